@@ -0,0 +1,264 @@
+#include "AwFmApproximateSearch.h"
+#include <stdlib.h>
+#include <string.h>
+#include "AwFmDiskBwt.h"
+#include "AwFmIndexStruct.h"
+#include "AwFmSearch.h"
+
+#define DEFAULT_HIT_LIST_CAPACITY 4
+
+static inline void **hitListHits(const struct AwFmHitListLayout *const layout,
+                                 void *searchData) {
+  return (void **)((uint8_t *)searchData + layout->hitsOffset);
+}
+
+static inline uint32_t *
+hitListCount(const struct AwFmHitListLayout *const layout, void *searchData) {
+  return (uint32_t *)((uint8_t *)searchData + layout->countOffset);
+}
+
+static inline uint32_t *
+hitListCapacity(const struct AwFmHitListLayout *const layout,
+                void *searchData) {
+  return (uint32_t *)((uint8_t *)searchData + layout->capacityOffset);
+}
+
+static inline void *searchDataAt(const struct AwFmHitListLayout *const layout,
+                                 void *searchDataArray, const size_t index) {
+  return (uint8_t *)searchDataArray + (index * layout->searchDataSize);
+}
+
+static inline uint8_t *hitAt(const struct AwFmHitListLayout *const layout,
+                             void *searchData, const uint32_t hitIndex) {
+  return (uint8_t *)*hitListHits(layout, searchData) +
+         (hitIndex * layout->hitSize);
+}
+
+void *awFmHitListAllocSearchData(const struct AwFmHitListLayout *const layout,
+                                 const size_t capacity) {
+  void *searchDataArray = calloc(capacity, layout->searchDataSize);
+  if (searchDataArray == NULL) {
+    return NULL;
+  }
+
+  bool hitListAllocationFailed = false;
+  for (size_t i = 0; i < capacity; i++) {
+    void *searchData = searchDataAt(layout, searchDataArray, i);
+    void *hits = malloc(DEFAULT_HIT_LIST_CAPACITY * layout->hitSize);
+    *hitListHits(layout, searchData) = hits;
+    *hitListCapacity(layout, searchData) = DEFAULT_HIT_LIST_CAPACITY;
+    hitListAllocationFailed |= hits == NULL;
+  }
+
+  if (hitListAllocationFailed) {
+    for (size_t i = 0; i < capacity; i++) {
+      free(*hitListHits(layout, searchDataAt(layout, searchDataArray, i)));
+    }
+    free(searchDataArray);
+    return NULL;
+  }
+  return searchDataArray;
+}
+
+void awFmHitListDeallocSearchData(const struct AwFmHitListLayout *const layout,
+                                  void *searchDataArray,
+                                  const size_t capacity) {
+  for (size_t i = 0; i < capacity; i++) {
+    void *searchData = searchDataAt(layout, searchDataArray, i);
+    awFmHitListClear(layout, searchData);
+    free(*hitListHits(layout, searchData));
+  }
+  free(searchDataArray);
+}
+
+void awFmHitListClear(const struct AwFmHitListLayout *const layout,
+                      void *searchData) {
+  uint32_t *count = hitListCount(layout, searchData);
+  for (uint32_t i = 0; i < *count; i++) {
+    uint8_t *hit = hitAt(layout, searchData, i);
+    uint64_t **positionList = (uint64_t **)(hit + layout->positionListOffset);
+    free(*positionList);
+    *positionList = NULL;
+  }
+  *count = 0;
+}
+
+bool awFmHitListAppend(const struct AwFmHitListLayout *const layout,
+                       void *searchData, const void *_RESTRICT_ const hit) {
+  uint32_t *count = hitListCount(layout, searchData);
+  uint32_t *capacity = hitListCapacity(layout, searchData);
+  if (*count == *capacity) {
+    const uint32_t newCapacity = *capacity * 2;
+    void *hits = realloc(*hitListHits(layout, searchData),
+                         newCapacity * layout->hitSize);
+    if (hits == NULL) {
+      return false;
+    }
+    *hitListHits(layout, searchData) = hits;
+    *capacity = newCapacity;
+  }
+  memcpy(hitAt(layout, searchData, (*count)++), hit, layout->hitSize);
+  return true;
+}
+
+enum AwFmReturnCode
+awFmHitListLocate(const struct AwFmHitListLayout *const layout,
+                  const struct AwFmIndex *_RESTRICT_ const index,
+                  void *searchData) {
+  const uint32_t count = *hitListCount(layout, searchData);
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t *hit = hitAt(layout, searchData, i);
+    enum AwFmReturnCode returnCode;
+    *(uint64_t **)(hit + layout->positionListOffset) =
+        awFmFindDatabaseHitPositions(
+            index, (struct AwFmSearchRange *)(hit + layout->rangeOffset),
+            &returnCode);
+    if (__builtin_expect(returnCode != AwFmFileReadOkay, 0)) {
+      return returnCode;
+    }
+  }
+  return AwFmSuccess;
+}
+
+bool awFmBranchSearchScratchReserve(
+    struct AwFmBranchSearchScratch *_RESTRICT_ const scratch,
+    const size_t queryLength) {
+  if (queryLength <= scratch->capacity) {
+    return true;
+  }
+  uint8_t *letters = realloc(scratch->letters, queryLength);
+  if (letters == NULL) {
+    return false;
+  }
+  scratch->letters = letters;
+  int16_t *profile =
+      realloc(scratch->profile,
+              queryLength * (AW_FM_AMINO_CARDINALITY + 1) * sizeof(int16_t));
+  if (profile == NULL) {
+    return false;
+  }
+  scratch->profile = profile;
+  int32_t *bestScoreBefore =
+      realloc(scratch->bestScoreBefore, (queryLength + 1) * sizeof(int32_t));
+  if (bestScoreBefore == NULL) {
+    return false;
+  }
+  scratch->bestScoreBefore = bestScoreBefore;
+  // the branch stack holds at most one branch per letter at each position.
+  struct AwFmBranch *branches =
+      realloc(scratch->branches,
+              ((queryLength * (AW_FM_AMINO_CARDINALITY + 1)) + 1) *
+                  sizeof(struct AwFmBranch));
+  if (branches == NULL) {
+    return false;
+  }
+  scratch->branches = branches;
+  scratch->capacity = queryLength;
+  return true;
+}
+
+void awFmBranchSearchScratchDealloc(
+    struct AwFmBranchSearchScratch *_RESTRICT_ const scratch) {
+  free(scratch->letters);
+  free(scratch->profile);
+  free(scratch->bestScoreBefore);
+  free(scratch->branches);
+}
+
+enum AwFmReturnCode
+awFmBranchAndBoundSearch(const struct AwFmIndex *_RESTRICT_ const index,
+                         const int16_t *_RESTRICT_ const profile,
+                         const size_t queryLength, const int32_t minScore,
+                         struct AwFmBranchSearchScratch *_RESTRICT_ const
+                             scratch,
+                         const AwFmBranchHitConsumer consumeHit,
+                         void *const consumerData) {
+  const int32_t *bestScoreBefore = scratch->bestScoreBefore;
+  if (queryLength == 0 || bestScoreBefore[queryLength] < minScore) {
+    return AwFmSuccess;
+  }
+
+  // the ambiguity letter is branched on too, so a query can be aligned to an
+  // ambiguous stretch of the database if its profile allows it.
+  const uint8_t numLetters =
+      awFmGetAlphabetCardinality(index->config.alphabetType) + 1;
+  struct AwFmBranch *branches = scratch->branches;
+  size_t numBranches = 0;
+  branches[numBranches++] = (struct AwFmBranch){
+      .range = {.startPtr = 0, .endPtr = index->bwtLength - 1},
+      .lettersSearched = 0,
+      .score = 0};
+
+  while (numBranches != 0) {
+    const struct AwFmBranch branch = branches[--numBranches];
+
+    // every letter's range comes from the occurrences before each end of
+    // the branch's range, one block read each.
+    uint64_t countsBefore[AW_FM_AMINO_CARDINALITY + 1];
+    uint64_t countsAfter[AW_FM_AMINO_CARDINALITY + 1];
+    awFmCountLettersBeforePosition(index, branch.range.startPtr,
+                                   countsBefore);
+    awFmCountLettersBeforePosition(index, branch.range.endPtr + 1,
+                                   countsAfter);
+
+    const size_t position = queryLength - 1 - branch.lettersSearched;
+    const int16_t *positionScores = profile + (position * numLetters);
+    for (uint8_t letterIndex = 0; letterIndex < numLetters; letterIndex++) {
+      if (countsAfter[letterIndex] == countsBefore[letterIndex]) {
+        continue;
+      }
+      const int32_t score = branch.score + positionScores[letterIndex];
+      if (score + bestScoreBefore[position] < minScore) {
+        continue;
+      }
+
+      const struct AwFmBranch extendedBranch = {
+          .range = {.startPtr = index->prefixSums[letterIndex] +
+                                countsBefore[letterIndex],
+                    .endPtr = index->prefixSums[letterIndex] +
+                              countsAfter[letterIndex] - 1},
+          .lettersSearched = branch.lettersSearched + 1,
+          .score = score};
+      if (extendedBranch.lettersSearched == queryLength) {
+        if (!consumeHit(consumerData, extendedBranch.range, score)) {
+          return AwFmAllocationFailure;
+        }
+      } else {
+        branches[numBranches++] = extendedBranch;
+      }
+    }
+  }
+  return AwFmSuccess;
+}
+
+enum AwFmReturnCode awFmParallelApproximateSearch(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    const struct AwFmHitListLayout *const layout, void *searchDataArray,
+    const size_t count, const AwFmApproximateQuerySearch searchQuery,
+    const void *parameters, const bool locate, const uint32_t numThreads) {
+  enum AwFmReturnCode atomicReturnCode = AwFmSuccess;
+  const uint64_t bwtReadFailures = awFmDiskBwtReadFailures(index);
+
+  // the number of branches varies widely between queries, so they're handed
+  // out one at a time.
+#pragma omp parallel num_threads(numThreads > 0 ? numThreads : 1)
+  {
+    struct AwFmBranchSearchScratch scratch = {0};
+#pragma omp for schedule(dynamic)
+    for (size_t i = 0; i < count; i++) {
+      void *searchData = searchDataAt(layout, searchDataArray, i);
+      awFmHitListClear(layout, searchData);
+      enum AwFmReturnCode returnCode =
+          searchQuery(index, searchData, &scratch, parameters);
+      if (returnCode == AwFmSuccess && locate) {
+        returnCode = awFmHitListLocate(layout, index, searchData);
+      }
+      if (__builtin_expect(returnCode != AwFmSuccess, 0)) {
+#pragma omp atomic write
+        atomicReturnCode = returnCode;
+      }
+    }
+    awFmBranchSearchScratchDealloc(&scratch);
+  }
+  return awFmDiskBwtCheckReads(index, bwtReadFailures, atomicReturnCode);
+}
@@ -0,0 +1,191 @@
+#ifndef AW_FM_APPROXIMATE_SEARCH_H
+#define AW_FM_APPROXIMATE_SEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "AwFmIndex.h"
+
+/*Where a search data struct keeps its hit list, and where its hits keep
+ * their range and position list, so the mismatch, neighborhood, and spaced
+ * seed searches can share the code that manages their hit lists. Every
+ * offset is from offsetof.*/
+struct AwFmHitListLayout {
+  size_t searchDataSize;
+  size_t hitsOffset;
+  size_t countOffset;
+  size_t capacityOffset;
+  size_t hitSize;
+  size_t rangeOffset;
+  size_t positionListOffset;
+};
+
+// a branch of a branch and bound search: the range of the words matching the
+// query's last lettersSearched positions, and the score of those positions.
+struct AwFmBranch {
+  struct AwFmSearchRange range;
+  uint64_t lettersSearched;
+  int32_t score;
+};
+
+/*Per-thread buffers for branch and bound searches, grown to fit the longest
+ * query seen so far. Features fill the profile and bestScoreBefore arrays
+ * before searching, and may use letters for the query's letter indices.*/
+struct AwFmBranchSearchScratch {
+  uint8_t *letters;
+  int16_t *profile;
+  int32_t *bestScoreBefore;
+  struct AwFmBranch *branches;
+  size_t capacity;
+};
+
+// adds a hit found by awFmBranchAndBoundSearch to consumerData. Returns false
+// if the hit couldn't be stored.
+typedef bool (*AwFmBranchHitConsumer)(void *consumerData,
+                                      const struct AwFmSearchRange range,
+                                      const int32_t score);
+
+// searches one query of a search list, whose hits have already been cleared.
+typedef enum AwFmReturnCode (*AwFmApproximateQuerySearch)(
+    const struct AwFmIndex *_RESTRICT_ const index, void *searchData,
+    struct AwFmBranchSearchScratch *_RESTRICT_ const scratch,
+    const void *parameters);
+
+/*
+ * Function:  awFmHitListAllocSearchData
+ * --------------------
+ * Allocates an array of search data structs, zeroing each one and giving it
+ * an empty hit list with a small starting capacity.
+ *
+ *  Inputs:
+ *    layout:   Layout of the search data and its hits.
+ *    capacity: Number of search data structs to allocate.
+ *
+ *  Returns:
+ *    The array, or NULL on an allocation failure.
+ */
+void *awFmHitListAllocSearchData(const struct AwFmHitListLayout *const layout,
+                                 const size_t capacity);
+
+/*
+ * Function:  awFmHitListDeallocSearchData
+ * --------------------
+ * Frees every hit list and position list in the array, then the array.
+ */
+void awFmHitListDeallocSearchData(const struct AwFmHitListLayout *const layout,
+                                  void *searchDataArray, const size_t capacity);
+
+/*
+ * Function:  awFmHitListClear
+ * --------------------
+ * Frees the position lists of a search data struct's hits and empties its hit
+ * list, keeping the list's memory for the next search.
+ */
+void awFmHitListClear(const struct AwFmHitListLayout *const layout,
+                      void *searchData);
+
+/*
+ * Function:  awFmHitListAppend
+ * --------------------
+ * Copies the hit to the end of the search data struct's hit list, doubling the
+ * list's capacity if it's full.
+ *
+ *  Returns:
+ *    True on success, or false if the list couldn't grow.
+ */
+bool awFmHitListAppend(const struct AwFmHitListLayout *const layout,
+                       void *searchData, const void *_RESTRICT_ const hit);
+
+/*
+ * Function:  awFmHitListLocate
+ * --------------------
+ * Sets the position list of each of the search data struct's hits to the
+ * database positions of its range.
+ *
+ *  Returns:
+ *    AwFmSuccess, or the error from awFmFindDatabaseHitPositions.
+ */
+enum AwFmReturnCode
+awFmHitListLocate(const struct AwFmHitListLayout *const layout,
+                  const struct AwFmIndex *_RESTRICT_ const index,
+                  void *searchData);
+
+/*
+ * Function:  awFmBranchSearchScratchReserve
+ * --------------------
+ * Grows the scratch's buffers to fit a query of the given length.
+ *
+ *  Returns:
+ *    True on success, or false on an allocation failure.
+ */
+bool awFmBranchSearchScratchReserve(
+    struct AwFmBranchSearchScratch *_RESTRICT_ const scratch,
+    const size_t queryLength);
+
+/*
+ * Function:  awFmBranchSearchScratchDealloc
+ * --------------------
+ * Frees the scratch's buffers.
+ */
+void awFmBranchSearchScratchDealloc(
+    struct AwFmBranchSearchScratch *_RESTRICT_ const scratch);
+
+/*
+ * Function:  awFmBranchAndBoundSearch
+ * --------------------
+ * Finds every database word as long as the query whose profile score is at
+ * least minScore, extending branches right to left one letter at a time.
+ * A branch is pruned as soon as its score plus bestScoreBefore at its next
+ * position falls below minScore, so the features only differ in how they
+ * score letters and bound the rest of the query.
+ *
+ *  Inputs:
+ *    index:          Index to search.
+ *    profile:        A row of scores for each query position, indexed by
+ *      letter index with the ambiguity letter included.
+ *    queryLength:    Number of positions in the query.
+ *    minScore:       Lowest score a hit may have.
+ *    scratch:        Scratch reserved for the query, with bestScoreBefore[i]
+ *      set to the most positions 0 through i - 1 can add to a score.
+ *    consumeHit:     Called with each hit and its score.
+ *    consumerData:   Passed to consumeHit.
+ *
+ *  Returns:
+ *    AwFmSuccess, or AwFmAllocationFailure if consumeHit failed.
+ */
+enum AwFmReturnCode
+awFmBranchAndBoundSearch(const struct AwFmIndex *_RESTRICT_ const index,
+                         const int16_t *_RESTRICT_ const profile,
+                         const size_t queryLength, const int32_t minScore,
+                         struct AwFmBranchSearchScratch *_RESTRICT_ const
+                             scratch,
+                         const AwFmBranchHitConsumer consumeHit,
+                         void *const consumerData);
+
+/*
+ * Function:  awFmParallelApproximateSearch
+ * --------------------
+ * Clears each query's hits, searches it with searchQuery, and locates its
+ * hits if asked to, handing queries out to the threads one at a time. Each
+ * thread keeps its own branch search scratch.
+ *
+ *  Inputs:
+ *    index:            Index to search.
+ *    layout:           Layout of the search data and its hits.
+ *    searchDataArray:  Array of the queries' search data.
+ *    count:            Number of queries in the array.
+ *    searchQuery:      Feature's search for a single query.
+ *    parameters:       Passed to searchQuery.
+ *    locate:           If true, the hits' position lists are set.
+ *    numThreads:       Number of threads to search with.
+ *
+ *  Returns:
+ *    AwFmSuccess, or the error of one of the failed queries.
+ */
+enum AwFmReturnCode awFmParallelApproximateSearch(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    const struct AwFmHitListLayout *const layout, void *searchDataArray,
+    const size_t count, const AwFmApproximateQuerySearch searchQuery,
+    const void *parameters, const bool locate, const uint32_t numThreads);
+
+#endif /* end of include guard: AW_FM_APPROXIMATE_SEARCH_H */
@@ -0,0 +1,562 @@
+// pread and syscall() need _GNU_SOURCE in strict c11 mode.
+#define _GNU_SOURCE
+
+#include "AwFmAsyncRead.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define AW_FM_IO_URING_SUPPORTED
+#endif
+#endif
+
+#define AW_FM_IO_URING_QUEUE_DEPTH 256
+#define AW_FM_ASYNC_READ_FALLBACK_THREADS 4
+// readers past this many idle ones are deallocated when they're released.
+#define AW_FM_ASYNC_READER_POOL_CAPACITY 64
+
+#ifdef AW_FM_IO_URING_SUPPORTED
+struct AwFmIoUring {
+  int ringFileDescriptor;
+  uint32_t sqEntries;
+  uint32_t *sqHead;
+  uint32_t *sqTail;
+  uint32_t *sqRingMask;
+  uint32_t *sqArray;
+  uint32_t *cqHead;
+  uint32_t *cqTail;
+  uint32_t *cqRingMask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sqRingPtr;
+  size_t sqRingByteLength;
+  void *cqRingPtr;
+  size_t cqRingByteLength;
+  size_t sqesByteLength;
+};
+#endif
+
+struct AwFmReadThreadPool {
+  pthread_t threads[AW_FM_ASYNC_READ_FALLBACK_THREADS];
+  uint32_t threadCount;
+  pthread_mutex_t lock;
+  pthread_cond_t workAvailable;
+  pthread_cond_t workFinished;
+  bool shuttingDown;
+};
+
+struct AwFmAsyncFileReader {
+  int fileDescriptor;
+  bool usesIoUring;
+#ifdef AW_FM_IO_URING_SUPPORTED
+  struct AwFmIoUring ring;
+#endif
+  struct AwFmReadThreadPool *threadPool;
+
+  // state for the batch currently in flight. When using the thread pool,
+  // these are protected by threadPool->lock.
+  struct AwFmAsyncReadRequest *requests;
+  size_t requestCount;
+  size_t nextRequestToSubmit;
+  size_t completedRequestCount;
+  bool batchInFlight;
+  bool batchFailed;
+};
+
+/*
+ * Function:  awFmAsyncReadRequestSynchronously
+ * --------------------
+ * Performs the read with blocking pread() calls, stopping early at the end of
+ * the file. Used by the thread pool, and to retry reads io_uring couldn't
+ * complete in full.
+ */
+static bool awFmAsyncReadRequestSynchronously(
+    const int fileDescriptor,
+    const struct AwFmAsyncReadRequest *_RESTRICT_ const request,
+    size_t totalBytesRead) {
+  while (totalBytesRead < request->length) {
+    const ssize_t bytesRead =
+        pread(fileDescriptor, request->buffer + totalBytesRead,
+              request->length - totalBytesRead,
+              request->fileOffset + totalBytesRead);
+    if (bytesRead < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytesRead <= 0) {
+      break;
+    }
+    totalBytesRead += bytesRead;
+  }
+  return totalBytesRead >= request->requiredLength;
+}
+
+#ifdef AW_FM_IO_URING_SUPPORTED
+static bool awFmIoUringInit(struct AwFmIoUring *_RESTRICT_ const ring) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(struct io_uring_params));
+  const int ringFileDescriptor =
+      syscall(__NR_io_uring_setup, AW_FM_IO_URING_QUEUE_DEPTH, &params);
+  if (ringFileDescriptor < 0) {
+    return false;
+  }
+
+  ring->ringFileDescriptor = ringFileDescriptor;
+  ring->sqEntries = params.sq_entries;
+  ring->sqRingByteLength =
+      params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  ring->cqRingByteLength =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqesByteLength = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (singleMmap) {
+    if (ring->cqRingByteLength > ring->sqRingByteLength) {
+      ring->sqRingByteLength = ring->cqRingByteLength;
+    }
+    ring->cqRingByteLength = ring->sqRingByteLength;
+  }
+
+  ring->sqRingPtr = mmap(NULL, ring->sqRingByteLength, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ringFileDescriptor,
+                         IORING_OFF_SQ_RING);
+  if (ring->sqRingPtr == MAP_FAILED) {
+    close(ringFileDescriptor);
+    return false;
+  }
+  if (singleMmap) {
+    ring->cqRingPtr = ring->sqRingPtr;
+  } else {
+    ring->cqRingPtr = mmap(NULL, ring->cqRingByteLength,
+                           PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           ringFileDescriptor, IORING_OFF_CQ_RING);
+    if (ring->cqRingPtr == MAP_FAILED) {
+      munmap(ring->sqRingPtr, ring->sqRingByteLength);
+      close(ringFileDescriptor);
+      return false;
+    }
+  }
+  ring->sqes = mmap(NULL, ring->sqesByteLength, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ringFileDescriptor,
+                    IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    if (!singleMmap) {
+      munmap(ring->cqRingPtr, ring->cqRingByteLength);
+    }
+    munmap(ring->sqRingPtr, ring->sqRingByteLength);
+    close(ringFileDescriptor);
+    return false;
+  }
+
+  uint8_t *sqRing = ring->sqRingPtr;
+  uint8_t *cqRing = ring->cqRingPtr;
+  ring->sqHead = (uint32_t *)(sqRing + params.sq_off.head);
+  ring->sqTail = (uint32_t *)(sqRing + params.sq_off.tail);
+  ring->sqRingMask = (uint32_t *)(sqRing + params.sq_off.ring_mask);
+  ring->sqArray = (uint32_t *)(sqRing + params.sq_off.array);
+  ring->cqHead = (uint32_t *)(cqRing + params.cq_off.head);
+  ring->cqTail = (uint32_t *)(cqRing + params.cq_off.tail);
+  ring->cqRingMask = (uint32_t *)(cqRing + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cqRing + params.cq_off.cqes);
+  return true;
+}
+
+static void awFmIoUringDealloc(struct AwFmIoUring *_RESTRICT_ const ring) {
+  munmap(ring->sqes, ring->sqesByteLength);
+  if (ring->cqRingPtr != ring->sqRingPtr) {
+    munmap(ring->cqRingPtr, ring->cqRingByteLength);
+  }
+  munmap(ring->sqRingPtr, ring->sqRingByteLength);
+  close(ring->ringFileDescriptor);
+}
+
+/*
+ * Function:  awFmIoUringQueueRequests
+ * --------------------
+ * Places as many of the batch's unsubmitted requests in the submission queue
+ * as there are free entries, keeping the number in flight at or below the
+ * queue depth so the completion queue can't overflow.
+ */
+static void
+awFmIoUringQueueRequests(struct AwFmAsyncFileReader *_RESTRICT_ const reader) {
+  struct AwFmIoUring *ring = &reader->ring;
+  const size_t requestsInFlight =
+      reader->nextRequestToSubmit - reader->completedRequestCount;
+  uint32_t tail = *ring->sqTail;
+  uint32_t queuedCount = 0;
+
+  while (reader->nextRequestToSubmit < reader->requestCount &&
+         requestsInFlight + queuedCount < ring->sqEntries) {
+    const struct AwFmAsyncReadRequest *request =
+        &reader->requests[reader->nextRequestToSubmit];
+    const uint32_t sqIndex = tail & *ring->sqRingMask;
+    struct io_uring_sqe *sqe = &ring->sqes[sqIndex];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = reader->fileDescriptor;
+    sqe->addr = (uint64_t)(uintptr_t)request->buffer;
+    sqe->len = request->length;
+    sqe->off = request->fileOffset;
+    sqe->user_data = reader->nextRequestToSubmit;
+    ring->sqArray[sqIndex] = sqIndex;
+
+    tail++;
+    queuedCount++;
+    reader->nextRequestToSubmit++;
+  }
+
+  __atomic_store_n(ring->sqTail, tail, __ATOMIC_RELEASE);
+}
+
+/*
+ * Function:  awFmIoUringEnter
+ * --------------------
+ * Submits every entry the kernel hasn't consumed from the submission queue,
+ * including ones a previous call left behind, and waits for minComplete
+ * completions.
+ *
+ *  Returns:
+ *    False if the ring failed with an error other than EAGAIN or EBUSY, which
+ *      only mean it should be retried once completions have been reaped.
+ */
+static bool awFmIoUringEnter(struct AwFmIoUring *_RESTRICT_ const ring,
+                             const uint32_t minComplete) {
+  const uint32_t flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+  const uint32_t unsubmittedCount =
+      *ring->sqTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+  int result;
+  do {
+    result = syscall(__NR_io_uring_enter, ring->ringFileDescriptor,
+                     unsubmittedCount, minComplete, flags, NULL, 0);
+  } while (result < 0 && errno == EINTR);
+  return result >= 0 || errno == EAGAIN || errno == EBUSY;
+}
+
+/*
+ * Function:  awFmIoUringDiscardUnsubmitted
+ * --------------------
+ * Drops the entries the kernel hasn't consumed from the submission queue, so
+ * a failed batch's reads aren't submitted with the next batch. The kernel
+ * only consumes entries inside io_uring_enter, so moving the tail back is
+ * safe.
+ */
+static void
+awFmIoUringDiscardUnsubmitted(struct AwFmIoUring *_RESTRICT_ const ring) {
+  __atomic_store_n(ring->sqTail,
+                   __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE),
+                   __ATOMIC_RELEASE);
+}
+
+/*
+ * Function:  awFmIoUringReapCompletions
+ * --------------------
+ * Consumes every entry in the completion queue. Reads that failed or came back
+ * short are finished synchronously, which also covers kernels that predate
+ * IORING_OP_READ.
+ */
+static void
+awFmIoUringReapCompletions(struct AwFmAsyncFileReader *_RESTRICT_ const reader) {
+  struct AwFmIoUring *ring = &reader->ring;
+  uint32_t head = *ring->cqHead;
+  const uint32_t tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+
+  while (head != tail) {
+    const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cqRingMask];
+    const struct AwFmAsyncReadRequest *request =
+        &reader->requests[cqe->user_data];
+    const int32_t result = cqe->res;
+    if (__builtin_expect(result < 0 || (size_t)result < request->length, 0)) {
+      const size_t bytesAlreadyRead = result < 0 ? 0 : result;
+      if (!awFmAsyncReadRequestSynchronously(reader->fileDescriptor, request,
+                                             bytesAlreadyRead)) {
+        reader->batchFailed = true;
+      }
+    }
+    reader->completedRequestCount++;
+    head++;
+  }
+
+  __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+}
+#endif
+
+static void *awFmReadThreadPoolWorker(void *readerPtr) {
+  struct AwFmAsyncFileReader *reader = readerPtr;
+  struct AwFmReadThreadPool *pool = reader->threadPool;
+
+  pthread_mutex_lock(&pool->lock);
+  while (true) {
+    while (!pool->shuttingDown &&
+           reader->nextRequestToSubmit >= reader->requestCount) {
+      pthread_cond_wait(&pool->workAvailable, &pool->lock);
+    }
+    if (pool->shuttingDown) {
+      break;
+    }
+
+    const struct AwFmAsyncReadRequest *request =
+        &reader->requests[reader->nextRequestToSubmit++];
+    pthread_mutex_unlock(&pool->lock);
+    const bool readSucceeded =
+        awFmAsyncReadRequestSynchronously(reader->fileDescriptor, request, 0);
+    pthread_mutex_lock(&pool->lock);
+
+    reader->batchFailed |= !readSucceeded;
+    reader->completedRequestCount++;
+    if (reader->completedRequestCount == reader->requestCount) {
+      pthread_cond_signal(&pool->workFinished);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+static void
+awFmReadThreadPoolDealloc(struct AwFmAsyncFileReader *_RESTRICT_ const reader) {
+  struct AwFmReadThreadPool *pool = reader->threadPool;
+  pthread_mutex_lock(&pool->lock);
+  pool->shuttingDown = true;
+  pthread_cond_broadcast(&pool->workAvailable);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (uint32_t i = 0; i < pool->threadCount; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+  pthread_cond_destroy(&pool->workFinished);
+  pthread_cond_destroy(&pool->workAvailable);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool);
+  reader->threadPool = NULL;
+}
+
+static bool
+awFmReadThreadPoolInit(struct AwFmAsyncFileReader *_RESTRICT_ const reader) {
+  struct AwFmReadThreadPool *pool = malloc(sizeof(struct AwFmReadThreadPool));
+  if (pool == NULL) {
+    return false;
+  }
+  pool->threadCount = 0;
+  pool->shuttingDown = false;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->workAvailable, NULL);
+  pthread_cond_init(&pool->workFinished, NULL);
+  reader->threadPool = pool;
+
+  for (uint32_t i = 0; i < AW_FM_ASYNC_READ_FALLBACK_THREADS; i++) {
+    if (pthread_create(&pool->threads[i], NULL, awFmReadThreadPoolWorker,
+                       reader) != 0) {
+      break;
+    }
+    pool->threadCount++;
+  }
+
+  if (pool->threadCount == 0) {
+    awFmReadThreadPoolDealloc(reader);
+    return false;
+  }
+  return true;
+}
+
+struct AwFmAsyncFileReader *awFmAsyncFileReaderCreate(const int fileDescriptor,
+                                                      const bool allowIoUring) {
+  struct AwFmAsyncFileReader *reader =
+      calloc(1, sizeof(struct AwFmAsyncFileReader));
+  if (reader == NULL) {
+    return NULL;
+  }
+  reader->fileDescriptor = fileDescriptor;
+
+#ifdef AW_FM_IO_URING_SUPPORTED
+  if (allowIoUring && awFmIoUringInit(&reader->ring)) {
+    reader->usesIoUring = true;
+    return reader;
+  }
+#else
+  (void)allowIoUring;
+#endif
+
+  if (!awFmReadThreadPoolInit(reader)) {
+    free(reader);
+    return NULL;
+  }
+  return reader;
+}
+
+enum AwFmReturnCode
+awFmAsyncFileReaderSubmit(struct AwFmAsyncFileReader *_RESTRICT_ const reader,
+                          struct AwFmAsyncReadRequest *_RESTRICT_ const requests,
+                          const size_t requestCount) {
+  if (reader->batchInFlight) {
+    return AwFmGeneralFailure;
+  }
+
+#ifdef AW_FM_IO_URING_SUPPORTED
+  if (reader->usesIoUring) {
+    reader->requests = requests;
+    reader->requestCount = requestCount;
+    reader->nextRequestToSubmit = 0;
+    reader->completedRequestCount = 0;
+    reader->batchFailed = false;
+    reader->batchInFlight = true;
+
+    awFmIoUringQueueRequests(reader);
+    if (!awFmIoUringEnter(&reader->ring, 0)) {
+      // nothing was submitted, so no read of the batch is in flight.
+      awFmIoUringDiscardUnsubmitted(&reader->ring);
+      reader->batchInFlight = false;
+      reader->requests = NULL;
+      reader->requestCount = 0;
+      return AwFmFileReadFail;
+    }
+    return AwFmSuccess;
+  }
+#endif
+
+  struct AwFmReadThreadPool *pool = reader->threadPool;
+  pthread_mutex_lock(&pool->lock);
+  reader->requests = requests;
+  reader->requestCount = requestCount;
+  reader->nextRequestToSubmit = 0;
+  reader->completedRequestCount = 0;
+  reader->batchFailed = false;
+  reader->batchInFlight = true;
+  pthread_cond_broadcast(&pool->workAvailable);
+  pthread_mutex_unlock(&pool->lock);
+  return AwFmSuccess;
+}
+
+enum AwFmReturnCode
+awFmAsyncFileReaderWait(struct AwFmAsyncFileReader *_RESTRICT_ const reader) {
+  if (!reader->batchInFlight) {
+    return AwFmFileReadOkay;
+  }
+
+#ifdef AW_FM_IO_URING_SUPPORTED
+  if (reader->usesIoUring) {
+    while (reader->completedRequestCount < reader->requestCount) {
+      awFmIoUringReapCompletions(reader);
+      awFmIoUringQueueRequests(reader);
+      if (reader->completedRequestCount == reader->requestCount) {
+        break;
+      }
+      if (!awFmIoUringEnter(&reader->ring, 1)) {
+        // the ring is unusable, and anything still queued will never
+        // complete.
+        awFmIoUringDiscardUnsubmitted(&reader->ring);
+        reader->batchFailed = true;
+        break;
+      }
+    }
+    reader->batchInFlight = false;
+    reader->requests = NULL;
+    reader->requestCount = 0;
+    return reader->batchFailed ? AwFmFileReadFail : AwFmFileReadOkay;
+  }
+#endif
+
+  struct AwFmReadThreadPool *pool = reader->threadPool;
+  pthread_mutex_lock(&pool->lock);
+  while (reader->completedRequestCount < reader->requestCount) {
+    pthread_cond_wait(&pool->workFinished, &pool->lock);
+  }
+  reader->batchInFlight = false;
+  reader->requests = NULL;
+  reader->requestCount = 0;
+  reader->nextRequestToSubmit = 0;
+  reader->completedRequestCount = 0;
+  const bool batchFailed = reader->batchFailed;
+  pthread_mutex_unlock(&pool->lock);
+  return batchFailed ? AwFmFileReadFail : AwFmFileReadOkay;
+}
+
+bool awFmAsyncFileReaderUsesIoUring(
+    const struct AwFmAsyncFileReader *_RESTRICT_ const reader) {
+  return reader->usesIoUring;
+}
+
+void awFmAsyncFileReaderDealloc(struct AwFmAsyncFileReader *reader) {
+  if (reader == NULL) {
+    return;
+  }
+  awFmAsyncFileReaderWait(reader);
+
+#ifdef AW_FM_IO_URING_SUPPORTED
+  if (reader->usesIoUring) {
+    awFmIoUringDealloc(&reader->ring);
+  }
+#endif
+  if (reader->threadPool != NULL) {
+    awFmReadThreadPoolDealloc(reader);
+  }
+  free(reader);
+}
+
+struct AwFmAsyncFileReaderPool {
+  pthread_mutex_t lock;
+  struct AwFmAsyncFileReader *idleReaders[AW_FM_ASYNC_READER_POOL_CAPACITY];
+  uint32_t idleReaderCount;
+};
+
+struct AwFmAsyncFileReaderPool *awFmAsyncFileReaderPoolCreate(void) {
+  struct AwFmAsyncFileReaderPool *pool =
+      calloc(1, sizeof(struct AwFmAsyncFileReaderPool));
+  if (pool == NULL) {
+    return NULL;
+  }
+  if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+    free(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+struct AwFmAsyncFileReader *awFmAsyncFileReaderPoolAcquire(
+    struct AwFmAsyncFileReaderPool *_RESTRICT_ const pool,
+    const int fileDescriptor) {
+  struct AwFmAsyncFileReader *reader = NULL;
+  pthread_mutex_lock(&pool->lock);
+  if (pool->idleReaderCount > 0) {
+    reader = pool->idleReaders[--pool->idleReaderCount];
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  // creating the reader happens outside the lock, since it may spawn threads.
+  if (reader == NULL) {
+    reader = awFmAsyncFileReaderCreate(fileDescriptor, true);
+  }
+  return reader;
+}
+
+void awFmAsyncFileReaderPoolRelease(
+    struct AwFmAsyncFileReaderPool *_RESTRICT_ const pool,
+    struct AwFmAsyncFileReader *reader) {
+  if (reader == NULL) {
+    return;
+  }
+  awFmAsyncFileReaderWait(reader);
+
+  pthread_mutex_lock(&pool->lock);
+  if (pool->idleReaderCount < AW_FM_ASYNC_READER_POOL_CAPACITY) {
+    pool->idleReaders[pool->idleReaderCount++] = reader;
+    reader = NULL;
+  }
+  pthread_mutex_unlock(&pool->lock);
+  awFmAsyncFileReaderDealloc(reader);
+}
+
+void awFmAsyncFileReaderPoolDealloc(struct AwFmAsyncFileReaderPool *pool) {
+  if (pool == NULL) {
+    return;
+  }
+  for (uint32_t i = 0; i < pool->idleReaderCount; i++) {
+    awFmAsyncFileReaderDealloc(pool->idleReaders[i]);
+  }
+  pthread_mutex_destroy(&pool->lock);
+  free(pool);
+}
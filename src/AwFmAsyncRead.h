@@ -0,0 +1,144 @@
+#ifndef AW_FM_ASYNC_READ_H
+#define AW_FM_ASYNC_READ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "AwFmIndex.h"
+
+/*A single read submitted to an AwFmAsyncFileReader. Reads may extend past
+ * the end of the file, as long as the first requiredLength bytes exist.*/
+struct AwFmAsyncReadRequest {
+  uint8_t *buffer;
+  size_t fileOffset;
+  size_t length;
+  size_t requiredLength;
+};
+
+// opaque, defined in AwFmAsyncRead.c.
+struct AwFmAsyncFileReader;
+
+/*
+ * Function:  awFmAsyncFileReaderCreate
+ * --------------------
+ * Creates a reader that services batches of reads against the given file
+ * without blocking the caller. On linux, reads are submitted through an
+ * io_uring instance. If io_uring isn't available (old kernels, seccomp
+ * filters, or allowIoUring is false), reads are instead serviced by a small
+ * pool of worker threads using pread().
+ *
+ * Each reader may only have one batch in flight at a time, and is not safe to
+ * share between threads.
+ *
+ *  Inputs:
+ *    fileDescriptor: File to read from. Must stay open for the reader's life.
+ *    allowIoUring:   If false, the thread pool is always used.
+ *
+ *  Returns:
+ *    Pointer to the new reader, or NULL on allocation failure.
+ */
+struct AwFmAsyncFileReader *awFmAsyncFileReaderCreate(const int fileDescriptor,
+                                                      const bool allowIoUring);
+
+/*
+ * Function:  awFmAsyncFileReaderSubmit
+ * --------------------
+ * Starts reading every request in the batch, and returns without waiting for
+ * them to complete. The requests array and every buffer it points to must
+ * remain valid until awFmAsyncFileReaderWait returns.
+ *
+ *  Inputs:
+ *    reader:       Reader with no batch currently in flight.
+ *    requests:     Array of reads to perform.
+ *    requestCount: Number of reads in the requests array.
+ *
+ *  Returns:
+ *    AwFmSuccess if the batch was started, AwFmGeneralFailure if the reader
+ *      already had a batch in flight, or AwFmFileReadFail if io_uring
+ *      couldn't submit it. A batch that wasn't started needs no wait.
+ */
+enum AwFmReturnCode
+awFmAsyncFileReaderSubmit(struct AwFmAsyncFileReader *_RESTRICT_ const reader,
+                          struct AwFmAsyncReadRequest *_RESTRICT_ const requests,
+                          const size_t requestCount);
+
+/*
+ * Function:  awFmAsyncFileReaderWait
+ * --------------------
+ * Blocks until every read in the in-flight batch has completed.
+ *
+ *  Returns:
+ *    AwFmFileReadOkay if every read succeeded, or AwFmFileReadFail if any
+ *      read returned an error or ended before its requiredLength.
+ */
+enum AwFmReturnCode
+awFmAsyncFileReaderWait(struct AwFmAsyncFileReader *_RESTRICT_ const reader);
+
+/*
+ * Function:  awFmAsyncFileReaderUsesIoUring
+ * --------------------
+ * Returns true if the reader submits reads through io_uring, false if it uses
+ * the thread pool fallback.
+ */
+bool awFmAsyncFileReaderUsesIoUring(
+    const struct AwFmAsyncFileReader *_RESTRICT_ const reader);
+
+/*
+ * Function:  awFmAsyncFileReaderDealloc
+ * --------------------
+ * Waits for any in-flight batch, then frees the reader. May be given NULL.
+ */
+void awFmAsyncFileReaderDealloc(struct AwFmAsyncFileReader *reader);
+
+// opaque, defined in AwFmAsyncRead.c.
+struct AwFmAsyncFileReaderPool;
+
+/*
+ * Function:  awFmAsyncFileReaderPoolCreate
+ * --------------------
+ * Creates an empty pool of readers, so that setting up an io_uring instance or
+ * thread pool only happens the first time each concurrent caller needs one,
+ * instead of on every batch. The pool is safe to share between threads.
+ *
+ *  Returns:
+ *    Pointer to the new pool, or NULL on allocation failure.
+ */
+struct AwFmAsyncFileReaderPool *awFmAsyncFileReaderPoolCreate(void);
+
+/*
+ * Function:  awFmAsyncFileReaderPoolAcquire
+ * --------------------
+ * Takes an idle reader from the pool, or creates one if every pooled reader is
+ * in use. The reader belongs to the caller until it's released.
+ *
+ *  Inputs:
+ *    pool:           Pool to take the reader from.
+ *    fileDescriptor: File to read from. Every reader in a pool must read the
+ *      same file.
+ *
+ *  Returns:
+ *    Pointer to the reader, or NULL if a new reader couldn't be created.
+ */
+struct AwFmAsyncFileReader *awFmAsyncFileReaderPoolAcquire(
+    struct AwFmAsyncFileReaderPool *_RESTRICT_ const pool,
+    const int fileDescriptor);
+
+/*
+ * Function:  awFmAsyncFileReaderPoolRelease
+ * --------------------
+ * Waits for any in-flight batch, then returns the reader to the pool. If the
+ * pool is full, the reader is deallocated instead. May be given a NULL reader.
+ */
+void awFmAsyncFileReaderPoolRelease(
+    struct AwFmAsyncFileReaderPool *_RESTRICT_ const pool,
+    struct AwFmAsyncFileReader *reader);
+
+/*
+ * Function:  awFmAsyncFileReaderPoolDealloc
+ * --------------------
+ * Deallocates every reader in the pool, then the pool itself. No reader from
+ * the pool may still be in use. May be given NULL.
+ */
+void awFmAsyncFileReaderPoolDealloc(struct AwFmAsyncFileReaderPool *pool);
+
+#endif /* end of include guard: AW_FM_ASYNC_READ_H */
@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include "AwFmDiskBwt.h"
+#include "AwFmIndex.h"
+#include "AwFmIndexStruct.h"
+#include "AwFmSearch.h"
+
+// letters of the recovered sequence, by letter index. The ambiguity letter is
+// last, so every index sanitizes back to itself when the reverse is built.
+static const char nucleotideLetters[] = "acgtx";
+static const char aminoLetters[] = "acdefghiklmnpqrstvwyz";
+
+// true if the sentinel is one of the BWT positions [start, start + length).
+static inline bool
+rangeHoldsSentinel(const uint64_t sentinelPosition, const uint64_t start,
+                   const uint64_t length) {
+  return sentinelPosition - start < length;
+}
+
+// steps the range of sourceIndex back by letterIndex, and moves the paired
+// start in the other index past every suffix that continues with a lesser
+// letter, or ends the sequence.
+static inline void
+stepRange(const struct AwFmIndex *_RESTRICT_ const sourceIndex,
+          const uint64_t sourceSentinelPosition,
+          uint64_t *_RESTRICT_ sourceStart, uint64_t *_RESTRICT_ pairedStart,
+          uint64_t *_RESTRICT_ length, const uint8_t letterIndex) {
+  uint64_t countsBefore[AW_FM_AMINO_CARDINALITY + 1];
+  uint64_t countsAfter[AW_FM_AMINO_CARDINALITY + 1];
+  awFmCountLettersBeforePosition(sourceIndex, *sourceStart, countsBefore);
+  awFmCountLettersBeforePosition(sourceIndex, *sourceStart + *length,
+                                 countsAfter);
+
+  uint64_t lesserSuffixes =
+      rangeHoldsSentinel(sourceSentinelPosition, *sourceStart, *length);
+  for (uint8_t lesserLetter = 0; lesserLetter < letterIndex; lesserLetter++) {
+    lesserSuffixes += countsAfter[lesserLetter] - countsBefore[lesserLetter];
+  }
+
+  *sourceStart = sourceIndex->prefixSums[letterIndex] +
+                 countsBefore[letterIndex];
+  *pairedStart += lesserSuffixes;
+  *length = countsAfter[letterIndex] - countsBefore[letterIndex];
+}
+
+static enum AwFmReturnCode
+setSentinelPositions(struct AwFmBiDirectionalIndex *_RESTRICT_ const biIndex) {
+  if (biIndex->forwardIndex->config.alphabetType !=
+          biIndex->reverseIndex->config.alphabetType ||
+      biIndex->forwardIndex->bwtLength != biIndex->reverseIndex->bwtLength) {
+    return AwFmIncompatibleIndices;
+  }
+  biIndex->forwardSentinelPosition =
+      awFmFindSentinelBwtPosition(biIndex->forwardIndex);
+  biIndex->reverseSentinelPosition =
+      awFmFindSentinelBwtPosition(biIndex->reverseIndex);
+  return AwFmSuccess;
+}
+
+enum AwFmReturnCode awFmCreateBiDirectionalIndex(
+    struct AwFmBiDirectionalIndex *_RESTRICT_ *biIndex,
+    struct AwFmIndex *_RESTRICT_ const forwardIndex,
+    const char *_RESTRICT_ const reverseIndexFileSrc) {
+  if (biIndex == NULL || forwardIndex == NULL) {
+    return AwFmNullPtrError;
+  }
+  if (reverseIndexFileSrc == NULL) {
+    return AwFmNoFileSrcGiven;
+  }
+  *biIndex = NULL;
+  if (forwardIndex->config.alphabetType == AwFmAlphabetReducedAmino) {
+    return AwFmFeatureUnsupported;
+  }
+
+  // backtracing from the suffix that starts the sequence visits every letter
+  // from the last to the first, which is the reversed sequence in order.
+  const bool isAmino = forwardIndex->config.alphabetType == AwFmAlphabetAmino;
+  const char *letters = isAmino ? aminoLetters : nucleotideLetters;
+  const size_t sequenceLength = forwardIndex->bwtLength - 1;
+  uint8_t *reversedSequence = malloc(sequenceLength);
+  struct AwFmBiDirectionalIndex *newIndex = malloc(sizeof(*newIndex));
+  if (reversedSequence == NULL || newIndex == NULL) {
+    free(reversedSequence);
+    free(newIndex);
+    return AwFmAllocationFailure;
+  }
+
+  const uint64_t bwtReadFailures = awFmDiskBwtReadFailures(forwardIndex);
+  uint64_t bwtPosition = 0;
+  for (size_t i = 0; i < sequenceLength; i++) {
+    const uint8_t letterIndex =
+        isAmino ? awFmAminoBacktraceReturnPreviousLetterIndex(forwardIndex,
+                                                              &bwtPosition)
+                : awFmNucleotideBacktraceReturnPreviousLetterIndex(
+                      forwardIndex, &bwtPosition);
+    reversedSequence[i] = letters[letterIndex];
+  }
+  if (awFmDiskBwtCheckReads(forwardIndex, bwtReadFailures, AwFmSuccess) !=
+      AwFmSuccess) {
+    free(reversedSequence);
+    free(newIndex);
+    return AwFmFileReadFail;
+  }
+
+  // only the reverse index's BWT is ever used, so it samples its suffix array
+  // as sparsely as it can, and doesn't store the sequence.
+  struct AwFmIndexConfiguration reverseConfig = forwardIndex->config;
+  reverseConfig.suffixArrayCompressionRatio = UINT8_MAX;
+  reverseConfig.keepSuffixArrayInMemory = false;
+  reverseConfig.storeOriginalSequence = false;
+  const struct AwFmIndexBuildOptions reverseOptions = {
+      .allocationPolicy = forwardIndex->allocationPolicy,
+      .useDirectIo = forwardIndex->useDirectIo};
+
+  newIndex->forwardIndex = forwardIndex;
+  enum AwFmReturnCode returnCode = awFmCreateIndexWithOptions(
+      &newIndex->reverseIndex, &reverseConfig, reversedSequence,
+      sequenceLength, reverseIndexFileSrc, &reverseOptions);
+  free(reversedSequence);
+  if (returnCode != AwFmFileWriteOkay) {
+    free(newIndex);
+    return returnCode;
+  }
+
+  returnCode = setSentinelPositions(newIndex);
+  if (returnCode != AwFmSuccess) {
+    awFmDeallocIndex(newIndex->reverseIndex);
+    free(newIndex);
+    return returnCode;
+  }
+
+  *biIndex = newIndex;
+  return AwFmFileWriteOkay;
+}
+
+enum AwFmReturnCode awFmReadBiDirectionalIndexFromFile(
+    struct AwFmBiDirectionalIndex *_RESTRICT_ *biIndex,
+    const char *_RESTRICT_ const forwardFileSrc,
+    const char *_RESTRICT_ const reverseFileSrc,
+    const bool keepSuffixArrayInMemory) {
+  if (biIndex == NULL) {
+    return AwFmNullPtrError;
+  }
+  if (forwardFileSrc == NULL || reverseFileSrc == NULL) {
+    return AwFmNoFileSrcGiven;
+  }
+  *biIndex = NULL;
+
+  struct AwFmBiDirectionalIndex *newIndex = calloc(1, sizeof(*newIndex));
+  if (newIndex == NULL) {
+    return AwFmAllocationFailure;
+  }
+
+  enum AwFmReturnCode returnCode = awFmReadIndexFromFile(
+      &newIndex->forwardIndex, forwardFileSrc, keepSuffixArrayInMemory);
+  if (returnCode == AwFmFileReadOkay) {
+    returnCode = awFmReadIndexFromFile(&newIndex->reverseIndex,
+                                       reverseFileSrc, false);
+  }
+  if (returnCode == AwFmFileReadOkay) {
+    returnCode = setSentinelPositions(newIndex);
+  }
+  if (returnCode != AwFmSuccess) {
+    awFmDeallocBiDirectionalIndex(newIndex);
+    return returnCode;
+  }
+
+  *biIndex = newIndex;
+  return AwFmFileReadOkay;
+}
+
+void awFmDeallocBiDirectionalIndex(struct AwFmBiDirectionalIndex *biIndex) {
+  if (biIndex != NULL) {
+    awFmDeallocIndex(biIndex->forwardIndex);
+    awFmDeallocIndex(biIndex->reverseIndex);
+    free(biIndex);
+  }
+}
+
+struct AwFmBiDirectionalRange awFmBiDirectionalCreateInitialRange(
+    const struct AwFmBiDirectionalIndex *_RESTRICT_ const biIndex,
+    const uint8_t letterIndex) {
+  // a single letter is its own reverse, so it has the same range in both.
+  const uint64_t *prefixSums = biIndex->forwardIndex->prefixSums;
+  return (struct AwFmBiDirectionalRange){
+      .forwardStartPtr = prefixSums[letterIndex],
+      .reverseStartPtr = prefixSums[letterIndex],
+      .length = prefixSums[letterIndex + 1] - prefixSums[letterIndex]};
+}
+
+void awFmBiDirectionalExtendLeft(
+    const struct AwFmBiDirectionalIndex *_RESTRICT_ const biIndex,
+    struct AwFmBiDirectionalRange *_RESTRICT_ const range,
+    const uint8_t letterIndex) {
+  stepRange(biIndex->forwardIndex, biIndex->forwardSentinelPosition,
+            &range->forwardStartPtr, &range->reverseStartPtr, &range->length,
+            letterIndex);
+}
+
+void awFmBiDirectionalExtendRight(
+    const struct AwFmBiDirectionalIndex *_RESTRICT_ const biIndex,
+    struct AwFmBiDirectionalRange *_RESTRICT_ const range,
+    const uint8_t letterIndex) {
+  stepRange(biIndex->reverseIndex, biIndex->reverseSentinelPosition,
+            &range->reverseStartPtr, &range->forwardStartPtr, &range->length,
+            letterIndex);
+}
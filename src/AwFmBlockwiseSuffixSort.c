@@ -0,0 +1,828 @@
+#include "AwFmBlockwiseSuffixSort.h"
+#include <omp.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// difference cover periods are tried from smallest (cheapest comparisons) to
+// largest (smallest sample). Each is a power of 4, so its cover is easy to
+// build.
+#define AW_FM_BLOCKWISE_MIN_PERIOD_LOG2 6
+#define AW_FM_BLOCKWISE_MAX_PERIOD_LOG2 12
+#define AW_FM_BLOCKWISE_MAX_PERIOD (1 << AW_FM_BLOCKWISE_MAX_PERIOD_LOG2)
+// budgets that can't hold a partition this large are rejected.
+#define AW_FM_BLOCKWISE_MIN_PARTITION_CAPACITY 4096
+#define AW_FM_BLOCKWISE_INSERTION_SORT_MAX 16
+// sorts at least this large are split into tasks for all threads.
+#define AW_FM_BLOCKWISE_PARALLEL_SORT_MIN (1 << 16)
+// splitters are picked from a random sample this many times larger than the
+// number of partitions.
+#define AW_FM_BLOCKWISE_SPLITTER_OVERSAMPLING 32
+#define AW_FM_BLOCKWISE_COLLECT_STASH_SIZE 1024
+#define AW_FM_BLOCKWISE_INITIAL_GROUP_CAPACITY 1024
+// marks an unbounded side of a range, and an unknown head while ranking.
+#define AW_FM_BLOCKWISE_NONE UINT64_MAX
+
+struct AwFmBlockwiseEntry {
+  uint64_t key;
+  uint64_t position;
+};
+
+struct AwFmBlockwiseGroup {
+  size_t start;
+  size_t length;
+};
+
+struct AwFmBlockwiseGroupList {
+  struct AwFmBlockwiseGroup *groups;
+  size_t count;
+  size_t capacity;
+};
+
+// suffixes after lower (exclusive), up to and including upper.
+struct AwFmBlockwiseRange {
+  uint64_t lower;
+  uint64_t upper;
+};
+
+enum AwFmBlockwiseOrder {
+  // by key alone.
+  AwFmBlockwiseOrderKey,
+  // by the first period characters of the suffix.
+  AwFmBlockwiseOrderSamplePrefix,
+  // by the whole suffix. requires the ranked sample.
+  AwFmBlockwiseOrderSuffix
+};
+
+struct AwFmBlockwiseState {
+  const uint8_t *text;
+  uint64_t length;
+  uint32_t period;
+  uint8_t periodLog2;
+  uint32_t coverSize;
+  bool residueInCover[AW_FM_BLOCKWISE_MAX_PERIOD];
+  uint16_t residueCoverIndex[AW_FM_BLOCKWISE_MAX_PERIOD];
+  // for each difference d, a residue x in the cover where x + d is also in
+  // the cover.
+  uint16_t coverForDifference[AW_FM_BLOCKWISE_MAX_PERIOD];
+  // rank of each sampled suffix among the sampled suffixes.
+  uint64_t *sampleRanks;
+  struct AwFmBlockwiseEntry *partition;
+  size_t partitionCapacity;
+  AwFmSortedSuffixConsumer consumer;
+  void *context;
+  uint32_t numThreads;
+  size_t currentBytes;
+  size_t peakBytes;
+  uint32_t numPartitions;
+};
+
+static void *awFmBlockwiseAlloc(struct AwFmBlockwiseState *_RESTRICT_ state,
+                                const size_t numBytes) {
+  void *allocation = malloc(numBytes);
+  if (allocation != NULL) {
+    state->currentBytes += numBytes;
+    if (state->currentBytes > state->peakBytes) {
+      state->peakBytes = state->currentBytes;
+    }
+  }
+  return allocation;
+}
+
+static void awFmBlockwiseFree(struct AwFmBlockwiseState *_RESTRICT_ state,
+                              void *allocation, const size_t numBytes) {
+  free(allocation);
+  state->currentBytes -= numBytes;
+}
+
+// uses the cover {0..r-1} U {0, r, 2r, .. (r-1)r} for period r^2. Any
+// difference a*r + b is covered by b - (r-a)r.
+static void awFmBlockwiseInitCover(struct AwFmBlockwiseState *_RESTRICT_ state,
+                                   const uint8_t periodLog2) {
+  const uint32_t period = 1 << periodLog2;
+  const uint32_t root = 1 << (periodLog2 / 2);
+  state->period = period;
+  state->periodLog2 = periodLog2;
+
+  memset(state->residueInCover, 0, sizeof(state->residueInCover));
+  for (uint32_t i = 0; i < root; i++) {
+    state->residueInCover[i] = true;
+    state->residueInCover[i * root] = true;
+  }
+  state->coverSize = 0;
+  for (uint32_t residue = 0; residue < period; residue++) {
+    if (state->residueInCover[residue]) {
+      state->residueCoverIndex[residue] = state->coverSize++;
+    }
+  }
+  for (uint32_t difference = 0; difference < period; difference++) {
+    for (uint32_t residue = 0; residue < period; residue++) {
+      if (state->residueInCover[residue] &&
+          state->residueInCover[(residue + difference) & (period - 1)]) {
+        state->coverForDifference[difference] = residue;
+        break;
+      }
+    }
+  }
+}
+
+static inline size_t
+awFmBlockwiseSampleIndex(const struct AwFmBlockwiseState *_RESTRICT_ state,
+                         const uint64_t position) {
+  return (position >> state->periodLog2) * state->coverSize +
+         state->residueCoverIndex[position & (state->period - 1)];
+}
+
+// the first 8 characters of the suffix, with 0 past the end of the text.
+static inline uint64_t
+awFmBlockwisePrefixKey(const struct AwFmBlockwiseState *_RESTRICT_ state,
+                       const uint64_t position) {
+  if (__builtin_expect(position + 8 <= state->length, 1)) {
+    uint64_t key;
+    memcpy(&key, state->text + position, sizeof(uint64_t));
+    return __builtin_bswap64(key);
+  }
+  uint64_t key = 0;
+  for (uint8_t i = 0; i < 8; i++) {
+    key = (key << 8) |
+          (position + i < state->length ? state->text[position + i] : 0);
+  }
+  return key;
+}
+
+// compares up to count characters of the suffixes at a and b, 8 at a time
+// while both have 8 left. Returns 0 if they all match.
+static inline int awFmBlockwiseCompareCharacters(
+    const struct AwFmBlockwiseState *_RESTRICT_ state, const uint64_t a,
+    const uint64_t b, const uint32_t count) {
+  const uint8_t *_RESTRICT_ const text = state->text;
+  const uint64_t furthest = a > b ? a : b;
+  uint32_t i = 0;
+  for (; i + 8 <= count && furthest + i + 8 <= state->length; i += 8) {
+    uint64_t aWord, bWord;
+    memcpy(&aWord, text + a + i, sizeof(uint64_t));
+    memcpy(&bWord, text + b + i, sizeof(uint64_t));
+    if (aWord != bWord) {
+      return __builtin_bswap64(aWord) < __builtin_bswap64(bWord) ? -1 : 1;
+    }
+  }
+  for (; i < count; i++) {
+    if (text[a + i] != text[b + i]) {
+      return text[a + i] < text[b + i] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+// compares two different suffixes. The characters are compared until both
+// suffixes reach a sampled position, after which the sample ranks decide.
+// Since the last character of the text is unique, two different suffixes
+// always mismatch before either reads past the end.
+static inline int
+awFmBlockwiseCompareSuffixes(const struct AwFmBlockwiseState *_RESTRICT_ state,
+                             const uint64_t a, const uint64_t b) {
+  const uint32_t periodMask = state->period - 1;
+  const uint32_t coveredResidue =
+      state->coverForDifference[(b - a) & periodMask];
+  const uint32_t distanceToSample = (coveredResidue - a) & periodMask;
+  const int comparison =
+      awFmBlockwiseCompareCharacters(state, a, b, distanceToSample);
+  if (comparison != 0) {
+    return comparison;
+  }
+  return state->sampleRanks[awFmBlockwiseSampleIndex(state,
+                                                     a + distanceToSample)] <
+                 state->sampleRanks[awFmBlockwiseSampleIndex(
+                     state, b + distanceToSample)]
+             ? -1
+             : 1;
+}
+
+static inline int
+awFmBlockwiseCompare(const struct AwFmBlockwiseState *_RESTRICT_ state,
+                     const enum AwFmBlockwiseOrder order,
+                     const struct AwFmBlockwiseEntry *x,
+                     const struct AwFmBlockwiseEntry *y) {
+  if (x->key != y->key) {
+    return x->key < y->key ? -1 : 1;
+  }
+  if (order == AwFmBlockwiseOrderKey || x->position == y->position) {
+    return 0;
+  }
+  // matching prefix keys hold no end of text, so both suffixes continue for
+  // at least 8 more characters.
+  if (order == AwFmBlockwiseOrderSuffix) {
+    return awFmBlockwiseCompareSuffixes(state, x->position + 8,
+                                        y->position + 8);
+  }
+  return awFmBlockwiseCompareCharacters(state, x->position + 8,
+                                        y->position + 8, state->period - 8);
+}
+
+static inline void awFmBlockwiseSwap(struct AwFmBlockwiseEntry *x,
+                                     struct AwFmBlockwiseEntry *y) {
+  const struct AwFmBlockwiseEntry temp = *x;
+  *x = *y;
+  *y = temp;
+}
+
+static void
+awFmBlockwiseSiftDown(const struct AwFmBlockwiseState *_RESTRICT_ state,
+                      struct AwFmBlockwiseEntry *entries, size_t root,
+                      const size_t end, const enum AwFmBlockwiseOrder order) {
+  while (2 * root + 1 < end) {
+    size_t child = 2 * root + 1;
+    if (child + 1 < end && awFmBlockwiseCompare(state, order, &entries[child],
+                                                &entries[child + 1]) < 0) {
+      child++;
+    }
+    if (awFmBlockwiseCompare(state, order, &entries[root], &entries[child]) >=
+        0) {
+      return;
+    }
+    awFmBlockwiseSwap(&entries[root], &entries[child]);
+    root = child;
+  }
+}
+
+static void
+awFmBlockwiseHeapSort(const struct AwFmBlockwiseState *_RESTRICT_ state,
+                      struct AwFmBlockwiseEntry *entries, const size_t count,
+                      const enum AwFmBlockwiseOrder order) {
+  for (size_t root = count / 2; root > 0; root--) {
+    awFmBlockwiseSiftDown(state, entries, root - 1, count, order);
+  }
+  for (size_t end = count - 1; end > 0; end--) {
+    awFmBlockwiseSwap(&entries[0], &entries[end]);
+    awFmBlockwiseSiftDown(state, entries, 0, end, order);
+  }
+}
+
+static void awFmBlockwiseSort(const struct AwFmBlockwiseState *_RESTRICT_ state,
+                              struct AwFmBlockwiseEntry *entries, size_t count,
+                              const enum AwFmBlockwiseOrder order,
+                              uint32_t depthLimit, const bool spawnTasks) {
+  while (count > AW_FM_BLOCKWISE_INSERTION_SORT_MAX) {
+    if (depthLimit == 0) {
+      awFmBlockwiseHeapSort(state, entries, count, order);
+      return;
+    }
+    depthLimit--;
+
+    // median of three pivot, then a three-way partition so runs of equal
+    // entries are finished in one step.
+    struct AwFmBlockwiseEntry *first = &entries[0];
+    struct AwFmBlockwiseEntry *middle = &entries[count / 2];
+    struct AwFmBlockwiseEntry *last = &entries[count - 1];
+    if (awFmBlockwiseCompare(state, order, middle, first) < 0) {
+      awFmBlockwiseSwap(middle, first);
+    }
+    if (awFmBlockwiseCompare(state, order, last, middle) < 0) {
+      awFmBlockwiseSwap(last, middle);
+      if (awFmBlockwiseCompare(state, order, middle, first) < 0) {
+        awFmBlockwiseSwap(middle, first);
+      }
+    }
+    const struct AwFmBlockwiseEntry pivot = *middle;
+
+    size_t lessEnd = 0;
+    size_t i = 0;
+    size_t greaterStart = count;
+    while (i < greaterStart) {
+      const int comparison =
+          awFmBlockwiseCompare(state, order, &entries[i], &pivot);
+      if (comparison < 0) {
+        awFmBlockwiseSwap(&entries[lessEnd++], &entries[i++]);
+      } else if (comparison > 0) {
+        awFmBlockwiseSwap(&entries[i], &entries[--greaterStart]);
+      } else {
+        i++;
+      }
+    }
+
+    if (spawnTasks && lessEnd >= AW_FM_BLOCKWISE_PARALLEL_SORT_MIN) {
+#pragma omp task
+      awFmBlockwiseSort(state, entries, lessEnd, order, depthLimit, true);
+    } else {
+      awFmBlockwiseSort(state, entries, lessEnd, order, depthLimit,
+                        spawnTasks);
+    }
+    entries += greaterStart;
+    count -= greaterStart;
+  }
+
+  for (size_t i = 1; i < count; i++) {
+    const struct AwFmBlockwiseEntry entry = entries[i];
+    size_t j = i;
+    while (j > 0 &&
+           awFmBlockwiseCompare(state, order, &entry, &entries[j - 1]) < 0) {
+      entries[j] = entries[j - 1];
+      j--;
+    }
+    entries[j] = entry;
+  }
+}
+
+static void
+awFmBlockwiseSortAll(const struct AwFmBlockwiseState *_RESTRICT_ state,
+                     struct AwFmBlockwiseEntry *entries, const size_t count,
+                     const enum AwFmBlockwiseOrder order) {
+  const uint32_t depthLimit = 2 * (64 - __builtin_clzll(count | 1));
+  if (count < AW_FM_BLOCKWISE_PARALLEL_SORT_MIN || state->numThreads == 1) {
+    awFmBlockwiseSort(state, entries, count, order, depthLimit, false);
+    return;
+  }
+#pragma omp parallel num_threads(state->numThreads)
+#pragma omp single
+  awFmBlockwiseSort(state, entries, count, order, depthLimit, true);
+}
+
+static bool awFmBlockwiseAppendGroup(struct AwFmBlockwiseGroupList *list,
+                                     const size_t start, const size_t length) {
+  if (__builtin_expect(list->count == list->capacity, 0)) {
+    const size_t newCapacity = list->capacity == 0
+                                   ? AW_FM_BLOCKWISE_INITIAL_GROUP_CAPACITY
+                                   : list->capacity * 2;
+    void *newGroups =
+        realloc(list->groups, newCapacity * sizeof(struct AwFmBlockwiseGroup));
+    if (newGroups == NULL) {
+      return false;
+    }
+    list->groups = newGroups;
+    list->capacity = newCapacity;
+  }
+  list->groups[list->count].start = start;
+  list->groups[list->count].length = length;
+  list->count++;
+  return true;
+}
+
+// sorts the suffixes at the sampled positions, and records each one's rank in
+// sampleRanks. They're sorted by their first period characters, then groups
+// that still tie are refined by the rank of the sampled suffix h positions
+// later, doubling h each round. Every sampled suffix plus a multiple of the
+// period is also sampled, so the ranks at those offsets always exist.
+static enum AwFmReturnCode
+awFmBlockwiseRankSample(struct AwFmBlockwiseState *_RESTRICT_ state) {
+  const uint64_t length = state->length;
+  const uint64_t numPeriods = 1 + ((length - 1) >> state->periodLog2);
+  const size_t ranksBytes = numPeriods * state->coverSize * sizeof(uint64_t);
+  state->sampleRanks = awFmBlockwiseAlloc(state, ranksBytes);
+  if (state->sampleRanks == NULL) {
+    return AwFmAllocationFailure;
+  }
+
+  // the cover residues ascend, so the sampled positions before the end of
+  // the text are exactly the first sampleCount slots.
+  size_t sampleCount = (numPeriods - 1) * state->coverSize;
+  for (uint64_t position = (numPeriods - 1) << state->periodLog2;
+       position < length; position++) {
+    sampleCount += state->residueInCover[position & (state->period - 1)];
+  }
+  const size_t entriesBytes = sampleCount * sizeof(struct AwFmBlockwiseEntry);
+  struct AwFmBlockwiseEntry *entries = awFmBlockwiseAlloc(state, entriesBytes);
+  struct AwFmBlockwiseGroupList *nextGroups =
+      calloc(state->numThreads, sizeof(struct AwFmBlockwiseGroupList));
+  struct AwFmBlockwiseGroupList groups = {0};
+  if (entries == NULL || nextGroups == NULL) {
+    awFmBlockwiseFree(state, entries, entries == NULL ? 0 : entriesBytes);
+    free(nextGroups);
+    return AwFmAllocationFailure;
+  }
+
+#pragma omp parallel for schedule(static) num_threads(state->numThreads)
+  for (uint64_t periodIndex = 0; periodIndex < numPeriods; periodIndex++) {
+    const uint64_t periodStart = periodIndex << state->periodLog2;
+    for (uint32_t residue = 0; residue < state->period; residue++) {
+      const uint64_t position = periodStart + residue;
+      if (state->residueInCover[residue] && position < length) {
+        struct AwFmBlockwiseEntry *entry =
+            &entries[awFmBlockwiseSampleIndex(state, position)];
+        entry->position = position;
+        entry->key = awFmBlockwisePrefixKey(state, position);
+      }
+    }
+  }
+  awFmBlockwiseSortAll(state, entries, sampleCount,
+                       AwFmBlockwiseOrderSamplePrefix);
+
+  // each suffix's rank is the start of its run of equal prefixes. The run
+  // starts are marked in sampleRanks, since the keys are still needed for
+  // the comparisons, then carried forward through the keys.
+#pragma omp parallel for schedule(static) num_threads(state->numThreads)
+  for (size_t i = 0; i < sampleCount; i++) {
+    const bool startsGroup =
+        i == 0 || awFmBlockwiseCompare(state, AwFmBlockwiseOrderSamplePrefix,
+                                       &entries[i - 1], &entries[i]) != 0;
+    state->sampleRanks[awFmBlockwiseSampleIndex(state, entries[i].position)] =
+        startsGroup ? i : AW_FM_BLOCKWISE_NONE;
+  }
+  bool allocationFailed = false;
+  size_t groupStart = 0;
+  for (size_t i = 0; i < sampleCount; i++) {
+    const uint64_t mark = state->sampleRanks[awFmBlockwiseSampleIndex(
+        state, entries[i].position)];
+    if (mark != AW_FM_BLOCKWISE_NONE) {
+      if (i - groupStart > 1) {
+        allocationFailed |=
+            !awFmBlockwiseAppendGroup(&groups, groupStart, i - groupStart);
+      }
+      groupStart = i;
+    }
+    entries[i].key = groupStart;
+  }
+  if (sampleCount - groupStart > 1) {
+    allocationFailed |= !awFmBlockwiseAppendGroup(&groups, groupStart,
+                                                  sampleCount - groupStart);
+  }
+#pragma omp parallel for schedule(static) num_threads(state->numThreads)
+  for (size_t i = 0; i < sampleCount; i++) {
+    state->sampleRanks[awFmBlockwiseSampleIndex(state, entries[i].position)] =
+        entries[i].key;
+  }
+
+  for (uint64_t offset = state->period; groups.count > 0 && !allocationFailed;
+       offset *= 2) {
+    // each group is sorted by the rank of the suffix offset positions later,
+    // then its entries' keys are replaced by their new group's start.
+#pragma omp parallel for schedule(dynamic, 16) num_threads(state->numThreads)
+    for (size_t groupIndex = 0; groupIndex < groups.count; groupIndex++) {
+      const struct AwFmBlockwiseGroup group = groups.groups[groupIndex];
+      struct AwFmBlockwiseEntry *groupEntries = &entries[group.start];
+      for (size_t i = 0; i < group.length; i++) {
+        const uint64_t keyPosition = groupEntries[i].position + offset;
+        // a suffix that ends before the offset is shorter, so it sorts first.
+        groupEntries[i].key =
+            keyPosition < length
+                ? state->sampleRanks[awFmBlockwiseSampleIndex(state,
+                                                              keyPosition)] +
+                      1
+                : 0;
+      }
+      awFmBlockwiseSort(state, groupEntries, group.length,
+                        AwFmBlockwiseOrderKey,
+                        2 * (64 - __builtin_clzll(group.length)), false);
+
+      struct AwFmBlockwiseGroupList *list = &nextGroups[omp_get_thread_num()];
+      size_t newGroupStart = 0;
+      uint64_t newGroupKey = groupEntries[0].key;
+      for (size_t i = 0; i < group.length; i++) {
+        if (groupEntries[i].key != newGroupKey) {
+          if (i - newGroupStart > 1 &&
+              !awFmBlockwiseAppendGroup(list, group.start + newGroupStart,
+                                        i - newGroupStart)) {
+#pragma omp atomic write
+            allocationFailed = true;
+          }
+          newGroupStart = i;
+          newGroupKey = groupEntries[i].key;
+        }
+        groupEntries[i].key = group.start + newGroupStart;
+      }
+      if (group.length - newGroupStart > 1 &&
+          !awFmBlockwiseAppendGroup(list, group.start + newGroupStart,
+                                    group.length - newGroupStart)) {
+#pragma omp atomic write
+        allocationFailed = true;
+      }
+    }
+
+    // ranks can only change once every group has been sorted, since the sort
+    // reads the ranks of suffixes in other groups.
+#pragma omp parallel for schedule(dynamic, 16) num_threads(state->numThreads)
+    for (size_t groupIndex = 0; groupIndex < groups.count; groupIndex++) {
+      const struct AwFmBlockwiseGroup group = groups.groups[groupIndex];
+      for (size_t i = group.start; i < group.start + group.length; i++) {
+        state->sampleRanks[awFmBlockwiseSampleIndex(
+            state, entries[i].position)] = entries[i].key;
+      }
+    }
+
+    groups.count = 0;
+    for (uint32_t thread = 0; thread < state->numThreads; thread++) {
+      for (size_t i = 0; i < nextGroups[thread].count && !allocationFailed;
+           i++) {
+        allocationFailed |= !awFmBlockwiseAppendGroup(
+            &groups, nextGroups[thread].groups[i].start,
+            nextGroups[thread].groups[i].length);
+      }
+      nextGroups[thread].count = 0;
+    }
+  }
+
+  for (uint32_t thread = 0; thread < state->numThreads; thread++) {
+    free(nextGroups[thread].groups);
+  }
+  free(nextGroups);
+  free(groups.groups);
+  awFmBlockwiseFree(state, entries, entriesBytes);
+  return allocationFailed ? AwFmAllocationFailure : AwFmSuccess;
+}
+
+static inline bool
+awFmBlockwiseInRange(const struct AwFmBlockwiseState *_RESTRICT_ state,
+                     const struct AwFmBlockwiseRange *range,
+                     const uint64_t suffix) {
+  if (range->lower != AW_FM_BLOCKWISE_NONE &&
+      (suffix == range->lower ||
+       awFmBlockwiseCompareSuffixes(state, range->lower, suffix) > 0)) {
+    return false;
+  }
+  if (range->upper != AW_FM_BLOCKWISE_NONE && suffix != range->upper &&
+      awFmBlockwiseCompareSuffixes(state, suffix, range->upper) > 0) {
+    return false;
+  }
+  return true;
+}
+
+// index of the first splitter at or after the suffix, or numSplitters if the
+// suffix is after all of them.
+static inline size_t
+awFmBlockwiseFindBucket(const struct AwFmBlockwiseState *_RESTRICT_ state,
+                        const uint64_t *_RESTRICT_ splitters,
+                        const size_t numSplitters, const uint64_t suffix) {
+  size_t low = 0;
+  size_t high = numSplitters;
+  while (low < high) {
+    const size_t middle = (low + high) / 2;
+    if (suffix == splitters[middle] ||
+        awFmBlockwiseCompareSuffixes(state, suffix, splitters[middle]) < 0) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+  return low;
+}
+
+static inline uint64_t awFmBlockwiseHash(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xFF51AFD7ED558CCDULL;
+  value ^= value >> 33;
+  value *= 0xC4CEB9FE1A85EC53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+// scans the text for the suffixes in the range, and copies them into the
+// entries. If sampleSeed isn't NONE, only a pseudorandom 1 in sampleRate of
+// them are taken. Stops adding entries once capacity is reached.
+static size_t
+awFmBlockwiseCollect(const struct AwFmBlockwiseState *_RESTRICT_ state,
+                     const struct AwFmBlockwiseRange *range,
+                     struct AwFmBlockwiseEntry *_RESTRICT_ entries,
+                     const size_t capacity, const uint64_t sampleSeed,
+                     const uint64_t sampleRate) {
+  size_t collected = 0;
+#pragma omp parallel num_threads(state->numThreads)
+  {
+    struct AwFmBlockwiseEntry stash[AW_FM_BLOCKWISE_COLLECT_STASH_SIZE];
+    size_t stashCount = 0;
+#pragma omp for schedule(static) nowait
+    for (uint64_t suffix = 0; suffix < state->length; suffix++) {
+      if (sampleSeed != AW_FM_BLOCKWISE_NONE &&
+          awFmBlockwiseHash(suffix ^ sampleSeed) % sampleRate != 0) {
+        continue;
+      }
+      if (awFmBlockwiseInRange(state, range, suffix)) {
+        stash[stashCount].position = suffix;
+        stash[stashCount].key = awFmBlockwisePrefixKey(state, suffix);
+        stashCount++;
+      }
+      if (stashCount == AW_FM_BLOCKWISE_COLLECT_STASH_SIZE) {
+        size_t offset;
+#pragma omp atomic capture
+        {
+          offset = collected;
+          collected += stashCount;
+        }
+        if (offset < capacity) {
+          const size_t numToCopy =
+              offset + stashCount > capacity ? capacity - offset : stashCount;
+          memcpy(entries + offset, stash,
+                 numToCopy * sizeof(struct AwFmBlockwiseEntry));
+        }
+        stashCount = 0;
+      }
+    }
+    if (stashCount > 0) {
+      size_t offset;
+#pragma omp atomic capture
+      {
+        offset = collected;
+        collected += stashCount;
+      }
+      if (offset < capacity) {
+        const size_t numToCopy =
+            offset + stashCount > capacity ? capacity - offset : stashCount;
+        memcpy(entries + offset, stash,
+               numToCopy * sizeof(struct AwFmBlockwiseEntry));
+      }
+    }
+  }
+  return collected < capacity ? collected : capacity;
+}
+
+static enum AwFmReturnCode
+awFmBlockwiseEmitPartition(struct AwFmBlockwiseState *_RESTRICT_ state,
+                           const struct AwFmBlockwiseRange *range) {
+  const size_t count =
+      awFmBlockwiseCollect(state, range, state->partition,
+                           state->partitionCapacity, AW_FM_BLOCKWISE_NONE, 1);
+  awFmBlockwiseSortAll(state, state->partition, count,
+                       AwFmBlockwiseOrderSuffix);
+
+  // compact the positions to the front of the buffer. Each position moves
+  // to an earlier or equal address, so this is safe in place.
+  uint64_t *suffixes = (uint64_t *)state->partition;
+  for (size_t i = 0; i < count; i++) {
+    suffixes[i] = state->partition[i].position;
+  }
+  state->numPartitions++;
+  return state->consumer(suffixes, count, state->context);
+}
+
+// emits every suffix in the range, in order, splitting it into partitions that
+// fit the partition buffer.
+static enum AwFmReturnCode
+awFmBlockwiseSortRange(struct AwFmBlockwiseState *_RESTRICT_ state,
+                       const struct AwFmBlockwiseRange *range,
+                       const size_t count, const uint32_t depth) {
+  if (count == 0) {
+    return AwFmSuccess;
+  }
+  if (count <= state->partitionCapacity) {
+    return awFmBlockwiseEmitPartition(state, range);
+  }
+
+  // pick splitters from a random sample of the range, aiming for buckets of
+  // about half the partition capacity. The partition buffer isn't in use
+  // until the buckets are emitted, so the sample is taken into it.
+  const size_t numBuckets = 1 + (2 * count) / state->partitionCapacity;
+  const size_t sampleTarget =
+      numBuckets * AW_FM_BLOCKWISE_SPLITTER_OVERSAMPLING;
+  const size_t sampleCapacity = 2 * sampleTarget < state->partitionCapacity
+                                    ? 2 * sampleTarget
+                                    : state->partitionCapacity;
+  struct AwFmBlockwiseEntry *sample = state->partition;
+  const size_t splittersBytes = numBuckets * sizeof(uint64_t);
+  const size_t bucketCountsBytes =
+      (size_t)state->numThreads * numBuckets * sizeof(size_t);
+  uint64_t *splitters = awFmBlockwiseAlloc(state, splittersBytes);
+  size_t *bucketCounts = awFmBlockwiseAlloc(state, bucketCountsBytes);
+  if (splitters == NULL || bucketCounts == NULL) {
+    awFmBlockwiseFree(state, splitters, splitters == NULL ? 0 : splittersBytes);
+    awFmBlockwiseFree(state, bucketCounts,
+                      bucketCounts == NULL ? 0 : bucketCountsBytes);
+    return AwFmAllocationFailure;
+  }
+
+  const uint64_t sampleSeed =
+      awFmBlockwiseHash(((uint64_t)depth << 48) ^ range->lower ^ count);
+  const uint64_t sampleRate =
+      count / (sampleCapacity / 2) > 1 ? count / (sampleCapacity / 2) : 1;
+  const size_t sampleCount = awFmBlockwiseCollect(
+      state, range, sample, sampleCapacity, sampleSeed, sampleRate);
+  awFmBlockwiseSortAll(state, sample, sampleCount, AwFmBlockwiseOrderSuffix);
+
+  // the range's upper bound is never a splitter, so every bucket but the last
+  // is a strict subset of the range, and each split makes progress.
+  size_t numSplitters = 0;
+  for (size_t bucket = 1; bucket < numBuckets; bucket++) {
+    const size_t sampleIndex = (bucket * sampleCount) / numBuckets;
+    if (sampleIndex >= sampleCount) {
+      break;
+    }
+    const uint64_t splitter = sample[sampleIndex].position;
+    if (splitter != range->upper &&
+        (numSplitters == 0 || splitters[numSplitters - 1] != splitter)) {
+      splitters[numSplitters++] = splitter;
+    }
+  }
+
+  memset(bucketCounts, 0, bucketCountsBytes);
+#pragma omp parallel num_threads(state->numThreads)
+  {
+    size_t *threadCounts = bucketCounts + (omp_get_thread_num() * numBuckets);
+#pragma omp for schedule(static)
+    for (uint64_t suffix = 0; suffix < state->length; suffix++) {
+      if (awFmBlockwiseInRange(state, range, suffix)) {
+        threadCounts[awFmBlockwiseFindBucket(state, splitters, numSplitters,
+                                             suffix)]++;
+      }
+    }
+  }
+  for (uint32_t thread = 1; thread < state->numThreads; thread++) {
+    for (size_t bucket = 0; bucket <= numSplitters; bucket++) {
+      bucketCounts[bucket] += bucketCounts[thread * numBuckets + bucket];
+    }
+  }
+
+  // emit runs of consecutive buckets that fit in a partition together, and
+  // split any bucket that's too large on its own.
+  enum AwFmReturnCode returnCode = AwFmSuccess;
+  size_t bucket = 0;
+  while (bucket <= numSplitters && returnCode == AwFmSuccess) {
+    size_t lastBucket = bucket;
+    size_t bucketsCount = bucketCounts[bucket];
+    while (bucketsCount <= state->partitionCapacity &&
+           lastBucket < numSplitters &&
+           bucketsCount + bucketCounts[lastBucket + 1] <=
+               state->partitionCapacity) {
+      lastBucket++;
+      bucketsCount += bucketCounts[lastBucket];
+    }
+    const struct AwFmBlockwiseRange subrange = {
+        .lower = bucket == 0 ? range->lower : splitters[bucket - 1],
+        .upper = lastBucket == numSplitters ? range->upper
+                                            : splitters[lastBucket]};
+    returnCode =
+        awFmBlockwiseSortRange(state, &subrange, bucketsCount, depth + 1);
+    bucket = lastBucket + 1;
+  }
+
+  awFmBlockwiseFree(state, splitters, splittersBytes);
+  awFmBlockwiseFree(state, bucketCounts, bucketCountsBytes);
+  return returnCode;
+}
+
+enum AwFmReturnCode
+awFmBlockwiseSuffixSort(const uint8_t *_RESTRICT_ const text,
+                        const uint64_t length, const size_t memoryBudget,
+                        AwFmSortedSuffixConsumer consumer, void *context,
+                        struct AwFmBlockwiseSortStatistics *statistics) {
+  if (length == 0) {
+    return AwFmSuccess;
+  }
+
+  struct AwFmBlockwiseState *state = malloc(sizeof(struct AwFmBlockwiseState));
+  if (state == NULL) {
+    return AwFmAllocationFailure;
+  }
+  state->text = text;
+  state->length = length;
+  state->consumer = consumer;
+  state->context = context;
+  state->numThreads = omp_get_max_threads();
+  state->currentBytes = 0;
+  state->peakBytes = 0;
+  state->numPartitions = 0;
+  state->sampleRanks = NULL;
+  state->partition = NULL;
+
+  // use the densest sample whose ranking (16 bytes per sampled suffix while
+  // sorting, plus the 8 byte ranks) fits in half the budget, leaving the
+  // rest for partitions.
+  uint8_t periodLog2 = AW_FM_BLOCKWISE_MIN_PERIOD_LOG2;
+  size_t sampleRanksBytes = 0;
+  for (; periodLog2 <= AW_FM_BLOCKWISE_MAX_PERIOD_LOG2; periodLog2 += 2) {
+    const uint64_t numPeriods = 1 + ((length - 1) >> periodLog2);
+    const uint64_t coverSize = (2 << (periodLog2 / 2)) - 1;
+    sampleRanksBytes = numPeriods * coverSize * sizeof(uint64_t);
+    if (3 * sampleRanksBytes <= memoryBudget / 2) {
+      break;
+    }
+  }
+  size_t partitionCapacity = 0;
+  if (periodLog2 <= AW_FM_BLOCKWISE_MAX_PERIOD_LOG2) {
+    // an eighth of what's left is kept for the splitters and bucket counts.
+    partitionCapacity = ((memoryBudget - sampleRanksBytes) / 8 * 7) /
+                        sizeof(struct AwFmBlockwiseEntry);
+    if (partitionCapacity > length) {
+      partitionCapacity = length;
+    }
+  }
+  if (periodLog2 > AW_FM_BLOCKWISE_MAX_PERIOD_LOG2 ||
+      (partitionCapacity < AW_FM_BLOCKWISE_MIN_PARTITION_CAPACITY &&
+       partitionCapacity < length)) {
+    free(state);
+    return AwFmInsufficientMemoryBudget;
+  }
+  state->partitionCapacity = partitionCapacity;
+  awFmBlockwiseInitCover(state, periodLog2);
+
+  enum AwFmReturnCode returnCode = awFmBlockwiseRankSample(state);
+  const size_t partitionBytes =
+      partitionCapacity * sizeof(struct AwFmBlockwiseEntry);
+  if (returnCode == AwFmSuccess) {
+    state->partition = awFmBlockwiseAlloc(state, partitionBytes);
+    if (state->partition == NULL) {
+      returnCode = AwFmAllocationFailure;
+    }
+  }
+  if (returnCode == AwFmSuccess) {
+    const struct AwFmBlockwiseRange fullRange = {
+        .lower = AW_FM_BLOCKWISE_NONE, .upper = AW_FM_BLOCKWISE_NONE};
+    returnCode = awFmBlockwiseSortRange(state, &fullRange, length, 0);
+  }
+
+  if (statistics != NULL) {
+    statistics->peakBytes = state->peakBytes;
+    statistics->differenceCoverPeriod = state->period;
+    statistics->numPartitions = state->numPartitions;
+  }
+  free(state->partition);
+  free(state->sampleRanks);
+  free(state);
+  return returnCode;
+}
@@ -0,0 +1,60 @@
+#ifndef AW_FM_BLOCKWISE_SUFFIX_SORT_H
+#define AW_FM_BLOCKWISE_SUFFIX_SORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "AwFmIndex.h"
+
+/*Receives each partition of the suffix array from awFmBlockwiseSuffixSort, in
+ * suffix array order. Returning anything other than AwFmSuccess stops the sort,
+ * and that code is returned from awFmBlockwiseSuffixSort.*/
+typedef enum AwFmReturnCode (*AwFmSortedSuffixConsumer)(
+    const uint64_t *_RESTRICT_ const suffixes, const size_t count,
+    void *_RESTRICT_ const context);
+
+struct AwFmBlockwiseSortStatistics {
+  // largest amount of working memory held at once, in bytes.
+  size_t peakBytes;
+  // period of the difference cover sample used to compare suffixes.
+  uint32_t differenceCoverPeriod;
+  // number of partitions passed to the consumer.
+  uint32_t numPartitions;
+};
+
+/*
+ * Function:  awFmBlockwiseSuffixSort
+ * --------------------
+ * Sorts the suffixes of the text without materializing the full suffix array.
+ * First, a difference cover sample of the suffixes is ranked, which bounds the
+ * cost of comparing any two suffixes by the sample's period. Then the suffix
+ * array is produced in partitions bounded by splitter suffixes: each partition
+ * is collected in one scan over the text, sorted, and handed to the consumer
+ * before the next one is started.
+ *
+ * The sample period and the partition size are chosen so that the working
+ * memory stays within the budget. Smaller budgets use sparser samples and
+ * more partitions, and so more scans over the text.
+ *
+ *  Inputs:
+ *    text:         Text to sort. The last character must be unique and sort
+ *      before every other character, like the '$' sentinel.
+ *    length:       Length of the text, including the final character.
+ *    memoryBudget: Maximum working memory to use, in bytes, not including the
+ *      text itself.
+ *    consumer:     Called with each partition of the suffix array, in order.
+ *    context:      Passed to the consumer.
+ *    statistics:   If not NULL, filled with details about the sort.
+ *
+ *  Returns:
+ *    AwFmSuccess on success.
+ *    AwFmInsufficientMemoryBudget if the budget can't hold the sample.
+ *    AwFmAllocationFailure if working memory could not be allocated.
+ *    Any other code returned by the consumer.
+ */
+enum AwFmReturnCode
+awFmBlockwiseSuffixSort(const uint8_t *_RESTRICT_ const text,
+                        const uint64_t length, const size_t memoryBudget,
+                        AwFmSortedSuffixConsumer consumer, void *context,
+                        struct AwFmBlockwiseSortStatistics *statistics);
+
+#endif /* end of include guard: AW_FM_BLOCKWISE_SUFFIX_SORT_H */
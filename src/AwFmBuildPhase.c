@@ -0,0 +1,96 @@
+// clock_gettime needs _POSIX_C_SOURCE in strict c11 mode.
+#define _POSIX_C_SOURCE 200809L
+
+#include "AwFmBuildPhase.h"
+#include <omp.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <time.h>
+
+static const char *const awFmBuildPhaseNames[AW_FM_NUM_BUILD_PHASES] = {
+    "read sequence",       "sanitize",        "suffix sort", "bwt",
+    "suffix array sample", "kmer seed table", "file write"};
+
+static double processCpuSeconds(void) {
+  struct timespec time;
+  if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time) != 0) {
+    return 0;
+  }
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// samples the process's current (VmRSS) and peak (VmHWM) resident sizes.
+// where /proc isn't available, both are the peak since the process started.
+static void sampleResidentBytes(size_t *_RESTRICT_ const currentBytes,
+                                size_t *_RESTRICT_ const peakBytes) {
+#ifdef __linux__
+  FILE *statusFile = fopen("/proc/self/status", "r");
+  if (statusFile != NULL) {
+    char line[256];
+    size_t currentKilobytes = 0;
+    size_t peakKilobytes = 0;
+    bool foundCurrent = false;
+    bool foundPeak = false;
+    while ((!foundCurrent || !foundPeak) &&
+           fgets(line, sizeof(line), statusFile) != NULL) {
+      foundCurrent |= sscanf(line, "VmRSS: %zu kB", &currentKilobytes) == 1;
+      foundPeak |= sscanf(line, "VmHWM: %zu kB", &peakKilobytes) == 1;
+    }
+    fclose(statusFile);
+    if (foundCurrent && foundPeak) {
+      *currentBytes = currentKilobytes * 1024;
+      *peakBytes = peakKilobytes * 1024;
+      return;
+    }
+  }
+#endif
+  // ru_maxrss is in kilobytes on Linux.
+  struct rusage usage;
+  const size_t maxResidentBytes =
+      getrusage(RUSAGE_SELF, &usage) == 0 ? (size_t)usage.ru_maxrss * 1024 : 0;
+  *currentBytes = maxResidentBytes;
+  *peakBytes = maxResidentBytes;
+}
+
+void awFmBuildPhaseBegin(
+    struct AwFmBuildPhaseTimer *_RESTRICT_ const timer,
+    struct AwFmBuildStatistics *_RESTRICT_ const statistics,
+    const enum AwFmBuildPhase phase) {
+  if (statistics == NULL) {
+    timer->phase = NULL;
+    return;
+  }
+  timer->phase = &statistics->phases[phase];
+  sampleResidentBytes(&timer->startResidentBytes, &timer->startPeakBytes);
+  timer->wallStartTime = omp_get_wtime();
+  timer->cpuStartTime = processCpuSeconds();
+}
+
+void awFmBuildPhaseEnd(
+    const struct AwFmBuildPhaseTimer *_RESTRICT_ const timer) {
+  if (timer->phase == NULL) {
+    return;
+  }
+  timer->phase->wallSeconds += omp_get_wtime() - timer->wallStartTime;
+  timer->phase->cpuSeconds += processCpuSeconds() - timer->cpuStartTime;
+  size_t residentBytes, peakBytes;
+  sampleResidentBytes(&residentBytes, &peakBytes);
+  // if the process's peak didn't rise during the phase, the phase's own peak
+  // is somewhere below it, and the larger of its start and end sizes is the
+  // closest bound the samples give.
+  if (peakBytes <= timer->startPeakBytes) {
+    peakBytes = residentBytes > timer->startResidentBytes
+                    ? residentBytes
+                    : timer->startResidentBytes;
+  }
+  if (peakBytes > timer->phase->peakResidentBytes) {
+    timer->phase->peakResidentBytes = peakBytes;
+  }
+}
+
+const char *awFmGetBuildPhaseName(const enum AwFmBuildPhase phase) {
+  if ((unsigned)phase >= AW_FM_NUM_BUILD_PHASES) {
+    return "unknown";
+  }
+  return awFmBuildPhaseNames[phase];
+}
@@ -0,0 +1,50 @@
+#ifndef AW_FM_BUILD_PHASE_H
+#define AW_FM_BUILD_PHASE_H
+
+#include "AwFmIndex.h"
+
+// running measurement of one build phase, started by awFmBuildPhaseBegin.
+struct AwFmBuildPhaseTimer {
+  // NULL if the build isn't collecting statistics.
+  struct AwFmBuildPhaseStatistics *phase;
+  double wallStartTime;
+  double cpuStartTime;
+  // process resident sizes sampled when the phase began.
+  size_t startResidentBytes;
+  size_t startPeakBytes;
+};
+
+/*
+ * Function:  awFmBuildPhaseBegin
+ * --------------------
+ * Starts measuring a phase of an index build, sampling the process's current
+ * and peak resident set sizes. The process's peak is never reset, since that
+ * would clear the referenced bits other tools rely on. Does nothing if
+ * statistics is NULL, so builds that don't ask for statistics don't pay for
+ * them.
+ *
+ *  Inputs:
+ *    timer:      Timer to start.
+ *    statistics: Statistics of the build, or NULL.
+ *    phase:      Phase being measured.
+ */
+void awFmBuildPhaseBegin(
+    struct AwFmBuildPhaseTimer *_RESTRICT_ const timer,
+    struct AwFmBuildStatistics *_RESTRICT_ const statistics,
+    const enum AwFmBuildPhase phase);
+
+/*
+ * Function:  awFmBuildPhaseEnd
+ * --------------------
+ * Finishes measuring the timer's phase, adding its wall and CPU time to the
+ * phase's statistics. If the process's peak resident size rose during the
+ * phase, the new peak is the phase's peak. Otherwise the phase's peak is the
+ * larger of its starting and ending resident sizes.
+ *
+ *  Inputs:
+ *    timer: Timer started by awFmBuildPhaseBegin.
+ */
+void awFmBuildPhaseEnd(
+    const struct AwFmBuildPhaseTimer *_RESTRICT_ const timer);
+
+#endif /* end of include guard: AW_FM_BUILD_PHASE_H */
@@ -1,18 +1,34 @@
 #include <stdlib.h>
 #include <string.h>
+#include "AwFmBlockwiseSuffixSort.h"
+#include "AwFmBuildPhase.h"
+#include "AwFmCreate.h"
+#include "AwFmFastaReader.h"
 #include "AwFmFile.h"
 #include "AwFmIndex.h"
 #include "AwFmIndexStruct.h"
 #include "AwFmLetter.h"
 #include "AwFmSuffixArray.h"
+#include "AwFmSuffixSort.h"
 #include "FastaVector.h"
+#include "divsufsort.h"
 #include "divsufsort64.h"
 
+// the BWT is built in parallel, in chunks of this many blocks.
+#define AW_FM_BWT_CONSTRUCTION_CHUNK_BLOCKS 4096
+// how far ahead in the suffix array to prefetch the sequence letters.
+#define AW_FM_BWT_CONSTRUCTION_PREFETCH_DISTANCE 16
+// the kmer seed table is filled in parallel, split into at least this many
+// independent subtrees of kmers.
+#define AW_FM_SEED_TABLE_MIN_PARALLEL_SUBTREES 256
+
 /*private function prototypes*/
-void setBwtAndPrefixSums(struct AwFmIndex *_RESTRICT_ const index,
-                         const size_t sequenceLength,
-                         const uint8_t *_RESTRICT_ const sequence,
-                         const uint64_t *_RESTRICT_ const unsampledSuffixArray);
+enum AwFmReturnCode
+setBwtAndPrefixSums(struct AwFmIndex *_RESTRICT_ const index,
+                    const size_t sequenceLength,
+                    const uint8_t *_RESTRICT_ const sequence,
+                    const void *_RESTRICT_ const unsampledSuffixArray,
+                    const uint8_t valueByteWidth);
 
 void populateKmerSeedTableRecursive(struct AwFmIndex *_RESTRICT_ const index,
                                     struct AwFmSearchRange range,
@@ -20,12 +36,63 @@ void populateKmerSeedTableRecursive(struct AwFmIndex *_RESTRICT_ const index,
                                     uint64_t currentKmerIndex,
                                     uint64_t letterIndexMultiplier);
 
-void populateKmerSeedTable(struct AwFmIndex *_RESTRICT_ const index);
-
-void fullSequenceSanitize(const uint8_t *const sequence,
-                          uint8_t *const sanitizedSequenceCopy,
-                          const size_t sequenceLength,
-                          const enum AwFmAlphabetType alphabetType);
+static uint8_t suffixArrayValueByteWidth(const size_t suffixArrayLength);
+
+static bool buildSuffixArray(const uint8_t *_RESTRICT_ const sequence,
+                             void *_RESTRICT_ const suffixArray,
+                             const size_t suffixArrayLength,
+                             const uint8_t valueByteWidth);
+
+static enum AwFmReturnCode buildBwtAndSuffixArray(
+    struct AwFmIndex *_RESTRICT_ const index,
+    const uint8_t *_RESTRICT_ const sanitizedSequence,
+    struct AwFmFileWriter *_RESTRICT_ const writer,
+    struct AwFmBuildStatistics *_RESTRICT_ const statistics);
+
+static enum AwFmReturnCode
+openIndexFile(struct AwFmIndex *_RESTRICT_ const index,
+              const char *_RESTRICT_ const fileSrc,
+              struct AwFmFileWriter *_RESTRICT_ *writer);
+
+static enum AwFmReturnCode
+finishIndexFile(struct AwFmIndex *_RESTRICT_ const index,
+                struct AwFmFileWriter *_RESTRICT_ const writer,
+                double *_RESTRICT_ const fileWriteSeconds,
+                double *_RESTRICT_ const fileWriteWaitSeconds);
+
+static enum AwFmReturnCode createIndexInLowMemory(
+    struct AwFmIndex *_RESTRICT_ *index,
+    struct AwFmIndexConfiguration *_RESTRICT_ const config,
+    const struct AwFmIndexBuildOptions *_RESTRICT_ const options,
+    const uint8_t *const sequence, uint8_t *text, const size_t sequenceLength,
+    struct FastaVector *_RESTRICT_ const fastaVector,
+    const char *_RESTRICT_ const fileSrc);
+
+static size_t
+indexConstructionBytes(const struct AwFmIndex *_RESTRICT_ const index);
+
+static enum AwFmReturnCode checkReducedAminoLetterMap(
+    const struct AwFmIndexConfiguration *_RESTRICT_ const config,
+    const struct AwFmIndexBuildOptions *_RESTRICT_ const options);
+
+static void reduceSanitizedSequence(
+    const struct AwFmIndex *_RESTRICT_ const index, uint8_t *const sequence,
+    const size_t sequenceLength,
+    struct AwFmBuildStatistics *_RESTRICT_ const statistics);
+
+// state of a low-memory build, shared with the sorted suffix consumer.
+struct AwFmLowMemoryBuild {
+  struct AwFmIndex *index;
+  const uint8_t *sequence;
+  struct AwFmSuffixArrayWriter *writer;
+  // suffix array position of the next suffix to be consumed.
+  uint64_t suffixArrayPosition;
+  size_t nextBlockIndex;
+  // suffixes that don't yet fill the next BWT block.
+  uint64_t pendingSuffixes[AW_FM_POSITIONS_PER_FM_BLOCK];
+  size_t numPendingSuffixes;
+  uint64_t occurrences[AW_FM_BWT_MAX_OCCURRENCE_COUNTS];
+};
 
 /*function implementations*/
 enum AwFmReturnCode
@@ -34,6 +101,16 @@ awFmCreateIndex(struct AwFmIndex *_RESTRICT_ *index,
                 const uint8_t *_RESTRICT_ const sequence,
                 const size_t sequenceLength,
                 const char *_RESTRICT_ const fileSrc) {
+  return awFmCreateIndexWithOptions(index, config, sequence, sequenceLength,
+                                    fileSrc, NULL);
+}
+
+enum AwFmReturnCode awFmCreateIndexWithOptions(
+    struct AwFmIndex *_RESTRICT_ *index,
+    struct AwFmIndexConfiguration *_RESTRICT_ const config,
+    const uint8_t *_RESTRICT_ const sequence, const size_t sequenceLength,
+    const char *_RESTRICT_ const fileSrc,
+    const struct AwFmIndexBuildOptions *_RESTRICT_ const options) {
 
   // first, do a sanity check on inputs
   if (config == NULL) {
@@ -45,13 +122,33 @@ awFmCreateIndex(struct AwFmIndex *_RESTRICT_ *index,
   if (fileSrc == NULL) {
     return AwFmNullPtrError;
   }
+  const struct AwFmIndexBuildOptions defaultOptions = {0};
+  const struct AwFmIndexBuildOptions *buildOptions =
+      options != NULL ? options : &defaultOptions;
+  enum AwFmReturnCode returnCode =
+      checkReducedAminoLetterMap(config, buildOptions);
+  if (returnCode != AwFmSuccess) {
+    return returnCode;
+  }
 
   // set the index out arg initally to NULL, if this function fully completes
   // this will get overwritten
   *index = NULL;
 
+  struct AwFmBuildStatistics *statistics = buildOptions->buildStatistics;
+  if (statistics != NULL) {
+    *statistics = (struct AwFmBuildStatistics){0};
+  }
+
+  if (buildOptions->constructionMemoryBudget != 0) {
+    return createIndexInLowMemory(index, config, buildOptions, sequence, NULL,
+                                  sequenceLength, NULL, fileSrc);
+  }
+
   const size_t suffixArrayLength = sequenceLength + 1;
   // create a sanitized copy of the input sequence
+  struct AwFmBuildPhaseTimer phaseTimer;
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseSanitize);
   uint8_t *sanitizedSequenceCopy = malloc(suffixArrayLength);
   if (sanitizedSequenceCopy == NULL) {
     return AwFmAllocationFailure;
@@ -59,23 +156,25 @@ awFmCreateIndex(struct AwFmIndex *_RESTRICT_ *index,
 
   // sanitize the sequence, turning ambiguity characters into the singular
   // ambiguity character character (x for nucleotide, z for amino)
-  fullSequenceSanitize(sequence, sanitizedSequenceCopy, sequenceLength,
+  awFmSanitizeSequence(sequence, sanitizedSequenceCopy, sequenceLength,
                        config->alphabetType);
+  awFmBuildPhaseEnd(&phaseTimer);
 
   // append the final sentinel character as a terminator.
   sanitizedSequenceCopy[suffixArrayLength - 1] = '$';
 
   // allocate the index and all internal arrays.
   struct AwFmIndex *_RESTRICT_ indexData =
-      awFmIndexAlloc(config, suffixArrayLength);
+      awFmIndexAlloc(config, buildOptions, suffixArrayLength, true);
   if (indexData == NULL) {
     return AwFmAllocationFailure;
   }
+  reduceSanitizedSequence(indexData, sanitizedSequenceCopy, sequenceLength,
+                          statistics);
   indexData->versionNumber = AW_FM_CURRENT_VERSION_NUMBER;
   indexData->featureFlags = 0;
   indexData->fastaVector = NULL; // set the fastaVector struct to null, since we
                                  // aren't using it for this version.
-  memcpy(&indexData->config, config, sizeof(struct AwFmIndexConfiguration));
 
   // init the in memory suffix array to NULL, to be safe. this will get
   // overwritten on success, if the metadata demands in memory SA. If not, this
@@ -84,52 +183,62 @@ awFmCreateIndex(struct AwFmIndex *_RESTRICT_ *index,
 
   // set the bwtLength
   indexData->bwtLength = suffixArrayLength;
+  indexData->suffixArrayFileOffset = awFmGetSuffixArrayFileOffset(indexData);
+  indexData->sequenceFileOffset = awFmGetSequenceFileOffset(indexData);
 
-  uint64_t *suffixArray = malloc((suffixArrayLength) * sizeof(uint64_t));
-
-  if (suffixArray == NULL) {
-    free(sanitizedSequenceCopy);
-    awFmDeallocIndex(indexData);
-    return AwFmAllocationFailure;
+  // create the file. Each section is written in the background as soon as
+  // it's final, starting with the original sequence.
+  struct AwFmFileWriter *writer = NULL;
+  returnCode = openIndexFile(indexData, fileSrc, &writer);
+  if (returnCode == AwFmSuccess && config->storeOriginalSequence) {
+    returnCode = awFmFileWriterSubmit(writer, sequence, sequenceLength,
+                                      indexData->sequenceFileOffset);
   }
 
-  // create the suffix array, storing it starting in the second element of the
-  // suffix array we allocated. this doesn't clobber the sentinel we added
-  // earlier, and makes for easier bwt creation.
-  int64_t divSufSortReturnCode = divsufsort64(
-      sanitizedSequenceCopy, (int64_t *)(suffixArray), suffixArrayLength);
-  if (divSufSortReturnCode < 0) {
-    free(sanitizedSequenceCopy);
-    free(suffixArray);
-    awFmDeallocIndex(indexData);
-    return AwFmSuffixArrayCreationFailure;
+  // build the suffix array, BWT, and prefix sums. after generating the bwt,
+  // the sequence copy is no longer needed.
+  if (returnCode == AwFmSuccess) {
+    returnCode = buildBwtAndSuffixArray(indexData, sanitizedSequenceCopy,
+                                        writer, statistics);
   }
-
-  // set the bwt and prefix sums
-  setBwtAndPrefixSums(indexData, indexData->bwtLength, sanitizedSequenceCopy,
-                      suffixArray);
-  // after generating the bwt, the sequence copy is no longer needed.
   free(sanitizedSequenceCopy);
+  if (returnCode != AwFmSuccess) {
+    if (writer != NULL) {
+      awFmFileWriterFinish(writer, NULL, NULL);
+    }
+    awFmDeallocIndex(indexData);
+    return returnCode;
+  }
 
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseKmerSeedTable);
   populateKmerSeedTable(indexData);
+  awFmBuildPhaseEnd(&phaseTimer);
 
-  // initialize the compressed suffix array
-  enum AwFmReturnCode returnCode = awFmInitCompressedSuffixArray(
-      suffixArray, suffixArrayLength, &indexData->suffixArray,
-      config->suffixArrayCompressionRatio);
-  indexData->suffixArrayFileOffset = awFmGetSuffixArrayFileOffset(indexData);
-  indexData->sequenceFileOffset = awFmGetSequenceFileOffset(indexData);
-  // file descriptor will be set in awFmWriteIndexToFile
-
-  // create the file
-  returnCode =
-      awFmWriteIndexToFile(indexData, sequence, sequenceLength, fileSrc);
+  double fileWriteSeconds;
+  double fileWriteWaitSeconds;
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseFileWrite);
+  returnCode = finishIndexFile(indexData, writer, &fileWriteSeconds,
+                               &fileWriteWaitSeconds);
+  awFmBuildPhaseEnd(&phaseTimer);
 
   if (!config->keepSuffixArrayInMemory) {
     free(indexData->suffixArray.values);
     indexData->suffixArray.values = NULL;
   }
 
+  if (statistics != NULL) {
+    // the sanitized copy and the full suffix array are held together.
+    statistics->memoryBudget = 0;
+    statistics->peakConstructionBytes =
+        indexConstructionBytes(indexData) +
+        (suffixArrayLength *
+         (1 + suffixArrayValueByteWidth(suffixArrayLength)));
+    statistics->suffixArrayPartitions = 1;
+    statistics->differenceCoverPeriod = 0;
+    statistics->fileWriteSeconds = fileWriteSeconds;
+    statistics->fileWriteWaitSeconds = fileWriteWaitSeconds;
+  }
+
   // set the index as an out argument.
   *index = indexData;
 
@@ -142,6 +251,15 @@ awFmCreateIndexFromFasta(struct AwFmIndex *_RESTRICT_ *index,
                          struct AwFmIndexConfiguration *_RESTRICT_ const config,
                          const char *fastaSrc,
                          const char *_RESTRICT_ const indexFileSrc) {
+  return awFmCreateIndexFromFastaWithOptions(index, config, fastaSrc,
+                                             indexFileSrc, NULL);
+}
+
+enum AwFmReturnCode awFmCreateIndexFromFastaWithOptions(
+    struct AwFmIndex *_RESTRICT_ *index,
+    struct AwFmIndexConfiguration *_RESTRICT_ const config,
+    const char *fastaSrc, const char *_RESTRICT_ const indexFileSrc,
+    const struct AwFmIndexBuildOptions *_RESTRICT_ const options) {
 
   // first, do a sanity check on inputs
   if (config == NULL) {
@@ -153,12 +271,24 @@ awFmCreateIndexFromFasta(struct AwFmIndex *_RESTRICT_ *index,
   if (indexFileSrc == NULL) {
     return AwFmNullPtrError;
   }
+  const struct AwFmIndexBuildOptions defaultOptions = {0};
+  const struct AwFmIndexBuildOptions *buildOptions =
+      options != NULL ? options : &defaultOptions;
+  enum AwFmReturnCode returnCode =
+      checkReducedAminoLetterMap(config, buildOptions);
+  if (returnCode != AwFmSuccess) {
+    return returnCode;
+  }
 
   // set the index out arg initally to NULL, if this function fully completes
   // this will get overwritten
   *index = NULL;
 
-  // read in the sequence file with FastaVector
+  struct AwFmBuildStatistics *statistics = buildOptions->buildStatistics;
+  if (statistics != NULL) {
+    *statistics = (struct AwFmBuildStatistics){0};
+  }
+
   struct FastaVector *fastaVector = malloc(sizeof(struct FastaVector));
   if (fastaVector == NULL) {
     return AwFmAllocationFailure;
@@ -166,39 +296,49 @@ awFmCreateIndexFromFasta(struct AwFmIndex *_RESTRICT_ *index,
   enum FastaVectorReturnCode fastaVectorReturnCode =
       fastaVectorInit(fastaVector);
   if (fastaVectorReturnCode == FASTA_VECTOR_ALLOCATION_FAIL) {
+    free(fastaVector);
     return AwFmAllocationFailure;
   }
-  fastaVectorReturnCode = fastaVectorReadFasta(fastaSrc, fastaVector);
-  if (fastaVectorReturnCode == FASTA_VECTOR_FILE_OPEN_FAIL) {
-    return AwFmFileOpenFail;
-  } else if (fastaVectorReturnCode == FASTA_VECTOR_ALLOCATION_FAIL) {
-    return AwFmAllocationFailure;
+  // only the headers and metadata are kept in the fasta vector.
+  fastaVectorStringDealloc(&fastaVector->sequence);
+  fastaVector->sequence.charData = NULL;
+  fastaVector->sequence.capacity = 0;
+  fastaVector->sequence.count = 0;
+
+  // stream the fasta straight into the buffer the index is built from. If
+  // the original sequence is stored, the residues are sanitized in place
+  // after they're written to the index file, so only one copy is ever held.
+  uint8_t *sequence;
+  size_t sequenceLength;
+  struct AwFmBuildPhaseTimer phaseTimer;
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseReadSequence);
+  returnCode = awFmReadFastaForIndex(
+      fastaSrc, config->alphabetType, !config->storeOriginalSequence,
+      fastaVector, &sequence, &sequenceLength);
+  awFmBuildPhaseEnd(&phaseTimer);
+  if (returnCode != AwFmSuccess) {
+    fastaVectorDealloc(fastaVector);
+    free(fastaVector);
+    return returnCode;
   }
+  const uint8_t *originalSequence =
+      config->storeOriginalSequence ? sequence : NULL;
 
-  const size_t fullSequenceLength = fastaVector->sequence.count;
-  const char *fullSequencePtr = fastaVector->sequence.charData;
-
-  const size_t suffixArrayLength = fullSequenceLength + 1;
-  // create a sanitized copy of the input sequence
-  uint8_t *sanitizedSequenceCopy = malloc(suffixArrayLength);
-  if (sanitizedSequenceCopy == NULL) {
-    return AwFmAllocationFailure;
+  if (buildOptions->constructionMemoryBudget != 0) {
+    return createIndexInLowMemory(index, config, buildOptions,
+                                  originalSequence, sequence, sequenceLength,
+                                  fastaVector, indexFileSrc);
   }
 
-  // sanitize the sequence, turning ambiguity characters into the singular
-  // ambiguity character character (x for nucleotide, z for amino) giving the
-  // sequencePtr as the in and out arrays makes this an in-place algorithm
-  fullSequenceSanitize((uint8_t *)fullSequencePtr, sanitizedSequenceCopy,
-                       fullSequenceLength, config->alphabetType);
-
-  // FastaVector will always have one extra storage at the end of the string, so
-  // this shouldn't ever cause a buffer overflow
-  sanitizedSequenceCopy[suffixArrayLength - 1] = '$';
+  const size_t suffixArrayLength = sequenceLength + 1;
 
   // allocate the index and all internal arrays.
   struct AwFmIndex *_RESTRICT_ indexData =
-      awFmIndexAlloc(config, suffixArrayLength);
+      awFmIndexAlloc(config, buildOptions, suffixArrayLength, true);
   if (indexData == NULL) {
+    free(sequence);
+    fastaVectorDealloc(fastaVector);
+    free(fastaVector);
     return AwFmAllocationFailure;
   }
 
@@ -206,7 +346,6 @@ awFmCreateIndexFromFasta(struct AwFmIndex *_RESTRICT_ *index,
 
   indexData->featureFlags = 0 | (1 << AW_FM_FEATURE_FLAG_BIT_FASTA_VECTOR);
   indexData->fastaVector = fastaVector;
-  memcpy(&indexData->config, config, sizeof(struct AwFmIndexConfiguration));
 
   // init the in memory suffix array to NULL, to be safe. this will get
   // overwritten on success, if the metadata demands in memory SA. If not, this
@@ -215,50 +354,58 @@ awFmCreateIndexFromFasta(struct AwFmIndex *_RESTRICT_ *index,
 
   // set the bwtLength
   indexData->bwtLength = suffixArrayLength;
+  indexData->suffixArrayFileOffset = awFmGetSuffixArrayFileOffset(indexData);
+  indexData->sequenceFileOffset = awFmGetSequenceFileOffset(indexData);
 
-  uint64_t *suffixArray = malloc((suffixArrayLength) * sizeof(uint64_t));
-
-  if (suffixArray == NULL) {
-    free(sanitizedSequenceCopy);
-    awFmDeallocIndex(indexData);
-    return AwFmAllocationFailure;
+  // create the file. The original sequence has to be written before the
+  // buffer is sanitized in place, so it's written right away. The other
+  // sections are written in the background as soon as they're final.
+  struct AwFmFileWriter *writer = NULL;
+  returnCode = openIndexFile(indexData, indexFileSrc, &writer);
+  if (returnCode == AwFmSuccess && originalSequence != NULL) {
+    awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseReadSequence);
+    returnCode = awFmFileWriteFully(fileno(indexData->fileHandle),
+                                    originalSequence, sequenceLength,
+                                    indexData->sequenceFileOffset);
+    returnCode =
+        returnCode == AwFmFileWriteOkay ? AwFmSuccess : AwFmFileWriteFail;
+    awFmBuildPhaseEnd(&phaseTimer);
+    awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseSanitize);
+    awFmSanitizeSequence(sequence, sequence, sequenceLength,
+                         config->alphabetType);
+    awFmBuildPhaseEnd(&phaseTimer);
   }
-
-  // create the suffix array, storing it starting in the second element of the
-  // suffix array we allocated. this doesn't clobber the sentinel we added
-  // earlier, and makes for easier bwt creation.
-  int64_t divSufSortReturnCode = divsufsort64(
-      sanitizedSequenceCopy, (int64_t *)(suffixArray), suffixArrayLength);
-  if (divSufSortReturnCode < 0) {
-    free(sanitizedSequenceCopy);
-    free(suffixArray);
-    awFmDeallocIndex(indexData);
-    return AwFmSuffixArrayCreationFailure;
+  if (returnCode == AwFmSuccess) {
+    reduceSanitizedSequence(indexData, sequence, sequenceLength, statistics);
   }
-
-  // set the bwt and prefix sums
-  setBwtAndPrefixSums(indexData, indexData->bwtLength, sanitizedSequenceCopy,
-                      suffixArray);
-
-  // after generating the bwt, the sequence copy is no longer needed.
-  free(sanitizedSequenceCopy);
-
-  populateKmerSeedTable(indexData);
-  // initialize the compressed suffix array
-  enum AwFmReturnCode returnCode = awFmInitCompressedSuffixArray(
-      suffixArray, suffixArrayLength, &indexData->suffixArray,
-      config->suffixArrayCompressionRatio);
+  // the reader always leaves room for the sentinel.
+  sequence[sequenceLength] = '$';
+
+  // build the suffix array, BWT, and prefix sums. after generating the bwt,
+  // the sequence is no longer needed.
+  if (returnCode == AwFmSuccess) {
+    returnCode =
+        buildBwtAndSuffixArray(indexData, sequence, writer, statistics);
+  }
+  free(sequence);
   if (returnCode != AwFmSuccess) {
+    if (writer != NULL) {
+      awFmFileWriterFinish(writer, NULL, NULL);
+    }
+    awFmDeallocIndex(indexData);
     return returnCode;
   }
 
-  indexData->suffixArrayFileOffset = awFmGetSuffixArrayFileOffset(indexData);
-  indexData->sequenceFileOffset = awFmGetSequenceFileOffset(indexData);
-  // file descriptor will be set in awFmWriteIndexToFile
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseKmerSeedTable);
+  populateKmerSeedTable(indexData);
+  awFmBuildPhaseEnd(&phaseTimer);
 
-  // create the file
-  returnCode = awFmWriteIndexToFile(indexData, (uint8_t *)fullSequencePtr,
-                                    fullSequenceLength, indexFileSrc);
+  double fileWriteSeconds;
+  double fileWriteWaitSeconds;
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseFileWrite);
+  returnCode = finishIndexFile(indexData, writer, &fileWriteSeconds,
+                               &fileWriteWaitSeconds);
+  awFmBuildPhaseEnd(&phaseTimer);
 
   if (!config->keepSuffixArrayInMemory) {
     // if it's kept in memory, the suffixArray array is now used in the
@@ -268,8 +415,17 @@ awFmCreateIndexFromFasta(struct AwFmIndex *_RESTRICT_ *index,
     indexData->suffixArray.values = NULL;
   }
 
-  if (!config->storeOriginalSequence) {
-    fastaVectorStringDealloc(&indexData->fastaVector->sequence);
+  if (statistics != NULL) {
+    // the sequence and the full suffix array are held together.
+    statistics->memoryBudget = 0;
+    statistics->peakConstructionBytes =
+        indexConstructionBytes(indexData) +
+        (suffixArrayLength *
+         (1 + suffixArrayValueByteWidth(suffixArrayLength)));
+    statistics->suffixArrayPartitions = 1;
+    statistics->differenceCoverPeriod = 0;
+    statistics->fileWriteSeconds = fileWriteSeconds;
+    statistics->fileWriteWaitSeconds = fileWriteWaitSeconds;
   }
 
   // set the index as an out argument.
@@ -278,139 +434,736 @@ awFmCreateIndexFromFasta(struct AwFmIndex *_RESTRICT_ *index,
   return returnCode;
 }
 
-void setBwtAndPrefixSums(
-    struct AwFmIndex *_RESTRICT_ const index, const size_t bwtLength,
-    const uint8_t *_RESTRICT_ const sequence,
-    const uint64_t *_RESTRICT_ const unsampledSuffixArray) {
-  if (index->config.alphabetType != AwFmAlphabetAmino) {
-    uint64_t baseOccurrences[8] = {0};
-    // baseOccurrences is length 8 because that's how long the signpost
-    // baseOccurrences in each window need to be to keep alignment to 32B AVX2
-    // boundries.
-
-    for (uint64_t suffixArrayPosition = 0; suffixArrayPosition < bwtLength;
-         suffixArrayPosition++) {
-      const size_t blockIndex =
-          suffixArrayPosition / AW_FM_POSITIONS_PER_FM_BLOCK;
-      const uint8_t positionInBlock =
-          suffixArrayPosition % AW_FM_POSITIONS_PER_FM_BLOCK;
-      const uint8_t byteInVector = positionInBlock / 8;
-      const uint8_t bitInVectorByte = positionInBlock % 8;
-      struct AwFmNucleotideBlock *nucleotideBlockPtr =
-          &index->bwtBlockList.asNucleotide[blockIndex];
-      uint8_t *_RESTRICT_ const letterBitVectorBytes =
-          (uint8_t *)nucleotideBlockPtr->letterBitVectors;
-
-      if (__builtin_expect(positionInBlock == 0, 0)) {
-        // when we start a new block, copy over the base occurrences, and
-        // initialize the bit vectors while we only use 5 elements, copy over
-        // all 8 (to preserve padding and so valgrind doesn't complain about
-        // invalid writes)
-        memcpy(nucleotideBlockPtr->baseOccurrences, baseOccurrences,
-               8 * sizeof(uint64_t));
-        memset(nucleotideBlockPtr->letterBitVectors, 0,
-               sizeof(AwFmSimdVec256) * AW_FM_NUCLEOTIDE_VECTORS_PER_WINDOW);
+// sequences with fewer than 2^31 positions are sorted into a 32-bit suffix
+// array with divsufsort, which halves its memory. The parallel sorter always
+// makes a 64-bit suffix array.
+static uint8_t suffixArrayValueByteWidth(const size_t suffixArrayLength) {
+#ifdef AW_FM_PARALLEL_SUFFIX_SORT
+  (void)suffixArrayLength;
+  return sizeof(uint64_t);
+#else
+  return suffixArrayLength <= INT32_MAX ? sizeof(uint32_t) : sizeof(uint64_t);
+#endif
+}
+
+// sorts the suffixes with the backend selected at build time. divsufsort is
+// the default; AW_FM_PARALLEL_SUFFIX_SORT selects the multithreaded sorter,
+// which is faster on many cores but needs more memory.
+static bool buildSuffixArray(const uint8_t *_RESTRICT_ const sequence,
+                             void *_RESTRICT_ const suffixArray,
+                             const size_t suffixArrayLength,
+                             const uint8_t valueByteWidth) {
+  if (valueByteWidth == sizeof(uint32_t)) {
+    return divsufsort(sequence, (saidx_t *)suffixArray, suffixArrayLength) >=
+           0;
+  }
+#ifdef AW_FM_PARALLEL_SUFFIX_SORT
+  return awFmParallelSuffixSort(sequence, suffixArray, suffixArrayLength) ==
+         AwFmSuccess;
+#else
+  return divsufsort64(sequence, (int64_t *)suffixArray, suffixArrayLength) >= 0;
+#endif
+}
+
+// builds the full suffix array of the sanitized sequence, sets the BWT and
+// prefix sums from it, and compresses it into the index's suffix array. The
+// BWT sections are queued on the writer before the suffix array is compressed,
+// so they're written while the rest of the index is built.
+static enum AwFmReturnCode buildBwtAndSuffixArray(
+    struct AwFmIndex *_RESTRICT_ const index,
+    const uint8_t *_RESTRICT_ const sanitizedSequence,
+    struct AwFmFileWriter *_RESTRICT_ const writer,
+    struct AwFmBuildStatistics *_RESTRICT_ const statistics) {
+  const size_t suffixArrayLength = index->bwtLength;
+  const uint8_t valueByteWidth = suffixArrayValueByteWidth(suffixArrayLength);
+  struct AwFmBuildPhaseTimer phaseTimer;
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseSuffixSort);
+  void *suffixArray = malloc(suffixArrayLength * valueByteWidth);
+  if (suffixArray == NULL) {
+    return AwFmAllocationFailure;
+  }
+
+  if (!buildSuffixArray(sanitizedSequence, suffixArray, suffixArrayLength,
+                        valueByteWidth)) {
+    free(suffixArray);
+    return AwFmSuffixArrayCreationFailure;
+  }
+  awFmBuildPhaseEnd(&phaseTimer);
+
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseBwt);
+  if (setBwtAndPrefixSums(index, suffixArrayLength, sanitizedSequence,
+                          suffixArray, valueByteWidth) != AwFmSuccess ||
+      awFmWriteIndexBwtSections(index, writer) != AwFmSuccess) {
+    free(suffixArray);
+    return AwFmAllocationFailure;
+  }
+  awFmBuildPhaseEnd(&phaseTimer);
+
+  // the compressed suffix array takes ownership of the full one.
+  const uint8_t compressionRatio = index->config.suffixArrayCompressionRatio;
+  awFmBuildPhaseBegin(&phaseTimer, statistics,
+                      AwFmBuildPhaseSuffixArraySampling);
+  enum AwFmReturnCode returnCode;
+  if (valueByteWidth == sizeof(uint32_t)) {
+    returnCode = awFmInitCompressedSuffixArray32(
+        suffixArray, suffixArrayLength, &index->suffixArray, compressionRatio);
+  } else {
+    returnCode = awFmInitCompressedSuffixArray(
+        suffixArray, suffixArrayLength, &index->suffixArray, compressionRatio);
+  }
+  awFmBuildPhaseEnd(&phaseTimer);
+  return returnCode;
+}
+
+// creates the index file and a writer for it.
+static enum AwFmReturnCode
+openIndexFile(struct AwFmIndex *_RESTRICT_ const index,
+              const char *_RESTRICT_ const fileSrc,
+              struct AwFmFileWriter *_RESTRICT_ *writer) {
+  index->fileHandle = fopen(fileSrc, "w+b");
+  if (index->fileHandle == NULL) {
+    return AwFmFileAlreadyExists;
+  }
+  *writer = awFmFileWriterCreate(fileno(index->fileHandle), fileSrc,
+                                 index->useDirectIo);
+  return *writer != NULL ? AwFmSuccess : AwFmAllocationFailure;
+}
+
+// queues every section after the BWT, whose writes were queued once it was
+// built, and waits for the writer to finish. The sequence section is either
+// already written or queued.
+static enum AwFmReturnCode
+finishIndexFile(struct AwFmIndex *_RESTRICT_ const index,
+                struct AwFmFileWriter *_RESTRICT_ const writer,
+                double *_RESTRICT_ const fileWriteSeconds,
+                double *_RESTRICT_ const fileWriteWaitSeconds) {
+  const enum AwFmReturnCode returnCode = awFmWriteIndexRemainingSections(
+      index, writer, NULL, index->bwtLength - 1);
+  const enum AwFmReturnCode writeReturnCode =
+      awFmFileWriterFinish(writer, fileWriteSeconds, fileWriteWaitSeconds);
+  index->fileDescriptor = fileno(index->fileHandle);
+  return returnCode == AwFmSuccess ? writeReturnCode : returnCode;
+}
+
+// gathers each bit plane of the block's letters into the block's bit
+// vectors, 32 letters at a time with AVX2, or 8 at a time with a multiply
+// bit-gather elsewhere.
+static void
+awFmPackBlockBitPlanes(const uint8_t *_RESTRICT_ const compressedLetters,
+                       uint8_t *_RESTRICT_ const bitVectorBytes,
+                       const uint8_t numPlanes) {
+#ifdef __aarch64__
+  for (uint8_t byteInVector = 0; byteInVector < 32; byteInVector++) {
+    uint64_t letters;
+    memcpy(&letters, compressedLetters + (byteInVector * 8), sizeof(uint64_t));
+    for (uint8_t plane = 0; plane < numPlanes; plane++) {
+      // the multiply moves the low bit of each byte into the top byte, with
+      // the first letter in the lowest bit.
+      bitVectorBytes[(plane * 32) + byteInVector] =
+          (((letters >> plane) & 0x0101010101010101ULL) *
+           0x0102040810204080ULL) >>
+          56;
+    }
+  }
+#else
+  for (uint8_t segment = 0; segment < 8; segment++) {
+    const __m256i letters = _mm256_loadu_si256(
+        (const __m256i *)(compressedLetters + (segment * 32)));
+    for (uint8_t plane = 0; plane < numPlanes; plane++) {
+      // shift the plane's bit to the top of each byte, where movemask finds it.
+      const __m256i shiftedLetters =
+          _mm256_sll_epi16(letters, _mm_cvtsi32_si128(7 - plane));
+      const uint32_t planeBits = _mm256_movemask_epi8(shiftedLetters);
+      memcpy(bitVectorBytes + (plane * 32) + (segment * 4), &planeBits,
+             sizeof(uint32_t));
+    }
+  }
+#endif
+}
+
+// reads a value from a suffix array of 4 or 8 byte values.
+static inline uint64_t
+suffixArrayValueAt(const void *_RESTRICT_ const suffixArrayValues,
+                   const uint8_t valueByteWidth, const size_t valueIndex) {
+  return valueByteWidth == sizeof(uint32_t)
+             ? ((const uint32_t *)suffixArrayValues)[valueIndex]
+             : ((const uint64_t *)suffixArrayValues)[valueIndex];
+}
+
+static uint8_t numBitPlanes(const enum AwFmAlphabetType alphabetType) {
+  switch (alphabetType) {
+  case AwFmAlphabetAmino:
+    return AW_FM_AMINO_VECTORS_PER_WINDOW;
+  case AwFmAlphabetReducedAmino:
+    return AW_FM_REDUCED_AMINO_VECTORS_PER_WINDOW;
+  default:
+    return AW_FM_NUCLEOTIDE_VECTORS_PER_WINDOW;
+  }
+}
+
+// the number of counts in a block's baseOccurrences, including its padding.
+static uint8_t
+numBaseOccurrences(const struct AwFmIndex *_RESTRICT_ const index) {
+  return (awFmGetBwtBlockByteWidth(index) -
+          (numBitPlanes(index->config.alphabetType) * sizeof(AwFmSimdVec256))) /
+         sizeof(uint64_t);
+}
+
+static uint8_t
+letterToCompressedVector(const enum AwFmAlphabetType alphabetType,
+                         const uint8_t letterIndex) {
+  switch (alphabetType) {
+  case AwFmAlphabetAmino:
+    return awFmAminoAcidLetterIndexToCompressedVector(letterIndex);
+  case AwFmAlphabetReducedAmino:
+    return awFmReducedAminoLetterIndexToCompressedVector(letterIndex);
+  default:
+    return awFmNucleotideLetterIndexToCompressedVector(letterIndex);
+  }
+}
+
+// builds numBlocks BWT blocks, starting at firstBlockIndex, from the suffix
+// array values of their positions. suffixArrayValues starts at the first
+// position of the first block. occurrences holds the letter counts before the
+// first block, and is advanced to the counts after the last block.
+static enum AwFmReturnCode
+setBwtBlocks(struct AwFmIndex *_RESTRICT_ const index,
+             const uint8_t *_RESTRICT_ const sequence,
+             const void *_RESTRICT_ const suffixArrayValues,
+             const uint8_t valueByteWidth, const size_t numSuffixArrayValues,
+             const size_t firstBlockIndex, const size_t numBlocks,
+             uint64_t *_RESTRICT_ const occurrences) {
+  const size_t bwtLength = index->bwtLength;
+  const enum AwFmAlphabetType alphabetType = index->config.alphabetType;
+  const uint8_t alphabetCardinality = awFmGetAlphabetCardinality(alphabetType);
+  const uint8_t numPlanes = numBitPlanes(alphabetType);
+  // baseOccurrences is padded out to keep the blocks aligned to 32B AVX2
+  // boundries (8 for nucleotide, 24 for amino, 16 for reduced amino).
+  const uint8_t numOccurrenceCounts = numBaseOccurrences(index);
+  const uint8_t sentinelLetterIndex = alphabetCardinality + 1;
+  const size_t blockByteWidth = awFmGetBwtBlockByteWidth(index);
+  const size_t bitVectorsByteWidth = numPlanes * sizeof(AwFmSimdVec256);
+  uint8_t *const blockListBytes = (uint8_t *)index->bwtBlockList.asNucleotide;
+
+  // the letter conversions are hoisted into tables, since the gather from the
+  // sequence is the only part of the loop that can't be vectorized. Reduced
+  // amino sequences are built from the representative letter of each group.
+  uint8_t asciiToLetterIndex[256];
+  uint8_t letterIndexToCompressedVector[AW_FM_BWT_MAX_OCCURRENCE_COUNTS];
+  for (uint16_t ascii = 0; ascii < 256; ascii++) {
+    asciiToLetterIndex[ascii] =
+        alphabetType == AwFmAlphabetAmino
+            ? awFmAsciiAminoAcidToLetterIndex(ascii)
+            : awFmAsciiNucleotideToLetterIndex(ascii);
+  }
+  if (alphabetType == AwFmAlphabetReducedAmino) {
+    for (uint8_t letterIndex = 0; letterIndex <= sentinelLetterIndex;
+         letterIndex++) {
+      asciiToLetterIndex[awFmReducedAminoLetterIndexToAscii(letterIndex)] =
+          letterIndex;
+    }
+  }
+  for (uint8_t letterIndex = 0; letterIndex <= sentinelLetterIndex;
+       letterIndex++) {
+    letterIndexToCompressedVector[letterIndex] =
+        letterToCompressedVector(alphabetType, letterIndex);
+  }
+
+  const size_t firstPosition = firstBlockIndex * AW_FM_POSITIONS_PER_FM_BLOCK;
+  const size_t numChunks =
+      1 + ((numBlocks - 1) / AW_FM_BWT_CONSTRUCTION_CHUNK_BLOCKS);
+  uint64_t *chunkOccurrences =
+      calloc(numChunks * AW_FM_BWT_MAX_OCCURRENCE_COUNTS, sizeof(uint64_t));
+  if (chunkOccurrences == NULL) {
+    return AwFmAllocationFailure;
+  }
+
+  // first pass: pack each block's bit vectors, and store the block's own
+  // letter counts in its baseOccurrences until the chunk offsets are known.
+#pragma omp parallel for schedule(dynamic)
+  for (size_t chunkIndex = 0; chunkIndex < numChunks; chunkIndex++) {
+    uint64_t *_RESTRICT_ const chunkCounts =
+        &chunkOccurrences[chunkIndex * AW_FM_BWT_MAX_OCCURRENCE_COUNTS];
+    const size_t chunkStartBlock =
+        chunkIndex * AW_FM_BWT_CONSTRUCTION_CHUNK_BLOCKS;
+    size_t chunkEndBlock =
+        chunkStartBlock + AW_FM_BWT_CONSTRUCTION_CHUNK_BLOCKS;
+    if (chunkEndBlock > numBlocks) {
+      chunkEndBlock = numBlocks;
+    }
+
+    for (size_t blockIndex = firstBlockIndex + chunkStartBlock;
+         blockIndex < firstBlockIndex + chunkEndBlock; blockIndex++) {
+      uint8_t *const blockBytes =
+          blockListBytes + (blockIndex * blockByteWidth);
+      uint64_t *_RESTRICT_ const blockCounts =
+          (uint64_t *)(blockBytes + bitVectorsByteWidth);
+      memset(blockCounts, 0, numOccurrenceCounts * sizeof(uint64_t));
+
+      const size_t blockStartPosition =
+          blockIndex * AW_FM_POSITIONS_PER_FM_BLOCK;
+      size_t positionsInBlock = bwtLength - blockStartPosition;
+      if (positionsInBlock > AW_FM_POSITIONS_PER_FM_BLOCK) {
+        positionsInBlock = AW_FM_POSITIONS_PER_FM_BLOCK;
       }
 
-      uint64_t sequencePositionInSuffixArray =
-          unsampledSuffixArray[suffixArrayPosition];
-      uint8_t letterIndex;
-      if (__builtin_expect(sequencePositionInSuffixArray == 0, 0)) {
-        // set to the sentinel value (index 5) if we're looking at the letter
-        // before the first character.
-        letterIndex = 5;
-      } else {
-        uint64_t positionInBwt = sequencePositionInSuffixArray - 1;
-        letterIndex = awFmAsciiNucleotideToLetterIndex(sequence[positionInBwt]);
+      uint8_t compressedLetters[AW_FM_POSITIONS_PER_FM_BLOCK] = {0};
+      for (size_t i = 0; i < positionsInBlock; i++) {
+        const size_t valueIndex = blockStartPosition - firstPosition + i;
+        if (valueIndex + AW_FM_BWT_CONSTRUCTION_PREFETCH_DISTANCE <
+            numSuffixArrayValues) {
+          const uint64_t upcomingSequencePosition = suffixArrayValueAt(
+              suffixArrayValues, valueByteWidth,
+              valueIndex + AW_FM_BWT_CONSTRUCTION_PREFETCH_DISTANCE);
+          __builtin_prefetch(&sequence[upcomingSequencePosition == 0
+                                           ? 0
+                                           : upcomingSequencePosition - 1]);
+        }
+
+        const uint64_t sequencePositionInSuffixArray =
+            suffixArrayValueAt(suffixArrayValues, valueByteWidth, valueIndex);
+        // the letter before the first character is the sentinel.
+        const uint8_t letterIndex =
+            __builtin_expect(sequencePositionInSuffixArray != 0, 1)
+                ? asciiToLetterIndex[sequence[sequencePositionInSuffixArray -
+                                              1]]
+                : sentinelLetterIndex;
+        blockCounts[letterIndex]++;
+        compressedLetters[i] = letterIndexToCompressedVector[letterIndex];
       }
 
-      uint8_t letterAsCompressedVector =
-          awFmNucleotideLetterIndexToCompressedVector(letterIndex);
-      baseOccurrences[letterIndex]++;
-      letterBitVectorBytes[byteInVector] |=
-          ((letterAsCompressedVector >> 0) & 0x1) << bitInVectorByte;
-      letterBitVectorBytes[byteInVector + 32] |=
-          ((letterAsCompressedVector >> 1) & 0x1) << bitInVectorByte;
-      letterBitVectorBytes[byteInVector + 64] |=
-          ((letterAsCompressedVector >> 2) & 0x1) << bitInVectorByte;
+      awFmPackBlockBitPlanes(compressedLetters, blockBytes, numPlanes);
+      for (uint8_t letter = 0; letter < numOccurrenceCounts; letter++) {
+        chunkCounts[letter] += blockCounts[letter];
+      }
     }
+  }
 
-    // set the prefix sums
-    index->prefixSums[0] = 1; // 1 is for the sentinel
-    baseOccurrences[0]++;     // add the sentinel to the count of a's
-    for (uint8_t i = 1; i < AW_FM_NUCLEOTIDE_CARDINALITY + 2; i++) {
-      index->prefixSums[i] = baseOccurrences[i - 1];
-      baseOccurrences[i] += baseOccurrences[i - 1];
+  // turn the chunk counts into the occurrences before each chunk.
+  uint64_t totalOccurrences[AW_FM_BWT_MAX_OCCURRENCE_COUNTS] = {0};
+  memcpy(totalOccurrences, occurrences,
+         numOccurrenceCounts * sizeof(uint64_t));
+  for (size_t chunkIndex = 0; chunkIndex < numChunks; chunkIndex++) {
+    uint64_t *chunkCounts =
+        &chunkOccurrences[chunkIndex * AW_FM_BWT_MAX_OCCURRENCE_COUNTS];
+    for (uint8_t letter = 0; letter < numOccurrenceCounts; letter++) {
+      const uint64_t countInChunk = chunkCounts[letter];
+      chunkCounts[letter] = totalOccurrences[letter];
+      totalOccurrences[letter] += countInChunk;
     }
-  } else {
-    uint64_t baseOccurrences[24] = {0};
-
-    for (uint64_t suffixArrayPosition = 0; suffixArrayPosition < bwtLength;
-         suffixArrayPosition++) {
-      const size_t blockIndex =
-          suffixArrayPosition / AW_FM_POSITIONS_PER_FM_BLOCK;
-      const uint8_t positionInBlock =
-          suffixArrayPosition % AW_FM_POSITIONS_PER_FM_BLOCK;
-      const uint8_t byteInVector = positionInBlock / 8;
-      const uint8_t bitInVectorByte = positionInBlock % 8;
-      struct AwFmAminoBlock *_RESTRICT_ const aminoBlockPointer =
-          &index->bwtBlockList.asAmino[blockIndex];
-      uint8_t *_RESTRICT_ const letterBitVectorBytes =
-          (uint8_t *)aminoBlockPointer->letterBitVectors;
-
-      if (__builtin_expect(positionInBlock == 0, 0)) {
-        // when we start a new block, copy over the base occurrences, and
-        // initialize the bit vectors while we only use 21 elements, copy over
-        // all 24 (to preserve padding and so valgrind doesn't complain about
-        // invalid writes)
-        memcpy(aminoBlockPointer->baseOccurrences, baseOccurrences,
-               24 * sizeof(uint64_t));
-        memset(aminoBlockPointer->letterBitVectors, 0,
-               sizeof(AwFmSimdVec256) * AW_FM_AMINO_VECTORS_PER_WINDOW);
+  }
+
+  // second pass: replace each block's counts with the occurrences before it.
+#pragma omp parallel for schedule(static)
+  for (size_t chunkIndex = 0; chunkIndex < numChunks; chunkIndex++) {
+    uint64_t runningOccurrences[AW_FM_BWT_MAX_OCCURRENCE_COUNTS];
+    memcpy(runningOccurrences,
+           &chunkOccurrences[chunkIndex * AW_FM_BWT_MAX_OCCURRENCE_COUNTS],
+           sizeof(runningOccurrences));
+    const size_t chunkStartBlock =
+        chunkIndex * AW_FM_BWT_CONSTRUCTION_CHUNK_BLOCKS;
+    size_t chunkEndBlock =
+        chunkStartBlock + AW_FM_BWT_CONSTRUCTION_CHUNK_BLOCKS;
+    if (chunkEndBlock > numBlocks) {
+      chunkEndBlock = numBlocks;
+    }
+
+    for (size_t blockIndex = firstBlockIndex + chunkStartBlock;
+         blockIndex < firstBlockIndex + chunkEndBlock; blockIndex++) {
+      uint64_t *_RESTRICT_ const blockCounts =
+          (uint64_t *)(blockListBytes + (blockIndex * blockByteWidth) +
+                       bitVectorsByteWidth);
+      for (uint8_t letter = 0; letter < numOccurrenceCounts; letter++) {
+        const uint64_t countInBlock = blockCounts[letter];
+        blockCounts[letter] = runningOccurrences[letter];
+        runningOccurrences[letter] += countInBlock;
       }
+    }
+  }
+  free(chunkOccurrences);
+  memcpy(occurrences, totalOccurrences,
+         numOccurrenceCounts * sizeof(uint64_t));
+  return AwFmSuccess;
+}
+
+void setBwtBlockFromLetters(struct AwFmIndex *_RESTRICT_ const index,
+                            const size_t blockIndex,
+                            const uint8_t *_RESTRICT_ const letterIndices,
+                            const size_t numLetters,
+                            uint64_t *_RESTRICT_ const occurrences) {
+  const enum AwFmAlphabetType alphabetType = index->config.alphabetType;
+  const uint8_t numPlanes = numBitPlanes(alphabetType);
+  const uint8_t numOccurrenceCounts = numBaseOccurrences(index);
+  uint8_t *const blockBytes = ((uint8_t *)index->bwtBlockList.asNucleotide) +
+                              (blockIndex * awFmGetBwtBlockByteWidth(index));
+  memcpy(blockBytes + (numPlanes * sizeof(AwFmSimdVec256)), occurrences,
+         numOccurrenceCounts * sizeof(uint64_t));
+
+  uint8_t compressedLetters[AW_FM_POSITIONS_PER_FM_BLOCK] = {0};
+  for (size_t i = 0; i < numLetters; i++) {
+    const uint8_t letterIndex = letterIndices[i];
+    compressedLetters[i] = letterToCompressedVector(alphabetType, letterIndex);
+    occurrences[letterIndex]++;
+  }
+  awFmPackBlockBitPlanes(compressedLetters, blockBytes, numPlanes);
+}
+
+void setPrefixSums(struct AwFmIndex *_RESTRICT_ const index,
+                   const uint64_t *_RESTRICT_ const occurrences) {
+  const uint8_t alphabetCardinality =
+      awFmGetAlphabetCardinality(index->config.alphabetType);
+  uint64_t totalOccurrences[AW_FM_BWT_MAX_OCCURRENCE_COUNTS];
+  memcpy(totalOccurrences, occurrences, sizeof(totalOccurrences));
+
+  // set the prefix sums
+  index->prefixSums[0] = 1; // 1 is for the sentinel
+  totalOccurrences[0]++;    // add the sentinel to the count of a's
+  for (uint8_t i = 1; i < alphabetCardinality + 2; i++) {
+    index->prefixSums[i] = totalOccurrences[i - 1];
+    totalOccurrences[i] += totalOccurrences[i - 1];
+  }
+}
+
+enum AwFmReturnCode setBwtAndPrefixSums(
+    struct AwFmIndex *_RESTRICT_ const index, const size_t bwtLength,
+    const uint8_t *_RESTRICT_ const sequence,
+    const void *_RESTRICT_ const unsampledSuffixArray,
+    const uint8_t valueByteWidth) {
+  uint64_t occurrences[AW_FM_BWT_MAX_OCCURRENCE_COUNTS] = {0};
+  if (setBwtBlocks(index, sequence, unsampledSuffixArray, valueByteWidth,
+                   bwtLength, 0, awFmNumBlocksFromBwtLength(bwtLength),
+                   occurrences) != AwFmSuccess) {
+    return AwFmAllocationFailure;
+  }
+  setPrefixSums(index, occurrences);
+  return AwFmSuccess;
+}
+
+// a user-supplied reduced amino letter map has to place every amino acid.
+static enum AwFmReturnCode checkReducedAminoLetterMap(
+    const struct AwFmIndexConfiguration *_RESTRICT_ const config,
+    const struct AwFmIndexBuildOptions *_RESTRICT_ const options) {
+  if (config->alphabetType == AwFmAlphabetReducedAmino &&
+      options->reducedAminoLetterMap != NULL &&
+      !awFmReducedAminoLetterMapIsValid(options->reducedAminoLetterMap)) {
+    return AwFmIllegalPositionError;
+  }
+  return AwFmSuccess;
+}
+
+// reduced amino sequences are sanitized as amino acids, then each letter is
+// replaced with its group's representative letter so the suffix sort orders
+// the groups by letter index. Other alphabets are left as they are.
+static void reduceSanitizedSequence(
+    const struct AwFmIndex *_RESTRICT_ const index, uint8_t *const sequence,
+    const size_t sequenceLength,
+    struct AwFmBuildStatistics *_RESTRICT_ const statistics) {
+  if (index->config.alphabetType != AwFmAlphabetReducedAmino) {
+    return;
+  }
+  struct AwFmBuildPhaseTimer phaseTimer;
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseSanitize);
+  awFmReduceAminoSequence(sequence, sequenceLength,
+                          index->reducedAminoLetterMap);
+  awFmBuildPhaseEnd(&phaseTimer);
+}
+
+// memory held by the index's own arrays while it's being built.
+static size_t
+indexConstructionBytes(const struct AwFmIndex *_RESTRICT_ const index) {
+  size_t bytes =
+      awFmGetBwtBlockListByteLength(index) +
+      (awFmGetKmerTableLength(index) * sizeof(struct AwFmSearchRange));
+  if (index->fastaVector != NULL) {
+    bytes += index->fastaVector->header.count +
+             (index->fastaVector->metadata.count *
+              sizeof(struct FastaVectorMetadata));
+  }
+  return bytes;
+}
+
+// takes the next partition of the suffix array in a low-memory build, writing
+// its samples to the suffix array section and its letters to the BWT blocks.
+static enum AwFmReturnCode
+consumeSortedSuffixes(const uint64_t *_RESTRICT_ const suffixes,
+                      const size_t count, void *_RESTRICT_ const context) {
+  struct AwFmLowMemoryBuild *_RESTRICT_ const build = context;
+  struct AwFmIndex *_RESTRICT_ const index = build->index;
+  const uint64_t compressionRatio = index->config.suffixArrayCompressionRatio;
+
+  // the sampled positions are the multiples of the compression ratio.
+  const uint64_t firstSampleIndex =
+      (compressionRatio - (build->suffixArrayPosition % compressionRatio)) %
+      compressionRatio;
+  for (uint64_t i = firstSampleIndex; i < count; i += compressionRatio) {
+    const enum AwFmReturnCode returnCode =
+        awFmSuffixArrayWriterAppend(build->writer, suffixes[i]);
+    if (returnCode != AwFmSuccess) {
+      return returnCode;
+    }
+  }
+  build->suffixArrayPosition += count;
+
+  // finish the block left partial by the last partition, if this one fills it.
+  size_t consumed = 0;
+  if (build->numPendingSuffixes != 0) {
+    consumed = AW_FM_POSITIONS_PER_FM_BLOCK - build->numPendingSuffixes;
+    if (consumed > count) {
+      consumed = count;
+    }
+    memcpy(&build->pendingSuffixes[build->numPendingSuffixes], suffixes,
+           consumed * sizeof(uint64_t));
+    build->numPendingSuffixes += consumed;
+    if (build->numPendingSuffixes < AW_FM_POSITIONS_PER_FM_BLOCK) {
+      return AwFmSuccess;
+    }
+    if (setBwtBlocks(index, build->sequence, build->pendingSuffixes,
+                     sizeof(uint64_t), AW_FM_POSITIONS_PER_FM_BLOCK,
+                     build->nextBlockIndex, 1,
+                     build->occurrences) != AwFmSuccess) {
+      return AwFmAllocationFailure;
+    }
+    build->nextBlockIndex++;
+    build->numPendingSuffixes = 0;
+  }
+
+  // the full blocks are built straight from the partition.
+  const size_t numFullBlocks =
+      (count - consumed) / AW_FM_POSITIONS_PER_FM_BLOCK;
+  if (numFullBlocks != 0) {
+    const size_t numValues = numFullBlocks * AW_FM_POSITIONS_PER_FM_BLOCK;
+    if (setBwtBlocks(index, build->sequence, &suffixes[consumed],
+                     sizeof(uint64_t), numValues, build->nextBlockIndex,
+                     numFullBlocks, build->occurrences) != AwFmSuccess) {
+      return AwFmAllocationFailure;
+    }
+    build->nextBlockIndex += numFullBlocks;
+    consumed += numValues;
+  }
+
+  build->numPendingSuffixes = count - consumed;
+  memcpy(build->pendingSuffixes, &suffixes[consumed],
+         build->numPendingSuffixes * sizeof(uint64_t));
+  return AwFmSuccess;
+}
+
+// builds the index without holding the full suffix array in memory. The
+// suffix array is sorted in partitions that fit the options' budget,
+// and each one is streamed into the BWT and the suffix array section of the
+// file. sequence is the original sequence, which is written to the file if
+// it's stored and then sanitized into text. text is a buffer of
+// sequenceLength + 1 bytes that the build takes ownership of, or NULL to
+// allocate one, and may be the same buffer as sequence. If sequence is NULL,
+// text must already hold the sanitized sequence.
+static enum AwFmReturnCode createIndexInLowMemory(
+    struct AwFmIndex *_RESTRICT_ *index,
+    struct AwFmIndexConfiguration *_RESTRICT_ const config,
+    const struct AwFmIndexBuildOptions *_RESTRICT_ const options,
+    const uint8_t *const sequence, uint8_t *text, const size_t sequenceLength,
+    struct FastaVector *_RESTRICT_ const fastaVector,
+    const char *_RESTRICT_ const fileSrc) {
+  const size_t bwtLength = sequenceLength + 1;
+  struct AwFmIndex *_RESTRICT_ indexData =
+      awFmIndexAlloc(config, options, bwtLength, true);
+  if (indexData == NULL) {
+    free(text);
+    if (fastaVector != NULL) {
+      fastaVectorDealloc(fastaVector);
+      free(fastaVector);
+    }
+    return AwFmAllocationFailure;
+  }
+  indexData->versionNumber = AW_FM_CURRENT_VERSION_NUMBER;
+  indexData->featureFlags =
+      fastaVector != NULL ? (1 << AW_FM_FEATURE_FLAG_BIT_FASTA_VECTOR) : 0;
+  indexData->fastaVector = fastaVector;
+  indexData->suffixArray.values = NULL;
+  indexData->bwtLength = bwtLength;
+  indexData->suffixArray.valueBitWidth =
+      awFmComputeSuffixArrayValueMinWidth(bwtLength);
+  indexData->suffixArray.compressedByteLength =
+      awFmComputeCompressedSaSizeInBytes(bwtLength,
+                                         config->suffixArrayCompressionRatio);
+  indexData->suffixArrayFileOffset = awFmGetSuffixArrayFileOffset(indexData);
+  indexData->sequenceFileOffset = awFmGetSequenceFileOffset(indexData);
+
+  const size_t fixedBytes = indexConstructionBytes(indexData) +
+                            AW_FM_SUFFIX_ARRAY_WRITER_BUFFER_SIZE + bwtLength;
+  const size_t suffixArrayBytes =
+      config->keepSuffixArrayInMemory
+          ? indexData->suffixArray.compressedByteLength
+          : 0;
+  if (fixedBytes + suffixArrayBytes >= options->constructionMemoryBudget) {
+    free(text);
+    awFmDeallocIndex(indexData);
+    return AwFmInsufficientMemoryBudget;
+  }
 
-      uint64_t sequencePositionInSuffixArray =
-          unsampledSuffixArray[suffixArrayPosition];
-      uint8_t letterIndex;
-      if (__builtin_expect(sequencePositionInSuffixArray != 0, 1)) {
-        uint64_t positionInBwt = sequencePositionInSuffixArray - 1;
-        letterIndex = awFmAsciiAminoAcidToLetterIndex(sequence[positionInBwt]);
-      } else {
-        // set to the sentinel value (index 21) if we're looking at the letter
-        // before the first character.
-        letterIndex = 21;
+  indexData->fileHandle = fopen(fileSrc, "w+b");
+  if (indexData->fileHandle == NULL) {
+    free(text);
+    awFmDeallocIndex(indexData);
+    return AwFmFileOpenFail;
+  }
+  const int fileDescriptor = fileno(indexData->fileHandle);
+
+  struct AwFmBuildStatistics *statistics = options->buildStatistics;
+  struct AwFmBuildPhaseTimer phaseTimer;
+  if (sequence != NULL) {
+    awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseReadSequence);
+    if (config->storeOriginalSequence &&
+        awFmFileWriteFully(fileDescriptor, sequence, sequenceLength,
+                           indexData->sequenceFileOffset) !=
+            AwFmFileWriteOkay) {
+      free(text);
+      awFmDeallocIndex(indexData);
+      return AwFmFileWriteFail;
+    }
+    awFmBuildPhaseEnd(&phaseTimer);
+
+    awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseSanitize);
+    if (text == NULL) {
+      text = malloc(bwtLength);
+      if (text == NULL) {
+        awFmDeallocIndex(indexData);
+        return AwFmAllocationFailure;
       }
-      uint8_t letterAsVectorFormat =
-          awFmAminoAcidLetterIndexToCompressedVector(letterIndex);
-      baseOccurrences[letterIndex]++;
-      letterBitVectorBytes[byteInVector] |=
-          (((letterAsVectorFormat >> 0) & 0x1) << bitInVectorByte);
-      letterBitVectorBytes[byteInVector + 32] |=
-          (((letterAsVectorFormat >> 1) & 0x1) << bitInVectorByte);
-      letterBitVectorBytes[byteInVector + 64] |=
-          (((letterAsVectorFormat >> 2) & 0x1) << bitInVectorByte);
-      letterBitVectorBytes[byteInVector + 96] |=
-          (((letterAsVectorFormat >> 3) & 0x1) << bitInVectorByte);
-      letterBitVectorBytes[byteInVector + 128] |=
-          (((letterAsVectorFormat >> 4) & 0x1) << bitInVectorByte);
     }
-    // set the prefix sums
-    index->prefixSums[0] = 1;
-    baseOccurrences[0]++; // add the sentinel into the count of a's
-    for (uint8_t i = 1; i < AW_FM_AMINO_CARDINALITY + 2; i++) {
-      index->prefixSums[i] = baseOccurrences[i - 1];
-      baseOccurrences[i] += baseOccurrences[i - 1];
+    awFmSanitizeSequence(sequence, text, sequenceLength, config->alphabetType);
+    awFmBuildPhaseEnd(&phaseTimer);
+  }
+  reduceSanitizedSequence(indexData, text, sequenceLength, statistics);
+  text[sequenceLength] = '$';
+
+  struct AwFmSuffixArrayWriter writer;
+  enum AwFmReturnCode returnCode = awFmSuffixArrayWriterInit(
+      &writer, fileDescriptor, indexData->suffixArrayFileOffset,
+      indexData->suffixArray.valueBitWidth);
+  struct AwFmLowMemoryBuild build = {.index = indexData,
+                                     .sequence = text,
+                                     .writer = &writer,
+                                     .suffixArrayPosition = 0,
+                                     .nextBlockIndex = 0,
+                                     .numPendingSuffixes = 0,
+                                     .occurrences = {0}};
+  struct AwFmBlockwiseSortStatistics sortStatistics = {0};
+  // the BWT and the suffix array samples are set as the suffixes are sorted.
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseSuffixSort);
+  if (returnCode == AwFmSuccess) {
+    returnCode = awFmBlockwiseSuffixSort(
+        text, bwtLength, options->constructionMemoryBudget - fixedBytes,
+        consumeSortedSuffixes, &build, &sortStatistics);
+    // the last block is usually left partial.
+    if (returnCode == AwFmSuccess && build.numPendingSuffixes != 0 &&
+        setBwtBlocks(indexData, text, build.pendingSuffixes, sizeof(uint64_t),
+                     build.numPendingSuffixes, build.nextBlockIndex, 1,
+                     build.occurrences) != AwFmSuccess) {
+      returnCode = AwFmAllocationFailure;
+    }
+    if (returnCode == AwFmSuccess) {
+      returnCode = awFmSuffixArrayWriterFinish(
+          &writer, indexData->suffixArray.compressedByteLength);
+    } else {
+      awFmSuffixArrayWriterDealloc(&writer);
     }
   }
+  awFmBuildPhaseEnd(&phaseTimer);
+
+  free(text);
+  if (returnCode != AwFmSuccess) {
+    awFmDeallocIndex(indexData);
+    return returnCode;
+  }
+
+  setPrefixSums(indexData, build.occurrences);
+
+  // the BWT is written while the kmer seed table is built. The sequence and
+  // the suffix array sections are already in the file.
+  struct AwFmFileWriter *fileWriter = awFmFileWriterCreate(
+      fileDescriptor, fileSrc, indexData->useDirectIo);
+  if (fileWriter == NULL) {
+    awFmDeallocIndex(indexData);
+    return AwFmAllocationFailure;
+  }
+  returnCode = awFmWriteIndexBwtSections(indexData, fileWriter);
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseKmerSeedTable);
+  populateKmerSeedTable(indexData);
+  awFmBuildPhaseEnd(&phaseTimer);
+  double fileWriteSeconds;
+  double fileWriteWaitSeconds;
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseFileWrite);
+  const enum AwFmReturnCode writeReturnCode = finishIndexFile(
+      indexData, fileWriter, &fileWriteSeconds, &fileWriteWaitSeconds);
+  awFmBuildPhaseEnd(&phaseTimer);
+  if (returnCode == AwFmSuccess) {
+    returnCode = writeReturnCode;
+  }
+
+  if (returnCode == AwFmFileWriteOkay && config->keepSuffixArrayInMemory) {
+    indexData->suffixArray.values =
+        malloc(indexData->suffixArray.compressedByteLength);
+    if (indexData->suffixArray.values == NULL) {
+      returnCode = AwFmAllocationFailure;
+    } else if (awFmFileReadFully(indexData->fileDescriptor,
+                                 indexData->suffixArray.values,
+                                 indexData->suffixArray.compressedByteLength,
+                                 indexData->suffixArrayFileOffset) !=
+               AwFmFileReadOkay) {
+      returnCode = AwFmFileReadFail;
+    }
+  }
+
+  if (statistics != NULL) {
+    size_t peakBytes = fixedBytes + sortStatistics.peakBytes;
+    if (fixedBytes + suffixArrayBytes > peakBytes) {
+      peakBytes = fixedBytes + suffixArrayBytes;
+    }
+    statistics->memoryBudget = options->constructionMemoryBudget;
+    statistics->peakConstructionBytes = peakBytes;
+    statistics->suffixArrayPartitions = sortStatistics.numPartitions;
+    statistics->differenceCoverPeriod = sortStatistics.differenceCoverPeriod;
+    statistics->fileWriteSeconds = fileWriteSeconds;
+    statistics->fileWriteWaitSeconds = fileWriteWaitSeconds;
+  }
+
+  *index = indexData;
+  return returnCode;
 }
 
 void populateKmerSeedTable(struct AwFmIndex *_RESTRICT_ const index) {
   const uint8_t alphabetCardinality =
       awFmGetAlphabetCardinality(index->config.alphabetType);
-  for (uint8_t i = 0; i < alphabetCardinality; i++) {
-    struct AwFmSearchRange range = {.startPtr = index->prefixSums[i],
-                                    .endPtr = index->prefixSums[i + 1] - 1};
-    populateKmerSeedTableRecursive(index, range, 1, i, alphabetCardinality);
+  const size_t kmerLength = index->config.kmerLengthInSeedTable;
+
+  // the kmers that end in the same few letters share a subtree of backward
+  // steps, and write disjoint parts of the table. Split the kmers into enough
+  // subtrees to keep every thread busy, and fill them in parallel.
+  size_t splitLength = 1;
+  uint64_t numSubtrees = alphabetCardinality;
+  while (splitLength < kmerLength &&
+         numSubtrees < AW_FM_SEED_TABLE_MIN_PARALLEL_SUBTREES) {
+    splitLength++;
+    numSubtrees *= alphabetCardinality;
+  }
+
+#pragma omp parallel for schedule(dynamic)
+  for (uint64_t subtreeIndex = 0; subtreeIndex < numSubtrees;
+       subtreeIndex++) {
+    // the lowest digit of the kmer index is the last letter of the kmer,
+    // which is the first one searched.
+    uint64_t remainingLetters = subtreeIndex;
+    const uint8_t lastLetter = remainingLetters % alphabetCardinality;
+    remainingLetters /= alphabetCardinality;
+    struct AwFmSearchRange range = {.startPtr = index->prefixSums[lastLetter],
+                                    .endPtr =
+                                        index->prefixSums[lastLetter + 1] - 1};
+    for (size_t letterNum = 1; letterNum < splitLength; letterNum++) {
+      const uint8_t extendedLetter = remainingLetters % alphabetCardinality;
+      remainingLetters /= alphabetCardinality;
+      awFmIterativeStepBackwardSearch(index, &range, extendedLetter);
+    }
+    populateKmerSeedTableRecursive(index, range, splitLength, subtreeIndex,
+                                   numSubtrees);
   }
 }
 
@@ -434,12 +1187,7 @@ void populateKmerSeedTableRecursive(struct AwFmIndex *_RESTRICT_ const index,
   for (uint8_t extendedLetter = 0; extendedLetter < alphabetSize;
        extendedLetter++) {
     struct AwFmSearchRange newRange = range;
-    if (index->config.alphabetType != AwFmAlphabetAmino) {
-      awFmNucleotideIterativeStepBackwardSearch(index, &newRange,
-                                                extendedLetter);
-    } else {
-      awFmAminoIterativeStepBackwardSearch(index, &newRange, extendedLetter);
-    }
+    awFmIterativeStepBackwardSearch(index, &newRange, extendedLetter);
 
     uint64_t newKmerIndex =
         currentKmerIndex + (extendedLetter * letterIndexMultiplier);
@@ -448,19 +1196,3 @@ void populateKmerSeedTableRecursive(struct AwFmIndex *_RESTRICT_ const index,
                                    letterIndexMultiplier * alphabetSize);
   }
 }
-
-inline void fullSequenceSanitize(const uint8_t *const sequence,
-                                 uint8_t *const sanitizedSequenceCopy,
-                                 const size_t sequenceLength,
-                                 const enum AwFmAlphabetType alphabetType) {
-
-  if (alphabetType != AwFmAlphabetAmino) {
-    for (size_t i = 0; i < sequenceLength; i++) {
-      sanitizedSequenceCopy[i] = awFmAsciiNucleotideLetterSanitize(sequence[i]);
-    }
-  } else {
-    for (size_t i = 0; i < sequenceLength; i++) {
-      sanitizedSequenceCopy[i] = awFmAsciiAminoLetterSanitize(sequence[i]);
-    }
-  }
-}
@@ -1,7 +1,52 @@
 #ifndef AW_FM_INDEX_CREATE_H
 #define AW_FM_INDEX_CREATE_H
 
-// This is intentionally left blank, all public function prototypes for
-// AwFmCreate are found in AwFmIndex.h as public API functions
+#include <stddef.h>
+#include <stdint.h>
+#include "AwFmIndex.h"
+
+// All public function prototypes for AwFmCreate are found in AwFmIndex.h as
+// public API functions. These are the construction steps shared with the
+// other ways of building an index, like merging two indices.
+
+// length of the padded baseOccurrences array in an amino block.
+#define AW_FM_BWT_MAX_OCCURRENCE_COUNTS (AW_FM_AMINO_CARDINALITY + 4)
+
+/*
+ * Function:  setBwtBlockFromLetters
+ * --------------------
+ * Packs one BWT block from the letter indices of its positions, for builds
+ * that produce the BWT as a stream of letters rather than from a suffix array.
+ *
+ *  Inputs:
+ *    index:         Index whose block list holds the block.
+ *    blockIndex:    Block to set.
+ *    letterIndices: Letter index of each position in the block, using the
+ *      sentinel letter index for the sentinel.
+ *    numLetters:    Number of positions in the block, at most
+ *      AW_FM_POSITIONS_PER_FM_BLOCK. Only the last block may be partial.
+ *    occurrences:   Counts of each letter before the block, advanced to the
+ *      counts after it.
+ */
+void setBwtBlockFromLetters(struct AwFmIndex *_RESTRICT_ const index,
+                            const size_t blockIndex,
+                            const uint8_t *_RESTRICT_ const letterIndices,
+                            const size_t numLetters,
+                            uint64_t *_RESTRICT_ const occurrences);
+
+/*
+ * Function:  setPrefixSums
+ * --------------------
+ * Sets the index's prefix sums from the letter counts of the whole BWT.
+ */
+void setPrefixSums(struct AwFmIndex *_RESTRICT_ const index,
+                   const uint64_t *_RESTRICT_ const occurrences);
+
+/*
+ * Function:  populateKmerSeedTable
+ * --------------------
+ * Fills the kmer seed table by searching every kmer in the index's BWT.
+ */
+void populateKmerSeedTable(struct AwFmIndex *_RESTRICT_ const index);
 
 #endif /* end of include guard: AW_FM_INDEX_CREATE_H */
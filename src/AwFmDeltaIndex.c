@@ -0,0 +1,660 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "AwFmIndex.h"
+
+// the delta index's working files are named by appending these to the prefix.
+#define AW_FM_DELTA_FASTA_SUFFIX ".delta.fasta"
+#define AW_FM_DELTA_INDEX_SUFFIX ".delta.awfmi"
+#define AW_FM_COMPACTING_INDEX_SUFFIX ".compacting.awfmi"
+#define AW_FM_MAIN_INDEX_SUFFIX ".main.awfmi"
+
+// maps a range of an index's sequence positions to global positions, which
+// count every sequence in the order it was added.
+struct AwFmDeltaSegment {
+  uint64_t indexStart;
+  uint64_t length;
+  uint64_t globalStart;
+};
+
+// an index and its global coordinates, shared by every snapshot that uses it.
+// Deallocated once the last of those snapshots is released.
+struct AwFmSharedIndex {
+  struct AwFmIndex *index;
+  // sorted by indexStart. Compaction puts the newer sequences first.
+  struct AwFmDeltaSegment *segments;
+  size_t numSegments;
+  uint32_t references;
+};
+
+// the indices a search runs against. Replaced as a whole, never modified, so
+// a search sees either every effect of an append or compaction or none.
+struct AwFmDeltaSnapshot {
+  struct AwFmSharedIndex *main;
+  // NULL if nothing was appended since the last compaction.
+  struct AwFmSharedIndex *delta;
+  uint32_t references;
+};
+
+struct AwFmDeltaRecord {
+  char *header;
+  char *sequence;
+  size_t sequenceLength;
+};
+
+struct AwFmDeltaIndex {
+  struct AwFmIndexConfiguration config;
+  // delta and compacted indices are allocated and written like the main index.
+  struct AwFmIndexBuildOptions buildOptions;
+  char *deltaFastaSrc;
+  char *deltaIndexSrc;
+  char *compactingIndexSrc;
+  char *mainIndexSrc;
+  // protects snapshot and every reference count, and is only held briefly.
+  pthread_mutex_t snapshotLock;
+  struct AwFmDeltaSnapshot *snapshot;
+  // serializes changes to the records and the snapshots built from them.
+  pthread_mutex_t appendLock;
+  // appended sequences not yet compacted into the main index, oldest first.
+  struct AwFmDeltaRecord *records;
+  size_t numRecords;
+  size_t recordCapacity;
+  // global position of the first record's sequence.
+  uint64_t recordsGlobalStart;
+  pthread_t compactionThread;
+  bool compactionRunning;
+  bool compactionNeedsJoin;
+  enum AwFmReturnCode compactionReturnCode;
+};
+
+static char *makeFileSrc(const char *_RESTRICT_ const prefix,
+                         const char *_RESTRICT_ const suffix) {
+  char *fileSrc = malloc(strlen(prefix) + strlen(suffix) + 1);
+  if (fileSrc != NULL) {
+    strcpy(fileSrc, prefix);
+    strcat(fileSrc, suffix);
+  }
+  return fileSrc;
+}
+
+static struct AwFmSharedIndex *
+createSharedIndex(struct AwFmIndex *_RESTRICT_ const index,
+                  const size_t numSegments) {
+  struct AwFmSharedIndex *shared = malloc(sizeof(struct AwFmSharedIndex));
+  if (shared == NULL) {
+    return NULL;
+  }
+  shared->segments = malloc(numSegments * sizeof(struct AwFmDeltaSegment));
+  if (shared->segments == NULL) {
+    free(shared);
+    return NULL;
+  }
+  shared->index = index;
+  shared->numSegments = numSegments;
+  shared->references = 0;
+  return shared;
+}
+
+static void
+deallocSharedIndex(struct AwFmSharedIndex *_RESTRICT_ const shared) {
+  awFmDeallocIndex(shared->index);
+  free(shared->segments);
+  free(shared);
+}
+
+static struct AwFmDeltaSnapshot *
+acquireSnapshot(struct AwFmDeltaIndex *_RESTRICT_ const deltaIndex) {
+  pthread_mutex_lock(&deltaIndex->snapshotLock);
+  struct AwFmDeltaSnapshot *snapshot = deltaIndex->snapshot;
+  snapshot->references++;
+  pthread_mutex_unlock(&deltaIndex->snapshotLock);
+  return snapshot;
+}
+
+static void
+releaseSnapshot(struct AwFmDeltaIndex *_RESTRICT_ const deltaIndex,
+                struct AwFmDeltaSnapshot *_RESTRICT_ const snapshot) {
+  struct AwFmSharedIndex *unusedMain = NULL;
+  struct AwFmSharedIndex *unusedDelta = NULL;
+  pthread_mutex_lock(&deltaIndex->snapshotLock);
+  const bool snapshotUnused = --snapshot->references == 0;
+  if (snapshotUnused) {
+    if (--snapshot->main->references == 0) {
+      unusedMain = snapshot->main;
+    }
+    if (snapshot->delta != NULL && --snapshot->delta->references == 0) {
+      unusedDelta = snapshot->delta;
+    }
+  }
+  pthread_mutex_unlock(&deltaIndex->snapshotLock);
+
+  // deallocated outside the lock, so searches can start in the meantime.
+  if (unusedMain != NULL) {
+    deallocSharedIndex(unusedMain);
+  }
+  if (unusedDelta != NULL) {
+    deallocSharedIndex(unusedDelta);
+  }
+  if (snapshotUnused) {
+    free(snapshot);
+  }
+}
+
+// makes the given indices the ones new searches run against. Searches already
+// running keep the snapshot they started with.
+static enum AwFmReturnCode
+publishSnapshot(struct AwFmDeltaIndex *_RESTRICT_ const deltaIndex,
+                struct AwFmSharedIndex *_RESTRICT_ const main,
+                struct AwFmSharedIndex *_RESTRICT_ const delta) {
+  struct AwFmDeltaSnapshot *snapshot = malloc(sizeof(struct AwFmDeltaSnapshot));
+  if (snapshot == NULL) {
+    return AwFmAllocationFailure;
+  }
+  snapshot->main = main;
+  snapshot->delta = delta;
+  // the reference held by deltaIndex->snapshot.
+  snapshot->references = 1;
+
+  pthread_mutex_lock(&deltaIndex->snapshotLock);
+  main->references++;
+  if (delta != NULL) {
+    delta->references++;
+  }
+  struct AwFmDeltaSnapshot *previousSnapshot = deltaIndex->snapshot;
+  deltaIndex->snapshot = snapshot;
+  pthread_mutex_unlock(&deltaIndex->snapshotLock);
+
+  if (previousSnapshot != NULL) {
+    releaseSnapshot(deltaIndex, previousSnapshot);
+  }
+  return AwFmSuccess;
+}
+
+// builds an index over the records from firstRecord on, through a fasta file,
+// whose sequence starts at globalStart. The files are removed as soon as the
+// index is built; the index keeps its file open, so it stays readable until
+// it's deallocated.
+static enum AwFmReturnCode
+buildRecordIndex(struct AwFmDeltaIndex *_RESTRICT_ const deltaIndex,
+                 const size_t firstRecord, const uint64_t globalStart,
+                 struct AwFmSharedIndex *_RESTRICT_ *sharedIndex) {
+  *sharedIndex = NULL;
+  if (firstRecord == deltaIndex->numRecords) {
+    return AwFmSuccess;
+  }
+
+  FILE *fastaFile = fopen(deltaIndex->deltaFastaSrc, "w");
+  if (fastaFile == NULL) {
+    return AwFmFileOpenFail;
+  }
+  uint64_t sequenceLength = 0;
+  bool writeFailed = false;
+  for (size_t i = firstRecord; i < deltaIndex->numRecords; i++) {
+    const struct AwFmDeltaRecord *record = &deltaIndex->records[i];
+    writeFailed |= fprintf(fastaFile, ">%s\n", record->header) < 0;
+    writeFailed |= fwrite(record->sequence, 1, record->sequenceLength,
+                          fastaFile) != record->sequenceLength;
+    writeFailed |= fputc('\n', fastaFile) == EOF;
+    sequenceLength += record->sequenceLength;
+  }
+  writeFailed |= fclose(fastaFile) != 0;
+  if (writeFailed) {
+    remove(deltaIndex->deltaFastaSrc);
+    return AwFmFileWriteFail;
+  }
+
+  struct AwFmIndexConfiguration config = deltaIndex->config;
+  struct AwFmIndex *index;
+  const enum AwFmReturnCode returnCode = awFmCreateIndexFromFastaWithOptions(
+      &index, &config, deltaIndex->deltaFastaSrc, deltaIndex->deltaIndexSrc,
+      &deltaIndex->buildOptions);
+  remove(deltaIndex->deltaFastaSrc);
+  remove(deltaIndex->deltaIndexSrc);
+  if (awFmReturnCodeIsFailure(returnCode)) {
+    return returnCode;
+  }
+
+  *sharedIndex = createSharedIndex(index, 1);
+  if (*sharedIndex == NULL) {
+    awFmDeallocIndex(index);
+    return AwFmAllocationFailure;
+  }
+  (*sharedIndex)->segments[0] =
+      (struct AwFmDeltaSegment){.indexStart = 0,
+                                .length = sequenceLength,
+                                .globalStart = globalStart};
+  return AwFmSuccess;
+}
+
+// rebuilds the delta over the records from firstRecord on, and publishes it
+// with the given main index. Called with the append lock held.
+static enum AwFmReturnCode
+rebuildDelta(struct AwFmDeltaIndex *_RESTRICT_ const deltaIndex,
+             struct AwFmSharedIndex *_RESTRICT_ const main,
+             const size_t firstRecord, const uint64_t globalStart) {
+  struct AwFmSharedIndex *delta;
+  enum AwFmReturnCode returnCode =
+      buildRecordIndex(deltaIndex, firstRecord, globalStart, &delta);
+  if (returnCode == AwFmSuccess) {
+    returnCode = publishSnapshot(deltaIndex, main, delta);
+    if (returnCode != AwFmSuccess && delta != NULL) {
+      deallocSharedIndex(delta);
+    }
+  }
+  return returnCode;
+}
+
+enum AwFmReturnCode awFmDeltaIndexCreate(
+    struct AwFmDeltaIndex *_RESTRICT_ *deltaIndex,
+    struct AwFmIndex *_RESTRICT_ const mainIndex,
+    const struct AwFmIndexConfiguration *_RESTRICT_ const config,
+    const char *_RESTRICT_ const fileSrcPrefix) {
+  if (deltaIndex == NULL || mainIndex == NULL || config == NULL ||
+      fileSrcPrefix == NULL) {
+    return AwFmNullPtrError;
+  }
+  *deltaIndex = NULL;
+  if (mainIndex->config.alphabetType == AwFmAlphabetReducedAmino ||
+      config->alphabetType == AwFmAlphabetReducedAmino) {
+    return AwFmFeatureUnsupported;
+  }
+  if ((mainIndex->config.alphabetType == AwFmAlphabetAmino) !=
+      (config->alphabetType == AwFmAlphabetAmino)) {
+    return AwFmIncompatibleIndices;
+  }
+
+  struct AwFmDeltaIndex *newIndex = calloc(1, sizeof(struct AwFmDeltaIndex));
+  if (newIndex == NULL) {
+    return AwFmAllocationFailure;
+  }
+  newIndex->config = *config;
+  newIndex->buildOptions.allocationPolicy = mainIndex->allocationPolicy;
+  newIndex->buildOptions.useDirectIo = mainIndex->useDirectIo;
+  newIndex->recordsGlobalStart = mainIndex->bwtLength - 1;
+  newIndex->compactionReturnCode = AwFmSuccess;
+  newIndex->deltaFastaSrc =
+      makeFileSrc(fileSrcPrefix, AW_FM_DELTA_FASTA_SUFFIX);
+  newIndex->deltaIndexSrc =
+      makeFileSrc(fileSrcPrefix, AW_FM_DELTA_INDEX_SUFFIX);
+  newIndex->compactingIndexSrc =
+      makeFileSrc(fileSrcPrefix, AW_FM_COMPACTING_INDEX_SUFFIX);
+  newIndex->mainIndexSrc = makeFileSrc(fileSrcPrefix, AW_FM_MAIN_INDEX_SUFFIX);
+  struct AwFmSharedIndex *main = createSharedIndex(mainIndex, 1);
+  if (newIndex->deltaFastaSrc == NULL || newIndex->deltaIndexSrc == NULL ||
+      newIndex->compactingIndexSrc == NULL || newIndex->mainIndexSrc == NULL ||
+      main == NULL) {
+    if (main != NULL) {
+      free(main->segments);
+      free(main);
+    }
+    free(newIndex->deltaFastaSrc);
+    free(newIndex->deltaIndexSrc);
+    free(newIndex->compactingIndexSrc);
+    free(newIndex->mainIndexSrc);
+    free(newIndex);
+    return AwFmAllocationFailure;
+  }
+  main->segments[0] = (struct AwFmDeltaSegment){
+      .indexStart = 0, .length = mainIndex->bwtLength - 1, .globalStart = 0};
+
+  pthread_mutex_init(&newIndex->snapshotLock, NULL);
+  pthread_mutex_init(&newIndex->appendLock, NULL);
+  if (publishSnapshot(newIndex, main, NULL) != AwFmSuccess) {
+    // the main index stays with the caller.
+    free(main->segments);
+    free(main);
+    awFmDeallocDeltaIndex(newIndex);
+    return AwFmAllocationFailure;
+  }
+  *deltaIndex = newIndex;
+  return AwFmSuccess;
+}
+
+enum AwFmReturnCode
+awFmDeltaIndexAppendSequence(struct AwFmDeltaIndex *_RESTRICT_ const deltaIndex,
+                             const char *_RESTRICT_ const header,
+                             const char *_RESTRICT_ const sequence,
+                             const size_t sequenceLength) {
+  if (deltaIndex == NULL || sequence == NULL) {
+    return AwFmNullPtrError;
+  }
+  if (sequenceLength == 0) {
+    return AwFmNoDatabaseSequenceGiven;
+  }
+
+  const char *headerString = header != NULL ? header : "";
+  struct AwFmDeltaRecord record = {
+      .header = malloc(strlen(headerString) + 1),
+      .sequence = malloc(sequenceLength),
+      .sequenceLength = sequenceLength};
+  if (record.header == NULL || record.sequence == NULL) {
+    free(record.header);
+    free(record.sequence);
+    return AwFmAllocationFailure;
+  }
+  strcpy(record.header, headerString);
+  memcpy(record.sequence, sequence, sequenceLength);
+
+  pthread_mutex_lock(&deltaIndex->appendLock);
+  if (deltaIndex->numRecords == deltaIndex->recordCapacity) {
+    const size_t newCapacity =
+        deltaIndex->recordCapacity != 0 ? deltaIndex->recordCapacity * 2 : 16;
+    struct AwFmDeltaRecord *newRecords = realloc(
+        deltaIndex->records, newCapacity * sizeof(struct AwFmDeltaRecord));
+    if (newRecords == NULL) {
+      pthread_mutex_unlock(&deltaIndex->appendLock);
+      free(record.header);
+      free(record.sequence);
+      return AwFmAllocationFailure;
+    }
+    deltaIndex->records = newRecords;
+    deltaIndex->recordCapacity = newCapacity;
+  }
+  deltaIndex->records[deltaIndex->numRecords++] = record;
+
+  // the main index can only change under the append lock, so it's safe to
+  // read it outside the snapshot lock.
+  enum AwFmReturnCode returnCode =
+      rebuildDelta(deltaIndex, deltaIndex->snapshot->main, 0,
+                   deltaIndex->recordsGlobalStart);
+  if (returnCode != AwFmSuccess) {
+    deltaIndex->numRecords--;
+    free(record.header);
+    free(record.sequence);
+  }
+  pthread_mutex_unlock(&deltaIndex->appendLock);
+  return returnCode;
+}
+
+struct AwFmCompactionJob {
+  struct AwFmDeltaIndex *deltaIndex;
+  struct AwFmDeltaSnapshot *snapshot;
+  size_t numRecords;
+};
+
+// merges the snapshot's delta into its main index, then swaps in the merged
+// index along with a delta of whatever was appended in the meantime.
+static void *compactionThread(void *jobPtr) {
+  struct AwFmCompactionJob *job = jobPtr;
+  struct AwFmDeltaIndex *deltaIndex = job->deltaIndex;
+  const struct AwFmSharedIndex *main = job->snapshot->main;
+  const struct AwFmSharedIndex *delta = job->snapshot->delta;
+
+  // the delta is merged in first, since only the first index's suffixes are
+  // sorted. Its segment comes first in the merged index.
+  struct AwFmIndex *mergedIndex;
+  enum AwFmReturnCode returnCode =
+      awFmMergeIndices(&mergedIndex, &deltaIndex->config, delta->index,
+                       main->index, deltaIndex->compactingIndexSrc,
+                       &deltaIndex->buildOptions);
+  struct AwFmSharedIndex *merged = NULL;
+  if (awFmReturnCodeIsSuccess(returnCode)) {
+    merged = createSharedIndex(mergedIndex, main->numSegments + 1);
+    if (merged == NULL) {
+      awFmDeallocIndex(mergedIndex);
+      returnCode = AwFmAllocationFailure;
+    }
+  }
+  if (merged != NULL) {
+    const uint64_t deltaLength = delta->segments[0].length;
+    merged->segments[0] = delta->segments[0];
+    for (size_t i = 0; i < main->numSegments; i++) {
+      merged->segments[i + 1] = main->segments[i];
+      merged->segments[i + 1].indexStart += deltaLength;
+    }
+  } else {
+    remove(deltaIndex->compactingIndexSrc);
+  }
+
+  pthread_mutex_lock(&deltaIndex->appendLock);
+  if (merged != NULL) {
+    // the records appended since the compaction started become the new delta.
+    const size_t numCompacted = job->numRecords;
+    const uint64_t compactedLength = delta->segments[0].length;
+    returnCode =
+        rebuildDelta(deltaIndex, merged, numCompacted,
+                     deltaIndex->recordsGlobalStart + compactedLength);
+    if (returnCode == AwFmSuccess) {
+      for (size_t i = 0; i < numCompacted; i++) {
+        free(deltaIndex->records[i].header);
+        free(deltaIndex->records[i].sequence);
+      }
+      memmove(deltaIndex->records, deltaIndex->records + numCompacted,
+              (deltaIndex->numRecords - numCompacted) *
+                  sizeof(struct AwFmDeltaRecord));
+      deltaIndex->numRecords -= numCompacted;
+      deltaIndex->recordsGlobalStart += compactedLength;
+      // searches still using the previous main index file keep it open, so
+      // it can be replaced right away.
+      if (rename(deltaIndex->compactingIndexSrc, deltaIndex->mainIndexSrc) !=
+          0) {
+        returnCode = AwFmFileWriteFail;
+      }
+    } else {
+      // the records stay in the delta, to be compacted next time.
+      deallocSharedIndex(merged);
+      remove(deltaIndex->compactingIndexSrc);
+    }
+  }
+  deltaIndex->compactionReturnCode = returnCode;
+  deltaIndex->compactionRunning = false;
+  pthread_mutex_unlock(&deltaIndex->appendLock);
+
+  releaseSnapshot(deltaIndex, job->snapshot);
+  free(job);
+  return NULL;
+}
+
+enum AwFmReturnCode awFmDeltaIndexStartCompaction(
+    struct AwFmDeltaIndex *_RESTRICT_ const deltaIndex) {
+  if (deltaIndex == NULL) {
+    return AwFmNullPtrError;
+  }
+  pthread_mutex_lock(&deltaIndex->appendLock);
+  if (deltaIndex->compactionRunning || deltaIndex->numRecords == 0) {
+    pthread_mutex_unlock(&deltaIndex->appendLock);
+    return AwFmSuccess;
+  }
+  // the previous compaction is done with the append lock, so it can't be
+  // waiting on it.
+  if (deltaIndex->compactionNeedsJoin) {
+    pthread_join(deltaIndex->compactionThread, NULL);
+    deltaIndex->compactionNeedsJoin = false;
+  }
+
+  struct AwFmCompactionJob *job = malloc(sizeof(struct AwFmCompactionJob));
+  if (job == NULL) {
+    pthread_mutex_unlock(&deltaIndex->appendLock);
+    return AwFmAllocationFailure;
+  }
+  // under the append lock, the snapshot's delta holds every record.
+  job->deltaIndex = deltaIndex;
+  job->snapshot = acquireSnapshot(deltaIndex);
+  job->numRecords = deltaIndex->numRecords;
+  deltaIndex->compactionRunning = true;
+  if (pthread_create(&deltaIndex->compactionThread, NULL, compactionThread,
+                     job) != 0) {
+    deltaIndex->compactionRunning = false;
+    pthread_mutex_unlock(&deltaIndex->appendLock);
+    releaseSnapshot(deltaIndex, job->snapshot);
+    free(job);
+    return AwFmAllocationFailure;
+  }
+  deltaIndex->compactionNeedsJoin = true;
+  pthread_mutex_unlock(&deltaIndex->appendLock);
+  return AwFmSuccess;
+}
+
+enum AwFmReturnCode awFmDeltaIndexWaitForCompaction(
+    struct AwFmDeltaIndex *_RESTRICT_ const deltaIndex) {
+  if (deltaIndex == NULL) {
+    return AwFmNullPtrError;
+  }
+  pthread_mutex_lock(&deltaIndex->appendLock);
+  const bool needsJoin = deltaIndex->compactionNeedsJoin;
+  const pthread_t thread = deltaIndex->compactionThread;
+  deltaIndex->compactionNeedsJoin = false;
+  pthread_mutex_unlock(&deltaIndex->appendLock);
+
+  // joined outside the lock, which the compaction needs to finish.
+  if (needsJoin) {
+    pthread_join(thread, NULL);
+  }
+  pthread_mutex_lock(&deltaIndex->appendLock);
+  const enum AwFmReturnCode returnCode = deltaIndex->compactionReturnCode;
+  pthread_mutex_unlock(&deltaIndex->appendLock);
+  return returnCode;
+}
+
+// true if the hit runs past the end of the sequence it starts in.
+static bool hitSpansSequences(const struct AwFmIndex *_RESTRICT_ const index,
+                              const uint64_t position,
+                              const uint64_t hitLength) {
+  if (index->fastaVector == NULL) {
+    return false;
+  }
+  size_t sequenceNumber;
+  size_t localPosition;
+  if (awFmGetLocalSequencePositionFromIndexPosition(
+          index, position, &sequenceNumber, &localPosition) != AwFmSuccess) {
+    return true;
+  }
+  const struct FastaVectorMetadata *metadata =
+      index->fastaVector->metadata.data;
+  const size_t sequenceStart =
+      sequenceNumber != 0 ? metadata[sequenceNumber - 1].sequenceEndPosition
+                          : 0;
+  const size_t sequenceLength =
+      metadata[sequenceNumber].sequenceEndPosition - sequenceStart;
+  return localPosition + hitLength > sequenceLength;
+}
+
+static uint64_t
+toGlobalPosition(const struct AwFmSharedIndex *_RESTRICT_ const shared,
+                 const uint64_t position) {
+  // there's a segment per compaction, so a linear scan is plenty.
+  size_t segment = shared->numSegments - 1;
+  while (shared->segments[segment].indexStart > position) {
+    segment--;
+  }
+  return shared->segments[segment].globalStart +
+         (position - shared->segments[segment].indexStart);
+}
+
+// converts each hit to global coordinates, dropping the ones that span two
+// sequences. Those only exist because the index's sequences are stored
+// back-to-back, and which sequences are adjacent changes with each compaction.
+static void
+convertHitsToGlobal(const struct AwFmSharedIndex *_RESTRICT_ const shared,
+                    struct AwFmKmerSearchData *_RESTRICT_ const searchData) {
+  uint32_t numKept = 0;
+  for (uint32_t i = 0; i < searchData->count; i++) {
+    const uint64_t position = searchData->positionList[i];
+    if (!hitSpansSequences(shared->index, position, searchData->kmerLength)) {
+      searchData->positionList[numKept++] = toGlobalPosition(shared, position);
+    }
+  }
+  searchData->count = numKept;
+}
+
+static bool appendHits(struct AwFmKmerSearchData *_RESTRICT_ const searchData,
+                       const struct AwFmKmerSearchData *_RESTRICT_ const hits) {
+  const size_t newCount = (size_t)searchData->count + hits->count;
+  if (newCount > searchData->capacity) {
+    uint64_t *newPositionList =
+        realloc(searchData->positionList, newCount * sizeof(uint64_t));
+    if (newPositionList == NULL) {
+      return false;
+    }
+    searchData->positionList = newPositionList;
+    searchData->capacity = newCount;
+  }
+  memcpy(searchData->positionList + searchData->count, hits->positionList,
+         hits->count * sizeof(uint64_t));
+  searchData->count = newCount;
+  return true;
+}
+
+enum AwFmReturnCode awFmDeltaIndexParallelSearchLocate(
+    struct AwFmDeltaIndex *_RESTRICT_ const deltaIndex,
+    struct AwFmKmerSearchList *_RESTRICT_ const searchList,
+    uint32_t numThreads) {
+  if (deltaIndex == NULL || searchList == NULL) {
+    return AwFmNullPtrError;
+  }
+  struct AwFmDeltaSnapshot *snapshot = acquireSnapshot(deltaIndex);
+  enum AwFmReturnCode returnCode =
+      awFmParallelSearchLocate(snapshot->main->index, searchList, numThreads);
+  // the position lists of a failed locate can't be trusted, so they aren't
+  // converted.
+  if (awFmReturnCodeIsFailure(returnCode)) {
+    releaseSnapshot(deltaIndex, snapshot);
+    return returnCode;
+  }
+  for (size_t i = 0; i < searchList->count; i++) {
+    convertHitsToGlobal(snapshot->main, &searchList->kmerSearchData[i]);
+  }
+
+  if (snapshot->delta != NULL && searchList->count != 0) {
+    struct AwFmKmerSearchList *deltaList =
+        awFmCreateKmerSearchList(searchList->count);
+    if (deltaList == NULL) {
+      releaseSnapshot(deltaIndex, snapshot);
+      return AwFmAllocationFailure;
+    }
+    deltaList->count = searchList->count;
+    for (size_t i = 0; i < searchList->count; i++) {
+      deltaList->kmerSearchData[i].kmerString =
+          searchList->kmerSearchData[i].kmerString;
+      deltaList->kmerSearchData[i].kmerLength =
+          searchList->kmerSearchData[i].kmerLength;
+    }
+    returnCode =
+        awFmParallelSearchLocate(snapshot->delta->index, deltaList, numThreads);
+    for (size_t i = 0;
+         awFmReturnCodeIsSuccess(returnCode) && i < searchList->count; i++) {
+      convertHitsToGlobal(snapshot->delta, &deltaList->kmerSearchData[i]);
+      if (!appendHits(&searchList->kmerSearchData[i],
+                      &deltaList->kmerSearchData[i])) {
+        returnCode = AwFmAllocationFailure;
+      }
+    }
+    awFmDeallocKmerSearchList(deltaList);
+  }
+  releaseSnapshot(deltaIndex, snapshot);
+  return returnCode;
+}
+
+uint64_t awFmDeltaIndexGetSequenceLength(
+    struct AwFmDeltaIndex *_RESTRICT_ const deltaIndex) {
+  pthread_mutex_lock(&deltaIndex->appendLock);
+  uint64_t length = deltaIndex->recordsGlobalStart;
+  for (size_t i = 0; i < deltaIndex->numRecords; i++) {
+    length += deltaIndex->records[i].sequenceLength;
+  }
+  pthread_mutex_unlock(&deltaIndex->appendLock);
+  return length;
+}
+
+void awFmDeallocDeltaIndex(struct AwFmDeltaIndex *deltaIndex) {
+  if (deltaIndex == NULL) {
+    return;
+  }
+  awFmDeltaIndexWaitForCompaction(deltaIndex);
+  if (deltaIndex->snapshot != NULL) {
+    releaseSnapshot(deltaIndex, deltaIndex->snapshot);
+  }
+  for (size_t i = 0; i < deltaIndex->numRecords; i++) {
+    free(deltaIndex->records[i].header);
+    free(deltaIndex->records[i].sequence);
+  }
+  free(deltaIndex->records);
+  pthread_mutex_destroy(&deltaIndex->snapshotLock);
+  pthread_mutex_destroy(&deltaIndex->appendLock);
+  free(deltaIndex->deltaFastaSrc);
+  free(deltaIndex->deltaIndexSrc);
+  free(deltaIndex->compactingIndexSrc);
+  free(deltaIndex->mainIndexSrc);
+  free(deltaIndex);
+}
@@ -0,0 +1,79 @@
+#include "AwFmDiskBwt.h"
+#include <string.h>
+#include "AwFmFile.h"
+#include "AwFmPageCache.h"
+
+// BWT blocks are read from the file in large chunks, so a miss pulls in the
+// neighborhood of the block, and sequential device reads stay efficient.
+#define AW_FM_DISK_BWT_CHUNK_SIZE (1024 * 1024)
+#define AW_FM_DISK_BWT_DEFAULT_CACHE_CAPACITY (256 * (size_t)1024 * 1024)
+
+enum AwFmReturnCode
+awFmDiskBwtInit(struct AwFmIndex *_RESTRICT_ const index,
+                size_t capacityInBytes) {
+  if (capacityInBytes == 0) {
+    capacityInBytes = AW_FM_DISK_BWT_DEFAULT_CACHE_CAPACITY;
+  } else if (capacityInBytes < AW_FM_DISK_BWT_CHUNK_SIZE) {
+    capacityInBytes = AW_FM_DISK_BWT_CHUNK_SIZE;
+  }
+
+  struct AwFmPageCache *cache = awFmPageCacheCreate(
+      index->fileDescriptor, AW_FM_DISK_BWT_CHUNK_SIZE, capacityInBytes);
+  if (cache == NULL) {
+    return AwFmAllocationFailure;
+  }
+  awFmPageCacheDealloc(index->bwtCache);
+  index->bwtCache = cache;
+  return AwFmSuccess;
+}
+
+enum AwFmReturnCode
+awFmDiskBwtReadBlock(const struct AwFmIndex *_RESTRICT_ const index,
+                     const uint64_t blockIndex,
+                     void *_RESTRICT_ const destination) {
+  const size_t blockByteWidth = awFmGetBwtBlockByteWidth(index);
+  const size_t blockFileOffset =
+      awFmGetBwtFileOffset(index) + blockIndex * blockByteWidth;
+  const enum AwFmReturnCode returnCode = awFmPageCacheRead(
+      index->bwtCache, blockFileOffset, destination, blockByteWidth);
+  if (__builtin_expect(returnCode != AwFmFileReadOkay, 0)) {
+    memset(destination, 0, blockByteWidth);
+  }
+  return returnCode;
+}
+
+uint64_t
+awFmDiskBwtReadFailures(const struct AwFmIndex *_RESTRICT_ const index) {
+  if (__builtin_expect(index->bwtCache == NULL, 1)) {
+    return 0;
+  }
+  return awFmPageCacheGetReadFailures(index->bwtCache);
+}
+
+enum AwFmReturnCode
+awFmDiskBwtCheckReads(const struct AwFmIndex *_RESTRICT_ const index,
+                      const uint64_t readFailuresBefore,
+                      const enum AwFmReturnCode returnCode) {
+  if (awFmReturnCodeIsFailure(returnCode) ||
+      awFmDiskBwtReadFailures(index) == readFailuresBefore) {
+    return returnCode;
+  }
+  return AwFmFileReadFail;
+}
+
+void awFmDiskBwtPrefetch(const struct AwFmIndex *_RESTRICT_ const index,
+                         const uint64_t blockIndex) {
+  const size_t blockFileOffset = awFmGetBwtFileOffset(index) +
+                                 blockIndex * awFmGetBwtBlockByteWidth(index);
+  awFmPageCachePrefetch(index->bwtCache, blockFileOffset);
+}
+
+void awFmGetBwtCacheStatistics(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmCacheStatistics *_RESTRICT_ const statistics) {
+  if (index->bwtCache == NULL) {
+    memset(statistics, 0, sizeof(struct AwFmCacheStatistics));
+    return;
+  }
+  awFmPageCacheGetStatistics(index->bwtCache, statistics);
+}
@@ -0,0 +1,84 @@
+#ifndef AW_FM_DISK_BWT_H
+#define AW_FM_DISK_BWT_H
+
+#include <stdint.h>
+#include "AwFmIndex.h"
+
+/*
+ * Function:  awFmDiskBwtInit
+ * --------------------
+ * Sets up the block cache for an index whose BWT was left in the index file.
+ * Afterwards, the search functions read BWT blocks through the cache instead
+ * of from the in-memory block list, which must be NULL.
+ *
+ *  Inputs:
+ *    index:            Index with an open file descriptor and no block list.
+ *    capacityInBytes:  Memory to use for cached BWT chunks. 0 selects the
+ *      default capacity, and anything smaller than one chunk is rounded up.
+ *
+ *  Returns:
+ *    AwFmSuccess, or AwFmAllocationFailure if the cache could not be created.
+ */
+enum AwFmReturnCode
+awFmDiskBwtInit(struct AwFmIndex *_RESTRICT_ const index,
+                size_t capacityInBytes);
+
+/*
+ * Function:  awFmDiskBwtReadBlock
+ * --------------------
+ * Copies the BWT block at the given index into the destination, reading its
+ * chunk from the index file if it isn't cached. If the file can't be read,
+ * the destination is zeroed so the caller never reads uninitialized memory,
+ * and the failure is counted in the cache, where awFmDiskBwtCheckReads
+ * turns it into the return code of the search that made the read.
+ *
+ *  Inputs:
+ *    index:        Index whose BWT is on disk.
+ *    blockIndex:   Index of the block in the BWT.
+ *    destination:  Buffer the size of one of the index's blocks.
+ *
+ *  Returns:
+ *    AwFmFileReadOkay on success, or AwFmFileReadFail if the block couldn't
+ *      be read.
+ */
+enum AwFmReturnCode
+awFmDiskBwtReadBlock(const struct AwFmIndex *_RESTRICT_ const index,
+                     const uint64_t blockIndex,
+                     void *_RESTRICT_ const destination);
+
+/*
+ * Function:  awFmDiskBwtReadFailures
+ * --------------------
+ * Returns the number of BWT block reads from the index file that have failed
+ * so far, or 0 if the index's BWT is in memory. Searches take this count
+ * before they start, and hand it to awFmDiskBwtCheckReads when they finish.
+ */
+uint64_t
+awFmDiskBwtReadFailures(const struct AwFmIndex *_RESTRICT_ const index);
+
+/*
+ * Function:  awFmDiskBwtCheckReads
+ * --------------------
+ * Returns the code a search should return, given the code it would return
+ * otherwise. If the search succeeded but a block read failed since
+ * readFailuresBefore was taken, its ranges were computed from a zeroed
+ * block, so AwFmFileReadFail is returned instead. Reads that failed in
+ * concurrent searches of the same index are also counted, so those report
+ * the failure too.
+ */
+enum AwFmReturnCode
+awFmDiskBwtCheckReads(const struct AwFmIndex *_RESTRICT_ const index,
+                      const uint64_t readFailuresBefore,
+                      const enum AwFmReturnCode returnCode);
+
+/*
+ * Function:  awFmDiskBwtPrefetch
+ * --------------------
+ * Disk-backed equivalent of awFmBlockPrefetch. Asks the operating system to
+ * start reading the chunk containing the block in the background, if that
+ * chunk isn't already cached.
+ */
+void awFmDiskBwtPrefetch(const struct AwFmIndex *_RESTRICT_ const index,
+                         const uint64_t blockIndex);
+
+#endif /* end of include guard: AW_FM_DISK_BWT_H */
@@ -0,0 +1,232 @@
+#include "AwFmFastaReader.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "AwFmLetter.h"
+
+// starting capacity of the residue buffer when the input's size isn't known,
+// like when reading from a pipe.
+#define AW_FM_FASTA_INITIAL_SEQUENCE_CAPACITY (16 * 1024 * 1024)
+
+// parsing state carried from one chunk of the file to the next.
+struct AwFmFastaParser {
+  struct FastaVector *fastaVector;
+  uint8_t *sequence;
+  size_t sequenceLength;
+  size_t sequenceCapacity;
+  enum AwFmAlphabetType alphabetType;
+  bool sanitize;
+  bool atLineStart;
+  bool inHeader;
+  // true once a header or residue of a sequence with no metadata yet is seen.
+  bool inRecord;
+  // header length when the current header line started.
+  size_t headerLineStart;
+};
+
+static bool appendHeader(struct FastaVectorString *_RESTRICT_ const header,
+                         const uint8_t *_RESTRICT_ const bytes,
+                         const size_t length) {
+  if (header->count + length > header->capacity) {
+    size_t newCapacity = header->capacity != 0 ? header->capacity * 2 : 256;
+    if (newCapacity < header->count + length) {
+      newCapacity = header->count + length;
+    }
+    char *newCharData = realloc(header->charData, newCapacity);
+    if (newCharData == NULL) {
+      return false;
+    }
+    header->charData = newCharData;
+    header->capacity = newCapacity;
+  }
+  memcpy(header->charData + header->count, bytes, length);
+  header->count += length;
+  return true;
+}
+
+// drops the carriage return of a header line that ended in "\r\n".
+static void endHeaderLine(struct AwFmFastaParser *_RESTRICT_ const parser) {
+  struct FastaVectorString *header = &parser->fastaVector->header;
+  if (header->count > parser->headerLineStart &&
+      header->charData[header->count - 1] == '\r') {
+    header->count--;
+  }
+  parser->inHeader = false;
+}
+
+// adds the metadata that marks the end of the current sequence.
+static bool endRecord(struct AwFmFastaParser *_RESTRICT_ const parser) {
+  struct FastaVectorMetadataVector *metadata = &parser->fastaVector->metadata;
+  if (metadata->count == metadata->capacity) {
+    const size_t newCapacity =
+        metadata->capacity != 0 ? metadata->capacity * 2 : 16;
+    struct FastaVectorMetadata *newData = realloc(
+        metadata->data, newCapacity * sizeof(struct FastaVectorMetadata));
+    if (newData == NULL) {
+      return false;
+    }
+    metadata->data = newData;
+    metadata->capacity = newCapacity;
+  }
+  metadata->data[metadata->count].headerEndPosition =
+      parser->fastaVector->header.count;
+  metadata->data[metadata->count].sequenceEndPosition = parser->sequenceLength;
+  metadata->count++;
+  parser->inRecord = false;
+  return true;
+}
+
+// parses one chunk of the file. The residue buffer must have room for every
+// byte in the chunk.
+static enum AwFmReturnCode
+parseChunk(struct AwFmFastaParser *_RESTRICT_ const parser,
+           const uint8_t *_RESTRICT_ const chunk, const size_t chunkLength) {
+  const uint8_t *position = chunk;
+  const uint8_t *const chunkEnd = chunk + chunkLength;
+
+  while (position < chunkEnd) {
+    if (parser->atLineStart && *position == '>') {
+      if (parser->inRecord && !endRecord(parser)) {
+        return AwFmAllocationFailure;
+      }
+      parser->inHeader = true;
+      parser->inRecord = true;
+      parser->headerLineStart = parser->fastaVector->header.count;
+      position++;
+    }
+
+    const uint8_t *lineEnd = memchr(position, '\n', chunkEnd - position);
+    const uint8_t *segmentEnd = lineEnd != NULL ? lineEnd : chunkEnd;
+    if (parser->inHeader) {
+      if (!appendHeader(&parser->fastaVector->header, position,
+                        segmentEnd - position)) {
+        return AwFmAllocationFailure;
+      }
+      if (lineEnd != NULL) {
+        endHeaderLine(parser);
+      }
+    } else {
+      size_t segmentLength = segmentEnd - position;
+      if (segmentLength != 0 && segmentEnd[-1] == '\r') {
+        segmentLength--;
+      }
+      if (segmentLength != 0) {
+        uint8_t *destination = parser->sequence + parser->sequenceLength;
+        if (parser->sanitize) {
+          awFmSanitizeSequence(position, destination, segmentLength,
+                               parser->alphabetType);
+        } else {
+          memcpy(destination, position, segmentLength);
+        }
+        parser->sequenceLength += segmentLength;
+        parser->inRecord = true;
+      }
+    }
+
+    parser->atLineStart = lineEnd != NULL;
+    position = segmentEnd + (lineEnd != NULL);
+  }
+  return AwFmSuccess;
+}
+
+static bool reserveSequence(struct AwFmFastaParser *_RESTRICT_ const parser,
+                            const size_t requiredCapacity) {
+  if (__builtin_expect(requiredCapacity <= parser->sequenceCapacity, 1)) {
+    return true;
+  }
+  size_t newCapacity = parser->sequenceCapacity * 2;
+  if (newCapacity < requiredCapacity) {
+    newCapacity = requiredCapacity;
+  }
+  uint8_t *newSequence = realloc(parser->sequence, newCapacity);
+  if (newSequence == NULL) {
+    return false;
+  }
+  parser->sequence = newSequence;
+  parser->sequenceCapacity = newCapacity;
+  return true;
+}
+
+enum AwFmReturnCode
+awFmReadFastaForIndex(const char *_RESTRICT_ const fastaSrc,
+                      const enum AwFmAlphabetType alphabetType,
+                      const bool sanitize,
+                      struct FastaVector *_RESTRICT_ const fastaVector,
+                      uint8_t **_RESTRICT_ const sequence,
+                      size_t *_RESTRICT_ const sequenceLength) {
+  const int fileDescriptor = open(fastaSrc, O_RDONLY);
+  if (fileDescriptor < 0) {
+    return AwFmFileOpenFail;
+  }
+
+  // a regular file can't have more residues than bytes, so its buffer is
+  // allocated once. Pipes grow theirs as they're read.
+  size_t initialCapacity = AW_FM_FASTA_INITIAL_SEQUENCE_CAPACITY;
+  struct stat fileStat;
+  if (fstat(fileDescriptor, &fileStat) == 0 && S_ISREG(fileStat.st_mode)) {
+    initialCapacity = (size_t)fileStat.st_size + 1;
+  }
+
+  struct AwFmFastaParser parser = {.fastaVector = fastaVector,
+                                   .sequence = malloc(initialCapacity),
+                                   .sequenceLength = 0,
+                                   .sequenceCapacity = initialCapacity,
+                                   .alphabetType = alphabetType,
+                                   .sanitize = sanitize,
+                                   .atLineStart = true,
+                                   .inHeader = false,
+                                   .inRecord = false,
+                                   .headerLineStart = 0};
+  uint8_t *chunk = malloc(AW_FM_FASTA_READ_CHUNK_SIZE);
+  enum AwFmReturnCode returnCode =
+      (parser.sequence != NULL && chunk != NULL) ? AwFmSuccess
+                                                 : AwFmAllocationFailure;
+
+  while (returnCode == AwFmSuccess) {
+    const ssize_t bytesRead =
+        read(fileDescriptor, chunk, AW_FM_FASTA_READ_CHUNK_SIZE);
+    if (bytesRead == 0) {
+      break;
+    } else if (bytesRead < 0) {
+      if (errno != EINTR) {
+        returnCode = AwFmFileReadFail;
+      }
+    } else if (!reserveSequence(&parser,
+                                parser.sequenceLength + bytesRead + 1)) {
+      returnCode = AwFmAllocationFailure;
+    } else {
+      returnCode = parseChunk(&parser, chunk, bytesRead);
+    }
+  }
+  free(chunk);
+  close(fileDescriptor);
+
+  if (returnCode == AwFmSuccess) {
+    if (parser.inHeader) {
+      endHeaderLine(&parser);
+    }
+    if (parser.inRecord && !endRecord(&parser)) {
+      returnCode = AwFmAllocationFailure;
+    }
+  }
+  if (returnCode != AwFmSuccess) {
+    free(parser.sequence);
+    return returnCode;
+  }
+
+  // headers and line breaks leave some of the buffer unused.
+  if (parser.sequenceCapacity > parser.sequenceLength + 1) {
+    uint8_t *shrunkSequence =
+        realloc(parser.sequence, parser.sequenceLength + 1);
+    if (shrunkSequence != NULL) {
+      parser.sequence = shrunkSequence;
+    }
+  }
+
+  *sequence = parser.sequence;
+  *sequenceLength = parser.sequenceLength;
+  return AwFmSuccess;
+}
@@ -0,0 +1,53 @@
+#ifndef AW_FM_FASTA_READER_H
+#define AW_FM_FASTA_READER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "AwFmIndex.h"
+#include "FastaVector.h"
+
+// size of each read() from the fasta file.
+#define AW_FM_FASTA_READ_CHUNK_SIZE (1024 * 1024)
+
+/*
+ * Function:  awFmReadFastaForIndex
+ * --------------------
+ * Reads a fasta file into a single buffer that the index can be built from,
+ * without first loading the whole file. The file is read in large chunks, so
+ * fastaSrc may also be a pipe or fifo, like /dev/stdin. The residues of every
+ * sequence are concatenated into the output buffer, and the headers and the
+ * sequence boundaries are appended to the fastaVector as they're found, in the
+ * same form that fastaVectorReadFasta() produces. The fastaVector's own
+ * sequence string is left untouched.
+ *
+ * When sanitize is true, each line is sanitized as it's copied, so the buffer
+ * is ready to be sorted once the sentinel is appended. Otherwise, the buffer
+ * holds the original residues, and can be sanitized in place with
+ * awFmSanitizeSequence() once they're no longer needed.
+ *
+ *  Inputs:
+ *    fastaSrc:       Path of the fasta file to read.
+ *    alphabetType:   Alphabet used to sanitize the residues.
+ *    sanitize:       If true, the residues are sanitized as they're read.
+ *    fastaVector:    Initialized FastaVector to add headers and metadata to.
+ *    sequence:       Out-argument set to the new buffer of residues. The buffer
+ *      has room for one more byte after the last residue, for the sentinel.
+ *      The caller takes ownership, and must free() it.
+ *    sequenceLength: Out-argument set to the number of residues read.
+ *
+ *  Returns:
+ *    AwFmSuccess on success.
+ *    AwFmFileOpenFail if the file could not be opened.
+ *    AwFmFileReadFail if reading from the file failed.
+ *    AwFmAllocationFailure if memory could not be allocated.
+ */
+enum AwFmReturnCode
+awFmReadFastaForIndex(const char *_RESTRICT_ const fastaSrc,
+                      const enum AwFmAlphabetType alphabetType,
+                      const bool sanitize,
+                      struct FastaVector *_RESTRICT_ const fastaVector,
+                      uint8_t **_RESTRICT_ const sequence,
+                      size_t *_RESTRICT_ const sequenceLength);
+
+#endif /* end of include guard: AW_FM_FASTA_READER_H */
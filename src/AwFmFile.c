@@ -5,18 +5,46 @@
 #define _XOPEN_SOURCE 500
 
 #include "AwFmFile.h"
+#include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include "AwFmDiskBwt.h"
+#include "AwFmFileWriter.h"
 #include "AwFmIndex.h"
 #include "AwFmIndexStruct.h"
+#include "AwFmLetter.h"
+#include "AwFmPageCache.h"
 #include "AwFmSuffixArray.h"
+#include <omp.h>
+
+// sections of the index file are split into chunks of this size when loading
+// in parallel.
+#define AW_FM_PARALLEL_LOAD_CHUNK_SIZE (16 * 1024 * 1024)
 
 static const uint8_t IndexFileFormatIdHeaderLength = 10;
 static const char IndexFileFormatIdHeader[11] = "AwFmIndex\n\0";
 
+enum AwFmIndexFileSection {
+  AwFmIndexFileSectionBwt = 0,
+  AwFmIndexFileSectionPrefixSums = 1,
+  AwFmIndexFileSectionKmerSeedTable = 2,
+  AwFmIndexFileSectionSuffixArray = 3,
+  AwFmIndexFileSectionFastaVector = 4,
+  AwFmIndexFileSectionCount = 5
+};
+
+struct AwFmFileReadSegment {
+  uint8_t *destination;
+  size_t fileOffset;
+  size_t length;
+  enum AwFmIndexFileSection section;
+  double startTime;
+  double endTime;
+};
+
 enum AwFmReturnCode
 awFmWriteIndexToFile(struct AwFmIndex *_RESTRICT_ const index,
                      const uint8_t *_RESTRICT_ const sequence,
@@ -34,9 +62,6 @@ awFmWriteIndexToFile(struct AwFmIndex *_RESTRICT_ const index,
     return AwFmNullPtrError;
   }
 
-  const bool indexContainsFastaVector = awFmIndexContainsFastaVector(index);
-  const bool storeOriginalSequence = index->config.storeOriginalSequence;
-
   // open the file
   char fileOpenMode[4] = "w+b";
   index->fileHandle = fopen(fileSrc, fileOpenMode);
@@ -45,244 +70,291 @@ awFmWriteIndexToFile(struct AwFmIndex *_RESTRICT_ const index,
     return AwFmFileAlreadyExists;
   }
 
-  // write the header
-  size_t elementsWritten =
-      fwrite(IndexFileFormatIdHeader, sizeof(char),
-             IndexFileFormatIdHeaderLength, index->fileHandle);
-  if (elementsWritten != IndexFileFormatIdHeaderLength) {
-    fclose(index->fileHandle);
-    return AwFmFileWriteFail;
-  }
-
-  // write the config, starting with the version number
-  elementsWritten =
-      fwrite(&index->versionNumber, sizeof(uint32_t), 1, index->fileHandle);
-  if (elementsWritten != 1) {
-    fclose(index->fileHandle);
-    return AwFmFileWriteFail;
-  }
-  // write the config, starting with the version number
-  elementsWritten =
-      fwrite(&index->featureFlags, sizeof(uint32_t), 1, index->fileHandle);
-  if (elementsWritten != 1) {
-    fclose(index->fileHandle);
-    return AwFmFileWriteFail;
-  }
-  elementsWritten = fwrite(&index->config.suffixArrayCompressionRatio,
-                           sizeof(uint8_t), 1, index->fileHandle);
-  if (elementsWritten != 1) {
-    fclose(index->fileHandle);
-    return AwFmFileWriteFail;
-  }
-  elementsWritten = fwrite(&index->config.kmerLengthInSeedTable,
-                           sizeof(uint8_t), 1, index->fileHandle);
-  if (elementsWritten != 1) {
-    fclose(index->fileHandle);
-    return AwFmFileWriteFail;
-  }
-  uint8_t alphabetType = index->config.alphabetType;
-  elementsWritten =
-      fwrite(&alphabetType, sizeof(uint8_t), 1, index->fileHandle);
-  if (elementsWritten != 1) {
-    fclose(index->fileHandle);
-    return AwFmFileWriteFail;
-  }
-  elementsWritten =
-      fwrite(&storeOriginalSequence, sizeof(uint8_t), 1, index->fileHandle);
-  if (elementsWritten != 1) {
-    fclose(index->fileHandle);
-    return AwFmFileWriteFail;
-  }
-
-  // write the bwt length
-  elementsWritten =
-      fwrite(&index->bwtLength, sizeof(uint64_t), 1, index->fileHandle);
-  if (elementsWritten != 1) {
-    fclose(index->fileHandle);
-    return AwFmFileWriteFail;
-  }
-
-  const size_t numBlockInBwt = awFmNumBlocksFromBwtLength(index->bwtLength);
-  const size_t bytesPerBwtBlock =
-      index->config.alphabetType == AwFmAlphabetAmino
-          ? sizeof(struct AwFmAminoBlock)
-          : sizeof(struct AwFmNucleotideBlock);
-
-  elementsWritten = fwrite(index->bwtBlockList.asNucleotide, bytesPerBwtBlock,
-                           numBlockInBwt, index->fileHandle);
-  if (elementsWritten != numBlockInBwt) {
-    fclose(index->fileHandle);
-    return AwFmFileWriteFail;
-  }
-
-  // write the prefix sums table
-  const size_t prefixSumsLength =
-      awFmGetPrefixSumsLength(index->config.alphabetType);
-  elementsWritten = fwrite(index->prefixSums, sizeof(uint64_t),
-                           prefixSumsLength, index->fileHandle);
-  if (elementsWritten != prefixSumsLength) {
-    fclose(index->fileHandle);
-    return AwFmFileWriteFail;
-  }
-
-  // write the kmer seed table
-  const size_t numElementsInKmerSeedTable = awFmGetKmerTableLength(index);
-  elementsWritten = fwrite(index->kmerSeedTable, sizeof(struct AwFmSearchRange),
-                           numElementsInKmerSeedTable, index->fileHandle);
-  if (elementsWritten != numElementsInKmerSeedTable) {
-    fclose(index->fileHandle);
-    return AwFmFileWriteFail;
-  }
-
-  if (storeOriginalSequence) {
-    // write the sequence
-    elementsWritten =
-        fwrite(sequence, sizeof(char), sequenceLength, index->fileHandle);
-    if (elementsWritten != sequenceLength) {
-      fclose(index->fileHandle);
-      return AwFmFileWriteFail;
-    }
-  }
-
-  size_t downsampledSuffixArrayLengthInBytes =
-      index->suffixArray.compressedByteLength;
-  elementsWritten =
-      fwrite(index->suffixArray.values, sizeof(uint8_t),
-             downsampledSuffixArrayLengthInBytes, index->fileHandle);
-  if (elementsWritten != downsampledSuffixArrayLengthInBytes) {
-    fclose(index->fileHandle);
-    return AwFmFileWriteFail;
+  struct AwFmFileWriter *writer = awFmFileWriterCreate(
+      fileno(index->fileHandle), fileSrc, index->useDirectIo);
+  if (writer == NULL) {
+    return AwFmAllocationFailure;
   }
-
-  if (indexContainsFastaVector) {
-    // write the lengths for the header string and the metadata vector
-    const size_t headerStringLength = index->fastaVector->header.count;
-    const size_t fastaVectorMetadataLength = index->fastaVector->metadata.count;
-    size_t headerStringLengthWritten =
-        fwrite(&headerStringLength, sizeof(size_t), 1, index->fileHandle);
-    if (headerStringLengthWritten != 1) {
-      fclose(index->fileHandle);
-      return AwFmFileWriteFail;
-    }
-    size_t fastaVectorMetadataLengthWritten = fwrite(
-        &fastaVectorMetadataLength, sizeof(size_t), 1, index->fileHandle);
-    if (fastaVectorMetadataLengthWritten != 1) {
-      fclose(index->fileHandle);
-      return AwFmFileWriteFail;
-    }
-    size_t headerStringBytesWritten =
-        fwrite(index->fastaVector->header.charData, sizeof(char),
-               headerStringLength, index->fileHandle);
-    if (headerStringBytesWritten != headerStringLength) {
-      fclose(index->fileHandle);
-      return AwFmFileWriteFail;
-    }
-    size_t fastaVectorMetadataElementsWritten = fwrite(
-        index->fastaVector->metadata.data, sizeof(struct FastaVectorMetadata),
-        fastaVectorMetadataLength, index->fileHandle);
-    if (fastaVectorMetadataElementsWritten != fastaVectorMetadataLength) {
-      fclose(index->fileHandle);
-      return AwFmFileWriteFail;
-    }
+  enum AwFmReturnCode returnCode = awFmWriteIndexBwtSections(index, writer);
+  if (returnCode == AwFmSuccess) {
+    returnCode = awFmWriteIndexRemainingSections(index, writer, sequence,
+                                                 sequenceLength);
   }
-
-  fflush(index->fileHandle);
+  const enum AwFmReturnCode writeReturnCode =
+      awFmFileWriterFinish(writer, NULL, NULL);
   index->fileDescriptor = fileno(index->fileHandle);
-
-  return AwFmFileWriteOkay;
+  return returnCode == AwFmSuccess ? writeReturnCode : returnCode;
 }
 
 enum AwFmReturnCode
-awFmReadIndexFromFile(struct AwFmIndex *_RESTRICT_ *_RESTRICT_ index,
-                      const char *fileSrc, const bool keepSuffixArrayInMemory) {
+awFmWriteIndexBwtSections(const struct AwFmIndex *_RESTRICT_ const index,
+                          struct AwFmFileWriter *_RESTRICT_ const writer) {
+  // the file header: format id, config, and the bwt length, which fill the
+  // file up to the bwt.
+  uint8_t header[64];
+  const uint8_t configBytes[4] = {index->config.suffixArrayCompressionRatio,
+                                  index->config.kmerLengthInSeedTable,
+                                  index->config.alphabetType,
+                                  index->config.storeOriginalSequence};
+  uint8_t *headerPosition = header;
+  memcpy(headerPosition, IndexFileFormatIdHeader,
+         IndexFileFormatIdHeaderLength);
+  headerPosition += IndexFileFormatIdHeaderLength;
+  memcpy(headerPosition, &index->versionNumber, sizeof(uint32_t));
+  headerPosition += sizeof(uint32_t);
+  memcpy(headerPosition, &index->featureFlags, sizeof(uint32_t));
+  headerPosition += sizeof(uint32_t);
+  memcpy(headerPosition, configBytes, sizeof(configBytes));
+  headerPosition += sizeof(configBytes);
+  memcpy(headerPosition, &index->bwtLength, sizeof(uint64_t));
+  headerPosition += sizeof(uint64_t);
+  if (index->config.alphabetType == AwFmAlphabetReducedAmino) {
+    memcpy(headerPosition, index->reducedAminoLetterMap,
+           AW_FM_AMINO_CARDINALITY);
+    headerPosition += AW_FM_AMINO_CARDINALITY;
+  }
+
+  enum AwFmReturnCode returnCode =
+      awFmFileWriterSubmitCopy(writer, header, headerPosition - header, 0);
+  if (returnCode != AwFmSuccess) {
+    return returnCode;
+  }
+
+  const size_t bwtFileOffset = awFmGetBwtFileOffset(index);
+  const size_t bwtByteLength = awFmNumBlocksFromBwtLength(index->bwtLength) *
+                               awFmGetBwtBlockByteWidth(index);
+  returnCode = awFmFileWriterSubmit(writer, index->bwtBlockList.asNucleotide,
+                                    bwtByteLength, bwtFileOffset);
+  if (returnCode != AwFmSuccess) {
+    return returnCode;
+  }
+
+  const size_t prefixSumsByteLength =
+      awFmGetPrefixSumsLength(index->config.alphabetType) * sizeof(uint64_t);
+  return awFmFileWriterSubmit(writer, index->prefixSums, prefixSumsByteLength,
+                              bwtFileOffset + bwtByteLength);
+}
 
-  if (__builtin_expect(fileSrc == NULL, 0)) {
-    return AwFmNoFileSrcGiven;
+enum AwFmReturnCode awFmWriteIndexRemainingSections(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmFileWriter *_RESTRICT_ const writer,
+    const uint8_t *_RESTRICT_ const sequence, const uint64_t sequenceLength) {
+  const size_t sequenceFileOffset = awFmGetSequenceFileOffset(index);
+  const size_t kmerSeedTableByteLength =
+      awFmGetKmerTableLength(index) * sizeof(struct AwFmSearchRange);
+  enum AwFmReturnCode returnCode = awFmFileWriterSubmit(
+      writer, index->kmerSeedTable, kmerSeedTableByteLength,
+      sequenceFileOffset - kmerSeedTableByteLength);
+  if (returnCode != AwFmSuccess) {
+    return returnCode;
+  }
+
+  if (index->config.storeOriginalSequence && sequence != NULL) {
+    returnCode = awFmFileWriterSubmit(writer, sequence, sequenceLength,
+                                      sequenceFileOffset);
+    if (returnCode != AwFmSuccess) {
+      return returnCode;
+    }
   }
 
-  FILE *fileHandle = fopen(fileSrc, "r");
-  if (!fileHandle) {
-    return AwFmFileOpenFail;
+  if (index->suffixArray.values != NULL) {
+    returnCode = awFmFileWriterSubmit(writer, index->suffixArray.values,
+                                      index->suffixArray.compressedByteLength,
+                                      awFmGetSuffixArrayFileOffset(index));
+    if (returnCode != AwFmSuccess) {
+      return returnCode;
+    }
   }
 
-  // create a local-scope pointer for the index, when we're done we'll set the
-  // index out-arg to this pointer.
-  struct AwFmIndex *_RESTRICT_ indexData;
+  if (awFmIndexContainsFastaVector(index)) {
+    // the lengths of the header string and the metadata vector, then their
+    // contents.
+    const size_t fastaVectorFileOffset = awFmGetFastaVectorFileOffset(index);
+    const size_t lengths[2] = {index->fastaVector->header.count,
+                               index->fastaVector->metadata.count};
+    returnCode = awFmFileWriterSubmitCopy(writer, lengths, sizeof(lengths),
+                                          fastaVectorFileOffset);
+    if (returnCode != AwFmSuccess) {
+      return returnCode;
+    }
+    returnCode = awFmFileWriterSubmit(
+        writer, index->fastaVector->header.charData, lengths[0],
+        fastaVectorFileOffset + sizeof(lengths));
+    if (returnCode != AwFmSuccess) {
+      return returnCode;
+    }
+    return awFmFileWriterSubmit(
+        writer, index->fastaVector->metadata.data,
+        lengths[1] * sizeof(struct FastaVectorMetadata),
+        fastaVectorFileOffset + sizeof(lengths) + lengths[0]);
+  }
+  return AwFmSuccess;
+}
 
+static enum AwFmReturnCode
+awFmReadIndexFileHeader(FILE *fileHandle,
+                        struct AwFmIndexConfiguration *_RESTRICT_ const config,
+                        uint32_t *_RESTRICT_ const versionNumber,
+                        uint32_t *_RESTRICT_ const featureFlags,
+                        uint64_t *_RESTRICT_ const bwtLength,
+                        uint8_t *_RESTRICT_ const reducedAminoLetterMap) {
   // read the header, and check to make sure it matches
   char headerBuffer[IndexFileFormatIdHeaderLength + 1];
   size_t elementsRead = fread(headerBuffer, sizeof(char),
                               IndexFileFormatIdHeaderLength, fileHandle);
   if (elementsRead != IndexFileFormatIdHeaderLength) {
-    fclose(fileHandle);
     return AwFmFileReadFail;
   }
   if (strncmp(IndexFileFormatIdHeader, headerBuffer,
               IndexFileFormatIdHeaderLength) != 0) {
-    fclose(fileHandle);
     return AwFmFileFormatError;
   }
 
   // read in the metadata
-  struct AwFmIndexConfiguration config;
-  uint32_t versionNumber;
-  elementsRead = fread(&versionNumber, sizeof(uint32_t), 1, fileHandle);
+  memset(config, 0, sizeof(struct AwFmIndexConfiguration));
+  elementsRead = fread(versionNumber, sizeof(uint32_t), 1, fileHandle);
   if (elementsRead != 1) {
-    fclose(fileHandle);
     return AwFmFileReadFail;
   }
 
   // check to make sure the version is currently supported.
-  if (!awFmIndexIsVersionValid(versionNumber)) {
-    fclose(fileHandle);
+  if (!awFmIndexIsVersionValid(*versionNumber)) {
     return AwFmUnsupportedVersionError;
   }
-  uint32_t featureFlags;
-  elementsRead = fread(&featureFlags, sizeof(uint32_t), 1, fileHandle);
+  elementsRead = fread(featureFlags, sizeof(uint32_t), 1, fileHandle);
   if (elementsRead != 1) {
-    fclose(fileHandle);
     return AwFmFileReadFail;
   }
-  elementsRead = fread(&config.suffixArrayCompressionRatio, sizeof(uint8_t), 1,
+  elementsRead = fread(&config->suffixArrayCompressionRatio, sizeof(uint8_t), 1,
                        fileHandle);
   if (elementsRead != 1) {
-    fclose(fileHandle);
     return AwFmFileReadFail;
   }
   elementsRead =
-      fread(&config.kmerLengthInSeedTable, sizeof(uint8_t), 1, fileHandle);
+      fread(&config->kmerLengthInSeedTable, sizeof(uint8_t), 1, fileHandle);
   if (elementsRead != 1) {
-    fclose(fileHandle);
     return AwFmFileReadFail;
   }
   uint8_t alphabetType;
   elementsRead = fread(&alphabetType, sizeof(uint8_t), 1, fileHandle);
   if (elementsRead != 1) {
-    fclose(fileHandle);
     return AwFmFileReadFail;
   }
-  config.alphabetType = alphabetType;
+  config->alphabetType = alphabetType;
 
   uint8_t storeOriginalSequence;
-
   elementsRead = fread(&storeOriginalSequence, sizeof(uint8_t), 1, fileHandle);
   if (elementsRead != 1) {
-    fclose(fileHandle);
     return AwFmFileReadFail;
   }
   // boolean-ify the byte (should be 0 or 1 already, but just in case)
-  config.storeOriginalSequence = !!storeOriginalSequence;
+  config->storeOriginalSequence = !!storeOriginalSequence;
 
   // read the bwt length
-  uint64_t bwtLength;
-  elementsRead = fread(&bwtLength, sizeof(uint64_t), 1, fileHandle);
+  elementsRead = fread(bwtLength, sizeof(uint64_t), 1, fileHandle);
   if (elementsRead != 1) {
-    fclose(fileHandle);
     return AwFmFileReadFail;
   }
 
+  // reduced amino indices follow the bwt length with their letter map, which
+  // is passed on to the index when it's allocated.
+  if (config->alphabetType == AwFmAlphabetReducedAmino) {
+    if (*versionNumber < 9) {
+      return AwFmFileFormatError;
+    }
+    elementsRead = fread(reducedAminoLetterMap, sizeof(uint8_t),
+                         AW_FM_AMINO_CARDINALITY, fileHandle);
+    if (elementsRead != AW_FM_AMINO_CARDINALITY) {
+      return AwFmFileReadFail;
+    }
+    if (!awFmReducedAminoLetterMapIsValid(reducedAminoLetterMap)) {
+      return AwFmFileFormatError;
+    }
+  }
+
+  return AwFmFileReadOkay;
+}
+
+// allocates the FastaVector struct for an index being read from file, and
+// sizes the header and metadata buffers to hold the data stored in the file.
+// the sequence buffer is freed, since it won't be used here.
+static enum AwFmReturnCode
+awFmInitFastaVectorForIndexRead(struct AwFmIndex *_RESTRICT_ const index,
+                                const size_t fastaVectorHeaderLength,
+                                const size_t fastaVectorMetadataLength) {
+  // allocate and init the fastaVector struct
+  struct FastaVector *fastaVector = malloc(sizeof(struct FastaVector));
+  if (!fastaVector) {
+    return AwFmAllocationFailure;
+  }
+  enum FastaVectorReturnCode fastaVectorReturnCode =
+      fastaVectorInit(fastaVector);
+  if (fastaVectorReturnCode == FASTA_VECTOR_ALLOCATION_FAIL) {
+    free(fastaVector);
+    return AwFmAllocationFailure;
+  }
+
+  // free the sequence buffer in the fastaVector, since it won't be used here
+  fastaVectorStringDealloc(&fastaVector->sequence);
+  fastaVector->sequence.charData = NULL;
+  fastaVector->sequence.capacity = 0;
+  fastaVector->sequence.count = 0;
+  index->fastaVector = fastaVector;
+
+  // now, to do some hacking to the FastaVector struct
+  fastaVector->header.charData = realloc(
+      fastaVector->header.charData, fastaVectorHeaderLength * sizeof(char));
+  if (!fastaVector->header.charData) {
+    return AwFmAllocationFailure;
+  }
+  fastaVector->metadata.data =
+      realloc(fastaVector->metadata.data,
+              fastaVectorMetadataLength * sizeof(struct FastaVectorMetadata));
+  if (!fastaVector->metadata.data) {
+    return AwFmAllocationFailure;
+  }
+
+  fastaVector->header.count = fastaVectorHeaderLength;
+  fastaVector->header.capacity = fastaVectorHeaderLength;
+  fastaVector->metadata.count = fastaVectorMetadataLength;
+  fastaVector->metadata.capacity = fastaVectorMetadataLength;
+  return AwFmSuccess;
+}
+
+enum AwFmReturnCode
+awFmReadIndexFromFile(struct AwFmIndex *_RESTRICT_ *_RESTRICT_ index,
+                      const char *fileSrc, const bool keepSuffixArrayInMemory) {
+
+  if (__builtin_expect(fileSrc == NULL, 0)) {
+    return AwFmNoFileSrcGiven;
+  }
+
+  FILE *fileHandle = fopen(fileSrc, "r");
+  if (!fileHandle) {
+    return AwFmFileOpenFail;
+  }
+
+  // create a local-scope pointer for the index, when we're done we'll set the
+  // index out-arg to this pointer.
+  struct AwFmIndex *_RESTRICT_ indexData;
+
+  struct AwFmIndexConfiguration config;
+  uint32_t versionNumber;
+  uint32_t featureFlags;
+  uint64_t bwtLength;
+  uint8_t reducedAminoLetterMap[AW_FM_AMINO_CARDINALITY];
+  enum AwFmReturnCode headerReturnCode =
+      awFmReadIndexFileHeader(fileHandle, &config, &versionNumber,
+                              &featureFlags, &bwtLength, reducedAminoLetterMap);
+  if (headerReturnCode != AwFmFileReadOkay) {
+    fclose(fileHandle);
+    return headerReturnCode;
+  }
+
   // allocate the index
-  indexData = awFmIndexAlloc(&config, bwtLength);
+  const struct AwFmIndexBuildOptions options = {.reducedAminoLetterMap =
+                                                    reducedAminoLetterMap};
+  indexData = awFmIndexAlloc(&config, &options, bwtLength, true);
   if (indexData == NULL) {
     fclose(fileHandle);
     return AwFmAllocationFailure;
@@ -295,12 +367,10 @@ awFmReadIndexFromFile(struct AwFmIndex *_RESTRICT_ *_RESTRICT_ index,
 
   // read the bwt block list
   const size_t numBlockInBwt = awFmNumBlocksFromBwtLength(indexData->bwtLength);
-  const size_t bytesPerBwtBlock =
-      indexData->config.alphabetType == AwFmAlphabetAmino
-          ? sizeof(struct AwFmAminoBlock)
-          : sizeof(struct AwFmNucleotideBlock);
-  elementsRead = fread(indexData->bwtBlockList.asNucleotide, bytesPerBwtBlock,
-                       numBlockInBwt, fileHandle);
+  const size_t bytesPerBwtBlock = awFmGetBwtBlockByteWidth(indexData);
+  size_t elementsRead =
+      fread(indexData->bwtBlockList.asNucleotide, bytesPerBwtBlock,
+            numBlockInBwt, fileHandle);
   if (elementsRead != numBlockInBwt) {
     fclose(fileHandle);
     awFmDeallocIndex(indexData);
@@ -359,28 +429,6 @@ awFmReadIndexFromFile(struct AwFmIndex *_RESTRICT_ *_RESTRICT_ index,
   }
   if (indexContainsFastaVector) {
     fseek(fileHandle, awFmGetFastaVectorFileOffset(indexData), SEEK_SET);
-    // allocate and init the fastaVector struct
-    struct FastaVector *fastaVector = malloc(sizeof(struct FastaVector));
-    if (!fastaVector) {
-      fclose(fileHandle);
-      awFmDeallocIndex(indexData);
-      return AwFmAllocationFailure;
-    }
-    enum FastaVectorReturnCode fastaVectorReturnCode =
-        fastaVectorInit(fastaVector);
-    if (fastaVectorReturnCode == FASTA_VECTOR_ALLOCATION_FAIL) {
-      fclose(fileHandle);
-      awFmDeallocIndex(indexData);
-      return AwFmAllocationFailure;
-    }
-
-    // free the sequence buffer in the fastaVector, since it won't be used here
-    fastaVectorStringDealloc(&fastaVector->sequence);
-    fastaVector->sequence.charData = NULL;
-    fastaVector->sequence.capacity = 0;
-    fastaVector->sequence.count = 0;
-
-    indexData->fastaVector = fastaVector;
     size_t fastaVectorHeaderLength;
     size_t fastaVectorMetadataLength;
     elementsRead =
@@ -398,15 +446,15 @@ awFmReadIndexFromFile(struct AwFmIndex *_RESTRICT_ *_RESTRICT_ index,
       return AwFmFileReadFail;
     }
 
-    // now, to do some hacking to the FastaVector struct
-    fastaVector->header.charData = realloc(
-        fastaVector->header.charData, fastaVectorHeaderLength * sizeof(char));
-    if (!fastaVector->header.charData) {
+    enum AwFmReturnCode fastaVectorReturnCode = awFmInitFastaVectorForIndexRead(
+        indexData, fastaVectorHeaderLength, fastaVectorMetadataLength);
+    if (fastaVectorReturnCode != AwFmSuccess) {
       fclose(fileHandle);
       awFmDeallocIndex(indexData);
-      return AwFmAllocationFailure;
+      return fastaVectorReturnCode;
     }
 
+    struct FastaVector *fastaVector = indexData->fastaVector;
     elementsRead = fread(fastaVector->header.charData, sizeof(char),
                          fastaVectorHeaderLength, fileHandle);
     if (elementsRead != fastaVectorHeaderLength) {
@@ -415,15 +463,6 @@ awFmReadIndexFromFile(struct AwFmIndex *_RESTRICT_ *_RESTRICT_ index,
       return AwFmFileReadFail;
     }
 
-    fastaVector->metadata.data =
-        realloc(fastaVector->metadata.data,
-                fastaVectorMetadataLength * sizeof(struct FastaVectorMetadata));
-    if (!fastaVector->metadata.data) {
-      fclose(fileHandle);
-      awFmDeallocIndex(indexData);
-      return AwFmAllocationFailure;
-    }
-
     elementsRead =
         fread(fastaVector->metadata.data, sizeof(struct FastaVectorMetadata),
               fastaVectorMetadataLength, fileHandle);
@@ -432,11 +471,6 @@ awFmReadIndexFromFile(struct AwFmIndex *_RESTRICT_ *_RESTRICT_ index,
       awFmDeallocIndex(indexData);
       return AwFmFileReadFail;
     }
-
-    fastaVector->header.count = fastaVectorHeaderLength;
-    fastaVector->header.capacity = fastaVectorHeaderLength;
-    fastaVector->metadata.count = fastaVectorMetadataLength;
-    fastaVector->metadata.capacity = fastaVectorMetadataLength;
   }
 
   indexData->suffixArrayFileOffset = awFmGetSuffixArrayFileOffset(indexData);
@@ -448,6 +482,288 @@ awFmReadIndexFromFile(struct AwFmIndex *_RESTRICT_ *_RESTRICT_ index,
   return AwFmFileReadOkay;
 }
 
+// adds read segments covering the given section of the index file, split into
+// chunks so that large sections can be spread across multiple threads.
+static void awFmAppendFileReadSegments(
+    struct AwFmFileReadSegment *_RESTRICT_ const segments,
+    size_t *_RESTRICT_ const segmentCount, uint8_t *destination,
+    size_t fileOffset, size_t length,
+    const enum AwFmIndexFileSection section) {
+  while (length > 0) {
+    const size_t segmentLength = length < AW_FM_PARALLEL_LOAD_CHUNK_SIZE
+                                     ? length
+                                     : AW_FM_PARALLEL_LOAD_CHUNK_SIZE;
+    struct AwFmFileReadSegment *segment = &segments[*segmentCount];
+    segment->destination = destination;
+    segment->fileOffset = fileOffset;
+    segment->length = segmentLength;
+    segment->section = section;
+    segment->startTime = 0;
+    segment->endTime = 0;
+    (*segmentCount)++;
+
+    destination += segmentLength;
+    fileOffset += segmentLength;
+    length -= segmentLength;
+  }
+}
+
+static size_t awFmNumFileReadSegments(const size_t length) {
+  return (length + AW_FM_PARALLEL_LOAD_CHUNK_SIZE - 1) /
+         AW_FM_PARALLEL_LOAD_CHUNK_SIZE;
+}
+
+enum AwFmReturnCode awFmReadIndexFromFileParallel(
+    struct AwFmIndex *_RESTRICT_ *_RESTRICT_ index, const char *fileSrc,
+    const struct AwFmIndexLoadConfiguration *_RESTRICT_ const loadConfig,
+    struct AwFmIndexLoadStatistics *_RESTRICT_ const loadStatistics) {
+  if (__builtin_expect(fileSrc == NULL, 0)) {
+    return AwFmNoFileSrcGiven;
+  }
+  if (__builtin_expect(loadConfig == NULL, 0)) {
+    return AwFmNullPtrError;
+  }
+
+  const double loadStartTime = omp_get_wtime();
+  const uint32_t numThreads =
+      loadConfig->numThreads > 0 ? loadConfig->numThreads : 1;
+
+  FILE *fileHandle = fopen(fileSrc, "r");
+  if (!fileHandle) {
+    return AwFmFileOpenFail;
+  }
+
+  struct AwFmIndexConfiguration config;
+  uint32_t versionNumber;
+  uint32_t featureFlags;
+  uint64_t bwtLength;
+  uint8_t reducedAminoLetterMap[AW_FM_AMINO_CARDINALITY];
+  enum AwFmReturnCode returnCode =
+      awFmReadIndexFileHeader(fileHandle, &config, &versionNumber,
+                              &featureFlags, &bwtLength, reducedAminoLetterMap);
+  if (returnCode != AwFmFileReadOkay) {
+    fclose(fileHandle);
+    return returnCode;
+  }
+  config.keepSuffixArrayInMemory = loadConfig->keepSuffixArrayInMemory;
+  const struct AwFmIndexBuildOptions options = {
+      .allocationPolicy = loadConfig->allocationPolicy,
+      .reducedAminoLetterMap = reducedAminoLetterMap};
+
+  struct AwFmIndex *_RESTRICT_ indexData = awFmIndexAlloc(
+      &config, &options, bwtLength, !loadConfig->keepBwtOnDisk);
+  if (indexData == NULL) {
+    fclose(fileHandle);
+    return AwFmAllocationFailure;
+  }
+  // hand the file to the index now, so deallocating the index closes it.
+  indexData->versionNumber = versionNumber;
+  indexData->featureFlags = featureFlags;
+  indexData->fileHandle = fileHandle;
+  indexData->fileDescriptor = fileno(fileHandle);
+  indexData->suffixArray.compressedByteLength =
+      awFmComputeCompressedSaSizeInBytes(bwtLength,
+                                         config.suffixArrayCompressionRatio);
+  indexData->suffixArray.valueBitWidth =
+      awFmComputeSuffixArrayValueMinWidth(bwtLength);
+  indexData->suffixArrayFileOffset = awFmGetSuffixArrayFileOffset(indexData);
+  indexData->sequenceFileOffset = awFmGetSequenceFileOffset(indexData);
+
+  if (config.keepSuffixArrayInMemory) {
+    indexData->suffixArray.values =
+        malloc(indexData->suffixArray.compressedByteLength);
+    if (indexData->suffixArray.values == NULL) {
+      awFmDeallocIndex(indexData);
+      return AwFmAllocationFailure;
+    }
+  }
+
+  // the FastaVector section lengths are needed before its buffers can be
+  // allocated, so read them up front.
+  size_t fastaVectorDataFileOffset = 0;
+  size_t fastaVectorHeaderLength = 0;
+  size_t fastaVectorMetadataLength = 0;
+  if (awFmIndexContainsFastaVector(indexData)) {
+    const size_t fastaVectorFileOffset =
+        awFmGetFastaVectorFileOffset(indexData);
+    size_t fastaVectorLengths[2];
+    returnCode = awFmFileReadFully(indexData->fileDescriptor,
+                                   fastaVectorLengths, sizeof(fastaVectorLengths),
+                                   fastaVectorFileOffset);
+    if (returnCode != AwFmFileReadOkay) {
+      awFmDeallocIndex(indexData);
+      return returnCode;
+    }
+    fastaVectorHeaderLength = fastaVectorLengths[0];
+    fastaVectorMetadataLength = fastaVectorLengths[1];
+    fastaVectorDataFileOffset =
+        fastaVectorFileOffset + sizeof(fastaVectorLengths);
+
+    returnCode = awFmInitFastaVectorForIndexRead(
+        indexData, fastaVectorHeaderLength, fastaVectorMetadataLength);
+    if (returnCode != AwFmSuccess) {
+      awFmDeallocIndex(indexData);
+      return returnCode;
+    }
+  }
+
+  // lay out the sections of the file to be read.
+  const size_t bwtByteLength =
+      awFmNumBlocksFromBwtLength(bwtLength) * awFmGetBwtBlockByteWidth(indexData);
+  const size_t prefixSumsByteLength =
+      awFmGetPrefixSumsLength(config.alphabetType) * sizeof(uint64_t);
+  const size_t kmerSeedTableByteLength =
+      awFmGetKmerTableLength(indexData) * sizeof(struct AwFmSearchRange);
+  const size_t suffixArrayByteLength =
+      config.keepSuffixArrayInMemory
+          ? indexData->suffixArray.compressedByteLength
+          : 0;
+  const size_t fastaVectorHeaderByteLength =
+      fastaVectorHeaderLength * sizeof(char);
+  const size_t fastaVectorMetadataByteLength =
+      fastaVectorMetadataLength * sizeof(struct FastaVectorMetadata);
+
+  const size_t maxSegments =
+      awFmNumFileReadSegments(bwtByteLength) +
+      awFmNumFileReadSegments(prefixSumsByteLength) +
+      awFmNumFileReadSegments(kmerSeedTableByteLength) +
+      awFmNumFileReadSegments(suffixArrayByteLength) +
+      awFmNumFileReadSegments(fastaVectorHeaderByteLength) +
+      awFmNumFileReadSegments(fastaVectorMetadataByteLength);
+  struct AwFmFileReadSegment *segments =
+      malloc(maxSegments * sizeof(struct AwFmFileReadSegment));
+  if (segments == NULL) {
+    awFmDeallocIndex(indexData);
+    return AwFmAllocationFailure;
+  }
+
+  size_t segmentCount = 0;
+  const size_t bwtFileOffset = awFmGetBwtFileOffset(indexData);
+  awFmAppendFileReadSegments(
+      segments, &segmentCount, (uint8_t *)indexData->bwtBlockList.asNucleotide,
+      bwtFileOffset, loadConfig->keepBwtOnDisk ? 0 : bwtByteLength,
+      AwFmIndexFileSectionBwt);
+  awFmAppendFileReadSegments(segments, &segmentCount,
+                             (uint8_t *)indexData->prefixSums,
+                             bwtFileOffset + bwtByteLength,
+                             prefixSumsByteLength,
+                             AwFmIndexFileSectionPrefixSums);
+  awFmAppendFileReadSegments(
+      segments, &segmentCount, (uint8_t *)indexData->kmerSeedTable,
+      bwtFileOffset + bwtByteLength + prefixSumsByteLength,
+      kmerSeedTableByteLength, AwFmIndexFileSectionKmerSeedTable);
+  awFmAppendFileReadSegments(segments, &segmentCount,
+                             indexData->suffixArray.values,
+                             indexData->suffixArrayFileOffset,
+                             suffixArrayByteLength,
+                             AwFmIndexFileSectionSuffixArray);
+  if (indexData->fastaVector != NULL) {
+    awFmAppendFileReadSegments(
+        segments, &segmentCount,
+        (uint8_t *)indexData->fastaVector->header.charData,
+        fastaVectorDataFileOffset, fastaVectorHeaderByteLength,
+        AwFmIndexFileSectionFastaVector);
+    awFmAppendFileReadSegments(
+        segments, &segmentCount,
+        (uint8_t *)indexData->fastaVector->metadata.data,
+        fastaVectorDataFileOffset + fastaVectorHeaderByteLength,
+        fastaVectorMetadataByteLength, AwFmIndexFileSectionFastaVector);
+  }
+
+  const double headerEndTime = omp_get_wtime();
+  const int fileDescriptor = indexData->fileDescriptor;
+  bool readFailed = false;
+
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads)
+  for (size_t i = 0; i < segmentCount; i++) {
+    struct AwFmFileReadSegment *segment = &segments[i];
+    segment->startTime = omp_get_wtime();
+    enum AwFmReturnCode segmentReturnCode =
+        awFmFileReadFully(fileDescriptor, segment->destination,
+                          segment->length, segment->fileOffset);
+    segment->endTime = omp_get_wtime();
+    if (segmentReturnCode != AwFmFileReadOkay) {
+#pragma omp atomic write
+      readFailed = true;
+    }
+  }
+
+  // replication is best-effort on platforms without thread pinning, so only
+  // allocation failures are reported.
+  enum AwFmReturnCode replicationReturnCode = AwFmSuccess;
+  double numaReplicationSeconds = 0;
+  if (!readFailed && loadConfig->replicateAcrossNumaNodes) {
+    const double replicationStartTime = omp_get_wtime();
+    replicationReturnCode = awFmReplicateIndexAcrossNumaNodes(indexData);
+    numaReplicationSeconds = omp_get_wtime() - replicationStartTime;
+  }
+
+  enum AwFmReturnCode cacheReturnCode = AwFmSuccess;
+  if (!readFailed && loadConfig->suffixArrayCacheCapacity > 0) {
+    cacheReturnCode = awFmEnableSuffixArrayCache(
+        indexData, loadConfig->suffixArrayCacheCapacity);
+  }
+  if (!readFailed && loadConfig->keepBwtOnDisk &&
+      cacheReturnCode == AwFmSuccess) {
+    cacheReturnCode =
+        awFmDiskBwtInit(indexData, loadConfig->bwtCacheCapacity);
+  }
+
+  if (loadStatistics != NULL) {
+    double sectionStartTimes[AwFmIndexFileSectionCount];
+    double sectionEndTimes[AwFmIndexFileSectionCount];
+    for (size_t section = 0; section < AwFmIndexFileSectionCount; section++) {
+      sectionStartTimes[section] = 0;
+      sectionEndTimes[section] = 0;
+    }
+    uint64_t bytesRead = 0;
+    for (size_t i = 0; i < segmentCount; i++) {
+      const struct AwFmFileReadSegment *segment = &segments[i];
+      if (sectionEndTimes[segment->section] == 0 ||
+          segment->startTime < sectionStartTimes[segment->section]) {
+        sectionStartTimes[segment->section] = segment->startTime;
+      }
+      if (segment->endTime > sectionEndTimes[segment->section]) {
+        sectionEndTimes[segment->section] = segment->endTime;
+      }
+      bytesRead += segment->length;
+    }
+
+    loadStatistics->headerSeconds = headerEndTime - loadStartTime;
+    loadStatistics->bwtSeconds = sectionEndTimes[AwFmIndexFileSectionBwt] -
+                                 sectionStartTimes[AwFmIndexFileSectionBwt];
+    loadStatistics->prefixSumsSeconds =
+        sectionEndTimes[AwFmIndexFileSectionPrefixSums] -
+        sectionStartTimes[AwFmIndexFileSectionPrefixSums];
+    loadStatistics->kmerSeedTableSeconds =
+        sectionEndTimes[AwFmIndexFileSectionKmerSeedTable] -
+        sectionStartTimes[AwFmIndexFileSectionKmerSeedTable];
+    loadStatistics->suffixArraySeconds =
+        sectionEndTimes[AwFmIndexFileSectionSuffixArray] -
+        sectionStartTimes[AwFmIndexFileSectionSuffixArray];
+    loadStatistics->fastaVectorSeconds =
+        sectionEndTimes[AwFmIndexFileSectionFastaVector] -
+        sectionStartTimes[AwFmIndexFileSectionFastaVector];
+    loadStatistics->numaReplicationSeconds = numaReplicationSeconds;
+    loadStatistics->totalSeconds = omp_get_wtime() - loadStartTime;
+    loadStatistics->bytesRead = bytesRead;
+  }
+  free(segments);
+
+  if (readFailed) {
+    awFmDeallocIndex(indexData);
+    return AwFmFileReadFail;
+  }
+  if (replicationReturnCode == AwFmAllocationFailure ||
+      cacheReturnCode == AwFmAllocationFailure) {
+    awFmDeallocIndex(indexData);
+    return AwFmAllocationFailure;
+  }
+
+  *index = indexData;
+  return AwFmFileReadOkay;
+}
+
 enum AwFmReturnCode
 awFmReadSequenceFromFile(const struct AwFmIndex *_RESTRICT_ const index,
                          const size_t sequenceStartPosition,
@@ -496,8 +812,18 @@ awFmGetSuffixArrayValueFromFile(const struct AwFmIndex *_RESTRICT_ const index,
   int8_t bytesToRead =
       (offset.bitOffset + index->suffixArray.valueBitWidth + 7) /
       8; // rounded up.
-  int8_t totalBytesRead = 0;
+  if (index->suffixArrayCache != NULL) {
+    if (awFmPageCacheRead(index->suffixArrayCache,
+                          suffixArrayFileOffset + offset.byteOffset,
+                          valueBuffer, bytesToRead) != AwFmFileReadOkay) {
+      return AwFmFileReadFail;
+    }
+    *valueOut = awFmDecodeSuffixArrayValue(valueBuffer, offset.bitOffset,
+                                           index->suffixArray.valueBitWidth);
+    return AwFmSuccess;
+  }
 
+  int8_t totalBytesRead = 0;
   while (bytesToRead > totalBytesRead) {
     int8_t bytesLeft = bytesToRead - totalBytesRead;
     size_t readPosition =
@@ -506,37 +832,89 @@ awFmGetSuffixArrayValueFromFile(const struct AwFmIndex *_RESTRICT_ const index,
         pread(index->fileDescriptor, valueBuffer + totalBytesRead, bytesLeft,
               readPosition);
     if (bytesRead <= 0) {
-      return AwFmFileWriteFail;
+      return AwFmFileReadFail;
     }
     totalBytesRead += bytesRead;
   }
 
   // reconstruct the size_t valueOut from the valueBuffer.
-  // first memcpy the first 8 bytes into valueOut
-  memcpy(valueOut, valueBuffer, 8);
-  *valueOut >>= offset.bitOffset;
-  *valueOut |= ((uint64_t)valueBuffer[8]) << (64 - offset.bitOffset);
-  size_t bitmask = (((size_t)1) << index->suffixArray.valueBitWidth) - 1;
-  *valueOut &= bitmask;
+  *valueOut = awFmDecodeSuffixArrayValue(valueBuffer, offset.bitOffset,
+                                         index->suffixArray.valueBitWidth);
   return AwFmSuccess;
 }
 
-size_t
-awFmGetSequenceFileOffset(const struct AwFmIndex *_RESTRICT_ const index) {
+enum AwFmReturnCode awFmFileReadFully(const int fileDescriptor,
+                                      void *_RESTRICT_ const buffer,
+                                      const size_t length,
+                                      const size_t fileOffset) {
+  size_t totalBytesRead = 0;
+  while (totalBytesRead < length) {
+    ssize_t bytesRead =
+        pread(fileDescriptor, (uint8_t *)buffer + totalBytesRead,
+              length - totalBytesRead, fileOffset + totalBytesRead);
+    if (bytesRead < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytesRead <= 0) {
+      return AwFmFileReadFail;
+    }
+    totalBytesRead += bytesRead;
+  }
+  return AwFmFileReadOkay;
+}
+
+enum AwFmReturnCode awFmFileWriteFully(const int fileDescriptor,
+                                       const void *_RESTRICT_ const buffer,
+                                       const size_t length,
+                                       const size_t fileOffset) {
+  size_t totalBytesWritten = 0;
+  while (totalBytesWritten < length) {
+    ssize_t bytesWritten =
+        pwrite(fileDescriptor, (const uint8_t *)buffer + totalBytesWritten,
+               length - totalBytesWritten, fileOffset + totalBytesWritten);
+    if (bytesWritten < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytesWritten <= 0) {
+      return AwFmFileWriteFail;
+    }
+    totalBytesWritten += bytesWritten;
+  }
+  return AwFmFileWriteOkay;
+}
+
+size_t awFmGetBwtBlockByteWidth(const struct AwFmIndex *_RESTRICT_ const index) {
+  switch (index->config.alphabetType) {
+  case AwFmAlphabetAmino:
+    return sizeof(struct AwFmAminoBlock);
+  case AwFmAlphabetReducedAmino:
+    return sizeof(struct AwFmReducedAminoBlock);
+  default:
+    return sizeof(struct AwFmNucleotideBlock);
+  }
+}
+
+size_t awFmGetBwtFileOffset(const struct AwFmIndex *_RESTRICT_ const index) {
   const size_t configLength = 12 * sizeof(uint8_t);
-  const size_t bytesPerBwtBlock =
-      index->config.alphabetType == AwFmAlphabetAmino
-          ? sizeof(struct AwFmAminoBlock)
-          : sizeof(struct AwFmNucleotideBlock);
   const size_t bwtLengthDataLength = sizeof(uint64_t);
-  const size_t bwtLengthInBytes =
-      awFmNumBlocksFromBwtLength(index->bwtLength) * bytesPerBwtBlock;
+  const size_t letterMapLength =
+      index->config.alphabetType == AwFmAlphabetReducedAmino
+          ? AW_FM_AMINO_CARDINALITY
+          : 0;
+  return IndexFileFormatIdHeaderLength + configLength + bwtLengthDataLength +
+         letterMapLength;
+}
+
+size_t
+awFmGetSequenceFileOffset(const struct AwFmIndex *_RESTRICT_ const index) {
+  const size_t bwtLengthInBytes = awFmNumBlocksFromBwtLength(index->bwtLength) *
+                                  awFmGetBwtBlockByteWidth(index);
   const size_t prefixSumLengthInBytes =
       awFmGetPrefixSumsLength(index->config.alphabetType) * sizeof(uint64_t);
   const size_t kmerSeedTableLength = awFmGetKmerTableLength(index);
 
-  return IndexFileFormatIdHeaderLength + configLength + bwtLengthDataLength +
-         bwtLengthInBytes + prefixSumLengthInBytes +
+  return awFmGetBwtFileOffset(index) + bwtLengthInBytes +
+         prefixSumLengthInBytes +
          (kmerSeedTableLength * sizeof(struct AwFmSearchRange));
 }
 
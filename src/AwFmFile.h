@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "AwFmFileWriter.h"
 #include "AwFmIndexStruct.h"
 
 /*
@@ -32,6 +33,112 @@ enum AwFmReturnCode
 awFmGetSuffixArrayValueFromFile(const struct AwFmIndex *_RESTRICT_ const index,
                                 const size_t positionInArray, size_t *valueOut);
 
+/*
+ * Function:  awFmFileReadFully
+ * --------------------
+ * Reads the requested number of bytes from the given file descriptor at the
+ * given offset with pread(), retrying on short reads and on reads interrupted
+ * by a signal.
+ *
+ *  Inputs:
+ *    fileDescriptor: File descriptor to read from.
+ *    buffer:         Destination buffer, at least length bytes long.
+ *    length:         Number of bytes to read.
+ *    fileOffset:     Offset into the file to begin reading at.
+ *
+ *  Returns:
+ *    AwFmFileReadOkay on success, or AwFmFileReadFail if the file ended or
+ * could not be read before all bytes were read.
+ */
+enum AwFmReturnCode awFmFileReadFully(const int fileDescriptor,
+                                      void *_RESTRICT_ const buffer,
+                                      const size_t length,
+                                      const size_t fileOffset);
+
+/*
+ * Function:  awFmFileWriteFully
+ * --------------------
+ * Writes the buffer to the given file descriptor at the given offset with
+ * pwrite(), retrying on short writes and on writes interrupted by a signal.
+ *
+ *  Returns:
+ *    AwFmFileWriteOkay on success, or AwFmFileWriteFail if the write failed.
+ */
+enum AwFmReturnCode awFmFileWriteFully(const int fileDescriptor,
+                                       const void *_RESTRICT_ const buffer,
+                                       const size_t length,
+                                       const size_t fileOffset);
+
+/*
+ * Function:  awFmWriteIndexBwtSections
+ * --------------------
+ * Queues writes of the file header, the BWT, and the prefix sums on the
+ * writer. These sections are final as soon as the BWT is built, so builds
+ * queue them first and write them while the rest of the index is built.
+ *
+ *  Inputs:
+ *    index:  Index to write, with its BWT and prefix sums set.
+ *    writer: Writer for the index file.
+ *
+ *  Returns:
+ *    AwFmSuccess if the writes were queued, or AwFmAllocationFailure.
+ */
+enum AwFmReturnCode
+awFmWriteIndexBwtSections(const struct AwFmIndex *_RESTRICT_ const index,
+                          struct AwFmFileWriter *_RESTRICT_ const writer);
+
+/*
+ * Function:  awFmWriteIndexRemainingSections
+ * --------------------
+ * Queues writes of every section after the prefix sums on the writer: the
+ * kmer seed table, the sequence, the suffix array, and the FastaVector data.
+ *
+ *  Inputs:
+ *    index:          Index to write.
+ *    writer:         Writer for the index file.
+ *    sequence:       Original database sequence. If NULL, the sequence
+ *      section is assumed to already be written, and is skipped.
+ *    sequenceLength: Length of the sequence.
+ *
+ *  If index->suffixArray.values is NULL, the suffix array section is likewise
+ *  skipped.
+ *
+ *  Returns:
+ *    AwFmSuccess if the writes were queued, or AwFmAllocationFailure.
+ */
+enum AwFmReturnCode awFmWriteIndexRemainingSections(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmFileWriter *_RESTRICT_ const writer,
+    const uint8_t *_RESTRICT_ const sequence, const uint64_t sequenceLength);
+
+/*
+ * Function:  awFmGetBwtBlockByteWidth
+ * --------------------
+ * Returns the size, in bytes, of a single BWT block for the index's alphabet.
+ *
+ *  Inputs:
+ *    index: Pointer to the index struct.
+ *
+ *  Returns:
+ *    sizeof the nucleotide or amino block struct, depending on the alphabet.
+ */
+size_t awFmGetBwtBlockByteWidth(const struct AwFmIndex *_RESTRICT_ const index);
+
+/*
+ * Function:  awFmGetBwtFileOffset
+ * --------------------
+ * Computes the file offset for the start of the BWT block list in the
+ * AwFmIndex File. This offset is the same for every index file, except that
+ * reduced amino indices store their letter map before the BWT.
+ *
+ *  Inputs:
+ *    index: Pointer to the index struct.
+ *
+ *  Returns:
+ *    Offset into the file, in bytes, where the BWT starts.
+ */
+size_t awFmGetBwtFileOffset(const struct AwFmIndex *_RESTRICT_ const index);
+
 /*
  * Function:  awFmGetSequenceFileOffset
  * --------------------
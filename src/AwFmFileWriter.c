@@ -0,0 +1,266 @@
+// O_DIRECT needs _GNU_SOURCE in strict c11 mode.
+#define _GNU_SOURCE
+
+#include "AwFmFileWriter.h"
+#include <fcntl.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "AwFmFile.h"
+
+struct AwFmFileWriteRequest {
+  const uint8_t *buffer;
+  size_t length;
+  size_t fileOffset;
+  // copy made by awFmFileWriterSubmitCopy, freed once it's written.
+  uint8_t *ownedBuffer;
+  struct AwFmFileWriteRequest *next;
+};
+
+struct AwFmFileWriter {
+  int fileDescriptor;
+  // -1 if direct writes aren't in use.
+  int directFileDescriptor;
+  uint8_t *directBuffer;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t workAvailable;
+  // queue of writes not yet started, protected by lock.
+  struct AwFmFileWriteRequest *queueHead;
+  struct AwFmFileWriteRequest *queueTail;
+  bool finishing;
+  bool failed;
+  // only touched by the writer thread until it's joined.
+  double writeSeconds;
+};
+
+// writes the whole aligned blocks in [fileOffset, fileOffset + length) through
+// the aligned buffer with the direct file descriptor, and returns the range of
+// those blocks. Anything outside the range is left for a buffered write.
+static bool writeAlignedBlocks(struct AwFmFileWriter *_RESTRICT_ const writer,
+                               const uint8_t *_RESTRICT_ const buffer,
+                               const size_t length, const size_t fileOffset,
+                               size_t *_RESTRICT_ const alignedStart,
+                               size_t *_RESTRICT_ const alignedEnd) {
+  const size_t alignment = AW_FM_FILE_WRITER_DIRECT_ALIGNMENT;
+  *alignedStart = (fileOffset + alignment - 1) / alignment * alignment;
+  *alignedEnd = (fileOffset + length) / alignment * alignment;
+  if (*alignedEnd <= *alignedStart) {
+    *alignedStart = *alignedEnd = fileOffset;
+    return true;
+  }
+
+  for (size_t chunkStart = *alignedStart; chunkStart < *alignedEnd;
+       chunkStart += AW_FM_FILE_WRITER_CHUNK_SIZE) {
+    size_t chunkLength = *alignedEnd - chunkStart;
+    if (chunkLength > AW_FM_FILE_WRITER_CHUNK_SIZE) {
+      chunkLength = AW_FM_FILE_WRITER_CHUNK_SIZE;
+    }
+    memcpy(writer->directBuffer, buffer + (chunkStart - fileOffset),
+           chunkLength);
+    if (awFmFileWriteFully(writer->directFileDescriptor, writer->directBuffer,
+                           chunkLength, chunkStart) != AwFmFileWriteOkay) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool writeRequest(struct AwFmFileWriter *_RESTRICT_ const writer,
+                         const struct AwFmFileWriteRequest *const request) {
+  if (writer->directFileDescriptor < 0) {
+    return awFmFileWriteFully(writer->fileDescriptor, request->buffer,
+                              request->length,
+                              request->fileOffset) == AwFmFileWriteOkay;
+  }
+
+  size_t alignedStart;
+  size_t alignedEnd;
+  if (!writeAlignedBlocks(writer, request->buffer, request->length,
+                          request->fileOffset, &alignedStart, &alignedEnd)) {
+    return false;
+  }
+  // the unaligned head and tail of the request.
+  const size_t headLength = alignedStart - request->fileOffset;
+  const size_t tailOffset = alignedEnd - request->fileOffset;
+  return awFmFileWriteFully(writer->fileDescriptor, request->buffer,
+                            headLength,
+                            request->fileOffset) == AwFmFileWriteOkay &&
+         awFmFileWriteFully(writer->fileDescriptor,
+                            request->buffer + tailOffset,
+                            request->length - tailOffset,
+                            alignedEnd) == AwFmFileWriteOkay;
+}
+
+static void *awFmFileWriterThread(void *writerPtr) {
+  struct AwFmFileWriter *writer = writerPtr;
+  pthread_mutex_lock(&writer->lock);
+  while (true) {
+    while (writer->queueHead == NULL && !writer->finishing) {
+      pthread_cond_wait(&writer->workAvailable, &writer->lock);
+    }
+    struct AwFmFileWriteRequest *request = writer->queueHead;
+    if (request == NULL) {
+      break;
+    }
+    writer->queueHead = request->next;
+    if (writer->queueHead == NULL) {
+      writer->queueTail = NULL;
+    }
+    const bool skipWrite = writer->failed;
+    pthread_mutex_unlock(&writer->lock);
+
+    const double startTime = omp_get_wtime();
+    const bool writeSucceeded = skipWrite || writeRequest(writer, request);
+    writer->writeSeconds += omp_get_wtime() - startTime;
+    free(request->ownedBuffer);
+    free(request);
+
+    pthread_mutex_lock(&writer->lock);
+    writer->failed |= !writeSucceeded;
+  }
+  const bool syncFile = !writer->failed;
+  pthread_mutex_unlock(&writer->lock);
+
+  if (syncFile) {
+    const double startTime = omp_get_wtime();
+    const bool syncSucceeded = fsync(writer->fileDescriptor) == 0;
+    writer->writeSeconds += omp_get_wtime() - startTime;
+    pthread_mutex_lock(&writer->lock);
+    writer->failed |= !syncSucceeded;
+    pthread_mutex_unlock(&writer->lock);
+  }
+  return NULL;
+}
+
+struct AwFmFileWriter *
+awFmFileWriterCreate(const int fileDescriptor,
+                     const char *_RESTRICT_ const fileSrc,
+                     const bool useDirectIo) {
+  struct AwFmFileWriter *writer = malloc(sizeof(struct AwFmFileWriter));
+  if (writer == NULL) {
+    return NULL;
+  }
+  writer->fileDescriptor = fileDescriptor;
+  writer->directFileDescriptor = -1;
+  writer->directBuffer = NULL;
+  writer->queueHead = NULL;
+  writer->queueTail = NULL;
+  writer->finishing = false;
+  writer->failed = false;
+  writer->writeSeconds = 0;
+
+#ifdef O_DIRECT
+  // file systems without O_DIRECT support (like tmpfs) fail the open, in which
+  // case every write is buffered.
+  if (useDirectIo && fileSrc != NULL) {
+    writer->directBuffer = aligned_alloc(AW_FM_FILE_WRITER_DIRECT_ALIGNMENT,
+                                         AW_FM_FILE_WRITER_CHUNK_SIZE);
+    if (writer->directBuffer != NULL) {
+      writer->directFileDescriptor = open(fileSrc, O_WRONLY | O_DIRECT);
+    }
+  }
+#else
+  (void)fileSrc;
+  (void)useDirectIo;
+#endif
+
+  pthread_mutex_init(&writer->lock, NULL);
+  pthread_cond_init(&writer->workAvailable, NULL);
+  if (pthread_create(&writer->thread, NULL, awFmFileWriterThread, writer) !=
+      0) {
+    pthread_cond_destroy(&writer->workAvailable);
+    pthread_mutex_destroy(&writer->lock);
+    if (writer->directFileDescriptor >= 0) {
+      close(writer->directFileDescriptor);
+    }
+    free(writer->directBuffer);
+    free(writer);
+    return NULL;
+  }
+  return writer;
+}
+
+static enum AwFmReturnCode
+queueRequest(struct AwFmFileWriter *_RESTRICT_ const writer,
+             const void *const buffer, const size_t length,
+             const size_t fileOffset, uint8_t *const ownedBuffer) {
+  struct AwFmFileWriteRequest *request =
+      malloc(sizeof(struct AwFmFileWriteRequest));
+  if (request == NULL) {
+    free(ownedBuffer);
+    return AwFmAllocationFailure;
+  }
+  request->buffer = buffer;
+  request->length = length;
+  request->fileOffset = fileOffset;
+  request->ownedBuffer = ownedBuffer;
+  request->next = NULL;
+
+  pthread_mutex_lock(&writer->lock);
+  if (writer->queueTail == NULL) {
+    writer->queueHead = request;
+  } else {
+    writer->queueTail->next = request;
+  }
+  writer->queueTail = request;
+  pthread_cond_signal(&writer->workAvailable);
+  pthread_mutex_unlock(&writer->lock);
+  return AwFmSuccess;
+}
+
+enum AwFmReturnCode
+awFmFileWriterSubmit(struct AwFmFileWriter *_RESTRICT_ const writer,
+                     const void *_RESTRICT_ const buffer, const size_t length,
+                     const size_t fileOffset) {
+  if (length == 0) {
+    return AwFmSuccess;
+  }
+  return queueRequest(writer, buffer, length, fileOffset, NULL);
+}
+
+enum AwFmReturnCode
+awFmFileWriterSubmitCopy(struct AwFmFileWriter *_RESTRICT_ const writer,
+                         const void *_RESTRICT_ const buffer,
+                         const size_t length, const size_t fileOffset) {
+  if (length == 0) {
+    return AwFmSuccess;
+  }
+  uint8_t *copy = malloc(length);
+  if (copy == NULL) {
+    return AwFmAllocationFailure;
+  }
+  memcpy(copy, buffer, length);
+  return queueRequest(writer, copy, length, fileOffset, copy);
+}
+
+enum AwFmReturnCode
+awFmFileWriterFinish(struct AwFmFileWriter *_RESTRICT_ const writer,
+                     double *_RESTRICT_ const writeSeconds,
+                     double *_RESTRICT_ const waitSeconds) {
+  const double startTime = omp_get_wtime();
+  pthread_mutex_lock(&writer->lock);
+  writer->finishing = true;
+  pthread_cond_signal(&writer->workAvailable);
+  pthread_mutex_unlock(&writer->lock);
+  pthread_join(writer->thread, NULL);
+
+  if (writeSeconds != NULL) {
+    *writeSeconds = writer->writeSeconds;
+  }
+  if (waitSeconds != NULL) {
+    *waitSeconds = omp_get_wtime() - startTime;
+  }
+
+  const bool failed = writer->failed;
+  pthread_cond_destroy(&writer->workAvailable);
+  pthread_mutex_destroy(&writer->lock);
+  if (writer->directFileDescriptor >= 0) {
+    close(writer->directFileDescriptor);
+  }
+  free(writer->directBuffer);
+  free(writer);
+  return failed ? AwFmFileWriteFail : AwFmFileWriteOkay;
+}
@@ -0,0 +1,102 @@
+#ifndef AW_FM_FILE_WRITER_H
+#define AW_FM_FILE_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "AwFmIndex.h"
+
+// largest single write issued by an AwFmFileWriter.
+#define AW_FM_FILE_WRITER_CHUNK_SIZE (8 * 1024 * 1024)
+// alignment of the file offsets, lengths, and buffers of direct writes.
+#define AW_FM_FILE_WRITER_DIRECT_ALIGNMENT 4096
+
+// opaque, defined in AwFmFileWriter.c.
+struct AwFmFileWriter;
+
+/*
+ * Function:  awFmFileWriterCreate
+ * --------------------
+ * Creates a writer that writes sections of a file from a background thread,
+ * so the caller can keep building later sections while earlier ones are
+ * written. Writes are issued in the order they're submitted, each as a
+ * single large write.
+ *
+ * If useDirectIo is set, the file is opened a second time with O_DIRECT, and
+ * every whole, aligned block of each write is copied through an aligned buffer
+ * and written around the page cache, AW_FM_FILE_WRITER_CHUNK_SIZE bytes at a
+ * time. The unaligned ends of each write still go through fileDescriptor. If
+ * the file system doesn't support O_DIRECT, every write goes through
+ * fileDescriptor.
+ *
+ *  Inputs:
+ *    fileDescriptor: File to write to. Must stay open until the writer is
+ *      finished.
+ *    fileSrc:        Path of the same file, used to open it with O_DIRECT.
+ *      May be NULL if useDirectIo is false.
+ *    useDirectIo:    If true, try to write around the page cache.
+ *
+ *  Returns:
+ *    Pointer to the new writer, or NULL on allocation failure.
+ */
+struct AwFmFileWriter *
+awFmFileWriterCreate(const int fileDescriptor,
+                     const char *_RESTRICT_ const fileSrc,
+                     const bool useDirectIo);
+
+/*
+ * Function:  awFmFileWriterSubmit
+ * --------------------
+ * Queues a write of the buffer to the given file offset, and returns without
+ * waiting for it. The buffer must stay valid and unchanged until
+ * awFmFileWriterFinish returns.
+ *
+ *  Inputs:
+ *    writer:     Writer to queue the write on.
+ *    buffer:     Data to write.
+ *    length:     Number of bytes to write.
+ *    fileOffset: Offset in the file to write the data to.
+ *
+ *  Returns:
+ *    AwFmSuccess if the write was queued, or AwFmAllocationFailure.
+ */
+enum AwFmReturnCode
+awFmFileWriterSubmit(struct AwFmFileWriter *_RESTRICT_ const writer,
+                     const void *_RESTRICT_ const buffer, const size_t length,
+                     const size_t fileOffset);
+
+/*
+ * Function:  awFmFileWriterSubmitCopy
+ * --------------------
+ * Like awFmFileWriterSubmit, but writes a copy of the buffer, so the buffer
+ * may be reused as soon as this function returns. Meant for small sections
+ * like the file header.
+ */
+enum AwFmReturnCode
+awFmFileWriterSubmitCopy(struct AwFmFileWriter *_RESTRICT_ const writer,
+                         const void *_RESTRICT_ const buffer,
+                         const size_t length, const size_t fileOffset);
+
+/*
+ * Function:  awFmFileWriterFinish
+ * --------------------
+ * Waits for every queued write, flushes the file to storage with a single
+ * fsync(), and deallocates the writer.
+ *
+ *  Inputs:
+ *    writer:       Writer to finish.
+ *    writeSeconds: If not NULL, set to the time the background thread spent
+ *      writing and syncing.
+ *    waitSeconds:  If not NULL, set to the time this function spent waiting
+ *      for the writes to complete. Any write time beyond this overlapped with
+ *      the caller's own work.
+ *
+ *  Returns:
+ *    AwFmFileWriteOkay if every write succeeded, or AwFmFileWriteFail.
+ */
+enum AwFmReturnCode
+awFmFileWriterFinish(struct AwFmFileWriter *_RESTRICT_ const writer,
+                     double *_RESTRICT_ const writeSeconds,
+                     double *_RESTRICT_ const waitSeconds);
+
+#endif /* end of include guard: AW_FM_FILE_WRITER_H */
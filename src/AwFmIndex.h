@@ -26,10 +26,27 @@
 #define AW_FM_AMINO_VECTORS_PER_WINDOW 5
 #define AW_FM_AMINO_CARDINALITY 20
 
+#define AW_FM_REDUCED_AMINO_VECTORS_PER_WINDOW 4
+#define AW_FM_REDUCED_AMINO_CARDINALITY 11
+
 enum AwFmAlphabetType {
   AwFmAlphabetAmino = 1,
   AwFmAlphabetDna = 2,
-  AwFmAlphabetRna = 3
+  AwFmAlphabetRna = 3,
+  // amino acids grouped into at most AW_FM_REDUCED_AMINO_CARDINALITY letters
+  // by the build options' reducedAminoLetterMap.
+  AwFmAlphabetReducedAmino = 4
+};
+
+// Controls how the BWT block list and kmer seed table are allocated. Huge page
+// policies reduce TLB misses on the random accesses made by backward search.
+// If the requested policy is unavailable, allocation falls back to 2MB pages,
+// then to transparent huge pages, then to the default heap allocation.
+enum AwFmAllocationPolicy {
+  AwFmAllocationPolicyDefault = 0,
+  AwFmAllocationPolicyTransparentHugePages = 1,
+  AwFmAllocationPolicyHugePages2MB = 2,
+  AwFmAllocationPolicyHugePages1GB = 3
 };
 
 // NOTE: not currently used, but this enum is kept for future use.
@@ -64,9 +81,16 @@ struct AwFmNucleotideBlock {
                            4]; //+4 is for sentinel count and 32B padding
 };
 
+// +5 is for the ambiguity and sentinel counts, and pads the block out to 256B.
+struct AwFmReducedAminoBlock {
+  AwFmSimdVec256 letterBitVectors[AW_FM_REDUCED_AMINO_VECTORS_PER_WINDOW];
+  uint64_t baseOccurrences[AW_FM_REDUCED_AMINO_CARDINALITY + 5];
+};
+
 union AwFmBwtBlockList {
   struct AwFmNucleotideBlock *asNucleotide;
   struct AwFmAminoBlock *asAmino;
+  struct AwFmReducedAminoBlock *asReducedAmino;
 };
 
 /*Struct for the configuration in the AwFmIndex struct.
@@ -90,6 +114,33 @@ struct AwFmSearchRange {
   uint64_t endPtr;
 };
 
+// a forward index paired with an index of its reversed sequence, so a match
+// can be extended by a letter on either end.
+struct AwFmBiDirectionalIndex {
+  struct AwFmIndex *forwardIndex;
+  struct AwFmIndex *reverseIndex;
+  uint64_t forwardSentinelPosition;
+  uint64_t reverseSentinelPosition;
+};
+
+// the matches of a pattern, as the range of the pattern in the forward index
+// and of the reversed pattern in the reverse index. Both ranges hold length
+// positions, and the pattern is absent if length is 0.
+struct AwFmBiDirectionalRange {
+  uint64_t forwardStartPtr;
+  uint64_t reverseStartPtr;
+  uint64_t length;
+};
+
+// opaque, defined in AwFmNuma.c.
+struct AwFmNumaReplicaSet;
+// opaque, defined in AwFmPageCache.c.
+struct AwFmPageCache;
+// opaque, defined in AwFmDeltaIndex.c.
+struct AwFmDeltaIndex;
+// opaque, defined in AwFmAsyncRead.c.
+struct AwFmAsyncFileReaderPool;
+
 // feature flags, hardcode version
 struct AwFmIndex {
   uint32_t versionNumber;
@@ -106,6 +157,27 @@ struct AwFmIndex {
   // optional member data, dependant on the index version.
   struct FastaVector *fastaVector; // ptr should be null if not in use.
   struct AwFmCompressedSuffixArray suffixArray;
+  // policy the index was allocated with, also used for its NUMA replicas.
+  enum AwFmAllocationPolicy allocationPolicy;
+  // if set, the index file is written with O_DIRECT.
+  bool useDirectIo;
+  // policies that actually back the bwt and kmer seed table allocations.
+  enum AwFmAllocationPolicy bwtAllocationPolicy;
+  enum AwFmAllocationPolicy kmerSeedTableAllocationPolicy;
+  // per-node copies of the bwt and seed table, NULL if not replicated.
+  struct AwFmNumaReplicaSet *numaReplicas;
+  // shared cache of suffix array pages, NULL if the suffix array is in memory
+  // or the cache isn't enabled.
+  struct AwFmPageCache *suffixArrayCache;
+  // cache of BWT chunks when the BWT was left on disk, in which case
+  // bwtBlockList is NULL. NULL when the BWT is in memory.
+  struct AwFmPageCache *bwtCache;
+  // readers for batched suffix array reads, reused across locates so each
+  // one doesn't set up its own io_uring instance or read threads.
+  struct AwFmAsyncFileReaderPool *suffixArrayReaderPool;
+  // letter index of each amino acid letter index in a reduced amino index,
+  // including the ambiguity and sentinel letters. Unused by other alphabets.
+  uint8_t reducedAminoLetterMap[AW_FM_AMINO_CARDINALITY + 2];
 };
 
 struct AwFmKmerSearchData {
@@ -122,6 +194,298 @@ struct AwFmKmerSearchList {
   struct AwFmKmerSearchData *kmerSearchData;
 };
 
+// a super-maximal exact match: an exact match of the query that isn't
+// contained in any longer one. positionList is only set if the search
+// located the matches, and holds range.length positions.
+struct AwFmSmem {
+  uint64_t queryStart;
+  uint64_t length;
+  struct AwFmBiDirectionalRange range;
+  uint64_t *positionList;
+};
+
+struct AwFmSmemSearchData {
+  char *queryString;
+  uint64_t queryLength;
+  struct AwFmSmem *smems;
+  uint32_t count;
+  uint32_t capacity;
+};
+
+struct AwFmSmemSearchList {
+  size_t capacity;
+  size_t count;
+  struct AwFmSmemSearchData *smemSearchData;
+};
+
+// the longest substring ending at a query position that occurs in the
+// database, given by its length and its BWT range. The length is 0, and the
+// range invalid, if the letter at that position doesn't occur.
+struct AwFmMatchingStatistic {
+  uint64_t length;
+  struct AwFmSearchRange range;
+};
+
+struct AwFmMatchingStatisticsData {
+  char *queryString;
+  uint64_t queryLength;
+  // one per query position, allocated by the search.
+  struct AwFmMatchingStatistic *statistics;
+  uint64_t capacity;
+};
+
+struct AwFmMatchingStatisticsList {
+  size_t capacity;
+  size_t count;
+  struct AwFmMatchingStatisticsData *statisticsData;
+};
+
+// hits of every kmer window of a sequence, laid out by window. Window i is
+// the kmer starting at sequence position i, and its hits are positions
+// offsets[i] through offsets[i + 1] - 1.
+struct AwFmWindowHits {
+  uint64_t numWindows;
+  uint64_t *offsets;
+  uint64_t *positions;
+};
+
+// a database string within the search's mismatch limit of the kmer, with
+// numMismatches substitutions. positionList is only set if the search located
+// the matches, and holds one position per element of the range.
+struct AwFmMismatchHit {
+  struct AwFmSearchRange range;
+  uint8_t numMismatches;
+  uint64_t *positionList;
+};
+
+struct AwFmMismatchSearchData {
+  char *kmerString;
+  uint64_t kmerLength;
+  struct AwFmMismatchHit *hits;
+  uint32_t count;
+  uint32_t capacity;
+};
+
+struct AwFmMismatchSearchList {
+  size_t capacity;
+  size_t count;
+  struct AwFmMismatchSearchData *mismatchSearchData;
+};
+
+// a database word scoring at least the search's minimum score against the
+// query, along with its score. positionList is only set if the search
+// located the matches, and holds one position per element of the range.
+struct AwFmNeighborhoodHit {
+  struct AwFmSearchRange range;
+  int32_t score;
+  uint64_t *positionList;
+};
+
+// a query word, scored either by a profile with a row of scores for each of
+// its positions, or by the search's substitution matrix if profile is NULL.
+// Profile rows are indexed by letter index, ambiguity letter included, so
+// they're one longer than the alphabet's cardinality.
+struct AwFmNeighborhoodSearchData {
+  char *kmerString;
+  uint64_t kmerLength;
+  const int16_t *profile;
+  struct AwFmNeighborhoodHit *hits;
+  uint32_t count;
+  uint32_t capacity;
+};
+
+struct AwFmNeighborhoodSearchList {
+  size_t capacity;
+  size_t count;
+  struct AwFmNeighborhoodSearchData *neighborhoodSearchData;
+};
+
+// a database position matching a peptide kmer translated from a read. Frames
+// 0 through 2 translate the read starting at that offset, and frames 3
+// through 5 translate its reverse complement starting at offset frame - 3.
+// readPosition is the first read position, on the forward strand, of the
+// codons the kmer was translated from, so the kmer covers read positions
+// readPosition through readPosition + (3 * kmerLength) - 1 on either strand.
+struct AwFmTranslatedHit {
+  uint64_t databasePosition;
+  uint64_t readPosition;
+  uint8_t frame;
+};
+
+struct AwFmTranslatedSearchData {
+  char *readString;
+  uint64_t readLength;
+  struct AwFmTranslatedHit *hits;
+  uint32_t count;
+  uint32_t capacity;
+};
+
+struct AwFmTranslatedSearchList {
+  size_t capacity;
+  size_t count;
+  struct AwFmTranslatedSearchData *translatedSearchData;
+};
+
+// a spaced seed pattern, with '1' at care positions, where a kmer's letter
+// has to match, and '0' at don't care positions, which match any letter. If
+// tableCareLength is nonzero, the seed has a table of the ranges of every
+// combination of letters at the pattern's last tableCareLength care
+// positions, covering its last tableWidth positions. Entry i's ranges are
+// tableRanges[tableOffsets[i]] through tableRanges[tableOffsets[i + 1] - 1].
+// The table is only valid for the index the seed was made for.
+struct AwFmSpacedSeed {
+  char *pattern;
+  uint64_t patternLength;
+  uint64_t careLength;
+  uint8_t tableCareLength;
+  uint64_t tableWidth;
+  uint64_t *tableOffsets;
+  struct AwFmSearchRange *tableRanges;
+};
+
+// a database string matching the kmer at every care position of the spaced
+// seed. positionList is only set if the search located the matches, and
+// holds one position per element of the range.
+struct AwFmSpacedSeedHit {
+  struct AwFmSearchRange range;
+  uint64_t *positionList;
+};
+
+// a kmer of at least the seed's patternLength letters. exceededRangeLimit is
+// set if the kmer's search needed more ranges than the search's limit, in
+// which case it has no hits.
+struct AwFmSpacedSeedSearchData {
+  char *kmerString;
+  struct AwFmSpacedSeedHit *hits;
+  uint32_t count;
+  uint32_t capacity;
+  bool exceededRangeLimit;
+};
+
+struct AwFmSpacedSeedSearchList {
+  size_t capacity;
+  size_t count;
+  struct AwFmSpacedSeedSearchData *spacedSeedSearchData;
+};
+
+/*Struct for configuring how an index file is loaded by
+ * awFmReadIndexFromFileParallel.*/
+struct AwFmIndexLoadConfiguration {
+  bool keepSuffixArrayInMemory;
+  uint32_t numThreads;
+  enum AwFmAllocationPolicy allocationPolicy;
+  // if set, awFmReplicateIndexAcrossNumaNodes is called on the loaded index.
+  bool replicateAcrossNumaNodes;
+  // if nonzero and the suffix array stays on disk, awFmEnableSuffixArrayCache
+  // is called on the loaded index with this capacity.
+  size_t suffixArrayCacheCapacity;
+  // if set, the BWT is left in the index file, and blocks are read on demand
+  // through a cache of bwtCacheCapacity bytes (0 selects a 256MB default).
+  bool keepBwtOnDisk;
+  size_t bwtCacheCapacity;
+};
+
+/*Per-section timing data collected while loading an index file. Each section
+ * time is the wall time between the first and last read touching that section,
+ * so sections that were read concurrently will have overlapping times.*/
+struct AwFmIndexLoadStatistics {
+  double headerSeconds;
+  double bwtSeconds;
+  double prefixSumsSeconds;
+  double kmerSeedTableSeconds;
+  double suffixArraySeconds;
+  double fastaVectorSeconds;
+  double numaReplicationSeconds;
+  double totalSeconds;
+  uint64_t bytesRead;
+};
+
+/*Phases of an index build, in the order they run. Low-memory builds stream
+ * the BWT and the sampled suffix array out of the suffix sort, so they spend
+ * no time in AwFmBuildPhaseBwt or AwFmBuildPhaseSuffixArraySampling.*/
+enum AwFmBuildPhase {
+  // reading the fasta file, and writing the original sequence to the index
+  // file if it's stored.
+  AwFmBuildPhaseReadSequence = 0,
+  AwFmBuildPhaseSanitize = 1,
+  AwFmBuildPhaseSuffixSort = 2,
+  AwFmBuildPhaseBwt = 3,
+  AwFmBuildPhaseSuffixArraySampling = 4,
+  AwFmBuildPhaseKmerSeedTable = 5,
+  // waiting for the index file writes that didn't overlap other phases.
+  AwFmBuildPhaseFileWrite = 6
+};
+#define AW_FM_NUM_BUILD_PHASES 7
+
+/*Resources used by one phase of an index build. cpuSeconds counts every
+ * thread of the process, so it exceeds wallSeconds when a phase runs in
+ * parallel. On Linux, peakResidentBytes is the process's peak resident set
+ * size if it rose during the phase, or else the larger of the resident sizes
+ * at the phase's start and end. Elsewhere, it's the peak since the process
+ * started.*/
+struct AwFmBuildPhaseStatistics {
+  double wallSeconds;
+  double cpuSeconds;
+  size_t peakResidentBytes;
+};
+
+/*Details of an index build, filled in by awFmCreateIndexWithOptions,
+ * awFmCreateIndexFromFastaWithOptions, and awFmMergeIndices when the build
+ * options' buildStatistics is set.*/
+struct AwFmBuildStatistics {
+  // constructionMemoryBudget of the build, 0 for an in-memory build.
+  size_t memoryBudget;
+  // most memory allocated at once by the build, not counting the sequence
+  // passed to awFmCreateIndex.
+  size_t peakConstructionBytes;
+  // number of partitions the suffix array was sorted in, 1 for an in-memory
+  // build.
+  uint32_t suffixArrayPartitions;
+  // period of the difference cover sample used by a low-memory build.
+  uint32_t differenceCoverPeriod;
+  // time spent writing the index file, including the final fsync, and how
+  // long the build waited on the writes after finishing everything else. The
+  // rest of the write time overlapped with construction.
+  double fileWriteSeconds;
+  double fileWriteWaitSeconds;
+  // indexed by enum AwFmBuildPhase. Phases a build skips are left zeroed.
+  struct AwFmBuildPhaseStatistics phases[AW_FM_NUM_BUILD_PHASES];
+};
+
+/*Optional settings for building an index that aren't part of its
+ * configuration, passed to awFmCreateIndexWithOptions,
+ * awFmCreateIndexFromFastaWithOptions, and awFmMergeIndices. None of them
+ * except reducedAminoLetterMap are stored in the index file. Passing NULL
+ * options is the same as passing a zeroed struct.*/
+struct AwFmIndexBuildOptions {
+  enum AwFmAllocationPolicy allocationPolicy;
+  // a nonzero budget builds the index in low-memory mode, keeping the memory
+  // allocated during construction under this many bytes.
+  size_t constructionMemoryBudget;
+  // if set, filled with details of the build.
+  struct AwFmBuildStatistics *buildStatistics;
+  // if set, the index file is written with O_DIRECT where the file system
+  // supports it.
+  bool useDirectIo;
+  // for AwFmAlphabetReducedAmino, the reduced letter of each amino acid, by
+  // its position in "acdefghiklmnpqrstvwy". Each of the 20 values must be less
+  // than AW_FM_REDUCED_AMINO_CARDINALITY. If NULL, amino acids are grouped as
+  // [kredqn] c g h [ilv] m f y w p [sta].
+  const uint8_t *reducedAminoLetterMap;
+};
+
+/*Hit and miss counts for a page cache, from
+ * awFmGetSuffixArrayCacheStatistics.*/
+struct AwFmCacheStatistics {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  // reads that failed to read the index file.
+  uint64_t readFailures;
+  size_t capacityInBytes;
+  size_t pageSize;
+};
+
 // for internal use during backtrace, you can likely ignore this
 struct AwFmBacktrace {
   uint64_t position;
@@ -135,7 +499,8 @@ enum AwFmReturnCode{
   AwFmNullPtrError        = -4,   AwFmSuffixArrayCreationFailure  = -5,   AwFmIllegalPositionError  = -6,
   AwFmNoFileSrcGiven      = -7,   AwFmNoDatabaseSequenceGiven     = -8,   AwFmFileFormatError       = -9,
   AwFmFileOpenFail        = -10,  AwFmFileReadFail                = -11,  AwFmFileWriteFail         = -12,
-  AwFmErrorDbSequenceNull = -13,  AwFmErrorSuffixArrayNull        = -14,  AwFmFileAlreadyExists     = -15};
+  AwFmErrorDbSequenceNull = -13,  AwFmErrorSuffixArrayNull        = -14,  AwFmFileAlreadyExists     = -15,
+  AwFmFeatureUnsupported  = -16,  AwFmInsufficientMemoryBudget    = -17,  AwFmIncompatibleIndices   = -18};
 /* clang-format on */
 
 /*
@@ -160,6 +525,8 @@ enum AwFmReturnCode{
  * fileSrc, but allowOverwite was false. AwFmSuffixArrayCreationFailure if an
  * error was caused by divsufsort64 in suffix array creation. AwFmFileWriteFail
  * if a file write failed.
+ *
+ *  Same as awFmCreateIndexWithOptions with NULL options.
  */
 enum AwFmReturnCode
 awFmCreateIndex(struct AwFmIndex *_RESTRICT_ *index,
@@ -168,12 +535,55 @@ awFmCreateIndex(struct AwFmIndex *_RESTRICT_ *index,
                 const size_t sequenceLength,
                 const char *_RESTRICT_ const fileSrc);
 
+/*
+ * Function:  awFmCreateIndexWithOptions
+ * --------------------
+ * Allocates a new AwFmIndex from the sequence like awFmCreateIndex, with
+ * build options that aren't part of the index's configuration.
+ *
+ *  Inputs:
+ *    index:          Double pointer to a AwFmIndex struct to be allocated and
+ *      constructed.
+ *    config:         Fully initialized index config to construct the index
+ *      with. This configuration will be memcpy'd into the created index.
+ *    sequence:       Database sequence that the AwFmIndex is built from.
+ *    sequenceLength: Length of the sequence.
+ *    fileSrc:        File path to write the Index file to.
+ *    options:        Build options, or NULL to use the defaults.
+ *
+ *  Returns:
+ *    Any return of awFmCreateIndex, or
+ *      AwFmInsufficientMemoryBudget if the options' constructionMemoryBudget
+ *      is too small to build the index.
+ *      AwFmIllegalPositionError if the options' reducedAminoLetterMap maps an
+ *      amino acid past the reduced alphabet.
+ *
+ *  If options->constructionMemoryBudget is nonzero, the index is built in
+ *  low-memory mode. The suffix array is sorted in partitions that fit the
+ *  budget, and each partition is streamed into the BWT and the suffix array
+ *  section of the file, so the full suffix array is never held in memory.
+ *  The budget must hold the sequence, the BWT, and the kmer seed table, and
+ *  roughly 2 more bytes per position for the suffix sort; more budget makes
+ *  the build faster. The index file is equivalent to an in-memory build.
+ */
+enum AwFmReturnCode awFmCreateIndexWithOptions(
+    struct AwFmIndex *_RESTRICT_ *index,
+    struct AwFmIndexConfiguration *_RESTRICT_ const config,
+    const uint8_t *_RESTRICT_ const sequence, const size_t sequenceLength,
+    const char *_RESTRICT_ const fileSrc,
+    const struct AwFmIndexBuildOptions *_RESTRICT_ const options);
+
 /*
  * Function:  awFmCreateIndexFromFasta
  * --------------------
  * Loads the sequence and header data from the given fasta, and a allocates a
  * new AwFmIndex from the sequence using the given configuration.
  *
+ *  The fasta is streamed in large chunks straight into the buffer the index is
+ *  built from, so only one copy of the sequence is held, and fastaSrc may be a
+ *  pipe (like /dev/stdin). Only the headers and sequence boundaries are kept
+ *  in the index's FastaVector.
+ *
  *  Inputs:
  *    index:          Double pointer to a AwFmIndex struct to be allocated and
  * constructed. configuration:       Fully initialized config struct to
@@ -187,11 +597,14 @@ awFmCreateIndex(struct AwFmIndex *_RESTRICT_ *index,
  *      AwFmFileWriteOkay on success.
  *      AwFmNullPtrError on passing an argument as a null ptr
  *      AwFmFileOpenFail if the fasta cannot be opened for reading.
+ *      AwFmFileReadFail if reading the fasta failed.
  *      AwFmAllocationFailure if memory could not be allocated during the
  * creation process. AwFmFileAlreadyExists if a file exists at the given
  * fileSrc, but allowOverwite was false. AwFmSuffixArrayCreationFailure if an
  * error was caused by divsufsort64 in suffix array creation. AwFmFileWriteFail
  * if a file write failed.
+ *
+ *  Same as awFmCreateIndexFromFastaWithOptions with NULL options.
  */
 enum AwFmReturnCode
 awFmCreateIndexFromFasta(struct AwFmIndex *_RESTRICT_ *index,
@@ -199,6 +612,751 @@ awFmCreateIndexFromFasta(struct AwFmIndex *_RESTRICT_ *index,
                          const char *fastaSrc,
                          const char *_RESTRICT_ const indexFileSrc);
 
+/*
+ * Function:  awFmCreateIndexFromFastaWithOptions
+ * --------------------
+ * Builds a new AwFmIndex from the given fasta like awFmCreateIndexFromFasta,
+ * with build options that aren't part of the index's configuration.
+ *
+ *  Inputs:
+ *    index:          Double pointer to a AwFmIndex struct to be allocated and
+ *      constructed.
+ *    config:         Fully initialized config struct to construct the index
+ *      with. This config will be memcpy'd into the created index.
+ *    fastaSrc:       File source of the fasta to use to generate the index.
+ *      Every sequence in the fasta file will be included in the index.
+ *    indexFileSrc:   File path to write the Index file to.
+ *    options:        Build options, or NULL to use the defaults.
+ *
+ *  Returns:
+ *    Any return of awFmCreateIndexFromFasta, or
+ *      AwFmInsufficientMemoryBudget if the options' constructionMemoryBudget
+ *      is too small to build the index.
+ *      AwFmIllegalPositionError if the options' reducedAminoLetterMap maps an
+ *      amino acid past the reduced alphabet.
+ *
+ *  A nonzero options->constructionMemoryBudget builds the index in low-memory
+ *  mode, as described for awFmCreateIndexWithOptions.
+ */
+enum AwFmReturnCode awFmCreateIndexFromFastaWithOptions(
+    struct AwFmIndex *_RESTRICT_ *index,
+    struct AwFmIndexConfiguration *_RESTRICT_ const config,
+    const char *fastaSrc, const char *_RESTRICT_ const indexFileSrc,
+    const struct AwFmIndexBuildOptions *_RESTRICT_ const options);
+
+/*
+ * Function:  awFmMergeIndices
+ * --------------------
+ * Builds a new index over the sequences of two existing indices, without
+ * suffix sorting the second index again. The merged index is the same as an
+ * index built from a fasta file holding every sequence of firstIndex followed
+ * by every sequence of secondIndex. Indices built from a sequence rather than a
+ * fasta file count as a single sequence with an empty header.
+ *
+ * Only the suffixes of firstIndex's sequences are sorted, against the BWT of
+ * secondIndex, so the merge is fastest when firstIndex is the smaller of the
+ * two, e.g. when it holds a batch of new sequences being added to a large
+ * reference. The suffix array samples and the kmer seed table are rebuilt
+ * from the merged BWT, which takes one pass over all of its positions.
+ *
+ *  Inputs:
+ *    mergedIndex:  Double pointer to the AwFmIndex struct to be allocated and
+ *      constructed.
+ *    config:       Configuration of the merged index. Its alphabetType must
+ *      match both indices. If storeOriginalSequence is set, both indices must
+ *      store their original sequences, which are copied into the new index.
+ *    firstIndex:   Index whose sequences come first in the merged index.
+ *    secondIndex:  Index whose sequences come after firstIndex's.
+ *    fileSrc:      File path to write the merged index file to.
+ *    options:      Build options, or NULL to use the defaults. The memory
+ *      budget and letter map are ignored.
+ *
+ *  Returns:
+ *    AwFmReturnCode represnting the result of the merge. Possible returns are:
+ *      AwFmFileWriteOkay on success.
+ *      AwFmNullPtrError on passing an argument as a null ptr.
+ *      AwFmIncompatibleIndices if the alphabets don't match, or if the original
+ *        sequence was requested and one of the indices doesn't store it.
+ *      AwFmNoDatabaseSequenceGiven if either index holds an empty sequence.
+ *      AwFmAllocationFailure if memory could not be allocated.
+ *      AwFmFileAlreadyExists if the file could not be created.
+ *      AwFmFileReadFail if an original sequence could not be read.
+ *      AwFmFileWriteFail if a file write failed.
+ */
+enum AwFmReturnCode
+awFmMergeIndices(struct AwFmIndex *_RESTRICT_ *mergedIndex,
+                 const struct AwFmIndexConfiguration *_RESTRICT_ const config,
+                 const struct AwFmIndex *const firstIndex,
+                 const struct AwFmIndex *const secondIndex,
+                 const char *_RESTRICT_ const fileSrc,
+                 const struct AwFmIndexBuildOptions *_RESTRICT_ const options);
+
+/*
+ * Function:  awFmDeltaIndexCreate
+ * --------------------
+ * Wraps an index in a delta index, which makes sequences searchable as soon
+ *  as they're appended. Appended sequences go into a small delta index that's
+ *  rebuilt on every append, and are merged into the main index by a
+ *  compaction that runs in the background. Searches run against both, and
+ *  report hits in global positions, which count the main index's sequence
+ *  followed by every appended sequence in the order it was appended. Global
+ *  positions don't change when sequences are compacted.
+ *
+ *  Searches may run from any number of threads alongside appends and
+ *  compactions. Each search uses the indices that were current when it
+ *  started, so it sees each append or compaction either completely or not at
+ *  all.
+ *
+ *  The delta index's working files are named by appending ".delta.fasta",
+ *  ".delta.awfmi", and ".compacting.awfmi" to fileSrcPrefix, and are removed
+ *  as soon as they're read. Each compacted main index is kept at
+ *  fileSrcPrefix followed by ".main.awfmi", replacing the last one.
+ *
+ *  Inputs:
+ *    deltaIndex:     Double pointer to the delta index to be allocated.
+ *    mainIndex:      Index to add sequences to. On success, the delta index
+ *      owns it, and deallocates it once it's been compacted and no search is
+ *      using it.
+ *    config:         Configuration of the delta indices and the compacted
+ *      main indices. Its alphabet must match mainIndex's. If
+ *      storeOriginalSequence is set, mainIndex must store its sequence, too.
+ *    fileSrcPrefix:  Path prefix of the delta index's files.
+ *
+ *  Returns:
+ *    AwFmSuccess on success, AwFmNullPtrError if an argument was NULL,
+ *      AwFmIncompatibleIndices if the alphabets don't match, or
+ *      AwFmAllocationFailure.
+ */
+enum AwFmReturnCode awFmDeltaIndexCreate(
+    struct AwFmDeltaIndex *_RESTRICT_ *deltaIndex,
+    struct AwFmIndex *_RESTRICT_ const mainIndex,
+    const struct AwFmIndexConfiguration *_RESTRICT_ const config,
+    const char *_RESTRICT_ const fileSrcPrefix);
+
+/*
+ * Function:  awFmDeltaIndexAppendSequence
+ * --------------------
+ * Appends a sequence, and rebuilds the delta index so that searches started
+ *  after this function returns find it. Appends are serialized with each
+ *  other, and rebuild time grows with the number of sequences appended since
+ *  the last compaction.
+ *
+ *  Inputs:
+ *    deltaIndex:      Delta index to append to.
+ *    header:          Header of the sequence, as a single line without the
+ *      leading '>'. May be NULL for an empty header.
+ *    sequence:        Sequence to append.
+ *    sequenceLength:  Length of the sequence.
+ *
+ *  Returns:
+ *    AwFmSuccess on success, AwFmNoDatabaseSequenceGiven if the sequence is
+ *      empty, or the error that stopped the delta from being rebuilt, in which
+ *      case the sequence is not appended.
+ */
+enum AwFmReturnCode awFmDeltaIndexAppendSequence(
+    struct AwFmDeltaIndex *_RESTRICT_ const deltaIndex,
+    const char *_RESTRICT_ const header, const char *_RESTRICT_ const sequence,
+    const size_t sequenceLength);
+
+/*
+ * Function:  awFmDeltaIndexStartCompaction
+ * --------------------
+ * Starts merging every sequence in the delta into a new main index on a
+ *  background thread, with awFmMergeIndices. Appends and searches continue in
+ *  the meantime; sequences appended after this call stay in the delta. Does
+ *  nothing if a compaction is already running, or the delta is empty.
+ *
+ *  Returns:
+ *    AwFmSuccess if the compaction started or wasn't needed, or
+ *      AwFmAllocationFailure.
+ */
+enum AwFmReturnCode awFmDeltaIndexStartCompaction(
+    struct AwFmDeltaIndex *_RESTRICT_ const deltaIndex);
+
+/*
+ * Function:  awFmDeltaIndexWaitForCompaction
+ * --------------------
+ * Waits for the running compaction, if any, to finish.
+ *
+ *  Returns:
+ *    Result of the last compaction: AwFmSuccess if it succeeded or none has
+ *      run, or the error it failed with. A failed compaction leaves its
+ *      sequences in the delta.
+ */
+enum AwFmReturnCode awFmDeltaIndexWaitForCompaction(
+    struct AwFmDeltaIndex *_RESTRICT_ const deltaIndex);
+
+/*
+ * Function:  awFmDeltaIndexParallelSearchLocate
+ * --------------------
+ * Like awFmParallelSearchLocate, but finds the kmers in both the main index
+ *  and the delta, and reports each hit as a global position. Hits from the
+ *  main index come first. Hits that would span two sequences are left out,
+ *  since which sequences are stored next to each other changes as they're
+ *  compacted.
+ *
+ *  Returns:
+ *    AwFmSuccess on success, AwFmNullPtrError if deltaIndex or searchList is
+ *      NULL, AwFmFileReadFail if a suffix array read failed, or
+ *      AwFmAllocationFailure.
+ */
+enum AwFmReturnCode awFmDeltaIndexParallelSearchLocate(
+    struct AwFmDeltaIndex *_RESTRICT_ const deltaIndex,
+    struct AwFmKmerSearchList *_RESTRICT_ const searchList,
+    uint32_t numThreads);
+
+/*
+ * Function:  awFmDeltaIndexGetSequenceLength
+ * --------------------
+ * Returns the length of the main index's sequence plus every appended
+ *  sequence, which bounds the global positions.
+ */
+uint64_t awFmDeltaIndexGetSequenceLength(
+    struct AwFmDeltaIndex *_RESTRICT_ const deltaIndex);
+
+/*
+ * Function:  awFmDeallocDeltaIndex
+ * --------------------
+ * Waits for any running compaction, and deallocates the delta index along
+ *  with its main index. No search may be running on it.
+ */
+void awFmDeallocDeltaIndex(struct AwFmDeltaIndex *deltaIndex);
+
+/*
+ * Function:  awFmCreateBiDirectionalIndex
+ * --------------------
+ * Pairs an existing index with an index of its reversed sequence, which is
+ *  recovered from the forward index's BWT and written to its own file. The
+ *  reverse index is only used for its BWT, so it samples its suffix array as
+ *  sparsely as possible and doesn't store the sequence.
+ *
+ *  Inputs:
+ *    biIndex:             Set to the new bidirectional index on success.
+ *    forwardIndex:        Index to pair. On success, the bidirectional index
+ *      owns it, and deallocates it with itself.
+ *    reverseIndexFileSrc: File path to write the reverse index to.
+ *
+ *  Returns:
+ *    AwFmFileWriteOkay on success, or the error returned while building the
+ *      reverse index.
+ */
+enum AwFmReturnCode awFmCreateBiDirectionalIndex(
+    struct AwFmBiDirectionalIndex *_RESTRICT_ *biIndex,
+    struct AwFmIndex *_RESTRICT_ const forwardIndex,
+    const char *_RESTRICT_ const reverseIndexFileSrc);
+
+/*
+ * Function:  awFmReadBiDirectionalIndexFromFile
+ * --------------------
+ * Reads a forward index and the reverse index made for it by
+ *  awFmCreateBiDirectionalIndex.
+ *
+ *  Inputs:
+ *    biIndex:                 Set to the bidirectional index on success.
+ *    forwardFileSrc:          File path of the forward index.
+ *    reverseFileSrc:          File path of the reverse index.
+ *    keepSuffixArrayInMemory: Passed to awFmReadIndexFromFile for the forward
+ *      index.
+ *
+ *  Returns:
+ *    AwFmFileReadOkay on success, AwFmIncompatibleIndices if the two indices
+ *      differ in alphabet or length, or the error from reading either file.
+ */
+enum AwFmReturnCode awFmReadBiDirectionalIndexFromFile(
+    struct AwFmBiDirectionalIndex *_RESTRICT_ *biIndex,
+    const char *_RESTRICT_ const forwardFileSrc,
+    const char *_RESTRICT_ const reverseFileSrc,
+    const bool keepSuffixArrayInMemory);
+
+/*
+ * Function:  awFmDeallocBiDirectionalIndex
+ * --------------------
+ * Deallocates the bidirectional index, along with both of its indices.
+ */
+void awFmDeallocBiDirectionalIndex(struct AwFmBiDirectionalIndex *biIndex);
+
+/*
+ * Function:  awFmBiDirectionalCreateInitialRange
+ * --------------------
+ * Returns the range of a single letter, given as a letter index.
+ */
+struct AwFmBiDirectionalRange awFmBiDirectionalCreateInitialRange(
+    const struct AwFmBiDirectionalIndex *_RESTRICT_ const biIndex,
+    const uint8_t letterIndex);
+
+/*
+ * Function:  awFmBiDirectionalExtendLeft
+ * --------------------
+ * Updates the range of a pattern to the range of the letter followed by the
+ *  pattern. The forward range is stepped back as in a normal backward search,
+ *  and the reverse start is moved past the matches that the forward BWT shows
+ *  to be preceded by a lesser letter, or by nothing. Each step reads one BWT
+ *  block twice, to count every letter before both ends of the range.
+ *
+ *    The matches can be located as usual from the forward range
+ *  [forwardStartPtr, forwardStartPtr + length - 1] of the forward index.
+ *
+ *  Inputs:
+ *    biIndex:      Bidirectional index to search.
+ *    range:        Range of the pattern, updated in place. Must have a
+ *      nonzero length.
+ *    letterIndex:  Letter to prepend, which may not be the sentinel.
+ */
+void awFmBiDirectionalExtendLeft(
+    const struct AwFmBiDirectionalIndex *_RESTRICT_ const biIndex,
+    struct AwFmBiDirectionalRange *_RESTRICT_ const range,
+    const uint8_t letterIndex);
+
+/*
+ * Function:  awFmBiDirectionalExtendRight
+ * --------------------
+ * Updates the range of a pattern to the range of the pattern followed by the
+ *  letter. The mirror of awFmBiDirectionalExtendLeft, stepping the reverse
+ *  range back and moving the forward start.
+ *
+ *  Inputs:
+ *    biIndex:      Bidirectional index to search.
+ *    range:        Range of the pattern, updated in place. Must have a
+ *      nonzero length.
+ *    letterIndex:  Letter to append, which may not be the sentinel.
+ */
+void awFmBiDirectionalExtendRight(
+    const struct AwFmBiDirectionalIndex *_RESTRICT_ const biIndex,
+    struct AwFmBiDirectionalRange *_RESTRICT_ const range,
+    const uint8_t letterIndex);
+
+/*
+ * Function:  awFmCreateSmemSearchList
+ * --------------------
+ *  Allocates an AwFmSmemSearchList that can hold the given number of queries.
+ *  Like the AwFmKmerSearchList, the query strings aren't allocated, and are
+ *  only pointers to be set to the sequences to search.
+ *
+ *  Returns:
+ *    Pointer to the allocated search list, or NULL on failure.
+ */
+struct AwFmSmemSearchList *awFmCreateSmemSearchList(const size_t capacity);
+
+/*
+ * Function:  awFmDeallocSmemSearchList
+ * --------------------
+ *  Deallocates the search list, along with the SMEMs and position lists it
+ *  holds, but not the query strings.
+ */
+void awFmDeallocSmemSearchList(
+    struct AwFmSmemSearchList *_RESTRICT_ const searchList);
+
+/*
+ * Function:  awFmParallelSearchSmems
+ * --------------------
+ *  Finds the super-maximal exact matches of every query in the search list,
+ *  with the queries divided among threads. Each query is covered with a
+ *  handful of maximal matches instead of a search for every kmer in it.
+ *
+ *    Matches are grown from a query position by extending right as far as
+ *  possible, then extending every distinct range found on the way left, as
+ *  described by Li (2012). Ambiguity letters in a query are never matched,
+ *  so no SMEM spans one. Each query's SMEMs are listed by their start in the
+ *  query.
+ *
+ *  Inputs:
+ *    biIndex:          Bidirectional index to search.
+ *    searchList:       Search list with count queries. Each query's SMEMs
+ *      from any earlier search are replaced.
+ *    minSmemLength:    SMEMs shorter than this are left out.
+ *    locate:           If set, each SMEM's matches are located in the forward
+ *      index, and its positionList is set.
+ *    numThreads:       Number of threads to search with.
+ *
+ *  Returns:
+ *    AwFmSuccess on success, AwFmAllocationFailure, or AwFmFileReadFail if
+ *      a suffix array read failed while locating.
+ */
+enum AwFmReturnCode awFmParallelSearchSmems(
+    const struct AwFmBiDirectionalIndex *_RESTRICT_ const biIndex,
+    struct AwFmSmemSearchList *_RESTRICT_ const searchList,
+    const uint64_t minSmemLength, const bool locate, uint32_t numThreads);
+
+/*
+ * Function:  awFmCreateMatchingStatisticsList
+ * --------------------
+ *  Allocates an AwFmMatchingStatisticsList that can hold the given number of
+ *  queries. The query strings aren't allocated, and are only pointers to be
+ *  set to the sequences to search.
+ *
+ *  Returns:
+ *    Pointer to the allocated list, or NULL on failure.
+ */
+struct AwFmMatchingStatisticsList *
+awFmCreateMatchingStatisticsList(const size_t capacity);
+
+/*
+ * Function:  awFmDeallocMatchingStatisticsList
+ * --------------------
+ *  Deallocates the list and the statistics it holds, but not the query
+ *  strings.
+ */
+void awFmDeallocMatchingStatisticsList(
+    struct AwFmMatchingStatisticsList *_RESTRICT_ const statisticsList);
+
+/*
+ * Function:  awFmParallelMatchingStatistics
+ * --------------------
+ *  For every position of every query in the list, finds the longest substring
+ *  ending at that position that occurs in the database, with the queries
+ *  divided among threads. Only backward search is used, so any index works.
+ *
+ *    Each position is searched back from its own letter, starting from the
+ *  kmer seed table's range for the kmer that ends there whenever the match
+ *  could be that long. Since a match ending at a position is at most one
+ *  longer than the one ending before it, the search stops at that length
+ *  without stepping past it. Ambiguity letters in a query never match.
+ *
+ *  Inputs:
+ *    index:          Index to search.
+ *    statisticsList: List with count queries. Each query's statistics array
+ *      is grown to its length as needed, and filled in.
+ *    numThreads:     Number of threads to search with.
+ *
+ *  Returns:
+ *    AwFmSuccess on success, or AwFmAllocationFailure.
+ */
+enum AwFmReturnCode awFmParallelMatchingStatistics(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmMatchingStatisticsList *_RESTRICT_ const statisticsList,
+    uint32_t numThreads);
+
+/*
+ * Function:  awFmSlidingWindowSearchCount
+ * --------------------
+ *  Counts the occurrences of every length kmerLength window of the sequence,
+ *  without a search list entry per window. The seed table index of each
+ *  window is rolled from the previous window's, windows are extended in
+ *  interleaved groups like the kmers of awFmParallelSearchCount, and windows
+ *  holding an ambiguity letter are skipped with a count of 0.
+ *
+ *  Inputs:
+ *    index:          Index to search.
+ *    sequence:       Sequence whose windows are searched.
+ *    sequenceLength: Length of the sequence.
+ *    kmerLength:     Length of each window.
+ *    counts:         Output array, with a count for each of the
+ *      sequenceLength - kmerLength + 1 windows.
+ *    numThreads:     Number of threads to search with.
+ *
+ *  Returns:
+ *    AwFmSuccess on success, AwFmNullPtrError, AwFmIllegalPositionError if
+ *      kmerLength is 0, or AwFmAllocationFailure.
+ */
+enum AwFmReturnCode awFmSlidingWindowSearchCount(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    const char *_RESTRICT_ const sequence, const uint64_t sequenceLength,
+    const uint64_t kmerLength, uint64_t *_RESTRICT_ const counts,
+    uint32_t numThreads);
+
+/*
+ * Function:  awFmSlidingWindowSearchLocate
+ * --------------------
+ *  Like awFmSlidingWindowSearchCount, but locates the hits of every window.
+ *  The hits of all windows are stored in a single allocation, in window
+ *  order.
+ *
+ *  Inputs:
+ *    windowHits: Set to the allocated hits on success, to be deallocated
+ *      with awFmDeallocWindowHits.
+ *
+ *  Returns:
+ *    AwFmSuccess on success, AwFmNullPtrError, AwFmIllegalPositionError if
+ *      kmerLength is 0, AwFmAllocationFailure, or AwFmFileReadFail.
+ */
+enum AwFmReturnCode awFmSlidingWindowSearchLocate(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    const char *_RESTRICT_ const sequence, const uint64_t sequenceLength,
+    const uint64_t kmerLength, struct AwFmWindowHits *_RESTRICT_ *windowHits,
+    uint32_t numThreads);
+
+/*
+ * Function:  awFmDeallocWindowHits
+ * --------------------
+ *  Deallocates hits returned by awFmSlidingWindowSearchLocate.
+ */
+void awFmDeallocWindowHits(struct AwFmWindowHits *windowHits);
+
+/*
+ * Function:  awFmCreateMismatchSearchList
+ * --------------------
+ *  Allocates an AwFmMismatchSearchList that can hold the given number of
+ *  kmers. Like the AwFmKmerSearchList, the kmer strings aren't allocated, and
+ *  are only pointers to be set to the kmers to search.
+ *
+ *  Returns:
+ *    Pointer to the allocated search list, or NULL on failure.
+ */
+struct AwFmMismatchSearchList *
+awFmCreateMismatchSearchList(const size_t capacity);
+
+/*
+ * Function:  awFmDeallocMismatchSearchList
+ * --------------------
+ *  Deallocates the search list, along with the hits and position lists it
+ *  holds, but not the kmer strings.
+ */
+void awFmDeallocMismatchSearchList(
+    struct AwFmMismatchSearchList *_RESTRICT_ const searchList);
+
+/*
+ * Function:  awFmParallelSearchMismatches
+ * --------------------
+ *  Finds every database string within maxMismatches substitutions of each
+ *  kmer in the search list, with the kmers divided among threads. Each
+ *  distinct string found is one hit, with its BWT range and its number of
+ *  mismatches. Hits are listed in no particular order.
+ *
+ *    The search is a depth first backward search that tries every letter at
+ *  each kmer position. All of a range's letters are stepped from one block
+ *  read at each end of the range, instead of one backward step per letter.
+ *  Branches are pruned with a lower bound on the mismatches left in the rest
+ *  of the kmer, found from the kmer's pieces that don't occur in the
+ *  database, as in BWA (Li and Durbin, 2009). Once a branch has used all its
+ *  mismatches, the rest of the kmer is searched exactly. Ambiguity letters,
+ *  in a kmer or in the database, always count as mismatches.
+ *
+ *  Inputs:
+ *    index:          Index to search.
+ *    searchList:     Search list with count kmers. Each kmer's hits from any
+ *      earlier search are replaced.
+ *    maxMismatches:  Most substitutions a hit may have.
+ *    locate:         If set, each hit's matches are located, and its
+ *      positionList is set.
+ *    numThreads:     Number of threads to search with.
+ *
+ *  Returns:
+ *    AwFmSuccess on success, AwFmAllocationFailure, or AwFmFileReadFail if
+ *      a suffix array read failed while locating.
+ */
+enum AwFmReturnCode awFmParallelSearchMismatches(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmMismatchSearchList *_RESTRICT_ const searchList,
+    const uint8_t maxMismatches, const bool locate, uint32_t numThreads);
+
+/*
+ * Function:  awFmCreateNeighborhoodSearchList
+ * --------------------
+ *  Allocates an AwFmNeighborhoodSearchList that can hold the given number of
+ *  query words. The kmer strings and profiles aren't allocated, and are only
+ *  pointers to be set to each query's word or scores.
+ *
+ *  Returns:
+ *    Pointer to the allocated search list, or NULL on failure.
+ */
+struct AwFmNeighborhoodSearchList *
+awFmCreateNeighborhoodSearchList(const size_t capacity);
+
+/*
+ * Function:  awFmDeallocNeighborhoodSearchList
+ * --------------------
+ *  Deallocates the search list, along with the hits and position lists it
+ *  holds, but not the kmer strings or profiles.
+ */
+void awFmDeallocNeighborhoodSearchList(
+    struct AwFmNeighborhoodSearchList *_RESTRICT_ const searchList);
+
+/*
+ * Function:  awFmParallelSearchNeighborhood
+ * --------------------
+ *  Finds every database word that scores at least minScore against each
+ *  query in the search list, with the queries divided among threads. This
+ *  is the neighborhood of BLAST style seeding, found in one pass over the
+ *  index instead of by listing the neighbor words and searching each.
+ *
+ *    A word's score is the sum of the scores of its letters at each query
+ *  position, from the query's profile, or from the substitution matrix row
+ *  of the query's letter there. The search is a depth first backward search
+ *  that steps all of a range's letters from one block read at each end of
+ *  the range. A branch is pruned once its score plus the best score the
+ *  positions left could add falls below minScore, so words sharing a suffix
+ *  share its search. Each word found is one hit, listed in no particular
+ *  order.
+ *
+ *  Inputs:
+ *    index:                Index to search, of either alphabet.
+ *    searchList:           Search list with count queries. Each query's hits
+ *      from any earlier search are replaced.
+ *    substitutionMatrix:   Square matrix of scores, with a row for each
+ *      query letter and a column for each database letter, both by letter
+ *      index with the ambiguity letter last. Only needed if some query has
+ *      no profile.
+ *    minScore:             Lowest score of a hit.
+ *    locate:               If set, each hit's matches are located, and its
+ *      positionList is set.
+ *    numThreads:           Number of threads to search with.
+ *
+ *  Returns:
+ *    AwFmSuccess on success, AwFmNullPtrError if a query has no profile and
+ *      no matrix was given, AwFmAllocationFailure, or AwFmFileReadFail if a
+ *      suffix array read failed while locating.
+ */
+enum AwFmReturnCode awFmParallelSearchNeighborhood(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmNeighborhoodSearchList *_RESTRICT_ const searchList,
+    const int16_t *_RESTRICT_ const substitutionMatrix, const int32_t minScore,
+    const bool locate, uint32_t numThreads);
+
+/*
+ * Function:  awFmCreateTranslatedSearchList
+ * --------------------
+ *  Allocates an AwFmTranslatedSearchList that can hold the given number of
+ *  nucleotide reads. The read strings aren't allocated, and are only pointers
+ *  to be set to the reads to search.
+ *
+ *  Returns:
+ *    Pointer to the allocated search list, or NULL on failure.
+ */
+struct AwFmTranslatedSearchList *
+awFmCreateTranslatedSearchList(const size_t capacity);
+
+/*
+ * Function:  awFmDeallocTranslatedSearchList
+ * --------------------
+ *  Deallocates the search list, along with the hits it holds, but not the
+ *  read strings.
+ */
+void awFmDeallocTranslatedSearchList(
+    struct AwFmTranslatedSearchList *_RESTRICT_ const searchList);
+
+/*
+ * Function:  awFmParallelSearchTranslated
+ * --------------------
+ *  Translates each nucleotide read in all six frames with the standard
+ *  genetic code, and locates every peptide kmer of every frame in a protein
+ *  index, with the reads divided among threads. Each located position is one
+ *  hit, listed by frame, then by kmer within the frame.
+ *
+ *    Each read is translated into a per-thread buffer that's reused for
+ *  every read. The codon at each read position is translated once for both
+ *  strands, and the six frames are laid out one after another, split by an
+ *  ambiguity letter, so every kmer of the read is searched in one pass of the
+ *  interleaved window search. Stop codons and codons with an ambiguous
+ *  nucleotide translate to the ambiguity letter, so kmers containing them
+ *  have no hits.
+ *
+ *  Inputs:
+ *    index:      Amino or reduced amino index to search.
+ *    searchList: Search list with count reads. Each read's hits from any
+ *      earlier search are replaced.
+ *    kmerLength: Length of the peptide kmers, in amino acids.
+ *    numThreads: Number of threads to search with.
+ *
+ *  Returns:
+ *    AwFmSuccess on success, AwFmIllegalPositionError if kmerLength is 0,
+ *      AwFmIncompatibleIndices if the index is a nucleotide index,
+ *      AwFmAllocationFailure, or AwFmFileReadFail if a suffix array read
+ *      failed.
+ */
+enum AwFmReturnCode awFmParallelSearchTranslated(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmTranslatedSearchList *_RESTRICT_ const searchList,
+    const uint64_t kmerLength, uint32_t numThreads);
+
+/*
+ * Function:  awFmCreateSpacedSeed
+ * --------------------
+ *  Allocates a spaced seed for the pattern, and if tableCareLength is
+ *  nonzero, builds its seed table from the index. The table has one entry
+ *  per combination of letters at the pattern's last tableCareLength care
+ *  positions, holding the ranges of every string matching them, so a search
+ *  starts from the entry instead of branching through those positions. Each
+ *  letter added to the table multiplies its entries by the alphabet's
+ *  cardinality, and each don't care position it covers multiplies its ranges
+ *  by up to one more than that.
+ *
+ *  Inputs:
+ *    seed:            Set to the allocated seed on success, to be deallocated
+ *      with awFmDeallocSpacedSeed.
+ *    index:           Index the seed will search.
+ *    pattern:         Null terminated string of '1' for care positions and
+ *      '0' for don't care positions, with at least one care position.
+ *    tableCareLength: Number of care positions in the seed table, or 0 for
+ *      no table.
+ *
+ *  Returns:
+ *    AwFmSuccess on success, AwFmNullPtrError, AwFmIllegalPositionError if
+ *      the pattern is invalid or tableCareLength is more than its care
+ *      positions or makes a table of more than 2^32 entries, or
+ *      AwFmAllocationFailure.
+ */
+enum AwFmReturnCode
+awFmCreateSpacedSeed(struct AwFmSpacedSeed *_RESTRICT_ *seed,
+                     const struct AwFmIndex *_RESTRICT_ const index,
+                     const char *_RESTRICT_ const pattern,
+                     const uint8_t tableCareLength);
+
+/*
+ * Function:  awFmDeallocSpacedSeed
+ * --------------------
+ *  Deallocates the spaced seed and its seed table.
+ */
+void awFmDeallocSpacedSeed(struct AwFmSpacedSeed *seed);
+
+/*
+ * Function:  awFmCreateSpacedSeedSearchList
+ * --------------------
+ *  Allocates an AwFmSpacedSeedSearchList that can hold the given number of
+ *  kmers. Like the AwFmKmerSearchList, the kmer strings aren't allocated, and
+ *  are only pointers to be set to the kmers to search.
+ *
+ *  Returns:
+ *    Pointer to the allocated search list, or NULL on failure.
+ */
+struct AwFmSpacedSeedSearchList *
+awFmCreateSpacedSeedSearchList(const size_t capacity);
+
+/*
+ * Function:  awFmDeallocSpacedSeedSearchList
+ * --------------------
+ *  Deallocates the search list, along with the hits and position lists it
+ *  holds, but not the kmer strings.
+ */
+void awFmDeallocSpacedSeedSearchList(
+    struct AwFmSpacedSeedSearchList *_RESTRICT_ const searchList);
+
+/*
+ * Function:  awFmParallelSearchSpacedSeed
+ * --------------------
+ *  Finds every database string that matches each kmer in the search list at
+ *  the seed's care positions. Each distinct string found is one hit, with its
+ *  BWT range. Hits are listed in no particular order. Kmers with an ambiguity
+ *  letter at a care position have no hits.
+ *
+ *    The search is a backward search that keeps the ranges of every string
+ *  matching the kmer's suffix. A care position steps each range with the
+ *  kmer's letter, and a don't care position branches each range on every
+ *  letter, from one block read at each end of the range. The kmers are
+ *  sorted by their care letters, from the end of the pattern, and divided
+ *  among threads in runs, so a kmer that shares its last care letters with
+ *  the one before it reuses the ranges found for them.
+ *
+ *  Inputs:
+ *    index:      Index to search.
+ *    seed:       Spaced seed made for the index.
+ *    searchList: Search list with count kmers. Each kmer's hits from any
+ *      earlier search are replaced.
+ *    maxRanges:  Most ranges a kmer's search may keep at once. A kmer that
+ *      needs more stops, and its exceededRangeLimit is set.
+ *    locate:     If set, each hit's matches are located, and its
+ *      positionList is set.
+ *    numThreads: Number of threads to search with.
+ *
+ *  Returns:
+ *    AwFmSuccess on success, AwFmAllocationFailure, or AwFmFileReadFail if
+ *      a suffix array read failed while locating.
+ */
+enum AwFmReturnCode awFmParallelSearchSpacedSeed(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    const struct AwFmSpacedSeed *_RESTRICT_ const seed,
+    struct AwFmSpacedSeedSearchList *_RESTRICT_ const searchList,
+    const uint64_t maxRanges, const bool locate, uint32_t numThreads);
+
 /*
  * Function:  awFmDeallocIndex
  * --------------------
@@ -261,6 +1419,126 @@ enum AwFmReturnCode
 awFmReadIndexFromFile(struct AwFmIndex *_RESTRICT_ *_RESTRICT_ index,
                       const char *fileSrc, const bool keepSuffixArrayInMemory);
 
+/*
+ * Function:  awFmReadIndexFromFileParallel
+ * --------------------
+ * Reads the AwFmIndex file from the given fileSrc, splitting the BWT, kmer seed
+ * table, compressed suffix array, and FastaVector data into large chunks that
+ * are read concurrently with pread() across the requested number of threads.
+ * The resulting index is identical to one loaded with awFmReadIndexFromFile.
+ *
+ *  Inputs:
+ *    index:          Double pointer to an unallocated AwFmIndex to be
+ *        allocated and populated by this function.
+ *    fileSrc:        Path to the file containing the AwFmIndex.
+ *    loadConfig:     Configuration describing how to load the index. A
+ *        numThreads value of 0 is treated as 1.
+ *    loadStatistics: Optional out-argument that receives the time spent
+ *        loading each section of the file. May be NULL.
+ *
+ *  Returns:
+ *    AwFmReturnCode represnting the result of the read. Possible returns are:
+ *      AwFmFileReadOkay on success.
+ *      AwFmNoFileSrcGiven if fileSrc was NULL.
+ *      AwFmNullPtrError if loadConfig was NULL.
+ *      AwFmFileOpenFail if no file could be opened at the given fileSrc.
+ *      AwFmFileFormatError if the header was not correct.
+ *      AwFmUnsupportedVersionError if the file's version is not supported.
+ *      AwFmAllocationFailure on failure to allocated the necessary memory.
+ *      AwFmFileReadFail if any section of the file could not be read.
+ */
+enum AwFmReturnCode awFmReadIndexFromFileParallel(
+    struct AwFmIndex *_RESTRICT_ *_RESTRICT_ index, const char *fileSrc,
+    const struct AwFmIndexLoadConfiguration *_RESTRICT_ const loadConfig,
+    struct AwFmIndexLoadStatistics *_RESTRICT_ const loadStatistics);
+
+/*
+ * Function:  awFmReplicateIndexAcrossNumaNodes
+ * --------------------
+ * Makes a copy of the BWT and kmer seed table in the local memory of each NUMA
+ * node this process may run on. Afterwards, awFmParallelSearchLocate and
+ * awFmParallelSearchCount pin each worker thread to a node and have it read
+ * that node's copy, so memory traffic stays off the inter-socket links. The
+ * suffix array is left shared, since it's only read once per located hit.
+ *
+ * Memory use for the BWT and seed table grows by a factor of the node count.
+ * Calling this function on an index that is already replicated does nothing.
+ *
+ *  Inputs:
+ *    index:  Pointer to the AwFmIndex to replicate.
+ *
+ *  Returns:
+ *    AwFmReturnCode representing the result. Possible returns are:
+ *      AwFmSuccess on success.
+ *      AwFmNullPtrError if index was NULL.
+ *      AwFmAllocationFailure if any replica could not be allocated. The index
+ *        is left unchanged in this case.
+ *      AwFmFeatureUnsupported if thread pinning isn't supported on this
+ *        platform (currently, anything other than linux), or if the index's
+ *        BWT was left on disk.
+ */
+enum AwFmReturnCode
+awFmReplicateIndexAcrossNumaNodes(struct AwFmIndex *_RESTRICT_ const index);
+
+/*
+ * Function:  awFmGetNumaReplicaCount
+ * --------------------
+ * Returns the number of NUMA node replicas backing the index, or 0 if the
+ * index hasn't been replicated.
+ */
+uint32_t awFmGetNumaReplicaCount(const struct AwFmIndex *_RESTRICT_ const index);
+
+/*
+ * Function:  awFmEnableSuffixArrayCache
+ * --------------------
+ * Gives an index whose suffix array stays on disk a bounded, in-memory cache
+ * of suffix array pages, shared by every thread searching the index. Locate
+ * queries that hit the same regions of the suffix array, e.g., repetitive or
+ * overlapping kmers, are then answered without another trip to the file.
+ * Pages are evicted with the CLOCK algorithm once the cache is full. Calling
+ * this function again replaces the existing cache.
+ *
+ * If the suffix array is held in memory, this function does nothing.
+ *
+ *  Inputs:
+ *    index:            Pointer to the AwFmIndex to add the cache to.
+ *    capacityInBytes:  Maximum memory to use for cached pages. Must be at
+ *      least 4096 bytes.
+ *
+ *  Returns:
+ *    AwFmReturnCode representing the result. Possible returns are:
+ *      AwFmSuccess on success.
+ *      AwFmNullPtrError if index was NULL.
+ *      AwFmAllocationFailure if the cache could not be allocated.
+ */
+enum AwFmReturnCode
+awFmEnableSuffixArrayCache(struct AwFmIndex *_RESTRICT_ const index,
+                           const size_t capacityInBytes);
+
+/*
+ * Function:  awFmGetSuffixArrayCacheStatistics
+ * --------------------
+ * Fills the given struct with the suffix array cache's capacity, and the
+ * number of hits, misses, and evictions since the cache was enabled. If the
+ * index has no cache, every field is set to 0.
+ */
+void awFmGetSuffixArrayCacheStatistics(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmCacheStatistics *_RESTRICT_ const statistics);
+
+/*
+ * Function:  awFmGetBwtCacheStatistics
+ * --------------------
+ * Fills the given struct with the capacity, hit, miss, eviction, and read
+ * failure counts of the BWT block cache of an index loaded with keepBwtOnDisk.
+ * Searches that return a code report failed block reads as AwFmFileReadFail;
+ * others, like awFmParallelSearchCount, can check readFailures instead. If the
+ * BWT is in memory, every field is set to 0.
+ */
+void awFmGetBwtCacheStatistics(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmCacheStatistics *_RESTRICT_ const statistics);
+
 /*
  * Function:  awFmFindSearchRangeForString
  * --------------------
@@ -513,6 +1791,40 @@ void awFmAminoIterativeStepBackwardSearch(
     const struct AwFmIndex *_RESTRICT_ const index,
     struct AwFmSearchRange *_RESTRICT_ const range, const uint8_t letterIndex);
 
+/*
+ * Function:  awFmReducedAminoIterativeStepBackwardSearch
+ * --------------------
+ * Performs a single backward search step on the given reduced amino index.
+ *  In lieu of returning an additional value, this function updates the data
+ * pointed to by the range ptr.
+ *
+ *  Inputs:
+ *    index: AwFmIndex struct to search
+ *    range: range in the BWT that corresponds to the implicit kmer that is
+ * about to be extended. this acts as an out-parameter, and will update to the
+ * newly extended range once finished. letterIndex: letter index of the suffix
+ * character, between 0 and 10.
+ */
+void awFmReducedAminoIterativeStepBackwardSearch(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmSearchRange *_RESTRICT_ const range, const uint8_t letterIndex);
+
+/*
+ * Function:  awFmIterativeStepBackwardSearch
+ * --------------------
+ * Performs a single backward search step with the step function for the
+ *  index's alphabet.
+ *
+ *  Inputs:
+ *    index: AwFmIndex struct to search
+ *    range: range to extend, updated in place.
+ *    letterIndex: letter index of the prefix character in the index's
+ * alphabet, as given by awFmAsciiToLetterIndex.
+ */
+void awFmIterativeStepBackwardSearch(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmSearchRange *_RESTRICT_ const range, const uint8_t letterIndex);
+
 /*
  * Function:  awFmFindDatabaseHitPositions
  * --------------------
@@ -639,6 +1951,25 @@ uint8_t awFmNucleotideBacktraceReturnPreviousLetterIndex(
 uint8_t awFmAminoBacktraceReturnPreviousLetterIndex(
     const struct AwFmIndex *_RESTRICT_ const index, uint64_t *bwtPosition);
 
+/*
+ * Function:  awFmReducedAminoBacktraceReturnPreviousLetterIndex
+ * --------------------
+ *  Backtraces the given position in the bwt of a reduced amino index, and
+ * returns the the previous character to that position. The given BWT position
+ * will then be updated to refer to the position of the returned previous
+ * character.
+ *
+ *  Inputs:
+ *     index:			Pointer to the valid AwFmIndex struct.
+ *     bwtPosition:     A valid position in the fm index
+ *
+ *  Returns:
+ *    Letter index of the character found at the given position in the bwt. In
+ * other words, the letter previous in the sequence to the given position.
+ */
+uint8_t awFmReducedAminoBacktraceReturnPreviousLetterIndex(
+    const struct AwFmIndex *_RESTRICT_ const index, uint64_t *bwtPosition);
+
 /*
  * Function:  awFmGetHeaderStringFromSequenceNumber
  * --------------------
@@ -705,6 +2036,20 @@ bool awFmReturnCodeIsFailure(const enum AwFmReturnCode rc);
  */
 bool awFmReturnCodeIsSuccess(const enum AwFmReturnCode rc);
 
+/*
+ * Function:  awFmGetBuildPhaseName
+ * --------------------
+ * Returns a short, human-readable name for a phase of an index build, for
+ *  reporting AwFmBuildStatistics.
+ *
+ *  Inputs:
+ *    phase: phase to name.
+ *
+ *  Returns:
+ *    Name of the phase, or "unknown" if the phase isn't valid.
+ */
+const char *awFmGetBuildPhaseName(const enum AwFmBuildPhase phase);
+
 /*
  * Function:  awFmGetNumSequences
  * --------------------
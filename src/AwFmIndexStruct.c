@@ -1,14 +1,22 @@
 #include "AwFmIndexStruct.h"
 #include <stdlib.h>
 #include <string.h>
+#include "AwFmAsyncRead.h"
+#include "AwFmFile.h"
 #include "AwFmIndex.h"
+#include "AwFmLetter.h"
+#include "AwFmMemory.h"
+#include "AwFmNuma.h"
+#include "AwFmPageCache.h"
 #include "FastaVector.h"
 
-#define AW_FM_BWT_BYTE_ALIGNMENT 32
-
 struct AwFmIndex *
 awFmIndexAlloc(const struct AwFmIndexConfiguration *_RESTRICT_ const config,
-               const size_t bwtLength) {
+               const struct AwFmIndexBuildOptions *_RESTRICT_ const options,
+               const size_t bwtLength, const bool allocateBwt) {
+  const struct AwFmIndexBuildOptions defaultOptions = {0};
+  const struct AwFmIndexBuildOptions *buildOptions =
+      options != NULL ? options : &defaultOptions;
 
   // allocate the index
   struct AwFmIndex *index = malloc(sizeof(struct AwFmIndex));
@@ -19,6 +27,12 @@ awFmIndexAlloc(const struct AwFmIndexConfiguration *_RESTRICT_ const config,
   memset(index, 0, sizeof(struct AwFmIndex));
   memcpy(&index->config, config, sizeof(struct AwFmIndexConfiguration));
   index->bwtLength = bwtLength;
+  index->allocationPolicy = buildOptions->allocationPolicy;
+  index->useDirectIo = buildOptions->useDirectIo;
+  if (config->alphabetType == AwFmAlphabetReducedAmino) {
+    awFmSetReducedAminoLetterMap(index->reducedAminoLetterMap,
+                                 buildOptions->reducedAminoLetterMap);
+  }
 
   // allocate the prefixSums
   size_t prefixSumsLength = awFmGetPrefixSumsLength(config->alphabetType);
@@ -29,37 +43,51 @@ awFmIndexAlloc(const struct AwFmIndexConfiguration *_RESTRICT_ const config,
   }
 
   // allocate the blockLists
-  size_t numBlocksInBwt = awFmNumBlocksFromBwtLength(bwtLength);
-  size_t sizeOfBwtBlock = config->alphabetType == AwFmAlphabetAmino
-                              ? sizeof(struct AwFmAminoBlock)
-                              : sizeof(struct AwFmNucleotideBlock);
-
-  // alloc the backward bwt
-  index->bwtBlockList.asNucleotide =
-      aligned_alloc(AW_FM_BWT_BYTE_ALIGNMENT, numBlocksInBwt * sizeOfBwtBlock);
-  if (index->bwtBlockList.asNucleotide == NULL) {
-    awFmDeallocIndex(index);
-    return NULL;
+  if (allocateBwt) {
+    index->bwtBlockList.asNucleotide = awFmAllocLargeArray(
+        awFmGetBwtBlockListByteLength(index), index->allocationPolicy,
+        &index->bwtAllocationPolicy);
+    if (index->bwtBlockList.asNucleotide == NULL) {
+      awFmDeallocIndex(index);
+      return NULL;
+    }
   }
 
-  const size_t kmerSeedTableSize = awFmGetKmerTableLength(index);
   // allocate the kmerSeedTable
-  index->kmerSeedTable =
-      malloc(kmerSeedTableSize * sizeof(struct AwFmSearchRange));
+  index->kmerSeedTable = awFmAllocLargeArray(
+      awFmGetKmerTableLength(index) * sizeof(struct AwFmSearchRange),
+      index->allocationPolicy, &index->kmerSeedTableAllocationPolicy);
   if (index->kmerSeedTable == NULL) {
     awFmDeallocIndex(index);
     return NULL;
   }
 
+  index->suffixArrayReaderPool = awFmAsyncFileReaderPoolCreate();
+  if (index->suffixArrayReaderPool == NULL) {
+    awFmDeallocIndex(index);
+    return NULL;
+  }
+
   return index;
 }
 
 void awFmDeallocIndex(struct AwFmIndex *index) {
   if (index != NULL) {
-    fclose(index->fileHandle);
-    free(index->bwtBlockList.asNucleotide);
+    if (index->fileHandle != NULL) {
+      fclose(index->fileHandle);
+    }
+    awFmNumaDeallocReplicas(index);
+    awFmPageCacheDealloc(index->suffixArrayCache);
+    awFmPageCacheDealloc(index->bwtCache);
+    awFmAsyncFileReaderPoolDealloc(index->suffixArrayReaderPool);
+    awFmFreeLargeArray(index->bwtBlockList.asNucleotide,
+                       awFmGetBwtBlockListByteLength(index),
+                       index->bwtAllocationPolicy);
     free(index->prefixSums);
-    free(index->kmerSeedTable);
+    awFmFreeLargeArray(index->kmerSeedTable,
+                       awFmGetKmerTableLength(index) *
+                           sizeof(struct AwFmSearchRange),
+                       index->kmerSeedTableAllocationPolicy);
     free(index->suffixArray.values);
     if (index->fastaVector != NULL) {
       fastaVectorDealloc(index->fastaVector);
@@ -70,8 +98,14 @@ void awFmDeallocIndex(struct AwFmIndex *index) {
 }
 
 uint_fast8_t awFmGetAlphabetCardinality(const enum AwFmAlphabetType alphabet) {
-  return (alphabet == AwFmAlphabetAmino) ? AW_FM_AMINO_CARDINALITY
-                                         : AW_FM_NUCLEOTIDE_CARDINALITY;
+  switch (alphabet) {
+  case AwFmAlphabetAmino:
+    return AW_FM_AMINO_CARDINALITY;
+  case AwFmAlphabetReducedAmino:
+    return AW_FM_REDUCED_AMINO_CARDINALITY;
+  default:
+    return AW_FM_NUCLEOTIDE_CARDINALITY;
+  }
 }
 
 size_t awFmGetKmerTableLength(const struct AwFmIndex *_RESTRICT_ index) {
@@ -85,6 +119,12 @@ size_t awFmGetKmerTableLength(const struct AwFmIndex *_RESTRICT_ index) {
   return length;
 }
 
+size_t awFmGetBwtBlockListByteLength(
+    const struct AwFmIndex *_RESTRICT_ const index) {
+  return awFmNumBlocksFromBwtLength(index->bwtLength) *
+         awFmGetBwtBlockByteWidth(index);
+}
+
 bool awFmBwtPositionIsSampled(const struct AwFmIndex *_RESTRICT_ const index,
                               const uint64_t position) {
   return (position % index->config.suffixArrayCompressionRatio) == 0;
@@ -130,7 +170,8 @@ awFmSearchRangeLength(const struct AwFmSearchRange *_RESTRICT_ const range) {
 }
 
 bool awFmIndexIsVersionValid(const uint16_t versionNumber) {
-  return versionNumber == AW_FM_CURRENT_VERSION_NUMBER;
+  return versionNumber >= AW_FM_OLDEST_SUPPORTED_VERSION_NUMBER &&
+         versionNumber <= AW_FM_CURRENT_VERSION_NUMBER;
 }
 
 bool awFmIndexContainsFastaVector(
@@ -6,7 +6,11 @@
 #include <stdio.h>
 #include "AwFmIndex.h"
 
-#define AW_FM_CURRENT_VERSION_NUMBER 8
+// version 9 added reduced amino indices, with their letter map after the bwt
+// length and 4-plane blocks. Version 8 files can't hold them, and are
+// otherwise laid out the same, so they're still read.
+#define AW_FM_CURRENT_VERSION_NUMBER 9
+#define AW_FM_OLDEST_SUPPORTED_VERSION_NUMBER 8
 #define AW_FM_FEATURE_FLAG_BIT_FASTA_VECTOR 0
 
 /*
@@ -18,7 +22,12 @@
  *  Inputs:
  *    config:         configuration struct that describes the format and
  * parameters of the index. The config struct will be memcpy'd directly into the
- * index. bwtLength:   Length of the BWT, in positions, that the index will hold
+ * index. options: Build options giving the allocation policy, direct I/O
+ *      setting, and reduced amino letter map of the index, or NULL for the
+ *      defaults.
+ *    bwtLength:      Length of the BWT, in positions, that the index will hold
+ *    allocateBwt:    If false, the BWT block list is left NULL, for indices
+ *      whose BWT stays on disk.
  *
  *  Returns:
  *    Allocated AwFmIndex struct, or NULL on an allocation failure.
@@ -27,7 +36,8 @@
  */
 struct AwFmIndex *
 awFmIndexAlloc(const struct AwFmIndexConfiguration *_RESTRICT_ const config,
-               const size_t bwtLength);
+               const struct AwFmIndexBuildOptions *_RESTRICT_ const options,
+               const size_t bwtLength, const bool allocateBwt);
 
 /*
  * Function:  awFmGetAlphabetCardinality
@@ -35,6 +45,7 @@ awFmIndexAlloc(const struct AwFmIndexConfiguration *_RESTRICT_ const config,
  * Returns the number of letters in the given alphabet.
  *  If AwFmAlphabetNucleotide is given, returns 4.
  *  If AwFmAlphabetAmino  is given, returns 20.
+ *  If AwFmAlphabetReducedAmino is given, returns 11.
  *  Inputs:
  *    alphabet: Alphabet to query.
  *
@@ -57,6 +68,20 @@ uint_fast8_t awFmGetAlphabetCardinality(const enum AwFmAlphabetType alphabet);
  */
 size_t awFmGetKmerTableLength(const struct AwFmIndex *_RESTRICT_ index);
 
+/*
+ * Function:  awFmGetBwtBlockListByteLength
+ * --------------------
+ * Computes the size, in bytes, of the index's BWT block list.
+ *
+ *  Inputs:
+ *    index: AwFmIndex struct with the bwtLength and alphabet set.
+ *
+ *  Returns:
+ *    Number of bytes in the BWT block list.
+ */
+size_t awFmGetBwtBlockListByteLength(
+    const struct AwFmIndex *_RESTRICT_ const index);
+
 /*
  * Function:  awFmNumBlocksFromBwtLength
  * --------------------
@@ -196,7 +221,8 @@ awFmSearchRangeLength(const struct AwFmSearchRange *_RESTRICT_ const range);
  * Function:  awFmIndexIsVersionValid
  * --------------------
  * returns true if the given version number is one that is currently supported.
- *   The supported version numbers are enumerated at the top of this header
+ *   The supported version numbers are AW_FM_OLDEST_SUPPORTED_VERSION_NUMBER
+ *   through AW_FM_CURRENT_VERSION_NUMBER, defined at the top of this header
  * (AwFmIndexStruct.h)
  *
  *  Inputs:
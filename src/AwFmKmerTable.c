@@ -50,6 +50,23 @@ awFmAminoKmerSeedRangeFromTable(const struct AwFmIndex *_RESTRICT_ const index,
   return index->kmerSeedTable[kmerTableIndex];
 }
 
+struct AwFmSearchRange awFmReducedAminoKmerSeedRangeFromTable(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    const char *_RESTRICT_ const kmer, const size_t kmerLength) {
+
+  const size_t kmerSeedStartPosition =
+      kmerLength - index->config.kmerLengthInSeedTable;
+  size_t kmerTableIndex = 0;
+  for (size_t i = kmerSeedStartPosition; i < kmerLength; i++) {
+    uint8_t letterIndex = awFmAsciiReducedAminoToLetterIndex(
+        index->reducedAminoLetterMap, kmer[i]);
+    kmerTableIndex =
+        (kmerTableIndex * AW_FM_REDUCED_AMINO_CARDINALITY) + letterIndex;
+  }
+
+  return index->kmerSeedTable[kmerTableIndex];
+}
+
 // definition check for an intentionally undefined variable so this code doesn't
 // get implemented, get used, or throw
 #ifdef AW_FM_PARTIAL_SEED_CODE_IMPLEMENTATION_PROVIDED
@@ -51,6 +51,25 @@ awFmAminoKmerSeedRangeFromTable(const struct AwFmIndex *_RESTRICT_ const index,
                                 const char *_RESTRICT_ const kmer,
                                 const size_t kmerLength);
 
+/*
+ * Function:  awFmReducedAminoKmerSeedRangeFromTable
+ * --------------------
+ * Like awFmAminoKmerSeedRangeFromTable, for a reduced amino index. The kmer's
+ * amino acids are reduced by the index's letter map to find the range.
+ *
+ *  Inputs:
+ *    index: AwFmIndex struct to search
+ *    kmer: ascii amino acid character string to search for in the
+ * kmerSeedTable. kmerLength: length, in characters of the kmer.
+ *
+ *  Returns:
+ *    Copy of the AwFmSearchRange containing the startPtr and endPtr for the
+ * kmer seed.
+ */
+struct AwFmSearchRange awFmReducedAminoKmerSeedRangeFromTable(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    const char *_RESTRICT_ const kmer, const size_t kmerLength);
+
 /*
  * Function:  awFmQueryCanUseKmerTable
  * --------------------
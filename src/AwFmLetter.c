@@ -1,5 +1,6 @@
 #include "AwFmLetter.h"
 #include <ctype.h>
+#include <string.h>
 
 uint8_t awFmAsciiNucleotideToLetterIndex(const uint8_t asciiLetter) {
   uint8_t toLowerCase = asciiLetter | 0x20;
@@ -95,9 +96,90 @@ uint8_t awFmAminoAcidCompressedVectorToLetterIndex(
   return letterLookup[compressedVectorLetter];
 }
 
+// the built-in reduced alphabet, by amino letter index: [kredqn] c g h [ilv]
+// m f y w p [sta].
+static const uint8_t defaultReducedAminoLetterMap[AW_FM_AMINO_CARDINALITY] = {
+    10, 1, 0, 0, 6, 2, 3, 4, 0, 4, 5, 0, 9, 0, 0, 10, 10, 4, 8, 7};
+
+uint8_t awFmAsciiReducedAminoToLetterIndex(
+    const uint8_t *_RESTRICT_ const letterMap, const uint8_t asciiLetter) {
+  return letterMap[awFmAsciiAminoAcidToLetterIndex(asciiLetter)];
+}
+
+uint8_t awFmReducedAminoLetterIndexToAscii(const uint8_t letterIndex) {
+  if (__builtin_expect(letterIndex >= AW_FM_REDUCED_AMINO_CARDINALITY, 0)) {
+    return letterIndex == AW_FM_REDUCED_AMINO_CARDINALITY ? 'z' : '$';
+  }
+  return 'a' + letterIndex;
+}
+
+uint8_t
+awFmReducedAminoLetterIndexToCompressedVector(const uint8_t letterIndex) {
+  // the sentinel is 0, and every other letter is one more than its index.
+  return letterIndex == AW_FM_REDUCED_AMINO_CARDINALITY + 1 ? 0
+                                                            : letterIndex + 1;
+}
+
+uint8_t awFmReducedAminoCompressedVectorToLetterIndex(
+    const uint8_t compressedVectorLetter) {
+  return compressedVectorLetter == 0 ? AW_FM_REDUCED_AMINO_CARDINALITY + 1
+                                     : compressedVectorLetter - 1;
+}
+
+bool awFmReducedAminoLetterMapIsValid(const uint8_t *_RESTRICT_ const
+                                          letterMap) {
+  for (uint8_t i = 0; i < AW_FM_AMINO_CARDINALITY; i++) {
+    if (letterMap[i] >= AW_FM_REDUCED_AMINO_CARDINALITY) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void awFmSetReducedAminoLetterMap(uint8_t *_RESTRICT_ const indexLetterMap,
+                                  const uint8_t *_RESTRICT_ const letterMap) {
+  memcpy(indexLetterMap,
+         letterMap != NULL ? letterMap : defaultReducedAminoLetterMap,
+         AW_FM_AMINO_CARDINALITY);
+  indexLetterMap[AW_FM_AMINO_CARDINALITY] = AW_FM_REDUCED_AMINO_CARDINALITY;
+  indexLetterMap[AW_FM_AMINO_CARDINALITY + 1] =
+      AW_FM_REDUCED_AMINO_CARDINALITY + 1;
+}
+
+void awFmReduceAminoSequence(uint8_t *const sequence,
+                             const size_t sequenceLength,
+                             const uint8_t *_RESTRICT_ const letterMap) {
+  uint8_t asciiToReducedAscii[256];
+  for (uint16_t ascii = 0; ascii < 256; ascii++) {
+    asciiToReducedAscii[ascii] = awFmReducedAminoLetterIndexToAscii(
+        awFmAsciiReducedAminoToLetterIndex(letterMap, ascii));
+  }
+  for (size_t position = 0; position < sequenceLength; position++) {
+    sequence[position] = asciiToReducedAscii[sequence[position]];
+  }
+}
+
+uint8_t awFmAsciiToLetterIndex(const struct AwFmIndex *_RESTRICT_ const index,
+                               const uint8_t asciiLetter) {
+  switch (index->config.alphabetType) {
+  case AwFmAlphabetAmino:
+    return awFmAsciiAminoAcidToLetterIndex(asciiLetter);
+  case AwFmAlphabetReducedAmino:
+    return awFmAsciiReducedAminoToLetterIndex(index->reducedAminoLetterMap,
+                                              asciiLetter);
+  default:
+    return awFmAsciiNucleotideToLetterIndex(asciiLetter);
+  }
+}
+
 bool awFmLetterIsAmbiguous(const char letter,
                            const enum AwFmAlphabetType alphabet) {
   const char lowercase = tolower(letter);
+  if (alphabet == AwFmAlphabetReducedAmino) {
+    // every letter the map can't place is ambiguous, so the letter's index
+    // always fits in the kmer seed table.
+    return awFmAsciiAminoAcidToLetterIndex(letter) >= AW_FM_AMINO_CARDINALITY;
+  }
   if (alphabet == AwFmAlphabetAmino) {
     switch (lowercase) {
     case 'z':
@@ -123,3 +205,161 @@ bool awFmLetterIsAmbiguous(const char letter,
   // this return should never occur
   return true;
 }
+
+// each vector form below matches the scalar sanitize function letter for
+// letter, so the tail of the sequence can use the scalar form.
+#ifdef __aarch64__
+static inline uint8x16_t nucleotideSanitizeVec(const uint8x16_t letters) {
+  const uint8x16_t lowerCase = vorrq_u8(letters, vdupq_n_u8(0x20));
+  uint8x16_t isValid = vceqq_u8(lowerCase, vdupq_n_u8('a'));
+  isValid = vorrq_u8(isValid, vceqq_u8(lowerCase, vdupq_n_u8('c')));
+  isValid = vorrq_u8(isValid, vceqq_u8(lowerCase, vdupq_n_u8('g')));
+  isValid = vorrq_u8(isValid, vceqq_u8(lowerCase, vdupq_n_u8('t')));
+  isValid = vorrq_u8(isValid, vceqq_u8(lowerCase, vdupq_n_u8('u')));
+  isValid = vorrq_u8(isValid, vceqq_u8(lowerCase, vdupq_n_u8('$')));
+  return vbslq_u8(isValid, lowerCase, vdupq_n_u8('x'));
+}
+
+static inline uint8x16_t aminoSanitizeVec(const uint8x16_t letters) {
+  const uint8x16_t lowerCase = vorrq_u8(letters, vdupq_n_u8(0x20));
+  uint8x16_t isAmbiguous = vceqq_u8(lowerCase, vdupq_n_u8('b'));
+  isAmbiguous = vorrq_u8(isAmbiguous, vceqq_u8(lowerCase, vdupq_n_u8('x')));
+  isAmbiguous = vorrq_u8(isAmbiguous, vceqq_u8(letters, vdupq_n_u8(0)));
+  return vbslq_u8(isAmbiguous, vdupq_n_u8('z'), letters);
+}
+
+static size_t sanitizeSequenceVectors(const uint8_t *const sequence,
+                                      uint8_t *const sanitizedSequence,
+                                      const size_t sequenceLength,
+                                      const bool isAmino) {
+  size_t position = 0;
+  for (; position + 16 <= sequenceLength; position += 16) {
+    const uint8x16_t letters = vld1q_u8(sequence + position);
+    vst1q_u8(sanitizedSequence + position,
+             isAmino ? aminoSanitizeVec(letters)
+                     : nucleotideSanitizeVec(letters));
+  }
+  return position;
+}
+#else
+static inline __m256i nucleotideSanitizeVec(const __m256i letters) {
+  const __m256i lowerCase = _mm256_or_si256(letters, _mm256_set1_epi8(0x20));
+  __m256i isValid = _mm256_cmpeq_epi8(lowerCase, _mm256_set1_epi8('a'));
+  isValid = _mm256_or_si256(
+      isValid, _mm256_cmpeq_epi8(lowerCase, _mm256_set1_epi8('c')));
+  isValid = _mm256_or_si256(
+      isValid, _mm256_cmpeq_epi8(lowerCase, _mm256_set1_epi8('g')));
+  isValid = _mm256_or_si256(
+      isValid, _mm256_cmpeq_epi8(lowerCase, _mm256_set1_epi8('t')));
+  isValid = _mm256_or_si256(
+      isValid, _mm256_cmpeq_epi8(lowerCase, _mm256_set1_epi8('u')));
+  isValid = _mm256_or_si256(
+      isValid, _mm256_cmpeq_epi8(lowerCase, _mm256_set1_epi8('$')));
+  return _mm256_blendv_epi8(_mm256_set1_epi8('x'), lowerCase, isValid);
+}
+
+static inline __m256i aminoSanitizeVec(const __m256i letters) {
+  const __m256i lowerCase = _mm256_or_si256(letters, _mm256_set1_epi8(0x20));
+  __m256i isAmbiguous = _mm256_cmpeq_epi8(lowerCase, _mm256_set1_epi8('b'));
+  isAmbiguous = _mm256_or_si256(
+      isAmbiguous, _mm256_cmpeq_epi8(lowerCase, _mm256_set1_epi8('x')));
+  isAmbiguous = _mm256_or_si256(
+      isAmbiguous, _mm256_cmpeq_epi8(letters, _mm256_setzero_si256()));
+  return _mm256_blendv_epi8(letters, _mm256_set1_epi8('z'), isAmbiguous);
+}
+
+static size_t sanitizeSequenceVectors(const uint8_t *const sequence,
+                                      uint8_t *const sanitizedSequence,
+                                      const size_t sequenceLength,
+                                      const bool isAmino) {
+  size_t position = 0;
+  for (; position + 32 <= sequenceLength; position += 32) {
+    const __m256i letters =
+        _mm256_loadu_si256((const __m256i *)(sequence + position));
+    _mm256_storeu_si256((__m256i *)(sanitizedSequence + position),
+                        isAmino ? aminoSanitizeVec(letters)
+                                : nucleotideSanitizeVec(letters));
+  }
+  return position;
+}
+#endif
+
+void awFmSanitizeSequence(const uint8_t *const sequence,
+                          uint8_t *const sanitizedSequence,
+                          const size_t sequenceLength,
+                          const enum AwFmAlphabetType alphabetType) {
+  // reduced amino sequences are sanitized as amino acids, and reduced later.
+  const bool isAmino = alphabetType == AwFmAlphabetAmino ||
+                       alphabetType == AwFmAlphabetReducedAmino;
+  size_t position = sanitizeSequenceVectors(sequence, sanitizedSequence,
+                                            sequenceLength, isAmino);
+  for (; position < sequenceLength; position++) {
+    sanitizedSequence[position] =
+        isAmino ? awFmAsciiAminoLetterSanitize(sequence[position])
+                : awFmAsciiNucleotideLetterSanitize(sequence[position]);
+  }
+}
+
+// the low nibble of each lowercase nucleotide is distinct, so one table
+// lookup by nibble gives both the letter a byte has to be and its index.
+#ifdef __aarch64__
+static size_t nucleotideLetterIndexVectors(const uint8_t *const sequence,
+                                           uint8_t *const letterIndices,
+                                           const size_t sequenceLength) {
+  const uint8x16_t expectedLetters = {0, 'a', 0, 'c', 't', 'u', 0, 'g',
+                                      0, 0,   0, 0,   0,   0,   0, 0};
+  const uint8x16_t nibbleLetterIndices = {4, 0, 4, 1, 3, 3, 4, 2,
+                                          4, 4, 4, 4, 4, 4, 4, 4};
+  size_t position = 0;
+  for (; position + 16 <= sequenceLength; position += 16) {
+    const uint8x16_t lowerCase =
+        vorrq_u8(vld1q_u8(sequence + position), vdupq_n_u8(0x20));
+    const uint8x16_t nibbles = vandq_u8(lowerCase, vdupq_n_u8(0x0F));
+    const uint8x16_t isValid =
+        vceqq_u8(lowerCase, vqtbl1q_u8(expectedLetters, nibbles));
+    vst1q_u8(letterIndices + position,
+             vbslq_u8(isValid, vqtbl1q_u8(nibbleLetterIndices, nibbles),
+                      vdupq_n_u8(4)));
+  }
+  return position;
+}
+#else
+static size_t nucleotideLetterIndexVectors(const uint8_t *const sequence,
+                                           uint8_t *const letterIndices,
+                                           const size_t sequenceLength) {
+  const __m256i expectedLetters = _mm256_setr_epi8(
+      0, 'a', 0, 'c', 't', 'u', 0, 'g', 0, 0, 0, 0, 0, 0, 0, 0, 0, 'a', 0,
+      'c', 't', 'u', 0, 'g', 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i nibbleLetterIndices =
+      _mm256_setr_epi8(4, 0, 4, 1, 3, 3, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 4,
+                       1, 3, 3, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4);
+  size_t position = 0;
+  for (; position + 32 <= sequenceLength; position += 32) {
+    const __m256i lowerCase = _mm256_or_si256(
+        _mm256_loadu_si256((const __m256i *)(sequence + position)),
+        _mm256_set1_epi8(0x20));
+    const __m256i nibbles =
+        _mm256_and_si256(lowerCase, _mm256_set1_epi8(0x0F));
+    const __m256i isValid = _mm256_cmpeq_epi8(
+        lowerCase, _mm256_shuffle_epi8(expectedLetters, nibbles));
+    _mm256_storeu_si256(
+        (__m256i *)(letterIndices + position),
+        _mm256_blendv_epi8(_mm256_set1_epi8(4),
+                           _mm256_shuffle_epi8(nibbleLetterIndices, nibbles),
+                           isValid));
+  }
+  return position;
+}
+#endif
+
+void awFmNucleotidesToLetterIndices(const uint8_t *const sequence,
+                                    uint8_t *const letterIndices,
+                                    const size_t sequenceLength) {
+  size_t position =
+      nucleotideLetterIndexVectors(sequence, letterIndices, sequenceLength);
+  for (; position < sequenceLength; position++) {
+    const uint8_t letterIndex = awFmAsciiNucleotideToLetterIndex(
+        sequence[position]);
+    letterIndices[position] = letterIndex < 4 ? letterIndex : 4;
+  }
+}
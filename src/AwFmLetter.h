@@ -128,6 +128,128 @@ uint8_t awFmAminoAcidLetterIndexToCompressedVector(const uint8_t letterIndex);
 uint8_t awFmAminoAcidCompressedVectorToLetterIndex(
     const uint8_t compressedVectorLetter);
 
+/*
+ * Function:  awFmAsciiReducedAminoToLetterIndex
+ * --------------------
+ * Transforms an ascii amino acid character into the letter index of its group
+ * in a reduced amino alphabet. Ambiguity characters are given the index 11,
+ * and the sentinel '$' the index 12.
+ *
+ *  Inputs:
+ *    letterMap:   the index's reducedAminoLetterMap.
+ *    asciiLetter: ascii-encoded amino acid, ambiguity code, or sentinel '$'.
+ *
+ *  Returns:
+ *    Letter index of the amino acid's group.
+ */
+uint8_t awFmAsciiReducedAminoToLetterIndex(
+    const uint8_t *_RESTRICT_ const letterMap, const uint8_t asciiLetter);
+
+/*
+ * Function:  awFmReducedAminoLetterIndexToAscii
+ * --------------------
+ * Returns the ascii letter a reduced amino letter index is built from. Groups
+ * are represented by 'a' onward, ambiguity by 'z', and the sentinel by '$', so
+ * the letters sort in the same order as their indices.
+ *
+ *  Inputs:
+ *    letterIndex: letter index of the group, ambiguity, or sentinel.
+ *
+ *  Returns:
+ *    The representative ascii letter.
+ */
+uint8_t awFmReducedAminoLetterIndexToAscii(const uint8_t letterIndex);
+
+/*
+ * Function:  awFmReducedAminoLetterIndexToCompressedVector
+ * --------------------
+ * Transforms a reduced amino letter index into its 4-bit compressed vector
+ * representation.
+ *
+ *  Inputs:
+ *    letterIndex: letter index of the group, ambiguity, or sentinel.
+ *
+ *  Returns:
+ *    Compressed vector representation of the letter.
+ */
+uint8_t
+awFmReducedAminoLetterIndexToCompressedVector(const uint8_t letterIndex);
+
+/*
+ * Function:  awFmReducedAminoCompressedVectorToLetterIndex
+ * --------------------
+ * Transforms a compressed vector representation of a reduced amino letter
+ * into its letter index.
+ *
+ *  Inputs:
+ *    compressedVectorLetter: format that the letter is stored in the vectors.
+ *
+ *  Returns:
+ *    Letter index between 0 and 12, where 12 is the sentinel.
+ */
+uint8_t awFmReducedAminoCompressedVectorToLetterIndex(
+    const uint8_t compressedVectorLetter);
+
+/*
+ * Function:  awFmReducedAminoLetterMapIsValid
+ * --------------------
+ * Checks that every amino acid in the letter map is given a letter of the
+ * reduced alphabet.
+ *
+ *  Inputs:
+ *    letterMap: 20 reduced letters, one per amino acid.
+ *
+ *  Returns:
+ *    true if every letter is less than AW_FM_REDUCED_AMINO_CARDINALITY.
+ */
+bool awFmReducedAminoLetterMapIsValid(const uint8_t *_RESTRICT_ const
+                                          letterMap);
+
+/*
+ * Function:  awFmSetReducedAminoLetterMap
+ * --------------------
+ * Fills an index's reducedAminoLetterMap from a build options letter map,
+ * adding the ambiguity and sentinel letters.
+ *
+ *  Inputs:
+ *    indexLetterMap: the index's map, of AW_FM_AMINO_CARDINALITY + 2 letters.
+ *    letterMap:      20 reduced letters, one per amino acid, or NULL for the
+ *      built-in grouping.
+ */
+void awFmSetReducedAminoLetterMap(uint8_t *_RESTRICT_ const indexLetterMap,
+                                  const uint8_t *_RESTRICT_ const letterMap);
+
+/*
+ * Function:  awFmReduceAminoSequence
+ * --------------------
+ * Replaces every letter of a sanitized amino sequence with the representative
+ * letter of its group, as given by awFmReducedAminoLetterIndexToAscii.
+ *
+ *  Inputs:
+ *    sequence:       sanitized amino sequence, reduced in place.
+ *    sequenceLength: number of letters to reduce.
+ *    letterMap:      the index's reducedAminoLetterMap.
+ */
+void awFmReduceAminoSequence(uint8_t *const sequence,
+                             const size_t sequenceLength,
+                             const uint8_t *_RESTRICT_ const letterMap);
+
+/*
+ * Function:  awFmAsciiToLetterIndex
+ * --------------------
+ * Transforms an ascii query letter into a letter index of the index's
+ * alphabet.
+ *
+ *  Inputs:
+ *    index:       index the letter will be searched in.
+ *    asciiLetter: ascii-encoded letter of the query.
+ *
+ *  Returns:
+ *    Letter index of the letter in the index's alphabet.
+ */
+uint8_t awFmAsciiToLetterIndex(const struct AwFmIndex *_RESTRICT_ const index,
+                               const uint8_t asciiLetter);
+
 /*
  * Function:  awFmLetterIsAmbiguous
  * --------------------
@@ -143,4 +265,41 @@ uint8_t awFmAminoAcidCompressedVectorToLetterIndex(
 bool awFmLetterIsAmbiguous(const char letter,
                            const enum AwFmAlphabetType alphabet);
 
+/*
+ * Function:  awFmSanitizeSequence
+ * --------------------
+ * Sanitizes every letter of the sequence with awFmAsciiNucleotideLetterSanitize
+ * or awFmAsciiAminoLetterSanitize, 32 letters at a time with SIMD compares.
+ * The sequence and sanitizedSequence may be the same buffer.
+ *
+ *  Inputs:
+ *    sequence:          ascii-encoded sequence to sanitize.
+ *    sanitizedSequence: buffer of at least sequenceLength bytes to write the
+ *      sanitized letters to.
+ *    sequenceLength:    number of letters to sanitize.
+ *    alphabetType:      alphabet of the sequence.
+ */
+void awFmSanitizeSequence(const uint8_t *const sequence,
+                          uint8_t *const sanitizedSequence,
+                          const size_t sequenceLength,
+                          const enum AwFmAlphabetType alphabetType);
+
+/*
+ * Function:  awFmNucleotidesToLetterIndices
+ * --------------------
+ * Converts every letter of the nucleotide sequence to its letter index, 32
+ * letters at a time with SIMD table lookups. Letters other than a, c, g, t,
+ * and u, in either case, become the ambiguity letter index 4, the sentinel
+ * included.
+ *
+ *  Inputs:
+ *    sequence:       ascii-encoded nucleotide sequence.
+ *    letterIndices:  buffer of at least sequenceLength bytes to write the
+ *      letter indices to.
+ *    sequenceLength: number of letters to convert.
+ */
+void awFmNucleotidesToLetterIndices(const uint8_t *const sequence,
+                                    uint8_t *const letterIndices,
+                                    const size_t sequenceLength);
+
 #endif /* end of include guard: AW_FM_LETTER_H */
@@ -0,0 +1,154 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "AwFmDiskBwt.h"
+#include "AwFmIndex.h"
+#include "AwFmIndexStruct.h"
+#include "AwFmKmerTable.h"
+#include "AwFmLetter.h"
+
+static inline struct AwFmSearchRange
+seedRangeFromTable(const struct AwFmIndex *_RESTRICT_ const index,
+                   const char *_RESTRICT_ const kmer, const size_t kmerLength) {
+  switch (index->config.alphabetType) {
+  case AwFmAlphabetAmino:
+    return awFmAminoKmerSeedRangeFromTable(index, kmer, kmerLength);
+  case AwFmAlphabetReducedAmino:
+    return awFmReducedAminoKmerSeedRangeFromTable(index, kmer, kmerLength);
+  default:
+    return awFmNucleotideKmerSeedRangeFromTable(index, kmer, kmerLength);
+  }
+}
+
+// finds the longest match ending at queryEnd that's at most maxLength long.
+static struct AwFmMatchingStatistic
+findLongestMatchEndingAt(const struct AwFmIndex *_RESTRICT_ const index,
+                         const char *_RESTRICT_ const query,
+                         const size_t queryEnd, const uint64_t maxLength) {
+  const uint8_t ambiguityLetterIndex =
+      awFmGetAlphabetCardinality(index->config.alphabetType);
+  const uint8_t seedLength = index->config.kmerLengthInSeedTable;
+  struct AwFmMatchingStatistic statistic = {
+      .length = 0, .range = {.startPtr = 1, .endPtr = 0}};
+
+  // a seed table miss only means the match is shorter than a kmer, so the
+  // search falls back to starting from the single letter.
+  if (maxLength >= seedLength &&
+      awFmQueryCanUseKmerTable(index, query + queryEnd + 1 - seedLength,
+                               seedLength)) {
+    statistic.range = seedRangeFromTable(
+        index, query + queryEnd + 1 - seedLength, seedLength);
+    if (awFmSearchRangeIsValid(&statistic.range)) {
+      statistic.length = seedLength;
+    }
+  }
+  if (statistic.length == 0) {
+    const uint8_t letterIndex = awFmAsciiToLetterIndex(index, query[queryEnd]);
+    if (letterIndex == ambiguityLetterIndex) {
+      return statistic;
+    }
+    statistic.range = (struct AwFmSearchRange){
+        .startPtr = index->prefixSums[letterIndex],
+        .endPtr = index->prefixSums[letterIndex + 1] - 1};
+    if (!awFmSearchRangeIsValid(&statistic.range)) {
+      return statistic;
+    }
+    statistic.length = 1;
+  }
+
+  while (statistic.length < maxLength) {
+    const uint8_t letterIndex =
+        awFmAsciiToLetterIndex(index, query[queryEnd - statistic.length]);
+    if (letterIndex == ambiguityLetterIndex) {
+      break;
+    }
+    struct AwFmSearchRange extendedRange = statistic.range;
+    awFmIterativeStepBackwardSearch(index, &extendedRange, letterIndex);
+    if (!awFmSearchRangeIsValid(&extendedRange)) {
+      break;
+    }
+    statistic.range = extendedRange;
+    statistic.length++;
+  }
+  return statistic;
+}
+
+static enum AwFmReturnCode computeMatchingStatistics(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmMatchingStatisticsData *_RESTRICT_ const statisticsData) {
+  const uint64_t queryLength = statisticsData->queryLength;
+  if (statisticsData->capacity < queryLength) {
+    struct AwFmMatchingStatistic *statistics =
+        realloc(statisticsData->statistics,
+                queryLength * sizeof(struct AwFmMatchingStatistic));
+    if (statistics == NULL) {
+      return AwFmAllocationFailure;
+    }
+    statisticsData->statistics = statistics;
+    statisticsData->capacity = queryLength;
+  }
+
+  // the match ending at a position, minus its last letter, also matches, so
+  // each match is at most one longer than the one before it.
+  uint64_t previousLength = 0;
+  for (size_t queryEnd = 0; queryEnd < queryLength; queryEnd++) {
+    statisticsData->statistics[queryEnd] = findLongestMatchEndingAt(
+        index, statisticsData->queryString, queryEnd, previousLength + 1);
+    previousLength = statisticsData->statistics[queryEnd].length;
+  }
+  return AwFmSuccess;
+}
+
+struct AwFmMatchingStatisticsList *
+awFmCreateMatchingStatisticsList(const size_t capacity) {
+  struct AwFmMatchingStatisticsList *statisticsList =
+      malloc(sizeof(struct AwFmMatchingStatisticsList));
+  if (statisticsList == NULL) {
+    return NULL;
+  }
+  statisticsList->capacity = capacity;
+  statisticsList->count = 0;
+  statisticsList->statisticsData =
+      malloc(capacity * sizeof(struct AwFmMatchingStatisticsData));
+  if (statisticsList->statisticsData == NULL) {
+    free(statisticsList);
+    return NULL;
+  }
+  for (size_t i = 0; i < capacity; i++) {
+    statisticsList->statisticsData[i] = (struct AwFmMatchingStatisticsData){
+        .queryString = NULL, .queryLength = 0, .statistics = NULL,
+        .capacity = 0};
+  }
+  return statisticsList;
+}
+
+void awFmDeallocMatchingStatisticsList(
+    struct AwFmMatchingStatisticsList *_RESTRICT_ const statisticsList) {
+  for (size_t i = 0; i < statisticsList->capacity; i++) {
+    free(statisticsList->statisticsData[i].statistics);
+  }
+  free(statisticsList->statisticsData);
+  free(statisticsList);
+}
+
+enum AwFmReturnCode awFmParallelMatchingStatistics(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmMatchingStatisticsList *_RESTRICT_ const statisticsList,
+    uint32_t numThreads) {
+  const size_t statisticsListCount = statisticsList->count;
+  enum AwFmReturnCode atomicReturnCode = AwFmSuccess;
+  const uint64_t bwtReadFailures = awFmDiskBwtReadFailures(index);
+
+#pragma omp parallel for schedule(dynamic) \
+    num_threads(numThreads > 0 ? numThreads : 1)
+  for (size_t i = 0; i < statisticsListCount; i++) {
+    if (__builtin_expect(computeMatchingStatistics(
+                             index, &statisticsList->statisticsData[i]) !=
+                             AwFmSuccess,
+                         0)) {
+#pragma omp atomic write
+      atomicReturnCode = AwFmAllocationFailure;
+    }
+  }
+  return awFmDiskBwtCheckReads(index, bwtReadFailures, atomicReturnCode);
+}
@@ -0,0 +1,132 @@
+// MAP_ANONYMOUS and MAP_HUGETLB need _DEFAULT_SOURCE to be visible in strict
+// c11 mode.
+#define _DEFAULT_SOURCE
+
+#include "AwFmMemory.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#define AW_FM_HEAP_BYTE_ALIGNMENT 32
+#define AW_FM_2MB_PAGE_SIZE ((size_t)1 << 21)
+#define AW_FM_1GB_PAGE_SIZE ((size_t)1 << 30)
+
+#if defined(__linux__) && defined(MAP_HUGETLB)
+#define AW_FM_HUGETLB_SUPPORTED
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+#endif
+
+static size_t awFmRoundUpToMultiple(const size_t length, const size_t multiple) {
+  return ((length + multiple - 1) / multiple) * multiple;
+}
+
+#ifdef AW_FM_HUGETLB_SUPPORTED
+static void *awFmAllocHugetlbPages(const size_t byteLength,
+                                   const size_t pageSize, const int pageFlag) {
+  void *array =
+      mmap(NULL, awFmRoundUpToMultiple(byteLength, pageSize),
+           PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | pageFlag, -1, 0);
+  return array == MAP_FAILED ? NULL : array;
+}
+#endif
+
+// maps anonymous memory aligned to a 2MB boundary, so that the kernel is able
+// to back the entire array with transparent huge pages.
+static void *awFmAllocTransparentHugePages(const size_t byteLength) {
+  const size_t alignedLength =
+      awFmRoundUpToMultiple(byteLength, AW_FM_2MB_PAGE_SIZE);
+  const size_t mappedLength = alignedLength + AW_FM_2MB_PAGE_SIZE;
+  uint8_t *mapping = mmap(NULL, mappedLength, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    return NULL;
+  }
+
+  // trim the unaligned head and the leftover tail from the mapping.
+  uint8_t *alignedStart = (uint8_t *)awFmRoundUpToMultiple(
+      (uintptr_t)mapping, AW_FM_2MB_PAGE_SIZE);
+  const size_t headLength = alignedStart - mapping;
+  if (headLength > 0) {
+    munmap(mapping, headLength);
+  }
+  const size_t tailLength = mappedLength - headLength - alignedLength;
+  if (tailLength > 0) {
+    munmap(alignedStart + alignedLength, tailLength);
+  }
+
+#ifdef MADV_HUGEPAGE
+  // if THP is disabled, madvise fails, but the mapping is still usable.
+  madvise(alignedStart, alignedLength, MADV_HUGEPAGE);
+#endif
+  return alignedStart;
+}
+
+void *awFmAllocLargeArray(const size_t byteLength,
+                          const enum AwFmAllocationPolicy requestedPolicy,
+                          enum AwFmAllocationPolicy *_RESTRICT_ policyUsed) {
+  void *array = NULL;
+  switch (requestedPolicy) {
+  case AwFmAllocationPolicyHugePages1GB:
+#ifdef AW_FM_HUGETLB_SUPPORTED
+    array = awFmAllocHugetlbPages(byteLength, AW_FM_1GB_PAGE_SIZE,
+                                  MAP_HUGE_1GB);
+    if (array != NULL) {
+      *policyUsed = AwFmAllocationPolicyHugePages1GB;
+      return array;
+    }
+#endif
+    // fall through
+  case AwFmAllocationPolicyHugePages2MB:
+#ifdef AW_FM_HUGETLB_SUPPORTED
+    array = awFmAllocHugetlbPages(byteLength, AW_FM_2MB_PAGE_SIZE,
+                                  MAP_HUGE_2MB);
+    if (array != NULL) {
+      *policyUsed = AwFmAllocationPolicyHugePages2MB;
+      return array;
+    }
+#endif
+    // fall through
+  case AwFmAllocationPolicyTransparentHugePages:
+    array = awFmAllocTransparentHugePages(byteLength);
+    if (array != NULL) {
+      *policyUsed = AwFmAllocationPolicyTransparentHugePages;
+      return array;
+    }
+    // fall through
+  default:
+    *policyUsed = AwFmAllocationPolicyDefault;
+    // aligned_alloc requires the size to be a multiple of the alignment.
+    return aligned_alloc(
+        AW_FM_HEAP_BYTE_ALIGNMENT,
+        awFmRoundUpToMultiple(byteLength, AW_FM_HEAP_BYTE_ALIGNMENT));
+  }
+}
+
+void awFmFreeLargeArray(void *array, const size_t byteLength,
+                        const enum AwFmAllocationPolicy policyUsed) {
+  if (array == NULL) {
+    return;
+  }
+
+  switch (policyUsed) {
+  case AwFmAllocationPolicyHugePages1GB:
+    munmap(array, awFmRoundUpToMultiple(byteLength, AW_FM_1GB_PAGE_SIZE));
+    break;
+  case AwFmAllocationPolicyHugePages2MB:
+  case AwFmAllocationPolicyTransparentHugePages:
+    munmap(array, awFmRoundUpToMultiple(byteLength, AW_FM_2MB_PAGE_SIZE));
+    break;
+  default:
+    free(array);
+    break;
+  }
+}
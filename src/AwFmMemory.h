@@ -0,0 +1,43 @@
+#ifndef AW_FM_MEMORY_H
+#define AW_FM_MEMORY_H
+
+#include <stddef.h>
+#include "AwFmIndex.h"
+
+/*
+ * Function:  awFmAllocLargeArray
+ * --------------------
+ * Allocates a large array (e.g., the BWT block list or kmer seed table) using
+ * the requested allocation policy. If the requested policy can't be satisfied
+ * (e.g., no hugetlb pages are reserved on the system), the allocation falls
+ * back to the next smaller page size, then to transparent huge pages, and
+ * finally to a 32-byte aligned heap allocation.
+ *
+ *  Inputs:
+ *    byteLength:       Number of bytes to allocate.
+ *    requestedPolicy:  Policy to try first.
+ *    policyUsed:       Out-argument that receives the policy that actually
+ *      backs the allocation. This must be given to awFmFreeLargeArray.
+ *
+ *  Returns:
+ *    Pointer to the allocated array, aligned to at least 32 bytes, or NULL if
+ * every policy failed.
+ */
+void *awFmAllocLargeArray(const size_t byteLength,
+                          const enum AwFmAllocationPolicy requestedPolicy,
+                          enum AwFmAllocationPolicy *_RESTRICT_ policyUsed);
+
+/*
+ * Function:  awFmFreeLargeArray
+ * --------------------
+ * Frees an array allocated with awFmAllocLargeArray.
+ *
+ *  Inputs:
+ *    array:        Pointer returned by awFmAllocLargeArray. May be NULL.
+ *    byteLength:   Length given to awFmAllocLargeArray.
+ *    policyUsed:   Policy returned by awFmAllocLargeArray.
+ */
+void awFmFreeLargeArray(void *array, const size_t byteLength,
+                        const enum AwFmAllocationPolicy policyUsed);
+
+#endif /* end of include guard: AW_FM_MEMORY_H */
@@ -0,0 +1,680 @@
+#include <stdlib.h>
+#include <string.h>
+#include "AwFmBuildPhase.h"
+#include "AwFmCreate.h"
+#include "AwFmDiskBwt.h"
+#include "AwFmFile.h"
+#include "AwFmFileWriter.h"
+#include "AwFmIndex.h"
+#include "AwFmIndexStruct.h"
+#include "AwFmOccurrence.h"
+#include "AwFmSearch.h"
+#include "AwFmSuffixArray.h"
+#include "FastaVector.h"
+
+// original sequences are copied into the merged index file this many bytes at
+// a time.
+#define AW_FM_MERGE_SEQUENCE_COPY_CHUNK_SIZE (8 * 1024 * 1024)
+// the letter of each suffix is packed under its rank in the initial sort key.
+#define AW_FM_MERGE_LETTER_BITS 5
+
+// a suffix of the first index's sequence, while those suffixes are sorted.
+struct AwFmMergeSuffix {
+  uint64_t key;
+  uint64_t position;
+};
+
+// a run of the sorted suffixes that haven't been told apart yet.
+struct AwFmMergeGroup {
+  size_t start;
+  size_t length;
+};
+
+// returns the BWT block, reading it into scratchBlock if the BWT was left on
+// disk.
+static inline const void *
+getBwtBlock(const struct AwFmIndex *_RESTRICT_ const index,
+            const uint64_t blockIndex,
+            struct AwFmAminoBlock *_RESTRICT_ const scratchBlock) {
+  if (__builtin_expect(index->bwtCache == NULL, 1)) {
+    return ((const uint8_t *)index->bwtBlockList.asNucleotide) +
+           (blockIndex * awFmGetBwtBlockByteWidth(index));
+  }
+  awFmDiskBwtReadBlock(index, blockIndex, scratchBlock);
+  return scratchBlock;
+}
+
+static inline uint8_t
+letterAtBwtPosition(const struct AwFmIndex *_RESTRICT_ const index,
+                    const uint64_t bwtPosition) {
+  struct AwFmAminoBlock scratchBlock;
+  const void *block = getBwtBlock(
+      index, awFmGetBlockIndexFromGlobalPosition(bwtPosition), &scratchBlock);
+  const uint8_t localPosition =
+      awFmGetBlockQueryPositionFromGlobalPosition(bwtPosition);
+  return index->config.alphabetType == AwFmAlphabetAmino
+             ? awFmGetAminoLetterAtBwtPosition(block, localPosition)
+             : awFmGetNucleotideLetterAtBwtPosition(block, localPosition);
+}
+
+// takes the number of suffixes in the index that sort before some string, and
+// returns the number that sort before that string with the letter prepended.
+// The string doesn't have to be a suffix of the index's sequence.
+static inline uint64_t
+stepBackward(const struct AwFmIndex *_RESTRICT_ const index,
+             const uint8_t letterIndex, const uint64_t suffixesBefore) {
+  const uint64_t queryPosition = suffixesBefore - 1;
+  struct AwFmAminoBlock scratchBlock;
+  const void *block = getBwtBlock(
+      index, awFmGetBlockIndexFromGlobalPosition(queryPosition), &scratchBlock);
+  const uint8_t localPosition =
+      awFmGetBlockQueryPositionFromGlobalPosition(queryPosition);
+
+  uint64_t baseOccurrence;
+  AwFmSimdVec256 occurrenceVector;
+  if (index->config.alphabetType == AwFmAlphabetAmino) {
+    const struct AwFmAminoBlock *aminoBlock = block;
+    baseOccurrence = aminoBlock->baseOccurrences[letterIndex];
+    occurrenceVector =
+        awFmMakeAminoAcidOccurrenceVector(aminoBlock, letterIndex);
+  } else {
+    const struct AwFmNucleotideBlock *nucleotideBlock = block;
+    baseOccurrence = nucleotideBlock->baseOccurrences[letterIndex];
+    occurrenceVector =
+        awFmMakeNucleotideOccurrenceVector(nucleotideBlock, letterIndex);
+  }
+  return index->prefixSums[letterIndex] + baseOccurrence +
+         AwFmMaskedVectorPopcount(occurrenceVector, localPosition);
+}
+
+static int compareMergeSuffixes(const void *a, const void *b) {
+  const uint64_t keyA = ((const struct AwFmMergeSuffix *)a)->key;
+  const uint64_t keyB = ((const struct AwFmMergeSuffix *)b)->key;
+  return (keyA > keyB) - (keyA < keyB);
+}
+
+// splits the sorted range into runs of equal keys, giving each suffix the
+// sorted position of its run as its rank, and adds the runs that still hold
+// more than one suffix to the group list.
+static void rankSortedRange(struct AwFmMergeSuffix *_RESTRICT_ const suffixes,
+                            const size_t start, const size_t length,
+                            uint64_t *_RESTRICT_ const ranks,
+                            struct AwFmMergeGroup *_RESTRICT_ const groups,
+                            size_t *_RESTRICT_ const numGroups) {
+  size_t runStart = start;
+  for (size_t i = start; i < start + length; i++) {
+    if (i + 1 == start + length || suffixes[i + 1].key != suffixes[i].key) {
+      for (size_t j = runStart; j <= i; j++) {
+        ranks[suffixes[j].position] = runStart;
+      }
+      if (i > runStart) {
+        groups[(*numGroups)++] = (struct AwFmMergeGroup){
+            .start = runStart, .length = i - runStart + 1};
+      }
+      runStart = i + 1;
+    }
+  }
+}
+
+// sorts the suffixes of firstText followed by the whole second sequence. Each
+// one is keyed by the number of the second index's suffixes that sort before
+// it, which orders every pair except those that fall between the same two
+// suffixes of the second index. Those are told apart by their letters and
+// then by the order of the suffixes that follow them, doubling the compared
+// length each round. The extra suffix at position firstLength stands for the
+// second sequence itself, and is the only one with an odd rank, so every
+// comparison ends there at the latest.
+static enum AwFmReturnCode
+sortFirstSuffixes(const uint8_t *_RESTRICT_ const firstText,
+                  const size_t firstLength,
+                  const uint64_t *_RESTRICT_ const secondRanks,
+                  const uint64_t secondSentinelPosition,
+                  struct AwFmMergeSuffix *_RESTRICT_ const suffixes) {
+  const size_t numSuffixes = firstLength + 1;
+  uint64_t *ranks = malloc(numSuffixes * sizeof(uint64_t));
+  const size_t maxGroups = (numSuffixes / 2) + 1;
+  struct AwFmMergeGroup *groups = malloc(maxGroups * sizeof(*groups));
+  struct AwFmMergeGroup *nextGroups = malloc(maxGroups * sizeof(*nextGroups));
+  if (ranks == NULL || groups == NULL || nextGroups == NULL) {
+    free(ranks);
+    free(groups);
+    free(nextGroups);
+    return AwFmAllocationFailure;
+  }
+
+  for (size_t position = 0; position < firstLength; position++) {
+    suffixes[position] = (struct AwFmMergeSuffix){
+        .key = ((secondRanks[position] * 2) << AW_FM_MERGE_LETTER_BITS) |
+               firstText[position],
+        .position = position};
+  }
+  suffixes[firstLength] = (struct AwFmMergeSuffix){
+      .key = ((secondSentinelPosition * 2) + 1) << AW_FM_MERGE_LETTER_BITS,
+      .position = firstLength};
+  qsort(suffixes, numSuffixes, sizeof(struct AwFmMergeSuffix),
+        compareMergeSuffixes);
+  size_t numGroups = 0;
+  rankSortedRange(suffixes, 0, numSuffixes, ranks, groups, &numGroups);
+
+  for (size_t comparedLength = 1; numGroups != 0; comparedLength *= 2) {
+    // every key is read before any rank of this round changes. Suffixes that
+    // still share a group can't reach the unique last suffix within
+    // comparedLength, so the position after them is in range.
+    for (size_t groupIndex = 0; groupIndex < numGroups; groupIndex++) {
+      const struct AwFmMergeGroup group = groups[groupIndex];
+      for (size_t i = group.start; i < group.start + group.length; i++) {
+        suffixes[i].key = ranks[suffixes[i].position + comparedLength];
+      }
+    }
+
+    size_t numNextGroups = 0;
+    for (size_t groupIndex = 0; groupIndex < numGroups; groupIndex++) {
+      const struct AwFmMergeGroup group = groups[groupIndex];
+      qsort(&suffixes[group.start], group.length,
+            sizeof(struct AwFmMergeSuffix), compareMergeSuffixes);
+      rankSortedRange(suffixes, group.start, group.length, ranks, nextGroups,
+                      &numNextGroups);
+    }
+    struct AwFmMergeGroup *swap = groups;
+    groups = nextGroups;
+    nextGroups = swap;
+    numGroups = numNextGroups;
+  }
+
+  free(ranks);
+  free(groups);
+  free(nextGroups);
+  return AwFmSuccess;
+}
+
+// adds the next letter of the merged BWT, packing the block once it's full.
+static inline void
+appendBwtLetter(struct AwFmIndex *_RESTRICT_ const index,
+                uint8_t *_RESTRICT_ const blockLetters,
+                size_t *_RESTRICT_ const numBlockLetters,
+                size_t *_RESTRICT_ const blockIndex, const uint8_t letterIndex,
+                uint64_t *_RESTRICT_ const occurrences) {
+  blockLetters[(*numBlockLetters)++] = letterIndex;
+  if (*numBlockLetters == AW_FM_POSITIONS_PER_FM_BLOCK) {
+    setBwtBlockFromLetters(index, (*blockIndex)++, blockLetters,
+                           AW_FM_POSITIONS_PER_FM_BLOCK, occurrences);
+    *numBlockLetters = 0;
+  }
+}
+
+// builds the merged BWT by interleaving the second index's BWT with the
+// sorted suffixes of the first sequence. Each of those goes right before the
+// second index's suffix at its rank. The second sequence is now preceded by
+// the end of the first one instead of the sentinel, and the merged sentinel
+// precedes the first sequence.
+static void
+setMergedBwt(struct AwFmIndex *_RESTRICT_ const mergedIndex,
+             const struct AwFmIndex *_RESTRICT_ const secondIndex,
+             const uint8_t *_RESTRICT_ const firstText,
+             const size_t firstLength,
+             const uint64_t *_RESTRICT_ const secondRanks,
+             const struct AwFmMergeSuffix *_RESTRICT_ const suffixes) {
+  const uint8_t sentinelLetterIndex =
+      awFmGetAlphabetCardinality(mergedIndex->config.alphabetType) + 1;
+  uint64_t occurrences[AW_FM_BWT_MAX_OCCURRENCE_COUNTS] = {0};
+  uint8_t blockLetters[AW_FM_POSITIONS_PER_FM_BLOCK];
+  size_t numBlockLetters = 0;
+  size_t blockIndex = 0;
+
+  size_t nextSuffix = 0;
+  for (uint64_t secondPosition = 0; secondPosition < secondIndex->bwtLength;
+       secondPosition++) {
+    while (nextSuffix <= firstLength) {
+      const uint64_t position = suffixes[nextSuffix].position;
+      // the suffix standing in for the second sequence is already in its BWT.
+      if (position != firstLength) {
+        if (secondRanks[position] > secondPosition) {
+          break;
+        }
+        appendBwtLetter(mergedIndex, blockLetters, &numBlockLetters,
+                        &blockIndex,
+                        position != 0 ? firstText[position - 1]
+                                      : sentinelLetterIndex,
+                        occurrences);
+      }
+      nextSuffix++;
+    }
+
+    uint8_t letterIndex = letterAtBwtPosition(secondIndex, secondPosition);
+    if (letterIndex == sentinelLetterIndex) {
+      letterIndex = firstText[firstLength - 1];
+    }
+    appendBwtLetter(mergedIndex, blockLetters, &numBlockLetters, &blockIndex,
+                    letterIndex, occurrences);
+  }
+
+  // suffixes that sort after every suffix of the second index.
+  for (; nextSuffix <= firstLength; nextSuffix++) {
+    const uint64_t position = suffixes[nextSuffix].position;
+    if (position != firstLength) {
+      appendBwtLetter(mergedIndex, blockLetters, &numBlockLetters,
+                      &blockIndex,
+                      position != 0 ? firstText[position - 1]
+                                    : sentinelLetterIndex,
+                      occurrences);
+    }
+  }
+  if (numBlockLetters != 0) {
+    setBwtBlockFromLetters(mergedIndex, blockIndex, blockLetters,
+                           numBlockLetters, occurrences);
+  }
+  setPrefixSums(mergedIndex, occurrences);
+}
+
+// finds the merged BWT's letters from the two indices. Only the suffixes of
+// the first index's sequence are sorted; the second index is only searched.
+static enum AwFmReturnCode
+buildMergedBwt(struct AwFmIndex *_RESTRICT_ const mergedIndex,
+               const struct AwFmIndex *const firstIndex,
+               const struct AwFmIndex *const secondIndex,
+               struct AwFmBuildStatistics *_RESTRICT_ const statistics) {
+  const size_t firstLength = firstIndex->bwtLength - 1;
+  const bool isAmino = mergedIndex->config.alphabetType == AwFmAlphabetAmino;
+  uint8_t *firstText = malloc(firstLength);
+  uint64_t *secondRanks = malloc(firstLength * sizeof(uint64_t));
+  struct AwFmMergeSuffix *suffixes =
+      malloc((firstLength + 1) * sizeof(struct AwFmMergeSuffix));
+  if (firstText == NULL || secondRanks == NULL || suffixes == NULL) {
+    free(firstText);
+    free(secondRanks);
+    free(suffixes);
+    return AwFmAllocationFailure;
+  }
+
+  struct AwFmBuildPhaseTimer phaseTimer;
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseSuffixSort);
+  // the first sequence's letters, from back to front, by walking its BWT from
+  // the suffix holding just the sentinel.
+  uint64_t bwtPosition = 0;
+  for (size_t position = firstLength; position-- > 0;) {
+    firstText[position] =
+        isAmino ? awFmAminoBacktraceReturnPreviousLetterIndex(firstIndex,
+                                                              &bwtPosition)
+                : awFmNucleotideBacktraceReturnPreviousLetterIndex(
+                      firstIndex, &bwtPosition);
+  }
+
+  // searching the second index for each suffix of the first sequence followed
+  // by the second sequence, one letter at a time from the back.
+  const uint64_t secondSentinelPosition =
+      awFmFindSentinelBwtPosition(secondIndex);
+  uint64_t suffixesBefore = secondSentinelPosition;
+  for (size_t position = firstLength; position-- > 0;) {
+    suffixesBefore =
+        stepBackward(secondIndex, firstText[position], suffixesBefore);
+    secondRanks[position] = suffixesBefore;
+  }
+
+  enum AwFmReturnCode returnCode =
+      sortFirstSuffixes(firstText, firstLength, secondRanks,
+                        secondSentinelPosition, suffixes);
+  awFmBuildPhaseEnd(&phaseTimer);
+
+  if (returnCode == AwFmSuccess) {
+    awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseBwt);
+    setMergedBwt(mergedIndex, secondIndex, firstText, firstLength, secondRanks,
+                 suffixes);
+    awFmBuildPhaseEnd(&phaseTimer);
+  }
+  free(firstText);
+  free(secondRanks);
+  free(suffixes);
+  return returnCode;
+}
+
+// samples the merged suffix array by walking the whole merged BWT from the
+// suffix holding just the sentinel, which visits every suffix from the last
+// sequence position to the first.
+static enum AwFmReturnCode
+writeSuffixArraySamples(const struct AwFmIndex *_RESTRICT_ const mergedIndex,
+                        const int fileDescriptor) {
+  const uint64_t compressionRatio =
+      mergedIndex->config.suffixArrayCompressionRatio;
+  const bool isAmino = mergedIndex->config.alphabetType == AwFmAlphabetAmino;
+  uint64_t *samples = malloc(awFmGetCompressedSuffixArrayLength(mergedIndex) *
+                             sizeof(uint64_t));
+  if (samples == NULL) {
+    return AwFmAllocationFailure;
+  }
+
+  uint64_t bwtPosition = 0;
+  for (uint64_t sequencePosition = mergedIndex->bwtLength - 1;;
+       sequencePosition--) {
+    if (bwtPosition % compressionRatio == 0) {
+      samples[bwtPosition / compressionRatio] = sequencePosition;
+    }
+    if (sequencePosition == 0) {
+      break;
+    }
+    bwtPosition =
+        isAmino ? awFmAminoBacktraceBwtPosition(mergedIndex, bwtPosition)
+                : awFmNucleotideBacktraceBwtPosition(mergedIndex, bwtPosition);
+  }
+
+  struct AwFmSuffixArrayWriter writer;
+  enum AwFmReturnCode returnCode = awFmSuffixArrayWriterInit(
+      &writer, fileDescriptor, mergedIndex->suffixArrayFileOffset,
+      mergedIndex->suffixArray.valueBitWidth);
+  const size_t numSamples = awFmGetCompressedSuffixArrayLength(mergedIndex);
+  for (size_t i = 0; returnCode == AwFmSuccess && i < numSamples; i++) {
+    returnCode = awFmSuffixArrayWriterAppend(&writer, samples[i]);
+  }
+  if (returnCode == AwFmSuccess) {
+    returnCode = awFmSuffixArrayWriterFinish(
+        &writer, mergedIndex->suffixArray.compressedByteLength);
+  } else {
+    awFmSuffixArrayWriterDealloc(&writer);
+  }
+  free(samples);
+  return returnCode;
+}
+
+static bool appendHeader(struct FastaVectorString *_RESTRICT_ const header,
+                         const char *_RESTRICT_ const chars,
+                         const size_t length) {
+  if (header->count + length > header->capacity) {
+    const size_t newCapacity = header->count + length;
+    char *newCharData = realloc(header->charData, newCapacity);
+    if (newCharData == NULL) {
+      return false;
+    }
+    header->charData = newCharData;
+    header->capacity = newCapacity;
+  }
+  memcpy(header->charData + header->count, chars, length);
+  header->count += length;
+  return true;
+}
+
+static bool
+appendMetadata(struct FastaVectorMetadataVector *_RESTRICT_ const metadata,
+               const size_t headerEndPosition,
+               const size_t sequenceEndPosition) {
+  if (metadata->count == metadata->capacity) {
+    const size_t newCapacity =
+        metadata->capacity != 0 ? metadata->capacity * 2 : 16;
+    struct FastaVectorMetadata *newData = realloc(
+        metadata->data, newCapacity * sizeof(struct FastaVectorMetadata));
+    if (newData == NULL) {
+      return false;
+    }
+    metadata->data = newData;
+    metadata->capacity = newCapacity;
+  }
+  metadata->data[metadata->count].headerEndPosition = headerEndPosition;
+  metadata->data[metadata->count].sequenceEndPosition = sequenceEndPosition;
+  metadata->count++;
+  return true;
+}
+
+// appends the headers and sequence boundaries of the index's sequences, which
+// start at sequenceOffset in the merged sequence. An index without a fasta
+// vector holds one sequence with an empty header.
+static bool
+appendFastaRecords(struct FastaVector *_RESTRICT_ const fastaVector,
+                   const struct AwFmIndex *_RESTRICT_ const index,
+                   const size_t sequenceOffset) {
+  const size_t headerOffset = fastaVector->header.count;
+  if (index->fastaVector == NULL) {
+    return appendMetadata(&fastaVector->metadata, headerOffset,
+                          sequenceOffset + index->bwtLength - 1);
+  }
+
+  const struct FastaVector *source = index->fastaVector;
+  if (!appendHeader(&fastaVector->header, source->header.charData,
+                    source->header.count)) {
+    return false;
+  }
+  for (size_t i = 0; i < source->metadata.count; i++) {
+    if (!appendMetadata(
+            &fastaVector->metadata,
+            headerOffset + source->metadata.data[i].headerEndPosition,
+            sequenceOffset + source->metadata.data[i].sequenceEndPosition)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static struct FastaVector *
+mergeFastaVectors(const struct AwFmIndex *_RESTRICT_ const firstIndex,
+                  const struct AwFmIndex *_RESTRICT_ const secondIndex) {
+  struct FastaVector *fastaVector = malloc(sizeof(struct FastaVector));
+  if (fastaVector == NULL) {
+    return NULL;
+  }
+  if (fastaVectorInit(fastaVector) == FASTA_VECTOR_ALLOCATION_FAIL) {
+    free(fastaVector);
+    return NULL;
+  }
+  // like an index built from a fasta, only the headers and metadata are kept.
+  fastaVectorStringDealloc(&fastaVector->sequence);
+  fastaVector->sequence.charData = NULL;
+  fastaVector->sequence.capacity = 0;
+  fastaVector->sequence.count = 0;
+
+  if (!appendFastaRecords(fastaVector, firstIndex, 0) ||
+      !appendFastaRecords(fastaVector, secondIndex,
+                          firstIndex->bwtLength - 1)) {
+    fastaVectorDealloc(fastaVector);
+    free(fastaVector);
+    return NULL;
+  }
+  return fastaVector;
+}
+
+// copies the original sequences from the two index files into the sequence
+// section of the merged index file.
+static enum AwFmReturnCode
+copyOriginalSequences(const struct AwFmIndex *_RESTRICT_ const mergedIndex,
+                      const int fileDescriptor,
+                      const struct AwFmIndex *const firstIndex,
+                      const struct AwFmIndex *const secondIndex) {
+  uint8_t *buffer = malloc(AW_FM_MERGE_SEQUENCE_COPY_CHUNK_SIZE);
+  if (buffer == NULL) {
+    return AwFmAllocationFailure;
+  }
+
+  const struct AwFmIndex *sources[2] = {firstIndex, secondIndex};
+  size_t destinationOffset = mergedIndex->sequenceFileOffset;
+  enum AwFmReturnCode returnCode = AwFmSuccess;
+  for (uint8_t sourceIndex = 0; sourceIndex < 2; sourceIndex++) {
+    const struct AwFmIndex *source = sources[sourceIndex];
+    const size_t sequenceLength = source->bwtLength - 1;
+    for (size_t copied = 0;
+         returnCode == AwFmSuccess && copied < sequenceLength;) {
+      size_t chunkLength = sequenceLength - copied;
+      if (chunkLength > AW_FM_MERGE_SEQUENCE_COPY_CHUNK_SIZE) {
+        chunkLength = AW_FM_MERGE_SEQUENCE_COPY_CHUNK_SIZE;
+      }
+      if (awFmFileReadFully(source->fileDescriptor, buffer, chunkLength,
+                            source->sequenceFileOffset + copied) !=
+          AwFmFileReadOkay) {
+        returnCode = AwFmFileReadFail;
+      } else if (awFmFileWriteFully(fileDescriptor, buffer, chunkLength,
+                                    destinationOffset) != AwFmFileWriteOkay) {
+        returnCode = AwFmFileWriteFail;
+      }
+      copied += chunkLength;
+      destinationOffset += chunkLength;
+    }
+  }
+  free(buffer);
+  return returnCode;
+}
+
+// writes every section of the merged index file. The BWT is written in the
+// background while the suffix array is sampled and the kmer seed table is
+// built.
+static enum AwFmReturnCode
+writeMergedIndex(struct AwFmIndex *_RESTRICT_ const mergedIndex,
+                 const struct AwFmIndex *const firstIndex,
+                 const struct AwFmIndex *const secondIndex,
+                 const char *_RESTRICT_ const fileSrc,
+                 struct AwFmBuildStatistics *_RESTRICT_ const statistics) {
+  mergedIndex->fileHandle = fopen(fileSrc, "w+b");
+  if (mergedIndex->fileHandle == NULL) {
+    return AwFmFileAlreadyExists;
+  }
+  const int fileDescriptor = fileno(mergedIndex->fileHandle);
+  struct AwFmFileWriter *writer = awFmFileWriterCreate(
+      fileDescriptor, fileSrc, mergedIndex->useDirectIo);
+  if (writer == NULL) {
+    return AwFmAllocationFailure;
+  }
+  enum AwFmReturnCode returnCode =
+      awFmWriteIndexBwtSections(mergedIndex, writer);
+
+  struct AwFmBuildPhaseTimer phaseTimer;
+  awFmBuildPhaseBegin(&phaseTimer, statistics,
+                      AwFmBuildPhaseSuffixArraySampling);
+  if (returnCode == AwFmSuccess) {
+    returnCode = writeSuffixArraySamples(mergedIndex, fileDescriptor);
+  }
+  awFmBuildPhaseEnd(&phaseTimer);
+
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseReadSequence);
+  if (returnCode == AwFmSuccess &&
+      mergedIndex->config.storeOriginalSequence) {
+    returnCode = copyOriginalSequences(mergedIndex, fileDescriptor,
+                                       firstIndex, secondIndex);
+  }
+  awFmBuildPhaseEnd(&phaseTimer);
+
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseKmerSeedTable);
+  populateKmerSeedTable(mergedIndex);
+  awFmBuildPhaseEnd(&phaseTimer);
+
+  awFmBuildPhaseBegin(&phaseTimer, statistics, AwFmBuildPhaseFileWrite);
+  if (returnCode == AwFmSuccess) {
+    returnCode = awFmWriteIndexRemainingSections(
+        mergedIndex, writer, NULL, mergedIndex->bwtLength - 1);
+  }
+  double fileWriteSeconds;
+  double fileWriteWaitSeconds;
+  const enum AwFmReturnCode writeReturnCode =
+      awFmFileWriterFinish(writer, &fileWriteSeconds, &fileWriteWaitSeconds);
+  awFmBuildPhaseEnd(&phaseTimer);
+  mergedIndex->fileDescriptor = fileDescriptor;
+  if (statistics != NULL) {
+    statistics->fileWriteSeconds = fileWriteSeconds;
+    statistics->fileWriteWaitSeconds = fileWriteWaitSeconds;
+  }
+  return returnCode == AwFmSuccess ? writeReturnCode : returnCode;
+}
+
+enum AwFmReturnCode
+awFmMergeIndices(struct AwFmIndex *_RESTRICT_ *mergedIndex,
+                 const struct AwFmIndexConfiguration *_RESTRICT_ const config,
+                 const struct AwFmIndex *const firstIndex,
+                 const struct AwFmIndex *const secondIndex,
+                 const char *_RESTRICT_ const fileSrc,
+                 const struct AwFmIndexBuildOptions *_RESTRICT_ const options) {
+  if (mergedIndex == NULL || config == NULL || firstIndex == NULL ||
+      secondIndex == NULL || fileSrc == NULL) {
+    return AwFmNullPtrError;
+  }
+  *mergedIndex = NULL;
+
+  // reduced amino indices depend on their letter maps, which merging
+  // doesn't reconcile.
+  if (config->alphabetType == AwFmAlphabetReducedAmino ||
+      firstIndex->config.alphabetType == AwFmAlphabetReducedAmino ||
+      secondIndex->config.alphabetType == AwFmAlphabetReducedAmino) {
+    return AwFmFeatureUnsupported;
+  }
+  const bool isAmino = config->alphabetType == AwFmAlphabetAmino;
+  if ((firstIndex->config.alphabetType == AwFmAlphabetAmino) != isAmino ||
+      (secondIndex->config.alphabetType == AwFmAlphabetAmino) != isAmino) {
+    return AwFmIncompatibleIndices;
+  }
+  if (config->storeOriginalSequence &&
+      (!firstIndex->config.storeOriginalSequence ||
+       !secondIndex->config.storeOriginalSequence)) {
+    return AwFmIncompatibleIndices;
+  }
+  if (firstIndex->bwtLength < 2 || secondIndex->bwtLength < 2) {
+    return AwFmNoDatabaseSequenceGiven;
+  }
+
+  struct AwFmBuildStatistics *statistics =
+      options != NULL ? options->buildStatistics : NULL;
+  if (statistics != NULL) {
+    *statistics = (struct AwFmBuildStatistics){0};
+  }
+
+  const size_t bwtLength = firstIndex->bwtLength + secondIndex->bwtLength - 1;
+  struct AwFmIndex *indexData =
+      awFmIndexAlloc(config, options, bwtLength, true);
+  if (indexData == NULL) {
+    return AwFmAllocationFailure;
+  }
+  indexData->versionNumber = AW_FM_CURRENT_VERSION_NUMBER;
+  indexData->featureFlags = 1 << AW_FM_FEATURE_FLAG_BIT_FASTA_VECTOR;
+  indexData->suffixArray.values = NULL;
+  indexData->suffixArray.valueBitWidth =
+      awFmComputeSuffixArrayValueMinWidth(bwtLength);
+  indexData->suffixArray.compressedByteLength =
+      awFmComputeCompressedSaSizeInBytes(bwtLength,
+                                         config->suffixArrayCompressionRatio);
+  indexData->suffixArrayFileOffset = awFmGetSuffixArrayFileOffset(indexData);
+  indexData->sequenceFileOffset = awFmGetSequenceFileOffset(indexData);
+  indexData->fastaVector = mergeFastaVectors(firstIndex, secondIndex);
+  if (indexData->fastaVector == NULL) {
+    awFmDeallocIndex(indexData);
+    return AwFmAllocationFailure;
+  }
+
+  const uint64_t firstReadFailures = awFmDiskBwtReadFailures(firstIndex);
+  const uint64_t secondReadFailures = awFmDiskBwtReadFailures(secondIndex);
+  enum AwFmReturnCode returnCode =
+      buildMergedBwt(indexData, firstIndex, secondIndex, statistics);
+  if (returnCode == AwFmSuccess) {
+    returnCode = writeMergedIndex(indexData, firstIndex, secondIndex, fileSrc,
+                                  statistics);
+  }
+  returnCode =
+      awFmDiskBwtCheckReads(firstIndex, firstReadFailures, returnCode);
+  returnCode =
+      awFmDiskBwtCheckReads(secondIndex, secondReadFailures, returnCode);
+  if (returnCode != AwFmFileWriteOkay) {
+    awFmDeallocIndex(indexData);
+    return returnCode;
+  }
+
+  if (config->keepSuffixArrayInMemory) {
+    indexData->suffixArray.values =
+        malloc(indexData->suffixArray.compressedByteLength);
+    if (indexData->suffixArray.values == NULL) {
+      returnCode = AwFmAllocationFailure;
+    } else if (awFmFileReadFully(indexData->fileDescriptor,
+                                 indexData->suffixArray.values,
+                                 indexData->suffixArray.compressedByteLength,
+                                 indexData->suffixArrayFileOffset) !=
+               AwFmFileReadOkay) {
+      returnCode = AwFmFileReadFail;
+    }
+  }
+
+  if (statistics != NULL) {
+    // the sort holds the first sequence, its ranks in the second index, and
+    // two copies of its suffixes' keys alongside the merged index.
+    const size_t firstLength = firstIndex->bwtLength - 1;
+    statistics->peakConstructionBytes =
+        awFmGetBwtBlockListByteLength(indexData) +
+        (awFmGetKmerTableLength(indexData) * sizeof(struct AwFmSearchRange)) +
+        (firstLength * (1 + sizeof(uint64_t))) +
+        ((firstLength + 1) *
+         (sizeof(struct AwFmMergeSuffix) + sizeof(uint64_t) +
+          sizeof(struct AwFmMergeGroup)));
+    statistics->suffixArrayPartitions = 1;
+  }
+
+  *mergedIndex = indexData;
+  return returnCode;
+}
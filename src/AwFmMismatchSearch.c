@@ -0,0 +1,147 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "AwFmApproximateSearch.h"
+#include "AwFmIndex.h"
+#include "AwFmIndexStruct.h"
+#include "AwFmLetter.h"
+#include "AwFmSearch.h"
+
+static const struct AwFmHitListLayout mismatchHitListLayout = {
+    .searchDataSize = sizeof(struct AwFmMismatchSearchData),
+    .hitsOffset = offsetof(struct AwFmMismatchSearchData, hits),
+    .countOffset = offsetof(struct AwFmMismatchSearchData, count),
+    .capacityOffset = offsetof(struct AwFmMismatchSearchData, capacity),
+    .hitSize = sizeof(struct AwFmMismatchHit),
+    .rangeOffset = offsetof(struct AwFmMismatchHit, range),
+    .positionListOffset = offsetof(struct AwFmMismatchHit, positionList)};
+
+// hits are scored by the negated number of mismatches.
+static bool appendHit(void *searchData, const struct AwFmSearchRange range,
+                      const int32_t score) {
+  const struct AwFmMismatchHit hit = {
+      .range = range, .numMismatches = -score, .positionList = NULL};
+  return awFmHitListAppend(&mismatchHitListLayout, searchData, &hit);
+}
+
+// sets lowerBounds[i] to a lower bound on the mismatches in any hit of the
+// kmer's first i + 1 letters. Each piece of the kmer that doesn't occur in
+// the database holds a mismatch, so the bound is the number of disjoint such
+// pieces, found by taking the one that ends first each time.
+static void
+findLowerBounds(const struct AwFmIndex *_RESTRICT_ const index,
+                const uint8_t *_RESTRICT_ const letters,
+                const size_t kmerLength,
+                int32_t *_RESTRICT_ const lowerBounds) {
+  const uint8_t ambiguityLetterIndex =
+      awFmGetAlphabetCardinality(index->config.alphabetType);
+  int32_t numPieces = 0;
+  size_t pieceStart = 0;
+  for (size_t pieceEnd = 0; pieceEnd < kmerLength; pieceEnd++) {
+    bool pieceOccurs = letters[pieceEnd] != ambiguityLetterIndex;
+    if (pieceOccurs) {
+      struct AwFmSearchRange range = {
+          .startPtr = index->prefixSums[letters[pieceEnd]],
+          .endPtr = index->prefixSums[letters[pieceEnd] + 1] - 1};
+      pieceOccurs = awFmSearchRangeIsValid(&range);
+      for (size_t position = pieceEnd; pieceOccurs && position > pieceStart;
+           position--) {
+        if (letters[position - 1] == ambiguityLetterIndex) {
+          pieceOccurs = false;
+          break;
+        }
+        awFmIterativeStepBackwardSearch(index, &range, letters[position - 1]);
+        pieceOccurs = awFmSearchRangeIsValid(&range);
+      }
+    }
+
+    if (!pieceOccurs) {
+      numPieces++;
+      pieceStart = pieceEnd + 1;
+    }
+    lowerBounds[pieceEnd] = numPieces;
+  }
+}
+
+// scores each letter 0 where it matches the kmer and -1 where it doesn't, so
+// a hit's score is its negated number of mismatches. The ambiguity letter
+// never matches, so a kmer can be substituted into an ambiguous stretch of
+// the database.
+static enum AwFmReturnCode
+searchKmer(const struct AwFmIndex *_RESTRICT_ const index, void *searchDataPtr,
+           struct AwFmBranchSearchScratch *_RESTRICT_ const scratch,
+           const void *parameters) {
+  struct AwFmMismatchSearchData *searchData = searchDataPtr;
+  const uint8_t maxMismatches = *(const uint8_t *)parameters;
+  const size_t kmerLength = searchData->kmerLength;
+  if (kmerLength == 0) {
+    return AwFmSuccess;
+  }
+  if (!awFmBranchSearchScratchReserve(scratch, kmerLength)) {
+    return AwFmAllocationFailure;
+  }
+
+  const uint8_t cardinality =
+      awFmGetAlphabetCardinality(index->config.alphabetType);
+  const uint8_t numLetters = cardinality + 1;
+  uint8_t *letters = scratch->letters;
+  for (size_t position = 0; position < kmerLength; position++) {
+    letters[position] =
+        awFmAsciiToLetterIndex(index, searchData->kmerString[position]);
+    int16_t *positionScores = scratch->profile + (position * numLetters);
+    for (uint8_t letterIndex = 0; letterIndex < numLetters; letterIndex++) {
+      positionScores[letterIndex] =
+          letterIndex == letters[position] && letterIndex != cardinality ? 0
+                                                                         : -1;
+    }
+  }
+
+  // bestScoreBefore[i] is the negated lower bound on the mismatches in
+  // positions 0 through i - 1.
+  int32_t *bestScoreBefore = scratch->bestScoreBefore;
+  findLowerBounds(index, letters, kmerLength, bestScoreBefore + 1);
+  bestScoreBefore[0] = 0;
+  for (size_t position = 1; position <= kmerLength; position++) {
+    bestScoreBefore[position] = -bestScoreBefore[position];
+  }
+
+  return awFmBranchAndBoundSearch(index, scratch->profile, kmerLength,
+                                  -(int32_t)maxMismatches, scratch, appendHit,
+                                  searchData);
+}
+
+struct AwFmMismatchSearchList *
+awFmCreateMismatchSearchList(const size_t capacity) {
+  struct AwFmMismatchSearchList *searchList =
+      malloc(sizeof(struct AwFmMismatchSearchList));
+  if (searchList == NULL) {
+    return NULL;
+  }
+  searchList->capacity = capacity;
+  searchList->count = 0;
+  searchList->mismatchSearchData =
+      awFmHitListAllocSearchData(&mismatchHitListLayout, capacity);
+  if (searchList->mismatchSearchData == NULL) {
+    free(searchList);
+    return NULL;
+  }
+  return searchList;
+}
+
+void awFmDeallocMismatchSearchList(
+    struct AwFmMismatchSearchList *_RESTRICT_ const searchList) {
+  awFmHitListDeallocSearchData(&mismatchHitListLayout,
+                               searchList->mismatchSearchData,
+                               searchList->capacity);
+  free(searchList);
+}
+
+enum AwFmReturnCode awFmParallelSearchMismatches(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmMismatchSearchList *_RESTRICT_ const searchList,
+    const uint8_t maxMismatches, const bool locate, uint32_t numThreads) {
+  return awFmParallelApproximateSearch(
+      index, &mismatchHitListLayout, searchList->mismatchSearchData,
+      searchList->count, searchKmer, &maxMismatches, locate, numThreads);
+}
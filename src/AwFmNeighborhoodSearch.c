@@ -0,0 +1,134 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "AwFmApproximateSearch.h"
+#include "AwFmIndex.h"
+#include "AwFmIndexStruct.h"
+#include "AwFmLetter.h"
+#include "AwFmSearch.h"
+
+static const struct AwFmHitListLayout neighborhoodHitListLayout = {
+    .searchDataSize = sizeof(struct AwFmNeighborhoodSearchData),
+    .hitsOffset = offsetof(struct AwFmNeighborhoodSearchData, hits),
+    .countOffset = offsetof(struct AwFmNeighborhoodSearchData, count),
+    .capacityOffset = offsetof(struct AwFmNeighborhoodSearchData, capacity),
+    .hitSize = sizeof(struct AwFmNeighborhoodHit),
+    .rangeOffset = offsetof(struct AwFmNeighborhoodHit, range),
+    .positionListOffset = offsetof(struct AwFmNeighborhoodHit, positionList)};
+
+// the scoring of a search, shared by every query in its list.
+struct AwFmNeighborhoodParameters {
+  const int16_t *substitutionMatrix;
+  int32_t minScore;
+};
+
+static bool appendHit(void *searchData, const struct AwFmSearchRange range,
+                      const int32_t score) {
+  const struct AwFmNeighborhoodHit hit = {
+      .range = range, .score = score, .positionList = NULL};
+  return awFmHitListAppend(&neighborhoodHitListLayout, searchData, &hit);
+}
+
+// builds the profile of a query word from the substitution matrix rows of
+// its letters.
+static void
+makeMatrixProfile(const struct AwFmIndex *_RESTRICT_ const index,
+                  const struct AwFmNeighborhoodSearchData *_RESTRICT_ const
+                      searchData,
+                  const int16_t *_RESTRICT_ const substitutionMatrix,
+                  int16_t *_RESTRICT_ const profile) {
+  const uint8_t numLetters =
+      awFmGetAlphabetCardinality(index->config.alphabetType) + 1;
+  for (size_t position = 0; position < searchData->kmerLength; position++) {
+    const uint8_t letterIndex =
+        awFmAsciiToLetterIndex(index, searchData->kmerString[position]);
+    for (uint8_t i = 0; i < numLetters; i++) {
+      profile[(position * numLetters) + i] =
+          substitutionMatrix[(letterIndex * numLetters) + i];
+    }
+  }
+}
+
+static enum AwFmReturnCode
+searchQuery(const struct AwFmIndex *_RESTRICT_ const index,
+            void *searchDataPtr,
+            struct AwFmBranchSearchScratch *_RESTRICT_ const scratch,
+            const void *parametersPtr) {
+  struct AwFmNeighborhoodSearchData *searchData = searchDataPtr;
+  const struct AwFmNeighborhoodParameters *parameters = parametersPtr;
+  const size_t kmerLength = searchData->kmerLength;
+  if (kmerLength == 0) {
+    return AwFmSuccess;
+  }
+  if (searchData->profile == NULL && parameters->substitutionMatrix == NULL) {
+    return AwFmNullPtrError;
+  }
+  if (!awFmBranchSearchScratchReserve(scratch, kmerLength)) {
+    return AwFmAllocationFailure;
+  }
+
+  const uint8_t numLetters =
+      awFmGetAlphabetCardinality(index->config.alphabetType) + 1;
+  const int16_t *profile = searchData->profile;
+  if (profile == NULL) {
+    makeMatrixProfile(index, searchData, parameters->substitutionMatrix,
+                      scratch->profile);
+    profile = scratch->profile;
+  }
+
+  // bestScoreBefore[i] is the most that positions 0 through i - 1 can add,
+  // which is all the positions a branch at position i has left.
+  int32_t *bestScoreBefore = scratch->bestScoreBefore;
+  bestScoreBefore[0] = 0;
+  for (size_t position = 0; position < kmerLength; position++) {
+    int16_t bestScore = profile[position * numLetters];
+    for (uint8_t i = 1; i < numLetters; i++) {
+      const int16_t score = profile[(position * numLetters) + i];
+      bestScore = score > bestScore ? score : bestScore;
+    }
+    bestScoreBefore[position + 1] = bestScoreBefore[position] + bestScore;
+  }
+
+  return awFmBranchAndBoundSearch(index, profile, kmerLength,
+                                  parameters->minScore, scratch, appendHit,
+                                  searchData);
+}
+
+struct AwFmNeighborhoodSearchList *
+awFmCreateNeighborhoodSearchList(const size_t capacity) {
+  struct AwFmNeighborhoodSearchList *searchList =
+      malloc(sizeof(struct AwFmNeighborhoodSearchList));
+  if (searchList == NULL) {
+    return NULL;
+  }
+  searchList->capacity = capacity;
+  searchList->count = 0;
+  searchList->neighborhoodSearchData =
+      awFmHitListAllocSearchData(&neighborhoodHitListLayout, capacity);
+  if (searchList->neighborhoodSearchData == NULL) {
+    free(searchList);
+    return NULL;
+  }
+  return searchList;
+}
+
+void awFmDeallocNeighborhoodSearchList(
+    struct AwFmNeighborhoodSearchList *_RESTRICT_ const searchList) {
+  awFmHitListDeallocSearchData(&neighborhoodHitListLayout,
+                               searchList->neighborhoodSearchData,
+                               searchList->capacity);
+  free(searchList);
+}
+
+enum AwFmReturnCode awFmParallelSearchNeighborhood(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmNeighborhoodSearchList *_RESTRICT_ const searchList,
+    const int16_t *_RESTRICT_ const substitutionMatrix, const int32_t minScore,
+    const bool locate, uint32_t numThreads) {
+  const struct AwFmNeighborhoodParameters parameters = {
+      .substitutionMatrix = substitutionMatrix, .minScore = minScore};
+  return awFmParallelApproximateSearch(
+      index, &neighborhoodHitListLayout, searchList->neighborhoodSearchData,
+      searchList->count, searchQuery, &parameters, locate, numThreads);
+}
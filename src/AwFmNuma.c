@@ -0,0 +1,350 @@
+// cpu_set_t and sched_setaffinity need _GNU_SOURCE.
+#define _GNU_SOURCE
+
+#include "AwFmNuma.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "AwFmIndexStruct.h"
+#include "AwFmMemory.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#define AW_FM_NUMA_SYSFS_NODE_DIR "/sys/devices/system/node"
+#define AW_FM_NUMA_MAX_NODES 64
+#define AW_FM_NUMA_LIST_BUFFER_SIZE 4096
+
+#ifdef __linux__
+
+_Static_assert(sizeof(cpu_set_t) <=
+                   sizeof(((struct AwFmNumaThreadBinding *)0)->previousAffinity),
+               "AwFmNumaThreadBinding is too small to hold a cpu_set_t");
+
+struct AwFmNumaReplica {
+  uint32_t nodeId;
+  // false if the node's cpus couldn't be determined, in which case threads
+  // reading this replica are left unpinned.
+  bool hasCpuSet;
+  cpu_set_t cpuSet;
+  // the replica promoted to the index's own bwt and seed table is freed by
+  // awFmDeallocIndex instead.
+  bool ownsArrays;
+  union AwFmBwtBlockList bwtBlockList;
+  struct AwFmSearchRange *kmerSeedTable;
+  enum AwFmAllocationPolicy bwtAllocationPolicy;
+  enum AwFmAllocationPolicy kmerSeedTableAllocationPolicy;
+};
+
+struct AwFmNumaReplicaSet {
+  uint32_t replicaCount;
+  struct AwFmNumaReplica *replicas;
+};
+
+/*
+ * Function:  awFmNumaParseList
+ * --------------------
+ * Parses a sysfs list file (e.g., "0-3,8-11") into the given values array.
+ *
+ *  Returns:
+ *    Number of values written, or 0 if the file couldn't be read.
+ */
+static size_t awFmNumaParseList(const char *fileSrc, uint32_t *values,
+                                const size_t capacity) {
+  FILE *listFile = fopen(fileSrc, "r");
+  if (listFile == NULL) {
+    return 0;
+  }
+  char buffer[AW_FM_NUMA_LIST_BUFFER_SIZE];
+  const size_t bytesRead = fread(buffer, 1, sizeof(buffer) - 1, listFile);
+  fclose(listFile);
+  buffer[bytesRead] = 0;
+
+  size_t count = 0;
+  char *cursor = buffer;
+  while (*cursor != 0 && *cursor != '\n') {
+    char *rangeEnd;
+    const unsigned long rangeStart = strtoul(cursor, &rangeEnd, 10);
+    if (rangeEnd == cursor) {
+      break;
+    }
+    unsigned long rangeLast = rangeStart;
+    cursor = rangeEnd;
+    if (*cursor == '-') {
+      cursor++;
+      rangeLast = strtoul(cursor, &rangeEnd, 10);
+      cursor = rangeEnd;
+    }
+    for (unsigned long value = rangeStart;
+         value <= rangeLast && count < capacity; value++) {
+      values[count++] = value;
+    }
+    if (*cursor == ',') {
+      cursor++;
+    }
+  }
+  return count;
+}
+
+/*
+ * Function:  awFmNumaDiscoverNodes
+ * --------------------
+ * Finds the online NUMA nodes that have at least one cpu this process may run
+ * on, and stores each node's usable cpus in the given replicas.
+ *
+ *  Returns:
+ *    Number of nodes found, or 0 if the topology couldn't be read.
+ */
+static uint32_t
+awFmNumaDiscoverNodes(struct AwFmNumaReplica *_RESTRICT_ const replicas,
+                      const cpu_set_t *_RESTRICT_ const processAffinity) {
+  uint32_t nodeIds[AW_FM_NUMA_MAX_NODES];
+  const size_t nodeCount = awFmNumaParseList(
+      AW_FM_NUMA_SYSFS_NODE_DIR "/online", nodeIds, AW_FM_NUMA_MAX_NODES);
+
+  uint32_t *cpuIds = malloc(CPU_SETSIZE * sizeof(uint32_t));
+  if (cpuIds == NULL) {
+    return 0;
+  }
+
+  uint32_t replicaCount = 0;
+  for (size_t i = 0; i < nodeCount; i++) {
+    char cpuListSrc[128];
+    snprintf(cpuListSrc, sizeof(cpuListSrc),
+             AW_FM_NUMA_SYSFS_NODE_DIR "/node%u/cpulist", nodeIds[i]);
+    const size_t cpuCount =
+        awFmNumaParseList(cpuListSrc, cpuIds, CPU_SETSIZE);
+
+    struct AwFmNumaReplica *replica = &replicas[replicaCount];
+    CPU_ZERO(&replica->cpuSet);
+    for (size_t cpu = 0; cpu < cpuCount; cpu++) {
+      if (cpuIds[cpu] < CPU_SETSIZE && CPU_ISSET(cpuIds[cpu], processAffinity)) {
+        CPU_SET(cpuIds[cpu], &replica->cpuSet);
+      }
+    }
+
+    // memory-only nodes, and nodes this process isn't allowed to run on, get
+    // no replica since no worker thread could be local to them.
+    if (CPU_COUNT(&replica->cpuSet) > 0) {
+      replica->nodeId = nodeIds[i];
+      replica->hasCpuSet = true;
+      replicaCount++;
+    }
+  }
+
+  free(cpuIds);
+  return replicaCount;
+}
+
+static void
+awFmNumaPinThread(const struct AwFmNumaReplica *_RESTRICT_ const replica,
+                  struct AwFmNumaThreadBinding *_RESTRICT_ const binding) {
+  binding->affinityChanged = false;
+  if (!replica->hasCpuSet) {
+    return;
+  }
+
+  cpu_set_t previousAffinity;
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &previousAffinity) != 0) {
+    return;
+  }
+  if (sched_setaffinity(0, sizeof(cpu_set_t), &replica->cpuSet) == 0) {
+    memcpy(binding->previousAffinity, &previousAffinity, sizeof(cpu_set_t));
+    binding->affinityChanged = true;
+  }
+}
+
+void awFmNumaUnbindThread(
+    const struct AwFmNumaThreadBinding *_RESTRICT_ const binding) {
+  if (binding->affinityChanged) {
+    cpu_set_t previousAffinity;
+    memcpy(&previousAffinity, binding->previousAffinity, sizeof(cpu_set_t));
+    sched_setaffinity(0, sizeof(cpu_set_t), &previousAffinity);
+  }
+}
+
+const struct AwFmIndex *
+awFmNumaBindThread(const struct AwFmIndex *_RESTRICT_ const index,
+                   struct AwFmIndex *_RESTRICT_ const localIndexBuffer,
+                   struct AwFmNumaThreadBinding *_RESTRICT_ const binding) {
+  binding->affinityChanged = false;
+  const struct AwFmNumaReplicaSet *replicaSet = index->numaReplicas;
+  if (replicaSet == NULL) {
+    return index;
+  }
+
+  const struct AwFmNumaReplica *replica =
+      &replicaSet->replicas[omp_get_thread_num() % replicaSet->replicaCount];
+  awFmNumaPinThread(replica, binding);
+
+  memcpy(localIndexBuffer, index, sizeof(struct AwFmIndex));
+  localIndexBuffer->bwtBlockList = replica->bwtBlockList;
+  localIndexBuffer->kmerSeedTable = replica->kmerSeedTable;
+  return localIndexBuffer;
+}
+
+static void
+awFmNumaDeallocReplicaSet(struct AwFmNumaReplicaSet *_RESTRICT_ replicaSet,
+                          const size_t bwtByteLength,
+                          const size_t kmerSeedTableByteLength) {
+  for (uint32_t i = 0; i < replicaSet->replicaCount; i++) {
+    struct AwFmNumaReplica *replica = &replicaSet->replicas[i];
+    if (replica->ownsArrays) {
+      awFmFreeLargeArray(replica->bwtBlockList.asNucleotide, bwtByteLength,
+                         replica->bwtAllocationPolicy);
+      awFmFreeLargeArray(replica->kmerSeedTable, kmerSeedTableByteLength,
+                         replica->kmerSeedTableAllocationPolicy);
+    }
+  }
+  free(replicaSet->replicas);
+  free(replicaSet);
+}
+
+void awFmNumaDeallocReplicas(struct AwFmIndex *_RESTRICT_ const index) {
+  if (index->numaReplicas != NULL) {
+    awFmNumaDeallocReplicaSet(index->numaReplicas,
+                              awFmGetBwtBlockListByteLength(index),
+                              awFmGetKmerTableLength(index) *
+                                  sizeof(struct AwFmSearchRange));
+    index->numaReplicas = NULL;
+  }
+}
+
+enum AwFmReturnCode
+awFmReplicateIndexAcrossNumaNodes(struct AwFmIndex *_RESTRICT_ const index) {
+  if (index == NULL) {
+    return AwFmNullPtrError;
+  }
+  if (index->numaReplicas != NULL) {
+    return AwFmSuccess;
+  }
+  // a BWT left on disk is read through its shared block cache instead.
+  if (index->bwtBlockList.asNucleotide == NULL) {
+    return AwFmFeatureUnsupported;
+  }
+
+  cpu_set_t processAffinity;
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &processAffinity) != 0) {
+    return AwFmFeatureUnsupported;
+  }
+
+  struct AwFmNumaReplicaSet *replicaSet =
+      malloc(sizeof(struct AwFmNumaReplicaSet));
+  if (replicaSet == NULL) {
+    return AwFmAllocationFailure;
+  }
+  replicaSet->replicas =
+      calloc(AW_FM_NUMA_MAX_NODES, sizeof(struct AwFmNumaReplica));
+  if (replicaSet->replicas == NULL) {
+    free(replicaSet);
+    return AwFmAllocationFailure;
+  }
+
+  replicaSet->replicaCount =
+      awFmNumaDiscoverNodes(replicaSet->replicas, &processAffinity);
+  if (replicaSet->replicaCount == 0) {
+    // no sysfs topology (e.g., inside some containers). Treat the machine as
+    // a single node and leave threads unpinned.
+    replicaSet->replicaCount = 1;
+    replicaSet->replicas[0].hasCpuSet = false;
+  }
+
+  const size_t bwtByteLength = awFmGetBwtBlockListByteLength(index);
+  const size_t kmerSeedTableByteLength =
+      awFmGetKmerTableLength(index) * sizeof(struct AwFmSearchRange);
+  bool allocationFailed = false;
+
+  // each replica is allocated and copied by a thread pinned to its node, so
+  // first-touch placement puts every page of the replica in that node's memory.
+#pragma omp parallel for schedule(static, 1)                                  \
+    num_threads(replicaSet->replicaCount)
+  for (uint32_t i = 0; i < replicaSet->replicaCount; i++) {
+    struct AwFmNumaReplica *replica = &replicaSet->replicas[i];
+    struct AwFmNumaThreadBinding binding;
+    awFmNumaPinThread(replica, &binding);
+
+    replica->ownsArrays = true;
+    replica->bwtBlockList.asNucleotide =
+        awFmAllocLargeArray(bwtByteLength, index->allocationPolicy,
+                            &replica->bwtAllocationPolicy);
+    replica->kmerSeedTable = awFmAllocLargeArray(
+        kmerSeedTableByteLength, index->allocationPolicy,
+        &replica->kmerSeedTableAllocationPolicy);
+
+    if (replica->bwtBlockList.asNucleotide == NULL ||
+        replica->kmerSeedTable == NULL) {
+#pragma omp atomic write
+      allocationFailed = true;
+    } else {
+      memcpy(replica->bwtBlockList.asNucleotide,
+             index->bwtBlockList.asNucleotide, bwtByteLength);
+      memcpy(replica->kmerSeedTable, index->kmerSeedTable,
+             kmerSeedTableByteLength);
+    }
+
+    awFmNumaUnbindThread(&binding);
+  }
+
+  if (allocationFailed) {
+    awFmNumaDeallocReplicaSet(replicaSet, bwtByteLength,
+                              kmerSeedTableByteLength);
+    return AwFmAllocationFailure;
+  }
+
+  // the original arrays were likely touched by whichever threads loaded the
+  // file, so they're spread across nodes. Replace them with the first replica
+  // rather than keeping an extra copy around.
+  struct AwFmNumaReplica *primaryReplica = &replicaSet->replicas[0];
+  awFmFreeLargeArray(index->bwtBlockList.asNucleotide, bwtByteLength,
+                     index->bwtAllocationPolicy);
+  awFmFreeLargeArray(index->kmerSeedTable, kmerSeedTableByteLength,
+                     index->kmerSeedTableAllocationPolicy);
+  index->bwtBlockList = primaryReplica->bwtBlockList;
+  index->kmerSeedTable = primaryReplica->kmerSeedTable;
+  index->bwtAllocationPolicy = primaryReplica->bwtAllocationPolicy;
+  index->kmerSeedTableAllocationPolicy =
+      primaryReplica->kmerSeedTableAllocationPolicy;
+  primaryReplica->ownsArrays = false;
+
+  index->numaReplicas = replicaSet;
+  return AwFmSuccess;
+}
+
+uint32_t awFmGetNumaReplicaCount(const struct AwFmIndex *_RESTRICT_ const index) {
+  return index->numaReplicas == NULL ? 0 : index->numaReplicas->replicaCount;
+}
+
+#else
+
+// thread pinning and first-touch placement are only implemented for linux.
+const struct AwFmIndex *
+awFmNumaBindThread(const struct AwFmIndex *_RESTRICT_ const index,
+                   struct AwFmIndex *_RESTRICT_ const localIndexBuffer,
+                   struct AwFmNumaThreadBinding *_RESTRICT_ const binding) {
+  (void)localIndexBuffer;
+  binding->affinityChanged = false;
+  return index;
+}
+
+void awFmNumaUnbindThread(
+    const struct AwFmNumaThreadBinding *_RESTRICT_ const binding) {
+  (void)binding;
+}
+
+void awFmNumaDeallocReplicas(struct AwFmIndex *_RESTRICT_ const index) {
+  (void)index;
+}
+
+enum AwFmReturnCode
+awFmReplicateIndexAcrossNumaNodes(struct AwFmIndex *_RESTRICT_ const index) {
+  return index == NULL ? AwFmNullPtrError : AwFmFeatureUnsupported;
+}
+
+uint32_t awFmGetNumaReplicaCount(const struct AwFmIndex *_RESTRICT_ const index) {
+  (void)index;
+  return 0;
+}
+
+#endif
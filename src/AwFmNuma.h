@@ -0,0 +1,61 @@
+#ifndef AW_FM_NUMA_H
+#define AW_FM_NUMA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "AwFmIndex.h"
+
+/*Saved state for a worker thread that was pinned to a NUMA node by
+ * awFmNumaBindThread. The previous affinity is stored as raw bytes so this
+ * header doesn't need _GNU_SOURCE for cpu_set_t.*/
+struct AwFmNumaThreadBinding {
+  bool affinityChanged;
+  uint64_t previousAffinity[16];
+};
+
+/*
+ * Function:  awFmNumaBindThread
+ * --------------------
+ * Called by each worker thread at the start of an OpenMP parallel region.
+ * If the index has been replicated across NUMA nodes, pins the calling thread
+ * to the cpus of the node assigned to its OpenMP thread number, and returns a
+ * shallow copy of the index whose BWT and kmer seed table point to that node's
+ * replica. Otherwise, the given index is returned unchanged.
+ *
+ *  Inputs:
+ *    index:            Index shared by every thread.
+ *    localIndexBuffer: Thread-local storage for the shallow index copy.
+ *    binding:          Receives the thread's previous affinity, to be given to
+ *      awFmNumaUnbindThread at the end of the parallel region.
+ *
+ *  Returns:
+ *    Pointer to the index the calling thread should search.
+ */
+const struct AwFmIndex *
+awFmNumaBindThread(const struct AwFmIndex *_RESTRICT_ const index,
+                   struct AwFmIndex *_RESTRICT_ const localIndexBuffer,
+                   struct AwFmNumaThreadBinding *_RESTRICT_ const binding);
+
+/*
+ * Function:  awFmNumaUnbindThread
+ * --------------------
+ * Restores the cpu affinity the calling thread had before awFmNumaBindThread.
+ *
+ *  Inputs:
+ *    binding:  Binding previously filled by awFmNumaBindThread.
+ */
+void awFmNumaUnbindThread(
+    const struct AwFmNumaThreadBinding *_RESTRICT_ const binding);
+
+/*
+ * Function:  awFmNumaDeallocReplicas
+ * --------------------
+ * Frees every NUMA replica owned by the index. The replica that was promoted
+ * to the index's own BWT and kmer seed table is left for awFmDeallocIndex.
+ *
+ *  Inputs:
+ *    index:  Index whose replicas should be freed. numaReplicas may be NULL.
+ */
+void awFmNumaDeallocReplicas(struct AwFmIndex *_RESTRICT_ const index);
+
+#endif /* end of include guard: AW_FM_NUMA_H */
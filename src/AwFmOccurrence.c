@@ -134,6 +134,60 @@ AwFmSimdVec256 awFmMakeAminoAcidOccurrenceVector(
   }
 }
 
+AwFmSimdVec256 awFmMakeReducedAminoOccurrenceVector(
+    const struct AwFmReducedAminoBlock *_RESTRICT_ const blockPtr,
+    const uint8_t letter) {
+  // load the letter bit vectors
+  const AwFmSimdVec256 *_RESTRICT_ const blockVectorPtr =
+      blockPtr->letterBitVectors;
+  const AwFmSimdVec256 bit0Vector = AwFmSimdVecLoad(blockVectorPtr);
+  const AwFmSimdVec256 bit1Vector = AwFmSimdVecLoad(blockVectorPtr + 1);
+  const AwFmSimdVec256 bit2Vector = AwFmSimdVecLoad(blockVectorPtr + 2);
+  const AwFmSimdVec256 bit3Vector = AwFmSimdVecLoad(blockVectorPtr + 3);
+
+  // encodings 0b1101 through 0b1111 are never used, so some letters don't
+  // need to check every bit.
+  switch (letter) {
+  case 0: /*encoding 0b0001*/
+    return AwFmSimdVecAndNot(AwFmSimdVecOr(bit3Vector, bit2Vector),
+                             AwFmSimdVecAndNot(bit1Vector, bit0Vector));
+  case 1: /*encoding 0b0010*/
+    return AwFmSimdVecAndNot(AwFmSimdVecOr(bit3Vector, bit2Vector),
+                             AwFmSimdVecAndNot(bit0Vector, bit1Vector));
+  case 2: /*encoding 0b0011*/
+    return AwFmSimdVecAndNot(AwFmSimdVecOr(bit3Vector, bit2Vector),
+                             AwFmSimdVecAnd(bit1Vector, bit0Vector));
+  case 3: /*encoding 0b0100*/
+    return AwFmSimdVecAndNot(AwFmSimdVecOr(bit3Vector, bit1Vector),
+                             AwFmSimdVecAndNot(bit0Vector, bit2Vector));
+  case 4: /*encoding 0b0101*/
+    return AwFmSimdVecAnd(bit2Vector,
+                          AwFmSimdVecAndNot(bit1Vector, bit0Vector));
+  case 5: /*encoding 0b0110*/
+    return AwFmSimdVecAnd(bit2Vector,
+                          AwFmSimdVecAndNot(bit0Vector, bit1Vector));
+  case 6: /*encoding 0b0111*/
+    return AwFmSimdVecAnd(bit2Vector, AwFmSimdVecAnd(bit1Vector, bit0Vector));
+  case 7: /*encoding 0b1000*/
+    return AwFmSimdVecAndNot(AwFmSimdVecOr(bit2Vector, bit1Vector),
+                             AwFmSimdVecAndNot(bit0Vector, bit3Vector));
+  case 8: /*encoding 0b1001*/
+    return AwFmSimdVecAnd(bit3Vector,
+                          AwFmSimdVecAndNot(bit1Vector, bit0Vector));
+  case 9: /*encoding 0b1010*/
+    return AwFmSimdVecAnd(bit3Vector,
+                          AwFmSimdVecAndNot(bit0Vector, bit1Vector));
+  case 10: /*encoding 0b1011*/
+    return AwFmSimdVecAnd(bit3Vector, AwFmSimdVecAnd(bit1Vector, bit0Vector));
+  case 11: /*ambiguity character encoding 0b1100*/
+    return AwFmSimdVecAnd(bit3Vector, bit2Vector);
+  // 0b0000 is sentinel, but since you can't search for sentinels, it is not
+  // included here.
+  default:
+    __builtin_unreachable();
+  }
+}
+
 inline void awFmBlockPrefetch(const void *_RESTRICT_ const baseBlockListPtr,
                               const uint64_t blockByteWidth,
                               const uint64_t nextQueryPosition) {
@@ -215,3 +269,21 @@ uint8_t awFmGetAminoLetterAtBwtPosition(const struct AwFmAminoBlock *blockPtr,
 
   return awFmAminoAcidCompressedVectorToLetterIndex(letterAsCompressedVector);
 }
+
+uint8_t awFmGetReducedAminoLetterAtBwtPosition(
+    const struct AwFmReducedAminoBlock *blockPtr,
+    const uint8_t localPosition) {
+  const uint8_t byteInBlock = localPosition / 8;
+  const uint8_t bitInBlockByte = localPosition % 8;
+
+  const uint8_t *_RESTRICT_ const letterBytePointer =
+      &((uint8_t *)&blockPtr->letterBitVectors)[byteInBlock];
+  const uint8_t letterAsCompressedVector =
+      ((letterBytePointer[0] >> bitInBlockByte) & 1) |
+      ((letterBytePointer[32] >> bitInBlockByte) & 1) << 1 |
+      ((letterBytePointer[64] >> bitInBlockByte) & 1) << 2 |
+      ((letterBytePointer[96] >> bitInBlockByte) & 1) << 3;
+
+  return awFmReducedAminoCompressedVectorToLetterIndex(
+      letterAsCompressedVector);
+}
@@ -42,6 +42,24 @@ AwFmSimdVec256 awFmMakeAminoAcidOccurrenceVector(
     const struct AwFmAminoBlock *_RESTRICT_ const blockPtr,
     const uint8_t letter);
 
+/*
+ * Function:  awFmMakeReducedAminoOccurrenceVector
+ * --------------------
+ * Computes the vector of characters before the given position equal to the
+ * given letter.
+ *
+ *  Inputs:
+ *    blockPtr: Pointer to the AwFmReducedAminoBlock in which the query
+ * position resides.
+ *    letter: letter for which the occurrence request is for.
+ *
+ *  Returns:
+ *   Vector with bits set at every position the given letter was found.
+ */
+AwFmSimdVec256 awFmMakeReducedAminoOccurrenceVector(
+    const struct AwFmReducedAminoBlock *_RESTRICT_ const blockPtr,
+    const uint8_t letter);
+
 /*
  * Function:  awFmVectorPopcount
  * --------------------
@@ -124,4 +142,21 @@ awFmGetNucleotideLetterAtBwtPosition(const struct AwFmNucleotideBlock *blockPtr,
 uint8_t awFmGetAminoLetterAtBwtPosition(const struct AwFmAminoBlock *blockPtr,
                                         const uint8_t localPosition);
 
+/*
+ * Function:  awFmGetReducedAminoLetterAtBwtPosition
+ * --------------------
+ * Given a specific position in the reduced amino BWT, returns the letter in
+ * the BWT at this position.
+ *
+ *  Inputs:
+ *    blockList: blockList to be queried.
+ *    localPosition: Position of the character to be returned.
+ *
+ *  Returns:
+ *    letter at the bwtPosition in the specified blockList.
+ */
+uint8_t awFmGetReducedAminoLetterAtBwtPosition(
+    const struct AwFmReducedAminoBlock *blockPtr,
+    const uint8_t localPosition);
+
 #endif /* end of include guard: AW_FM_OCCURANCE_H */
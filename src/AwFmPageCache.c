@@ -0,0 +1,456 @@
+// pread and posix_fadvise need _XOPEN_SOURCE in strict c11 mode.
+#define _XOPEN_SOURCE 600
+
+#include "AwFmPageCache.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define AW_FM_PAGE_CACHE_MAX_SHARDS 64
+#define AW_FM_PAGE_CACHE_MAX_DATA_ALIGNMENT 4096
+#define AW_FM_PAGE_CACHE_NO_FRAME UINT32_MAX
+#define AW_FM_PAGE_CACHE_NO_PAGE SIZE_MAX
+
+struct AwFmPageCacheFrame {
+  size_t pageIndex; // AW_FM_PAGE_CACHE_NO_PAGE if the frame is empty.
+  bool referenced;
+  // set while a thread fills the frame without holding the shard lock. Loading
+  // frames aren't in the table, and can't be chosen for eviction.
+  bool loading;
+};
+
+struct AwFmPageCacheShard {
+  pthread_mutex_t lock;
+  struct AwFmPageCacheFrame *frames;
+  uint8_t *pageData;
+  // open-addressed table mapping page indices to frames, with linear probing.
+  uint32_t *table;
+  uint32_t tableMask;
+  uint32_t frameCount;
+  uint32_t clockHand;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+};
+
+struct AwFmPageCache {
+  int fileDescriptor;
+  size_t fileLength;
+  size_t pageSize;
+  uint32_t shardCount;
+  struct AwFmPageCacheShard *shards;
+  // updated atomically, so failed reads are counted without a shard lock.
+  uint64_t readFailures;
+};
+
+static inline uint64_t awFmPageCacheHash(const size_t pageIndex) {
+  return pageIndex * 0x9E3779B97F4A7C15ULL;
+}
+
+static inline struct AwFmPageCacheShard *
+awFmPageCacheGetShard(const struct AwFmPageCache *_RESTRICT_ const cache,
+                      const uint64_t hash) {
+  return &cache->shards[(hash >> 40) & (cache->shardCount - 1)];
+}
+
+static uint32_t
+awFmPageCacheFindFrame(const struct AwFmPageCacheShard *_RESTRICT_ const shard,
+                       const size_t pageIndex, const uint64_t hash) {
+  for (uint32_t slot = hash & shard->tableMask;
+       shard->table[slot] != AW_FM_PAGE_CACHE_NO_FRAME;
+       slot = (slot + 1) & shard->tableMask) {
+    if (shard->frames[shard->table[slot]].pageIndex == pageIndex) {
+      return shard->table[slot];
+    }
+  }
+  return AW_FM_PAGE_CACHE_NO_FRAME;
+}
+
+static void
+awFmPageCacheTableInsert(struct AwFmPageCacheShard *_RESTRICT_ const shard,
+                         const uint32_t frameIndex, const uint64_t hash) {
+  uint32_t slot = hash & shard->tableMask;
+  while (shard->table[slot] != AW_FM_PAGE_CACHE_NO_FRAME) {
+    slot = (slot + 1) & shard->tableMask;
+  }
+  shard->table[slot] = frameIndex;
+}
+
+// removes the frame's page from the table, shifting back any later entries in
+// the probe sequence so lookups never stop early at the hole.
+static void
+awFmPageCacheTableRemove(struct AwFmPageCacheShard *_RESTRICT_ const shard,
+                         const uint32_t frameIndex) {
+  const uint64_t hash =
+      awFmPageCacheHash(shard->frames[frameIndex].pageIndex);
+  uint32_t hole = hash & shard->tableMask;
+  while (shard->table[hole] != frameIndex) {
+    hole = (hole + 1) & shard->tableMask;
+  }
+  shard->table[hole] = AW_FM_PAGE_CACHE_NO_FRAME;
+
+  uint32_t slot = hole;
+  while (true) {
+    slot = (slot + 1) & shard->tableMask;
+    if (shard->table[slot] == AW_FM_PAGE_CACHE_NO_FRAME) {
+      return;
+    }
+    const uint32_t homeSlot =
+        awFmPageCacheHash(shard->frames[shard->table[slot]].pageIndex) &
+        shard->tableMask;
+    const bool homeBetweenHoleAndSlot =
+        hole <= slot ? (hole < homeSlot && homeSlot <= slot)
+                     : (hole < homeSlot || homeSlot <= slot);
+    if (!homeBetweenHoleAndSlot) {
+      shard->table[hole] = shard->table[slot];
+      shard->table[slot] = AW_FM_PAGE_CACHE_NO_FRAME;
+      hole = slot;
+    }
+  }
+}
+
+/*
+ * Function:  awFmPageCacheClaimFrame
+ * --------------------
+ * Finds a frame to hold a new page with the CLOCK algorithm, evicting its
+ * current page if it has one. Must be called with the shard lock held.
+ *
+ *  Returns:
+ *    Index of the claimed frame, or AW_FM_PAGE_CACHE_NO_FRAME if every frame
+ *      in the shard is currently loading.
+ */
+static uint32_t
+awFmPageCacheClaimFrame(struct AwFmPageCacheShard *_RESTRICT_ const shard) {
+  // two sweeps are enough to clear every reference bit.
+  for (uint32_t i = 0; i < 2 * shard->frameCount; i++) {
+    const uint32_t frameIndex = shard->clockHand;
+    struct AwFmPageCacheFrame *frame = &shard->frames[frameIndex];
+    shard->clockHand = (shard->clockHand + 1) % shard->frameCount;
+
+    if (frame->loading) {
+      continue;
+    }
+    if (frame->pageIndex == AW_FM_PAGE_CACHE_NO_PAGE) {
+      return frameIndex;
+    }
+    if (frame->referenced) {
+      frame->referenced = false;
+      continue;
+    }
+    awFmPageCacheTableRemove(shard, frameIndex);
+    frame->pageIndex = AW_FM_PAGE_CACHE_NO_PAGE;
+    shard->evictions++;
+    return frameIndex;
+  }
+  return AW_FM_PAGE_CACHE_NO_FRAME;
+}
+
+// reads from the file, zero-filling anything past the end of the file.
+static bool awFmPageCacheReadFromFile(const int fileDescriptor,
+                                      uint8_t *_RESTRICT_ const destination,
+                                      const size_t fileOffset,
+                                      const size_t length) {
+  size_t totalBytesRead = 0;
+  while (totalBytesRead < length) {
+    const ssize_t bytesRead =
+        pread(fileDescriptor, destination + totalBytesRead,
+              length - totalBytesRead, fileOffset + totalBytesRead);
+    if (bytesRead < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytesRead < 0) {
+      return false;
+    }
+    if (bytesRead == 0) {
+      memset(destination + totalBytesRead, 0, length - totalBytesRead);
+      break;
+    }
+    totalBytesRead += bytesRead;
+  }
+  return true;
+}
+
+/*
+ * Function:  awFmPageCacheCopyFromPage
+ * --------------------
+ * Copies part of a single page to the destination, loading the page into the
+ * cache on a miss. The file read happens without the shard lock held, so
+ * threads reading other pages of the shard aren't blocked behind it.
+ */
+static bool
+awFmPageCacheCopyFromPage(struct AwFmPageCache *_RESTRICT_ const cache,
+                          const size_t pageIndex, const size_t offsetInPage,
+                          uint8_t *_RESTRICT_ const destination,
+                          const size_t length) {
+  const uint64_t hash = awFmPageCacheHash(pageIndex);
+  struct AwFmPageCacheShard *shard = awFmPageCacheGetShard(cache, hash);
+  const size_t pageSize = cache->pageSize;
+
+  pthread_mutex_lock(&shard->lock);
+  uint32_t frameIndex = awFmPageCacheFindFrame(shard, pageIndex, hash);
+  if (__builtin_expect(frameIndex != AW_FM_PAGE_CACHE_NO_FRAME, 1)) {
+    shard->hits++;
+    shard->frames[frameIndex].referenced = true;
+    memcpy(destination,
+           shard->pageData + (size_t)frameIndex * pageSize + offsetInPage,
+           length);
+    pthread_mutex_unlock(&shard->lock);
+    return true;
+  }
+
+  shard->misses++;
+  frameIndex = awFmPageCacheClaimFrame(shard);
+  if (frameIndex == AW_FM_PAGE_CACHE_NO_FRAME) {
+    // more threads are loading pages into this shard than it has frames, so
+    // bypass the cache for this read.
+    pthread_mutex_unlock(&shard->lock);
+    return awFmPageCacheReadFromFile(cache->fileDescriptor, destination,
+                                     pageIndex * pageSize + offsetInPage,
+                                     length);
+  }
+  shard->frames[frameIndex].loading = true;
+  pthread_mutex_unlock(&shard->lock);
+
+  uint8_t *frameData = shard->pageData + (size_t)frameIndex * pageSize;
+  const bool readSucceeded = awFmPageCacheReadFromFile(
+      cache->fileDescriptor, frameData, pageIndex * pageSize, pageSize);
+
+  pthread_mutex_lock(&shard->lock);
+  shard->frames[frameIndex].loading = false;
+  if (__builtin_expect(!readSucceeded, 0)) {
+    pthread_mutex_unlock(&shard->lock);
+    return false;
+  }
+
+  // another thread may have loaded the same page while this one was reading.
+  const uint32_t existingFrameIndex =
+      awFmPageCacheFindFrame(shard, pageIndex, hash);
+  if (existingFrameIndex == AW_FM_PAGE_CACHE_NO_FRAME) {
+    shard->frames[frameIndex].pageIndex = pageIndex;
+    shard->frames[frameIndex].referenced = true;
+    awFmPageCacheTableInsert(shard, frameIndex, hash);
+  }
+  memcpy(destination, frameData + offsetInPage, length);
+  pthread_mutex_unlock(&shard->lock);
+  return true;
+}
+
+struct AwFmPageCache *awFmPageCacheCreate(const int fileDescriptor,
+                                          const size_t pageSize,
+                                          const size_t capacityInBytes) {
+  const size_t totalFrameCount = capacityInBytes / pageSize;
+  if (totalFrameCount == 0) {
+    return NULL;
+  }
+
+  struct AwFmPageCache *cache = malloc(sizeof(struct AwFmPageCache));
+  if (cache == NULL) {
+    return NULL;
+  }
+  struct stat fileStat;
+  if (fstat(fileDescriptor, &fileStat) != 0) {
+    free(cache);
+    return NULL;
+  }
+  cache->fileDescriptor = fileDescriptor;
+  cache->fileLength = fileStat.st_size;
+  cache->pageSize = pageSize;
+  cache->readFailures = 0;
+  cache->shardCount = 1;
+  while (cache->shardCount * 2 <= AW_FM_PAGE_CACHE_MAX_SHARDS &&
+         cache->shardCount * 2 <= totalFrameCount) {
+    cache->shardCount *= 2;
+  }
+  cache->shards = calloc(cache->shardCount, sizeof(struct AwFmPageCacheShard));
+  if (cache->shards == NULL) {
+    free(cache);
+    return NULL;
+  }
+
+  const uint32_t framesPerShard = totalFrameCount / cache->shardCount;
+  uint32_t tableLength = 1;
+  while (tableLength < 2 * framesPerShard) {
+    tableLength *= 2;
+  }
+  const size_t pageDataAlignment =
+      pageSize < AW_FM_PAGE_CACHE_MAX_DATA_ALIGNMENT
+          ? pageSize
+          : AW_FM_PAGE_CACHE_MAX_DATA_ALIGNMENT;
+
+  bool allocationFailed = false;
+  for (uint32_t i = 0; i < cache->shardCount; i++) {
+    struct AwFmPageCacheShard *shard = &cache->shards[i];
+    pthread_mutex_init(&shard->lock, NULL);
+    shard->frameCount = framesPerShard;
+    shard->tableMask = tableLength - 1;
+    shard->frames = malloc(framesPerShard * sizeof(struct AwFmPageCacheFrame));
+    shard->table = malloc(tableLength * sizeof(uint32_t));
+    shard->pageData =
+        aligned_alloc(pageDataAlignment, (size_t)framesPerShard * pageSize);
+    if (shard->frames == NULL || shard->table == NULL ||
+        shard->pageData == NULL) {
+      allocationFailed = true;
+      continue;
+    }
+    for (uint32_t frame = 0; frame < framesPerShard; frame++) {
+      shard->frames[frame].pageIndex = AW_FM_PAGE_CACHE_NO_PAGE;
+      shard->frames[frame].referenced = false;
+      shard->frames[frame].loading = false;
+    }
+    memset(shard->table, 0xFF, tableLength * sizeof(uint32_t));
+  }
+
+  if (allocationFailed) {
+    awFmPageCacheDealloc(cache);
+    return NULL;
+  }
+  return cache;
+}
+
+void awFmPageCacheDealloc(struct AwFmPageCache *cache) {
+  if (cache == NULL) {
+    return;
+  }
+  for (uint32_t i = 0; i < cache->shardCount; i++) {
+    struct AwFmPageCacheShard *shard = &cache->shards[i];
+    pthread_mutex_destroy(&shard->lock);
+    free(shard->frames);
+    free(shard->table);
+    free(shard->pageData);
+  }
+  free(cache->shards);
+  free(cache);
+}
+
+enum AwFmReturnCode awFmPageCacheRead(struct AwFmPageCache *_RESTRICT_ const cache,
+                                      const size_t fileOffset,
+                                      void *_RESTRICT_ const destination,
+                                      const size_t length) {
+  size_t bytesCopied = 0;
+  while (bytesCopied < length) {
+    const size_t position = fileOffset + bytesCopied;
+    const size_t offsetInPage = position % cache->pageSize;
+    size_t copyLength = cache->pageSize - offsetInPage;
+    if (copyLength > length - bytesCopied) {
+      copyLength = length - bytesCopied;
+    }
+    if (!awFmPageCacheCopyFromPage(cache, position / cache->pageSize,
+                                   offsetInPage,
+                                   (uint8_t *)destination + bytesCopied,
+                                   copyLength)) {
+      __atomic_fetch_add(&cache->readFailures, 1, __ATOMIC_RELAXED);
+      return AwFmFileReadFail;
+    }
+    bytesCopied += copyLength;
+  }
+  return AwFmFileReadOkay;
+}
+
+bool awFmPageCacheReadIfCached(struct AwFmPageCache *_RESTRICT_ const cache,
+                               const size_t fileOffset,
+                               void *_RESTRICT_ const destination,
+                               const size_t length) {
+  size_t bytesCopied = 0;
+  while (bytesCopied < length) {
+    const size_t position = fileOffset + bytesCopied;
+    const size_t pageIndex = position / cache->pageSize;
+    const size_t offsetInPage = position % cache->pageSize;
+    size_t copyLength = cache->pageSize - offsetInPage;
+    if (copyLength > length - bytesCopied) {
+      copyLength = length - bytesCopied;
+    }
+
+    const uint64_t hash = awFmPageCacheHash(pageIndex);
+    struct AwFmPageCacheShard *shard = awFmPageCacheGetShard(cache, hash);
+    pthread_mutex_lock(&shard->lock);
+    const uint32_t frameIndex = awFmPageCacheFindFrame(shard, pageIndex, hash);
+    if (frameIndex == AW_FM_PAGE_CACHE_NO_FRAME) {
+      shard->misses++;
+      pthread_mutex_unlock(&shard->lock);
+      return false;
+    }
+    shard->hits++;
+    shard->frames[frameIndex].referenced = true;
+    memcpy((uint8_t *)destination + bytesCopied,
+           shard->pageData + (size_t)frameIndex * cache->pageSize +
+               offsetInPage,
+           copyLength);
+    pthread_mutex_unlock(&shard->lock);
+    bytesCopied += copyLength;
+  }
+  return true;
+}
+
+void awFmPageCacheInsert(struct AwFmPageCache *_RESTRICT_ const cache,
+                         const size_t pageFileOffset,
+                         const void *_RESTRICT_ const pageData) {
+  // a page running past the end of the file would have been a short read, so
+  // the caller's copy may not be zero-filled like the cache's own pages are.
+  if (pageFileOffset + cache->pageSize > cache->fileLength) {
+    return;
+  }
+  const size_t pageIndex = pageFileOffset / cache->pageSize;
+  const uint64_t hash = awFmPageCacheHash(pageIndex);
+  struct AwFmPageCacheShard *shard = awFmPageCacheGetShard(cache, hash);
+
+  pthread_mutex_lock(&shard->lock);
+  if (awFmPageCacheFindFrame(shard, pageIndex, hash) ==
+      AW_FM_PAGE_CACHE_NO_FRAME) {
+    const uint32_t frameIndex = awFmPageCacheClaimFrame(shard);
+    if (frameIndex != AW_FM_PAGE_CACHE_NO_FRAME) {
+      memcpy(shard->pageData + (size_t)frameIndex * cache->pageSize, pageData,
+             cache->pageSize);
+      shard->frames[frameIndex].pageIndex = pageIndex;
+      shard->frames[frameIndex].referenced = true;
+      awFmPageCacheTableInsert(shard, frameIndex, hash);
+    }
+  }
+  pthread_mutex_unlock(&shard->lock);
+}
+
+void awFmPageCachePrefetch(struct AwFmPageCache *_RESTRICT_ const cache,
+                           const size_t fileOffset) {
+  const size_t pageIndex = fileOffset / cache->pageSize;
+  const uint64_t hash = awFmPageCacheHash(pageIndex);
+  struct AwFmPageCacheShard *shard = awFmPageCacheGetShard(cache, hash);
+
+  pthread_mutex_lock(&shard->lock);
+  const bool pageIsCached = awFmPageCacheFindFrame(shard, pageIndex, hash) !=
+                            AW_FM_PAGE_CACHE_NO_FRAME;
+  pthread_mutex_unlock(&shard->lock);
+
+  if (!pageIsCached) {
+    posix_fadvise(cache->fileDescriptor, pageIndex * cache->pageSize,
+                  cache->pageSize, POSIX_FADV_WILLNEED);
+  }
+}
+
+size_t awFmPageCacheGetPageSize(const struct AwFmPageCache *_RESTRICT_ const cache) {
+  return cache->pageSize;
+}
+
+uint64_t awFmPageCacheGetReadFailures(
+    const struct AwFmPageCache *_RESTRICT_ const cache) {
+  return __atomic_load_n(&cache->readFailures, __ATOMIC_RELAXED);
+}
+
+void awFmPageCacheGetStatistics(
+    struct AwFmPageCache *_RESTRICT_ const cache,
+    struct AwFmCacheStatistics *_RESTRICT_ const statistics) {
+  memset(statistics, 0, sizeof(struct AwFmCacheStatistics));
+  statistics->pageSize = cache->pageSize;
+  statistics->readFailures = awFmPageCacheGetReadFailures(cache);
+  for (uint32_t i = 0; i < cache->shardCount; i++) {
+    struct AwFmPageCacheShard *shard = &cache->shards[i];
+    pthread_mutex_lock(&shard->lock);
+    statistics->hits += shard->hits;
+    statistics->misses += shard->misses;
+    statistics->evictions += shard->evictions;
+    statistics->capacityInBytes += (size_t)shard->frameCount * cache->pageSize;
+    pthread_mutex_unlock(&shard->lock);
+  }
+}
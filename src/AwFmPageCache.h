@@ -0,0 +1,126 @@
+#ifndef AW_FM_PAGE_CACHE_H
+#define AW_FM_PAGE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "AwFmIndex.h"
+
+// opaque, defined in AwFmPageCache.c.
+struct AwFmPageCache;
+
+/*
+ * Function:  awFmPageCacheCreate
+ * --------------------
+ * Creates a bounded cache of fixed-size pages of a file, shared between every
+ * thread that reads through it. Pages are keyed by their absolute offset in
+ * the file (pageSize-aligned), and the cache is split into independently
+ * locked shards so threads reading different pages rarely contend. Each shard
+ * evicts pages with the CLOCK algorithm.
+ *
+ *  Inputs:
+ *    fileDescriptor:   File to cache. Must stay open for the cache's life.
+ *    pageSize:         Size of each cached page, in bytes. Must be a power of 2.
+ *    capacityInBytes:  Maximum memory used for page data. This is rounded down
+ *      to a whole number of pages, with at least one page per shard.
+ *
+ *  Returns:
+ *    Pointer to the new cache, or NULL if capacityInBytes is smaller than one
+ *      page, the file couldn't be stat'ed, or memory could not be allocated.
+ */
+struct AwFmPageCache *awFmPageCacheCreate(const int fileDescriptor,
+                                          const size_t pageSize,
+                                          const size_t capacityInBytes);
+
+/*
+ * Function:  awFmPageCacheDealloc
+ * --------------------
+ * Frees the cache and every page it holds. May be given NULL.
+ */
+void awFmPageCacheDealloc(struct AwFmPageCache *cache);
+
+/*
+ * Function:  awFmPageCacheRead
+ * --------------------
+ * Copies length bytes starting at fileOffset into the destination buffer.
+ * Pages not already in the cache are read from the file and inserted. Bytes
+ * past the end of the file read as zero.
+ *
+ *  Returns:
+ *    AwFmFileReadOkay on success, or AwFmFileReadFail if the file could not
+ *      be read.
+ */
+enum AwFmReturnCode awFmPageCacheRead(struct AwFmPageCache *_RESTRICT_ const cache,
+                                      const size_t fileOffset,
+                                      void *_RESTRICT_ const destination,
+                                      const size_t length);
+
+/*
+ * Function:  awFmPageCacheReadIfCached
+ * --------------------
+ * Like awFmPageCacheRead, but never touches the file. If any page in the
+ * range isn't cached, returns false and the destination's contents are
+ * undefined. Used by callers that fetch missing pages themselves, e.g., with
+ * asynchronous reads, and later hand them to awFmPageCacheInsert.
+ *
+ *  Returns:
+ *    True if the whole range was copied from the cache.
+ */
+bool awFmPageCacheReadIfCached(struct AwFmPageCache *_RESTRICT_ const cache,
+                               const size_t fileOffset,
+                               void *_RESTRICT_ const destination,
+                               const size_t length);
+
+/*
+ * Function:  awFmPageCacheInsert
+ * --------------------
+ * Inserts a full page that the caller read from the file. Does nothing if the
+ * page is already cached, or if it runs past the end of the file.
+ *
+ *  Inputs:
+ *    pageFileOffset: Offset of the page in the file. Must be a multiple of the
+ *      cache's page size.
+ *    pageData:       pageSize bytes of the file starting at pageFileOffset.
+ */
+void awFmPageCacheInsert(struct AwFmPageCache *_RESTRICT_ const cache,
+                         const size_t pageFileOffset,
+                         const void *_RESTRICT_ const pageData);
+
+/*
+ * Function:  awFmPageCachePrefetch
+ * --------------------
+ * Hints that the page containing fileOffset will be read soon. If the page
+ * isn't cached, the operating system is asked to start reading it in the
+ * background, so the miss that follows doesn't wait on the device. Doesn't
+ * count as a hit or a miss.
+ */
+void awFmPageCachePrefetch(struct AwFmPageCache *_RESTRICT_ const cache,
+                           const size_t fileOffset);
+
+/*
+ * Function:  awFmPageCacheGetPageSize
+ * --------------------
+ * Returns the size of each page held by the cache.
+ */
+size_t awFmPageCacheGetPageSize(const struct AwFmPageCache *_RESTRICT_ const cache);
+
+/*
+ * Function:  awFmPageCacheGetReadFailures
+ * --------------------
+ * Returns the number of calls to awFmPageCacheRead that failed to read the
+ * file since the cache was created.
+ */
+uint64_t awFmPageCacheGetReadFailures(
+    const struct AwFmPageCache *_RESTRICT_ const cache);
+
+/*
+ * Function:  awFmPageCacheGetStatistics
+ * --------------------
+ * Fills the given struct with the cache's capacity and its hit, miss,
+ * eviction, and read failure counts since it was created.
+ */
+void awFmPageCacheGetStatistics(
+    struct AwFmPageCache *_RESTRICT_ const cache,
+    struct AwFmCacheStatistics *_RESTRICT_ const statistics);
+
+#endif /* end of include guard: AW_FM_PAGE_CACHE_H */
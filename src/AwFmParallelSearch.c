@@ -2,12 +2,15 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include "AwFmDiskBwt.h"
 #include "AwFmIndex.h"
 #include "AwFmIndexStruct.h"
 #include "AwFmKmerTable.h"
 #include "AwFmLetter.h"
+#include "AwFmNuma.h"
 #include "AwFmSearch.h"
 #include "AwFmSuffixArray.h"
+#include "AwFmSuffixArrayBatch.h"
 
 #define NUM_CONCURRENT_QUERIES 32
 #define DEFAULT_POSITION_LIST_CAPACITY 4
@@ -30,9 +33,85 @@ enum AwFmReturnCode parallelSearchTracebackPositionLists(
     struct AwFmSearchRange *_RESTRICT_ const ranges,
     const size_t threadBlockStartIndex, const size_t threadBlockEndIndex);
 
+enum AwFmReturnCode parallelSearchQueueSuffixArrayReadsForBlock(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmKmerSearchList *_RESTRICT_ const searchList,
+    struct AwFmSearchRange *_RESTRICT_ const ranges,
+    const size_t threadBlockStartIndex, const size_t threadBlockEndIndex,
+    struct AwFmSuffixArrayBatch *_RESTRICT_ const batch);
+
 bool setPositionListCount(
     struct AwFmKmerSearchData *_RESTRICT_ const searchData, uint32_t count);
 
+/*Per-thread state for locating hits when the suffix array is on disk. While
+ * one batch of suffix array reads is in flight, the thread backtraces the next
+ * thread block's hits into the other batch.*/
+struct AwFmLocatePipeline {
+  struct AwFmAsyncFileReader *reader;
+  struct AwFmSuffixArrayBatch batches[2];
+  uint8_t fillingBatchIndex;
+};
+
+static bool
+locatePipelineInit(const struct AwFmIndex *_RESTRICT_ const index,
+                   struct AwFmLocatePipeline *_RESTRICT_ const pipeline) {
+  if (index->config.keepSuffixArrayInMemory) {
+    return false;
+  }
+  // if the reader can't be made, fall back to reading values one at a time.
+  pipeline->reader = awFmAsyncFileReaderPoolAcquire(
+      index->suffixArrayReaderPool, index->fileDescriptor);
+  if (pipeline->reader == NULL) {
+    return false;
+  }
+  awFmSuffixArrayBatchInit(&pipeline->batches[0]);
+  awFmSuffixArrayBatchInit(&pipeline->batches[1]);
+  pipeline->fillingBatchIndex = 0;
+  return true;
+}
+
+static enum AwFmReturnCode locatePipelineProcessBlock(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmLocatePipeline *_RESTRICT_ const pipeline,
+    struct AwFmKmerSearchList *_RESTRICT_ const searchList,
+    struct AwFmSearchRange *_RESTRICT_ const ranges,
+    const size_t threadBlockStartIndex, const size_t threadBlockEndIndex) {
+  struct AwFmSuffixArrayBatch *fillingBatch =
+      &pipeline->batches[pipeline->fillingBatchIndex];
+  struct AwFmSuffixArrayBatch *inFlightBatch =
+      &pipeline->batches[!pipeline->fillingBatchIndex];
+
+  // these backtraces overlap with the previous block's reads.
+  enum AwFmReturnCode queueReturnCode =
+      parallelSearchQueueSuffixArrayReadsForBlock(
+          index, searchList, ranges, threadBlockStartIndex,
+          threadBlockEndIndex, fillingBatch);
+  enum AwFmReturnCode finishReturnCode =
+      awFmSuffixArrayBatchFinish(index, inFlightBatch, pipeline->reader);
+  if (__builtin_expect(awFmReturnCodeIsFailure(queueReturnCode), 0)) {
+    return queueReturnCode;
+  }
+
+  enum AwFmReturnCode submitReturnCode =
+      awFmSuffixArrayBatchSubmit(index, fillingBatch, pipeline->reader);
+  pipeline->fillingBatchIndex = !pipeline->fillingBatchIndex;
+  return awFmReturnCodeIsFailure(submitReturnCode) ? submitReturnCode
+                                                   : finishReturnCode;
+}
+
+static enum AwFmReturnCode
+locatePipelineFinish(const struct AwFmIndex *_RESTRICT_ const index,
+                     struct AwFmLocatePipeline *_RESTRICT_ const pipeline) {
+  enum AwFmReturnCode returnCode = awFmSuffixArrayBatchFinish(
+      index, &pipeline->batches[!pipeline->fillingBatchIndex],
+      pipeline->reader);
+  awFmAsyncFileReaderPoolRelease(index->suffixArrayReaderPool,
+                                 pipeline->reader);
+  awFmSuffixArrayBatchDealloc(&pipeline->batches[0]);
+  awFmSuffixArrayBatchDealloc(&pipeline->batches[1]);
+  return returnCode;
+}
+
 struct AwFmKmerSearchList *awFmCreateKmerSearchList(const size_t capacity) {
   // struct AwFmKmerSearchList *searchList =
   // aligned_alloc(AW_FM_CACHE_LINE_SIZE_IN_BYTES,
@@ -99,36 +178,63 @@ awFmParallelSearchLocate(const struct AwFmIndex *_RESTRICT_ const index,
 
   const uint32_t searchListCount = searchList->count;
   enum AwFmReturnCode atomicReturnCode = AwFmSuccess;
+  const uint64_t bwtReadFailures = awFmDiskBwtReadFailures(index);
   if (numThreads > 1) {
-#pragma omp parallel for num_threads(numThreads)
-    for (size_t threadBlockStartIndex = 0;
-         threadBlockStartIndex < searchListCount;
-         threadBlockStartIndex += AW_FM_NUM_CONCURRENT_QUERIES) {
-
-      const size_t threadBlockEndIndex =
-          threadBlockStartIndex + AW_FM_NUM_CONCURRENT_QUERIES >
-                  searchList->count
-              ? searchList->count
-              : threadBlockStartIndex + AW_FM_NUM_CONCURRENT_QUERIES;
-
-      struct AwFmSearchRange ranges[AW_FM_NUM_CONCURRENT_QUERIES];
+#pragma omp parallel num_threads(numThreads)
+    {
+      // if the index is replicated across NUMA nodes, each thread is pinned
+      // to a node and searches that node's copy of the bwt and seed table.
+      struct AwFmIndex localIndex;
+      struct AwFmNumaThreadBinding numaBinding;
+      const struct AwFmIndex *threadIndex =
+          awFmNumaBindThread(index, &localIndex, &numaBinding);
+      struct AwFmLocatePipeline pipeline;
+      const bool usePipeline = locatePipelineInit(threadIndex, &pipeline);
+
+#pragma omp for
+      for (size_t threadBlockStartIndex = 0;
+           threadBlockStartIndex < searchListCount;
+           threadBlockStartIndex += AW_FM_NUM_CONCURRENT_QUERIES) {
+
+        const size_t threadBlockEndIndex =
+            threadBlockStartIndex + AW_FM_NUM_CONCURRENT_QUERIES >
+                    searchList->count
+                ? searchList->count
+                : threadBlockStartIndex + AW_FM_NUM_CONCURRENT_QUERIES;
+
+        struct AwFmSearchRange ranges[AW_FM_NUM_CONCURRENT_QUERIES];
+
+        parallelSearchFindKmerSeedsForBlock(threadIndex, searchList, ranges,
+                                            threadBlockStartIndex,
+                                            threadBlockEndIndex);
+        parallelSearchExtendKmersInBlock(threadIndex, searchList, ranges,
+                                         threadBlockStartIndex,
+                                         threadBlockEndIndex);
+        enum AwFmReturnCode rc =
+            usePipeline
+                ? locatePipelineProcessBlock(threadIndex, &pipeline, searchList,
+                                             ranges, threadBlockStartIndex,
+                                             threadBlockEndIndex)
+                : parallelSearchTracebackPositionLists(
+                      threadIndex, searchList, ranges, threadBlockStartIndex,
+                      threadBlockEndIndex);
+        if (__builtin_expect(awFmReturnCodeIsFailure(rc), 0)) {
+#pragma omp atomic write
+          atomicReturnCode = AwFmFileReadFail;
+        }
+      }
 
-      parallelSearchFindKmerSeedsForBlock(index, searchList, ranges,
-                                          threadBlockStartIndex,
-                                          threadBlockEndIndex);
-      parallelSearchExtendKmersInBlock(index, searchList, ranges,
-                                       threadBlockStartIndex,
-                                       threadBlockEndIndex);
-      enum AwFmReturnCode rc = parallelSearchTracebackPositionLists(
-          index, searchList, ranges, threadBlockStartIndex,
-          threadBlockEndIndex);
-      if (__builtin_expect(awFmReturnCodeIsFailure(rc), 0)) {
+      if (usePipeline && awFmReturnCodeIsFailure(
+                             locatePipelineFinish(threadIndex, &pipeline))) {
 #pragma omp atomic write
         atomicReturnCode = AwFmFileReadFail;
       }
+      awFmNumaUnbindThread(&numaBinding);
     }
-    return atomicReturnCode;
+    return awFmDiskBwtCheckReads(index, bwtReadFailures, atomicReturnCode);
   } else {
+    struct AwFmLocatePipeline pipeline;
+    const bool usePipeline = locatePipelineInit(index, &pipeline);
     for (size_t threadBlockStartIndex = 0;
          threadBlockStartIndex < searchListCount;
          threadBlockStartIndex += AW_FM_NUM_CONCURRENT_QUERIES) {
@@ -145,14 +251,28 @@ awFmParallelSearchLocate(const struct AwFmIndex *_RESTRICT_ const index,
       parallelSearchExtendKmersInBlock(index, searchList, ranges,
                                        threadBlockStartIndex,
                                        threadBlockEndIndex);
-      enum AwFmReturnCode rc = parallelSearchTracebackPositionLists(
-          index, searchList, ranges, threadBlockStartIndex,
-          threadBlockEndIndex);
+      enum AwFmReturnCode rc =
+          usePipeline
+              ? locatePipelineProcessBlock(index, &pipeline, searchList, ranges,
+                                           threadBlockStartIndex,
+                                           threadBlockEndIndex)
+              : parallelSearchTracebackPositionLists(
+                    index, searchList, ranges, threadBlockStartIndex,
+                    threadBlockEndIndex);
+      if (__builtin_expect(awFmReturnCodeIsFailure(rc), 0)) {
+        if (usePipeline) {
+          locatePipelineFinish(index, &pipeline);
+        }
+        return rc;
+      }
+    }
+    if (usePipeline) {
+      enum AwFmReturnCode rc = locatePipelineFinish(index, &pipeline);
       if (__builtin_expect(awFmReturnCodeIsFailure(rc), 0)) {
         return rc;
       }
     }
-    return AwFmSuccess;
+    return awFmDiskBwtCheckReads(index, bwtReadFailures, AwFmSuccess);
   }
 }
 
@@ -164,30 +284,40 @@ void awFmParallelSearchCount(
   const uint32_t searchListCount = searchList->count;
 
   if (numThreads > 1) {
-#pragma omp parallel for num_threads(numThreads)
-    for (size_t threadBlockStartIndex = 0;
-         threadBlockStartIndex < searchListCount;
-         threadBlockStartIndex += AW_FM_NUM_CONCURRENT_QUERIES) {
-
-      const size_t threadBlockEndIndex =
-          threadBlockStartIndex + AW_FM_NUM_CONCURRENT_QUERIES >
-                  searchList->count
-              ? searchList->count
-              : threadBlockStartIndex + AW_FM_NUM_CONCURRENT_QUERIES;
-      struct AwFmSearchRange ranges[AW_FM_NUM_CONCURRENT_QUERIES];
-
-      parallelSearchFindKmerSeedsForBlock(index, searchList, ranges,
-                                          threadBlockStartIndex,
-                                          threadBlockEndIndex);
-      parallelSearchExtendKmersInBlock(index, searchList, ranges,
-                                       threadBlockStartIndex,
-                                       threadBlockEndIndex);
-
-      // load the range lengths into the count member variables.
-      for (size_t i = threadBlockStartIndex; i < threadBlockEndIndex; i++) {
-        searchList->kmerSearchData[i].count =
-            awFmSearchRangeLength(&ranges[i - threadBlockStartIndex]);
+#pragma omp parallel num_threads(numThreads)
+    {
+      struct AwFmIndex localIndex;
+      struct AwFmNumaThreadBinding numaBinding;
+      const struct AwFmIndex *threadIndex =
+          awFmNumaBindThread(index, &localIndex, &numaBinding);
+
+#pragma omp for
+      for (size_t threadBlockStartIndex = 0;
+           threadBlockStartIndex < searchListCount;
+           threadBlockStartIndex += AW_FM_NUM_CONCURRENT_QUERIES) {
+
+        const size_t threadBlockEndIndex =
+            threadBlockStartIndex + AW_FM_NUM_CONCURRENT_QUERIES >
+                    searchList->count
+                ? searchList->count
+                : threadBlockStartIndex + AW_FM_NUM_CONCURRENT_QUERIES;
+        struct AwFmSearchRange ranges[AW_FM_NUM_CONCURRENT_QUERIES];
+
+        parallelSearchFindKmerSeedsForBlock(threadIndex, searchList, ranges,
+                                            threadBlockStartIndex,
+                                            threadBlockEndIndex);
+        parallelSearchExtendKmersInBlock(threadIndex, searchList, ranges,
+                                         threadBlockStartIndex,
+                                         threadBlockEndIndex);
+
+        // load the range lengths into the count member variables.
+        for (size_t i = threadBlockStartIndex; i < threadBlockEndIndex; i++) {
+          searchList->kmerSearchData[i].count =
+              awFmSearchRangeLength(&ranges[i - threadBlockStartIndex]);
+        }
       }
+
+      awFmNumaUnbindThread(&numaBinding);
     }
   } else {
     // exact duplicate of above code, without the omp pragma, so it doesn't kill
@@ -247,7 +377,16 @@ void parallelSearchFindKmerSeedsForBlock(
             ? kmerLength
             : index->config.kmerLengthInSeedTable;
 
-    if (index->config.alphabetType != AwFmAlphabetAmino) {
+    if (index->config.alphabetType == AwFmAlphabetReducedAmino) {
+      if (queryCanUseKmerTable) {
+        ranges[rangesIndex] = awFmReducedAminoKmerSeedRangeFromTable(
+            index, kmerString, kmerLength);
+      } else {
+        awFmReducedAminoNonSeededSearch(
+            index, kmerString + kmerStringNonSeededStart,
+            kmerStringNonSeededLength, &ranges[rangesIndex]);
+      }
+    } else if (index->config.alphabetType != AwFmAlphabetAmino) {
       // TODO: reimplement partial seeded search when it's implementable
       if (queryCanUseKmerTable) {
         ranges[rangesIndex] =
@@ -296,7 +435,13 @@ void parallelSearchExtendKmersInBlock(
         const uint64_t currentQueryLetterIndex =
             kmerLength - currentKmerLetterIndex;
 
-        if (index->config.alphabetType != AwFmAlphabetAmino) {
+        if (index->config.alphabetType == AwFmAlphabetReducedAmino) {
+          const uint8_t queryLetterIndex = awFmAsciiReducedAminoToLetterIndex(
+              index->reducedAminoLetterMap,
+              kmerString[currentQueryLetterIndex]);
+          awFmReducedAminoIterativeStepBackwardSearch(
+              index, &ranges[rangesIndex], queryLetterIndex);
+        } else if (index->config.alphabetType != AwFmAlphabetAmino) {
           const uint8_t queryLetterIndex = awFmAsciiNucleotideToLetterIndex(
               kmerString[currentQueryLetterIndex]);
           awFmNucleotideIterativeStepBackwardSearch(index, &ranges[rangesIndex],
@@ -339,7 +484,13 @@ enum AwFmReturnCode parallelSearchTracebackPositionLists(
           .position = ranges[rangesIndex].startPtr + indexOfPositionToBacktrace,
           .offset = 0};
 
-      if (index->config.alphabetType != AwFmAlphabetAmino) {
+      if (index->config.alphabetType == AwFmAlphabetReducedAmino) {
+        while (!awFmBwtPositionIsSampled(index, backtrace.position)) {
+          backtrace.position =
+              awFmReducedAminoBacktraceBwtPosition(index, backtrace.position);
+          backtrace.offset++;
+        }
+      } else if (index->config.alphabetType != AwFmAlphabetAmino) {
         while (!awFmBwtPositionIsSampled(index, backtrace.position)) {
           backtrace.position =
               awFmNucleotideBacktraceBwtPosition(index, backtrace.position);
@@ -364,6 +515,62 @@ enum AwFmReturnCode parallelSearchTracebackPositionLists(
   return AwFmSuccess;
 }
 
+enum AwFmReturnCode parallelSearchQueueSuffixArrayReadsForBlock(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmKmerSearchList *_RESTRICT_ const searchList,
+    struct AwFmSearchRange *_RESTRICT_ const ranges,
+    const size_t threadBlockStartIndex, const size_t threadBlockEndIndex,
+    struct AwFmSuffixArrayBatch *_RESTRICT_ const batch) {
+
+  for (size_t kmerIndex = threadBlockStartIndex;
+       kmerIndex < threadBlockEndIndex; kmerIndex++) {
+    const uint64_t rangesIndex = kmerIndex - threadBlockStartIndex;
+
+    struct AwFmKmerSearchData *searchData =
+        &searchList->kmerSearchData[kmerIndex];
+    const size_t rangeLength = awFmSearchRangeLength(&ranges[rangesIndex]);
+    if (__builtin_expect(!setPositionListCount(searchData, rangeLength), 0)) {
+      return AwFmAllocationFailure;
+    }
+
+    for (size_t indexOfPositionToBacktrace = 0;
+         indexOfPositionToBacktrace < rangeLength;
+         indexOfPositionToBacktrace++) {
+      struct AwFmBacktrace backtrace = {
+          .position = ranges[rangesIndex].startPtr + indexOfPositionToBacktrace,
+          .offset = 0};
+
+      if (index->config.alphabetType == AwFmAlphabetReducedAmino) {
+        while (!awFmBwtPositionIsSampled(index, backtrace.position)) {
+          backtrace.position =
+              awFmReducedAminoBacktraceBwtPosition(index, backtrace.position);
+          backtrace.offset++;
+        }
+      } else if (index->config.alphabetType != AwFmAlphabetAmino) {
+        while (!awFmBwtPositionIsSampled(index, backtrace.position)) {
+          backtrace.position =
+              awFmNucleotideBacktraceBwtPosition(index, backtrace.position);
+          backtrace.offset++;
+        }
+      } else {
+        while (!awFmBwtPositionIsSampled(index, backtrace.position)) {
+          backtrace.position =
+              awFmAminoBacktraceBwtPosition(index, backtrace.position);
+          backtrace.offset++;
+        }
+      }
+
+      enum AwFmReturnCode rc = awFmSuffixArrayBatchAdd(
+          index, batch, &backtrace,
+          &searchData->positionList[indexOfPositionToBacktrace]);
+      if (__builtin_expect(rc != AwFmSuccess, 0)) {
+        return rc;
+      }
+    }
+  }
+  return AwFmSuccess;
+}
+
 bool setPositionListCount(
     struct AwFmKmerSearchData *_RESTRICT_ const searchData, uint32_t newCount) {
   if (__builtin_expect(searchData->capacity >= newCount, 1)) {
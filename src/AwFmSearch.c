@@ -1,21 +1,82 @@
+#include <string.h>
 #include "AwFmSearch.h"
+#include "AwFmDiskBwt.h"
 #include "AwFmLetter.h"
 #include "AwFmOccurrence.h"
 #include "AwFmSuffixArray.h"
 
+// blocks are fetched through these so the same search code serves indices
+// whose BWT was left on disk. The in-memory case is predicted, so it costs the
+// usual path a single well-predicted branch.
+static inline const struct AwFmNucleotideBlock *awFmGetNucleotideBlock(
+    const struct AwFmIndex *_RESTRICT_ const index, const uint64_t blockIndex,
+    struct AwFmNucleotideBlock *_RESTRICT_ const scratchBlock) {
+  if (__builtin_expect(index->bwtCache == NULL, 1)) {
+    return &index->bwtBlockList.asNucleotide[blockIndex];
+  }
+  awFmDiskBwtReadBlock(index, blockIndex, scratchBlock);
+  return scratchBlock;
+}
+
+static inline const struct AwFmAminoBlock *
+awFmGetAminoBlock(const struct AwFmIndex *_RESTRICT_ const index,
+                  const uint64_t blockIndex,
+                  struct AwFmAminoBlock *_RESTRICT_ const scratchBlock) {
+  if (__builtin_expect(index->bwtCache == NULL, 1)) {
+    return &index->bwtBlockList.asAmino[blockIndex];
+  }
+  awFmDiskBwtReadBlock(index, blockIndex, scratchBlock);
+  return scratchBlock;
+}
+
+static inline const struct AwFmReducedAminoBlock *awFmGetReducedAminoBlock(
+    const struct AwFmIndex *_RESTRICT_ const index, const uint64_t blockIndex,
+    struct AwFmReducedAminoBlock *_RESTRICT_ const scratchBlock) {
+  if (__builtin_expect(index->bwtCache == NULL, 1)) {
+    return &index->bwtBlockList.asReducedAmino[blockIndex];
+  }
+  awFmDiskBwtReadBlock(index, blockIndex, scratchBlock);
+  return scratchBlock;
+}
+
+// prefetches the first cache lines of the block into the CPU cache, or for
+// a BWT on disk, starts reading the block's chunk in the background.
+static inline void
+awFmPrefetchBwtBlock(const struct AwFmIndex *_RESTRICT_ const index,
+                     const uint64_t blockIndex, const size_t blockByteWidth,
+                     const uint8_t numCacheLines) {
+  if (__builtin_expect(index->bwtCache == NULL, 1)) {
+    const uint8_t *blockPtr = ((uint8_t *)index->bwtBlockList.asNucleotide) +
+                              (blockIndex * blockByteWidth);
+    for (uint8_t cacheLine = 0; cacheLine < numCacheLines; cacheLine++) {
+      AwFmSimdPrefetch(blockPtr + (cacheLine * AW_FM_CACHE_LINE_SIZE_IN_BYTES));
+    }
+  } else {
+    awFmDiskBwtPrefetch(index, blockIndex);
+  }
+}
+
+// awFmBlockPrefetch, with the same disk-backed fallback.
+static inline void
+awFmPrefetchBwtPosition(const struct AwFmIndex *_RESTRICT_ const index,
+                        const uint64_t blockByteWidth,
+                        const uint64_t bwtPosition) {
+  if (__builtin_expect(index->bwtCache == NULL, 1)) {
+    awFmBlockPrefetch(index->bwtBlockList.asNucleotide, blockByteWidth,
+                      bwtPosition);
+  } else {
+    awFmDiskBwtPrefetch(index,
+                        awFmGetBlockIndexFromGlobalPosition(bwtPosition));
+  }
+}
+
 struct AwFmSearchRange
 awFmCreateInitialQueryRange(const struct AwFmIndex *_RESTRICT_ const index,
                             const char *_RESTRICT_ const query,
                             const uint64_t queryLength) {
 
-  uint8_t finalLetterIndexInQuery;
-  if (index->config.alphabetType != AwFmAlphabetAmino) {
-    finalLetterIndexInQuery =
-        awFmAsciiNucleotideToLetterIndex(query[queryLength - 1]);
-  } else {
-    finalLetterIndexInQuery =
-        awFmAsciiAminoAcidToLetterIndex(query[queryLength - 1]);
-  }
+  const uint8_t finalLetterIndexInQuery =
+      awFmAsciiToLetterIndex(index, query[queryLength - 1]);
 
   struct AwFmSearchRange searchRange;
   searchRange.startPtr = index->prefixSums[finalLetterIndexInQuery],
@@ -26,12 +87,7 @@ awFmCreateInitialQueryRange(const struct AwFmIndex *_RESTRICT_ const index,
 
 struct AwFmSearchRange awFmCreateInitialQueryRangeFromChar(
     const struct AwFmIndex *_RESTRICT_ const index, const char letter) {
-  uint8_t letterIndex;
-  if (index->config.alphabetType != AwFmAlphabetAmino) {
-    letterIndex = awFmAsciiNucleotideToLetterIndex(letter);
-  } else {
-    letterIndex = awFmAsciiAminoAcidToLetterIndex(letter);
-  }
+  const uint8_t letterIndex = awFmAsciiToLetterIndex(index, letter);
   struct AwFmSearchRange searchRange;
   searchRange.startPtr = index->prefixSums[letterIndex],
   searchRange.endPtr = index->prefixSums[letterIndex + 1] - 1;
@@ -54,10 +110,12 @@ void awFmNucleotideIterativeStepBackwardSearch(
   // before needing the bit vectors, we can figure out if they sentinel
   // character will be added.
   uint64_t newStartPointer = letterPrefixSum;
-  uint64_t baseOccurrence =
-      index->bwtBlockList.asNucleotide[blockIndex].baseOccurrences[letterIndex];
-  AwFmSimdVec256 occurrenceVector = awFmMakeNucleotideOccurrenceVector(
-      &(index->bwtBlockList.asNucleotide[blockIndex]), letterIndex);
+  struct AwFmNucleotideBlock scratchBlock;
+  const struct AwFmNucleotideBlock *blockPtr =
+      awFmGetNucleotideBlock(index, blockIndex, &scratchBlock);
+  uint64_t baseOccurrence = blockPtr->baseOccurrences[letterIndex];
+  AwFmSimdVec256 occurrenceVector =
+      awFmMakeNucleotideOccurrenceVector(blockPtr, letterIndex);
 
   uint_fast16_t vectorPopcount =
       AwFmMaskedVectorPopcount(occurrenceVector, localQueryPosition);
@@ -67,11 +125,8 @@ void awFmNucleotideIterativeStepBackwardSearch(
 
   // prefetch the next start ptr
   uint64_t newStartBlock = (newStartPointer - 1) / AW_FM_POSITIONS_PER_FM_BLOCK;
-  uint8_t *newStartBlockPtr =
-      ((uint8_t *)index->bwtBlockList.asNucleotide) +
-      (newStartBlock * sizeof(struct AwFmNucleotideBlock));
-  AwFmSimdPrefetch(newStartBlockPtr);
-  AwFmSimdPrefetch(newStartBlockPtr + 64);
+  awFmPrefetchBwtBlock(index, newStartBlock, sizeof(struct AwFmNucleotideBlock),
+                       2);
 
   // query for the new end pointer
   queryPosition = range->endPtr;
@@ -83,10 +138,9 @@ void awFmNucleotideIterativeStepBackwardSearch(
   // we can subtract it here to kill time before needing the block from memory
   uint64_t newEndPointer = letterPrefixSum - 1;
 
-  baseOccurrence =
-      index->bwtBlockList.asNucleotide[blockIndex].baseOccurrences[letterIndex];
-  occurrenceVector = awFmMakeNucleotideOccurrenceVector(
-      &(index->bwtBlockList.asNucleotide[blockIndex]), letterIndex);
+  blockPtr = awFmGetNucleotideBlock(index, blockIndex, &scratchBlock);
+  baseOccurrence = blockPtr->baseOccurrences[letterIndex];
+  occurrenceVector = awFmMakeNucleotideOccurrenceVector(blockPtr, letterIndex);
   vectorPopcount =
       AwFmMaskedVectorPopcount(occurrenceVector, localQueryPosition);
 
@@ -94,10 +148,8 @@ void awFmNucleotideIterativeStepBackwardSearch(
 
   // prefetch the next start ptr
   uint64_t newEndBlock = (newEndPointer) / AW_FM_POSITIONS_PER_FM_BLOCK;
-  uint8_t *newEndBlockPtr = ((uint8_t *)index->bwtBlockList.asNucleotide) +
-                            (newEndBlock * sizeof(struct AwFmNucleotideBlock));
-  AwFmSimdPrefetch(newEndBlockPtr);
-  AwFmSimdPrefetch(newEndBlockPtr + 64);
+  awFmPrefetchBwtBlock(index, newEndBlock, sizeof(struct AwFmNucleotideBlock),
+                       2);
 
   range->endPtr = newEndPointer;
 }
@@ -113,21 +165,19 @@ void awFmAminoIterativeStepBackwardSearch(
   uint64_t blockIndex = awFmGetBlockIndexFromGlobalPosition(queryPosition);
   uint8_t localQueryPosition =
       awFmGetBlockQueryPositionFromGlobalPosition(queryPosition);
-  uint64_t baseOccurrence =
-      index->bwtBlockList.asAmino[blockIndex].baseOccurrences[letterIndex];
-  AwFmSimdVec256 occurrenceVector = awFmMakeAminoAcidOccurrenceVector(
-      &(index->bwtBlockList.asAmino[blockIndex]), letterIndex);
+  struct AwFmAminoBlock scratchBlock;
+  const struct AwFmAminoBlock *blockPtr =
+      awFmGetAminoBlock(index, blockIndex, &scratchBlock);
+  uint64_t baseOccurrence = blockPtr->baseOccurrences[letterIndex];
+  AwFmSimdVec256 occurrenceVector =
+      awFmMakeAminoAcidOccurrenceVector(blockPtr, letterIndex);
   uint16_t vectorPopcount =
       AwFmMaskedVectorPopcount(occurrenceVector, localQueryPosition);
   uint64_t newStartPointer = letterPrefixSum + vectorPopcount + baseOccurrence;
 
   // prefetch the next start ptr
   uint64_t newStartBlock = (newStartPointer - 1) / AW_FM_POSITIONS_PER_FM_BLOCK;
-  uint8_t *newStartBlockPtr = ((uint8_t *)index->bwtBlockList.asAmino) +
-                              (newStartBlock * sizeof(struct AwFmAminoBlock));
-  for (size_t cacheLine = 0; cacheLine < 5; cacheLine++) {
-    AwFmSimdPrefetch(newStartBlockPtr + (cacheLine * 64));
-  }
+  awFmPrefetchBwtBlock(index, newStartBlock, sizeof(struct AwFmAminoBlock), 5);
 
   range->startPtr = newStartPointer;
 
@@ -137,10 +187,9 @@ void awFmAminoIterativeStepBackwardSearch(
   localQueryPosition =
       awFmGetBlockQueryPositionFromGlobalPosition(queryPosition);
 
-  baseOccurrence =
-      index->bwtBlockList.asAmino[blockIndex].baseOccurrences[letterIndex];
-  occurrenceVector = awFmMakeAminoAcidOccurrenceVector(
-      &(index->bwtBlockList.asAmino[blockIndex]), letterIndex);
+  blockPtr = awFmGetAminoBlock(index, blockIndex, &scratchBlock);
+  baseOccurrence = blockPtr->baseOccurrences[letterIndex];
+  occurrenceVector = awFmMakeAminoAcidOccurrenceVector(blockPtr, letterIndex);
   vectorPopcount =
       AwFmMaskedVectorPopcount(occurrenceVector, localQueryPosition);
 
@@ -149,15 +198,79 @@ void awFmAminoIterativeStepBackwardSearch(
 
   // prefetch the next start ptr
   uint64_t newEndBlock = (newEndPointer - 1) / AW_FM_POSITIONS_PER_FM_BLOCK;
-  uint8_t *newEndBlockPtr = ((uint8_t *)index->bwtBlockList.asAmino) +
-                            (newEndBlock * sizeof(struct AwFmAminoBlock));
-  for (size_t cacheLine = 0; cacheLine < 5; cacheLine++) {
-    AwFmSimdPrefetch(newEndBlockPtr + (cacheLine * 64));
-  }
+  awFmPrefetchBwtBlock(index, newEndBlock, sizeof(struct AwFmAminoBlock), 5);
+
+  range->endPtr = newEndPointer;
+}
+
+void awFmReducedAminoIterativeStepBackwardSearch(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmSearchRange *_RESTRICT_ const range, const uint8_t letterIndex) {
+
+  // query for the start pointer
+  uint64_t queryPosition = range->startPtr - 1;
+  const uint64_t letterPrefixSum = index->prefixSums[letterIndex];
+
+  uint64_t blockIndex = awFmGetBlockIndexFromGlobalPosition(queryPosition);
+  uint8_t localQueryPosition =
+      awFmGetBlockQueryPositionFromGlobalPosition(queryPosition);
+  struct AwFmReducedAminoBlock scratchBlock;
+  const struct AwFmReducedAminoBlock *blockPtr =
+      awFmGetReducedAminoBlock(index, blockIndex, &scratchBlock);
+  uint64_t baseOccurrence = blockPtr->baseOccurrences[letterIndex];
+  AwFmSimdVec256 occurrenceVector =
+      awFmMakeReducedAminoOccurrenceVector(blockPtr, letterIndex);
+  uint16_t vectorPopcount =
+      AwFmMaskedVectorPopcount(occurrenceVector, localQueryPosition);
+  uint64_t newStartPointer = letterPrefixSum + vectorPopcount + baseOccurrence;
+
+  // prefetch the next start ptr. The whole block is 4 cache lines.
+  uint64_t newStartBlock = (newStartPointer - 1) / AW_FM_POSITIONS_PER_FM_BLOCK;
+  awFmPrefetchBwtBlock(index, newStartBlock,
+                       sizeof(struct AwFmReducedAminoBlock), 4);
+
+  range->startPtr = newStartPointer;
+
+  // query for the new end pointer
+  queryPosition = range->endPtr;
+  blockIndex = awFmGetBlockIndexFromGlobalPosition(queryPosition);
+  localQueryPosition =
+      awFmGetBlockQueryPositionFromGlobalPosition(queryPosition);
+
+  blockPtr = awFmGetReducedAminoBlock(index, blockIndex, &scratchBlock);
+  baseOccurrence = blockPtr->baseOccurrences[letterIndex];
+  occurrenceVector =
+      awFmMakeReducedAminoOccurrenceVector(blockPtr, letterIndex);
+  vectorPopcount =
+      AwFmMaskedVectorPopcount(occurrenceVector, localQueryPosition);
+
+  const uint64_t newEndPointer =
+      letterPrefixSum + vectorPopcount + baseOccurrence - 1;
+
+  // prefetch the next end ptr
+  uint64_t newEndBlock = newEndPointer / AW_FM_POSITIONS_PER_FM_BLOCK;
+  awFmPrefetchBwtBlock(index, newEndBlock,
+                       sizeof(struct AwFmReducedAminoBlock), 4);
 
   range->endPtr = newEndPointer;
 }
 
+void awFmIterativeStepBackwardSearch(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmSearchRange *_RESTRICT_ const range, const uint8_t letterIndex) {
+  switch (index->config.alphabetType) {
+  case AwFmAlphabetAmino:
+    awFmAminoIterativeStepBackwardSearch(index, range, letterIndex);
+    break;
+  case AwFmAlphabetReducedAmino:
+    awFmReducedAminoIterativeStepBackwardSearch(index, range, letterIndex);
+    break;
+  default:
+    awFmNucleotideIterativeStepBackwardSearch(index, range, letterIndex);
+    break;
+  }
+}
+
 uint64_t *awFmFindDatabaseHitPositions(
     const struct AwFmIndex *_RESTRICT_ const index,
     const struct AwFmSearchRange *_RESTRICT_ const searchRange,
@@ -177,6 +290,7 @@ uint64_t *awFmFindDatabaseHitPositions(
       malloc(numPositionsInRange * sizeof(uint64_t));
   // check for allocation failures
   if (__builtin_expect(positionArray == NULL, 0)) {
+    free(offsetArray);
     *fileAccessResult = AwFmAllocationFailure;
     return NULL;
   }
@@ -186,16 +300,27 @@ uint64_t *awFmFindDatabaseHitPositions(
     return NULL;
   }
 
+  *fileAccessResult = awFmFindDatabaseHitPositionsToArray(
+      index, searchRange, positionArray, offsetArray);
+  free(offsetArray);
+  return positionArray;
+}
+
+enum AwFmReturnCode awFmFindDatabaseHitPositionsToArray(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    const struct AwFmSearchRange *_RESTRICT_ const searchRange,
+    uint64_t *_RESTRICT_ const positionArray,
+    uint64_t *_RESTRICT_ const offsetArray) {
+  const uint64_t numPositionsInRange = awFmSearchRangeLength(searchRange);
+  const uint64_t bwtReadFailures = awFmDiskBwtReadFailures(index);
+
   // call a prefetch for each block that contains the positions that we need to
   // start querying
-  const uint_fast16_t blockWidth =
-      index->config.alphabetType == AwFmAlphabetAmino
-          ? sizeof(struct AwFmAminoBlock)
-          : sizeof(struct AwFmNucleotideBlock);
+  const uint_fast16_t blockWidth = awFmGetBwtBlockByteWidth(index);
 
   for (uint64_t i = searchRange->startPtr; i < searchRange->endPtr;
        i += AW_FM_POSITIONS_PER_FM_BLOCK) {
-    awFmBlockPrefetch((uint8_t *)index->bwtBlockList.asAmino, blockWidth, i);
+    awFmPrefetchBwtPosition(index, blockWidth, i);
   }
 
   // backtrace each position until we have a list of the positions in the
@@ -204,7 +329,13 @@ uint64_t *awFmFindDatabaseHitPositions(
     uint64_t databaseSequenceOffset = 0;
     uint64_t backtracePosition = searchRange->startPtr + i;
 
-    if (index->config.alphabetType != AwFmAlphabetAmino) {
+    if (index->config.alphabetType == AwFmAlphabetReducedAmino) {
+      while (!awFmBwtPositionIsSampled(index, backtracePosition)) {
+        backtracePosition =
+            awFmReducedAminoBacktraceBwtPosition(index, backtracePosition);
+        databaseSequenceOffset++;
+      }
+    } else if (index->config.alphabetType != AwFmAlphabetAmino) {
       while (!awFmBwtPositionIsSampled(index, backtracePosition)) {
         backtracePosition =
             awFmNucleotideBacktraceBwtPosition(index, backtracePosition);
@@ -223,13 +354,13 @@ uint64_t *awFmFindDatabaseHitPositions(
   }
 
   // get the positions from the suffix array.
-  *fileAccessResult = awFmReadPositionsFromSuffixArray(index, positionArray,
-                                                       numPositionsInRange);
+  const enum AwFmReturnCode fileAccessResult =
+      awFmReadPositionsFromSuffixArray(index, positionArray,
+                                       numPositionsInRange);
 
   // make sure that reading from the suffix array actually succeeded
-  if (*fileAccessResult == AwFmFileReadFail) {
-    free(offsetArray);
-    return positionArray;
+  if (fileAccessResult == AwFmFileReadFail) {
+    return fileAccessResult;
   }
 
   // add the offsets to the returned positions to get the actual positions of
@@ -239,10 +370,7 @@ uint64_t *awFmFindDatabaseHitPositions(
     positionArray[i] %= index->bwtLength; // mod by the length so that the
                                           // sentinel wraps to zero.
   }
-  free(offsetArray);
-
-  *fileAccessResult = AwFmFileReadOkay;
-  return positionArray;
+  return awFmDiskBwtCheckReads(index, bwtReadFailures, AwFmFileReadOkay);
 }
 
 uint64_t awFmFindDatabaseHitPositionSingle(
@@ -251,8 +379,15 @@ uint64_t awFmFindDatabaseHitPositionSingle(
 
   uint64_t databaseSequenceOffset = 0;
   uint64_t backtracePosition = bwtPosition;
+  const uint64_t bwtReadFailures = awFmDiskBwtReadFailures(index);
 
-  if (index->config.alphabetType != AwFmAlphabetAmino) {
+  if (index->config.alphabetType == AwFmAlphabetReducedAmino) {
+    while (!awFmBwtPositionIsSampled(index, backtracePosition)) {
+      backtracePosition =
+          awFmReducedAminoBacktraceBwtPosition(index, backtracePosition);
+      databaseSequenceOffset++;
+    }
+  } else if (index->config.alphabetType != AwFmAlphabetAmino) {
     while (!awFmBwtPositionIsSampled(index, backtracePosition)) {
       backtracePosition =
           awFmNucleotideBacktraceBwtPosition(index, backtracePosition);
@@ -277,7 +412,8 @@ uint64_t awFmFindDatabaseHitPositionSingle(
   backtracePosition += databaseSequenceOffset;
   backtracePosition %=
       index->bwtLength; // mod by the length so that the sentinel wraps to zero.
-  *fileAccessResult = AwFmFileReadOkay;
+  *fileAccessResult =
+      awFmDiskBwtCheckReads(index, bwtReadFailures, AwFmFileReadOkay);
   return backtracePosition;
 }
 
@@ -319,17 +455,9 @@ awFmFindSearchRangeForString(const struct AwFmIndex *_RESTRICT_ const index,
                              const char *_RESTRICT_ const kmer,
                              const size_t kmerLength) {
   size_t kmerLetterPosition = kmerLength - 1;
-  uint16_t bwtBlockWidth;
-  uint8_t kmerLetterIndex;
-
-  if (index->config.alphabetType != AwFmAlphabetAmino) {
-    bwtBlockWidth = sizeof(struct AwFmNucleotideBlock);
-    kmerLetterIndex =
-        awFmAsciiNucleotideToLetterIndex(kmer[kmerLetterPosition]);
-  } else {
-    bwtBlockWidth = sizeof(struct AwFmAminoBlock);
-    kmerLetterIndex = awFmAsciiAminoAcidToLetterIndex(kmer[kmerLetterPosition]);
-  }
+  const uint16_t bwtBlockWidth = awFmGetBwtBlockByteWidth(index);
+  uint8_t kmerLetterIndex =
+      awFmAsciiToLetterIndex(index, kmer[kmerLetterPosition]);
 
   // create the inital range from the first suffix letter.
   struct AwFmSearchRange range = {
@@ -337,9 +465,16 @@ awFmFindSearchRangeForString(const struct AwFmIndex *_RESTRICT_ const index,
       .endPtr = index->prefixSums[kmerLetterIndex + 1] - 1};
 
   // start by prefetching the endptr
-  awFmBlockPrefetch(index->bwtBlockList.asNucleotide, bwtBlockWidth,
-                    range.endPtr);
-  if (index->config.alphabetType != AwFmAlphabetAmino) {
+  awFmPrefetchBwtPosition(index, bwtBlockWidth, range.endPtr);
+  if (index->config.alphabetType == AwFmAlphabetReducedAmino) {
+    while (__builtin_expect(
+        awFmSearchRangeIsValid(&range) && (kmerLetterPosition--), 1)) {
+      kmerLetterIndex = awFmAsciiReducedAminoToLetterIndex(
+          index->reducedAminoLetterMap, kmer[kmerLetterPosition]);
+      awFmReducedAminoIterativeStepBackwardSearch(index, &range,
+                                                  kmerLetterIndex);
+    }
+  } else if (index->config.alphabetType != AwFmAlphabetAmino) {
     while (__builtin_expect(
         awFmSearchRangeIsValid(&range) && (kmerLetterPosition--), 1)) {
       kmerLetterIndex =
@@ -374,8 +509,9 @@ inline size_t awFmNucleotideBacktraceBwtPosition(
   const uint64_t blockIndex = awFmGetBlockIndexFromGlobalPosition(bwtPosition);
   const uint8_t localQueryPosition =
       awFmGetBlockQueryPositionFromGlobalPosition(bwtPosition);
+  struct AwFmNucleotideBlock scratchBlock;
   const struct AwFmNucleotideBlock *_RESTRICT_ const blockPtr =
-      &index->bwtBlockList.asNucleotide[blockIndex];
+      awFmGetNucleotideBlock(index, blockIndex, &scratchBlock);
   const uint8_t letterIndex =
       awFmGetNucleotideLetterAtBwtPosition(blockPtr, localQueryPosition);
 
@@ -404,8 +540,9 @@ awFmAminoBacktraceBwtPosition(const struct AwFmIndex *_RESTRICT_ const index,
   const uint64_t blockIndex = awFmGetBlockIndexFromGlobalPosition(bwtPosition);
   const uint8_t localQueryPosition =
       awFmGetBlockQueryPositionFromGlobalPosition(bwtPosition);
+  struct AwFmAminoBlock scratchBlock;
   const struct AwFmAminoBlock *_RESTRICT_ const blockPtr =
-      &index->bwtBlockList.asAmino[blockIndex];
+      awFmGetAminoBlock(index, blockIndex, &scratchBlock);
   uint8_t letterIndex =
       awFmGetAminoLetterAtBwtPosition(blockPtr, localQueryPosition);
 
@@ -426,6 +563,35 @@ awFmAminoBacktraceBwtPosition(const struct AwFmIndex *_RESTRICT_ const index,
   return backtraceBwtPosition;
 }
 
+inline size_t awFmReducedAminoBacktraceBwtPosition(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    const uint64_t bwtPosition) {
+
+  const uint64_t *prefixSums = index->prefixSums;
+  const uint64_t blockIndex = awFmGetBlockIndexFromGlobalPosition(bwtPosition);
+  const uint8_t localQueryPosition =
+      awFmGetBlockQueryPositionFromGlobalPosition(bwtPosition);
+  struct AwFmReducedAminoBlock scratchBlock;
+  const struct AwFmReducedAminoBlock *_RESTRICT_ const blockPtr =
+      awFmGetReducedAminoBlock(index, blockIndex, &scratchBlock);
+  const uint8_t letterIndex =
+      awFmGetReducedAminoLetterAtBwtPosition(blockPtr, localQueryPosition);
+
+  // if we encountered the sentinel, we know the position and can stop
+  // backtracing
+  if (__builtin_expect(letterIndex == AW_FM_REDUCED_AMINO_CARDINALITY + 1,
+                       0)) {
+    return 0;
+  }
+
+  const AwFmSimdVec256 occurrenceVector =
+      awFmMakeReducedAminoOccurrenceVector(blockPtr, letterIndex);
+  const uint64_t baseOccurrence = blockPtr->baseOccurrences[letterIndex];
+  const uint16_t vectorPopcount =
+      AwFmMaskedVectorPopcount(occurrenceVector, localQueryPosition);
+  return prefixSums[letterIndex] + baseOccurrence + vectorPopcount - 1;
+}
+
 inline uint8_t awFmNucleotideBacktraceReturnPreviousLetterIndex(
     const struct AwFmIndex *_RESTRICT_ const index, uint64_t *bwtPosition) {
 
@@ -433,8 +599,9 @@ inline uint8_t awFmNucleotideBacktraceReturnPreviousLetterIndex(
   const uint64_t blockIndex = awFmGetBlockIndexFromGlobalPosition(*bwtPosition);
   const uint8_t localQueryPosition =
       awFmGetBlockQueryPositionFromGlobalPosition(*bwtPosition);
+  struct AwFmNucleotideBlock scratchBlock;
   const struct AwFmNucleotideBlock *_RESTRICT_ const blockPtr =
-      &index->bwtBlockList.asNucleotide[blockIndex];
+      awFmGetNucleotideBlock(index, blockIndex, &scratchBlock);
   const uint8_t letterIndex =
       awFmGetNucleotideLetterAtBwtPosition(blockPtr, localQueryPosition);
 
@@ -461,8 +628,9 @@ inline uint8_t awFmAminoBacktraceReturnPreviousLetterIndex(
   const uint64_t blockIndex = awFmGetBlockIndexFromGlobalPosition(*bwtPosition);
   const uint8_t localQueryPosition =
       awFmGetBlockQueryPositionFromGlobalPosition(*bwtPosition);
+  struct AwFmAminoBlock scratchBlock;
   const struct AwFmAminoBlock *_RESTRICT_ const blockPtr =
-      &index->bwtBlockList.asAmino[blockIndex];
+      awFmGetAminoBlock(index, blockIndex, &scratchBlock);
   uint8_t letterIndex =
       awFmGetAminoLetterAtBwtPosition(blockPtr, localQueryPosition);
 
@@ -482,6 +650,36 @@ inline uint8_t awFmAminoBacktraceReturnPreviousLetterIndex(
   return letterIndex;
 }
 
+inline uint8_t awFmReducedAminoBacktraceReturnPreviousLetterIndex(
+    const struct AwFmIndex *_RESTRICT_ const index, uint64_t *bwtPosition) {
+
+  const uint64_t *prefixSums = index->prefixSums;
+  const uint64_t blockIndex = awFmGetBlockIndexFromGlobalPosition(*bwtPosition);
+  const uint8_t localQueryPosition =
+      awFmGetBlockQueryPositionFromGlobalPosition(*bwtPosition);
+  struct AwFmReducedAminoBlock scratchBlock;
+  const struct AwFmReducedAminoBlock *_RESTRICT_ const blockPtr =
+      awFmGetReducedAminoBlock(index, blockIndex, &scratchBlock);
+  const uint8_t letterIndex =
+      awFmGetReducedAminoLetterAtBwtPosition(blockPtr, localQueryPosition);
+
+  // if we encountered the sentinel, we know the position and can stop
+  // backtracing
+  if (__builtin_expect(letterIndex == AW_FM_REDUCED_AMINO_CARDINALITY + 1,
+                       0)) {
+    return 0;
+  }
+
+  const AwFmSimdVec256 occurrenceVector =
+      awFmMakeReducedAminoOccurrenceVector(blockPtr, letterIndex);
+  const uint64_t baseOccurrence = blockPtr->baseOccurrences[letterIndex];
+  const uint16_t vectorPopcount =
+      AwFmMaskedVectorPopcount(occurrenceVector, localQueryPosition);
+  *bwtPosition = prefixSums[letterIndex] + baseOccurrence + vectorPopcount - 1;
+
+  return letterIndex;
+}
+
 inline void
 awFmNucleotideNonSeededSearch(const struct AwFmIndex *_RESTRICT_ const index,
                               const char *_RESTRICT_ const kmer,
@@ -518,3 +716,142 @@ awFmAminoNonSeededSearch(const struct AwFmIndex *_RESTRICT_ const index,
         index, range, awFmAsciiAminoAcidToLetterIndex(kmer[indexInKmerString]));
   }
 }
+
+inline void awFmReducedAminoNonSeededSearch(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    const char *_RESTRICT_ const kmer, const uint64_t kmerLength,
+    struct AwFmSearchRange *range) {
+
+  const uint8_t *letterMap = index->reducedAminoLetterMap;
+  uint64_t indexInKmerString = kmerLength - 1;
+  uint8_t queryLetterIndex =
+      awFmAsciiReducedAminoToLetterIndex(letterMap, kmer[indexInKmerString]);
+  range->startPtr = index->prefixSums[queryLetterIndex];
+  range->endPtr = index->prefixSums[queryLetterIndex + 1] - 1;
+
+  while (indexInKmerString-- != 0 && awFmSearchRangeIsValid(range)) {
+    awFmReducedAminoIterativeStepBackwardSearch(
+        index, range,
+        awFmAsciiReducedAminoToLetterIndex(letterMap,
+                                           kmer[indexInKmerString]));
+  }
+}
+
+uint64_t
+awFmFindSentinelBwtPosition(const struct AwFmIndex *_RESTRICT_ const index) {
+  // the blocks count the sentinel like any other letter, so the block that
+  // holds it is the last one with no sentinel before it.
+  const uint8_t sentinelLetterIndex =
+      awFmGetAlphabetCardinality(index->config.alphabetType) + 1;
+  const enum AwFmAlphabetType alphabetType = index->config.alphabetType;
+  struct AwFmNucleotideBlock scratchNucleotideBlock;
+  struct AwFmAminoBlock scratchAminoBlock;
+  struct AwFmReducedAminoBlock scratchReducedAminoBlock;
+
+  uint64_t lowBlock = 0;
+  uint64_t highBlock = awFmNumBlocksFromBwtLength(index->bwtLength) - 1;
+  while (lowBlock < highBlock) {
+    const uint64_t middleBlock = lowBlock + ((highBlock - lowBlock + 1) / 2);
+    uint64_t sentinelsBefore;
+    if (alphabetType == AwFmAlphabetAmino) {
+      sentinelsBefore =
+          awFmGetAminoBlock(index, middleBlock, &scratchAminoBlock)
+              ->baseOccurrences[sentinelLetterIndex];
+    } else if (alphabetType == AwFmAlphabetReducedAmino) {
+      sentinelsBefore = awFmGetReducedAminoBlock(index, middleBlock,
+                                                 &scratchReducedAminoBlock)
+                            ->baseOccurrences[sentinelLetterIndex];
+    } else {
+      sentinelsBefore =
+          awFmGetNucleotideBlock(index, middleBlock, &scratchNucleotideBlock)
+              ->baseOccurrences[sentinelLetterIndex];
+    }
+    if (sentinelsBefore == 0) {
+      lowBlock = middleBlock;
+    } else {
+      highBlock = middleBlock - 1;
+    }
+  }
+
+  uint64_t position = lowBlock * AW_FM_POSITIONS_PER_FM_BLOCK;
+  if (alphabetType == AwFmAlphabetReducedAmino) {
+    const struct AwFmReducedAminoBlock *blockPtr =
+        awFmGetReducedAminoBlock(index, lowBlock, &scratchReducedAminoBlock);
+    while (awFmGetReducedAminoLetterAtBwtPosition(
+               blockPtr, awFmGetBlockQueryPositionFromGlobalPosition(
+                             position)) != sentinelLetterIndex) {
+      position++;
+    }
+  } else if (alphabetType == AwFmAlphabetAmino) {
+    const struct AwFmAminoBlock *blockPtr =
+        awFmGetAminoBlock(index, lowBlock, &scratchAminoBlock);
+    while (awFmGetAminoLetterAtBwtPosition(
+               blockPtr, awFmGetBlockQueryPositionFromGlobalPosition(
+                             position)) != sentinelLetterIndex) {
+      position++;
+    }
+  } else {
+    const struct AwFmNucleotideBlock *blockPtr =
+        awFmGetNucleotideBlock(index, lowBlock, &scratchNucleotideBlock);
+    while (awFmGetNucleotideLetterAtBwtPosition(
+               blockPtr, awFmGetBlockQueryPositionFromGlobalPosition(
+                             position)) != sentinelLetterIndex) {
+      position++;
+    }
+  }
+  return position;
+}
+
+void awFmCountLettersBeforePosition(
+    const struct AwFmIndex *_RESTRICT_ const index, const uint64_t position,
+    uint64_t *_RESTRICT_ const counts) {
+  const uint8_t numLetters =
+      awFmGetAlphabetCardinality(index->config.alphabetType) + 1;
+  if (position == 0) {
+    memset(counts, 0, numLetters * sizeof(uint64_t));
+    return;
+  }
+
+  // the last position counted is position - 1, so its block's base
+  // occurrences plus the letters up to and including it give the count.
+  const uint64_t queryPosition = position - 1;
+  const uint64_t blockIndex =
+      awFmGetBlockIndexFromGlobalPosition(queryPosition);
+  const uint8_t localQueryPosition =
+      awFmGetBlockQueryPositionFromGlobalPosition(queryPosition);
+
+  if (index->config.alphabetType == AwFmAlphabetReducedAmino) {
+    struct AwFmReducedAminoBlock scratchBlock;
+    const struct AwFmReducedAminoBlock *blockPtr =
+        awFmGetReducedAminoBlock(index, blockIndex, &scratchBlock);
+    for (uint8_t letterIndex = 0; letterIndex < numLetters; letterIndex++) {
+      counts[letterIndex] =
+          blockPtr->baseOccurrences[letterIndex] +
+          AwFmMaskedVectorPopcount(
+              awFmMakeReducedAminoOccurrenceVector(blockPtr, letterIndex),
+              localQueryPosition);
+    }
+  } else if (index->config.alphabetType == AwFmAlphabetAmino) {
+    struct AwFmAminoBlock scratchBlock;
+    const struct AwFmAminoBlock *blockPtr =
+        awFmGetAminoBlock(index, blockIndex, &scratchBlock);
+    for (uint8_t letterIndex = 0; letterIndex < numLetters; letterIndex++) {
+      counts[letterIndex] =
+          blockPtr->baseOccurrences[letterIndex] +
+          AwFmMaskedVectorPopcount(
+              awFmMakeAminoAcidOccurrenceVector(blockPtr, letterIndex),
+              localQueryPosition);
+    }
+  } else {
+    struct AwFmNucleotideBlock scratchBlock;
+    const struct AwFmNucleotideBlock *blockPtr =
+        awFmGetNucleotideBlock(index, blockIndex, &scratchBlock);
+    for (uint8_t letterIndex = 0; letterIndex < numLetters; letterIndex++) {
+      counts[letterIndex] =
+          blockPtr->baseOccurrences[letterIndex] +
+          AwFmMaskedVectorPopcount(
+              awFmMakeNucleotideOccurrenceVector(blockPtr, letterIndex),
+              localQueryPosition);
+    }
+  }
+}
@@ -44,6 +44,23 @@ size_t
 awFmAminoBacktraceBwtPosition(const struct AwFmIndex *_RESTRICT_ const index,
                               const uint64_t bwtPosition);
 
+/*
+ * Function:  awFmReducedAminoBacktraceBwtPosition
+ * --------------------
+ * Given a specified Bwt position in a reduced amino index, backsteps to find
+ *  the position one before in original sequence.
+ *
+ *  Inputs:
+ *    index: Index to backstep
+ *    bwtPosition: Position of the character to be returned.
+ *
+ *  Returns:
+ *    Position in the suffix array of the character in the sequence immediately
+ * preceeding the one found at the given bwtPosition.
+ */
+size_t awFmReducedAminoBacktraceBwtPosition(
+    const struct AwFmIndex *_RESTRICT_ const index, const uint64_t bwtPosition);
+
 /*
  * Function:  awFmSingleKmerExists
  * --------------------
@@ -118,4 +135,105 @@ void awFmAminoNonSeededSearch(const struct AwFmIndex *_RESTRICT_ const index,
                               const size_t kmerLength,
                               struct AwFmSearchRange *range);
 
+/*
+ * Function:  awFmReducedAminoNonSeededSearch
+ * --------------------
+ *  Finds the range in the bwt of a reduced amino index corresponding to the
+ * entire given amino kmer, whose letters are reduced by the index's letter
+ * map. Like awFmAminoNonSeededSearch, this is meant for kmers that can't use
+ * the kmerTable.
+ *
+ *  Inputs:
+ *    index:        Pointer to the valid AwFmIndex struct.
+ *    kmer:         Pointer to the kmer character string.
+ *    kmerLength:   Length of the kmer, at least 1.
+ *    range:        Pointer to a search range where the output will be written.
+ */
+void awFmReducedAminoNonSeededSearch(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    const char *_RESTRICT_ const kmer, const size_t kmerLength,
+    struct AwFmSearchRange *range);
+
+/*
+ * Function:  awFmFindDatabaseHitPositionsToArray
+ * --------------------
+ * Like awFmFindDatabaseHitPositions, but writes the positions to the given
+ *  array instead of allocating one, so callers can lay out the hits of many
+ *  ranges in a single buffer.
+ *
+ *  Inputs:
+ *    index:          Index to locate the hits in.
+ *    searchRange:    Nonempty range of BWT positions to locate.
+ *    positionArray:  Output array, with space for a position per BWT position
+ *      in the range.
+ *    offsetArray:    Scratch array of the same length.
+ *
+ *  Returns:
+ *    AwFmFileReadOkay on success, or AwFmFileReadFail.
+ */
+enum AwFmReturnCode awFmFindDatabaseHitPositionsToArray(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    const struct AwFmSearchRange *_RESTRICT_ const searchRange,
+    uint64_t *_RESTRICT_ const positionArray,
+    uint64_t *_RESTRICT_ const offsetArray);
+
+/*
+ * Function:  awFmFindSentinelBwtPosition
+ * --------------------
+ * Finds the position of the sentinel in the BWT, which is also the number of
+ *  suffixes that sort before the whole sequence.
+ *
+ *  Inputs:
+ *    index: Index to search, with its BWT either in memory or on disk.
+ *
+ *  Returns:
+ *    BWT position of the sentinel character.
+ */
+uint64_t
+awFmFindSentinelBwtPosition(const struct AwFmIndex *_RESTRICT_ const index);
+
+/*
+ * Function:  awFmCountLettersBeforePosition
+ * --------------------
+ * Counts every letter of the alphabet, except the sentinel, over the BWT
+ *  positions [0, position). This is what a bidirectional step needs, since
+ *  it has to know how many of the range's suffixes continue with a lesser
+ *  letter.
+ *
+ *  Inputs:
+ *    index:    Index to count in.
+ *    position: Number of leading BWT positions to count over. May be anywhere
+ *      from 0 to the bwtLength.
+ *    counts:   Output array, with space for one count per letter of the
+ *      alphabet, including the ambiguity letter.
+ */
+void awFmCountLettersBeforePosition(
+    const struct AwFmIndex *_RESTRICT_ const index, const uint64_t position,
+    uint64_t *_RESTRICT_ const counts);
+
+/*
+ * Function:  awFmFindWindowRanges
+ * --------------------
+ * Finds the ranges of the kmer windows of the sequence starting in
+ *  [chunkStart, chunkEnd). The seed table index rolls in one letter per
+ *  window, and the windows are extended in interleaved groups so their block
+ *  reads overlap. Windows with an ambiguity letter get an empty range without
+ *  being searched.
+ *
+ *  Inputs:
+ *    index:      Index to search.
+ *    sequence:   Sequence the windows are taken from. Every window in the
+ *      chunk must fit in the sequence.
+ *    kmerLength: Length of each window.
+ *    chunkStart: First window to search.
+ *    chunkEnd:   One past the last window to search.
+ *    ranges:     Output array, with the range of window chunkStart + i
+ *      written to ranges[i].
+ */
+void awFmFindWindowRanges(const struct AwFmIndex *_RESTRICT_ const index,
+                          const char *_RESTRICT_ const sequence,
+                          const uint64_t kmerLength, const uint64_t chunkStart,
+                          const uint64_t chunkEnd,
+                          struct AwFmSearchRange *_RESTRICT_ const ranges);
+
 #endif /* end of include guard: AW_FM_INDEX_SEARCH_H */
@@ -0,0 +1,280 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "AwFmDiskBwt.h"
+#include "AwFmIndex.h"
+#include "AwFmIndexStruct.h"
+#include "AwFmLetter.h"
+#include "AwFmNuma.h"
+#include "AwFmSearch.h"
+
+// windows are handed to threads this many at a time. Each chunk starts its
+// rolling seed index over, so chunks are long enough to make that rare.
+#define AW_FM_WINDOW_CHUNK_SIZE 4096
+
+// extends the seeded ranges of a group of windows to the whole kmer, one
+// letter of every window at a time so their block reads overlap.
+static void
+extendWindowGroup(const struct AwFmIndex *_RESTRICT_ const index,
+                  const char *_RESTRICT_ const sequence,
+                  const uint64_t kmerLength, const uint64_t seededLength,
+                  const uint64_t *_RESTRICT_ const groupWindows,
+                  struct AwFmSearchRange *_RESTRICT_ const groupRanges,
+                  const size_t groupSize) {
+  for (uint64_t length = seededLength; length < kmerLength; length++) {
+    for (size_t i = 0; i < groupSize; i++) {
+      if (!awFmSearchRangeIsValid(&groupRanges[i])) {
+        continue;
+      }
+      const uint8_t letterIndex = awFmAsciiToLetterIndex(
+          index, sequence[groupWindows[i] + kmerLength - 1 - length]);
+      awFmIterativeStepBackwardSearch(index, &groupRanges[i], letterIndex);
+    }
+  }
+}
+
+void awFmFindWindowRanges(const struct AwFmIndex *_RESTRICT_ const index,
+                          const char *_RESTRICT_ const sequence,
+                          const uint64_t kmerLength, const uint64_t chunkStart,
+                          const uint64_t chunkEnd,
+                          struct AwFmSearchRange *_RESTRICT_ const ranges) {
+  const uint8_t cardinality =
+      awFmGetAlphabetCardinality(index->config.alphabetType);
+  const uint8_t tableKmerLength = index->config.kmerLengthInSeedTable;
+  const bool useSeedTable = kmerLength >= tableKmerLength;
+  const uint64_t seededLength = useSeedTable ? tableKmerLength : 1;
+  uint64_t seedTableSize = 1;
+  for (uint8_t i = 0; i < tableKmerLength; i++) {
+    seedTableSize *= cardinality;
+  }
+
+  uint64_t groupWindows[AW_FM_NUM_CONCURRENT_QUERIES];
+  struct AwFmSearchRange groupRanges[AW_FM_NUM_CONCURRENT_QUERIES];
+  size_t groupSize = 0;
+
+  // the seed index rolls in one letter per window, and the run of letters
+  // since the last ambiguity letter tells which windows are clean.
+  uint64_t seedIndex = 0;
+  uint64_t cleanRunLength = 0;
+  uint64_t position = chunkStart;
+  for (uint64_t window = chunkStart; window < chunkEnd; window++) {
+    for (; position < window + kmerLength; position++) {
+      const uint8_t letterIndex =
+          awFmAsciiToLetterIndex(index, sequence[position]);
+      if (__builtin_expect(letterIndex == cardinality, 0)) {
+        cleanRunLength = 0;
+        seedIndex = 0;
+      } else {
+        cleanRunLength++;
+        seedIndex = ((seedIndex * cardinality) + letterIndex) % seedTableSize;
+      }
+    }
+
+    if (cleanRunLength < kmerLength) {
+      ranges[window - chunkStart] =
+          (struct AwFmSearchRange){.startPtr = 1, .endPtr = 0};
+      continue;
+    }
+
+    const uint8_t lastLetterIndex =
+        awFmAsciiToLetterIndex(index, sequence[window + kmerLength - 1]);
+    groupWindows[groupSize] = window;
+    groupRanges[groupSize++] =
+        useSeedTable
+            ? index->kmerSeedTable[seedIndex]
+            : (struct AwFmSearchRange){
+                  .startPtr = index->prefixSums[lastLetterIndex],
+                  .endPtr = index->prefixSums[lastLetterIndex + 1] - 1};
+    if (groupSize == AW_FM_NUM_CONCURRENT_QUERIES) {
+      extendWindowGroup(index, sequence, kmerLength, seededLength,
+                        groupWindows, groupRanges, groupSize);
+      for (size_t i = 0; i < groupSize; i++) {
+        ranges[groupWindows[i] - chunkStart] = groupRanges[i];
+      }
+      groupSize = 0;
+    }
+  }
+
+  if (groupSize != 0) {
+    extendWindowGroup(index, sequence, kmerLength, seededLength, groupWindows,
+                      groupRanges, groupSize);
+    for (size_t i = 0; i < groupSize; i++) {
+      ranges[groupWindows[i] - chunkStart] = groupRanges[i];
+    }
+  }
+}
+
+static inline uint64_t numWindowsInSequence(const uint64_t sequenceLength,
+                                            const uint64_t kmerLength) {
+  return sequenceLength >= kmerLength ? sequenceLength - kmerLength + 1 : 0;
+}
+
+enum AwFmReturnCode awFmSlidingWindowSearchCount(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    const char *_RESTRICT_ const sequence, const uint64_t sequenceLength,
+    const uint64_t kmerLength, uint64_t *_RESTRICT_ const counts,
+    uint32_t numThreads) {
+  if (index == NULL || sequence == NULL || counts == NULL) {
+    return AwFmNullPtrError;
+  }
+  if (kmerLength == 0) {
+    return AwFmIllegalPositionError;
+  }
+  const uint64_t numWindows = numWindowsInSequence(sequenceLength, kmerLength);
+  enum AwFmReturnCode atomicReturnCode = AwFmSuccess;
+  const uint64_t bwtReadFailures = awFmDiskBwtReadFailures(index);
+
+#pragma omp parallel num_threads(numThreads > 0 ? numThreads : 1)
+  {
+    struct AwFmIndex localIndex;
+    struct AwFmNumaThreadBinding numaBinding;
+    const struct AwFmIndex *threadIndex =
+        awFmNumaBindThread(index, &localIndex, &numaBinding);
+    struct AwFmSearchRange *ranges =
+        malloc(AW_FM_WINDOW_CHUNK_SIZE * sizeof(struct AwFmSearchRange));
+    if (ranges == NULL) {
+#pragma omp atomic write
+      atomicReturnCode = AwFmAllocationFailure;
+    }
+
+#pragma omp for schedule(dynamic)
+    for (uint64_t chunkStart = 0; chunkStart < numWindows;
+         chunkStart += AW_FM_WINDOW_CHUNK_SIZE) {
+      if (__builtin_expect(ranges == NULL, 0)) {
+        continue;
+      }
+      const uint64_t chunkEnd =
+          chunkStart + AW_FM_WINDOW_CHUNK_SIZE < numWindows
+              ? chunkStart + AW_FM_WINDOW_CHUNK_SIZE
+              : numWindows;
+      awFmFindWindowRanges(threadIndex, sequence, kmerLength, chunkStart,
+                           chunkEnd, ranges);
+      for (uint64_t window = chunkStart; window < chunkEnd; window++) {
+        counts[window] = awFmSearchRangeLength(&ranges[window - chunkStart]);
+      }
+    }
+
+    free(ranges);
+    awFmNumaUnbindThread(&numaBinding);
+  }
+  return awFmDiskBwtCheckReads(index, bwtReadFailures, atomicReturnCode);
+}
+
+enum AwFmReturnCode awFmSlidingWindowSearchLocate(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    const char *_RESTRICT_ const sequence, const uint64_t sequenceLength,
+    const uint64_t kmerLength, struct AwFmWindowHits *_RESTRICT_ *windowHits,
+    uint32_t numThreads) {
+  if (index == NULL || sequence == NULL || windowHits == NULL) {
+    return AwFmNullPtrError;
+  }
+  if (kmerLength == 0) {
+    return AwFmIllegalPositionError;
+  }
+  *windowHits = NULL;
+  const uint64_t numWindows = numWindowsInSequence(sequenceLength, kmerLength);
+  const uint64_t bwtReadFailures = awFmDiskBwtReadFailures(index);
+  struct AwFmWindowHits *hits = malloc(sizeof(struct AwFmWindowHits));
+  struct AwFmSearchRange *ranges =
+      malloc(numWindows * sizeof(struct AwFmSearchRange));
+  if (hits == NULL || (ranges == NULL && numWindows != 0)) {
+    free(hits);
+    free(ranges);
+    return AwFmAllocationFailure;
+  }
+  hits->numWindows = numWindows;
+  hits->positions = NULL;
+  hits->offsets = malloc((numWindows + 1) * sizeof(uint64_t));
+  if (hits->offsets == NULL) {
+    free(ranges);
+    awFmDeallocWindowHits(hits);
+    return AwFmAllocationFailure;
+  }
+
+  // the ranges are all found before any hit is located, so the hits can be
+  // laid out by window in one allocation.
+#pragma omp parallel num_threads(numThreads > 0 ? numThreads : 1)
+  {
+    struct AwFmIndex localIndex;
+    struct AwFmNumaThreadBinding numaBinding;
+    const struct AwFmIndex *threadIndex =
+        awFmNumaBindThread(index, &localIndex, &numaBinding);
+#pragma omp for schedule(dynamic)
+    for (uint64_t chunkStart = 0; chunkStart < numWindows;
+         chunkStart += AW_FM_WINDOW_CHUNK_SIZE) {
+      const uint64_t chunkEnd =
+          chunkStart + AW_FM_WINDOW_CHUNK_SIZE < numWindows
+              ? chunkStart + AW_FM_WINDOW_CHUNK_SIZE
+              : numWindows;
+      awFmFindWindowRanges(threadIndex, sequence, kmerLength, chunkStart,
+                           chunkEnd, ranges + chunkStart);
+    }
+    awFmNumaUnbindThread(&numaBinding);
+  }
+
+  hits->offsets[0] = 0;
+  for (uint64_t window = 0; window < numWindows; window++) {
+    hits->offsets[window + 1] =
+        hits->offsets[window] + awFmSearchRangeLength(&ranges[window]);
+  }
+  hits->positions = malloc(hits->offsets[numWindows] * sizeof(uint64_t));
+  if (hits->positions == NULL && hits->offsets[numWindows] != 0) {
+    free(ranges);
+    awFmDeallocWindowHits(hits);
+    return AwFmAllocationFailure;
+  }
+
+  enum AwFmReturnCode atomicReturnCode = AwFmSuccess;
+#pragma omp parallel num_threads(numThreads > 0 ? numThreads : 1)
+  {
+    // scratch for the backtrace offsets, grown to the largest window's hits.
+    uint64_t *offsetArray = NULL;
+    uint64_t offsetArrayCapacity = 0;
+
+#pragma omp for schedule(dynamic, 64)
+    for (uint64_t window = 0; window < numWindows; window++) {
+      const uint64_t numHits =
+          hits->offsets[window + 1] - hits->offsets[window];
+      if (numHits == 0) {
+        continue;
+      }
+      if (numHits > offsetArrayCapacity) {
+        free(offsetArray);
+        offsetArray = malloc(numHits * sizeof(uint64_t));
+        offsetArrayCapacity = offsetArray != NULL ? numHits : 0;
+        if (offsetArray == NULL) {
+#pragma omp atomic write
+          atomicReturnCode = AwFmAllocationFailure;
+          continue;
+        }
+      }
+      if (__builtin_expect(awFmFindDatabaseHitPositionsToArray(
+                               index, &ranges[window],
+                               hits->positions + hits->offsets[window],
+                               offsetArray) != AwFmFileReadOkay,
+                           0)) {
+#pragma omp atomic write
+        atomicReturnCode = AwFmFileReadFail;
+      }
+    }
+    free(offsetArray);
+  }
+
+  free(ranges);
+  atomicReturnCode =
+      awFmDiskBwtCheckReads(index, bwtReadFailures, atomicReturnCode);
+  if (atomicReturnCode != AwFmSuccess) {
+    awFmDeallocWindowHits(hits);
+    return atomicReturnCode;
+  }
+  *windowHits = hits;
+  return AwFmSuccess;
+}
+
+void awFmDeallocWindowHits(struct AwFmWindowHits *windowHits) {
+  if (windowHits != NULL) {
+    free(windowHits->offsets);
+    free(windowHits->positions);
+    free(windowHits);
+  }
+}
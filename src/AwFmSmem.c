@@ -0,0 +1,316 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "AwFmDiskBwt.h"
+#include "AwFmIndex.h"
+#include "AwFmIndexStruct.h"
+#include "AwFmLetter.h"
+
+#define DEFAULT_SMEM_LIST_CAPACITY 4
+
+// a match that starts at the query position the search started from, or
+// later while extending left, and ends before queryEnd.
+struct AwFmSmemInterval {
+  struct AwFmBiDirectionalRange range;
+  uint64_t queryEnd;
+};
+
+// per-thread buffers, grown to fit the longest query seen so far.
+struct AwFmSmemScratch {
+  uint8_t *letters;
+  struct AwFmSmemInterval *intervals[2];
+  size_t capacity;
+};
+
+static bool
+smemScratchReserve(struct AwFmSmemScratch *_RESTRICT_ const scratch,
+                   const size_t queryLength) {
+  if (queryLength <= scratch->capacity) {
+    return true;
+  }
+  uint8_t *letters = realloc(scratch->letters, queryLength);
+  if (letters == NULL) {
+    return false;
+  }
+  scratch->letters = letters;
+  for (uint8_t i = 0; i < 2; i++) {
+    struct AwFmSmemInterval *intervals = realloc(
+        scratch->intervals[i], queryLength * sizeof(struct AwFmSmemInterval));
+    if (intervals == NULL) {
+      return false;
+    }
+    scratch->intervals[i] = intervals;
+  }
+  scratch->capacity = queryLength;
+  return true;
+}
+
+static void smemScratchDealloc(struct AwFmSmemScratch *_RESTRICT_ scratch) {
+  free(scratch->letters);
+  free(scratch->intervals[0]);
+  free(scratch->intervals[1]);
+}
+
+static void
+clearSmems(struct AwFmSmemSearchData *_RESTRICT_ const searchData) {
+  for (uint32_t i = 0; i < searchData->count; i++) {
+    free(searchData->smems[i].positionList);
+    searchData->smems[i].positionList = NULL;
+  }
+  searchData->count = 0;
+}
+
+static bool appendSmem(struct AwFmSmemSearchData *_RESTRICT_ const searchData,
+                       const uint64_t queryStart,
+                       const struct AwFmSmemInterval *_RESTRICT_ interval) {
+  if (searchData->count == searchData->capacity) {
+    const uint32_t newCapacity = searchData->capacity * 2;
+    struct AwFmSmem *smems =
+        realloc(searchData->smems, newCapacity * sizeof(struct AwFmSmem));
+    if (smems == NULL) {
+      return false;
+    }
+    searchData->smems = smems;
+    searchData->capacity = newCapacity;
+  }
+  searchData->smems[searchData->count++] =
+      (struct AwFmSmem){.queryStart = queryStart,
+                        .length = interval->queryEnd - queryStart,
+                        .range = interval->range,
+                        .positionList = NULL};
+  return true;
+}
+
+// finds the SMEMs that cover queryPosition, which must not be ambiguous.
+// Returns the end of the longest match that starts at queryPosition, where
+// the search for the next SMEMs should start, or 0 on allocation failure.
+static size_t
+findSmemsAtPosition(const struct AwFmBiDirectionalIndex *_RESTRICT_ biIndex,
+                    struct AwFmSmemSearchData *_RESTRICT_ const searchData,
+                    struct AwFmSmemScratch *_RESTRICT_ const scratch,
+                    const size_t queryLength, const size_t queryPosition,
+                    const uint64_t minSmemLength) {
+  const uint8_t *letters = scratch->letters;
+  const uint8_t ambiguityLetterIndex = awFmGetAlphabetCardinality(
+      biIndex->forwardIndex->config.alphabetType);
+  struct AwFmSmemInterval *previous = scratch->intervals[0];
+  struct AwFmSmemInterval *current = scratch->intervals[1];
+  size_t numPrevious = 0;
+
+  // extend right as far as possible, keeping the last interval before each
+  // drop in the number of matches. These are listed shortest match first.
+  struct AwFmSmemInterval interval = {
+      .range = awFmBiDirectionalCreateInitialRange(
+          biIndex, letters[queryPosition]),
+      .queryEnd = queryPosition + 1};
+  // a letter that doesn't occur in the database is in no match.
+  if (interval.range.length == 0) {
+    return queryPosition + 1;
+  }
+  for (size_t position = queryPosition + 1;; position++) {
+    if (position == queryLength || letters[position] == ambiguityLetterIndex) {
+      previous[numPrevious++] = interval;
+      break;
+    }
+    struct AwFmBiDirectionalRange extendedRange = interval.range;
+    awFmBiDirectionalExtendRight(biIndex, &extendedRange, letters[position]);
+    if (extendedRange.length != interval.range.length) {
+      previous[numPrevious++] = interval;
+    }
+    if (extendedRange.length == 0) {
+      break;
+    }
+    interval.range = extendedRange;
+    interval.queryEnd = position + 1;
+  }
+  const size_t nextQueryPosition = previous[numPrevious - 1].queryEnd;
+
+  // longest match first, so the first interval that can't be extended left
+  // in each step is the only one not contained in another match.
+  for (size_t i = 0; i < numPrevious / 2; i++) {
+    const struct AwFmSmemInterval swap = previous[i];
+    previous[i] = previous[numPrevious - 1 - i];
+    previous[numPrevious - 1 - i] = swap;
+  }
+
+  // SMEMs are found with decreasing starts, and reversed at the end.
+  const uint32_t firstSmem = searchData->count;
+  uint64_t lastSmemStart = UINT64_MAX;
+  for (size_t start = queryPosition; numPrevious != 0; start--) {
+    const bool canExtend =
+        start != 0 && letters[start - 1] != ambiguityLetterIndex;
+    size_t numCurrent = 0;
+    for (size_t i = 0; i < numPrevious; i++) {
+      struct AwFmBiDirectionalRange extendedRange = previous[i].range;
+      if (canExtend) {
+        awFmBiDirectionalExtendLeft(biIndex, &extendedRange,
+                                    letters[start - 1]);
+      }
+
+      if (!canExtend || extendedRange.length == 0) {
+        // nothing longer was kept from this step, so the match is maximal,
+        // and only the first one found at this start isn't contained.
+        if (numCurrent == 0 && start < lastSmemStart) {
+          lastSmemStart = start;
+          if (previous[i].queryEnd - start >= minSmemLength &&
+              !appendSmem(searchData, start, &previous[i])) {
+            return 0;
+          }
+        }
+      } else if (numCurrent == 0 ||
+                 extendedRange.length != current[numCurrent - 1].range.length) {
+        current[numCurrent++] = (struct AwFmSmemInterval){
+            .range = extendedRange, .queryEnd = previous[i].queryEnd};
+      }
+    }
+
+    struct AwFmSmemInterval *swap = previous;
+    previous = current;
+    current = swap;
+    numPrevious = numCurrent;
+  }
+
+  for (uint32_t i = firstSmem, j = searchData->count; i + 1 < j; i++, j--) {
+    const struct AwFmSmem swap = searchData->smems[i];
+    searchData->smems[i] = searchData->smems[j - 1];
+    searchData->smems[j - 1] = swap;
+  }
+  return nextQueryPosition;
+}
+
+static enum AwFmReturnCode
+locateSmems(const struct AwFmIndex *_RESTRICT_ const index,
+            struct AwFmSmemSearchData *_RESTRICT_ const searchData) {
+  for (uint32_t i = 0; i < searchData->count; i++) {
+    struct AwFmSmem *smem = &searchData->smems[i];
+    const struct AwFmSearchRange range = {
+        .startPtr = smem->range.forwardStartPtr,
+        .endPtr = smem->range.forwardStartPtr + smem->range.length - 1};
+    enum AwFmReturnCode returnCode;
+    smem->positionList = awFmFindDatabaseHitPositions(index, &range,
+                                                      &returnCode);
+    if (__builtin_expect(returnCode != AwFmFileReadOkay, 0)) {
+      return returnCode;
+    }
+  }
+  return AwFmSuccess;
+}
+
+static enum AwFmReturnCode
+searchQuery(const struct AwFmBiDirectionalIndex *_RESTRICT_ const biIndex,
+            struct AwFmSmemSearchData *_RESTRICT_ const searchData,
+            struct AwFmSmemScratch *_RESTRICT_ const scratch,
+            const uint64_t minSmemLength, const bool locate) {
+  clearSmems(searchData);
+  const size_t queryLength = searchData->queryLength;
+  if (!smemScratchReserve(scratch, queryLength)) {
+    return AwFmAllocationFailure;
+  }
+
+  const bool isAmino =
+      biIndex->forwardIndex->config.alphabetType == AwFmAlphabetAmino;
+  const uint8_t ambiguityLetterIndex = awFmGetAlphabetCardinality(
+      biIndex->forwardIndex->config.alphabetType);
+  for (size_t i = 0; i < queryLength; i++) {
+    scratch->letters[i] =
+        isAmino ? awFmAsciiAminoAcidToLetterIndex(searchData->queryString[i])
+                : awFmAsciiNucleotideToLetterIndex(searchData->queryString[i]);
+  }
+
+  size_t queryPosition = 0;
+  while (queryPosition < queryLength) {
+    if (scratch->letters[queryPosition] == ambiguityLetterIndex) {
+      queryPosition++;
+      continue;
+    }
+    queryPosition = findSmemsAtPosition(biIndex, searchData, scratch,
+                                        queryLength, queryPosition,
+                                        minSmemLength);
+    if (__builtin_expect(queryPosition == 0, 0)) {
+      return AwFmAllocationFailure;
+    }
+  }
+
+  return locate ? locateSmems(biIndex->forwardIndex, searchData) : AwFmSuccess;
+}
+
+struct AwFmSmemSearchList *awFmCreateSmemSearchList(const size_t capacity) {
+  struct AwFmSmemSearchList *searchList =
+      malloc(sizeof(struct AwFmSmemSearchList));
+  if (searchList == NULL) {
+    return NULL;
+  }
+  searchList->capacity = capacity;
+  searchList->count = 0;
+  searchList->smemSearchData =
+      malloc(capacity * sizeof(struct AwFmSmemSearchData));
+  if (searchList->smemSearchData == NULL) {
+    free(searchList);
+    return NULL;
+  }
+
+  bool smemListAllocationFailed = false;
+  for (size_t i = 0; i < capacity; i++) {
+    searchList->smemSearchData[i].queryString = NULL;
+    searchList->smemSearchData[i].queryLength = 0;
+    searchList->smemSearchData[i].count = 0;
+    searchList->smemSearchData[i].capacity = DEFAULT_SMEM_LIST_CAPACITY;
+    searchList->smemSearchData[i].smems =
+        malloc(DEFAULT_SMEM_LIST_CAPACITY * sizeof(struct AwFmSmem));
+    smemListAllocationFailed |= searchList->smemSearchData[i].smems == NULL;
+  }
+
+  if (smemListAllocationFailed) {
+    for (size_t i = 0; i < capacity; i++) {
+      free(searchList->smemSearchData[i].smems);
+    }
+    free(searchList->smemSearchData);
+    free(searchList);
+    return NULL;
+  }
+  return searchList;
+}
+
+void awFmDeallocSmemSearchList(
+    struct AwFmSmemSearchList *_RESTRICT_ const searchList) {
+  for (size_t i = 0; i < searchList->capacity; i++) {
+    clearSmems(&searchList->smemSearchData[i]);
+    free(searchList->smemSearchData[i].smems);
+  }
+  free(searchList->smemSearchData);
+  free(searchList);
+}
+
+enum AwFmReturnCode awFmParallelSearchSmems(
+    const struct AwFmBiDirectionalIndex *_RESTRICT_ const biIndex,
+    struct AwFmSmemSearchList *_RESTRICT_ const searchList,
+    const uint64_t minSmemLength, const bool locate, uint32_t numThreads) {
+  const size_t searchListCount = searchList->count;
+  enum AwFmReturnCode atomicReturnCode = AwFmSuccess;
+  const uint64_t forwardReadFailures =
+      awFmDiskBwtReadFailures(biIndex->forwardIndex);
+  const uint64_t reverseReadFailures =
+      awFmDiskBwtReadFailures(biIndex->reverseIndex);
+
+  // queries vary widely in how long they take, so they're handed out one at
+  // a time.
+#pragma omp parallel num_threads(numThreads > 0 ? numThreads : 1)
+  {
+    struct AwFmSmemScratch scratch = {0};
+#pragma omp for schedule(dynamic)
+    for (size_t i = 0; i < searchListCount; i++) {
+      enum AwFmReturnCode returnCode =
+          searchQuery(biIndex, &searchList->smemSearchData[i], &scratch,
+                      minSmemLength, locate);
+      if (__builtin_expect(returnCode != AwFmSuccess, 0)) {
+#pragma omp atomic write
+        atomicReturnCode = returnCode;
+      }
+    }
+    smemScratchDealloc(&scratch);
+  }
+  atomicReturnCode = awFmDiskBwtCheckReads(
+      biIndex->reverseIndex, reverseReadFailures, atomicReturnCode);
+  return awFmDiskBwtCheckReads(biIndex->forwardIndex, forwardReadFailures,
+                               atomicReturnCode);
+}
@@ -0,0 +1,547 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "AwFmApproximateSearch.h"
+#include "AwFmDiskBwt.h"
+#include "AwFmIndex.h"
+#include "AwFmIndexStruct.h"
+#include "AwFmLetter.h"
+#include "AwFmSearch.h"
+
+// sorted kmers are handed to threads this many at a time. Each run starts its
+// shared ranges over, so runs are long enough to make that rare.
+#define AW_FM_SPACED_SEED_RUN_LENGTH 256
+
+static const struct AwFmHitListLayout spacedSeedHitListLayout = {
+    .searchDataSize = sizeof(struct AwFmSpacedSeedSearchData),
+    .hitsOffset = offsetof(struct AwFmSpacedSeedSearchData, hits),
+    .countOffset = offsetof(struct AwFmSpacedSeedSearchData, count),
+    .capacityOffset = offsetof(struct AwFmSpacedSeedSearchData, capacity),
+    .hitSize = sizeof(struct AwFmSpacedSeedHit),
+    .rangeOffset = offsetof(struct AwFmSpacedSeedHit, range),
+    .positionListOffset = offsetof(struct AwFmSpacedSeedHit, positionList)};
+
+// a kmer's letters at the care positions, from the end of the pattern.
+struct AwFmSpacedSeedKey {
+  const uint8_t *careLetters;
+  uint64_t careLength;
+  size_t queryIndex;
+};
+
+// a branch of the seed table build: the range of the strings matching the
+// last depth positions of the pattern, and the table entry of their care
+// letters so far.
+struct AwFmSeedTableBranch {
+  struct AwFmSearchRange range;
+  uint64_t depth;
+  uint64_t entry;
+};
+
+struct AwFmSeedTableRange {
+  uint64_t entry;
+  struct AwFmSearchRange range;
+};
+
+// per-thread buffers. The ranges of each depth of the search are kept one
+// after another, with depth d's ranges starting at levelStarts[d], so a kmer
+// can pick up from the last depth it shares with the kmer before it.
+struct AwFmSpacedSeedScratch {
+  struct AwFmSearchRange *ranges;
+  size_t capacity;
+  uint64_t *levelStarts;
+};
+
+static bool spacedSeedScratchReserve(
+    struct AwFmSpacedSeedScratch *_RESTRICT_ const scratch,
+    const size_t numRanges) {
+  if (numRanges <= scratch->capacity) {
+    return true;
+  }
+  const size_t newCapacity =
+      scratch->capacity * 2 > numRanges ? scratch->capacity * 2 : numRanges;
+  struct AwFmSearchRange *ranges =
+      realloc(scratch->ranges, newCapacity * sizeof(struct AwFmSearchRange));
+  if (ranges == NULL) {
+    return false;
+  }
+  scratch->ranges = ranges;
+  scratch->capacity = newCapacity;
+  return true;
+}
+
+// writes the nonempty ranges of each letter below numLetters followed by the
+// range, from the occurrences before each end of it. The letter of each
+// branch is written to branchLetters if it isn't NULL.
+static size_t branchRange(const struct AwFmIndex *_RESTRICT_ const index,
+                          const struct AwFmSearchRange range,
+                          const uint8_t numLetters,
+                          struct AwFmSearchRange *_RESTRICT_ const branches,
+                          uint8_t *_RESTRICT_ const branchLetters) {
+  uint64_t countsBefore[AW_FM_AMINO_CARDINALITY + 1];
+  uint64_t countsAfter[AW_FM_AMINO_CARDINALITY + 1];
+  awFmCountLettersBeforePosition(index, range.startPtr, countsBefore);
+  awFmCountLettersBeforePosition(index, range.endPtr + 1, countsAfter);
+
+  size_t numBranches = 0;
+  for (uint8_t letterIndex = 0; letterIndex < numLetters; letterIndex++) {
+    if (countsAfter[letterIndex] == countsBefore[letterIndex]) {
+      continue;
+    }
+    if (branchLetters != NULL) {
+      branchLetters[numBranches] = letterIndex;
+    }
+    branches[numBranches++] = (struct AwFmSearchRange){
+        .startPtr = index->prefixSums[letterIndex] + countsBefore[letterIndex],
+        .endPtr =
+            index->prefixSums[letterIndex] + countsAfter[letterIndex] - 1};
+  }
+  return numBranches;
+}
+
+static inline bool patternIsCare(const struct AwFmSpacedSeed *_RESTRICT_ seed,
+                                 const uint64_t depth) {
+  return seed->pattern[seed->patternLength - 1 - depth] == '1';
+}
+
+// finds the ranges of every combination of letters at the table's care
+// positions with a depth first search, and groups them by table entry.
+static enum AwFmReturnCode
+buildSeedTable(const struct AwFmIndex *_RESTRICT_ const index,
+               struct AwFmSpacedSeed *_RESTRICT_ const seed,
+               const uint64_t numEntries) {
+  const uint8_t cardinality =
+      awFmGetAlphabetCardinality(index->config.alphabetType);
+  struct AwFmSeedTableBranch *branches =
+      malloc(((seed->tableWidth * (cardinality + 1)) + 1) *
+             sizeof(struct AwFmSeedTableBranch));
+  size_t tableRangesCapacity = 1024;
+  size_t numTableRanges = 0;
+  struct AwFmSeedTableRange *tableRanges =
+      malloc(tableRangesCapacity * sizeof(struct AwFmSeedTableRange));
+  seed->tableOffsets = calloc(numEntries + 1, sizeof(uint64_t));
+  if (branches == NULL || tableRanges == NULL || seed->tableOffsets == NULL) {
+    free(branches);
+    free(tableRanges);
+    return AwFmAllocationFailure;
+  }
+
+  size_t numBranches = 0;
+  branches[numBranches++] = (struct AwFmSeedTableBranch){
+      .range = {.startPtr = 0, .endPtr = index->bwtLength - 1},
+      .depth = 0,
+      .entry = 0};
+  while (numBranches != 0) {
+    const struct AwFmSeedTableBranch branch = branches[--numBranches];
+    if (branch.depth == seed->tableWidth) {
+      if (numTableRanges == tableRangesCapacity) {
+        tableRangesCapacity *= 2;
+        struct AwFmSeedTableRange *grownRanges = realloc(
+            tableRanges,
+            tableRangesCapacity * sizeof(struct AwFmSeedTableRange));
+        if (grownRanges == NULL) {
+          free(branches);
+          free(tableRanges);
+          return AwFmAllocationFailure;
+        }
+        tableRanges = grownRanges;
+      }
+      tableRanges[numTableRanges++] = (struct AwFmSeedTableRange){
+          .entry = branch.entry, .range = branch.range};
+      continue;
+    }
+
+    // don't care positions also branch on the ambiguity letter.
+    const bool isCare = patternIsCare(seed, branch.depth);
+    struct AwFmSearchRange letterRanges[AW_FM_AMINO_CARDINALITY + 1];
+    uint8_t letters[AW_FM_AMINO_CARDINALITY + 1];
+    const size_t numLetterRanges =
+        branchRange(index, branch.range, isCare ? cardinality : cardinality + 1,
+                    letterRanges, letters);
+    for (size_t i = 0; i < numLetterRanges; i++) {
+      branches[numBranches++] = (struct AwFmSeedTableBranch){
+          .range = letterRanges[i],
+          .depth = branch.depth + 1,
+          .entry = isCare ? (branch.entry * cardinality) + letters[i]
+                          : branch.entry};
+    }
+  }
+  free(branches);
+
+  seed->tableRanges =
+      malloc((numTableRanges + 1) * sizeof(struct AwFmSearchRange));
+  if (seed->tableRanges == NULL) {
+    free(tableRanges);
+    return AwFmAllocationFailure;
+  }
+  for (size_t i = 0; i < numTableRanges; i++) {
+    seed->tableOffsets[tableRanges[i].entry + 1]++;
+  }
+  for (uint64_t entry = 0; entry < numEntries; entry++) {
+    seed->tableOffsets[entry + 1] += seed->tableOffsets[entry];
+  }
+  // tableOffsets[entry] is used as the insertion point, then shifted back.
+  for (size_t i = 0; i < numTableRanges; i++) {
+    seed->tableRanges[seed->tableOffsets[tableRanges[i].entry]++] =
+        tableRanges[i].range;
+  }
+  for (uint64_t entry = numEntries; entry > 0; entry--) {
+    seed->tableOffsets[entry] = seed->tableOffsets[entry - 1];
+  }
+  seed->tableOffsets[0] = 0;
+  free(tableRanges);
+  return AwFmSuccess;
+}
+
+enum AwFmReturnCode
+awFmCreateSpacedSeed(struct AwFmSpacedSeed *_RESTRICT_ *seed,
+                     const struct AwFmIndex *_RESTRICT_ const index,
+                     const char *_RESTRICT_ const pattern,
+                     const uint8_t tableCareLength) {
+  if (seed == NULL || index == NULL || pattern == NULL) {
+    return AwFmNullPtrError;
+  }
+  *seed = NULL;
+  const size_t patternLength = strlen(pattern);
+  uint64_t careLength = 0;
+  for (size_t i = 0; i < patternLength; i++) {
+    if (pattern[i] == '1') {
+      careLength++;
+    } else if (pattern[i] != '0') {
+      return AwFmIllegalPositionError;
+    }
+  }
+  if (careLength == 0 || tableCareLength > careLength) {
+    return AwFmIllegalPositionError;
+  }
+  const uint8_t cardinality =
+      awFmGetAlphabetCardinality(index->config.alphabetType);
+  uint64_t numEntries = 1;
+  for (uint8_t i = 0; i < tableCareLength; i++) {
+    numEntries *= cardinality;
+    if (numEntries > UINT32_MAX) {
+      return AwFmIllegalPositionError;
+    }
+  }
+
+  struct AwFmSpacedSeed *newSeed = calloc(1, sizeof(struct AwFmSpacedSeed));
+  if (newSeed == NULL) {
+    return AwFmAllocationFailure;
+  }
+  newSeed->pattern = malloc(patternLength + 1);
+  if (newSeed->pattern == NULL) {
+    awFmDeallocSpacedSeed(newSeed);
+    return AwFmAllocationFailure;
+  }
+  memcpy(newSeed->pattern, pattern, patternLength + 1);
+  newSeed->patternLength = patternLength;
+  newSeed->careLength = careLength;
+  newSeed->tableCareLength = tableCareLength;
+
+  // the table covers the pattern back to its tableCareLength'th care
+  // position from the end.
+  uint8_t caresInTable = 0;
+  while (caresInTable < tableCareLength) {
+    caresInTable += patternIsCare(newSeed, newSeed->tableWidth);
+    newSeed->tableWidth++;
+  }
+  if (tableCareLength != 0) {
+    const uint64_t bwtReadFailures = awFmDiskBwtReadFailures(index);
+    const enum AwFmReturnCode returnCode = awFmDiskBwtCheckReads(
+        index, bwtReadFailures, buildSeedTable(index, newSeed, numEntries));
+    if (returnCode != AwFmSuccess) {
+      awFmDeallocSpacedSeed(newSeed);
+      return returnCode;
+    }
+  }
+  *seed = newSeed;
+  return AwFmSuccess;
+}
+
+void awFmDeallocSpacedSeed(struct AwFmSpacedSeed *seed) {
+  if (seed != NULL) {
+    free(seed->pattern);
+    free(seed->tableOffsets);
+    free(seed->tableRanges);
+    free(seed);
+  }
+}
+
+// sets the ranges at the table's depth, either from the kmer's seed table
+// entry or, without a table, the range of every suffix.
+static bool
+startSearch(const struct AwFmIndex *_RESTRICT_ const index,
+            const struct AwFmSpacedSeed *_RESTRICT_ const seed,
+            const struct AwFmSpacedSeedKey *_RESTRICT_ const key,
+            struct AwFmSpacedSeedScratch *_RESTRICT_ const scratch) {
+  uint64_t *levelStarts = scratch->levelStarts;
+  levelStarts[seed->tableWidth] = 0;
+  if (seed->tableCareLength == 0) {
+    levelStarts[1] = 1;
+    scratch->ranges[0] = (struct AwFmSearchRange){
+        .startPtr = 0, .endPtr = index->bwtLength - 1};
+    return true;
+  }
+
+  const uint8_t cardinality =
+      awFmGetAlphabetCardinality(index->config.alphabetType);
+  uint64_t entry = 0;
+  for (uint8_t i = 0; i < seed->tableCareLength; i++) {
+    entry = (entry * cardinality) + key->careLetters[i];
+  }
+  const uint64_t numRanges =
+      seed->tableOffsets[entry + 1] - seed->tableOffsets[entry];
+  if (!spacedSeedScratchReserve(scratch, numRanges)) {
+    return false;
+  }
+  memcpy(scratch->ranges, seed->tableRanges + seed->tableOffsets[entry],
+         numRanges * sizeof(struct AwFmSearchRange));
+  levelStarts[seed->tableWidth + 1] = numRanges;
+  return true;
+}
+
+// searches a run of sorted kmers. Levels up to validDepth hold the ranges of
+// the previous kmer, and the next kmer keeps the ones that only depend on the
+// care letters they share.
+static enum AwFmReturnCode
+searchRun(const struct AwFmIndex *_RESTRICT_ const index,
+          const struct AwFmSpacedSeed *_RESTRICT_ const seed,
+          struct AwFmSpacedSeedSearchList *_RESTRICT_ const searchList,
+          const struct AwFmSpacedSeedKey *_RESTRICT_ const keys,
+          const size_t runStart, const size_t runEnd,
+          const uint64_t *_RESTRICT_ const careDepths,
+          const uint64_t *_RESTRICT_ const caresBeforeDepth,
+          const uint64_t maxRanges,
+          struct AwFmSpacedSeedScratch *_RESTRICT_ const scratch) {
+  const uint8_t cardinality =
+      awFmGetAlphabetCardinality(index->config.alphabetType);
+  const uint64_t patternLength = seed->patternLength;
+  uint64_t *levelStarts = scratch->levelStarts;
+  uint64_t validDepth = 0;
+
+  for (size_t keyIndex = runStart; keyIndex < runEnd; keyIndex++) {
+    const struct AwFmSpacedSeedKey *key = &keys[keyIndex];
+    struct AwFmSpacedSeedSearchData *searchData =
+        &searchList->spacedSeedSearchData[key->queryIndex];
+
+    uint64_t depth = 0;
+    if (keyIndex != runStart) {
+      const struct AwFmSpacedSeedKey *previousKey = &keys[keyIndex - 1];
+      uint64_t sharedCares = 0;
+      while (sharedCares < seed->careLength &&
+             key->careLetters[sharedCares] ==
+                 previousKey->careLetters[sharedCares]) {
+        sharedCares++;
+      }
+      depth = sharedCares == seed->careLength ? patternLength
+                                              : careDepths[sharedCares];
+      depth = depth < validDepth ? depth : validDepth;
+    }
+    if (keyIndex == runStart || depth < seed->tableWidth) {
+      if (!startSearch(index, seed, key, scratch)) {
+        return AwFmAllocationFailure;
+      }
+      depth = seed->tableWidth;
+    }
+
+    bool exceededRangeLimit =
+        levelStarts[depth + 1] - levelStarts[depth] > maxRanges;
+    while (!exceededRangeLimit && depth < patternLength) {
+      const uint64_t levelStart = levelStarts[depth];
+      const uint64_t levelEnd = levelStarts[depth + 1];
+      const bool isCare = patternIsCare(seed, depth);
+      const uint64_t mostRanges =
+          isCare ? levelEnd - levelStart
+                 : (levelEnd - levelStart) * (cardinality + 1);
+      if (!spacedSeedScratchReserve(scratch, levelEnd + mostRanges)) {
+        return AwFmAllocationFailure;
+      }
+
+      struct AwFmSearchRange *ranges = scratch->ranges;
+      uint64_t nextLevelEnd = levelEnd;
+      for (uint64_t i = levelStart; i < levelEnd; i++) {
+        if (isCare) {
+          // stepping needs a range past the sentinel's row, so the first
+          // letter's range is read from the prefix sums instead.
+          const uint8_t letterIndex = key->careLetters[caresBeforeDepth[depth]];
+          struct AwFmSearchRange range = {
+              .startPtr = index->prefixSums[letterIndex],
+              .endPtr = index->prefixSums[letterIndex + 1] - 1};
+          if (depth != 0) {
+            range = ranges[i];
+            awFmIterativeStepBackwardSearch(index, &range, letterIndex);
+          }
+          if (awFmSearchRangeIsValid(&range)) {
+            ranges[nextLevelEnd++] = range;
+          }
+        } else {
+          nextLevelEnd += branchRange(index, ranges[i], cardinality + 1,
+                                      ranges + nextLevelEnd, NULL);
+        }
+        if (nextLevelEnd - levelEnd > maxRanges) {
+          exceededRangeLimit = true;
+          break;
+        }
+      }
+      if (!exceededRangeLimit) {
+        levelStarts[depth + 2] = nextLevelEnd;
+        depth++;
+      }
+    }
+    validDepth = depth;
+
+    searchData->exceededRangeLimit = exceededRangeLimit;
+    if (exceededRangeLimit) {
+      continue;
+    }
+    for (uint64_t i = levelStarts[patternLength];
+         i < levelStarts[patternLength + 1]; i++) {
+      const struct AwFmSpacedSeedHit hit = {.range = scratch->ranges[i],
+                                            .positionList = NULL};
+      if (!awFmHitListAppend(&spacedSeedHitListLayout, searchData, &hit)) {
+        return AwFmAllocationFailure;
+      }
+    }
+  }
+  return AwFmSuccess;
+}
+
+static int compareKeys(const void *a, const void *b) {
+  const struct AwFmSpacedSeedKey *x = a;
+  const struct AwFmSpacedSeedKey *y = b;
+  const int comparison = memcmp(x->careLetters, y->careLetters, x->careLength);
+  if (comparison != 0) {
+    return comparison;
+  }
+  return x->queryIndex < y->queryIndex ? -1 : x->queryIndex > y->queryIndex;
+}
+
+struct AwFmSpacedSeedSearchList *
+awFmCreateSpacedSeedSearchList(const size_t capacity) {
+  struct AwFmSpacedSeedSearchList *searchList =
+      malloc(sizeof(struct AwFmSpacedSeedSearchList));
+  if (searchList == NULL) {
+    return NULL;
+  }
+  searchList->capacity = capacity;
+  searchList->count = 0;
+  searchList->spacedSeedSearchData =
+      awFmHitListAllocSearchData(&spacedSeedHitListLayout, capacity);
+  if (searchList->spacedSeedSearchData == NULL) {
+    free(searchList);
+    return NULL;
+  }
+  return searchList;
+}
+
+void awFmDeallocSpacedSeedSearchList(
+    struct AwFmSpacedSeedSearchList *_RESTRICT_ const searchList) {
+  awFmHitListDeallocSearchData(&spacedSeedHitListLayout,
+                               searchList->spacedSeedSearchData,
+                               searchList->capacity);
+  free(searchList);
+}
+
+enum AwFmReturnCode awFmParallelSearchSpacedSeed(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    const struct AwFmSpacedSeed *_RESTRICT_ const seed,
+    struct AwFmSpacedSeedSearchList *_RESTRICT_ const searchList,
+    const uint64_t maxRanges, const bool locate, uint32_t numThreads) {
+  const size_t searchListCount = searchList->count;
+  const uint64_t bwtReadFailures = awFmDiskBwtReadFailures(index);
+  const uint64_t patternLength = seed->patternLength;
+  const uint64_t careLength = seed->careLength;
+  const uint8_t cardinality =
+      awFmGetAlphabetCardinality(index->config.alphabetType);
+
+  uint8_t *careLetters = malloc(searchListCount * careLength);
+  struct AwFmSpacedSeedKey *keys =
+      malloc(searchListCount * sizeof(struct AwFmSpacedSeedKey));
+  uint64_t *careDepths = malloc(careLength * sizeof(uint64_t));
+  uint64_t *caresBeforeDepth = malloc(patternLength * sizeof(uint64_t));
+  if ((searchListCount != 0 && (careLetters == NULL || keys == NULL)) ||
+      careDepths == NULL || caresBeforeDepth == NULL) {
+    free(careLetters);
+    free(keys);
+    free(careDepths);
+    free(caresBeforeDepth);
+    return AwFmAllocationFailure;
+  }
+  uint64_t caresSoFar = 0;
+  for (uint64_t depth = 0; depth < patternLength; depth++) {
+    caresBeforeDepth[depth] = caresSoFar;
+    if (patternIsCare(seed, depth)) {
+      careDepths[caresSoFar++] = depth;
+    }
+  }
+
+  // kmers with an ambiguity letter at a care position have no hits, so
+  // they're left out of the search.
+  size_t numKeys = 0;
+  for (size_t i = 0; i < searchListCount; i++) {
+    struct AwFmSpacedSeedSearchData *searchData =
+        &searchList->spacedSeedSearchData[i];
+    awFmHitListClear(&spacedSeedHitListLayout, searchData);
+    searchData->exceededRangeLimit = false;
+    uint8_t *letters = careLetters + (i * careLength);
+    bool isAmbiguous = false;
+    for (uint64_t care = 0; care < careLength && !isAmbiguous; care++) {
+      letters[care] = awFmAsciiToLetterIndex(
+          index, searchData->kmerString[patternLength - 1 - careDepths[care]]);
+      isAmbiguous = letters[care] == cardinality;
+    }
+    if (!isAmbiguous) {
+      keys[numKeys++] = (struct AwFmSpacedSeedKey){
+          .careLetters = letters, .careLength = careLength, .queryIndex = i};
+    }
+  }
+  qsort(keys, numKeys, sizeof(struct AwFmSpacedSeedKey), compareKeys);
+
+  enum AwFmReturnCode atomicReturnCode = AwFmSuccess;
+#pragma omp parallel num_threads(numThreads > 0 ? numThreads : 1)
+  {
+    struct AwFmSpacedSeedScratch scratch = {0};
+    scratch.levelStarts = malloc((patternLength + 2) * sizeof(uint64_t));
+    if (scratch.levelStarts == NULL || !spacedSeedScratchReserve(&scratch, 1)) {
+#pragma omp atomic write
+      atomicReturnCode = AwFmAllocationFailure;
+    }
+
+#pragma omp for schedule(dynamic)
+    for (size_t runStart = 0; runStart < numKeys;
+         runStart += AW_FM_SPACED_SEED_RUN_LENGTH) {
+      if (__builtin_expect(scratch.ranges == NULL ||
+                               scratch.levelStarts == NULL,
+                           0)) {
+        continue;
+      }
+      const size_t runEnd = runStart + AW_FM_SPACED_SEED_RUN_LENGTH < numKeys
+                                ? runStart + AW_FM_SPACED_SEED_RUN_LENGTH
+                                : numKeys;
+      enum AwFmReturnCode returnCode =
+          searchRun(index, seed, searchList, keys, runStart, runEnd,
+                    careDepths, caresBeforeDepth, maxRanges, &scratch);
+      for (size_t i = runStart; locate && i < runEnd; i++) {
+        if (returnCode == AwFmSuccess) {
+          returnCode = awFmHitListLocate(
+              &spacedSeedHitListLayout, index,
+              &searchList->spacedSeedSearchData[keys[i].queryIndex]);
+        }
+      }
+      if (__builtin_expect(returnCode != AwFmSuccess, 0)) {
+#pragma omp atomic write
+        atomicReturnCode = returnCode;
+      }
+    }
+
+    free(scratch.ranges);
+    free(scratch.levelStarts);
+  }
+
+  free(careLetters);
+  free(keys);
+  free(careDepths);
+  free(caresBeforeDepth);
+  return awFmDiskBwtCheckReads(index, bwtReadFailures, atomicReturnCode);
+}
@@ -3,11 +3,21 @@
 #include <assert.h>
 #include <string.h>
 #include "AwFmFile.h"
+#include "AwFmPageCache.h"
+#include "AwFmSuffixArrayBatch.h"
 
 // adding padding bytes prevents buffer overflow problems recalling values from
 // the suffix array.
 #define AW_FM_SUFFIX_ARRAY_END_PADDING_BYTES 8
 
+// below this many positions, setting up a batched read costs more than just
+// reading the values one at a time.
+#define AW_FM_SUFFIX_ARRAY_MIN_BATCHED_READ_COUNT 64
+
+// suffix array pages are cached at the file system's block size, which also
+// matches the alignment of batched suffix array reads.
+#define AW_FM_SUFFIX_ARRAY_CACHE_PAGE_SIZE 4096
+
 // simple log2 ceiling implementation, thanks builtin clzll!
 uint8_t log2Floor(const uint64_t a) { return 64 - __builtin_clzll(a); }
 
@@ -52,29 +62,27 @@ size_t awFmComputeCompressedSaSizeInBytes(size_t saLength,
   return offset.byteOffset + AW_FM_SUFFIX_ARRAY_END_PADDING_BYTES;
 }
 
-// note: fullSa MUST be dynamically allocated, this reallocs the array and
-// claims ownership. the reallocated array will be freed when awFmDeallocIndex()
-// is called.
-enum AwFmReturnCode awFmInitCompressedSuffixArray(
-    uint64_t *fullSa, size_t saLength,
+// compresses the suffix array of 4 or 8 byte values in place, and reallocs it
+// down to the compressed length. Each sample is written at or before the
+// bytes of the value it came from, so no unread values are clobbered.
+static enum AwFmReturnCode awFmCompressSuffixArrayInPlace(
+    uint8_t *fullSa, const uint8_t valueByteWidth, const size_t saLength,
     struct AwFmCompressedSuffixArray *compressedSuffixArray,
-    uint8_t samplingRatio) {
-
-  if (fullSa == NULL || compressedSuffixArray == NULL) {
-    return AwFmNullPtrError;
-  }
+    const uint8_t samplingRatio) {
   uint8_t minimumBitWidth = awFmComputeSuffixArrayValueMinWidth(saLength);
   size_t compressedSaByteSize =
       awFmComputeCompressedSaSizeInBytes(saLength, samplingRatio);
 
-  compressedSuffixArray->values = (uint8_t *)fullSa;
+  compressedSuffixArray->values = fullSa;
   compressedSuffixArray->valueBitWidth = minimumBitWidth;
   compressedSuffixArray->compressedByteLength = compressedSaByteSize;
 
   const size_t numSaSamples =
       awFmGetSampledSuffixArrayLength(saLength, samplingRatio);
   for (size_t i = 0; i < numSaSamples; i++) {
-    uint64_t saValue = fullSa[i * samplingRatio];
+    uint64_t saValue = valueByteWidth == sizeof(uint32_t)
+                           ? ((uint32_t *)fullSa)[i * samplingRatio]
+                           : ((uint64_t *)fullSa)[i * samplingRatio];
 
     struct AwFmSuffixArrayOffset offset =
         awFmGetOffsetIntoSuffixArrayByteArray(minimumBitWidth, i);
@@ -108,9 +116,45 @@ enum AwFmReturnCode awFmInitCompressedSuffixArray(
     return AwFmAllocationFailure;
   }
 
+  // zero the padding, which otherwise holds leftover suffix array values, so
+  // the index file doesn't depend on how the suffix array was built.
+  memset(compressedSuffixArray->values +
+             compressedSuffixArray->compressedByteLength -
+             AW_FM_SUFFIX_ARRAY_END_PADDING_BYTES,
+         0, AW_FM_SUFFIX_ARRAY_END_PADDING_BYTES);
+
   return AwFmSuccess;
 }
 
+// note: fullSa MUST be dynamically allocated, this reallocs the array and
+// claims ownership. the reallocated array will be freed when awFmDeallocIndex()
+// is called.
+enum AwFmReturnCode awFmInitCompressedSuffixArray(
+    uint64_t *fullSa, size_t saLength,
+    struct AwFmCompressedSuffixArray *compressedSuffixArray,
+    uint8_t samplingRatio) {
+
+  if (fullSa == NULL || compressedSuffixArray == NULL) {
+    return AwFmNullPtrError;
+  }
+  return awFmCompressSuffixArrayInPlace((uint8_t *)fullSa, sizeof(uint64_t),
+                                        saLength, compressedSuffixArray,
+                                        samplingRatio);
+}
+
+enum AwFmReturnCode awFmInitCompressedSuffixArray32(
+    uint32_t *fullSa, size_t saLength,
+    struct AwFmCompressedSuffixArray *compressedSuffixArray,
+    uint8_t samplingRatio) {
+
+  if (fullSa == NULL || compressedSuffixArray == NULL) {
+    return AwFmNullPtrError;
+  }
+  return awFmCompressSuffixArrayInPlace((uint8_t *)fullSa, sizeof(uint32_t),
+                                        saLength, compressedSuffixArray,
+                                        samplingRatio);
+}
+
 size_t awFmGetValueFromCompressedSuffixArray(
     const struct AwFmCompressedSuffixArray *suffixArray,
     size_t positionInArray) {
@@ -141,11 +185,66 @@ size_t awFmGetValueFromCompressedSuffixArray(
   return buffer & bitmask;
 }
 
+uint64_t awFmDecodeSuffixArrayValue(const uint8_t *_RESTRICT_ const valueBytes,
+                                    const uint8_t bitOffset,
+                                    const uint8_t valueBitWidth) {
+  uint64_t value;
+  memcpy(&value, valueBytes, 8);
+  value >>= bitOffset;
+  // shifting by 64 is undefined, so only pull in the 9th byte when the value
+  // actually spills into it.
+  if (bitOffset + valueBitWidth > 64) {
+    value |= ((uint64_t)valueBytes[8]) << (64 - bitOffset);
+  }
+  return valueBitWidth >= 64 ? value : value & ((1ULL << valueBitWidth) - 1);
+}
+
 inline size_t awFmGetSampledSuffixArrayLength(uint64_t bwtLength,
                                               uint64_t compressionRatio) {
   return (bwtLength + compressionRatio - 1) / compressionRatio;
 }
 
+/*
+ * Function:  awFmReadPositionsFromSuffixArrayBatched
+ * --------------------
+ * Reads every position from the on-disk suffix array with a single batch of
+ * coalesced reads.
+ *
+ *  Returns:
+ *    AwFmFileReadOkay on success, AwFmFileReadFail if the file could not be
+ * read, or AwFmAllocationFailure if the batch could not be set up, in which
+ * case the positionArray is left unchanged.
+ */
+static enum AwFmReturnCode awFmReadPositionsFromSuffixArrayBatched(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    uint64_t *_RESTRICT_ const positionArray,
+    const size_t positionArrayLength) {
+  struct AwFmAsyncFileReader *reader = awFmAsyncFileReaderPoolAcquire(
+      index->suffixArrayReaderPool, index->fileDescriptor);
+  if (reader == NULL) {
+    return AwFmAllocationFailure;
+  }
+
+  struct AwFmSuffixArrayBatch batch;
+  awFmSuffixArrayBatchInit(&batch);
+  enum AwFmReturnCode rc = AwFmSuccess;
+  for (size_t i = 0; i < positionArrayLength && rc == AwFmSuccess; i++) {
+    const struct AwFmBacktrace backtrace = {.position = positionArray[i],
+                                            .offset = 0};
+    rc = awFmSuffixArrayBatchAdd(index, &batch, &backtrace, &positionArray[i]);
+  }
+  if (rc == AwFmSuccess) {
+    rc = awFmSuffixArrayBatchSubmit(index, &batch, reader);
+  }
+  if (rc == AwFmSuccess) {
+    rc = awFmSuffixArrayBatchFinish(index, &batch, reader);
+  }
+
+  awFmSuffixArrayBatchDealloc(&batch);
+  awFmAsyncFileReaderPoolRelease(index->suffixArrayReaderPool, reader);
+  return rc;
+}
+
 enum AwFmReturnCode
 awFmReadPositionsFromSuffixArray(const struct AwFmIndex *_RESTRICT_ const index,
                                  uint64_t *_RESTRICT_ const positionArray,
@@ -161,19 +260,28 @@ awFmReadPositionsFromSuffixArray(const struct AwFmIndex *_RESTRICT_ const index,
     }
 
     return AwFmSuccess;
-  } else {
-    for (size_t i = 0; i < positionArrayLength; i++) {
-      size_t indexInSuffixArray =
-          positionArray[i] / index->config.suffixArrayCompressionRatio;
-      enum AwFmReturnCode rc = awFmGetSuffixArrayValueFromFile(
-          index, indexInSuffixArray, &positionArray[i]);
-      if (rc != AwFmSuccess) {
-        return rc;
-      }
+  }
+
+  if (positionArrayLength >= AW_FM_SUFFIX_ARRAY_MIN_BATCHED_READ_COUNT) {
+    enum AwFmReturnCode rc = awFmReadPositionsFromSuffixArrayBatched(
+        index, positionArray, positionArrayLength);
+    // if the batch couldn't be allocated, read the values one at a time.
+    if (rc != AwFmAllocationFailure) {
+      return rc;
     }
+  }
 
-    return AwFmFileReadOkay;
+  for (size_t i = 0; i < positionArrayLength; i++) {
+    size_t indexInSuffixArray =
+        positionArray[i] / index->config.suffixArrayCompressionRatio;
+    enum AwFmReturnCode rc = awFmGetSuffixArrayValueFromFile(
+        index, indexInSuffixArray, &positionArray[i]);
+    if (rc != AwFmSuccess) {
+      return rc;
+    }
   }
+
+  return AwFmFileReadOkay;
 }
 
 enum AwFmReturnCode awFmSuffixArrayReadPositionParallel(
@@ -201,3 +309,126 @@ enum AwFmReturnCode awFmSuffixArrayReadPositionParallel(
     return rc;
   }
 }
+
+enum AwFmReturnCode
+awFmEnableSuffixArrayCache(struct AwFmIndex *_RESTRICT_ const index,
+                           const size_t capacityInBytes) {
+  if (index == NULL) {
+    return AwFmNullPtrError;
+  }
+  if (index->config.keepSuffixArrayInMemory) {
+    return AwFmSuccess;
+  }
+
+  struct AwFmPageCache *cache =
+      awFmPageCacheCreate(index->fileDescriptor,
+                          AW_FM_SUFFIX_ARRAY_CACHE_PAGE_SIZE, capacityInBytes);
+  if (cache == NULL) {
+    return AwFmAllocationFailure;
+  }
+  awFmPageCacheDealloc(index->suffixArrayCache);
+  index->suffixArrayCache = cache;
+  return AwFmSuccess;
+}
+
+void awFmGetSuffixArrayCacheStatistics(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmCacheStatistics *_RESTRICT_ const statistics) {
+  if (index->suffixArrayCache == NULL) {
+    memset(statistics, 0, sizeof(struct AwFmCacheStatistics));
+    return;
+  }
+  awFmPageCacheGetStatistics(index->suffixArrayCache, statistics);
+}
+
+enum AwFmReturnCode
+awFmSuffixArrayWriterInit(struct AwFmSuffixArrayWriter *_RESTRICT_ const writer,
+                          const int fileDescriptor, const size_t fileOffset,
+                          const uint8_t valueBitWidth) {
+  writer->fileDescriptor = fileDescriptor;
+  writer->sectionFileOffset = fileOffset;
+  writer->fileOffset = fileOffset;
+  writer->valueBitWidth = valueBitWidth;
+  writer->bitsInBuffer = 0;
+  // the padding leaves room for the bytes of a value that starts in the last
+  // byte of the buffer.
+  writer->buffer = calloc(AW_FM_SUFFIX_ARRAY_WRITER_BUFFER_SIZE +
+                              AW_FM_SUFFIX_ARRAY_END_PADDING_BYTES + 1,
+                          sizeof(uint8_t));
+  return writer->buffer == NULL ? AwFmAllocationFailure : AwFmSuccess;
+}
+
+// writes every complete byte in the buffer, and moves the partial byte, if
+// any, to the front.
+static enum AwFmReturnCode
+awFmSuffixArrayWriterFlush(
+    struct AwFmSuffixArrayWriter *_RESTRICT_ const writer) {
+  const size_t completeBytes = writer->bitsInBuffer / 8;
+  if (awFmFileWriteFully(writer->fileDescriptor, writer->buffer, completeBytes,
+                         writer->fileOffset) != AwFmFileWriteOkay) {
+    return AwFmFileWriteFail;
+  }
+  writer->fileOffset += completeBytes;
+  writer->buffer[0] = writer->buffer[completeBytes];
+  memset(writer->buffer + 1, 0,
+         AW_FM_SUFFIX_ARRAY_WRITER_BUFFER_SIZE +
+             AW_FM_SUFFIX_ARRAY_END_PADDING_BYTES);
+  writer->bitsInBuffer %= 8;
+  return AwFmSuccess;
+}
+
+enum AwFmReturnCode awFmSuffixArrayWriterAppend(
+    struct AwFmSuffixArrayWriter *_RESTRICT_ const writer,
+    const uint64_t value) {
+  const size_t byteOffset = writer->bitsInBuffer / 8;
+  const uint8_t bitOffset = writer->bitsInBuffer % 8;
+  // same layout as awFmInitCompressedSuffixArray. The buffer is zeroed ahead
+  // of the write position, so the first byte can be or'd in.
+  writer->buffer[byteOffset] |= (value << bitOffset) & 0xFF;
+  uint64_t remainingValue = value >> (8 - bitOffset);
+  int8_t bitsRemaining = writer->valueBitWidth - (8 - bitOffset);
+  for (size_t i = byteOffset + 1; bitsRemaining > 0; i++) {
+    writer->buffer[i] = remainingValue;
+    remainingValue >>= 8;
+    bitsRemaining -= 8;
+  }
+  writer->bitsInBuffer += writer->valueBitWidth;
+
+  if (__builtin_expect(writer->bitsInBuffer / 8 >=
+                           AW_FM_SUFFIX_ARRAY_WRITER_BUFFER_SIZE,
+                       0)) {
+    return awFmSuffixArrayWriterFlush(writer);
+  }
+  return AwFmSuccess;
+}
+
+enum AwFmReturnCode awFmSuffixArrayWriterFinish(
+    struct AwFmSuffixArrayWriter *_RESTRICT_ const writer,
+    const size_t compressedByteLength) {
+  const size_t sectionEnd = writer->sectionFileOffset + compressedByteLength;
+  // round up to include the final partial byte.
+  writer->bitsInBuffer = ((writer->bitsInBuffer + 7) / 8) * 8;
+  enum AwFmReturnCode returnCode = awFmSuffixArrayWriterFlush(writer);
+  // the bytes past the last value, including the end padding, are zeros.
+  memset(writer->buffer, 0, AW_FM_SUFFIX_ARRAY_WRITER_BUFFER_SIZE);
+  while (returnCode == AwFmSuccess && writer->fileOffset < sectionEnd) {
+    size_t paddingLength = sectionEnd - writer->fileOffset;
+    if (paddingLength > AW_FM_SUFFIX_ARRAY_WRITER_BUFFER_SIZE) {
+      paddingLength = AW_FM_SUFFIX_ARRAY_WRITER_BUFFER_SIZE;
+    }
+    if (awFmFileWriteFully(writer->fileDescriptor, writer->buffer,
+                           paddingLength,
+                           writer->fileOffset) != AwFmFileWriteOkay) {
+      returnCode = AwFmFileWriteFail;
+    }
+    writer->fileOffset += paddingLength;
+  }
+  awFmSuffixArrayWriterDealloc(writer);
+  return returnCode;
+}
+
+void awFmSuffixArrayWriterDealloc(
+    struct AwFmSuffixArrayWriter *_RESTRICT_ const writer) {
+  free(writer->buffer);
+  writer->buffer = NULL;
+}
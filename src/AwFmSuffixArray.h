@@ -3,11 +3,26 @@
 
 #include "AwFmIndex.h"
 
+// streamed suffix array samples are written out in chunks of this many bytes.
+#define AW_FM_SUFFIX_ARRAY_WRITER_BUFFER_SIZE (1024 * 1024)
+
 struct AwFmSuffixArrayOffset {
   size_t byteOffset;
   uint8_t bitOffset;
 };
 
+/*Streams the bit-compressed, downsampled suffix array into the index file,
+ * for builds that never hold the full suffix array in memory.*/
+struct AwFmSuffixArrayWriter {
+  int fileDescriptor;
+  size_t sectionFileOffset;
+  // file offset where the buffer's first byte will be written.
+  size_t fileOffset;
+  uint8_t valueBitWidth;
+  uint8_t *buffer;
+  size_t bitsInBuffer;
+};
+
 /*
  * Function:  awFmInitCompressedSuffixArray
  * --------------------
@@ -38,6 +53,18 @@ enum AwFmReturnCode awFmInitCompressedSuffixArray(
     struct AwFmCompressedSuffixArray *compressedSuffixArray,
     uint8_t samplingRatio);
 
+/*
+ * Function:  awFmInitCompressedSuffixArray32
+ * --------------------
+ * Same as awFmInitCompressedSuffixArray, but from a uint32_t* suffix array,
+ * for sequences with fewer than 2^32 positions. The compressed suffix array
+ * is identical to the one made from the equivalent uint64_t* suffix array.
+ */
+enum AwFmReturnCode awFmInitCompressedSuffixArray32(
+    uint32_t *fullSa, size_t saLength,
+    struct AwFmCompressedSuffixArray *compressedSuffixArray,
+    uint8_t samplingRatio);
+
 /*
  * Function:  awFmGetValueFromCompressedSuffixArray
  * --------------------
@@ -150,6 +177,25 @@ struct AwFmSuffixArrayOffset
 awFmGetOffsetIntoSuffixArrayByteArray(const uint8_t compressedValueBitWidth,
                                       const size_t indexOfValueInCompressedSa);
 
+/*
+ * Function:  awFmDecodeSuffixArrayValue
+ * --------------------
+ * Extracts a bit-compressed suffix array value from a copy of the bytes that
+ * hold it, e.g., bytes read from the suffix array section of the index file.
+ *
+ *  Inputs:
+ *    valueBytes:     Pointer to the byte containing the value's first bit.
+ *      At least 9 bytes must be readable from this pointer.
+ *    bitOffset:      Offset of the value's first bit in valueBytes[0].
+ *    valueBitWidth:  Width of each value in the compressed suffix array.
+ *
+ *  Returns:
+ *    The decoded suffix array value.
+ */
+uint64_t awFmDecodeSuffixArrayValue(const uint8_t *_RESTRICT_ const valueBytes,
+                                    const uint8_t bitOffset,
+                                    const uint8_t valueBitWidth);
+
 /*
  * Function:  awFmSuffixArrayReadPositionParallel
  * --------------------
@@ -172,4 +218,64 @@ enum AwFmReturnCode awFmSuffixArrayReadPositionParallel(
     const struct AwFmIndex *_RESTRICT_ const index,
     struct AwFmBacktrace *_RESTRICT_ const backtracePtr);
 
+/*
+ * Function:  awFmSuffixArrayWriterInit
+ * --------------------
+ * Prepares a writer that packs suffix array samples into the compressed suffix
+ * array format, and writes them to the file starting at the given offset.
+ *
+ *  Inputs:
+ *    writer:         Writer to initialize.
+ *    fileDescriptor: File to write to.
+ *    fileOffset:     Offset of the suffix array section in the file.
+ *    valueBitWidth:  Width of each value, from
+ *      awFmComputeSuffixArrayValueMinWidth.
+ *
+ *  Returns:
+ *    AwFmSuccess, or AwFmAllocationFailure if the write buffer could not be
+ *      allocated.
+ */
+enum AwFmReturnCode
+awFmSuffixArrayWriterInit(struct AwFmSuffixArrayWriter *_RESTRICT_ const writer,
+                          const int fileDescriptor, const size_t fileOffset,
+                          const uint8_t valueBitWidth);
+
+/*
+ * Function:  awFmSuffixArrayWriterAppend
+ * --------------------
+ * Appends the next sample of the downsampled suffix array.
+ *
+ *  Returns:
+ *    AwFmSuccess, or AwFmFileWriteFail if a full buffer could not be written.
+ */
+enum AwFmReturnCode awFmSuffixArrayWriterAppend(
+    struct AwFmSuffixArrayWriter *_RESTRICT_ const writer,
+    const uint64_t value);
+
+/*
+ * Function:  awFmSuffixArrayWriterFinish
+ * --------------------
+ * Writes out any buffered samples, zero fills the rest of the section, and
+ * frees the writer's buffer.
+ *
+ *  Inputs:
+ *    writer:                Writer to finish.
+ *    compressedByteLength:  Length of the suffix array section, from
+ *      awFmComputeCompressedSaSizeInBytes.
+ *
+ *  Returns:
+ *    AwFmSuccess, or AwFmFileWriteFail if the file could not be written.
+ */
+enum AwFmReturnCode awFmSuffixArrayWriterFinish(
+    struct AwFmSuffixArrayWriter *_RESTRICT_ const writer,
+    const size_t compressedByteLength);
+
+/*
+ * Function:  awFmSuffixArrayWriterDealloc
+ * --------------------
+ * Frees the writer's buffer without writing anything, for abandoned builds.
+ */
+void awFmSuffixArrayWriterDealloc(
+    struct AwFmSuffixArrayWriter *_RESTRICT_ const writer);
+
 #endif
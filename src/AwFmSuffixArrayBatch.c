@@ -0,0 +1,237 @@
+#include "AwFmSuffixArrayBatch.h"
+#include <stdlib.h>
+#include <string.h>
+#include "AwFmPageCache.h"
+#include "AwFmSuffixArray.h"
+
+#define AW_FM_SA_BATCH_PAGE_SIZE 4096
+#define AW_FM_SA_BATCH_MAX_READ_LENGTH (256 * 1024)
+#define AW_FM_SA_BATCH_INITIAL_CAPACITY 64
+// values are decoded with a 9 byte load, so the buffer is padded to keep the
+// last value's load in bounds.
+#define AW_FM_SA_BATCH_BUFFER_PADDING 9
+#define AW_FM_SA_BATCH_CACHED_ENTRY SIZE_MAX
+
+static int awFmSuffixArrayBatchEntryCompare(const void *a, const void *b) {
+  const uint64_t sampleIndexA =
+      ((const struct AwFmSuffixArrayBatchEntry *)a)->sampleIndex;
+  const uint64_t sampleIndexB =
+      ((const struct AwFmSuffixArrayBatchEntry *)b)->sampleIndex;
+  return (sampleIndexA > sampleIndexB) - (sampleIndexA < sampleIndexB);
+}
+
+static bool awFmSuffixArrayBatchReserveReads(
+    struct AwFmSuffixArrayBatch *_RESTRICT_ const batch,
+    const size_t readCapacity) {
+  if (batch->readCapacity >= readCapacity) {
+    return true;
+  }
+  void *newReads =
+      realloc(batch->reads, readCapacity * sizeof(struct AwFmAsyncReadRequest));
+  if (newReads == NULL) {
+    return false;
+  }
+  batch->reads = newReads;
+  batch->readCapacity = readCapacity;
+  return true;
+}
+
+void awFmSuffixArrayBatchInit(
+    struct AwFmSuffixArrayBatch *_RESTRICT_ const batch) {
+  memset(batch, 0, sizeof(struct AwFmSuffixArrayBatch));
+  batch->submitReturnCode = AwFmSuccess;
+}
+
+void awFmSuffixArrayBatchDealloc(
+    struct AwFmSuffixArrayBatch *_RESTRICT_ const batch) {
+  free(batch->entries);
+  free(batch->reads);
+  free(batch->readBuffer);
+  memset(batch, 0, sizeof(struct AwFmSuffixArrayBatch));
+}
+
+enum AwFmReturnCode
+awFmSuffixArrayBatchAdd(const struct AwFmIndex *_RESTRICT_ const index,
+                        struct AwFmSuffixArrayBatch *_RESTRICT_ const batch,
+                        const struct AwFmBacktrace *_RESTRICT_ const backtrace,
+                        uint64_t *const destination) {
+  if (__builtin_expect(batch->entryCount == batch->entryCapacity, 0)) {
+    const size_t newCapacity = batch->entryCapacity == 0
+                                   ? AW_FM_SA_BATCH_INITIAL_CAPACITY
+                                   : batch->entryCapacity * 2;
+    void *newEntries = realloc(
+        batch->entries, newCapacity * sizeof(struct AwFmSuffixArrayBatchEntry));
+    if (newEntries == NULL) {
+      return AwFmAllocationFailure;
+    }
+    batch->entries = newEntries;
+    batch->entryCapacity = newCapacity;
+  }
+
+  struct AwFmSuffixArrayBatchEntry *entry = &batch->entries[batch->entryCount++];
+  entry->sampleIndex =
+      backtrace->position / index->config.suffixArrayCompressionRatio;
+  entry->offset = backtrace->offset;
+  entry->destination = destination;
+  return AwFmSuccess;
+}
+
+enum AwFmReturnCode
+awFmSuffixArrayBatchSubmit(const struct AwFmIndex *_RESTRICT_ const index,
+                           struct AwFmSuffixArrayBatch *_RESTRICT_ const batch,
+                           struct AwFmAsyncFileReader *_RESTRICT_ const reader) {
+  batch->readCount = 0;
+  batch->submitReturnCode = AwFmSuccess;
+  if (batch->entryCount == 0) {
+    return AwFmSuccess;
+  }
+
+  // sorting the entries puts hits on the same page of the suffix array next to
+  // each other, and makes the reads sequential in the file.
+  qsort(batch->entries, batch->entryCount,
+        sizeof(struct AwFmSuffixArrayBatchEntry),
+        awFmSuffixArrayBatchEntryCompare);
+
+  const uint8_t valueBitWidth = index->suffixArray.valueBitWidth;
+  size_t bufferLength = 0;
+  for (size_t i = 0; i < batch->entryCount; i++) {
+    struct AwFmSuffixArrayBatchEntry *entry = &batch->entries[i];
+    const struct AwFmSuffixArrayOffset saOffset =
+        awFmGetOffsetIntoSuffixArrayByteArray(valueBitWidth,
+                                              entry->sampleIndex);
+    const size_t valueStart = index->suffixArrayFileOffset + saOffset.byteOffset;
+    const size_t valueEnd =
+        valueStart + (saOffset.bitOffset + valueBitWidth + 7) / 8;
+
+    if (index->suffixArrayCache != NULL) {
+      uint8_t valueBytes[AW_FM_SA_BATCH_BUFFER_PADDING] = {0};
+      if (awFmPageCacheReadIfCached(index->suffixArrayCache, valueStart,
+                                    valueBytes, valueEnd - valueStart)) {
+        const uint64_t saValue = awFmDecodeSuffixArrayValue(
+            valueBytes, saOffset.bitOffset, valueBitWidth);
+        *entry->destination = (saValue + entry->offset) % index->bwtLength;
+        entry->bufferOffset = AW_FM_SA_BATCH_CACHED_ENTRY;
+        continue;
+      }
+    }
+
+    const size_t pageStart = valueStart & ~(size_t)(AW_FM_SA_BATCH_PAGE_SIZE - 1);
+    const size_t pageEnd = (valueEnd + AW_FM_SA_BATCH_PAGE_SIZE - 1) &
+                           ~(size_t)(AW_FM_SA_BATCH_PAGE_SIZE - 1);
+
+    struct AwFmAsyncReadRequest *currentRead =
+        batch->readCount > 0 ? &batch->reads[batch->readCount - 1] : NULL;
+    const bool extendsCurrentRead =
+        currentRead != NULL &&
+        pageStart <= currentRead->fileOffset + currentRead->length &&
+        pageEnd - currentRead->fileOffset <= AW_FM_SA_BATCH_MAX_READ_LENGTH;
+
+    if (extendsCurrentRead) {
+      const size_t readEnd = currentRead->fileOffset + currentRead->length;
+      if (pageEnd > readEnd) {
+        currentRead->length = pageEnd - currentRead->fileOffset;
+        bufferLength += pageEnd - readEnd;
+      }
+      currentRead->requiredLength = valueEnd - currentRead->fileOffset;
+    } else {
+      if (batch->readCount == batch->readCapacity &&
+          !awFmSuffixArrayBatchReserveReads(
+              batch, batch->readCapacity == 0
+                         ? AW_FM_SA_BATCH_INITIAL_CAPACITY
+                         : batch->readCapacity * 2)) {
+        batch->submitReturnCode = AwFmAllocationFailure;
+        return AwFmAllocationFailure;
+      }
+      currentRead = &batch->reads[batch->readCount++];
+      // the buffer doesn't exist yet, so stash this read's position in it.
+      currentRead->buffer = (uint8_t *)(uintptr_t)bufferLength;
+      currentRead->fileOffset = pageStart;
+      currentRead->length = pageEnd - pageStart;
+      currentRead->requiredLength = valueEnd - pageStart;
+      bufferLength += currentRead->length;
+    }
+
+    entry->bufferOffset = (size_t)(uintptr_t)currentRead->buffer +
+                          (valueStart - currentRead->fileOffset);
+  }
+
+  if (batch->readCount == 0) {
+    return AwFmSuccess;
+  }
+
+  const size_t bufferCapacity = bufferLength + AW_FM_SA_BATCH_BUFFER_PADDING;
+  if (batch->readBufferCapacity < bufferCapacity) {
+    free(batch->readBuffer);
+    batch->readBuffer = malloc(bufferCapacity);
+    if (batch->readBuffer == NULL) {
+      batch->readBufferCapacity = 0;
+      batch->submitReturnCode = AwFmAllocationFailure;
+      return AwFmAllocationFailure;
+    }
+    batch->readBufferCapacity = bufferCapacity;
+  }
+  for (size_t i = 0; i < batch->readCount; i++) {
+    batch->reads[i].buffer =
+        batch->readBuffer + (size_t)(uintptr_t)batch->reads[i].buffer;
+  }
+
+  batch->submitReturnCode =
+      awFmAsyncFileReaderSubmit(reader, batch->reads, batch->readCount);
+  batch->inFlight = batch->submitReturnCode == AwFmSuccess;
+  return batch->submitReturnCode;
+}
+
+enum AwFmReturnCode
+awFmSuffixArrayBatchFinish(const struct AwFmIndex *_RESTRICT_ const index,
+                           struct AwFmSuffixArrayBatch *_RESTRICT_ const batch,
+                           struct AwFmAsyncFileReader *_RESTRICT_ const reader) {
+  // entries of a batch that failed to submit point into reads that never
+  // happened, so there's nothing to decode.
+  if (__builtin_expect(awFmReturnCodeIsFailure(batch->submitReturnCode), 0)) {
+    const enum AwFmReturnCode submitReturnCode = batch->submitReturnCode;
+    batch->entryCount = 0;
+    batch->readCount = 0;
+    batch->submitReturnCode = AwFmSuccess;
+    return submitReturnCode;
+  }
+
+  enum AwFmReturnCode returnCode = AwFmFileReadOkay;
+  if (batch->inFlight) {
+    returnCode = awFmAsyncFileReaderWait(reader);
+    batch->inFlight = false;
+  }
+
+  if (returnCode == AwFmFileReadOkay) {
+    const uint8_t valueBitWidth = index->suffixArray.valueBitWidth;
+    for (size_t i = 0; i < batch->entryCount; i++) {
+      const struct AwFmSuffixArrayBatchEntry *entry = &batch->entries[i];
+      if (entry->bufferOffset == AW_FM_SA_BATCH_CACHED_ENTRY) {
+        continue;
+      }
+      const uint8_t bitOffset =
+          awFmGetOffsetIntoSuffixArrayByteArray(valueBitWidth,
+                                                entry->sampleIndex)
+              .bitOffset;
+      const uint64_t saValue = awFmDecodeSuffixArrayValue(
+          batch->readBuffer + entry->bufferOffset, bitOffset, valueBitWidth);
+      *entry->destination = (saValue + entry->offset) % index->bwtLength;
+    }
+
+    // reads are page-aligned, so every page they cover can go in the cache.
+    if (index->suffixArrayCache != NULL) {
+      for (size_t i = 0; i < batch->readCount; i++) {
+        const struct AwFmAsyncReadRequest *read = &batch->reads[i];
+        for (size_t pageOffset = 0; pageOffset < read->length;
+             pageOffset += AW_FM_SA_BATCH_PAGE_SIZE) {
+          awFmPageCacheInsert(index->suffixArrayCache,
+                              read->fileOffset + pageOffset,
+                              read->buffer + pageOffset);
+        }
+      }
+    }
+  }
+
+  batch->entryCount = 0;
+  batch->readCount = 0;
+  return returnCode;
+}
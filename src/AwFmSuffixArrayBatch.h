@@ -0,0 +1,109 @@
+#ifndef AW_FM_SUFFIX_ARRAY_BATCH_H
+#define AW_FM_SUFFIX_ARRAY_BATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "AwFmAsyncRead.h"
+#include "AwFmIndex.h"
+
+/*A single sampled suffix array value to fetch from the index file. When the
+ * batch finishes, (value + offset) % bwtLength is written to destination.
+ * Entries found in the index's suffix array cache are resolved on submit, and
+ * have a bufferOffset of SIZE_MAX.*/
+struct AwFmSuffixArrayBatchEntry {
+  uint64_t sampleIndex;
+  uint64_t offset;
+  uint64_t *destination;
+  size_t bufferOffset;
+};
+
+/*Collects sampled suffix array reads for an index whose suffix array is kept
+ * on disk. On submit, the entries are sorted and coalesced into page-aligned
+ * reads, so hits that share a page of the suffix array only cost one read.*/
+struct AwFmSuffixArrayBatch {
+  struct AwFmSuffixArrayBatchEntry *entries;
+  size_t entryCount;
+  size_t entryCapacity;
+  struct AwFmAsyncReadRequest *reads;
+  size_t readCount;
+  size_t readCapacity;
+  uint8_t *readBuffer;
+  size_t readBufferCapacity;
+  bool inFlight;
+  // result of the last submit, returned by finish if the submit failed.
+  enum AwFmReturnCode submitReturnCode;
+};
+
+/*
+ * Function:  awFmSuffixArrayBatchInit
+ * --------------------
+ * Initializes an empty batch. No memory is allocated until entries are added.
+ */
+void awFmSuffixArrayBatchInit(
+    struct AwFmSuffixArrayBatch *_RESTRICT_ const batch);
+
+/*
+ * Function:  awFmSuffixArrayBatchDealloc
+ * --------------------
+ * Frees the memory owned by the batch. The batch must not be in flight.
+ */
+void awFmSuffixArrayBatchDealloc(
+    struct AwFmSuffixArrayBatch *_RESTRICT_ const batch);
+
+/*
+ * Function:  awFmSuffixArrayBatchAdd
+ * --------------------
+ * Adds a sampled position to the batch.
+ *
+ *  Inputs:
+ *    batch:        Batch that isn't currently in flight.
+ *    backtrace:    Sampled BWT position, and the offset accumulated while
+ *      backtracing to it.
+ *    destination:  Where to write the resulting sequence position.
+ *
+ *  Returns:
+ *    AwFmSuccess, or AwFmAllocationFailure if the batch could not grow.
+ */
+enum AwFmReturnCode
+awFmSuffixArrayBatchAdd(const struct AwFmIndex *_RESTRICT_ const index,
+                        struct AwFmSuffixArrayBatch *_RESTRICT_ const batch,
+                        const struct AwFmBacktrace *_RESTRICT_ const backtrace,
+                        uint64_t *const destination);
+
+/*
+ * Function:  awFmSuffixArrayBatchSubmit
+ * --------------------
+ * Coalesces the batch's entries into page-aligned reads and starts reading
+ * them with the given reader. The caller is free to do other work until
+ * awFmSuffixArrayBatchFinish is called. Empty batches aren't submitted. If the
+ * index has a suffix array cache, entries on cached pages are written to their
+ * destinations immediately instead of being read.
+ *
+ *  Returns:
+ *    AwFmSuccess, AwFmAllocationFailure if the read list couldn't be
+ *      allocated, or AwFmGeneralFailure if the reader was busy.
+ */
+enum AwFmReturnCode
+awFmSuffixArrayBatchSubmit(const struct AwFmIndex *_RESTRICT_ const index,
+                           struct AwFmSuffixArrayBatch *_RESTRICT_ const batch,
+                           struct AwFmAsyncFileReader *_RESTRICT_ const reader);
+
+/*
+ * Function:  awFmSuffixArrayBatchFinish
+ * --------------------
+ * Waits for a submitted batch's reads, writes every entry's sequence position
+ * to its destination, and empties the batch so it can be reused. Pages read
+ * by the batch are added to the index's suffix array cache, if it has one.
+ *
+ *  Returns:
+ *    AwFmFileReadOkay on success, AwFmFileReadFail if any read failed, or the
+ *      error from awFmSuffixArrayBatchSubmit if the batch failed to submit, in
+ *      which case no destinations are written.
+ */
+enum AwFmReturnCode
+awFmSuffixArrayBatchFinish(const struct AwFmIndex *_RESTRICT_ const index,
+                           struct AwFmSuffixArrayBatch *_RESTRICT_ const batch,
+                           struct AwFmAsyncFileReader *_RESTRICT_ const reader);
+
+#endif /* end of include guard: AW_FM_SUFFIX_ARRAY_BATCH_H */
@@ -0,0 +1,482 @@
+#include "AwFmSuffixSort.h"
+#include <omp.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// groups this small are insertion sorted.
+#define AW_FM_SUFFIX_SORT_INSERTION_SORT_MAX 16
+// groups at least this large are sorted and split by every thread together.
+#define AW_FM_SUFFIX_SORT_PARALLEL_GROUP_MIN (1 << 20)
+#define AW_FM_SUFFIX_SORT_SERIAL_RADIX_BITS 8
+#define AW_FM_SUFFIX_SORT_PARALLEL_RADIX_BITS 11
+#define AW_FM_SUFFIX_SORT_INITIAL_GROUP_CAPACITY 1024
+#define AW_FM_SUFFIX_SORT_UNKNOWN_HEAD UINT64_MAX
+
+// a run of positions in the suffix array whose suffixes share a prefix.
+struct AwFmSuffixSortGroup {
+  uint64_t start;
+  uint64_t length;
+};
+
+struct AwFmSuffixSortGroupList {
+  struct AwFmSuffixSortGroup *groups;
+  size_t count;
+  size_t capacity;
+};
+
+struct AwFmSuffixSortState {
+  uint64_t *suffixArray;
+  // for each text position, the suffix array position where its group
+  // starts. Once a suffix is alone in its group, this is its final rank.
+  uint64_t *rank;
+  // radix sort buffer, then the new group start of each suffix array position.
+  uint64_t *scratch;
+  uint64_t length;
+  // suffixes in a group are ordered by the rank of the suffix this far ahead.
+  uint64_t offset;
+  // one list of newly found groups per thread.
+  struct AwFmSuffixSortGroupList *nextGroups;
+  uint32_t numThreads;
+  bool allocationFailed;
+};
+
+static inline uint64_t
+awFmSuffixSortKey(const struct AwFmSuffixSortState *_RESTRICT_ const state,
+                  const uint64_t suffix) {
+  const uint64_t keyPosition = suffix + state->offset;
+  // a suffix that ends before the offset is shorter, so it sorts first.
+  return keyPosition < state->length ? state->rank[keyPosition] + 1 : 0;
+}
+
+static void
+awFmSuffixSortAppendGroup(struct AwFmSuffixSortState *_RESTRICT_ const state,
+                          struct AwFmSuffixSortGroupList *_RESTRICT_ const list,
+                          const uint64_t start, const uint64_t length) {
+  if (__builtin_expect(list->count == list->capacity, 0)) {
+    const size_t newCapacity = list->capacity == 0
+                                   ? AW_FM_SUFFIX_SORT_INITIAL_GROUP_CAPACITY
+                                   : list->capacity * 2;
+    void *newGroups =
+        realloc(list->groups, newCapacity * sizeof(struct AwFmSuffixSortGroup));
+    if (newGroups == NULL) {
+#pragma omp atomic write
+      state->allocationFailed = true;
+      return;
+    }
+    list->groups = newGroups;
+    list->capacity = newCapacity;
+  }
+  list->groups[list->count].start = start;
+  list->groups[list->count].length = length;
+  list->count++;
+}
+
+static void awFmSuffixSortSerial(struct AwFmSuffixSortState *_RESTRICT_ const state,
+                                 const struct AwFmSuffixSortGroup *group) {
+  uint64_t *_RESTRICT_ const suffixes = state->suffixArray + group->start;
+  const uint64_t length = group->length;
+
+  if (length <= AW_FM_SUFFIX_SORT_INSERTION_SORT_MAX) {
+    uint64_t keys[AW_FM_SUFFIX_SORT_INSERTION_SORT_MAX];
+    for (uint64_t i = 0; i < length; i++) {
+      keys[i] = awFmSuffixSortKey(state, suffixes[i]);
+    }
+    for (uint64_t i = 1; i < length; i++) {
+      const uint64_t key = keys[i];
+      const uint64_t suffix = suffixes[i];
+      uint64_t j = i;
+      while (j > 0 && keys[j - 1] > key) {
+        keys[j] = keys[j - 1];
+        suffixes[j] = suffixes[j - 1];
+        j--;
+      }
+      keys[j] = key;
+      suffixes[j] = suffix;
+    }
+    return;
+  }
+
+  uint64_t minKey = UINT64_MAX;
+  uint64_t maxKey = 0;
+  for (uint64_t i = 0; i < length; i++) {
+    const uint64_t key = awFmSuffixSortKey(state, suffixes[i]);
+    minKey = key < minKey ? key : minKey;
+    maxKey = key > maxKey ? key : maxKey;
+  }
+  if (minKey == maxKey) {
+    return;
+  }
+
+  // lsd radix sort on the bits that actually differ within the group.
+  const uint8_t significantBits = 64 - __builtin_clzll(maxKey - minKey);
+  const uint32_t numBuckets = 1 << AW_FM_SUFFIX_SORT_SERIAL_RADIX_BITS;
+  uint64_t *source = suffixes;
+  uint64_t *destination = state->scratch + group->start;
+  for (uint8_t shift = 0; shift < significantBits;
+       shift += AW_FM_SUFFIX_SORT_SERIAL_RADIX_BITS) {
+    uint64_t bucketOffsets[1 << AW_FM_SUFFIX_SORT_SERIAL_RADIX_BITS] = {0};
+    for (uint64_t i = 0; i < length; i++) {
+      const uint64_t key = awFmSuffixSortKey(state, source[i]) - minKey;
+      bucketOffsets[(key >> shift) & (numBuckets - 1)]++;
+    }
+    uint64_t offset = 0;
+    for (uint32_t bucket = 0; bucket < numBuckets; bucket++) {
+      const uint64_t bucketCount = bucketOffsets[bucket];
+      bucketOffsets[bucket] = offset;
+      offset += bucketCount;
+    }
+    for (uint64_t i = 0; i < length; i++) {
+      const uint64_t key = awFmSuffixSortKey(state, source[i]) - minKey;
+      destination[bucketOffsets[(key >> shift) & (numBuckets - 1)]++] =
+          source[i];
+    }
+    uint64_t *swap = source;
+    source = destination;
+    destination = swap;
+  }
+  if (source != suffixes) {
+    memcpy(suffixes, source, length * sizeof(uint64_t));
+  }
+}
+
+// records the start of each position's new group in the scratch array, and
+// lists the new groups that still hold more than one suffix.
+static void awFmSuffixSortSplitSerial(
+    struct AwFmSuffixSortState *_RESTRICT_ const state,
+    const struct AwFmSuffixSortGroup *group,
+    struct AwFmSuffixSortGroupList *_RESTRICT_ const list) {
+  const uint64_t *_RESTRICT_ const suffixes = state->suffixArray;
+  uint64_t *_RESTRICT_ const groupStarts = state->scratch;
+  const uint64_t groupEnd = group->start + group->length;
+
+  uint64_t currentStart = group->start;
+  uint64_t currentKey = awFmSuffixSortKey(state, suffixes[group->start]);
+  groupStarts[group->start] = currentStart;
+  for (uint64_t i = group->start + 1; i < groupEnd; i++) {
+    const uint64_t key = awFmSuffixSortKey(state, suffixes[i]);
+    if (key != currentKey) {
+      if (i - currentStart > 1) {
+        awFmSuffixSortAppendGroup(state, list, currentStart, i - currentStart);
+      }
+      currentStart = i;
+      currentKey = key;
+    }
+    groupStarts[i] = currentStart;
+  }
+  if (groupEnd - currentStart > 1) {
+    awFmSuffixSortAppendGroup(state, list, currentStart,
+                              groupEnd - currentStart);
+  }
+}
+
+static void
+awFmSuffixSortParallel(struct AwFmSuffixSortState *_RESTRICT_ const state,
+                       const struct AwFmSuffixSortGroup *group) {
+  uint64_t *const suffixes = state->suffixArray + group->start;
+  const uint64_t length = group->length;
+
+  uint64_t minKey = UINT64_MAX;
+  uint64_t maxKey = 0;
+#pragma omp parallel for num_threads(state->numThreads)                       \
+    reduction(min : minKey) reduction(max : maxKey)
+  for (uint64_t i = 0; i < length; i++) {
+    const uint64_t key = awFmSuffixSortKey(state, suffixes[i]);
+    minKey = key < minKey ? key : minKey;
+    maxKey = key > maxKey ? key : maxKey;
+  }
+  if (minKey == maxKey) {
+    return;
+  }
+
+  const uint32_t numBuckets = 1 << AW_FM_SUFFIX_SORT_PARALLEL_RADIX_BITS;
+  uint64_t *bucketOffsets =
+      malloc((size_t)state->numThreads * numBuckets * sizeof(uint64_t));
+  if (bucketOffsets == NULL) {
+    state->allocationFailed = true;
+    return;
+  }
+
+  const uint8_t significantBits = 64 - __builtin_clzll(maxKey - minKey);
+  uint64_t *source = suffixes;
+  uint64_t *destination = state->scratch + group->start;
+  for (uint8_t shift = 0; shift < significantBits;
+       shift += AW_FM_SUFFIX_SORT_PARALLEL_RADIX_BITS) {
+#pragma omp parallel num_threads(state->numThreads)
+    {
+      const uint32_t threadIndex = omp_get_thread_num();
+      const uint32_t threadCount = omp_get_num_threads();
+      const uint64_t chunkStart = (length * threadIndex) / threadCount;
+      const uint64_t chunkEnd = (length * (threadIndex + 1)) / threadCount;
+      uint64_t *threadOffsets = bucketOffsets + (threadIndex * numBuckets);
+      memset(threadOffsets, 0, numBuckets * sizeof(uint64_t));
+
+      for (uint64_t i = chunkStart; i < chunkEnd; i++) {
+        const uint64_t key = awFmSuffixSortKey(state, source[i]) - minKey;
+        threadOffsets[(key >> shift) & (numBuckets - 1)]++;
+      }
+
+#pragma omp barrier
+#pragma omp single
+      {
+        // each thread scatters its elements of a bucket after the elements
+        // of the threads before it, which keeps the sort stable.
+        uint64_t offset = 0;
+        for (uint32_t bucket = 0; bucket < numBuckets; bucket++) {
+          for (uint32_t thread = 0; thread < threadCount; thread++) {
+            const uint64_t count = bucketOffsets[thread * numBuckets + bucket];
+            bucketOffsets[thread * numBuckets + bucket] = offset;
+            offset += count;
+          }
+        }
+      }
+
+      for (uint64_t i = chunkStart; i < chunkEnd; i++) {
+        const uint64_t key = awFmSuffixSortKey(state, source[i]) - minKey;
+        destination[threadOffsets[(key >> shift) & (numBuckets - 1)]++] =
+            source[i];
+      }
+    }
+    uint64_t *swap = source;
+    source = destination;
+    destination = swap;
+  }
+  free(bucketOffsets);
+
+  if (source != suffixes) {
+#pragma omp parallel for num_threads(state->numThreads)
+    for (uint64_t i = 0; i < length; i++) {
+      suffixes[i] = source[i];
+    }
+  }
+}
+
+static void
+awFmSuffixSortSplitParallel(struct AwFmSuffixSortState *_RESTRICT_ const state,
+                            const struct AwFmSuffixSortGroup *group) {
+  const uint64_t *_RESTRICT_ const suffixes = state->suffixArray;
+  uint64_t *_RESTRICT_ const groupStarts = state->scratch;
+  const uint64_t groupEnd = group->start + group->length;
+  uint64_t *lastChunkStarts = malloc(state->numThreads * sizeof(uint64_t));
+  if (lastChunkStarts == NULL) {
+    state->allocationFailed = true;
+    return;
+  }
+
+#pragma omp parallel num_threads(state->numThreads)
+  {
+    const uint32_t threadIndex = omp_get_thread_num();
+    const uint32_t threadCount = omp_get_num_threads();
+    const uint64_t chunkStart =
+        group->start + (group->length * threadIndex) / threadCount;
+    const uint64_t chunkEnd =
+        group->start + (group->length * (threadIndex + 1)) / threadCount;
+
+    // mark the new group starts inside this chunk. Positions before the
+    // chunk's first group start belong to a group from an earlier chunk.
+    uint64_t currentStart = AW_FM_SUFFIX_SORT_UNKNOWN_HEAD;
+    for (uint64_t i = chunkStart; i < chunkEnd; i++) {
+      if (i == group->start ||
+          awFmSuffixSortKey(state, suffixes[i]) !=
+              awFmSuffixSortKey(state, suffixes[i - 1])) {
+        currentStart = i;
+      }
+      groupStarts[i] = currentStart;
+    }
+    lastChunkStarts[threadIndex] = currentStart;
+
+#pragma omp barrier
+    uint64_t carriedStart = AW_FM_SUFFIX_SORT_UNKNOWN_HEAD;
+    for (uint32_t thread = threadIndex; thread > 0 &&
+                                        carriedStart ==
+                                            AW_FM_SUFFIX_SORT_UNKNOWN_HEAD;
+         thread--) {
+      carriedStart = lastChunkStarts[thread - 1];
+    }
+    for (uint64_t i = chunkStart;
+         i < chunkEnd && groupStarts[i] == AW_FM_SUFFIX_SORT_UNKNOWN_HEAD;
+         i++) {
+      groupStarts[i] = carriedStart;
+    }
+
+#pragma omp barrier
+    // each thread lists the groups that start in its chunk.
+    struct AwFmSuffixSortGroupList *list = &state->nextGroups[threadIndex];
+    for (uint64_t i = chunkStart; i < chunkEnd; i++) {
+      if (groupStarts[i] == i) {
+        uint64_t end = i + 1;
+        while (end < groupEnd && groupStarts[end] == i) {
+          end++;
+        }
+        if (end - i > 1) {
+          awFmSuffixSortAppendGroup(state, list, i, end - i);
+        }
+        i = end - 1;
+      }
+    }
+  }
+  free(lastChunkStarts);
+}
+
+static void
+awFmSuffixSortRefineGroups(struct AwFmSuffixSortState *_RESTRICT_ const state,
+                           const struct AwFmSuffixSortGroupList *groups) {
+  const bool useParallelGroups = state->numThreads > 1;
+
+  // very large groups would serialize the loop below, so all threads work on
+  // them one at a time instead.
+  if (useParallelGroups) {
+    for (size_t i = 0; i < groups->count; i++) {
+      if (groups->groups[i].length >= AW_FM_SUFFIX_SORT_PARALLEL_GROUP_MIN) {
+        awFmSuffixSortParallel(state, &groups->groups[i]);
+        awFmSuffixSortSplitParallel(state, &groups->groups[i]);
+      }
+    }
+  }
+
+#pragma omp parallel for schedule(dynamic, 16) num_threads(state->numThreads)
+  for (size_t i = 0; i < groups->count; i++) {
+    const struct AwFmSuffixSortGroup *group = &groups->groups[i];
+    if (!useParallelGroups ||
+        group->length < AW_FM_SUFFIX_SORT_PARALLEL_GROUP_MIN) {
+      awFmSuffixSortSerial(state, group);
+      awFmSuffixSortSplitSerial(state, group,
+                                &state->nextGroups[omp_get_thread_num()]);
+    }
+  }
+
+  // ranks can only change once every group has been split, since the split
+  // reads the ranks of suffixes in other groups.
+#pragma omp parallel for schedule(dynamic, 16) num_threads(state->numThreads)
+  for (size_t i = 0; i < groups->count; i++) {
+    const struct AwFmSuffixSortGroup *group = &groups->groups[i];
+    for (uint64_t j = group->start; j < group->start + group->length; j++) {
+      state->rank[state->suffixArray[j]] = state->scratch[j];
+    }
+  }
+}
+
+enum AwFmReturnCode
+awFmParallelSuffixSort(const uint8_t *_RESTRICT_ const text,
+                       uint64_t *_RESTRICT_ const suffixArray,
+                       const uint64_t length) {
+  if (length <= 1) {
+    if (length == 1) {
+      suffixArray[0] = 0;
+    }
+    return AwFmSuccess;
+  }
+
+  struct AwFmSuffixSortState state = {.suffixArray = suffixArray,
+                                      .length = length,
+                                      .offset = 0,
+                                      .numThreads = omp_get_max_threads(),
+                                      .allocationFailed = false};
+  state.rank = malloc(length * sizeof(uint64_t));
+  state.scratch = malloc(length * sizeof(uint64_t));
+  state.nextGroups =
+      calloc(state.numThreads, sizeof(struct AwFmSuffixSortGroupList));
+  struct AwFmSuffixSortGroupList groups = {0};
+  if (state.rank == NULL || state.scratch == NULL || state.nextGroups == NULL) {
+    free(state.rank);
+    free(state.scratch);
+    free(state.nextGroups);
+    return AwFmAllocationFailure;
+  }
+
+  // give each character in the text a dense code, with 0 reserved for
+  // positions past the end, so as many characters as possible fit in a key.
+  bool characterPresent[256] = {false};
+#pragma omp parallel num_threads(state.numThreads)
+  {
+    bool threadCharacterPresent[256] = {false};
+#pragma omp for
+    for (uint64_t i = 0; i < length; i++) {
+      threadCharacterPresent[text[i]] = true;
+    }
+#pragma omp critical
+    for (uint16_t character = 0; character < 256; character++) {
+      characterPresent[character] |= threadCharacterPresent[character];
+    }
+  }
+  uint8_t characterCodes[256] = {0};
+  uint16_t numCharacters = 0;
+  for (uint16_t character = 0; character < 256; character++) {
+    if (characterPresent[character]) {
+      characterCodes[character] = ++numCharacters;
+    }
+  }
+  const uint8_t bitsPerCharacter = 32 - __builtin_clz(numCharacters);
+  // keys are kept below 2^63, so adding one in awFmSuffixSortKey can't wrap.
+  const uint8_t charactersPerKey = 63 / bitsPerCharacter;
+  const uint64_t keyMask =
+      (1ULL << (bitsPerCharacter * charactersPerKey)) - 1;
+
+  // the initial keys are the suffixes' leading characters, packed together.
+#pragma omp parallel num_threads(state.numThreads)
+  {
+    const uint32_t threadIndex = omp_get_thread_num();
+    const uint32_t threadCount = omp_get_num_threads();
+    const uint64_t chunkStart = (length * threadIndex) / threadCount;
+    const uint64_t chunkEnd = (length * (threadIndex + 1)) / threadCount;
+    uint64_t key = 0;
+    if (chunkStart < chunkEnd) {
+      for (uint8_t i = 0; i < charactersPerKey - 1; i++) {
+        const uint64_t position = chunkStart + i;
+        key = (key << bitsPerCharacter) |
+              (position < length ? characterCodes[text[position]] : 0);
+      }
+    }
+    for (uint64_t i = chunkStart; i < chunkEnd; i++) {
+      const uint64_t lastPosition = i + charactersPerKey - 1;
+      key = ((key << bitsPerCharacter) |
+             (lastPosition < length ? characterCodes[text[lastPosition]] : 0)) &
+            keyMask;
+      state.rank[i] = key;
+      suffixArray[i] = i;
+    }
+  }
+
+  awFmSuffixSortAppendGroup(&state, &groups, 0, length);
+  uint64_t sortedPrefixLength = charactersPerKey;
+  while (groups.count > 0 && !state.allocationFailed) {
+    awFmSuffixSortRefineGroups(&state, &groups);
+
+    // gather the groups that are still unsorted for the next round.
+    size_t nextGroupCount = 0;
+    for (uint32_t thread = 0; thread < state.numThreads; thread++) {
+      nextGroupCount += state.nextGroups[thread].count;
+    }
+    if (nextGroupCount > groups.capacity) {
+      void *newGroups =
+          realloc(groups.groups,
+                  nextGroupCount * sizeof(struct AwFmSuffixSortGroup));
+      if (newGroups == NULL) {
+        state.allocationFailed = true;
+        break;
+      }
+      groups.groups = newGroups;
+      groups.capacity = nextGroupCount;
+    }
+    groups.count = 0;
+    for (uint32_t thread = 0; thread < state.numThreads; thread++) {
+      memcpy(groups.groups + groups.count, state.nextGroups[thread].groups,
+             state.nextGroups[thread].count *
+                 sizeof(struct AwFmSuffixSortGroup));
+      groups.count += state.nextGroups[thread].count;
+      state.nextGroups[thread].count = 0;
+    }
+
+    state.offset = sortedPrefixLength;
+    sortedPrefixLength *= 2;
+  }
+
+  for (uint32_t thread = 0; thread < state.numThreads; thread++) {
+    free(state.nextGroups[thread].groups);
+  }
+  free(state.nextGroups);
+  free(groups.groups);
+  free(state.rank);
+  free(state.scratch);
+  return state.allocationFailed ? AwFmAllocationFailure : AwFmSuccess;
+}
@@ -0,0 +1,36 @@
+#ifndef AW_FM_SUFFIX_SORT_H
+#define AW_FM_SUFFIX_SORT_H
+
+#include <stdint.h>
+#include "AwFmIndex.h"
+
+/*
+ * Function:  awFmParallelSuffixSort
+ * --------------------
+ * Builds the suffix array of the text with a multithreaded prefix-doubling
+ * sort. Suffixes are first bucketed by their leading characters, then groups
+ * of suffixes that still share a prefix are refined by the rank of the suffix
+ * h positions later, doubling h each round, until every group is a single
+ * suffix. Large groups are radix sorted by all threads together, and small
+ * groups are sorted concurrently.
+ *
+ * This is the suffix sorting backend used by index creation when the library
+ * is built with AW_FM_PARALLEL_SUFFIX_SORT defined. It produces the same suffix
+ * array as divsufsort64, but needs roughly 24 bytes of memory per position
+ * (plus the list of unsorted groups), compared to about 9 for divsufsort64.
+ *
+ *  Inputs:
+ *    text:         Text to sort.
+ *    suffixArray:  Array of length elements to write the suffix array to.
+ *    length:       Length of the text.
+ *
+ *  Returns:
+ *    AwFmSuccess, or AwFmAllocationFailure if working memory could not be
+ *      allocated.
+ */
+enum AwFmReturnCode
+awFmParallelSuffixSort(const uint8_t *_RESTRICT_ const text,
+                       uint64_t *_RESTRICT_ const suffixArray,
+                       const uint64_t length);
+
+#endif /* end of include guard: AW_FM_SUFFIX_SORT_H */
@@ -0,0 +1,283 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "AwFmDiskBwt.h"
+#include "AwFmIndex.h"
+#include "AwFmIndexStruct.h"
+#include "AwFmLetter.h"
+#include "AwFmNuma.h"
+#include "AwFmSearch.h"
+
+#define AW_FM_NUM_READING_FRAMES 6
+
+// the standard genetic code, indexed by the letter indices of a codon's
+// nucleotides as a base 4 number. Stop codons are the ambiguity letter, so
+// no kmer spans one.
+static const char codonAminoAcids[64] = "knknttttrsrsiimiqhqhpppprrrrllll"
+                                        "ededaaaaggggvvvvxyxyssssxcwclflf";
+
+// per-thread buffers, grown to fit the longest read seen so far. The frames
+// of a read, and the range of each of their windows, take at most twice the
+// read's length plus a separator per frame.
+struct AwFmTranslationScratch {
+  uint8_t *letterIndices;
+  char *frames;
+  struct AwFmSearchRange *ranges;
+  size_t readCapacity;
+  uint64_t *positions;
+  uint64_t *offsets;
+  size_t positionCapacity;
+};
+
+static bool translationScratchReserve(
+    struct AwFmTranslationScratch *_RESTRICT_ const scratch,
+    const size_t readLength) {
+  if (readLength <= scratch->readCapacity) {
+    return true;
+  }
+  const size_t framesLength = (2 * readLength) + AW_FM_NUM_READING_FRAMES;
+  uint8_t *letterIndices = realloc(scratch->letterIndices, readLength);
+  if (letterIndices == NULL) {
+    return false;
+  }
+  scratch->letterIndices = letterIndices;
+  char *frames = realloc(scratch->frames, framesLength);
+  if (frames == NULL) {
+    return false;
+  }
+  scratch->frames = frames;
+  struct AwFmSearchRange *ranges = realloc(
+      scratch->ranges, framesLength * sizeof(struct AwFmSearchRange));
+  if (ranges == NULL) {
+    return false;
+  }
+  scratch->ranges = ranges;
+  scratch->readCapacity = readLength;
+  return true;
+}
+
+static bool positionScratchReserve(
+    struct AwFmTranslationScratch *_RESTRICT_ const scratch,
+    const size_t numPositions) {
+  if (numPositions <= scratch->positionCapacity) {
+    return true;
+  }
+  uint64_t *positions =
+      realloc(scratch->positions, numPositions * sizeof(uint64_t));
+  if (positions == NULL) {
+    return false;
+  }
+  scratch->positions = positions;
+  uint64_t *offsets =
+      realloc(scratch->offsets, numPositions * sizeof(uint64_t));
+  if (offsets == NULL) {
+    return false;
+  }
+  scratch->offsets = offsets;
+  scratch->positionCapacity = numPositions;
+  return true;
+}
+
+static void translationScratchDealloc(
+    struct AwFmTranslationScratch *_RESTRICT_ scratch) {
+  free(scratch->letterIndices);
+  free(scratch->frames);
+  free(scratch->ranges);
+  free(scratch->positions);
+  free(scratch->offsets);
+}
+
+// translates the read's six frames into frames, one after another, each
+// followed by an ambiguity letter. Frame i starts at frameStarts[i], and
+// frameStarts[6] is the length of all of them. The codon starting at each
+// read position belongs to forward frame position % 3, and its reverse
+// complement is the codon starting at readLength - 3 - position of the
+// reverse complement, so both are translated from the same three letters.
+static uint64_t translateSixFrames(const char *_RESTRICT_ const read,
+                                   const uint64_t readLength,
+                                   uint8_t *_RESTRICT_ const letterIndices,
+                                   char *_RESTRICT_ const frames,
+                                   uint64_t *_RESTRICT_ const frameStarts) {
+  awFmNucleotidesToLetterIndices((const uint8_t *)read, letterIndices,
+                                 readLength);
+  frameStarts[0] = 0;
+  for (uint8_t frame = 0; frame < AW_FM_NUM_READING_FRAMES; frame++) {
+    const uint64_t offset = frame % 3;
+    const uint64_t frameLength =
+        readLength > offset ? (readLength - offset) / 3 : 0;
+    frames[frameStarts[frame] + frameLength] = 'x';
+    frameStarts[frame + 1] = frameStarts[frame] + frameLength + 1;
+  }
+
+  for (uint64_t position = 0; position + 3 <= readLength; position++) {
+    const uint8_t first = letterIndices[position];
+    const uint8_t second = letterIndices[position + 1];
+    const uint8_t third = letterIndices[position + 2];
+    char forwardAminoAcid = 'x';
+    char reverseAminoAcid = 'x';
+    // the ambiguity letter index is the only one with bit 2 set.
+    if (__builtin_expect((first | second | third) < 4, 1)) {
+      forwardAminoAcid = codonAminoAcids[(first << 4) | (second << 2) | third];
+      reverseAminoAcid =
+          codonAminoAcids[63 - ((third << 4) | (second << 2) | first)];
+    }
+    frames[frameStarts[position % 3] + (position / 3)] = forwardAminoAcid;
+    const uint64_t reversePosition = readLength - 3 - position;
+    frames[frameStarts[3 + (reversePosition % 3)] + (reversePosition / 3)] =
+        reverseAminoAcid;
+  }
+  return frameStarts[AW_FM_NUM_READING_FRAMES];
+}
+
+static enum AwFmReturnCode
+searchRead(const struct AwFmIndex *_RESTRICT_ const threadIndex,
+           const struct AwFmIndex *_RESTRICT_ const index,
+           struct AwFmTranslatedSearchData *_RESTRICT_ const searchData,
+           const uint64_t kmerLength,
+           struct AwFmTranslationScratch *_RESTRICT_ const scratch) {
+  searchData->count = 0;
+  const uint64_t readLength = searchData->readLength;
+  if (readLength < 3 * kmerLength) {
+    return AwFmSuccess;
+  }
+  if (!translationScratchReserve(scratch, readLength)) {
+    return AwFmAllocationFailure;
+  }
+  uint64_t frameStarts[AW_FM_NUM_READING_FRAMES + 1];
+  const uint64_t framesLength =
+      translateSixFrames(searchData->readString, readLength,
+                         scratch->letterIndices, scratch->frames, frameStarts);
+
+  // windows that span two frames include a separator, so they're never
+  // searched.
+  const uint64_t numWindows = framesLength - kmerLength + 1;
+  struct AwFmSearchRange *ranges = scratch->ranges;
+  awFmFindWindowRanges(threadIndex, scratch->frames, kmerLength, 0,
+                       numWindows, ranges);
+
+  uint64_t numHits = 0;
+  uint64_t longestRangeLength = 0;
+  for (uint64_t window = 0; window < numWindows; window++) {
+    const uint64_t rangeLength = awFmSearchRangeLength(&ranges[window]);
+    numHits += rangeLength;
+    longestRangeLength =
+        rangeLength > longestRangeLength ? rangeLength : longestRangeLength;
+  }
+  if (numHits > UINT32_MAX) {
+    return AwFmAllocationFailure;
+  }
+  if (numHits > searchData->capacity) {
+    struct AwFmTranslatedHit *hits = realloc(
+        searchData->hits, numHits * sizeof(struct AwFmTranslatedHit));
+    if (hits == NULL) {
+      return AwFmAllocationFailure;
+    }
+    searchData->hits = hits;
+    searchData->capacity = numHits;
+  }
+  if (!positionScratchReserve(scratch, longestRangeLength)) {
+    return AwFmAllocationFailure;
+  }
+
+  uint8_t frame = 0;
+  for (uint64_t window = 0; window < numWindows; window++) {
+    while (window >= frameStarts[frame + 1]) {
+      frame++;
+    }
+    const uint64_t rangeLength = awFmSearchRangeLength(&ranges[window]);
+    if (rangeLength == 0) {
+      continue;
+    }
+    if (__builtin_expect(awFmFindDatabaseHitPositionsToArray(
+                             index, &ranges[window], scratch->positions,
+                             scratch->offsets) != AwFmFileReadOkay,
+                         0)) {
+      return AwFmFileReadFail;
+    }
+
+    const uint64_t framePosition = window - frameStarts[frame];
+    const uint64_t readPosition =
+        frame < 3
+            ? frame + (3 * framePosition)
+            : readLength - (frame - 3) - (3 * (framePosition + kmerLength));
+    for (uint64_t i = 0; i < rangeLength; i++) {
+      searchData->hits[searchData->count++] =
+          (struct AwFmTranslatedHit){.databasePosition = scratch->positions[i],
+                                     .readPosition = readPosition,
+                                     .frame = frame};
+    }
+  }
+  return AwFmSuccess;
+}
+
+struct AwFmTranslatedSearchList *
+awFmCreateTranslatedSearchList(const size_t capacity) {
+  struct AwFmTranslatedSearchList *searchList =
+      malloc(sizeof(struct AwFmTranslatedSearchList));
+  if (searchList == NULL) {
+    return NULL;
+  }
+  searchList->capacity = capacity;
+  searchList->count = 0;
+  searchList->translatedSearchData =
+      malloc(capacity * sizeof(struct AwFmTranslatedSearchData));
+  if (searchList->translatedSearchData == NULL) {
+    free(searchList);
+    return NULL;
+  }
+  for (size_t i = 0; i < capacity; i++) {
+    searchList->translatedSearchData[i] = (struct AwFmTranslatedSearchData){
+        .readString = NULL, .readLength = 0, .hits = NULL, .count = 0,
+        .capacity = 0};
+  }
+  return searchList;
+}
+
+void awFmDeallocTranslatedSearchList(
+    struct AwFmTranslatedSearchList *_RESTRICT_ const searchList) {
+  for (size_t i = 0; i < searchList->capacity; i++) {
+    free(searchList->translatedSearchData[i].hits);
+  }
+  free(searchList->translatedSearchData);
+  free(searchList);
+}
+
+enum AwFmReturnCode awFmParallelSearchTranslated(
+    const struct AwFmIndex *_RESTRICT_ const index,
+    struct AwFmTranslatedSearchList *_RESTRICT_ const searchList,
+    const uint64_t kmerLength, uint32_t numThreads) {
+  if (kmerLength == 0) {
+    return AwFmIllegalPositionError;
+  }
+  if (index->config.alphabetType != AwFmAlphabetAmino &&
+      index->config.alphabetType != AwFmAlphabetReducedAmino) {
+    return AwFmIncompatibleIndices;
+  }
+  const size_t searchListCount = searchList->count;
+  enum AwFmReturnCode atomicReturnCode = AwFmSuccess;
+  const uint64_t bwtReadFailures = awFmDiskBwtReadFailures(index);
+
+#pragma omp parallel num_threads(numThreads > 0 ? numThreads : 1)
+  {
+    struct AwFmIndex localIndex;
+    struct AwFmNumaThreadBinding numaBinding;
+    const struct AwFmIndex *threadIndex =
+        awFmNumaBindThread(index, &localIndex, &numaBinding);
+    struct AwFmTranslationScratch scratch = {0};
+
+#pragma omp for schedule(dynamic)
+    for (size_t i = 0; i < searchListCount; i++) {
+      const enum AwFmReturnCode returnCode =
+          searchRead(threadIndex, index, &searchList->translatedSearchData[i],
+                     kmerLength, &scratch);
+      if (__builtin_expect(returnCode != AwFmSuccess, 0)) {
+#pragma omp atomic write
+        atomicReturnCode = returnCode;
+      }
+    }
+
+    translationScratchDealloc(&scratch);
+    awFmNumaUnbindThread(&numaBinding);
+  }
+  return awFmDiskBwtCheckReads(index, bwtReadFailures, atomicReturnCode);
+}
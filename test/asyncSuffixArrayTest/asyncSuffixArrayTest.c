@@ -0,0 +1,425 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/AwFmAsyncRead.h"
+#include "../../src/AwFmFile.h"
+#include "../../src/AwFmIndex.h"
+#include "../../src/AwFmIndexStruct.h"
+#include "../../src/AwFmPageCache.h"
+#include "../../src/AwFmParallelSearch.h"
+#include "../../src/AwFmSuffixArray.h"
+#include "../../src/AwFmSuffixArrayBatch.h"
+#include "../test.h"
+
+char buffer[2048];
+uint8_t nucleotideLookup[4] = {'a', 'g', 'c', 't'};
+uint8_t aminoLookup[20] = {'a', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'k', 'l',
+                           'm', 'n', 'p', 'q', 'r', 's', 't', 'v', 'w', 'y'};
+
+void testBatchedSuffixArrayReads(const bool allowIoUring);
+void testDiskSuffixArrayLocate(const enum AwFmAlphabetType alphabetType);
+void testPageCacheReads(void);
+void testSuffixArrayCache(const enum AwFmAlphabetType alphabetType);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  for (size_t i = 0; i < 4; i++) {
+    testBatchedSuffixArrayReads(true);
+    testBatchedSuffixArrayReads(false);
+    testDiskSuffixArrayLocate(AwFmAlphabetDna);
+    testDiskSuffixArrayLocate(AwFmAlphabetAmino);
+    testPageCacheReads();
+    testSuffixArrayCache(AwFmAlphabetDna);
+    testSuffixArrayCache(AwFmAlphabetAmino);
+  }
+
+  printf("async suffix array testing finished.\n");
+}
+
+struct AwFmIndex *createTestIndex(const enum AwFmAlphabetType alphabetType,
+                                  const uint8_t compressionRatio,
+                                  const bool keepSuffixArrayInMemory,
+                                  const uint8_t *sequence,
+                                  const size_t sequenceLength) {
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = compressionRatio,
+      .kmerLengthInSeedTable = 4,
+      .alphabetType = alphabetType,
+      .keepSuffixArrayInMemory = keepSuffixArrayInMemory,
+      .storeOriginalSequence = false};
+  struct AwFmIndex *index;
+  enum AwFmReturnCode rc = awFmCreateIndex(
+      &index, &config, sequence, sequenceLength, "testAsyncSa.awfmi");
+  sprintf(buffer, "index creation returned error code %i.", rc);
+  testAssertString(rc > 0, buffer);
+  return index;
+}
+
+uint8_t *createSequence(const enum AwFmAlphabetType alphabetType,
+                        const size_t sequenceLength) {
+  uint8_t *sequence = malloc(sequenceLength + 1);
+  for (size_t i = 0; i < sequenceLength; i++) {
+    sequence[i] = alphabetType == AwFmAlphabetAmino
+                      ? aminoLookup[rand() % 20]
+                      : nucleotideLookup[rand() % 4];
+  }
+  sequence[sequenceLength] = 0;
+  return sequence;
+}
+
+void testBatchedSuffixArrayReads(const bool allowIoUring) {
+  const size_t sequenceLength = 5000 + rand() % 100000;
+  const uint8_t compressionRatio = 1 + rand() % 16;
+  uint8_t *sequence = createSequence(AwFmAlphabetDna, sequenceLength);
+  struct AwFmIndex *index = createTestIndex(AwFmAlphabetDna, compressionRatio,
+                                            false, sequence, sequenceLength);
+
+  struct AwFmAsyncFileReader *reader =
+      awFmAsyncFileReaderCreate(index->fileDescriptor, allowIoUring);
+  testAssertString(reader != NULL, "async file reader could not be created.");
+  if (!allowIoUring) {
+    testAssertString(!awFmAsyncFileReaderUsesIoUring(reader),
+                     "reader used io_uring when it wasn't allowed to.");
+  }
+
+  const size_t numSamples =
+      awFmGetSampledSuffixArrayLength(index->bwtLength, compressionRatio);
+  const size_t numReads = 1 + rand() % 5000;
+  uint64_t *sampleIndices = malloc(numReads * sizeof(uint64_t));
+  uint64_t *expectedPositions = malloc(numReads * sizeof(uint64_t));
+  uint64_t *batchedPositions = malloc(numReads * sizeof(uint64_t));
+
+  struct AwFmSuffixArrayBatch batch;
+  awFmSuffixArrayBatchInit(&batch);
+  for (size_t i = 0; i < numReads; i++) {
+    // include a few repeated samples, since many hits can share a sample.
+    sampleIndices[i] = (i > 0 && rand() % 8 == 0) ? sampleIndices[i - 1]
+                                                  : rand() % numSamples;
+    const struct AwFmBacktrace backtrace = {
+        .position = sampleIndices[i] * compressionRatio,
+        .offset = rand() % 32};
+    size_t saValue;
+    awFmGetSuffixArrayValueFromFile(index, sampleIndices[i], &saValue);
+    expectedPositions[i] = (saValue + backtrace.offset) % index->bwtLength;
+    enum AwFmReturnCode rc = awFmSuffixArrayBatchAdd(index, &batch, &backtrace,
+                                                     &batchedPositions[i]);
+    testAssertString(rc == AwFmSuccess, "could not add entry to batch.");
+  }
+
+  enum AwFmReturnCode rc = awFmSuffixArrayBatchSubmit(index, &batch, reader);
+  sprintf(buffer, "batch submit returned error code %i.", rc);
+  testAssertString(rc == AwFmSuccess, buffer);
+  testAssertString(batch.readCount <= numReads,
+                   "batch had more reads than entries.");
+  rc = awFmSuffixArrayBatchFinish(index, &batch, reader);
+  sprintf(buffer, "batch finish returned error code %i.", rc);
+  testAssertString(rc == AwFmFileReadOkay, buffer);
+
+  for (size_t i = 0; i < numReads; i++) {
+    sprintf(buffer,
+            "batched read %zu gave position %zu, expected %zu (io_uring %i).",
+            i, batchedPositions[i], expectedPositions[i], allowIoUring);
+    testAssertString(expectedPositions[i] == batchedPositions[i], buffer);
+  }
+
+  // the batched path of awFmReadPositionsFromSuffixArray should match the
+  // in-memory suffix array.
+  struct AwFmIndex *inMemoryIndex;
+  awFmReadIndexFromFile(&inMemoryIndex, "testAsyncSa.awfmi", true);
+  for (size_t i = 0; i < numReads; i++) {
+    expectedPositions[i] = (rand() % numSamples) * compressionRatio;
+    batchedPositions[i] = expectedPositions[i];
+  }
+  // read twice, so the second read reuses the index's pooled reader.
+  for (size_t pass = 0; pass < 2; pass++) {
+    memcpy(batchedPositions, expectedPositions, numReads * sizeof(uint64_t));
+    rc = awFmReadPositionsFromSuffixArray(index, batchedPositions, numReads);
+    testAssertString(rc == AwFmFileReadOkay,
+                     "reading positions from disk suffix array failed.");
+  }
+  awFmReadPositionsFromSuffixArray(inMemoryIndex, expectedPositions, numReads);
+  testAssertString(memcmp(expectedPositions, batchedPositions,
+                          numReads * sizeof(uint64_t)) == 0,
+                   "disk and in-memory suffix array positions did not match.");
+
+  // a batch that fails to submit shouldn't write any destinations.
+  struct AwFmSuffixArrayBatch failedBatch;
+  awFmSuffixArrayBatchInit(&failedBatch);
+  const struct AwFmBacktrace backtrace = {.position = 0, .offset = 0};
+  uint64_t failedPosition = UINT64_MAX;
+  awFmSuffixArrayBatchAdd(index, &batch, &backtrace, batchedPositions);
+  awFmSuffixArrayBatchAdd(index, &failedBatch, &backtrace, &failedPosition);
+  rc = awFmSuffixArrayBatchSubmit(index, &batch, reader);
+  testAssertString(rc == AwFmSuccess, "batch submit failed.");
+  rc = awFmSuffixArrayBatchSubmit(index, &failedBatch, reader);
+  testAssertString(rc == AwFmGeneralFailure,
+                   "submitting to a busy reader should fail.");
+  rc = awFmSuffixArrayBatchFinish(index, &failedBatch, reader);
+  testAssertString(rc == AwFmGeneralFailure,
+                   "finishing a failed batch should return its submit error.");
+  testAssertString(failedPosition == UINT64_MAX,
+                   "finishing a failed batch wrote its destination.");
+  rc = awFmSuffixArrayBatchFinish(index, &batch, reader);
+  testAssertString(rc == AwFmFileReadOkay, "batch finish failed.");
+
+  awFmSuffixArrayBatchDealloc(&failedBatch);
+  awFmSuffixArrayBatchDealloc(&batch);
+  awFmAsyncFileReaderDealloc(reader);
+  free(sampleIndices);
+  free(expectedPositions);
+  free(batchedPositions);
+  free(sequence);
+  awFmDeallocIndex(inMemoryIndex);
+  awFmDeallocIndex(index);
+}
+
+void testDiskSuffixArrayLocate(const enum AwFmAlphabetType alphabetType) {
+  const size_t sequenceLength = 5000 + rand() % 50000;
+  const uint8_t compressionRatio = 1 + rand() % 16;
+  uint8_t *sequence = createSequence(alphabetType, sequenceLength);
+  struct AwFmIndex *diskIndex = createTestIndex(
+      alphabetType, compressionRatio, false, sequence, sequenceLength);
+  struct AwFmIndex *inMemoryIndex;
+  awFmReadIndexFromFile(&inMemoryIndex, "testAsyncSa.awfmi", true);
+
+  const size_t kmerCount = 100 + rand() % 2000;
+  struct AwFmKmerSearchList *diskList = awFmCreateKmerSearchList(kmerCount);
+  struct AwFmKmerSearchList *inMemoryList = awFmCreateKmerSearchList(kmerCount);
+  diskList->count = kmerCount;
+  inMemoryList->count = kmerCount;
+  for (size_t i = 0; i < kmerCount; i++) {
+    const size_t kmerLength = 2 + rand() % 10;
+    char *kmer = malloc(kmerLength);
+    for (size_t letter = 0; letter < kmerLength; letter++) {
+      kmer[letter] = alphabetType == AwFmAlphabetAmino
+                         ? aminoLookup[rand() % 20]
+                         : nucleotideLookup[rand() % 4];
+    }
+    diskList->kmerSearchData[i].kmerString = kmer;
+    diskList->kmerSearchData[i].kmerLength = kmerLength;
+    inMemoryList->kmerSearchData[i].kmerString = kmer;
+    inMemoryList->kmerSearchData[i].kmerLength = kmerLength;
+  }
+
+  for (uint32_t numThreads = 1; numThreads < 6; numThreads++) {
+    enum AwFmReturnCode rc =
+        awFmParallelSearchLocate(diskIndex, diskList, numThreads);
+    sprintf(buffer, "disk suffix array locate returned error code %i.", rc);
+    testAssertString(rc > 0, buffer);
+    awFmParallelSearchLocate(inMemoryIndex, inMemoryList, numThreads);
+
+    for (size_t i = 0; i < kmerCount; i++) {
+      const struct AwFmKmerSearchData *diskData = &diskList->kmerSearchData[i];
+      const struct AwFmKmerSearchData *inMemoryData =
+          &inMemoryList->kmerSearchData[i];
+      sprintf(buffer, "kmer %zu had %u hits with disk SA, but %u in memory.",
+              i, diskData->count, inMemoryData->count);
+      testAssertString(diskData->count == inMemoryData->count, buffer);
+      if (diskData->count == inMemoryData->count) {
+        sprintf(buffer,
+                "kmer %zu located different positions with disk SA "
+                "(%u threads).",
+                i, numThreads);
+        testAssertString(memcmp(diskData->positionList,
+                                inMemoryData->positionList,
+                                diskData->count * sizeof(uint64_t)) == 0,
+                         buffer);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < kmerCount; i++) {
+    free(diskList->kmerSearchData[i].kmerString);
+  }
+  awFmDeallocKmerSearchList(diskList);
+  awFmDeallocKmerSearchList(inMemoryList);
+  free(sequence);
+  awFmDeallocIndex(diskIndex);
+  awFmDeallocIndex(inMemoryIndex);
+}
+
+void testPageCacheReads(void) {
+  const size_t fileLength = 10000 + rand() % 200000;
+  uint8_t *fileContents = malloc(fileLength);
+  for (size_t i = 0; i < fileLength; i++) {
+    fileContents[i] = rand();
+  }
+  FILE *file = fopen("testPageCache.bin", "w+");
+  fwrite(fileContents, 1, fileLength, file);
+  fflush(file);
+
+  // a small capacity forces evictions.
+  const size_t pageSize = 512 << (rand() % 4);
+  const size_t capacity = pageSize * (1 + rand() % 32);
+  struct AwFmPageCache *cache =
+      awFmPageCacheCreate(fileno(file), pageSize, capacity);
+  testAssertString(cache != NULL, "page cache could not be created.");
+  testAssertString(awFmPageCacheCreate(fileno(file), pageSize, pageSize - 1) ==
+                       NULL,
+                   "page cache smaller than one page was created.");
+
+  uint8_t readBuffer[3000];
+  for (size_t i = 0; i < 5000; i++) {
+    const size_t length = 1 + rand() % sizeof(readBuffer);
+    // occasionally read past the end of the file, which should read as zero.
+    const size_t offset = rand() % fileLength;
+    enum AwFmReturnCode rc = awFmPageCacheRead(cache, offset, readBuffer, length);
+    testAssertString(rc == AwFmFileReadOkay, "page cache read failed.");
+    for (size_t j = 0; j < length; j++) {
+      const uint8_t expected =
+          offset + j < fileLength ? fileContents[offset + j] : 0;
+      if (readBuffer[j] != expected) {
+        sprintf(buffer,
+                "page cache byte %zu read as %u, expected %u (page size %zu).",
+                offset + j, readBuffer[j], expected, pageSize);
+        testAssertString(false, buffer);
+        break;
+      }
+    }
+  }
+
+  // a page that was just read must be a hit.
+  const size_t offset = rand() % fileLength;
+  awFmPageCacheRead(cache, offset, readBuffer, 1);
+  testAssertString(awFmPageCacheReadIfCached(cache, offset, readBuffer, 1),
+                   "page that was just read wasn't cached.");
+  testAssertString(readBuffer[0] == fileContents[offset],
+                   "cached read returned the wrong byte.");
+
+  struct AwFmCacheStatistics stats;
+  awFmPageCacheGetStatistics(cache, &stats);
+  testAssertString(stats.hits > 0, "page cache had no hits.");
+  testAssertString(stats.misses > 0, "page cache had no misses.");
+  testAssertString(stats.capacityInBytes <= capacity,
+                   "page cache capacity exceeded the requested capacity.");
+  testAssertString(stats.pageSize == pageSize,
+                   "page cache reported the wrong page size.");
+  if (fileLength > 2 * capacity) {
+    testAssertString(stats.evictions > 0,
+                     "page cache smaller than the file had no evictions.");
+  }
+
+  awFmPageCacheDealloc(cache);
+  fclose(file);
+  remove("testPageCache.bin");
+  free(fileContents);
+}
+
+void testSuffixArrayCache(const enum AwFmAlphabetType alphabetType) {
+  const size_t sequenceLength = 5000 + rand() % 100000;
+  const uint8_t compressionRatio = 1 + rand() % 8;
+  uint8_t *sequence = createSequence(alphabetType, sequenceLength);
+  struct AwFmIndex *index = createTestIndex(alphabetType, compressionRatio,
+                                            false, sequence, sequenceLength);
+  struct AwFmIndex *inMemoryIndex;
+  awFmReadIndexFromFile(&inMemoryIndex, "testAsyncSa.awfmi", true);
+
+  struct AwFmCacheStatistics stats;
+  awFmGetSuffixArrayCacheStatistics(index, &stats);
+  testAssertString(stats.hits == 0 && stats.capacityInBytes == 0,
+                   "index without a cache reported cache statistics.");
+  testAssertString(awFmEnableSuffixArrayCache(inMemoryIndex, 1 << 20) ==
+                       AwFmSuccess,
+                   "enabling the cache on an in-memory index failed.");
+  testAssertString(inMemoryIndex->suffixArrayCache == NULL,
+                   "in-memory suffix array was given a cache.");
+
+  // sometimes smaller than the suffix array, to exercise eviction.
+  const size_t capacity = 4096 * (1 + rand() % 64);
+  enum AwFmReturnCode rc = awFmEnableSuffixArrayCache(index, capacity);
+  testAssertString(rc == AwFmSuccess, "enabling the suffix array cache failed.");
+
+  const size_t numSamples =
+      awFmGetSampledSuffixArrayLength(index->bwtLength, compressionRatio);
+  const size_t numReads = 1 + rand() % 3000;
+  uint64_t *expectedPositions = malloc(numReads * sizeof(uint64_t));
+  uint64_t *cachedPositions = malloc(numReads * sizeof(uint64_t));
+  for (size_t pass = 0; pass < 2; pass++) {
+    for (size_t i = 0; i < numReads; i++) {
+      expectedPositions[i] = (rand() % numSamples) * compressionRatio;
+      cachedPositions[i] = expectedPositions[i];
+    }
+    // the first pass goes through the batched reader, the second reads values
+    // one at a time.
+    const size_t readCount =
+        pass == 0 ? numReads : (numReads < 63 ? numReads : 63);
+    rc = awFmReadPositionsFromSuffixArray(index, cachedPositions, readCount);
+    testAssertString(rc == AwFmFileReadOkay,
+                     "reading positions through the cache failed.");
+    awFmReadPositionsFromSuffixArray(inMemoryIndex, expectedPositions,
+                                     readCount);
+    testAssertString(memcmp(expectedPositions, cachedPositions,
+                            readCount * sizeof(uint64_t)) == 0,
+                     "cached and in-memory suffix array positions differ.");
+  }
+
+  const size_t kmerCount = 100 + rand() % 1000;
+  struct AwFmKmerSearchList *cachedList = awFmCreateKmerSearchList(kmerCount);
+  struct AwFmKmerSearchList *inMemoryList = awFmCreateKmerSearchList(kmerCount);
+  cachedList->count = kmerCount;
+  inMemoryList->count = kmerCount;
+  for (size_t i = 0; i < kmerCount; i++) {
+    const size_t kmerLength = 2 + rand() % 6;
+    char *kmer = malloc(kmerLength);
+    for (size_t letter = 0; letter < kmerLength; letter++) {
+      kmer[letter] = alphabetType == AwFmAlphabetAmino
+                         ? aminoLookup[rand() % 20]
+                         : nucleotideLookup[rand() % 4];
+    }
+    cachedList->kmerSearchData[i].kmerString = kmer;
+    cachedList->kmerSearchData[i].kmerLength = kmerLength;
+    inMemoryList->kmerSearchData[i].kmerString = kmer;
+    inMemoryList->kmerSearchData[i].kmerLength = kmerLength;
+  }
+
+  // repeating the search should be served mostly from the cache.
+  for (uint32_t numThreads = 1; numThreads < 5; numThreads++) {
+    rc = awFmParallelSearchLocate(index, cachedList, numThreads);
+    sprintf(buffer, "cached suffix array locate returned error code %i.", rc);
+    testAssertString(rc > 0, buffer);
+    awFmParallelSearchLocate(inMemoryIndex, inMemoryList, numThreads);
+
+    for (size_t i = 0; i < kmerCount; i++) {
+      const struct AwFmKmerSearchData *cachedData =
+          &cachedList->kmerSearchData[i];
+      const struct AwFmKmerSearchData *inMemoryData =
+          &inMemoryList->kmerSearchData[i];
+      testAssertString(cachedData->count == inMemoryData->count,
+                       "cached locate found a different number of hits.");
+      if (cachedData->count == inMemoryData->count) {
+        sprintf(buffer,
+                "kmer %zu located different positions with the suffix array "
+                "cache (%u threads).",
+                i, numThreads);
+        testAssertString(memcmp(cachedData->positionList,
+                                inMemoryData->positionList,
+                                cachedData->count * sizeof(uint64_t)) == 0,
+                         buffer);
+      }
+    }
+  }
+
+  awFmGetSuffixArrayCacheStatistics(index, &stats);
+  testAssertString(stats.hits > 0, "suffix array cache had no hits.");
+  testAssertString(stats.misses > 0, "suffix array cache had no misses.");
+  testAssertString(stats.capacityInBytes > 0 &&
+                       stats.capacityInBytes <= capacity,
+                   "suffix array cache capacity was out of range.");
+  testAssertString(stats.pageSize == 4096,
+                   "suffix array cache page size wasn't 4096.");
+
+  for (size_t i = 0; i < kmerCount; i++) {
+    free(cachedList->kmerSearchData[i].kmerString);
+  }
+  awFmDeallocKmerSearchList(cachedList);
+  awFmDeallocKmerSearchList(inMemoryList);
+  free(expectedPositions);
+  free(cachedPositions);
+  free(sequence);
+  awFmDeallocIndex(index);
+  awFmDeallocIndex(inMemoryIndex);
+}
@@ -0,0 +1,218 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/AwFmIndex.h"
+#include "../test.h"
+
+char buffer[2048];
+// ascii letters by letter index, ambiguity letter last.
+const char nucleotideLetters[] = "acgtn";
+const char aminoLetters[] = "acdefghiklmnpqrstvwyx";
+
+#define FORWARD_INDEX_SRC "biDirectionalForward.awfmi"
+#define REVERSE_INDEX_SRC "biDirectionalReverse.awfmi"
+#define MAX_PATTERN_LENGTH 40
+
+void testBiDirectionalSearch(const enum AwFmAlphabetType alphabet,
+                             const size_t sequenceLength);
+void testIncompatibleIndices(void);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  for (size_t i = 0; i < 4; i++) {
+    testBiDirectionalSearch(AwFmAlphabetDna, 1 + rand() % 50000);
+    testBiDirectionalSearch(AwFmAlphabetAmino, 1 + rand() % 50000);
+  }
+  testBiDirectionalSearch(AwFmAlphabetDna, 1);
+  testBiDirectionalSearch(AwFmAlphabetAmino, 2);
+  testIncompatibleIndices();
+
+  remove(FORWARD_INDEX_SRC);
+  remove(REVERSE_INDEX_SRC);
+  printf("bidirectional testing finished.\n");
+}
+
+// letter indices of a sequence that repeats stretches of itself, so patterns
+// have many matches.
+uint8_t *makeSequence(const enum AwFmAlphabetType alphabet,
+                      const size_t sequenceLength) {
+  const uint8_t cardinality = alphabet == AwFmAlphabetAmino ? 20 : 4;
+  uint8_t *sequence = malloc(sequenceLength);
+  const size_t period = 1 + rand() % 300;
+  for (size_t i = 0; i < sequenceLength; i++) {
+    if (i >= period && rand() % 4 != 0) {
+      sequence[i] = sequence[i - period];
+    } else if (rand() % 200 == 0) {
+      sequence[i] = cardinality;
+    } else {
+      sequence[i] = rand() % cardinality;
+    }
+  }
+  return sequence;
+}
+
+// checks the range against a backward search for the pattern in the forward
+// index, and for the reversed pattern in the reverse index.
+void checkRange(const struct AwFmBiDirectionalIndex *biIndex,
+                const struct AwFmBiDirectionalRange *range,
+                const uint8_t *pattern, const size_t patternLength,
+                const char *letters) {
+  char forwardKmer[MAX_PATTERN_LENGTH];
+  char reverseKmer[MAX_PATTERN_LENGTH];
+  for (size_t i = 0; i < patternLength; i++) {
+    forwardKmer[i] = letters[pattern[i]];
+    reverseKmer[patternLength - 1 - i] = letters[pattern[i]];
+  }
+  const struct AwFmSearchRange forwardRange = awFmFindSearchRangeForString(
+      biIndex->forwardIndex, forwardKmer, patternLength);
+  const struct AwFmSearchRange reverseRange = awFmFindSearchRangeForString(
+      biIndex->reverseIndex, reverseKmer, patternLength);
+  const uint64_t expectedLength = forwardRange.startPtr <= forwardRange.endPtr
+                                      ? forwardRange.endPtr -
+                                            forwardRange.startPtr + 1
+                                      : 0;
+
+  sprintf(buffer,
+          "pattern %.*s of length %zu expected %lu matches, got %lu.",
+          (int)patternLength, forwardKmer, patternLength, expectedLength,
+          range->length);
+  testAssertString(range->length == expectedLength, buffer);
+  if (expectedLength != 0 && range->length == expectedLength) {
+    sprintf(buffer,
+            "pattern %.*s expected forward start %lu, reverse start %lu, "
+            "got %lu and %lu.",
+            (int)patternLength, forwardKmer, forwardRange.startPtr,
+            reverseRange.startPtr, range->forwardStartPtr,
+            range->reverseStartPtr);
+    testAssertString(range->forwardStartPtr == forwardRange.startPtr &&
+                         range->reverseStartPtr == reverseRange.startPtr,
+                     buffer);
+    testAssertString(reverseRange.endPtr - reverseRange.startPtr + 1 ==
+                         expectedLength,
+                     "reverse index found a different number of matches.");
+  }
+}
+
+// grows patterns from single letters by random extensions on either side.
+// Most extensions copy the letter next to a known match, so the pattern keeps
+// matching for a while before a random letter ends it.
+void searchRandomPatterns(const struct AwFmBiDirectionalIndex *biIndex,
+                          const uint8_t *sequence, const size_t sequenceLength,
+                          const uint8_t cardinality, const char *letters) {
+  for (size_t patternNum = 0; patternNum < 300; patternNum++) {
+    uint8_t pattern[MAX_PATTERN_LENGTH];
+    size_t matchStart = rand() % sequenceLength;
+    size_t patternStart = MAX_PATTERN_LENGTH / 2;
+    size_t patternLength = 1;
+    pattern[patternStart] = sequence[matchStart];
+    struct AwFmBiDirectionalRange range =
+        awFmBiDirectionalCreateInitialRange(biIndex, pattern[patternStart]);
+    checkRange(biIndex, &range, pattern + patternStart, patternLength,
+               letters);
+
+    // cleared once a random letter is added, after which the pattern may
+    // not match at matchStart.
+    bool followsMatch = true;
+    while (range.length != 0 && patternLength < MAX_PATTERN_LENGTH / 2) {
+      const bool extendLeft = rand() % 2;
+      const size_t matchEnd = matchStart + patternLength;
+      if (rand() % 8 == 0 || (extendLeft && matchStart == 0) ||
+          (!extendLeft && matchEnd == sequenceLength)) {
+        followsMatch = false;
+      }
+      uint8_t letterIndex;
+      if (followsMatch) {
+        letterIndex =
+            extendLeft ? sequence[matchStart - 1] : sequence[matchEnd];
+      } else {
+        letterIndex = rand() % (cardinality + 1);
+      }
+
+      if (extendLeft) {
+        awFmBiDirectionalExtendLeft(biIndex, &range, letterIndex);
+        pattern[--patternStart] = letterIndex;
+        matchStart -= followsMatch;
+      } else {
+        awFmBiDirectionalExtendRight(biIndex, &range, letterIndex);
+        pattern[patternStart + patternLength] = letterIndex;
+      }
+      patternLength++;
+      checkRange(biIndex, &range, pattern + patternStart, patternLength,
+                 letters);
+    }
+  }
+}
+
+void testBiDirectionalSearch(const enum AwFmAlphabetType alphabet,
+                             const size_t sequenceLength) {
+  const bool isAmino = alphabet == AwFmAlphabetAmino;
+  const uint8_t cardinality = isAmino ? 20 : 4;
+  const char *letters = isAmino ? aminoLetters : nucleotideLetters;
+  uint8_t *sequence = makeSequence(alphabet, sequenceLength);
+  uint8_t *asciiSequence = malloc(sequenceLength);
+  for (size_t i = 0; i < sequenceLength; i++) {
+    asciiSequence[i] = letters[sequence[i]];
+  }
+
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 8,
+      .kmerLengthInSeedTable = isAmino ? 2 : 4,
+      .alphabetType = alphabet,
+      .keepSuffixArrayInMemory = true,
+      .storeOriginalSequence = false};
+  struct AwFmIndex *forwardIndex;
+  enum AwFmReturnCode returnCode =
+      awFmCreateIndex(&forwardIndex, &config, asciiSequence, sequenceLength,
+                      FORWARD_INDEX_SRC);
+  testAssertString(returnCode == AwFmFileWriteOkay,
+                   "forward index creation failed.");
+
+  struct AwFmBiDirectionalIndex *biIndex;
+  returnCode =
+      awFmCreateBiDirectionalIndex(&biIndex, forwardIndex, REVERSE_INDEX_SRC);
+  sprintf(buffer, "bidirectional index creation returned %d.", returnCode);
+  testAssertString(returnCode == AwFmFileWriteOkay, buffer);
+  searchRandomPatterns(biIndex, sequence, sequenceLength, cardinality,
+                       letters);
+  awFmDeallocBiDirectionalIndex(biIndex);
+
+  returnCode = awFmReadBiDirectionalIndexFromFile(&biIndex, FORWARD_INDEX_SRC,
+                                                  REVERSE_INDEX_SRC, false);
+  sprintf(buffer, "bidirectional index read returned %d.", returnCode);
+  testAssertString(returnCode == AwFmFileReadOkay, buffer);
+  searchRandomPatterns(biIndex, sequence, sequenceLength, cardinality,
+                       letters);
+  awFmDeallocBiDirectionalIndex(biIndex);
+
+  free(asciiSequence);
+  free(sequence);
+}
+
+void testIncompatibleIndices(void) {
+  uint8_t *sequence = makeSequence(AwFmAlphabetDna, 3000);
+  for (size_t i = 0; i < 3000; i++) {
+    sequence[i] = nucleotideLetters[sequence[i]];
+  }
+  struct AwFmIndexConfiguration config = {.suffixArrayCompressionRatio = 4,
+                                          .kmerLengthInSeedTable = 4,
+                                          .alphabetType = AwFmAlphabetDna,
+                                          .storeOriginalSequence = false};
+  struct AwFmIndex *index;
+  awFmCreateIndex(&index, &config, sequence, 3000, FORWARD_INDEX_SRC);
+  awFmDeallocIndex(index);
+  awFmCreateIndex(&index, &config, sequence, 2000, REVERSE_INDEX_SRC);
+  awFmDeallocIndex(index);
+
+  struct AwFmBiDirectionalIndex *biIndex;
+  const enum AwFmReturnCode returnCode = awFmReadBiDirectionalIndexFromFile(
+      &biIndex, FORWARD_INDEX_SRC, REVERSE_INDEX_SRC, false);
+  testAssertString(returnCode == AwFmIncompatibleIndices,
+                   "indices of different lengths should be incompatible.");
+  testAssertString(biIndex == NULL,
+                   "no bidirectional index should be returned on failure.");
+  free(sequence);
+}
@@ -0,0 +1,345 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/AwFmIndex.h"
+#include "../test.h"
+
+char buffer[2048];
+uint8_t aminoLookup[20] = {'a', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'k', 'l',
+                           'm', 'n', 'p', 'q', 'r', 's', 't', 'v', 'w', 'y'};
+uint8_t nucleotideLookup[4] = {'a', 'g', 'c', 't'};
+
+#define MAIN_INDEX_SRC "deltaMain.awfmi"
+#define FASTA_SRC "deltaIndexTest.fasta"
+#define DELTA_PREFIX "deltaIndexTest"
+#define MAX_RECORDS 64
+#define NUM_KMERS 40
+
+// every sequence in global order, starting with the main index's records.
+struct Records {
+  char *sequences[MAX_RECORDS];
+  size_t lengths[MAX_RECORDS];
+  size_t globalStarts[MAX_RECORDS];
+  size_t count;
+};
+
+struct SearchThreadArgs {
+  struct AwFmDeltaIndex *deltaIndex;
+  const struct Records *records;
+  enum AwFmAlphabetType alphabet;
+  // number of records the delta index has finished appending.
+  size_t numAppended;
+  // number of records handed to the delta index, including one that may
+  // still be being appended. Searches can see a record as soon as its
+  // append starts publishing it.
+  size_t numAppending;
+  bool stop;
+  uint32_t numSearches;
+};
+
+void testDeltaIndex(const enum AwFmAlphabetType alphabet);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  for (size_t i = 0; i < 3; i++) {
+    testDeltaIndex(AwFmAlphabetDna);
+    testDeltaIndex(AwFmAlphabetAmino);
+  }
+  remove(MAIN_INDEX_SRC);
+  remove(FASTA_SRC);
+  remove(DELTA_PREFIX ".main.awfmi");
+
+  printf("delta index testing finished.\n");
+}
+
+char randomLetter(const enum AwFmAlphabetType alphabet) {
+  if (rand() % 200 == 0) {
+    return alphabet == AwFmAlphabetAmino ? 'x' : 'n';
+  }
+  return alphabet == AwFmAlphabetAmino ? aminoLookup[rand() % 20]
+                                       : nucleotideLookup[rand() % 4];
+}
+
+// copies stretches of earlier records, so kmers hit several records.
+void addRecord(struct Records *records, const enum AwFmAlphabetType alphabet,
+               const size_t length) {
+  char *sequence = malloc(length);
+  for (size_t i = 0; i < length; i++) {
+    if (records->count != 0 && rand() % 50 == 0) {
+      const size_t source = rand() % records->count;
+      const size_t start = rand() % records->lengths[source];
+      for (size_t j = start; j < records->lengths[source] && i < length;
+           j++, i++) {
+        sequence[i] = records->sequences[source][j];
+      }
+      i--;
+    } else {
+      sequence[i] = randomLetter(alphabet);
+    }
+  }
+  // the search thread only reads records once numAppending covers them.
+  const size_t index = records->count++;
+  records->sequences[index] = sequence;
+  records->lengths[index] = length;
+  records->globalStarts[index] =
+      index == 0 ? 0 : records->globalStarts[index - 1] +
+                           records->lengths[index - 1];
+}
+
+// picks a kmer from one of the first numRecords records, without ambiguity
+// characters.
+void makeKmer(const struct Records *records, const size_t numRecords,
+              const enum AwFmAlphabetType alphabet, char *kmer,
+              uint64_t *kmerLength) {
+  const char ambiguity = alphabet == AwFmAlphabetAmino ? 'x' : 'n';
+  while (true) {
+    const size_t record = rand() % numRecords;
+    *kmerLength = 3 + rand() % 8;
+    if (records->lengths[record] < *kmerLength) {
+      continue;
+    }
+    const size_t start = rand() % (records->lengths[record] - *kmerLength + 1);
+    memcpy(kmer, records->sequences[record] + start, *kmerLength);
+    if (memchr(kmer, ambiguity, *kmerLength) == NULL) {
+      return;
+    }
+  }
+}
+
+int compareUint64(const void *a, const void *b) {
+  const uint64_t valueA = *(const uint64_t *)a;
+  const uint64_t valueB = *(const uint64_t *)b;
+  return (valueA > valueB) - (valueA < valueB);
+}
+
+// global positions of the kmer in the first numRecords records.
+size_t findHits(const struct Records *records, const size_t numRecords,
+                const char *kmer, const size_t kmerLength, uint64_t *hits) {
+  size_t numHits = 0;
+  for (size_t record = 0; record < numRecords; record++) {
+    for (size_t i = 0; i + kmerLength <= records->lengths[record]; i++) {
+      if (memcmp(records->sequences[record] + i, kmer, kmerLength) == 0) {
+        hits[numHits++] = records->globalStarts[record] + i;
+      }
+    }
+  }
+  return numHits;
+}
+
+bool containsHit(const uint64_t *hits, const size_t numHits,
+                 const uint64_t hit) {
+  return bsearch(&hit, hits, numHits, sizeof(uint64_t), compareUint64) != NULL;
+}
+
+// checks that the search found every hit in the records appended before it
+// started, and nothing that isn't in the records handed to the delta index
+// by the time it finished.
+bool checkSearch(struct AwFmDeltaIndex *deltaIndex,
+                 const struct Records *records,
+                 const enum AwFmAlphabetType alphabet,
+                 size_t *numAppended, size_t *numAppending) {
+  static __thread char kmers[NUM_KMERS][16];
+  struct AwFmKmerSearchList *searchList = awFmCreateKmerSearchList(NUM_KMERS);
+  searchList->count = NUM_KMERS;
+  const size_t recordsBefore =
+      __atomic_load_n(numAppended, __ATOMIC_ACQUIRE);
+  for (size_t i = 0; i < NUM_KMERS; i++) {
+    makeKmer(records, recordsBefore, alphabet, kmers[i],
+             &searchList->kmerSearchData[i].kmerLength);
+    searchList->kmerSearchData[i].kmerString = kmers[i];
+  }
+  const enum AwFmReturnCode returnCode =
+      awFmDeltaIndexParallelSearchLocate(deltaIndex, searchList, 1);
+  const size_t recordsAfter =
+      __atomic_load_n(numAppending, __ATOMIC_ACQUIRE);
+  // the global buffer would be shared with the search thread.
+  char message[512];
+  sprintf(message, "delta index locate returned error code %i.", returnCode);
+  testAssertString(returnCode == AwFmSuccess, message);
+  testAssertString(awFmDeltaIndexParallelSearchLocate(NULL, searchList, 1) ==
+                       AwFmNullPtrError,
+                   "delta index locate accepted a NULL delta index.");
+  testAssertString(awFmDeltaIndexParallelSearchLocate(deltaIndex, NULL, 1) ==
+                       AwFmNullPtrError,
+                   "delta index locate accepted a NULL search list.");
+
+  bool passed = true;
+  uint64_t *expectedBefore = malloc(1000000 * sizeof(uint64_t));
+  uint64_t *expectedAfter = malloc(1000000 * sizeof(uint64_t));
+  for (size_t i = 0; i < NUM_KMERS && passed; i++) {
+    const struct AwFmKmerSearchData *searchData =
+        &searchList->kmerSearchData[i];
+    const size_t numBefore =
+        findHits(records, recordsBefore, kmers[i], searchData->kmerLength,
+                 expectedBefore);
+    const size_t numAfter = findHits(records, recordsAfter, kmers[i],
+                                     searchData->kmerLength, expectedAfter);
+    qsort(expectedAfter, numAfter, sizeof(uint64_t), compareUint64);
+    uint64_t *found = malloc((searchData->count + 1) * sizeof(uint64_t));
+    memcpy(found, searchData->positionList,
+           searchData->count * sizeof(uint64_t));
+    qsort(found, searchData->count, sizeof(uint64_t), compareUint64);
+
+    for (uint32_t hit = 0; hit < searchData->count && passed; hit++) {
+      if (!containsHit(expectedAfter, numAfter, found[hit]) ||
+          (hit != 0 && found[hit] == found[hit - 1])) {
+        sprintf(message,
+                "kmer %zu (%.*s) reported hit %zu, which isn't in the %zu "
+                "records handed to the delta index, or is repeated.",
+                i, (int)searchData->kmerLength, kmers[i], found[hit],
+                recordsAfter);
+        testAssertString(false, message);
+        passed = false;
+      }
+    }
+    for (size_t hit = 0; hit < numBefore && passed; hit++) {
+      if (!containsHit(found, searchData->count, expectedBefore[hit])) {
+        sprintf(message,
+                "kmer %zu (%.*s) missed the hit at %zu in the first %zu "
+                "records, found %u hits.",
+                i, (int)searchData->kmerLength, kmers[i], expectedBefore[hit],
+                recordsBefore, searchData->count);
+        testAssertString(false, message);
+        passed = false;
+      }
+    }
+    free(found);
+  }
+  free(expectedBefore);
+  free(expectedAfter);
+  awFmDeallocKmerSearchList(searchList);
+  return passed;
+}
+
+void *searchThread(void *argsPtr) {
+  struct SearchThreadArgs *args = argsPtr;
+  while (!__atomic_load_n(&args->stop, __ATOMIC_ACQUIRE)) {
+    if (!checkSearch(args->deltaIndex, args->records, args->alphabet,
+                     &args->numAppended, &args->numAppending)) {
+      break;
+    }
+    args->numSearches++;
+  }
+  return NULL;
+}
+
+void testDeltaIndex(const enum AwFmAlphabetType alphabet) {
+  struct Records *records = calloc(1, sizeof(struct Records));
+  // the main index starts with a few records from a fasta.
+  const size_t numMainRecords = 1 + rand() % 3;
+  FILE *fastaFile = fopen(FASTA_SRC, "w");
+  for (size_t i = 0; i < numMainRecords; i++) {
+    addRecord(records, alphabet, 2000 + rand() % 20000);
+    fprintf(fastaFile, ">main %zu\n", i);
+    fwrite(records->sequences[i], 1, records->lengths[i], fastaFile);
+    fprintf(fastaFile, "\n");
+  }
+  fclose(fastaFile);
+
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 1 + rand() % 16,
+      .kmerLengthInSeedTable = alphabet == AwFmAlphabetAmino ? 3 : 6,
+      .alphabetType = alphabet,
+      .keepSuffixArrayInMemory = rand() % 2,
+      .storeOriginalSequence = rand() % 2};
+  struct AwFmIndex *mainIndex;
+  enum AwFmReturnCode returnCode = awFmCreateIndexFromFasta(
+      &mainIndex, &config, FASTA_SRC, MAIN_INDEX_SRC);
+  testAssertString(awFmReturnCodeIsSuccess(returnCode),
+                   "could not build the main index.");
+
+  struct AwFmDeltaIndex *deltaIndex;
+  returnCode =
+      awFmDeltaIndexCreate(&deltaIndex, mainIndex, &config, DELTA_PREFIX);
+  sprintf(buffer, "delta index creation returned error code %i.", returnCode);
+  testAssertString(returnCode == AwFmSuccess, buffer);
+
+  struct SearchThreadArgs args = {.deltaIndex = deltaIndex,
+                                  .records = records,
+                                  .alphabet = alphabet,
+                                  .numAppended = records->count,
+                                  .numAppending = records->count,
+                                  .stop = false,
+                                  .numSearches = 0};
+  pthread_t thread;
+  pthread_create(&thread, NULL, searchThread, &args);
+
+  // appends in rounds, compacting after each round while the next is appended.
+  for (size_t round = 0; round < 3; round++) {
+    const size_t numAppends = 1 + rand() % 5;
+    for (size_t i = 0; i < numAppends && records->count < MAX_RECORDS; i++) {
+      addRecord(records, alphabet, 1 + rand() % 3000);
+      const size_t record = records->count - 1;
+      __atomic_store_n(&args.numAppending, records->count,
+                       __ATOMIC_RELEASE);
+      sprintf(buffer, "appended %zu", record);
+      returnCode = awFmDeltaIndexAppendSequence(deltaIndex, buffer,
+                                                records->sequences[record],
+                                                records->lengths[record]);
+      sprintf(buffer, "append returned error code %i.", returnCode);
+      testAssertString(returnCode == AwFmSuccess, buffer);
+      __atomic_store_n(&args.numAppended, records->count,
+                       __ATOMIC_RELEASE);
+      checkSearch(deltaIndex, records, alphabet, &args.numAppended,
+                  &args.numAppending);
+    }
+    returnCode = awFmDeltaIndexStartCompaction(deltaIndex);
+    testAssertString(returnCode == AwFmSuccess,
+                     "could not start the compaction.");
+  }
+  returnCode = awFmDeltaIndexWaitForCompaction(deltaIndex);
+  sprintf(buffer, "compaction returned error code %i.", returnCode);
+  testAssertString(returnCode == AwFmSuccess, buffer);
+  checkSearch(deltaIndex, records, alphabet, &args.numAppended,
+              &args.numAppending);
+
+  // compacts whatever the last round left in the delta.
+  awFmDeltaIndexStartCompaction(deltaIndex);
+  returnCode = awFmDeltaIndexWaitForCompaction(deltaIndex);
+  testAssertString(returnCode == AwFmSuccess,
+                   "the final compaction failed.");
+  checkSearch(deltaIndex, records, alphabet, &args.numAppended,
+              &args.numAppending);
+
+  __atomic_store_n(&args.stop, true, __ATOMIC_RELEASE);
+  pthread_join(thread, NULL);
+  testAssertString(args.numSearches != 0,
+                   "the search thread didn't finish any searches.");
+
+  const uint64_t expectedLength =
+      records->globalStarts[records->count - 1] +
+      records->lengths[records->count - 1];
+  sprintf(buffer, "delta index reported length %zu, expected %zu.",
+          awFmDeltaIndexGetSequenceLength(deltaIndex), expectedLength);
+  testAssertString(awFmDeltaIndexGetSequenceLength(deltaIndex) ==
+                       expectedLength,
+                   buffer);
+
+  // everything has been compacted, so the main index file holds every record.
+  struct AwFmIndex *compactedIndex;
+  returnCode = awFmReadIndexFromFile(&compactedIndex,
+                                     DELTA_PREFIX ".main.awfmi", true);
+  testAssertString(awFmReturnCodeIsSuccess(returnCode),
+                   "could not read the compacted main index.");
+  if (awFmReturnCodeIsSuccess(returnCode)) {
+    sprintf(buffer, "compacted main index holds %zu positions, expected %zu.",
+            compactedIndex->bwtLength - 1, expectedLength);
+    testAssertString(compactedIndex->bwtLength - 1 == expectedLength, buffer);
+    sprintf(buffer, "compacted main index holds %u sequences, expected %zu.",
+            awFmGetNumSequences(compactedIndex), records->count);
+    testAssertString(awFmGetNumSequences(compactedIndex) == records->count,
+                     buffer);
+    awFmDeallocIndex(compactedIndex);
+  }
+
+  awFmDeallocDeltaIndex(deltaIndex);
+  for (size_t i = 0; i < records->count; i++) {
+    free(records->sequences[i]);
+  }
+  free(records);
+}
@@ -0,0 +1,232 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../src/AwFmIndex.h"
+#include "../../src/AwFmIndexStruct.h"
+#include "../../src/AwFmParallelSearch.h"
+#include "../../src/AwFmSearch.h"
+#include "../test.h"
+
+char buffer[2048];
+uint8_t nucleotideLookup[4] = {'a', 'g', 'c', 't'};
+uint8_t aminoLookup[20] = {'a', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'k', 'l',
+                           'm', 'n', 'p', 'q', 'r', 's', 't', 'v', 'w', 'y'};
+
+void testDiskBwtSearch(const enum AwFmAlphabetType alphabetType);
+void testDiskBwtReadFailure(void);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  for (size_t i = 0; i < 4; i++) {
+    testDiskBwtSearch(AwFmAlphabetDna);
+    testDiskBwtSearch(AwFmAlphabetAmino);
+  }
+  testDiskBwtReadFailure();
+
+  printf("disk bwt testing finished.\n");
+}
+
+char randomLetter(const enum AwFmAlphabetType alphabetType) {
+  return alphabetType == AwFmAlphabetAmino ? aminoLookup[rand() % 20]
+                                           : nucleotideLookup[rand() % 4];
+}
+
+void testDiskBwtSearch(const enum AwFmAlphabetType alphabetType) {
+  const size_t sequenceLength = 10000 + rand() % 200000;
+  uint8_t *sequence = malloc(sequenceLength + 1);
+  for (size_t i = 0; i < sequenceLength; i++) {
+    sequence[i] = randomLetter(alphabetType);
+  }
+  sequence[sequenceLength] = 0;
+
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 1 + rand() % 16,
+      .kmerLengthInSeedTable = 4,
+      .alphabetType = alphabetType,
+      .keepSuffixArrayInMemory = true,
+      .storeOriginalSequence = false};
+  struct AwFmIndex *inMemoryIndex;
+  enum AwFmReturnCode rc = awFmCreateIndex(
+      &inMemoryIndex, &config, sequence, sequenceLength, "testDiskBwt.awfmi");
+  sprintf(buffer, "index creation returned error code %i.", rc);
+  testAssertString(rc > 0, buffer);
+
+  struct AwFmIndex *diskIndex;
+  struct AwFmIndexLoadConfiguration loadConfig = {
+      .keepSuffixArrayInMemory = rand() % 2 == 0,
+      .numThreads = 1 + rand() % 4,
+      .keepBwtOnDisk = true,
+      .bwtCacheCapacity = (size_t)(rand() % 3) * 1024 * 1024};
+  rc = awFmReadIndexFromFileParallel(&diskIndex, "testDiskBwt.awfmi",
+                                     &loadConfig, NULL);
+  sprintf(buffer, "disk bwt load returned error code %i.", rc);
+  testAssertString(rc == AwFmFileReadOkay, buffer);
+  testAssertString(diskIndex->bwtBlockList.asNucleotide == NULL,
+                   "disk bwt index allocated an in-memory block list.");
+  testAssertString(awFmReplicateIndexAcrossNumaNodes(diskIndex) ==
+                       AwFmFeatureUnsupported,
+                   "disk bwt index was replicated across numa nodes.");
+
+  struct AwFmCacheStatistics stats;
+  awFmGetBwtCacheStatistics(inMemoryIndex, &stats);
+  testAssertString(stats.capacityInBytes == 0,
+                   "in-memory bwt reported cache statistics.");
+
+  // single kmer searches
+  for (size_t i = 0; i < 500; i++) {
+    char kmer[16];
+    const size_t kmerLength = 1 + rand() % 15;
+    for (size_t letter = 0; letter < kmerLength; letter++) {
+      kmer[letter] = randomLetter(alphabetType);
+    }
+    const struct AwFmSearchRange diskRange =
+        awFmFindSearchRangeForString(diskIndex, kmer, kmerLength);
+    const struct AwFmSearchRange inMemoryRange =
+        awFmFindSearchRangeForString(inMemoryIndex, kmer, kmerLength);
+    sprintf(buffer,
+            "disk bwt range [%zu, %zu] didn't match in-memory range "
+            "[%zu, %zu].",
+            diskRange.startPtr, diskRange.endPtr, inMemoryRange.startPtr,
+            inMemoryRange.endPtr);
+    testAssertString(diskRange.startPtr == inMemoryRange.startPtr &&
+                         diskRange.endPtr == inMemoryRange.endPtr,
+                     buffer);
+
+    if (awFmSearchRangeIsValid(&diskRange)) {
+      enum AwFmReturnCode diskResult, inMemoryResult;
+      const uint64_t diskPosition = awFmFindDatabaseHitPositionSingle(
+          diskIndex, diskRange.startPtr, &diskResult);
+      const uint64_t inMemoryPosition = awFmFindDatabaseHitPositionSingle(
+          inMemoryIndex, inMemoryRange.startPtr, &inMemoryResult);
+      testAssertString(diskResult == AwFmFileReadOkay,
+                       "disk bwt backtrace failed.");
+      testAssertString(diskPosition == inMemoryPosition,
+                       "disk bwt backtrace found a different position.");
+    }
+  }
+
+  // parallel count and locate
+  const size_t kmerCount = 100 + rand() % 2000;
+  struct AwFmKmerSearchList *diskList = awFmCreateKmerSearchList(kmerCount);
+  struct AwFmKmerSearchList *inMemoryList = awFmCreateKmerSearchList(kmerCount);
+  diskList->count = kmerCount;
+  inMemoryList->count = kmerCount;
+  for (size_t i = 0; i < kmerCount; i++) {
+    const size_t kmerLength = 2 + rand() % 10;
+    char *kmer = malloc(kmerLength);
+    for (size_t letter = 0; letter < kmerLength; letter++) {
+      kmer[letter] = randomLetter(alphabetType);
+    }
+    diskList->kmerSearchData[i].kmerString = kmer;
+    diskList->kmerSearchData[i].kmerLength = kmerLength;
+    inMemoryList->kmerSearchData[i].kmerString = kmer;
+    inMemoryList->kmerSearchData[i].kmerLength = kmerLength;
+  }
+
+  for (uint32_t numThreads = 1; numThreads < 5; numThreads++) {
+    awFmParallelSearchCount(diskIndex, diskList, numThreads);
+    awFmParallelSearchCount(inMemoryIndex, inMemoryList, numThreads);
+    for (size_t i = 0; i < kmerCount; i++) {
+      sprintf(buffer, "kmer %zu counted %u hits with disk bwt, %u in memory.",
+              i, diskList->kmerSearchData[i].count,
+              inMemoryList->kmerSearchData[i].count);
+      testAssertString(diskList->kmerSearchData[i].count ==
+                           inMemoryList->kmerSearchData[i].count,
+                       buffer);
+    }
+
+    rc = awFmParallelSearchLocate(diskIndex, diskList, numThreads);
+    sprintf(buffer, "disk bwt locate returned error code %i.", rc);
+    testAssertString(rc > 0, buffer);
+    awFmParallelSearchLocate(inMemoryIndex, inMemoryList, numThreads);
+    for (size_t i = 0; i < kmerCount; i++) {
+      const struct AwFmKmerSearchData *diskData = &diskList->kmerSearchData[i];
+      const struct AwFmKmerSearchData *inMemoryData =
+          &inMemoryList->kmerSearchData[i];
+      testAssertString(diskData->count == inMemoryData->count,
+                       "disk bwt locate found a different number of hits.");
+      if (diskData->count == inMemoryData->count) {
+        sprintf(buffer,
+                "kmer %zu located different positions with disk bwt "
+                "(%u threads).",
+                i, numThreads);
+        testAssertString(memcmp(diskData->positionList,
+                                inMemoryData->positionList,
+                                diskData->count * sizeof(uint64_t)) == 0,
+                         buffer);
+      }
+    }
+  }
+
+  awFmGetBwtCacheStatistics(diskIndex, &stats);
+  testAssertString(stats.misses > 0, "disk bwt cache had no misses.");
+  testAssertString(stats.hits > stats.misses,
+                   "disk bwt cache had more misses than hits.");
+  testAssertString(stats.capacityInBytes >= stats.pageSize,
+                   "disk bwt cache held less than one chunk.");
+  testAssertString(stats.readFailures == 0, "disk bwt cache failed a read.");
+
+  for (size_t i = 0; i < kmerCount; i++) {
+    free(diskList->kmerSearchData[i].kmerString);
+  }
+  awFmDeallocKmerSearchList(diskList);
+  awFmDeallocKmerSearchList(inMemoryList);
+  free(sequence);
+  awFmDeallocIndex(diskIndex);
+  awFmDeallocIndex(inMemoryIndex);
+}
+
+void testDiskBwtReadFailure(void) {
+  const size_t sequenceLength = 100000;
+  uint8_t *sequence = malloc(sequenceLength);
+  for (size_t i = 0; i < sequenceLength; i++) {
+    sequence[i] = randomLetter(AwFmAlphabetDna);
+  }
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 4,
+      .kmerLengthInSeedTable = 4,
+      .alphabetType = AwFmAlphabetDna,
+      .keepSuffixArrayInMemory = true,
+      .storeOriginalSequence = false};
+  struct AwFmIndex *index;
+  enum AwFmReturnCode rc = awFmCreateIndex(&index, &config, sequence,
+                                           sequenceLength, "testDiskBwt.awfmi");
+  testAssertString(rc > 0, "index creation failed.");
+  awFmDeallocIndex(index);
+
+  struct AwFmIndexLoadConfiguration loadConfig = {
+      .keepSuffixArrayInMemory = true, .numThreads = 1, .keepBwtOnDisk = true};
+  rc = awFmReadIndexFromFileParallel(&index, "testDiskBwt.awfmi", &loadConfig,
+                                     NULL);
+  testAssertString(rc == AwFmFileReadOkay, "disk bwt load failed.");
+
+  // pointing the index's file descriptor at a directory makes every block
+  // read fail.
+  const int directoryDescriptor = open(".", O_RDONLY);
+  testAssertString(dup2(directoryDescriptor, index->fileDescriptor) >= 0,
+                   "couldn't replace the index file descriptor.");
+  close(directoryDescriptor);
+  struct AwFmKmerSearchList *searchList = awFmCreateKmerSearchList(1);
+  searchList->kmerSearchData[0].kmerString = "acgtac";
+  searchList->kmerSearchData[0].kmerLength = 6;
+  searchList->count = 1;
+  rc = awFmParallelSearchLocate(index, searchList, 1);
+  sprintf(buffer, "locate on a truncated file returned error code %i.", rc);
+  testAssertString(rc == AwFmFileReadFail, buffer);
+
+  struct AwFmCacheStatistics stats;
+  awFmGetBwtCacheStatistics(index, &stats);
+  testAssertString(stats.readFailures > 0,
+                   "disk bwt cache didn't count the failed reads.");
+
+  awFmDeallocKmerSearchList(searchList);
+  awFmDeallocIndex(index);
+  free(sequence);
+  remove("testDiskBwt.awfmi");
+}
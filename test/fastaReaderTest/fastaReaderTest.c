@@ -0,0 +1,284 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../src/AwFmFastaReader.h"
+#include "../../src/AwFmIndex.h"
+#include "../../src/AwFmIndexStruct.h"
+#include "../../src/AwFmLetter.h"
+#include "../test.h"
+#include "FastaVector.h"
+
+char buffer[2048];
+uint8_t aminoLookup[20] = {'a', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'k', 'l',
+                           'm', 'n', 'p', 'q', 'r', 's', 't', 'v', 'w', 'y'};
+uint8_t nucleotideLookup[4] = {'a', 'g', 'c', 't'};
+
+#define FASTA_SRC "fastaReaderTest.fasta"
+#define CRLF_FASTA_SRC "fastaReaderTestCrlf.fasta"
+#define FASTA_INDEX_SRC "fastaIndex.awfmi"
+#define SEQUENCE_INDEX_SRC "sequenceIndex.awfmi"
+
+void testReaderMatchesFastaVector(const enum AwFmAlphabetType alphabet);
+void testReaderFromPipe(void);
+void testIndexFromFastaMatchesIndexFromSequence(
+    const enum AwFmAlphabetType alphabet, const bool storeOriginalSequence,
+    const bool lowMemory);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  for (size_t i = 0; i < 10; i++) {
+    testReaderMatchesFastaVector(AwFmAlphabetDna);
+    testReaderMatchesFastaVector(AwFmAlphabetAmino);
+  }
+  testReaderFromPipe();
+  for (size_t i = 0; i < 2; i++) {
+    for (int storeOriginal = 0; storeOriginal <= 1; storeOriginal++) {
+      for (int lowMemory = 0; lowMemory <= 1; lowMemory++) {
+        testIndexFromFastaMatchesIndexFromSequence(AwFmAlphabetDna,
+                                                   storeOriginal, lowMemory);
+        testIndexFromFastaMatchesIndexFromSequence(AwFmAlphabetAmino,
+                                                   storeOriginal, lowMemory);
+      }
+    }
+  }
+  remove(FASTA_SRC);
+  remove(CRLF_FASTA_SRC);
+  remove(FASTA_INDEX_SRC);
+  remove(SEQUENCE_INDEX_SRC);
+
+  printf("fasta reader testing finished.\n");
+}
+
+// writes a fasta with random records, headers, and line lengths, including
+// ambiguity codes and upper case residues. If crlfFile is not NULL, the same
+// fasta is also written there with "\r\n" line endings.
+void writeRandomFasta(const char *fileSrc, const char *crlfFileSrc,
+                      const enum AwFmAlphabetType alphabet,
+                      const size_t numRecords, const size_t maxRecordLength) {
+  FILE *files[2] = {fopen(fileSrc, "w"),
+                    crlfFileSrc != NULL ? fopen(crlfFileSrc, "w") : NULL};
+  const char *lineEndings[2] = {"\n", "\r\n"};
+  for (size_t record = 0; record < numRecords; record++) {
+    char header[64];
+    sprintf(header, ">record %zu description", record);
+    const size_t recordLength = rand() % maxRecordLength;
+    const size_t lineLength = 1 + rand() % 120;
+    for (size_t fileIndex = 0; fileIndex < 2; fileIndex++) {
+      if (files[fileIndex] != NULL) {
+        fprintf(files[fileIndex], "%s%s", header, lineEndings[fileIndex]);
+      }
+    }
+    for (size_t i = 0; i < recordLength; i++) {
+      uint8_t residue = alphabet == AwFmAlphabetAmino
+                            ? aminoLookup[rand() % 20]
+                            : nucleotideLookup[rand() % 4];
+      if (rand() % 50 == 0) {
+        residue = alphabet == AwFmAlphabetAmino ? 'x' : 'n';
+      }
+      if (rand() % 10 == 0) {
+        residue -= 0x20;
+      }
+      const bool endOfLine =
+          (i + 1) % lineLength == 0 || i + 1 == recordLength;
+      for (size_t fileIndex = 0; fileIndex < 2; fileIndex++) {
+        if (files[fileIndex] != NULL) {
+          fputc(residue, files[fileIndex]);
+          if (endOfLine) {
+            fputs(lineEndings[fileIndex], files[fileIndex]);
+          }
+        }
+      }
+    }
+  }
+  for (size_t fileIndex = 0; fileIndex < 2; fileIndex++) {
+    if (files[fileIndex] != NULL) {
+      fclose(files[fileIndex]);
+    }
+  }
+}
+
+// reads the fasta with awFmReadFastaForIndex and checks the sequence, headers,
+// and metadata against the fastaVector read the usual way.
+void compareWithFastaVector(const char *fastaSrc,
+                            const struct FastaVector *expected,
+                            const enum AwFmAlphabetType alphabet,
+                            const bool sanitize) {
+  struct FastaVector fastaVector;
+  fastaVectorInit(&fastaVector);
+  uint8_t *sequence = NULL;
+  size_t sequenceLength = 0;
+  enum AwFmReturnCode returnCode = awFmReadFastaForIndex(
+      fastaSrc, alphabet, sanitize, &fastaVector, &sequence, &sequenceLength);
+  sprintf(buffer, "reading fasta %s returned error code %i.", fastaSrc,
+          returnCode);
+  testAssertString(returnCode == AwFmSuccess, buffer);
+  if (returnCode != AwFmSuccess) {
+    fastaVectorDealloc(&fastaVector);
+    return;
+  }
+
+  sprintf(buffer, "fasta %s sequence length was %zu, expected %zu.", fastaSrc,
+          sequenceLength, expected->sequence.count);
+  testAssertString(sequenceLength == expected->sequence.count, buffer);
+  for (size_t i = 0; i < sequenceLength && i < expected->sequence.count; i++) {
+    const uint8_t expectedLetter =
+        !sanitize ? expected->sequence.charData[i]
+        : alphabet == AwFmAlphabetAmino
+            ? awFmAsciiAminoLetterSanitize(expected->sequence.charData[i])
+            : awFmAsciiNucleotideLetterSanitize(
+                  expected->sequence.charData[i]);
+    if (sequence[i] != expectedLetter) {
+      sprintf(buffer,
+              "fasta %s residue %zu was %c, expected %c (sanitize %i).",
+              fastaSrc, i, sequence[i], expectedLetter, sanitize);
+      testAssertString(false, buffer);
+      break;
+    }
+  }
+
+  testAssertString(fastaVector.header.count == expected->header.count &&
+                       memcmp(fastaVector.header.charData,
+                              expected->header.charData,
+                              expected->header.count) == 0,
+                   "headers did not match the fasta vector's headers.");
+  testAssertString(
+      fastaVector.metadata.count == expected->metadata.count &&
+          memcmp(fastaVector.metadata.data, expected->metadata.data,
+                 expected->metadata.count *
+                     sizeof(struct FastaVectorMetadata)) == 0,
+      "metadata did not match the fasta vector's metadata.");
+
+  free(sequence);
+  fastaVectorDealloc(&fastaVector);
+}
+
+void testReaderMatchesFastaVector(const enum AwFmAlphabetType alphabet) {
+  // large enough that some records span several read chunks.
+  const size_t maxRecordLength =
+      rand() % 2 ? 1000 : 3 * AW_FM_FASTA_READ_CHUNK_SIZE;
+  writeRandomFasta(FASTA_SRC, CRLF_FASTA_SRC, alphabet, 1 + rand() % 8,
+                   maxRecordLength);
+
+  struct FastaVector expected;
+  fastaVectorInit(&expected);
+  fastaVectorReadFasta(FASTA_SRC, &expected);
+
+  compareWithFastaVector(FASTA_SRC, &expected, alphabet, false);
+  compareWithFastaVector(FASTA_SRC, &expected, alphabet, true);
+  // line endings shouldn't change anything that's read.
+  compareWithFastaVector(CRLF_FASTA_SRC, &expected, alphabet, true);
+  fastaVectorDealloc(&expected);
+}
+
+// reads a fasta larger than the reader's starting buffer through a pipe, so
+// the buffer has to grow since the size isn't known up front.
+void testReaderFromPipe(void) {
+  writeRandomFasta(FASTA_SRC, NULL, AwFmAlphabetDna, 3, 12 * 1024 * 1024);
+  struct FastaVector expected;
+  fastaVectorInit(&expected);
+  fastaVectorReadFasta(FASTA_SRC, &expected);
+
+  int pipeDescriptors[2];
+  testAssertString(pipe(pipeDescriptors) == 0, "could not create pipe.");
+  const pid_t writerPid = fork();
+  if (writerPid == 0) {
+    close(pipeDescriptors[0]);
+    FILE *fastaFile = fopen(FASTA_SRC, "r");
+    char chunk[65536];
+    size_t bytesRead;
+    while ((bytesRead = fread(chunk, 1, sizeof(chunk), fastaFile)) != 0) {
+      if (write(pipeDescriptors[1], chunk, bytesRead) != (ssize_t)bytesRead) {
+        _exit(1);
+      }
+    }
+    _exit(0);
+  }
+  close(pipeDescriptors[1]);
+
+  char pipeSrc[64];
+  sprintf(pipeSrc, "/dev/fd/%i", pipeDescriptors[0]);
+  compareWithFastaVector(pipeSrc, &expected, AwFmAlphabetDna, true);
+  close(pipeDescriptors[0]);
+  waitpid(writerPid, NULL, 0);
+  fastaVectorDealloc(&expected);
+}
+
+// builds one index from a fasta and one from its concatenated sequence. The
+// two must have the same BWT, suffix array, and original sequence.
+void testIndexFromFastaMatchesIndexFromSequence(
+    const enum AwFmAlphabetType alphabet, const bool storeOriginalSequence,
+    const bool lowMemory) {
+  writeRandomFasta(FASTA_SRC, NULL, alphabet, 1 + rand() % 5, 20000);
+  struct FastaVector fastaVector;
+  fastaVectorInit(&fastaVector);
+  fastaVectorReadFasta(FASTA_SRC, &fastaVector);
+  const uint8_t *sequence = (uint8_t *)fastaVector.sequence.charData;
+  const size_t sequenceLength = fastaVector.sequence.count;
+
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 1 + rand() % 4,
+      .kmerLengthInSeedTable = alphabet == AwFmAlphabetAmino ? 3 : 6,
+      .alphabetType = alphabet,
+      .keepSuffixArrayInMemory = true,
+      .storeOriginalSequence = storeOriginalSequence};
+  const struct AwFmIndexBuildOptions options = {
+      .constructionMemoryBudget = lowMemory ? 64 * 1024 * 1024 : 0};
+  struct AwFmIndex *fastaIndex;
+  struct AwFmIndex *sequenceIndex;
+  enum AwFmReturnCode returnCode = awFmCreateIndexFromFastaWithOptions(
+      &fastaIndex, &config, FASTA_SRC, FASTA_INDEX_SRC, &options);
+  sprintf(buffer, "creating index from fasta returned error code %i.",
+          returnCode);
+  testAssertString(returnCode == AwFmFileWriteOkay, buffer);
+  returnCode =
+      awFmCreateIndexWithOptions(&sequenceIndex, &config, sequence,
+                                 sequenceLength, SEQUENCE_INDEX_SRC, &options);
+  sprintf(buffer, "creating index from sequence returned error code %i.",
+          returnCode);
+  testAssertString(returnCode == AwFmFileWriteOkay, buffer);
+  if (fastaIndex == NULL || sequenceIndex == NULL) {
+    fastaVectorDealloc(&fastaVector);
+    return;
+  }
+
+  testAssertString(fastaIndex->bwtLength == sequenceIndex->bwtLength,
+                   "index bwt lengths did not match.");
+  const size_t numBlocks = awFmNumBlocksFromBwtLength(fastaIndex->bwtLength);
+  const size_t blockBytes = alphabet == AwFmAlphabetAmino
+                                ? sizeof(struct AwFmAminoBlock)
+                                : sizeof(struct AwFmNucleotideBlock);
+  testAssertString(memcmp(fastaIndex->bwtBlockList.asNucleotide,
+                          sequenceIndex->bwtBlockList.asNucleotide,
+                          numBlocks * blockBytes) == 0,
+                   "bwt from fasta did not match bwt from sequence.");
+  testAssertString(
+      memcmp(fastaIndex->suffixArray.values, sequenceIndex->suffixArray.values,
+             fastaIndex->suffixArray.compressedByteLength) == 0,
+      "suffix array from fasta did not match suffix array from sequence.");
+
+  sprintf(buffer, "fasta index had %u sequences, expected %zu.",
+          awFmGetNumSequences(fastaIndex), fastaVector.metadata.count);
+  testAssertString(awFmGetNumSequences(fastaIndex) ==
+                       fastaVector.metadata.count,
+                   buffer);
+
+  if (storeOriginalSequence && sequenceLength > 0) {
+    char *storedSequence = malloc(sequenceLength + 1);
+    returnCode = awFmReadSequenceFromFile(fastaIndex, 0, sequenceLength,
+                                          storedSequence);
+    testAssertString(returnCode == AwFmFileReadOkay &&
+                         memcmp(storedSequence, sequence, sequenceLength) == 0,
+                     "stored sequence did not match the fasta's sequence.");
+    free(storedSequence);
+  }
+
+  awFmDeallocIndex(fastaIndex);
+  awFmDeallocIndex(sequenceIndex);
+  fastaVectorDealloc(&fastaVector);
+}
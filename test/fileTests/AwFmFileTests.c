@@ -21,12 +21,16 @@ uint8_t nucleotideLookup[5] = {'a', 'g', 'c', 't', '$'};
 void suffixArrayTest(void);
 void sequenceRecallTest(void);
 void indexReadTest(void);
+void parallelIndexReadTest(void);
+void versionCompatibilityTest(void);
 
 int main(int argc, char **argv) {
   srand(time(NULL));
   sequenceRecallTest();
   suffixArrayTest();
   indexReadTest();
+  parallelIndexReadTest();
+  versionCompatibilityTest();
 }
 
 void sequenceRecallTest(void) {
@@ -379,3 +383,188 @@ void indexReadTest(void) {
     awFmDeallocIndex(indexFromFile);
   }
 }
+
+// tests to make sure that the index read with awFmReadIndexFromFileParallel is
+// identical to the one read with awFmReadIndexFromFile.
+void parallelIndexReadTest(void) {
+  printf("beginning parallel index read test\n");
+  for (size_t testNum = 0; testNum < 40; testNum++) {
+    printf("test %zu\n", testNum);
+    const enum AwFmAlphabetType alphabetType =
+        rand() & 1 ? AwFmAlphabetDna : AwFmAlphabetAmino;
+    const bool keepSuffixArrayInMemory = rand() & 1;
+    const uint32_t numThreads = rand() % 8 + 1;
+
+    // write a small multi-sequence fasta so the FastaVector section is used.
+    FILE *fastaFile = fopen("testParallelLoad.fasta", "w");
+    const size_t numSequences = rand() % 5 + 1;
+    for (size_t sequenceNum = 0; sequenceNum < numSequences; sequenceNum++) {
+      fprintf(fastaFile, ">sequence %zu\n", sequenceNum);
+      const size_t sequenceLength = 1000 + rand() % 4000;
+      for (size_t i = 0; i < sequenceLength; i++) {
+        fputc(alphabetType == AwFmAlphabetDna ? nucleotideLookup[rand() % 4]
+                                              : aminoLookup[rand() % 20],
+              fastaFile);
+        if (i % 80 == 79) {
+          fputc('\n', fastaFile);
+        }
+      }
+      fputc('\n', fastaFile);
+    }
+    fclose(fastaFile);
+
+    struct AwFmIndex *index;
+    struct AwFmIndexConfiguration config = {.suffixArrayCompressionRatio =
+                                                rand() % 30 + 1,
+                                            .kmerLengthInSeedTable =
+                                                rand() % 3 + 2,
+                                            .alphabetType = alphabetType,
+                                            .keepSuffixArrayInMemory = false,
+                                            .storeOriginalSequence = rand() & 1};
+    enum AwFmReturnCode returnCode = awFmCreateIndexFromFasta(
+        &index, &config, "testParallelLoad.fasta", "testParallelLoad.awfmi");
+    sprintf(buffer, "creating the index returned error code %i", returnCode);
+    testAssertString(returnCode > 0, buffer);
+    awFmDeallocIndex(index);
+
+    struct AwFmIndex *serialIndex;
+    returnCode = awFmReadIndexFromFile(
+        &serialIndex, "testParallelLoad.awfmi", keepSuffixArrayInMemory);
+    sprintf(buffer, "serial read returned error code %i", returnCode);
+    testAssertString(returnCode > 0, buffer);
+
+    struct AwFmIndex *parallelIndex;
+    struct AwFmIndexLoadConfiguration loadConfig = {
+        .keepSuffixArrayInMemory = keepSuffixArrayInMemory,
+        .numThreads = numThreads,
+        .replicateAcrossNumaNodes = (rand() % 2) == 0,
+        .suffixArrayCacheCapacity = (rand() % 2) * 65536};
+    struct AwFmIndexLoadStatistics loadStatistics;
+    returnCode = awFmReadIndexFromFileParallel(
+        &parallelIndex, "testParallelLoad.awfmi", &loadConfig, &loadStatistics);
+    sprintf(buffer, "parallel read with %u threads returned error code %i",
+            numThreads, returnCode);
+    testAssertString(returnCode > 0, buffer);
+
+    testAssertString(serialIndex->bwtLength == parallelIndex->bwtLength,
+                     "bwt lengths did not match.");
+    testAssertString(serialIndex->featureFlags == parallelIndex->featureFlags,
+                     "feature flags did not match.");
+    testAssertString(memcmp(&serialIndex->config, &parallelIndex->config,
+                            sizeof(struct AwFmIndexConfiguration)) == 0,
+                     "configs did not match.");
+    testAssertString(serialIndex->suffixArrayFileOffset ==
+                         parallelIndex->suffixArrayFileOffset,
+                     "suffix array file offsets did not match.");
+    testAssertString(serialIndex->sequenceFileOffset ==
+                         parallelIndex->sequenceFileOffset,
+                     "sequence file offsets did not match.");
+
+    const size_t blockListLengthInBytes =
+        alphabetType == AwFmAlphabetAmino
+            ? awFmNumBlocksFromBwtLength(serialIndex->bwtLength) *
+                  sizeof(struct AwFmAminoBlock)
+            : awFmNumBlocksFromBwtLength(serialIndex->bwtLength) *
+                  sizeof(struct AwFmNucleotideBlock);
+    testAssertString(memcmp(serialIndex->bwtBlockList.asNucleotide,
+                            parallelIndex->bwtBlockList.asNucleotide,
+                            blockListLengthInBytes) == 0,
+                     "bwt block lists did not match.");
+    testAssertString(
+        memcmp(serialIndex->prefixSums, parallelIndex->prefixSums,
+               awFmGetPrefixSumsLength(alphabetType) * sizeof(uint64_t)) == 0,
+        "prefix sums did not match.");
+    testAssertString(memcmp(serialIndex->kmerSeedTable,
+                            parallelIndex->kmerSeedTable,
+                            awFmGetKmerTableLength(serialIndex) *
+                                sizeof(struct AwFmSearchRange)) == 0,
+                     "kmer seed tables did not match.");
+    if (keepSuffixArrayInMemory) {
+      testAssertString(memcmp(serialIndex->suffixArray.values,
+                              parallelIndex->suffixArray.values,
+                              serialIndex->suffixArray.compressedByteLength) ==
+                           0,
+                       "compressed suffix arrays did not match.");
+    } else {
+      testAssertString(parallelIndex->suffixArray.values == NULL,
+                       "suffix array was loaded when it should be on disk.");
+    }
+
+    const struct FastaVector *serialFastaVector = serialIndex->fastaVector;
+    const struct FastaVector *parallelFastaVector = parallelIndex->fastaVector;
+    testAssertString(serialFastaVector->header.count ==
+                         parallelFastaVector->header.count,
+                     "FastaVector header lengths did not match.");
+    testAssertString(memcmp(serialFastaVector->header.charData,
+                            parallelFastaVector->header.charData,
+                            serialFastaVector->header.count) == 0,
+                     "FastaVector headers did not match.");
+    testAssertString(serialFastaVector->metadata.count ==
+                         parallelFastaVector->metadata.count,
+                     "FastaVector metadata counts did not match.");
+    testAssertString(memcmp(serialFastaVector->metadata.data,
+                            parallelFastaVector->metadata.data,
+                            serialFastaVector->metadata.count *
+                                sizeof(struct FastaVectorMetadata)) == 0,
+                     "FastaVector metadata did not match.");
+
+    sprintf(buffer, "load statistics reported %zu bytes read, expected more.",
+            (size_t)loadStatistics.bytesRead);
+    testAssertString(loadStatistics.bytesRead >= blockListLengthInBytes,
+                     buffer);
+    testAssertString(loadStatistics.totalSeconds >= 0,
+                     "load statistics reported a negative total time.");
+
+    awFmDeallocIndex(serialIndex);
+    awFmDeallocIndex(parallelIndex);
+  }
+}
+
+// overwrites the version number that follows the file's 10 byte id header.
+void setIndexFileVersion(const char *fileSrc, const uint32_t versionNumber) {
+  FILE *file = fopen(fileSrc, "r+b");
+  fseek(file, 10, SEEK_SET);
+  fwrite(&versionNumber, sizeof(uint32_t), 1, file);
+  fclose(file);
+}
+
+void versionCompatibilityTest(void) {
+  printf("beginning version compatibility test\n");
+  const char *fileSrc = "testVersion.awfmi";
+  uint8_t sequence[1000];
+  for (size_t i = 0; i < sizeof(sequence); i++) {
+    sequence[i] = aminoLookup[rand() % 20];
+  }
+
+  for (uint8_t reduced = 0; reduced < 2; reduced++) {
+    struct AwFmIndexConfiguration config = {
+        .suffixArrayCompressionRatio = 4,
+        .kmerLengthInSeedTable = 2,
+        .alphabetType = reduced ? AwFmAlphabetReducedAmino : AwFmAlphabetAmino,
+        .keepSuffixArrayInMemory = true,
+        .storeOriginalSequence = false};
+    struct AwFmIndex *index;
+    enum AwFmReturnCode rc =
+        awFmCreateIndex(&index, &config, sequence, sizeof(sequence), fileSrc);
+    testAssertString(rc > 0, "index creation failed.");
+    awFmDeallocIndex(index);
+
+    // version 8 files predate reduced amino indices, so they can't hold one.
+    setIndexFileVersion(fileSrc, AW_FM_OLDEST_SUPPORTED_VERSION_NUMBER);
+    rc = awFmReadIndexFromFile(&index, fileSrc, true);
+    if (reduced) {
+      testAssertString(rc == AwFmFileFormatError,
+                       "a version 8 reduced amino index should be rejected.");
+    } else {
+      testAssertString(rc == AwFmFileReadOkay,
+                       "a version 8 amino index should still be read.");
+      awFmDeallocIndex(index);
+    }
+
+    setIndexFileVersion(fileSrc, AW_FM_CURRENT_VERSION_NUMBER + 1);
+    rc = awFmReadIndexFromFile(&index, fileSrc, true);
+    testAssertString(rc == AwFmUnsupportedVersionError,
+                     "a newer index version should be rejected.");
+  }
+  remove(fileSrc);
+}
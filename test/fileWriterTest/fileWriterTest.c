@@ -0,0 +1,112 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/AwFmFileWriter.h"
+#include "../../src/AwFmIndex.h"
+#include "../test.h"
+
+char buffer[2048];
+
+#define WRITER_TEST_FILE_SRC "fileWriterTest.bin"
+
+void testWritesMatchExpectedFile(const bool useDirectIo);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  for (size_t i = 0; i < 20; i++) {
+    testWritesMatchExpectedFile(false);
+    testWritesMatchExpectedFile(true);
+  }
+  remove(WRITER_TEST_FILE_SRC);
+
+  printf("file writer testing finished.\n");
+}
+
+// splits a random file into sections of random, mostly unaligned lengths,
+// queues them in a shuffled order, and checks the file that's written.
+void testWritesMatchExpectedFile(const bool useDirectIo) {
+  const size_t fileLength =
+      1 + rand() % (3 * AW_FM_FILE_WRITER_CHUNK_SIZE / (1 + rand() % 8));
+  uint8_t *expected = malloc(fileLength);
+  for (size_t i = 0; i < fileLength; i++) {
+    expected[i] = rand();
+  }
+
+  size_t sectionStarts[32];
+  size_t numSections = 0;
+  for (size_t position = 0; position < fileLength && numSections < 32;
+       numSections++) {
+    sectionStarts[numSections] = position;
+    position += 1 + rand() % (fileLength / 4 + 1);
+  }
+  size_t order[32];
+  for (size_t i = 0; i < numSections; i++) {
+    order[i] = i;
+  }
+  for (size_t i = numSections - 1; i > 0; i--) {
+    const size_t swapIndex = rand() % (i + 1);
+    const size_t temp = order[i];
+    order[i] = order[swapIndex];
+    order[swapIndex] = temp;
+  }
+
+  FILE *file = fopen(WRITER_TEST_FILE_SRC, "w+b");
+  struct AwFmFileWriter *writer =
+      awFmFileWriterCreate(fileno(file), WRITER_TEST_FILE_SRC, useDirectIo);
+  testAssertString(writer != NULL, "could not create file writer.");
+
+  for (size_t i = 0; i < numSections; i++) {
+    const size_t section = order[i];
+    const size_t sectionStart = sectionStarts[section];
+    const size_t sectionEnd = section + 1 < numSections
+                                  ? sectionStarts[section + 1]
+                                  : fileLength;
+    enum AwFmReturnCode returnCode;
+    if (rand() % 2) {
+      returnCode = awFmFileWriterSubmit(writer, expected + sectionStart,
+                                        sectionEnd - sectionStart,
+                                        sectionStart);
+    } else {
+      // the copy's source is clobbered right away, so the copy must be used.
+      uint8_t *source = malloc(sectionEnd - sectionStart);
+      memcpy(source, expected + sectionStart, sectionEnd - sectionStart);
+      returnCode = awFmFileWriterSubmitCopy(writer, source,
+                                            sectionEnd - sectionStart,
+                                            sectionStart);
+      memset(source, 0, sectionEnd - sectionStart);
+      free(source);
+    }
+    testAssertString(returnCode == AwFmSuccess,
+                     "could not queue a write on the file writer.");
+  }
+
+  double writeSeconds = -1;
+  double waitSeconds = -1;
+  enum AwFmReturnCode returnCode =
+      awFmFileWriterFinish(writer, &writeSeconds, &waitSeconds);
+  sprintf(buffer, "file writer finished with error code %i.", returnCode);
+  testAssertString(returnCode == AwFmFileWriteOkay, buffer);
+  testAssertString(writeSeconds >= 0 && waitSeconds >= 0,
+                   "file writer did not report its timing.");
+
+  uint8_t *written = malloc(fileLength + 1);
+  fseek(file, 0, SEEK_SET);
+  const size_t bytesRead = fread(written, 1, fileLength + 1, file);
+  sprintf(buffer, "written file had %zu bytes, expected %zu (direct io %i).",
+          bytesRead, fileLength, useDirectIo);
+  testAssertString(bytesRead == fileLength, buffer);
+  sprintf(buffer, "written file did not match the queued sections (direct io "
+                  "%i, %zu sections).",
+          useDirectIo, numSections);
+  testAssertString(
+      bytesRead == fileLength && memcmp(written, expected, fileLength) == 0,
+      buffer);
+
+  fclose(file);
+  free(written);
+  free(expected);
+}
@@ -323,10 +323,52 @@ void testCompressedAminos() {
   }
 }
 
+// every byte value, at lengths and offsets that exercise both the vector
+// loop and the scalar tail, in and out of place.
+void testSanitizeSequence() {
+  const size_t maxLength = 1000;
+  uint8_t *sequence = malloc(maxLength + 1);
+  uint8_t *sanitized = malloc(maxLength + 1);
+  for (size_t trial = 0; trial < 200; trial++) {
+    const size_t length = rand() % maxLength;
+    const size_t offset = rand() % 2;
+    for (size_t i = 0; i < length + offset; i++) {
+      sequence[i] = (i < 256) ? i : rand() % 256;
+    }
+    for (int alphabet = AwFmAlphabetAmino; alphabet <= AwFmAlphabetRna;
+         alphabet++) {
+      const bool inPlace = trial % 2 == 1;
+      uint8_t *destination = inPlace ? sequence + offset : sanitized + offset;
+      uint8_t *original = malloc(length + 1);
+      memcpy(original, sequence + offset, length);
+      awFmSanitizeSequence(sequence + offset, destination, length, alphabet);
+      for (size_t i = 0; i < length; i++) {
+        const uint8_t expected =
+            alphabet == AwFmAlphabetAmino
+                ? awFmAsciiAminoLetterSanitize(original[i])
+                : awFmAsciiNucleotideLetterSanitize(original[i]);
+        if (destination[i] != expected) {
+          sprintf(buffer,
+                  "sanitizing byte %u at position %zu gave %u, expected %u "
+                  "(alphabet %i).",
+                  original[i], i, destination[i], expected, alphabet);
+          testAssertString(false, buffer);
+          break;
+        }
+      }
+      memcpy(sequence + offset, original, length);
+      free(original);
+    }
+  }
+  free(sequence);
+  free(sanitized);
+}
+
 int main(int argc, char **argv) {
   srand(time(NULL));
   testNucleotideAscii();
   testAminoIndex();
   testCompressedAminos();
+  testSanitizeSequence();
   printf("letter tests finished\n");
 }
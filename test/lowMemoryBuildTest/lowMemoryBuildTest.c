@@ -0,0 +1,314 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/AwFmIndex.h"
+#include "../test.h"
+
+char buffer[2048];
+uint8_t aminoLookup[20] = {'a', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'k', 'l',
+                           'm', 'n', 'p', 'q', 'r', 's', 't', 'v', 'w', 'y'};
+uint8_t nucleotideLookup[4] = {'a', 'g', 'c', 't'};
+
+#define IN_MEMORY_INDEX_SRC "inMemoryIndex.awfmi"
+#define LOW_MEMORY_INDEX_SRC "lowMemoryIndex.awfmi"
+#define FASTA_SRC "lowMemoryBuildTest.fasta"
+
+void testLowMemoryBuildMatchesInMemoryBuild(
+    const enum AwFmAlphabetType alphabet, const bool fromFasta);
+void testInsufficientMemoryBudget(void);
+void checkBuildPhases(const struct AwFmBuildStatistics *statistics,
+                      const struct AwFmIndexConfiguration *config,
+                      const struct AwFmIndexBuildOptions *options,
+                      const bool fromFasta);
+void compareIndexFiles(const char *description);
+void compareLocateResults(struct AwFmIndex *inMemoryIndex,
+                          struct AwFmIndex *lowMemoryIndex,
+                          const uint8_t *sequence, const size_t sequenceLength);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  for (size_t i = 0; i < 4; i++) {
+    testLowMemoryBuildMatchesInMemoryBuild(AwFmAlphabetDna, false);
+    testLowMemoryBuildMatchesInMemoryBuild(AwFmAlphabetAmino, false);
+    testLowMemoryBuildMatchesInMemoryBuild(AwFmAlphabetDna, true);
+    testLowMemoryBuildMatchesInMemoryBuild(AwFmAlphabetAmino, true);
+  }
+  testInsufficientMemoryBudget();
+  remove(IN_MEMORY_INDEX_SRC);
+  remove(LOW_MEMORY_INDEX_SRC);
+  remove(FASTA_SRC);
+
+  printf("low memory build testing finished.\n");
+}
+
+uint8_t *makeSequence(const enum AwFmAlphabetType alphabet,
+                      const size_t sequenceLength) {
+  uint8_t *sequence = malloc(sequenceLength);
+  // repeat stretches of the sequence, so suffixes share long prefixes.
+  const size_t period = 1 + rand() % 5000;
+  for (size_t i = 0; i < sequenceLength; i++) {
+    if (i >= period && rand() % 100 != 0) {
+      sequence[i] = sequence[i - period];
+    } else if (rand() % 200 == 0) {
+      sequence[i] = alphabet == AwFmAlphabetAmino ? 'x' : 'n';
+    } else {
+      sequence[i] = alphabet == AwFmAlphabetAmino
+                        ? aminoLookup[rand() % 20]
+                        : nucleotideLookup[rand() % 4];
+    }
+  }
+  return sequence;
+}
+
+void writeFasta(const uint8_t *sequence, const size_t sequenceLength) {
+  FILE *fastaFile = fopen(FASTA_SRC, "w");
+  const size_t splitPosition = sequenceLength / 3;
+  fprintf(fastaFile, ">first\n");
+  fwrite(sequence, 1, splitPosition, fastaFile);
+  fprintf(fastaFile, "\n>second\n");
+  fwrite(sequence + splitPosition, 1, sequenceLength - splitPosition,
+         fastaFile);
+  fprintf(fastaFile, "\n");
+  fclose(fastaFile);
+}
+
+enum AwFmReturnCode createIndex(struct AwFmIndex **index,
+                                struct AwFmIndexConfiguration *config,
+                                const struct AwFmIndexBuildOptions *options,
+                                const uint8_t *sequence,
+                                const size_t sequenceLength,
+                                const bool fromFasta, const char *fileSrc) {
+  if (fromFasta) {
+    return awFmCreateIndexFromFastaWithOptions(index, config, FASTA_SRC,
+                                               fileSrc, options);
+  }
+  return awFmCreateIndexWithOptions(index, config, sequence, sequenceLength,
+                                    fileSrc, options);
+}
+
+void testLowMemoryBuildMatchesInMemoryBuild(
+    const enum AwFmAlphabetType alphabet, const bool fromFasta) {
+  const size_t sequenceLength = 50000 + rand() % 150000;
+  uint8_t *sequence = makeSequence(alphabet, sequenceLength);
+  if (fromFasta) {
+    writeFasta(sequence, sequenceLength);
+  }
+
+  struct AwFmBuildStatistics statistics;
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 1 + rand() % 20,
+      .kmerLengthInSeedTable = alphabet == AwFmAlphabetAmino ? 3 : 6,
+      .alphabetType = alphabet,
+      .keepSuffixArrayInMemory = rand() % 2,
+      .storeOriginalSequence = rand() % 2};
+  struct AwFmIndexBuildOptions options = {.constructionMemoryBudget = 0,
+                                          .buildStatistics = &statistics};
+
+  struct AwFmIndex *inMemoryIndex;
+  enum AwFmReturnCode returnCode =
+      createIndex(&inMemoryIndex, &config, &options, sequence, sequenceLength,
+                  fromFasta, IN_MEMORY_INDEX_SRC);
+  sprintf(buffer, "in memory build returned error code %i.", returnCode);
+  testAssertString(awFmReturnCodeIsSuccess(returnCode), buffer);
+  testAssertString(statistics.suffixArrayPartitions == 1,
+                   "in memory build should sort the suffix array at once.");
+  checkBuildPhases(&statistics, &config, &options, fromFasta);
+
+  // leaves the suffix sort about 2 bytes per position past the low memory
+  // build's own buffers, which forces the suffix array into many partitions.
+  // A kept suffix array also has to fit, after the sort. Sequences this short
+  // are sorted into a 32-bit suffix array by an in-memory build.
+  const size_t inMemorySuffixArrayBytes =
+      (sequenceLength + 1) * sizeof(uint32_t);
+  const size_t keptSuffixArrayBytes =
+      config.keepSuffixArrayInMemory ? sequenceLength * 4 : 0;
+  const size_t lowBudget = statistics.peakConstructionBytes -
+                           inMemorySuffixArrayBytes + (1024 * 1024) +
+                           (sequenceLength * 2) + keptSuffixArrayBytes;
+  const size_t budgets[2] = {lowBudget, lowBudget * 4};
+  for (uint8_t budgetIndex = 0; budgetIndex < 2; budgetIndex++) {
+    options.constructionMemoryBudget = budgets[budgetIndex];
+    struct AwFmIndex *lowMemoryIndex;
+    returnCode =
+        createIndex(&lowMemoryIndex, &config, &options, sequence,
+                    sequenceLength, fromFasta, LOW_MEMORY_INDEX_SRC);
+    sprintf(buffer, "low memory build with budget %zu returned error code %i.",
+            budgets[budgetIndex], returnCode);
+    testAssertString(awFmReturnCodeIsSuccess(returnCode), buffer);
+    if (!awFmReturnCodeIsSuccess(returnCode)) {
+      continue;
+    }
+
+    sprintf(buffer,
+            "low memory build used %zu bytes, over its budget of %zu bytes.",
+            statistics.peakConstructionBytes, budgets[budgetIndex]);
+    testAssertString(statistics.peakConstructionBytes <= budgets[budgetIndex],
+                     buffer);
+    testAssertString(statistics.differenceCoverPeriod != 0,
+                     "low memory build should report its sample period.");
+    checkBuildPhases(&statistics, &config, &options, fromFasta);
+    if (budgetIndex == 0) {
+      sprintf(buffer,
+              "tight budget sorted the suffix array in %u partitions, expected "
+              "more than 1.",
+              statistics.suffixArrayPartitions);
+      testAssertString(statistics.suffixArrayPartitions > 1, buffer);
+    }
+
+    sprintf(buffer, "%s index%s, budget %zu",
+            alphabet == AwFmAlphabetAmino ? "amino" : "nucleotide",
+            fromFasta ? " from fasta" : "", budgets[budgetIndex]);
+    compareIndexFiles(buffer);
+    compareLocateResults(inMemoryIndex, lowMemoryIndex, sequence,
+                         sequenceLength);
+    awFmDeallocIndex(lowMemoryIndex);
+  }
+
+  awFmDeallocIndex(inMemoryIndex);
+  free(sequence);
+}
+
+// every phase the build went through should have its time and peak memory
+// reported, and the phases it skipped should be left zeroed.
+void checkBuildPhases(const struct AwFmBuildStatistics *statistics,
+                      const struct AwFmIndexConfiguration *config,
+                      const struct AwFmIndexBuildOptions *options,
+                      const bool fromFasta) {
+  const bool lowMemory = options->constructionMemoryBudget != 0;
+  for (uint8_t phase = 0; phase < AW_FM_NUM_BUILD_PHASES; phase++) {
+    const struct AwFmBuildPhaseStatistics *phaseStatistics =
+        &statistics->phases[phase];
+    // fasta residues are sanitized while they're read, unless the original
+    // sequence is stored. Low memory builds set the BWT and suffix array
+    // samples while sorting.
+    const bool skipped =
+        (phase == AwFmBuildPhaseReadSequence && !fromFasta && !lowMemory) ||
+        (phase == AwFmBuildPhaseSanitize && fromFasta &&
+         !config->storeOriginalSequence) ||
+        (lowMemory && (phase == AwFmBuildPhaseBwt ||
+                       phase == AwFmBuildPhaseSuffixArraySampling));
+    if (skipped) {
+      sprintf(buffer, "skipped build phase %s should be zeroed.",
+              awFmGetBuildPhaseName(phase));
+      testAssertString(phaseStatistics->wallSeconds == 0 &&
+                           phaseStatistics->cpuSeconds == 0 &&
+                           phaseStatistics->peakResidentBytes == 0,
+                       buffer);
+    } else {
+      sprintf(buffer,
+              "build phase %s reported %f wall seconds, %f cpu seconds, and "
+              "%zu peak resident bytes.",
+              awFmGetBuildPhaseName(phase), phaseStatistics->wallSeconds,
+              phaseStatistics->cpuSeconds, phaseStatistics->peakResidentBytes);
+      testAssertString(phaseStatistics->wallSeconds >= 0 &&
+                           phaseStatistics->cpuSeconds >= 0 &&
+                           phaseStatistics->peakResidentBytes > 0,
+                       buffer);
+    }
+  }
+}
+
+uint8_t *readFile(const char *fileSrc, size_t *length) {
+  FILE *file = fopen(fileSrc, "rb");
+  fseek(file, 0, SEEK_END);
+  *length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *contents = malloc(*length);
+  if (fread(contents, 1, *length, file) != *length) {
+    *length = 0;
+  }
+  fclose(file);
+  return contents;
+}
+
+void compareIndexFiles(const char *description) {
+  size_t inMemoryLength, lowMemoryLength;
+  uint8_t *inMemoryFile = readFile(IN_MEMORY_INDEX_SRC, &inMemoryLength);
+  uint8_t *lowMemoryFile = readFile(LOW_MEMORY_INDEX_SRC, &lowMemoryLength);
+  char message[2560];
+  sprintf(message, "%s: file lengths differ, in memory %zu, low memory %zu.",
+          description, inMemoryLength, lowMemoryLength);
+  testAssertString(inMemoryLength == lowMemoryLength, message);
+  for (size_t i = 0; i < inMemoryLength && i < lowMemoryLength; i++) {
+    if (inMemoryFile[i] != lowMemoryFile[i]) {
+      sprintf(message, "%s: files first differ at byte %zu.", description, i);
+      testAssertString(false, message);
+      break;
+    }
+  }
+  free(inMemoryFile);
+  free(lowMemoryFile);
+}
+
+void compareLocateResults(struct AwFmIndex *inMemoryIndex,
+                          struct AwFmIndex *lowMemoryIndex,
+                          const uint8_t *sequence,
+                          const size_t sequenceLength) {
+  const size_t numKmers = 50;
+  const uint8_t kmerLength = 6;
+  struct AwFmKmerSearchList *inMemoryList = awFmCreateKmerSearchList(numKmers);
+  struct AwFmKmerSearchList *lowMemoryList = awFmCreateKmerSearchList(numKmers);
+  inMemoryList->count = numKmers;
+  lowMemoryList->count = numKmers;
+  for (size_t i = 0; i < numKmers; i++) {
+    const size_t kmerPosition = rand() % (sequenceLength - kmerLength);
+    inMemoryList->kmerSearchData[i].kmerLength = kmerLength;
+    inMemoryList->kmerSearchData[i].kmerString =
+        (char *)&sequence[kmerPosition];
+    lowMemoryList->kmerSearchData[i].kmerLength = kmerLength;
+    lowMemoryList->kmerSearchData[i].kmerString =
+        (char *)&sequence[kmerPosition];
+  }
+  awFmParallelSearchLocate(inMemoryIndex, inMemoryList, 2);
+  awFmParallelSearchLocate(lowMemoryIndex, lowMemoryList, 2);
+
+  for (size_t i = 0; i < numKmers; i++) {
+    const uint32_t count = inMemoryList->kmerSearchData[i].count;
+    sprintf(buffer, "kmer %zu located %u times, expected %u.", i,
+            lowMemoryList->kmerSearchData[i].count, count);
+    testAssertString(lowMemoryList->kmerSearchData[i].count == count, buffer);
+    if (lowMemoryList->kmerSearchData[i].count != count) {
+      continue;
+    }
+    for (uint32_t hit = 0; hit < count; hit++) {
+      if (inMemoryList->kmerSearchData[i].positionList[hit] !=
+          lowMemoryList->kmerSearchData[i].positionList[hit]) {
+        sprintf(buffer, "kmer %zu hit %u located at %zu, expected %zu.", i, hit,
+                lowMemoryList->kmerSearchData[i].positionList[hit],
+                inMemoryList->kmerSearchData[i].positionList[hit]);
+        testAssertString(false, buffer);
+        break;
+      }
+    }
+  }
+  awFmDeallocKmerSearchList(inMemoryList);
+  awFmDeallocKmerSearchList(lowMemoryList);
+}
+
+void testInsufficientMemoryBudget(void) {
+  const size_t sequenceLength = 100000;
+  uint8_t *sequence = makeSequence(AwFmAlphabetDna, sequenceLength);
+  struct AwFmIndexConfiguration config = {.suffixArrayCompressionRatio = 4,
+                                          .kmerLengthInSeedTable = 6,
+                                          .alphabetType = AwFmAlphabetDna,
+                                          .keepSuffixArrayInMemory = false,
+                                          .storeOriginalSequence = false};
+  const struct AwFmIndexBuildOptions options = {.constructionMemoryBudget =
+                                                    4096};
+  struct AwFmIndex *index;
+  enum AwFmReturnCode returnCode =
+      awFmCreateIndexWithOptions(&index, &config, sequence, sequenceLength,
+                                 LOW_MEMORY_INDEX_SRC, &options);
+  sprintf(buffer,
+          "build with a tiny budget returned code %i, expected "
+          "AwFmInsufficientMemoryBudget.",
+          returnCode);
+  testAssertString(returnCode == AwFmInsufficientMemoryBudget, buffer);
+  testAssertString(index == NULL,
+                   "index should be NULL after a failed low memory build.");
+  free(sequence);
+}
@@ -0,0 +1,160 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/AwFmIndex.h"
+#include "../test.h"
+
+char buffer[2048];
+const char nucleotideLetters[] = "acgt";
+const char aminoLetters[] = "acdefghiklmnpqrstvwy";
+
+#define INDEX_SRC "matchingStatisticsTest.awfmi"
+#define NUM_QUERIES 100
+#define MAX_QUERY_LENGTH 300
+
+void testMatchingStatistics(const enum AwFmAlphabetType alphabet,
+                            const size_t sequenceLength,
+                            const uint8_t kmerLengthInSeedTable);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  for (size_t i = 0; i < 3; i++) {
+    testMatchingStatistics(AwFmAlphabetDna, 1 + rand() % 20000, 1 + rand() % 8);
+    testMatchingStatistics(AwFmAlphabetAmino, 1 + rand() % 20000,
+                           1 + rand() % 4);
+  }
+  testMatchingStatistics(AwFmAlphabetDna, 3, 8);
+
+  remove(INDEX_SRC);
+  printf("matching statistics testing finished.\n");
+}
+
+char randomLetter(const enum AwFmAlphabetType alphabet) {
+  if (rand() % 300 == 0) {
+    return alphabet == AwFmAlphabetAmino ? 'x' : 'n';
+  }
+  return alphabet == AwFmAlphabetAmino ? aminoLetters[rand() % 20]
+                                       : nucleotideLetters[rand() % 4];
+}
+
+bool isAmbiguous(const enum AwFmAlphabetType alphabet, const char letter) {
+  return letter == (alphabet == AwFmAlphabetAmino ? 'x' : 'n');
+}
+
+// copies runs of the sequence with a few changes, so queries have long
+// matches that end at a mismatch.
+void makeQuery(const enum AwFmAlphabetType alphabet, const char *sequence,
+               const size_t sequenceLength, char *query,
+               const size_t queryLength) {
+  size_t sourcePosition = rand() % sequenceLength;
+  for (size_t i = 0; i < queryLength; i++) {
+    if (rand() % 40 == 0) {
+      sourcePosition = rand() % sequenceLength;
+    }
+    if (rand() % 30 == 0 || sourcePosition >= sequenceLength) {
+      query[i] = randomLetter(alphabet);
+    } else {
+      query[i] = sequence[sourcePosition];
+    }
+    sourcePosition++;
+  }
+}
+
+// length of the longest suffix of query[0, queryEnd] that occurs in the
+// sequence. Ambiguity letters in the query never match.
+size_t longestMatchEndingAt(const enum AwFmAlphabetType alphabet,
+                            const char *sequence, const size_t sequenceLength,
+                            const char *query, const size_t queryEnd) {
+  size_t longest = 0;
+  for (size_t end = 0; end < sequenceLength; end++) {
+    size_t length = 0;
+    while (length <= queryEnd && length <= end &&
+           !isAmbiguous(alphabet, query[queryEnd - length]) &&
+           query[queryEnd - length] == sequence[end - length]) {
+      length++;
+    }
+    longest = length > longest ? length : longest;
+  }
+  return longest;
+}
+
+void checkStatistics(const struct AwFmIndex *index,
+                     const enum AwFmAlphabetType alphabet, const char *sequence,
+                     const size_t sequenceLength,
+                     const struct AwFmMatchingStatisticsData *statisticsData) {
+  const char *query = statisticsData->queryString;
+  for (size_t queryEnd = 0; queryEnd < statisticsData->queryLength;
+       queryEnd++) {
+    const struct AwFmMatchingStatistic *statistic =
+        &statisticsData->statistics[queryEnd];
+    const size_t expectedLength = longestMatchEndingAt(
+        alphabet, sequence, sequenceLength, query, queryEnd);
+    sprintf(buffer, "position %zu expected match length %zu, got %lu.",
+            queryEnd, expectedLength, statistic->length);
+    testAssertString(statistic->length == expectedLength, buffer);
+    if (expectedLength == 0 || statistic->length != expectedLength) {
+      continue;
+    }
+
+    const struct AwFmSearchRange expectedRange = awFmFindSearchRangeForString(
+        index, query + queryEnd + 1 - expectedLength, expectedLength);
+    sprintf(buffer, "position %zu expected range %lu-%lu, got %lu-%lu.",
+            queryEnd, expectedRange.startPtr, expectedRange.endPtr,
+            statistic->range.startPtr, statistic->range.endPtr);
+    testAssertString(statistic->range.startPtr == expectedRange.startPtr &&
+                         statistic->range.endPtr == expectedRange.endPtr,
+                     buffer);
+  }
+}
+
+void testMatchingStatistics(const enum AwFmAlphabetType alphabet,
+                            const size_t sequenceLength,
+                            const uint8_t kmerLengthInSeedTable) {
+  char *sequence = malloc(sequenceLength);
+  for (size_t i = 0; i < sequenceLength; i++) {
+    sequence[i] = randomLetter(alphabet);
+  }
+
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 8,
+      .kmerLengthInSeedTable = kmerLengthInSeedTable,
+      .alphabetType = alphabet,
+      .keepSuffixArrayInMemory = false,
+      .storeOriginalSequence = false};
+  struct AwFmIndex *index;
+  enum AwFmReturnCode returnCode = awFmCreateIndex(
+      &index, &config, (uint8_t *)sequence, sequenceLength, INDEX_SRC);
+  testAssertString(returnCode == AwFmFileWriteOkay, "index creation failed.");
+
+  struct AwFmMatchingStatisticsList *statisticsList =
+      awFmCreateMatchingStatisticsList(NUM_QUERIES);
+  char *queries = malloc(NUM_QUERIES * MAX_QUERY_LENGTH);
+  statisticsList->count = NUM_QUERIES;
+  // searches twice, so the second search reuses the statistics arrays.
+  for (uint8_t round = 0; round < 2; round++) {
+    for (size_t i = 0; i < NUM_QUERIES; i++) {
+      char *query = queries + (i * MAX_QUERY_LENGTH);
+      const size_t queryLength = 1 + rand() % MAX_QUERY_LENGTH;
+      makeQuery(alphabet, sequence, sequenceLength, query, queryLength);
+      statisticsList->statisticsData[i].queryString = query;
+      statisticsList->statisticsData[i].queryLength = queryLength;
+    }
+
+    returnCode = awFmParallelMatchingStatistics(index, statisticsList, 4);
+    testAssertString(returnCode == AwFmSuccess,
+                     "matching statistics search failed.");
+    for (size_t i = 0; i < NUM_QUERIES; i++) {
+      checkStatistics(index, alphabet, sequence, sequenceLength,
+                      &statisticsList->statisticsData[i]);
+    }
+  }
+
+  awFmDeallocMatchingStatisticsList(statisticsList);
+  awFmDeallocIndex(index);
+  free(queries);
+  free(sequence);
+}
@@ -0,0 +1,330 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/AwFmIndex.h"
+#include "../test.h"
+
+char buffer[2048];
+uint8_t aminoLookup[20] = {'a', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'k', 'l',
+                           'm', 'n', 'p', 'q', 'r', 's', 't', 'v', 'w', 'y'};
+uint8_t nucleotideLookup[4] = {'a', 'g', 'c', 't'};
+
+#define FIRST_INDEX_SRC "mergeFirst.awfmi"
+#define SECOND_INDEX_SRC "mergeSecond.awfmi"
+#define MERGED_INDEX_SRC "merged.awfmi"
+#define EXPECTED_INDEX_SRC "mergeExpected.awfmi"
+#define FASTA_SRC "mergeTest.fasta"
+
+struct MergeInput {
+  uint8_t *sequence;
+  size_t sequenceLength;
+  bool fromFasta;
+  // number of fasta records the sequence is split into.
+  uint8_t numRecords;
+};
+
+void testMergeMatchesFastaBuild(const enum AwFmAlphabetType alphabet,
+                                const size_t firstLength,
+                                const size_t secondLength);
+void testSelfMerge(void);
+void testIncompatibleIndices(void);
+void compareIndexFiles(const char *description);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  for (size_t i = 0; i < 6; i++) {
+    testMergeMatchesFastaBuild(AwFmAlphabetDna, 1 + rand() % 20000,
+                               1000 + rand() % 100000);
+    testMergeMatchesFastaBuild(AwFmAlphabetAmino, 1 + rand() % 20000,
+                               1000 + rand() % 100000);
+  }
+  // single letter sequences, and a first index larger than the second.
+  testMergeMatchesFastaBuild(AwFmAlphabetDna, 1, 1);
+  testMergeMatchesFastaBuild(AwFmAlphabetDna, 50000, 300);
+  testMergeMatchesFastaBuild(AwFmAlphabetAmino, 300, 1);
+  testSelfMerge();
+  testIncompatibleIndices();
+
+  remove(FIRST_INDEX_SRC);
+  remove(SECOND_INDEX_SRC);
+  remove(MERGED_INDEX_SRC);
+  remove(EXPECTED_INDEX_SRC);
+  remove(FASTA_SRC);
+  printf("merge testing finished.\n");
+}
+
+uint8_t randomLetter(const enum AwFmAlphabetType alphabet) {
+  if (rand() % 200 == 0) {
+    return alphabet == AwFmAlphabetAmino ? 'x' : 'n';
+  }
+  return alphabet == AwFmAlphabetAmino ? aminoLookup[rand() % 20]
+                                       : nucleotideLookup[rand() % 4];
+}
+
+// repeats stretches of the sequence, and of the other sequence if given, so
+// suffixes of the two share long prefixes.
+uint8_t *makeSequence(const enum AwFmAlphabetType alphabet,
+                      const size_t sequenceLength, const uint8_t *other,
+                      const size_t otherLength) {
+  uint8_t *sequence = malloc(sequenceLength);
+  const size_t period = 1 + rand() % 500;
+  for (size_t i = 0; i < sequenceLength; i++) {
+    if (other != NULL && rand() % 2000 == 0) {
+      // copy a run of the other sequence.
+      const size_t runStart = rand() % otherLength;
+      for (size_t j = runStart; j < otherLength && i < sequenceLength;
+           j++, i++) {
+        sequence[i] = other[j];
+      }
+      i--;
+    } else if (i >= period && rand() % 100 != 0) {
+      sequence[i] = sequence[i - period];
+    } else {
+      sequence[i] = randomLetter(alphabet);
+    }
+  }
+  return sequence;
+}
+
+// writes the input's records to the open fasta. Inputs built from a sequence
+// are written as a single record with an empty header.
+void writeFastaRecords(FILE *fastaFile, const struct MergeInput *input,
+                       const char *name) {
+  if (!input->fromFasta) {
+    fprintf(fastaFile, ">\n");
+    fwrite(input->sequence, 1, input->sequenceLength, fastaFile);
+    fprintf(fastaFile, "\n");
+    return;
+  }
+  size_t recordStart = 0;
+  for (uint8_t record = 0; record < input->numRecords; record++) {
+    const size_t recordEnd =
+        record + 1 == input->numRecords
+            ? input->sequenceLength
+            : recordStart + (input->sequenceLength - recordStart) / 2;
+    fprintf(fastaFile, ">%s record %u\n", name, record);
+    fwrite(input->sequence + recordStart, 1, recordEnd - recordStart,
+           fastaFile);
+    fprintf(fastaFile, "\n");
+    recordStart = recordEnd;
+  }
+}
+
+enum AwFmReturnCode createInputIndex(struct AwFmIndex **index,
+                                     struct AwFmIndexConfiguration *config,
+                                     const struct MergeInput *input,
+                                     const char *name, const char *fileSrc) {
+  if (!input->fromFasta) {
+    return awFmCreateIndex(index, config, input->sequence,
+                           input->sequenceLength, fileSrc);
+  }
+  FILE *fastaFile = fopen(FASTA_SRC, "w");
+  writeFastaRecords(fastaFile, input, name);
+  fclose(fastaFile);
+  return awFmCreateIndexFromFasta(index, config, FASTA_SRC, fileSrc);
+}
+
+void testMergeMatchesFastaBuild(const enum AwFmAlphabetType alphabet,
+                                const size_t firstLength,
+                                const size_t secondLength) {
+  struct MergeInput first = {.sequenceLength = firstLength,
+                             .fromFasta = rand() % 2,
+                             .numRecords = 1 + rand() % 3};
+  struct MergeInput second = {.sequenceLength = secondLength,
+                              .fromFasta = rand() % 2,
+                              .numRecords = 1 + rand() % 3};
+  second.sequence = makeSequence(alphabet, secondLength, NULL, 0);
+  first.sequence =
+      makeSequence(alphabet, firstLength, second.sequence, secondLength);
+  // records need at least a letter each.
+  if (firstLength < 4) {
+    first.numRecords = 1;
+  }
+  if (secondLength < 4) {
+    second.numRecords = 1;
+  }
+
+  struct AwFmBuildStatistics statistics;
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 1 + rand() % 20,
+      .kmerLengthInSeedTable = alphabet == AwFmAlphabetAmino ? 3 : 6,
+      .alphabetType = alphabet,
+      .keepSuffixArrayInMemory = rand() % 2,
+      .storeOriginalSequence = rand() % 2};
+
+  struct AwFmIndex *firstIndex;
+  struct AwFmIndex *secondIndex;
+  enum AwFmReturnCode returnCode = createInputIndex(
+      &firstIndex, &config, &first, "first", FIRST_INDEX_SRC);
+  testAssertString(awFmReturnCodeIsSuccess(returnCode),
+                   "could not build the first index.");
+  returnCode = createInputIndex(&secondIndex, &config, &second, "second",
+                                SECOND_INDEX_SRC);
+  testAssertString(awFmReturnCodeIsSuccess(returnCode),
+                   "could not build the second index.");
+
+  FILE *fastaFile = fopen(FASTA_SRC, "w");
+  writeFastaRecords(fastaFile, &first, "first");
+  writeFastaRecords(fastaFile, &second, "second");
+  fclose(fastaFile);
+  struct AwFmIndex *expectedIndex;
+  returnCode = awFmCreateIndexFromFasta(&expectedIndex, &config, FASTA_SRC,
+                                        EXPECTED_INDEX_SRC);
+  testAssertString(awFmReturnCodeIsSuccess(returnCode),
+                   "could not build the expected index.");
+
+  const struct AwFmIndexBuildOptions options = {.buildStatistics =
+                                                    &statistics};
+  struct AwFmIndex *mergedIndex;
+  returnCode = awFmMergeIndices(&mergedIndex, &config, firstIndex, secondIndex,
+                                MERGED_INDEX_SRC, &options);
+  sprintf(buffer, "merge returned error code %i.", returnCode);
+  testAssertString(returnCode == AwFmFileWriteOkay, buffer);
+  if (returnCode == AwFmFileWriteOkay) {
+    testAssertString(
+        statistics.phases[AwFmBuildPhaseSuffixSort].peakResidentBytes > 0 &&
+            statistics.phases[AwFmBuildPhaseBwt].peakResidentBytes > 0,
+        "merge should report its suffix sort and BWT phases.");
+    sprintf(buffer,
+            "%s merge of %zu letters (%s) and %zu letters (%s), ratio %u, "
+            "stored sequence %i",
+            alphabet == AwFmAlphabetAmino ? "amino" : "nucleotide",
+            firstLength, first.fromFasta ? "fasta" : "sequence", secondLength,
+            second.fromFasta ? "fasta" : "sequence",
+            config.suffixArrayCompressionRatio, config.storeOriginalSequence);
+    compareIndexFiles(buffer);
+    testAssertString(mergedIndex->bwtLength == expectedIndex->bwtLength,
+                     "merged index has the wrong BWT length.");
+    awFmDeallocIndex(mergedIndex);
+  }
+
+  awFmDeallocIndex(firstIndex);
+  awFmDeallocIndex(secondIndex);
+  awFmDeallocIndex(expectedIndex);
+  free(first.sequence);
+  free(second.sequence);
+}
+
+// an index merged with itself is the index of its sequence repeated twice.
+void testSelfMerge(void) {
+  struct MergeInput input = {.sequenceLength = 5000 + rand() % 5000,
+                             .fromFasta = false,
+                             .numRecords = 1};
+  input.sequence = makeSequence(AwFmAlphabetDna, input.sequenceLength, NULL, 0);
+  struct AwFmIndexConfiguration config = {.suffixArrayCompressionRatio = 4,
+                                          .kmerLengthInSeedTable = 5,
+                                          .alphabetType = AwFmAlphabetDna,
+                                          .keepSuffixArrayInMemory = true,
+                                          .storeOriginalSequence = true};
+  struct AwFmIndex *index;
+  enum AwFmReturnCode returnCode =
+      createInputIndex(&index, &config, &input, "self", FIRST_INDEX_SRC);
+  testAssertString(awFmReturnCodeIsSuccess(returnCode),
+                   "could not build the index to merge with itself.");
+
+  FILE *fastaFile = fopen(FASTA_SRC, "w");
+  writeFastaRecords(fastaFile, &input, "self");
+  writeFastaRecords(fastaFile, &input, "self");
+  fclose(fastaFile);
+  struct AwFmIndex *expectedIndex;
+  returnCode = awFmCreateIndexFromFasta(&expectedIndex, &config, FASTA_SRC,
+                                        EXPECTED_INDEX_SRC);
+  testAssertString(awFmReturnCodeIsSuccess(returnCode),
+                   "could not build the expected index of the repeat.");
+
+  struct AwFmIndex *mergedIndex;
+  returnCode =
+      awFmMergeIndices(&mergedIndex, &config, index, index, MERGED_INDEX_SRC,
+                       NULL);
+  sprintf(buffer, "merging an index with itself returned error code %i.",
+          returnCode);
+  testAssertString(returnCode == AwFmFileWriteOkay, buffer);
+  if (returnCode == AwFmFileWriteOkay) {
+    compareIndexFiles("self merge");
+    awFmDeallocIndex(mergedIndex);
+  }
+  awFmDeallocIndex(index);
+  awFmDeallocIndex(expectedIndex);
+  free(input.sequence);
+}
+
+void testIncompatibleIndices(void) {
+  const size_t sequenceLength = 2000;
+  uint8_t *dnaSequence = makeSequence(AwFmAlphabetDna, sequenceLength, NULL, 0);
+  uint8_t *aminoSequence =
+      makeSequence(AwFmAlphabetAmino, sequenceLength, NULL, 0);
+  struct AwFmIndexConfiguration config = {.suffixArrayCompressionRatio = 4,
+                                          .kmerLengthInSeedTable = 4,
+                                          .alphabetType = AwFmAlphabetDna,
+                                          .storeOriginalSequence = false};
+  struct AwFmIndex *dnaIndex;
+  awFmCreateIndex(&dnaIndex, &config, dnaSequence, sequenceLength,
+                  FIRST_INDEX_SRC);
+  config.alphabetType = AwFmAlphabetAmino;
+  config.kmerLengthInSeedTable = 2;
+  struct AwFmIndex *aminoIndex;
+  awFmCreateIndex(&aminoIndex, &config, aminoSequence, sequenceLength,
+                  SECOND_INDEX_SRC);
+
+  struct AwFmIndex *mergedIndex;
+  enum AwFmReturnCode returnCode = awFmMergeIndices(
+      &mergedIndex, &config, dnaIndex, aminoIndex, MERGED_INDEX_SRC, NULL);
+  sprintf(buffer,
+          "merging indices of different alphabets returned %i, expected "
+          "AwFmIncompatibleIndices.",
+          returnCode);
+  testAssertString(returnCode == AwFmIncompatibleIndices, buffer);
+  testAssertString(mergedIndex == NULL,
+                   "merged index should be NULL after a failed merge.");
+
+  // neither index stores its original sequence to copy.
+  config.storeOriginalSequence = true;
+  returnCode = awFmMergeIndices(&mergedIndex, &config, aminoIndex, aminoIndex,
+                                MERGED_INDEX_SRC, NULL);
+  sprintf(buffer,
+          "merging indices without stored sequences returned %i, expected "
+          "AwFmIncompatibleIndices.",
+          returnCode);
+  testAssertString(returnCode == AwFmIncompatibleIndices, buffer);
+
+  awFmDeallocIndex(dnaIndex);
+  awFmDeallocIndex(aminoIndex);
+  free(dnaSequence);
+  free(aminoSequence);
+}
+
+uint8_t *readFile(const char *fileSrc, size_t *length) {
+  FILE *file = fopen(fileSrc, "rb");
+  fseek(file, 0, SEEK_END);
+  *length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *contents = malloc(*length);
+  if (fread(contents, 1, *length, file) != *length) {
+    *length = 0;
+  }
+  fclose(file);
+  return contents;
+}
+
+void compareIndexFiles(const char *description) {
+  size_t expectedLength, mergedLength;
+  uint8_t *expectedFile = readFile(EXPECTED_INDEX_SRC, &expectedLength);
+  uint8_t *mergedFile = readFile(MERGED_INDEX_SRC, &mergedLength);
+  char message[2560];
+  sprintf(message, "%s: file lengths differ, expected %zu, merged %zu.",
+          description, expectedLength, mergedLength);
+  testAssertString(expectedLength == mergedLength, message);
+  for (size_t i = 0; i < expectedLength && i < mergedLength; i++) {
+    if (expectedFile[i] != mergedFile[i]) {
+      sprintf(message, "%s: files first differ at byte %zu.", description, i);
+      testAssertString(false, message);
+      break;
+    }
+  }
+  free(expectedFile);
+  free(mergedFile);
+}
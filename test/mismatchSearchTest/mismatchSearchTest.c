@@ -0,0 +1,173 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/AwFmIndex.h"
+#include "../test.h"
+
+char buffer[2048];
+const char nucleotideLetters[] = "acgt";
+const char aminoLetters[] = "acdefghiklmnpqrstvwy";
+
+#define INDEX_SRC "mismatchSearchTest.awfmi"
+#define NUM_KMERS 200
+#define MAX_KMER_LENGTH 20
+
+void testMismatchSearch(const enum AwFmAlphabetType alphabet,
+                        const size_t sequenceLength,
+                        const uint8_t maxMismatches, const bool locate);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  for (uint8_t maxMismatches = 0; maxMismatches <= 3; maxMismatches++) {
+    testMismatchSearch(AwFmAlphabetDna, 1 + rand() % 20000, maxMismatches,
+                       maxMismatches % 2);
+    testMismatchSearch(AwFmAlphabetAmino, 1 + rand() % 20000, maxMismatches,
+                       maxMismatches % 2 == 0);
+  }
+
+  remove(INDEX_SRC);
+  printf("mismatch search testing finished.\n");
+}
+
+char randomLetter(const enum AwFmAlphabetType alphabet) {
+  if (rand() % 300 == 0) {
+    return alphabet == AwFmAlphabetAmino ? 'x' : 'n';
+  }
+  return alphabet == AwFmAlphabetAmino ? aminoLetters[rand() % 20]
+                                       : nucleotideLetters[rand() % 4];
+}
+
+// ambiguity letters in the kmer never match, even against each other.
+size_t hammingDistance(const enum AwFmAlphabetType alphabet, const char *kmer,
+                       const char *sequence, const size_t kmerLength) {
+  const char ambiguityLetter = alphabet == AwFmAlphabetAmino ? 'x' : 'n';
+  size_t distance = 0;
+  for (size_t i = 0; i < kmerLength; i++) {
+    distance += kmer[i] == ambiguityLetter || kmer[i] != sequence[i];
+  }
+  return distance;
+}
+
+int comparePositions(const void *a, const void *b) {
+  const uint64_t x = *(const uint64_t *)a;
+  const uint64_t y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+void checkHits(const enum AwFmAlphabetType alphabet, const char *sequence,
+               const size_t sequenceLength,
+               const struct AwFmMismatchSearchData *searchData,
+               const uint8_t maxMismatches, const bool locate) {
+  const char *kmer = searchData->kmerString;
+  const size_t kmerLength = searchData->kmerLength;
+  uint64_t *expectedPositions = malloc(sequenceLength * sizeof(uint64_t));
+  size_t numExpected = 0;
+  for (size_t start = 0; start + kmerLength <= sequenceLength; start++) {
+    if (hammingDistance(alphabet, kmer, sequence + start, kmerLength) <=
+        maxMismatches) {
+      expectedPositions[numExpected++] = start;
+    }
+  }
+
+  uint64_t *foundPositions = malloc((numExpected + 1) * sizeof(uint64_t));
+  size_t numFound = 0;
+  for (uint32_t i = 0; i < searchData->count; i++) {
+    const struct AwFmMismatchHit *hit = &searchData->hits[i];
+    testAssertString(hit->range.startPtr <= hit->range.endPtr,
+                     "hits should have nonempty ranges.");
+    testAssertString(hit->numMismatches <= maxMismatches,
+                     "hit has too many mismatches.");
+    const uint64_t rangeLength = hit->range.endPtr - hit->range.startPtr + 1;
+    if (!locate) {
+      testAssertString(hit->positionList == NULL,
+                       "position list should not be set without locate.");
+      numFound += rangeLength;
+      continue;
+    }
+    for (uint64_t j = 0; j < rangeLength; j++) {
+      const uint64_t position = hit->positionList[j];
+      const bool isExpected =
+          position + kmerLength <= sequenceLength &&
+          hammingDistance(alphabet, kmer, sequence + position, kmerLength) ==
+              hit->numMismatches;
+      sprintf(buffer, "kmer %.*s hit at %lu isn't %u mismatches away.",
+              (int)kmerLength, kmer, position, hit->numMismatches);
+      testAssertString(isExpected, buffer);
+      if (numFound < numExpected) {
+        foundPositions[numFound] = position;
+      }
+      numFound++;
+    }
+  }
+
+  sprintf(buffer, "kmer %.*s with %u mismatches expected %zu hits, got %zu.",
+          (int)kmerLength, kmer, maxMismatches, numExpected, numFound);
+  testAssertString(numFound == numExpected, buffer);
+  if (locate && numFound == numExpected) {
+    qsort(foundPositions, numFound, sizeof(uint64_t), comparePositions);
+    testAssertString(memcmp(foundPositions, expectedPositions,
+                            numFound * sizeof(uint64_t)) == 0,
+                     "located positions didn't match the expected hits.");
+  }
+  free(foundPositions);
+  free(expectedPositions);
+}
+
+void testMismatchSearch(const enum AwFmAlphabetType alphabet,
+                        const size_t sequenceLength,
+                        const uint8_t maxMismatches, const bool locate) {
+  char *sequence = malloc(sequenceLength);
+  for (size_t i = 0; i < sequenceLength; i++) {
+    sequence[i] = randomLetter(alphabet);
+  }
+
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 8,
+      .kmerLengthInSeedTable = alphabet == AwFmAlphabetAmino ? 2 : 4,
+      .alphabetType = alphabet,
+      .keepSuffixArrayInMemory = rand() % 2,
+      .storeOriginalSequence = false};
+  struct AwFmIndex *index;
+  enum AwFmReturnCode returnCode = awFmCreateIndex(
+      &index, &config, (uint8_t *)sequence, sequenceLength, INDEX_SRC);
+  testAssertString(returnCode == AwFmFileWriteOkay, "index creation failed.");
+
+  struct AwFmMismatchSearchList *searchList =
+      awFmCreateMismatchSearchList(NUM_KMERS);
+  char *kmers = malloc(NUM_KMERS * MAX_KMER_LENGTH);
+  searchList->count = NUM_KMERS;
+  // searches twice, to check the second search replaces the first's hits.
+  for (uint8_t round = 0; round < 2; round++) {
+    for (size_t i = 0; i < NUM_KMERS; i++) {
+      // copies of database kmers with a few substitutions, so most have hits.
+      char *kmer = kmers + (i * MAX_KMER_LENGTH);
+      const size_t kmerLength = 1 + rand() % MAX_KMER_LENGTH;
+      const size_t sourcePosition = rand() % sequenceLength;
+      for (size_t j = 0; j < kmerLength; j++) {
+        kmer[j] = sourcePosition + j < sequenceLength && rand() % 8 != 0
+                      ? sequence[sourcePosition + j]
+                      : randomLetter(alphabet);
+      }
+      searchList->mismatchSearchData[i].kmerString = kmer;
+      searchList->mismatchSearchData[i].kmerLength = kmerLength;
+    }
+
+    returnCode = awFmParallelSearchMismatches(index, searchList, maxMismatches,
+                                              locate, 4);
+    sprintf(buffer, "mismatch search returned %d.", returnCode);
+    testAssertString(returnCode == AwFmSuccess, buffer);
+    for (size_t i = 0; i < NUM_KMERS; i++) {
+      checkHits(alphabet, sequence, sequenceLength,
+                &searchList->mismatchSearchData[i], maxMismatches, locate);
+    }
+  }
+
+  awFmDeallocMismatchSearchList(searchList);
+  awFmDeallocIndex(index);
+  free(kmers);
+  free(sequence);
+}
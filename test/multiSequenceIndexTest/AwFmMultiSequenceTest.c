@@ -106,7 +106,7 @@ void getRawSequenceFromFastaVector(const struct FastaVector *const fastaVector,
 }
 
 struct AwFmIndexConfiguration generateReasonableRandomMetadata() {
-  struct AwFmIndexConfiguration config;
+  struct AwFmIndexConfiguration config = {0};
   config.suffixArrayCompressionRatio = (rand() % 20) + 1;
   config.alphabetType = (rand() % 2) == 0 ? AwFmAlphabetAmino : AwFmAlphabetDna;
   config.kmerLengthInSeedTable = config.alphabetType == AwFmAlphabetDna
@@ -207,35 +207,33 @@ void testAwFmIndexFastaVectorDataMatchesExpected(void) {
     testAssertString(awFmRc == AwFmFileWriteOkay,
                      "creating fastaVector index did not return AwFmSuccess.");
 
-    // compare the fasta sequence
+    // compare the fasta sequence. The sequence is streamed into the index
+    // rather than kept in its fastaVector, so it's read back from the file.
     sprintf(buffer,
-            "sequence count %zu did not match original fastaVector count %zu.",
-            fastaVectorIndex->fastaVector->sequence.count,
-            fastaVector->sequence.count);
-    testAssertString(fastaVectorIndex->fastaVector->sequence.count ==
-                         fastaVector->sequence.count,
-                     buffer);
-
-    sprintf(buffer, "sequence count %zu greater than capacity %zu",
-            fastaVectorIndex->fastaVector->sequence.count,
-            fastaVectorIndex->fastaVector->sequence.capacity);
-    testAssertString(fastaVectorIndex->fastaVector->sequence.capacity >=
-                         fastaVectorIndex->fastaVector->sequence.count,
+            "bwt length %zu did not match original fastaVector count %zu.",
+            fastaVectorIndex->bwtLength, fastaVector->sequence.count);
+    testAssertString(fastaVectorIndex->bwtLength ==
+                         fastaVector->sequence.count + 1,
                      buffer);
 
+    char *storedSequence = malloc(fastaVector->sequence.count + 1);
+    awFmRc = awFmReadSequenceFromFile(fastaVectorIndex, 0,
+                                      fastaVector->sequence.count,
+                                      storedSequence);
+    testAssertString(awFmRc == AwFmFileReadOkay,
+                     "reading the stored sequence did not return read okay.");
     for (size_t letterIndex = 0; letterIndex < fastaVector->sequence.count;
          letterIndex++) {
       sprintf(buffer,
               "letter in sequence at index %zu from index %u did not match "
               "from fastaVector %u",
-              letterIndex,
-              fastaVectorIndex->fastaVector->sequence.charData[letterIndex],
+              letterIndex, storedSequence[letterIndex],
               fastaVector->sequence.charData[letterIndex]);
-      testAssertString(
-          fastaVectorIndex->fastaVector->sequence.charData[letterIndex] ==
-              fastaVector->sequence.charData[letterIndex],
-          buffer);
+      testAssertString(storedSequence[letterIndex] ==
+                           fastaVector->sequence.charData[letterIndex],
+                       buffer);
     }
+    free(storedSequence);
 
     // compare the header
     sprintf(buffer,
@@ -628,7 +626,7 @@ void testFromFasta() {
   size_t localPosition, sequenceNumber;
   uint64_t *positions;
   struct AwFmIndex *index;
-  struct AwFmIndexConfiguration config;
+  struct AwFmIndexConfiguration config = {0};
   config.suffixArrayCompressionRatio = 2;
   config.kmerLengthInSeedTable = 2;
   config.alphabetType = AwFmAlphabetAmino;
@@ -0,0 +1,226 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/AwFmIndex.h"
+#include "../test.h"
+
+char buffer[2048];
+// ascii letters by letter index, ambiguity letter last.
+const char nucleotideLetters[] = "acgtn";
+const char aminoLetters[] = "acdefghiklmnpqrstvwyx";
+
+#define INDEX_SRC "neighborhoodSearchTest.awfmi"
+#define NUM_QUERIES 100
+#define MAX_KMER_LENGTH 8
+
+void testNeighborhoodSearch(const enum AwFmAlphabetType alphabet,
+                            const size_t sequenceLength,
+                            const size_t kmerLength, const bool locate);
+void testMissingMatrix(void);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  for (size_t i = 0; i < 2; i++) {
+    testNeighborhoodSearch(AwFmAlphabetAmino, 1 + rand() % 20000, 3, i);
+    testNeighborhoodSearch(AwFmAlphabetAmino, 1 + rand() % 20000, 4, !i);
+    testNeighborhoodSearch(AwFmAlphabetDna, 1 + rand() % 20000, 8, i);
+  }
+  testMissingMatrix();
+
+  remove(INDEX_SRC);
+  printf("neighborhood search testing finished.\n");
+}
+
+// a symmetric matrix that favors matches, roughly like BLOSUM62.
+int16_t *makeMatrix(const uint8_t numLetters) {
+  int16_t *matrix = malloc(numLetters * numLetters * sizeof(int16_t));
+  for (uint8_t i = 0; i < numLetters; i++) {
+    for (uint8_t j = 0; j <= i; j++) {
+      const int16_t score = i == j ? 4 + rand() % 8 : -4 + rand() % 7;
+      matrix[(i * numLetters) + j] = score;
+      matrix[(j * numLetters) + i] = score;
+    }
+  }
+  return matrix;
+}
+
+int comparePositions(const void *a, const void *b) {
+  const uint64_t x = *(const uint64_t *)a;
+  const uint64_t y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+int32_t scoreWord(const int16_t *profile, const uint8_t numLetters,
+                  const uint8_t *word, const size_t kmerLength) {
+  int32_t score = 0;
+  for (size_t i = 0; i < kmerLength; i++) {
+    score += profile[(i * numLetters) + word[i]];
+  }
+  return score;
+}
+
+void checkHits(const uint8_t *sequence, const size_t sequenceLength,
+               const uint8_t numLetters, const int16_t *profile,
+               const struct AwFmNeighborhoodSearchData *searchData,
+               const int32_t minScore, const bool locate) {
+  const size_t kmerLength = searchData->kmerLength;
+  uint64_t *expectedPositions = malloc(sequenceLength * sizeof(uint64_t));
+  size_t numExpected = 0;
+  for (size_t start = 0; start + kmerLength <= sequenceLength; start++) {
+    if (scoreWord(profile, numLetters, sequence + start, kmerLength) >=
+        minScore) {
+      expectedPositions[numExpected++] = start;
+    }
+  }
+
+  uint64_t *foundPositions = malloc((numExpected + 1) * sizeof(uint64_t));
+  size_t numFound = 0;
+  for (uint32_t i = 0; i < searchData->count; i++) {
+    const struct AwFmNeighborhoodHit *hit = &searchData->hits[i];
+    testAssertString(hit->range.startPtr <= hit->range.endPtr,
+                     "hits should have nonempty ranges.");
+    testAssertString(hit->score >= minScore, "hit scored below the minimum.");
+    const uint64_t rangeLength = hit->range.endPtr - hit->range.startPtr + 1;
+    if (!locate) {
+      testAssertString(hit->positionList == NULL,
+                       "position list should not be set without locate.");
+      numFound += rangeLength;
+      continue;
+    }
+    for (uint64_t j = 0; j < rangeLength; j++) {
+      const uint64_t position = hit->positionList[j];
+      const bool scoreMatches =
+          position + kmerLength <= sequenceLength &&
+          scoreWord(profile, numLetters, sequence + position, kmerLength) ==
+              hit->score;
+      sprintf(buffer, "hit at %lu doesn't have score %d.", position,
+              hit->score);
+      testAssertString(scoreMatches, buffer);
+      if (numFound < numExpected) {
+        foundPositions[numFound] = position;
+      }
+      numFound++;
+    }
+  }
+
+  sprintf(buffer, "query with min score %d expected %zu hits, got %zu.",
+          minScore, numExpected, numFound);
+  testAssertString(numFound == numExpected, buffer);
+  if (locate && numFound == numExpected) {
+    qsort(foundPositions, numFound, sizeof(uint64_t), comparePositions);
+    testAssertString(memcmp(foundPositions, expectedPositions,
+                            numFound * sizeof(uint64_t)) == 0,
+                     "located positions didn't match the expected hits.");
+  }
+  free(foundPositions);
+  free(expectedPositions);
+}
+
+void testNeighborhoodSearch(const enum AwFmAlphabetType alphabet,
+                            const size_t sequenceLength,
+                            const size_t kmerLength, const bool locate) {
+  const bool isAmino = alphabet == AwFmAlphabetAmino;
+  const uint8_t numLetters = isAmino ? 21 : 5;
+  const char *letters = isAmino ? aminoLetters : nucleotideLetters;
+  uint8_t *sequence = malloc(sequenceLength);
+  char *asciiSequence = malloc(sequenceLength);
+  for (size_t i = 0; i < sequenceLength; i++) {
+    sequence[i] = rand() % 300 == 0 ? numLetters - 1
+                                    : rand() % (numLetters - 1);
+    asciiSequence[i] = letters[sequence[i]];
+  }
+
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 8,
+      .kmerLengthInSeedTable = isAmino ? 2 : 4,
+      .alphabetType = alphabet,
+      .keepSuffixArrayInMemory = rand() % 2,
+      .storeOriginalSequence = false};
+  struct AwFmIndex *index;
+  enum AwFmReturnCode returnCode = awFmCreateIndex(
+      &index, &config, (uint8_t *)asciiSequence, sequenceLength, INDEX_SRC);
+  testAssertString(returnCode == AwFmFileWriteOkay, "index creation failed.");
+
+  int16_t *matrix = makeMatrix(numLetters);
+  struct AwFmNeighborhoodSearchList *searchList =
+      awFmCreateNeighborhoodSearchList(NUM_QUERIES);
+  char *kmers = malloc(NUM_QUERIES * MAX_KMER_LENGTH);
+  int16_t *profiles =
+      malloc(NUM_QUERIES * MAX_KMER_LENGTH * numLetters * sizeof(int16_t));
+  // the profile each query is checked against, its own or its matrix rows.
+  int16_t *expectedProfiles =
+      malloc(NUM_QUERIES * MAX_KMER_LENGTH * numLetters * sizeof(int16_t));
+  searchList->count = NUM_QUERIES;
+  for (size_t i = 0; i < NUM_QUERIES; i++) {
+    char *kmer = kmers + (i * MAX_KMER_LENGTH);
+    int16_t *profile = profiles + (i * MAX_KMER_LENGTH * numLetters);
+    int16_t *expectedProfile =
+        expectedProfiles + (i * MAX_KMER_LENGTH * numLetters);
+    const bool useProfile = rand() % 2;
+    for (size_t position = 0; position < kmerLength; position++) {
+      const uint8_t letterIndex = rand() % numLetters;
+      kmer[position] = letters[letterIndex];
+      for (uint8_t j = 0; j < numLetters; j++) {
+        profile[(position * numLetters) + j] = -5 + rand() % 16;
+        expectedProfile[(position * numLetters) + j] =
+            useProfile ? profile[(position * numLetters) + j]
+                       : matrix[(letterIndex * numLetters) + j];
+      }
+    }
+    searchList->neighborhoodSearchData[i].kmerString = kmer;
+    searchList->neighborhoodSearchData[i].kmerLength = kmerLength;
+    searchList->neighborhoodSearchData[i].profile =
+        useProfile ? profile : NULL;
+  }
+
+  // searches twice, to check the second search replaces the first's hits.
+  for (uint8_t round = 0; round < 2; round++) {
+    const int32_t minScore = (int32_t)kmerLength * (2 + rand() % 4);
+    returnCode = awFmParallelSearchNeighborhood(index, searchList, matrix,
+                                                minScore, locate, 4);
+    sprintf(buffer, "neighborhood search returned %d.", returnCode);
+    testAssertString(returnCode == AwFmSuccess, buffer);
+    for (size_t i = 0; i < NUM_QUERIES; i++) {
+      checkHits(sequence, sequenceLength, numLetters,
+                expectedProfiles + (i * MAX_KMER_LENGTH * numLetters),
+                &searchList->neighborhoodSearchData[i], minScore, locate);
+    }
+  }
+
+  awFmDeallocNeighborhoodSearchList(searchList);
+  awFmDeallocIndex(index);
+  free(expectedProfiles);
+  free(profiles);
+  free(kmers);
+  free(matrix);
+  free(asciiSequence);
+  free(sequence);
+}
+
+void testMissingMatrix(void) {
+  char sequence[] = "acdefghiklmnpqrstvwy";
+  struct AwFmIndexConfiguration config = {.suffixArrayCompressionRatio = 4,
+                                          .kmerLengthInSeedTable = 2,
+                                          .alphabetType = AwFmAlphabetAmino,
+                                          .keepSuffixArrayInMemory = true,
+                                          .storeOriginalSequence = false};
+  struct AwFmIndex *index;
+  awFmCreateIndex(&index, &config, (uint8_t *)sequence, strlen(sequence),
+                  INDEX_SRC);
+
+  struct AwFmNeighborhoodSearchList *searchList =
+      awFmCreateNeighborhoodSearchList(1);
+  searchList->count = 1;
+  searchList->neighborhoodSearchData[0].kmerString = "acd";
+  searchList->neighborhoodSearchData[0].kmerLength = 3;
+  const enum AwFmReturnCode returnCode =
+      awFmParallelSearchNeighborhood(index, searchList, NULL, 10, false, 1);
+  testAssertString(returnCode == AwFmNullPtrError,
+                   "a query without a profile needs a matrix.");
+  awFmDeallocNeighborhoodSearchList(searchList);
+  awFmDeallocIndex(index);
+}
@@ -27,6 +27,7 @@ uint8_t nucleotideLookup[5] = {'a', 'g', 'c', 't', 'x'};
 void testParallelSearchNucleotide();
 void testParallelSearchAmino();
 void testParallelCount();
+void testParallelSearchNumaReplicas();
 
 const uint8_t saCompressionRatio = 8;
 
@@ -38,6 +39,7 @@ int main(int argc, char **argv) {
   testParallelCount();
   testParallelSearchNucleotide();
   testParallelSearchAmino();
+  testParallelSearchNumaReplicas();
 
   printf("parallel search testing finished.\n");
 }
@@ -454,3 +456,106 @@ void testParallelCount(void) {
   free(sequence);
   awFmDeallocIndex(index);
 }
+
+void testParallelSearchNumaReplicas(void) {
+  struct AwFmIndex *index;
+  struct AwFmIndexConfiguration config = {.suffixArrayCompressionRatio =
+                                              saCompressionRatio,
+                                          .kmerLengthInSeedTable = 6,
+                                          .alphabetType = AwFmAlphabetDna,
+                                          .keepSuffixArrayInMemory = true,
+                                          .storeOriginalSequence = false};
+
+  const uint64_t sequenceLength = 10000 + rand() % 50000;
+  printf("creating nucleotide sequence of length %zu for numa replica test.\n",
+         sequenceLength);
+  uint8_t *sequence = malloc((sequenceLength + 1) * sizeof(uint8_t));
+  if (sequence == NULL) {
+    printf("critical error: could not allocate sequence\n");
+    exit(-1);
+  }
+  for (uint64_t i = 0; i < sequenceLength; i++) {
+    sequence[i] = nucleotideLookup[rand() % 4];
+  }
+  sequence[sequenceLength] = 0;
+
+  awFmCreateIndex(&index, &config, sequence, sequenceLength, "testIndex.awfmi");
+
+  const size_t kmerCount = 1000 + (rand() % 3000);
+  struct AwFmKmerSearchList *unreplicatedList =
+      awFmCreateKmerSearchList(kmerCount);
+  struct AwFmKmerSearchList *replicatedList =
+      awFmCreateKmerSearchList(kmerCount);
+  if (unreplicatedList == NULL || replicatedList == NULL) {
+    printf("critical error: parallel search data could not be allocated\n");
+    exit(-2);
+  }
+  unreplicatedList->count = kmerCount;
+  replicatedList->count = kmerCount;
+  for (size_t i = 0; i < kmerCount; i++) {
+    const uint16_t kmerLength = 4 + rand() % 12;
+    char *const kmer = malloc(kmerLength * sizeof(char));
+    for (uint16_t letterIndex = 0; letterIndex < kmerLength; letterIndex++) {
+      kmer[letterIndex] = nucleotideLookup[rand() % 4];
+    }
+    unreplicatedList->kmerSearchData[i].kmerString = kmer;
+    unreplicatedList->kmerSearchData[i].kmerLength = kmerLength;
+    replicatedList->kmerSearchData[i].kmerString = kmer;
+    replicatedList->kmerSearchData[i].kmerLength = kmerLength;
+  }
+
+  const uint32_t numThreads = 2 + rand() % 8;
+  awFmParallelSearchLocate(index, unreplicatedList, numThreads);
+
+  testAssertString(awFmGetNumaReplicaCount(index) == 0,
+                   "index reported numa replicas before replication.");
+  enum AwFmReturnCode rc = awFmReplicateIndexAcrossNumaNodes(index);
+  sprintf(buffer, "numa replication returned unexpected return code %i.", rc);
+  testAssertString(rc == AwFmSuccess || rc == AwFmFeatureUnsupported, buffer);
+  if (rc == AwFmSuccess) {
+    testAssertString(awFmGetNumaReplicaCount(index) >= 1,
+                     "replicated index reported no numa replicas.");
+    // replicating twice should leave the existing replicas alone.
+    const uint32_t replicaCount = awFmGetNumaReplicaCount(index);
+    rc = awFmReplicateIndexAcrossNumaNodes(index);
+    testAssertString(rc == AwFmSuccess &&
+                         awFmGetNumaReplicaCount(index) == replicaCount,
+                     "second numa replication changed the replica set.");
+  }
+
+  awFmParallelSearchLocate(index, replicatedList, numThreads);
+  for (size_t i = 0; i < kmerCount; i++) {
+    const struct AwFmKmerSearchData *expected =
+        &unreplicatedList->kmerSearchData[i];
+    const struct AwFmKmerSearchData *actual =
+        &replicatedList->kmerSearchData[i];
+    sprintf(buffer,
+            "kmer %zu had %u hits on the replicated index, expected %u.", i,
+            actual->count, expected->count);
+    testAssertString(actual->count == expected->count, buffer);
+    if (actual->count == expected->count) {
+      testAssertString(memcmp(actual->positionList, expected->positionList,
+                              actual->count * sizeof(uint64_t)) == 0,
+                       "replicated index located different positions.");
+    }
+  }
+
+  awFmParallelSearchCount(index, replicatedList, numThreads);
+  for (size_t i = 0; i < kmerCount; i++) {
+    sprintf(buffer,
+            "kmer %zu had count %u on the replicated index, expected %u.", i,
+            replicatedList->kmerSearchData[i].count,
+            unreplicatedList->kmerSearchData[i].count);
+    testAssertString(replicatedList->kmerSearchData[i].count ==
+                         unreplicatedList->kmerSearchData[i].count,
+                     buffer);
+  }
+
+  for (size_t i = 0; i < kmerCount; i++) {
+    free(unreplicatedList->kmerSearchData[i].kmerString);
+  }
+  awFmDeallocKmerSearchList(unreplicatedList);
+  awFmDeallocKmerSearchList(replicatedList);
+  free(sequence);
+  awFmDeallocIndex(index);
+}
@@ -0,0 +1,291 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/AwFmIndex.h"
+#include "../../src/AwFmIndexStruct.h"
+#include "../test.h"
+
+char buffer[2048];
+const char aminoLetters[] = "acdefghiklmnpqrstvwy";
+// the built-in grouping, [kredqn] c g h [ilv] m f y w p [sta].
+const uint8_t defaultLetterMap[20] = {10, 1, 0, 0, 6, 2, 3, 4, 0, 4,
+                                      5,  0, 9, 0, 0, 10, 10, 4, 8, 7};
+
+#define INDEX_SRC "reducedAlphabetTest.awfmi"
+#define FASTA_SRC "reducedAlphabetTest.fasta"
+
+void testBlockLayout(void);
+void testReducedSearch(const uint8_t *letterMap, const size_t sequenceLength,
+                       const bool buildFromFasta, const bool lowMemory);
+void testInvalidLetterMap(void);
+void testUnsupportedFeatures(void);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  testBlockLayout();
+
+  // a map that splits the amino acids into groups by position.
+  uint8_t customLetterMap[20];
+  for (uint8_t i = 0; i < 20; i++) {
+    customLetterMap[i] = (i * 7) % AW_FM_REDUCED_AMINO_CARDINALITY;
+  }
+  for (size_t i = 0; i < 2; i++) {
+    testReducedSearch(NULL, 1 + rand() % 20000, false, false);
+    testReducedSearch(customLetterMap, 1 + rand() % 20000, false, false);
+    testReducedSearch(NULL, 1 + rand() % 20000, true, false);
+    testReducedSearch(customLetterMap, 1 + rand() % 20000, true, true);
+  }
+  testInvalidLetterMap();
+  testUnsupportedFeatures();
+
+  remove(INDEX_SRC);
+  remove(FASTA_SRC);
+  printf("reduced alphabet testing finished.\n");
+}
+
+void testBlockLayout(void) {
+  testAssertString(sizeof(struct AwFmReducedAminoBlock) == 256,
+                   "reduced amino blocks should be 256 bytes.");
+  testAssertString(awFmGetAlphabetCardinality(AwFmAlphabetReducedAmino) ==
+                       AW_FM_REDUCED_AMINO_CARDINALITY,
+                   "reduced amino alphabet should have 11 letters.");
+  testAssertString(awFmGetPrefixSumsLength(AwFmAlphabetReducedAmino) ==
+                       AW_FM_REDUCED_AMINO_CARDINALITY + 2,
+                   "reduced amino prefix sums have the wrong length.");
+}
+
+// the group of each letter, with the ambiguity letter in a group of its own.
+uint8_t groupOf(const uint8_t *letterMap, const char letter) {
+  const char *found = strchr(aminoLetters, letter);
+  return found == NULL ? AW_FM_REDUCED_AMINO_CARDINALITY
+                       : letterMap[found - aminoLetters];
+}
+
+// counts and locates the kmer by comparing the groups of every letter.
+size_t bruteForceSearch(const uint8_t *letterMap, const char *sequence,
+                        const size_t sequenceLength, const char *kmer,
+                        const size_t kmerLength, uint64_t *positions) {
+  size_t count = 0;
+  for (size_t start = 0; start + kmerLength <= sequenceLength; start++) {
+    bool matches = true;
+    for (size_t i = 0; i < kmerLength && matches; i++) {
+      const uint8_t group = groupOf(letterMap, sequence[start + i]);
+      matches = group != AW_FM_REDUCED_AMINO_CARDINALITY &&
+                group == groupOf(letterMap, kmer[i]);
+    }
+    if (matches) {
+      positions[count++] = start;
+    }
+  }
+  return count;
+}
+
+int comparePositions(const void *a, const void *b) {
+  const uint64_t x = *(const uint64_t *)a;
+  const uint64_t y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+void writeFasta(const char *sequence, const size_t sequenceLength) {
+  FILE *fastaFile = fopen(FASTA_SRC, "w");
+  fprintf(fastaFile, ">reduced test sequence\n");
+  for (size_t i = 0; i < sequenceLength; i += 60) {
+    const size_t lineLength = sequenceLength - i < 60 ? sequenceLength - i : 60;
+    fwrite(sequence + i, 1, lineLength, fastaFile);
+    fputc('\n', fastaFile);
+  }
+  fclose(fastaFile);
+}
+
+void checkKmers(const struct AwFmIndex *index, const uint8_t *letterMap,
+                const char *sequence, const size_t sequenceLength,
+                const size_t kmerLength) {
+  const size_t numKmers = 200;
+  struct AwFmKmerSearchList *searchList = awFmCreateKmerSearchList(numKmers);
+  struct AwFmKmerSearchList *countList = awFmCreateKmerSearchList(numKmers);
+  char *kmers = malloc(numKmers * kmerLength);
+  for (size_t i = 0; i < numKmers; i++) {
+    // most kmers are copied from the sequence with letters swapped for
+    // others in their group, so they have hits without being exact matches.
+    char *kmer = kmers + (i * kmerLength);
+    const size_t start = sequenceLength > kmerLength
+                             ? rand() % (sequenceLength - kmerLength + 1)
+                             : 0;
+    for (size_t j = 0; j < kmerLength; j++) {
+      char letter = aminoLetters[rand() % 20];
+      if (i % 4 != 0 && start + j < sequenceLength &&
+          groupOf(letterMap, sequence[start + j]) !=
+              AW_FM_REDUCED_AMINO_CARDINALITY) {
+        const uint8_t group = groupOf(letterMap, sequence[start + j]);
+        do {
+          letter = aminoLetters[rand() % 20];
+        } while (groupOf(letterMap, letter) != group);
+      }
+      kmer[j] = letter;
+    }
+    searchList->kmerSearchData[i].kmerString = kmer;
+    searchList->kmerSearchData[i].kmerLength = kmerLength;
+    countList->kmerSearchData[i].kmerString = kmer;
+    countList->kmerSearchData[i].kmerLength = kmerLength;
+  }
+  searchList->count = numKmers;
+  countList->count = numKmers;
+
+  enum AwFmReturnCode returnCode =
+      awFmParallelSearchLocate(index, searchList, 3);
+  testAssertString(returnCode == AwFmSuccess, "parallel locate failed.");
+  awFmParallelSearchCount(index, countList, 3);
+
+  uint64_t *expectedPositions = malloc(sequenceLength * sizeof(uint64_t));
+  for (size_t i = 0; i < numKmers; i++) {
+    const char *kmer = kmers + (i * kmerLength);
+    const size_t expectedCount =
+        bruteForceSearch(letterMap, sequence, sequenceLength, kmer,
+                         kmerLength, expectedPositions);
+    struct AwFmKmerSearchData *searchData = &searchList->kmerSearchData[i];
+    sprintf(buffer, "kmer %.*s expected %zu hits, located %u, counted %u.",
+            (int)kmerLength, kmer, expectedCount, searchData->count,
+            countList->kmerSearchData[i].count);
+    testAssertString(searchData->count == expectedCount &&
+                         countList->kmerSearchData[i].count == expectedCount,
+                     buffer);
+
+    const struct AwFmSearchRange range =
+        awFmFindSearchRangeForString(index, kmer, kmerLength);
+    testAssertString(awFmSearchRangeLength(&range) == expectedCount,
+                     "search range for string had the wrong length.");
+    if (searchData->count != expectedCount) {
+      continue;
+    }
+    qsort(searchData->positionList, searchData->count, sizeof(uint64_t),
+          comparePositions);
+    testAssertString(memcmp(searchData->positionList, expectedPositions,
+                            expectedCount * sizeof(uint64_t)) == 0,
+                     "located positions didn't match.");
+  }
+
+  free(expectedPositions);
+  free(kmers);
+  awFmDeallocKmerSearchList(searchList);
+  awFmDeallocKmerSearchList(countList);
+}
+
+void testReducedSearch(const uint8_t *letterMap, const size_t sequenceLength,
+                       const bool buildFromFasta, const bool lowMemory) {
+  const uint8_t *expectedLetterMap =
+      letterMap != NULL ? letterMap : defaultLetterMap;
+  char *sequence = malloc(sequenceLength + 1);
+  for (size_t i = 0; i < sequenceLength; i++) {
+    sequence[i] = rand() % 300 == 0 ? 'x' : aminoLetters[rand() % 20];
+  }
+  sequence[sequenceLength] = 0;
+
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 1 + rand() % 8,
+      .kmerLengthInSeedTable = 4,
+      .alphabetType = AwFmAlphabetReducedAmino,
+      .keepSuffixArrayInMemory = rand() % 2,
+      .storeOriginalSequence = true};
+  const struct AwFmIndexBuildOptions options = {
+      .constructionMemoryBudget = lowMemory ? 64 * 1024 * 1024 : 0,
+      .reducedAminoLetterMap = letterMap};
+  struct AwFmIndex *index;
+  enum AwFmReturnCode returnCode;
+  if (buildFromFasta) {
+    writeFasta(sequence, sequenceLength);
+    returnCode = awFmCreateIndexFromFastaWithOptions(
+        &index, &config, FASTA_SRC, INDEX_SRC, &options);
+  } else {
+    returnCode = awFmCreateIndexWithOptions(&index, &config,
+                                            (uint8_t *)sequence,
+                                            sequenceLength, INDEX_SRC,
+                                            &options);
+  }
+  testAssertString(returnCode == AwFmFileWriteOkay,
+                   "reduced index creation failed.");
+  testAssertString(memcmp(index->reducedAminoLetterMap, expectedLetterMap,
+                          20) == 0,
+                   "index didn't keep the letter map.");
+
+  // kmers shorter than, as long as, and longer than the seed table's kmers.
+  const size_t kmerLengths[] = {1, 3, 4, 5, 8, 14};
+  for (size_t i = 0; i < sizeof(kmerLengths) / sizeof(size_t); i++) {
+    checkKmers(index, expectedLetterMap, sequence, sequenceLength,
+               kmerLengths[i]);
+  }
+  awFmDeallocIndex(index);
+
+  // the letter map is read back from the file header.
+  returnCode = awFmReadIndexFromFile(&index, INDEX_SRC, rand() % 2);
+  testAssertString(returnCode == AwFmFileReadOkay,
+                   "reading the reduced index failed.");
+  testAssertString(index->config.alphabetType == AwFmAlphabetReducedAmino,
+                   "read index has the wrong alphabet.");
+  testAssertString(memcmp(index->reducedAminoLetterMap, expectedLetterMap,
+                          20) == 0,
+                   "read index has the wrong letter map.");
+  checkKmers(index, expectedLetterMap, sequence, sequenceLength, 6);
+
+  // the stored sequence keeps the original amino acids.
+  char *storedSequence = malloc(sequenceLength + 1);
+  returnCode =
+      awFmReadSequenceFromFile(index, 0, sequenceLength, storedSequence);
+  testAssertString(returnCode == AwFmFileReadOkay &&
+                       memcmp(storedSequence, sequence, sequenceLength) == 0,
+                   "stored sequence didn't match the original.");
+  free(storedSequence);
+
+  awFmDeallocIndex(index);
+  free(sequence);
+}
+
+void testInvalidLetterMap(void) {
+  uint8_t letterMap[20];
+  memcpy(letterMap, defaultLetterMap, 20);
+  letterMap[7] = AW_FM_REDUCED_AMINO_CARDINALITY;
+  char sequence[] = "acdefghiklmnpqrstvwy";
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 4,
+      .kmerLengthInSeedTable = 2,
+      .alphabetType = AwFmAlphabetReducedAmino,
+      .keepSuffixArrayInMemory = true,
+      .storeOriginalSequence = false};
+  const struct AwFmIndexBuildOptions options = {.reducedAminoLetterMap =
+                                                    letterMap};
+  struct AwFmIndex *index;
+  enum AwFmReturnCode returnCode =
+      awFmCreateIndexWithOptions(&index, &config, (uint8_t *)sequence,
+                                 strlen(sequence), INDEX_SRC, &options);
+  testAssertString(returnCode == AwFmIllegalPositionError,
+                   "a map past the reduced alphabet should be rejected.");
+}
+
+void testUnsupportedFeatures(void) {
+  char sequence[] = "acdefghiklmnpqrstvwyacdefghiklmnpqrstvwy";
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 4,
+      .kmerLengthInSeedTable = 2,
+      .alphabetType = AwFmAlphabetReducedAmino,
+      .keepSuffixArrayInMemory = true,
+      .storeOriginalSequence = false};
+  struct AwFmIndex *index;
+  awFmCreateIndex(&index, &config, (uint8_t *)sequence, strlen(sequence),
+                  INDEX_SRC);
+
+  struct AwFmBiDirectionalIndex *biIndex;
+  enum AwFmReturnCode returnCode =
+      awFmCreateBiDirectionalIndex(&biIndex, index, "reducedReverse.awfmi");
+  testAssertString(returnCode == AwFmFeatureUnsupported,
+                   "reduced bidirectional indices should be unsupported.");
+
+  struct AwFmIndex *mergedIndex;
+  returnCode = awFmMergeIndices(&mergedIndex, &config, index, index,
+                                "reducedMerged.awfmi", NULL);
+  testAssertString(returnCode == AwFmFeatureUnsupported,
+                   "merging reduced indices should be unsupported.");
+  awFmDeallocIndex(index);
+}
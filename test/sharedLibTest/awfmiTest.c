@@ -6,7 +6,7 @@
 int main(int argc, char **argv) {
   struct AwFmIndex *index;
 
-  struct AwFmIndexConfiguration config;
+  struct AwFmIndexConfiguration config = {0};
   config.suffixArrayCompressionRatio = 2;
   config.kmerLengthInSeedTable = 2;
   config.alphabetType = AwFmAlphabetDna;
@@ -0,0 +1,178 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/AwFmIndex.h"
+#include "../test.h"
+
+char buffer[2048];
+const char nucleotideLetters[] = "acgt";
+const char aminoLetters[] = "acdefghiklmnpqrstvwy";
+
+#define INDEX_SRC "slidingWindowTest.awfmi"
+
+void testSlidingWindows(const enum AwFmAlphabetType alphabet,
+                        const size_t sequenceLength,
+                        const size_t queryLength);
+void testEmptyQuery(void);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  for (size_t i = 0; i < 2; i++) {
+    testSlidingWindows(AwFmAlphabetDna, 1 + rand() % 20000,
+                       1 + rand() % 10000);
+    testSlidingWindows(AwFmAlphabetAmino, 1 + rand() % 20000,
+                       1 + rand() % 10000);
+  }
+  testEmptyQuery();
+
+  remove(INDEX_SRC);
+  printf("sliding window testing finished.\n");
+}
+
+char randomLetter(const enum AwFmAlphabetType alphabet) {
+  if (rand() % 300 == 0) {
+    return alphabet == AwFmAlphabetAmino ? 'x' : 'n';
+  }
+  return alphabet == AwFmAlphabetAmino ? aminoLetters[rand() % 20]
+                                       : nucleotideLetters[rand() % 4];
+}
+
+bool windowIsAmbiguous(const enum AwFmAlphabetType alphabet,
+                       const char *window, const size_t kmerLength) {
+  const char ambiguityLetter = alphabet == AwFmAlphabetAmino ? 'x' : 'n';
+  return memchr(window, ambiguityLetter, kmerLength) != NULL;
+}
+
+int comparePositions(const void *a, const void *b) {
+  const uint64_t x = *(const uint64_t *)a;
+  const uint64_t y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+void checkWindows(const struct AwFmIndex *index,
+                  const enum AwFmAlphabetType alphabet, const char *sequence,
+                  const size_t sequenceLength, const char *query,
+                  const size_t queryLength, const size_t kmerLength) {
+  const size_t numWindows =
+      queryLength >= kmerLength ? queryLength - kmerLength + 1 : 0;
+  uint64_t *counts = malloc((numWindows + 1) * sizeof(uint64_t));
+  enum AwFmReturnCode returnCode = awFmSlidingWindowSearchCount(
+      index, query, queryLength, kmerLength, counts, 3);
+  testAssertString(returnCode == AwFmSuccess, "window count failed.");
+  struct AwFmWindowHits *hits;
+  returnCode = awFmSlidingWindowSearchLocate(index, query, queryLength,
+                                             kmerLength, &hits, 3);
+  testAssertString(returnCode == AwFmSuccess, "window locate failed.");
+  testAssertString(hits->numWindows == numWindows,
+                   "wrong number of windows.");
+
+  uint64_t *expectedPositions = malloc(sequenceLength * sizeof(uint64_t));
+  for (size_t window = 0; window < numWindows; window++) {
+    const char *kmer = query + window;
+    uint64_t expectedCount = 0;
+    if (!windowIsAmbiguous(alphabet, kmer, kmerLength)) {
+      const struct AwFmSearchRange range =
+          awFmFindSearchRangeForString(index, kmer, kmerLength);
+      expectedCount = awFmSearchRangeLength(&range);
+    }
+    sprintf(buffer, "window %zu of length %zu expected count %lu, got %lu.",
+            window, kmerLength, expectedCount, counts[window]);
+    testAssertString(counts[window] == expectedCount, buffer);
+
+    const uint64_t numHits = hits->offsets[window + 1] - hits->offsets[window];
+    sprintf(buffer, "window %zu expected %lu hits, got %lu.", window,
+            expectedCount, numHits);
+    testAssertString(numHits == expectedCount, buffer);
+    if (numHits != expectedCount || numHits == 0) {
+      continue;
+    }
+
+    size_t numExpected = 0;
+    for (size_t start = 0; start + kmerLength <= sequenceLength; start++) {
+      if (memcmp(sequence + start, kmer, kmerLength) == 0) {
+        expectedPositions[numExpected++] = start;
+      }
+    }
+    uint64_t *windowPositions = hits->positions + hits->offsets[window];
+    qsort(windowPositions, numHits, sizeof(uint64_t), comparePositions);
+    testAssertString(numExpected == numHits &&
+                         memcmp(windowPositions, expectedPositions,
+                                numHits * sizeof(uint64_t)) == 0,
+                     "located window positions didn't match.");
+  }
+
+  free(expectedPositions);
+  awFmDeallocWindowHits(hits);
+  free(counts);
+}
+
+void testSlidingWindows(const enum AwFmAlphabetType alphabet,
+                        const size_t sequenceLength,
+                        const size_t queryLength) {
+  char *sequence = malloc(sequenceLength);
+  for (size_t i = 0; i < sequenceLength; i++) {
+    sequence[i] = randomLetter(alphabet);
+  }
+  // the query copies runs of the sequence, so longer windows have hits.
+  char *query = malloc(queryLength);
+  for (size_t i = 0; i < queryLength; i++) {
+    query[i] = rand() % 20 == 0 ? randomLetter(alphabet)
+                                : sequence[(i + 7) % sequenceLength];
+  }
+
+  const uint8_t kmerLengthInSeedTable = alphabet == AwFmAlphabetAmino ? 3 : 6;
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 8,
+      .kmerLengthInSeedTable = kmerLengthInSeedTable,
+      .alphabetType = alphabet,
+      .keepSuffixArrayInMemory = rand() % 2,
+      .storeOriginalSequence = false};
+  struct AwFmIndex *index;
+  enum AwFmReturnCode returnCode = awFmCreateIndex(
+      &index, &config, (uint8_t *)sequence, sequenceLength, INDEX_SRC);
+  testAssertString(returnCode == AwFmFileWriteOkay, "index creation failed.");
+
+  // windows shorter than, as long as, and longer than the seed table's kmers.
+  const size_t kmerLengths[] = {1, kmerLengthInSeedTable - 1,
+                                kmerLengthInSeedTable,
+                                kmerLengthInSeedTable + 1, 12, 25};
+  for (size_t i = 0; i < sizeof(kmerLengths) / sizeof(size_t); i++) {
+    checkWindows(index, alphabet, sequence, sequenceLength, query, queryLength,
+                 kmerLengths[i]);
+  }
+
+  awFmDeallocIndex(index);
+  free(query);
+  free(sequence);
+}
+
+void testEmptyQuery(void) {
+  char sequence[] = "acgtacgtacgtaaaccc";
+  struct AwFmIndexConfiguration config = {.suffixArrayCompressionRatio = 4,
+                                          .kmerLengthInSeedTable = 4,
+                                          .alphabetType = AwFmAlphabetDna,
+                                          .keepSuffixArrayInMemory = true,
+                                          .storeOriginalSequence = false};
+  struct AwFmIndex *index;
+  awFmCreateIndex(&index, &config, (uint8_t *)sequence, strlen(sequence),
+                  INDEX_SRC);
+
+  // a query shorter than the window has no windows.
+  struct AwFmWindowHits *hits;
+  enum AwFmReturnCode returnCode =
+      awFmSlidingWindowSearchLocate(index, "acg", 3, 8, &hits, 2);
+  testAssertString(returnCode == AwFmSuccess && hits->numWindows == 0 &&
+                       hits->offsets[0] == 0,
+                   "short query should have no windows.");
+  awFmDeallocWindowHits(hits);
+
+  uint64_t count;
+  returnCode = awFmSlidingWindowSearchCount(index, "acgt", 4, 0, &count, 1);
+  testAssertString(returnCode == AwFmIllegalPositionError,
+                   "zero length windows should be rejected.");
+  awFmDeallocIndex(index);
+}
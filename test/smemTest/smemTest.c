@@ -0,0 +1,253 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/AwFmIndex.h"
+#include "../test.h"
+
+char buffer[2048];
+const char nucleotideLetters[] = "acgt";
+const char aminoLetters[] = "acdefghiklmnpqrstvwy";
+
+#define FORWARD_INDEX_SRC "smemForward.awfmi"
+#define REVERSE_INDEX_SRC "smemReverse.awfmi"
+#define NUM_QUERIES 100
+#define MAX_QUERY_LENGTH 300
+
+void testSmems(const enum AwFmAlphabetType alphabet,
+               const size_t sequenceLength, const uint64_t minSmemLength,
+               const bool locate);
+void testMissingLetters(void);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  for (size_t i = 0; i < 3; i++) {
+    testSmems(AwFmAlphabetDna, 1 + rand() % 20000, 1, i != 0);
+    testSmems(AwFmAlphabetAmino, 1 + rand() % 20000, 1, i != 0);
+  }
+  testSmems(AwFmAlphabetDna, 5000, 12, true);
+  testSmems(AwFmAlphabetAmino, 5000, 5, true);
+  testMissingLetters();
+
+  remove(FORWARD_INDEX_SRC);
+  remove(REVERSE_INDEX_SRC);
+  printf("smem testing finished.\n");
+}
+
+char randomLetter(const enum AwFmAlphabetType alphabet) {
+  if (rand() % 300 == 0) {
+    return alphabet == AwFmAlphabetAmino ? 'x' : 'n';
+  }
+  return alphabet == AwFmAlphabetAmino ? aminoLetters[rand() % 20]
+                                       : nucleotideLetters[rand() % 4];
+}
+
+bool isAmbiguous(const enum AwFmAlphabetType alphabet, const char letter) {
+  return letter == (alphabet == AwFmAlphabetAmino ? 'x' : 'n');
+}
+
+// copies runs of the sequence with a few changes, so queries have long
+// matches that end at a mismatch.
+void makeQuery(const enum AwFmAlphabetType alphabet, const char *sequence,
+               const size_t sequenceLength, char *query,
+               const size_t queryLength) {
+  size_t sourcePosition = rand() % sequenceLength;
+  for (size_t i = 0; i < queryLength; i++) {
+    if (rand() % 40 == 0) {
+      sourcePosition = rand() % sequenceLength;
+    }
+    if (rand() % 30 == 0 || sourcePosition >= sequenceLength) {
+      query[i] = randomLetter(alphabet);
+    } else {
+      query[i] = sequence[sourcePosition];
+    }
+    sourcePosition++;
+  }
+}
+
+// length of the longest prefix of the query at queryStart that occurs in the
+// sequence. Ambiguity letters in the query never match.
+size_t longestMatch(const enum AwFmAlphabetType alphabet, const char *sequence,
+                    const size_t sequenceLength, const char *query,
+                    const size_t queryStart, const size_t queryLength) {
+  size_t longest = 0;
+  for (size_t start = 0; start < sequenceLength; start++) {
+    size_t length = 0;
+    while (queryStart + length < queryLength &&
+           start + length < sequenceLength &&
+           !isAmbiguous(alphabet, query[queryStart + length]) &&
+           query[queryStart + length] == sequence[start + length]) {
+      length++;
+    }
+    longest = length > longest ? length : longest;
+  }
+  return longest;
+}
+
+int comparePositions(const void *a, const void *b) {
+  const uint64_t x = *(const uint64_t *)a;
+  const uint64_t y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+// checks the found SMEMs against every match [i, end(i)) where end(i) is
+// the end of the longest match at i. Such a match is an SMEM if it's nonempty
+// and ends after the one before it, since ends never decrease.
+void checkSmems(const enum AwFmAlphabetType alphabet, const char *sequence,
+                const size_t sequenceLength,
+                const struct AwFmSmemSearchData *searchData,
+                const uint64_t minSmemLength, const bool locate) {
+  const char *query = searchData->queryString;
+  const size_t queryLength = searchData->queryLength;
+  uint32_t smemIndex = 0;
+  size_t previousEnd = 0;
+  for (size_t i = 0; i < queryLength; i++) {
+    const size_t length = longestMatch(alphabet, sequence, sequenceLength,
+                                       query, i, queryLength);
+    const bool isSmem = length != 0 && i + length > previousEnd;
+    previousEnd = i + length > previousEnd ? i + length : previousEnd;
+    if (!isSmem || length < minSmemLength) {
+      continue;
+    }
+
+    if (smemIndex >= searchData->count) {
+      sprintf(buffer, "missing SMEM at %zu of length %zu.", i, length);
+      testAssertString(false, buffer);
+      return;
+    }
+    const struct AwFmSmem *smem = &searchData->smems[smemIndex++];
+    sprintf(buffer, "expected SMEM at %zu of length %zu, got %lu of %lu.", i,
+            length, smem->queryStart, smem->length);
+    testAssertString(smem->queryStart == i && smem->length == length, buffer);
+    if (smem->queryStart != i || smem->length != length) {
+      return;
+    }
+
+    // every occurrence of the match, in order.
+    uint64_t *expectedPositions = malloc(sequenceLength * sizeof(uint64_t));
+    size_t numExpected = 0;
+    for (size_t start = 0; start + length <= sequenceLength; start++) {
+      if (memcmp(sequence + start, query + i, length) == 0) {
+        expectedPositions[numExpected++] = start;
+      }
+    }
+    sprintf(buffer, "SMEM at %zu of length %zu expected %zu matches, got %lu.",
+            i, length, numExpected, smem->range.length);
+    testAssertString(smem->range.length == numExpected, buffer);
+
+    if (locate && smem->range.length == numExpected) {
+      qsort(smem->positionList, numExpected, sizeof(uint64_t),
+            comparePositions);
+      testAssertString(memcmp(smem->positionList, expectedPositions,
+                              numExpected * sizeof(uint64_t)) == 0,
+                       "located positions didn't match the SMEM's matches.");
+    } else if (!locate) {
+      testAssertString(smem->positionList == NULL,
+                       "position list should not be set without locate.");
+    }
+    free(expectedPositions);
+  }
+  sprintf(buffer, "expected %u SMEMs, got %u.", smemIndex, searchData->count);
+  testAssertString(smemIndex == searchData->count, buffer);
+}
+
+void testSmems(const enum AwFmAlphabetType alphabet,
+               const size_t sequenceLength, const uint64_t minSmemLength,
+               const bool locate) {
+  char *sequence = malloc(sequenceLength);
+  for (size_t i = 0; i < sequenceLength; i++) {
+    sequence[i] = randomLetter(alphabet);
+  }
+
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 8,
+      .kmerLengthInSeedTable = alphabet == AwFmAlphabetAmino ? 2 : 4,
+      .alphabetType = alphabet,
+      .keepSuffixArrayInMemory = rand() % 2,
+      .storeOriginalSequence = false};
+  struct AwFmIndex *forwardIndex;
+  enum AwFmReturnCode returnCode =
+      awFmCreateIndex(&forwardIndex, &config, (uint8_t *)sequence,
+                      sequenceLength, FORWARD_INDEX_SRC);
+  testAssertString(returnCode == AwFmFileWriteOkay,
+                   "forward index creation failed.");
+  struct AwFmBiDirectionalIndex *biIndex;
+  returnCode =
+      awFmCreateBiDirectionalIndex(&biIndex, forwardIndex, REVERSE_INDEX_SRC);
+  testAssertString(returnCode == AwFmFileWriteOkay,
+                   "bidirectional index creation failed.");
+
+  struct AwFmSmemSearchList *searchList = awFmCreateSmemSearchList(NUM_QUERIES);
+  char *queries = malloc(NUM_QUERIES * MAX_QUERY_LENGTH);
+  searchList->count = NUM_QUERIES;
+  // searches twice, to check the second search replaces the first's SMEMs.
+  for (uint8_t round = 0; round < 2; round++) {
+    for (size_t i = 0; i < NUM_QUERIES; i++) {
+      char *query = queries + (i * MAX_QUERY_LENGTH);
+      const size_t queryLength = 1 + rand() % MAX_QUERY_LENGTH;
+      makeQuery(alphabet, sequence, sequenceLength, query, queryLength);
+      searchList->smemSearchData[i].queryString = query;
+      searchList->smemSearchData[i].queryLength = queryLength;
+    }
+
+    returnCode = awFmParallelSearchSmems(biIndex, searchList, minSmemLength,
+                                         locate, 4);
+    sprintf(buffer, "SMEM search returned %d.", returnCode);
+    testAssertString(returnCode == AwFmSuccess, buffer);
+    for (size_t i = 0; i < NUM_QUERIES; i++) {
+      checkSmems(alphabet, sequence, sequenceLength,
+                 &searchList->smemSearchData[i], minSmemLength, locate);
+    }
+  }
+
+  awFmDeallocSmemSearchList(searchList);
+  awFmDeallocBiDirectionalIndex(biIndex);
+  free(queries);
+  free(sequence);
+}
+
+// queries with letters that never occur in the database, which start no
+// match of their own.
+void testMissingLetters(void) {
+  char sequence[] = "acaaccacacccaacaaacccacaccaaacacac";
+  const size_t sequenceLength = strlen(sequence);
+  struct AwFmIndexConfiguration config = {.suffixArrayCompressionRatio = 4,
+                                          .kmerLengthInSeedTable = 2,
+                                          .alphabetType = AwFmAlphabetDna,
+                                          .keepSuffixArrayInMemory = true,
+                                          .storeOriginalSequence = false};
+  struct AwFmIndex *forwardIndex;
+  enum AwFmReturnCode returnCode =
+      awFmCreateIndex(&forwardIndex, &config, (uint8_t *)sequence,
+                      sequenceLength, FORWARD_INDEX_SRC);
+  testAssertString(returnCode == AwFmFileWriteOkay,
+                   "forward index creation failed.");
+  struct AwFmBiDirectionalIndex *biIndex;
+  returnCode =
+      awFmCreateBiDirectionalIndex(&biIndex, forwardIndex, REVERSE_INDEX_SRC);
+  testAssertString(returnCode == AwFmFileWriteOkay,
+                   "bidirectional index creation failed.");
+
+  char *queries[] = {"acgt", "g", "ttt", "gacca", "caccgtacaacg"};
+  const size_t numQueries = sizeof(queries) / sizeof(queries[0]);
+  struct AwFmSmemSearchList *searchList = awFmCreateSmemSearchList(numQueries);
+  for (size_t i = 0; i < numQueries; i++) {
+    searchList->smemSearchData[i].queryString = queries[i];
+    searchList->smemSearchData[i].queryLength = strlen(queries[i]);
+  }
+  searchList->count = numQueries;
+
+  returnCode = awFmParallelSearchSmems(biIndex, searchList, 1, true, 2);
+  sprintf(buffer, "SMEM search returned %d.", returnCode);
+  testAssertString(returnCode == AwFmSuccess, buffer);
+  for (size_t i = 0; i < numQueries; i++) {
+    checkSmems(AwFmAlphabetDna, sequence, sequenceLength,
+               &searchList->smemSearchData[i], 1, true);
+  }
+
+  awFmDeallocSmemSearchList(searchList);
+  awFmDeallocBiDirectionalIndex(biIndex);
+}
@@ -0,0 +1,238 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/AwFmIndex.h"
+#include "../test.h"
+
+char buffer[2048];
+const char nucleotideLetters[] = "acgt";
+const char aminoLetters[] = "acdefghiklmnpqrstvwy";
+
+#define INDEX_SRC "spacedSeedTest.awfmi"
+
+void testSpacedSeeds(const enum AwFmAlphabetType alphabet,
+                     const size_t sequenceLength, const char *pattern,
+                     const uint8_t tableCareLength);
+void testRangeLimit(void);
+void testInvalidPatterns(void);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  for (size_t i = 0; i < 2; i++) {
+    testSpacedSeeds(AwFmAlphabetDna, 1 + rand() % 20000, "1101", 0);
+    testSpacedSeeds(AwFmAlphabetDna, 1 + rand() % 20000, "111010010100110111",
+                    0);
+    testSpacedSeeds(AwFmAlphabetDna, 1 + rand() % 20000, "111010010100110111",
+                    4);
+    testSpacedSeeds(AwFmAlphabetDna, 1 + rand() % 20000, "1", 1);
+    testSpacedSeeds(AwFmAlphabetAmino, 1 + rand() % 20000, "11011", 0);
+    testSpacedSeeds(AwFmAlphabetAmino, 1 + rand() % 20000, "1100101", 2);
+  }
+  testRangeLimit();
+  testInvalidPatterns();
+
+  remove(INDEX_SRC);
+  printf("spaced seed testing finished.\n");
+}
+
+char randomLetter(const enum AwFmAlphabetType alphabet) {
+  if (rand() % 300 == 0) {
+    return alphabet == AwFmAlphabetAmino ? 'x' : 'n';
+  }
+  return alphabet == AwFmAlphabetAmino ? aminoLetters[rand() % 20]
+                                       : nucleotideLetters[rand() % 4];
+}
+
+bool isAmbiguous(const enum AwFmAlphabetType alphabet, const char letter) {
+  return letter == (alphabet == AwFmAlphabetAmino ? 'x' : 'n');
+}
+
+int comparePositions(const void *a, const void *b) {
+  const uint64_t x = *(const uint64_t *)a;
+  const uint64_t y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+// finds every position where the kmer matches at each care position of the
+// pattern.
+size_t bruteForceSearch(const enum AwFmAlphabetType alphabet,
+                        const char *sequence, const size_t sequenceLength,
+                        const char *pattern, const char *kmer,
+                        uint64_t *positions) {
+  const size_t patternLength = strlen(pattern);
+  for (size_t i = 0; i < patternLength; i++) {
+    if (pattern[i] == '1' && isAmbiguous(alphabet, kmer[i])) {
+      return 0;
+    }
+  }
+  size_t count = 0;
+  for (size_t start = 0; start + patternLength <= sequenceLength; start++) {
+    bool matches = true;
+    for (size_t i = 0; i < patternLength && matches; i++) {
+      matches = pattern[i] == '0' || sequence[start + i] == kmer[i];
+    }
+    if (matches) {
+      positions[count++] = start;
+    }
+  }
+  return count;
+}
+
+void testSpacedSeeds(const enum AwFmAlphabetType alphabet,
+                     const size_t sequenceLength, const char *pattern,
+                     const uint8_t tableCareLength) {
+  const size_t patternLength = strlen(pattern);
+  char *sequence = malloc(sequenceLength);
+  for (size_t i = 0; i < sequenceLength; i++) {
+    sequence[i] = randomLetter(alphabet);
+  }
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 1 + rand() % 8,
+      .kmerLengthInSeedTable = alphabet == AwFmAlphabetAmino ? 3 : 6,
+      .alphabetType = alphabet,
+      .keepSuffixArrayInMemory = rand() % 2,
+      .storeOriginalSequence = false};
+  struct AwFmIndex *index;
+  enum AwFmReturnCode returnCode = awFmCreateIndex(
+      &index, &config, (uint8_t *)sequence, sequenceLength, INDEX_SRC);
+  testAssertString(returnCode == AwFmFileWriteOkay, "index creation failed.");
+
+  struct AwFmSpacedSeed *seed;
+  returnCode = awFmCreateSpacedSeed(&seed, index, pattern, tableCareLength);
+  testAssertString(returnCode == AwFmSuccess, "seed creation failed.");
+
+  // kmers are copied from the sequence with their don't care positions
+  // changed, and some are repeated or share their last care letters, so
+  // runs of sorted kmers share ranges.
+  const size_t numKmers = 300;
+  char *kmers = malloc(numKmers * patternLength);
+  struct AwFmSpacedSeedSearchList *searchList =
+      awFmCreateSpacedSeedSearchList(numKmers);
+  for (size_t i = 0; i < numKmers; i++) {
+    char *kmer = kmers + (i * patternLength);
+    if (i != 0 && rand() % 4 == 0) {
+      memcpy(kmer, kmer - patternLength, patternLength);
+      kmer[rand() % patternLength] = randomLetter(alphabet);
+    } else {
+      const size_t start = sequenceLength > patternLength
+                               ? rand() % (sequenceLength - patternLength + 1)
+                               : 0;
+      for (size_t j = 0; j < patternLength; j++) {
+        kmer[j] = start + j < sequenceLength && pattern[j] == '1'
+                      ? sequence[start + j]
+                      : randomLetter(alphabet);
+      }
+    }
+    searchList->spacedSeedSearchData[i].kmerString = kmer;
+  }
+  searchList->count = numKmers;
+
+  // searched twice, so the second search replaces the first one's hits.
+  for (size_t search = 0; search < 2; search++) {
+    returnCode = awFmParallelSearchSpacedSeed(index, seed, searchList,
+                                              UINT64_MAX, true, 3);
+    testAssertString(returnCode == AwFmSuccess, "spaced seed search failed.");
+  }
+
+  uint64_t *expectedPositions = malloc(sequenceLength * sizeof(uint64_t));
+  uint64_t *positions = malloc(sequenceLength * sizeof(uint64_t));
+  for (size_t i = 0; i < numKmers; i++) {
+    const char *kmer = kmers + (i * patternLength);
+    const size_t numExpected = bruteForceSearch(
+        alphabet, sequence, sequenceLength, pattern, kmer, expectedPositions);
+    struct AwFmSpacedSeedSearchData *searchData =
+        &searchList->spacedSeedSearchData[i];
+    testAssertString(!searchData->exceededRangeLimit,
+                     "unlimited search exceeded its range limit.");
+
+    size_t numPositions = 0;
+    for (uint32_t hit = 0; hit < searchData->count; hit++) {
+      const struct AwFmSpacedSeedHit *seedHit = &searchData->hits[hit];
+      const uint64_t rangeLength = awFmSearchRangeLength(&seedHit->range);
+      for (uint64_t j = 0; j < rangeLength && numPositions < sequenceLength;
+           j++) {
+        positions[numPositions++] = seedHit->positionList[j];
+      }
+    }
+    sprintf(buffer, "kmer %.*s with pattern %s expected %zu hits, got %zu.",
+            (int)patternLength, kmer, pattern, numExpected, numPositions);
+    testAssertString(numPositions == numExpected, buffer);
+    if (numPositions != numExpected) {
+      continue;
+    }
+    qsort(positions, numPositions, sizeof(uint64_t), comparePositions);
+    testAssertString(memcmp(positions, expectedPositions,
+                            numPositions * sizeof(uint64_t)) == 0,
+                     "located positions didn't match.");
+  }
+
+  free(positions);
+  free(expectedPositions);
+  awFmDeallocSpacedSeedSearchList(searchList);
+  awFmDeallocSpacedSeed(seed);
+  awFmDeallocIndex(index);
+  free(kmers);
+  free(sequence);
+}
+
+void testRangeLimit(void) {
+  char sequence[] = "acgtacgtaacccgggtttacgatcgatcgactagctacg";
+  struct AwFmIndexConfiguration config = {.suffixArrayCompressionRatio = 4,
+                                          .kmerLengthInSeedTable = 2,
+                                          .alphabetType = AwFmAlphabetDna,
+                                          .keepSuffixArrayInMemory = true,
+                                          .storeOriginalSequence = false};
+  struct AwFmIndex *index;
+  awFmCreateIndex(&index, &config, (uint8_t *)sequence, strlen(sequence),
+                  INDEX_SRC);
+  struct AwFmSpacedSeed *seed;
+  awFmCreateSpacedSeed(&seed, index, "10001", 0);
+  struct AwFmSpacedSeedSearchList *searchList =
+      awFmCreateSpacedSeedSearchList(1);
+  searchList->spacedSeedSearchData[0].kmerString = "acgta";
+  searchList->count = 1;
+
+  // three don't care positions need more than two ranges.
+  enum AwFmReturnCode returnCode =
+      awFmParallelSearchSpacedSeed(index, seed, searchList, 2, false, 1);
+  testAssertString(returnCode == AwFmSuccess &&
+                       searchList->spacedSeedSearchData[0].exceededRangeLimit &&
+                       searchList->spacedSeedSearchData[0].count == 0,
+                   "a search past its range limit should be flagged.");
+  returnCode =
+      awFmParallelSearchSpacedSeed(index, seed, searchList, 1000, false, 1);
+  testAssertString(returnCode == AwFmSuccess &&
+                       !searchList->spacedSeedSearchData[0].exceededRangeLimit,
+                   "a search within its range limit shouldn't be flagged.");
+
+  awFmDeallocSpacedSeedSearchList(searchList);
+  awFmDeallocSpacedSeed(seed);
+  awFmDeallocIndex(index);
+}
+
+void testInvalidPatterns(void) {
+  char sequence[] = "acgtacgtacgtaaaccc";
+  struct AwFmIndexConfiguration config = {.suffixArrayCompressionRatio = 4,
+                                          .kmerLengthInSeedTable = 2,
+                                          .alphabetType = AwFmAlphabetDna,
+                                          .keepSuffixArrayInMemory = true,
+                                          .storeOriginalSequence = false};
+  struct AwFmIndex *index;
+  awFmCreateIndex(&index, &config, (uint8_t *)sequence, strlen(sequence),
+                  INDEX_SRC);
+  struct AwFmSpacedSeed *seed;
+  testAssertString(awFmCreateSpacedSeed(&seed, index, "000", 0) ==
+                       AwFmIllegalPositionError,
+                   "a pattern without care positions should be rejected.");
+  testAssertString(awFmCreateSpacedSeed(&seed, index, "1*1", 0) ==
+                       AwFmIllegalPositionError,
+                   "a pattern with other letters should be rejected.");
+  testAssertString(awFmCreateSpacedSeed(&seed, index, "101", 3) ==
+                       AwFmIllegalPositionError,
+                   "a table past the care positions should be rejected.");
+  awFmDeallocIndex(index);
+}
@@ -0,0 +1,97 @@
+#include <omp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/AwFmIndex.h"
+#include "../../src/AwFmSuffixSort.h"
+#include "../test.h"
+#include "divsufsort64.h"
+
+char buffer[2048];
+
+void testAgainstDivsufsort(const size_t length, const uint8_t alphabetSize,
+                           const size_t period);
+void testSingleCharacterText(const size_t length);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  const int maxThreads = omp_get_max_threads();
+  for (int numThreads = 1; numThreads <= 4; numThreads++) {
+    omp_set_num_threads(numThreads);
+    for (size_t i = 0; i < 20; i++) {
+      testAgainstDivsufsort(1 + rand() % 40, 1 + rand() % 4, 0);
+      testAgainstDivsufsort(1000 + rand() % 100000, 4, 0);
+      testAgainstDivsufsort(1000 + rand() % 100000, 20, 0);
+      testAgainstDivsufsort(1000 + rand() % 100000, 255, 0);
+      testAgainstDivsufsort(1000 + rand() % 20000, 4, 1 + rand() % 50);
+    }
+    // large enough that the first group is sorted by all threads together.
+    testSingleCharacterText(3000000);
+  }
+  omp_set_num_threads(maxThreads);
+
+  printf("suffix sort testing finished.\n");
+}
+
+// period 0 makes a random text; otherwise the text repeats a random string
+// of that length, so suffixes share long prefixes.
+void testAgainstDivsufsort(const size_t length, const uint8_t alphabetSize,
+                           const size_t period) {
+  uint8_t *text = calloc(length, 1);
+  uint64_t *suffixArray = malloc(length * sizeof(uint64_t));
+  int64_t *expectedSuffixArray = malloc(length * sizeof(int64_t));
+  for (size_t i = 0; i < length; i++) {
+    text[i] = (period != 0 && i >= period) ? text[i - period]
+                                           : 1 + rand() % alphabetSize;
+  }
+
+  enum AwFmReturnCode rc = awFmParallelSuffixSort(text, suffixArray, length);
+  sprintf(buffer, "parallel suffix sort returned error code %i.", rc);
+  testAssertString(rc == AwFmSuccess, buffer);
+  divsufsort64(text, expectedSuffixArray, length);
+
+  for (size_t i = 0; i < length; i++) {
+    if (suffixArray[i] != (uint64_t)expectedSuffixArray[i]) {
+      sprintf(buffer,
+              "suffix array position %zu was %zu, expected %zu (length %zu, "
+              "alphabet %u, period %zu).",
+              i, suffixArray[i], expectedSuffixArray[i], length, alphabetSize,
+              period);
+      testAssertString(false, buffer);
+      break;
+    }
+  }
+
+  free(text);
+  free(suffixArray);
+  free(expectedSuffixArray);
+}
+
+void testSingleCharacterText(const size_t length) {
+  uint8_t *text = malloc(length);
+  uint64_t *suffixArray = malloc(length * sizeof(uint64_t));
+  memset(text, 'a', length);
+
+  enum AwFmReturnCode rc = awFmParallelSuffixSort(text, suffixArray, length);
+  sprintf(buffer, "parallel suffix sort returned error code %i.", rc);
+  testAssertString(rc == AwFmSuccess, buffer);
+
+  // shorter suffixes of a single repeated character sort first.
+  for (size_t i = 0; i < length; i++) {
+    if (suffixArray[i] != length - 1 - i) {
+      sprintf(buffer,
+              "single character suffix array position %zu was %zu, expected "
+              "%zu.",
+              i, suffixArray[i], length - 1 - i);
+      testAssertString(false, buffer);
+      break;
+    }
+  }
+
+  free(text);
+  free(suffixArray);
+}
@@ -0,0 +1,278 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/AwFmIndex.h"
+#include "../test.h"
+
+char buffer[2048];
+const char aminoLetters[] = "acdefghiklmnpqrstvwy";
+const char nucleotideLetters[] = "tcag";
+// the standard genetic code in tcag order, with stops as '*'.
+const char geneticCode[] =
+    "ffllssssyy**cc*wllllpppphhqqrrrriiimttttnnkkssrrvvvvaaaaddeegggg";
+
+#define INDEX_SRC "translatedSearchTest.awfmi"
+
+void testTranslatedSearch(const size_t sequenceLength, const size_t numReads,
+                          const size_t kmerLength);
+void testArgumentErrors(void);
+
+int main(int argc, char **argv) {
+  srand(time(NULL));
+  for (size_t i = 0; i < 3; i++) {
+    testTranslatedSearch(1 + rand() % 20000, 1 + rand() % 200,
+                         1 + rand() % 12);
+  }
+  testTranslatedSearch(5000, 100, 2);
+  testTranslatedSearch(5000, 100, 4);
+  testArgumentErrors();
+
+  remove(INDEX_SRC);
+  printf("translated search testing finished.\n");
+}
+
+char translateCodon(const char *codon) {
+  size_t codonIndex = 0;
+  for (size_t i = 0; i < 3; i++) {
+    const char letter = codon[i] | 0x20;
+    const char *found =
+        strchr(nucleotideLetters, letter == 'u' ? 't' : letter);
+    if (found == NULL) {
+      return '*';
+    }
+    codonIndex = (codonIndex * 4) + (found - nucleotideLetters);
+  }
+  return geneticCode[codonIndex];
+}
+
+char complement(const char letter) {
+  switch (letter | 0x20) {
+  case 'a':
+    return 't';
+  case 'c':
+    return 'g';
+  case 'g':
+    return 'c';
+  case 't':
+  case 'u':
+    return 'a';
+  default:
+    return 'n';
+  }
+}
+
+// writes a random codon for the amino acid.
+void randomCodon(const char aminoAcid, char *codon) {
+  size_t codonIndex;
+  do {
+    codonIndex = rand() % 64;
+  } while (geneticCode[codonIndex] != aminoAcid);
+  codon[0] = nucleotideLetters[codonIndex / 16];
+  codon[1] = nucleotideLetters[(codonIndex / 4) % 4];
+  codon[2] = nucleotideLetters[codonIndex % 4];
+}
+
+// reads are a random flank, the reverse translation of a piece of the
+// database, and another flank, on a random strand, with a few ambiguity
+// letters, mixed case, and u for t.
+char *makeRead(const char *sequence, const size_t sequenceLength,
+               size_t *readLength) {
+  const size_t leftFlank = rand() % 8;
+  const size_t rightFlank = rand() % 8;
+  const size_t pieceStart = rand() % sequenceLength;
+  size_t pieceLength = 1 + rand() % 40;
+  if (pieceStart + pieceLength > sequenceLength) {
+    pieceLength = sequenceLength - pieceStart;
+  }
+  const size_t length = leftFlank + (3 * pieceLength) + rightFlank;
+  char *read = malloc(length);
+  for (size_t i = 0; i < length; i++) {
+    read[i] = nucleotideLetters[rand() % 4];
+  }
+  for (size_t i = 0; i < pieceLength; i++) {
+    randomCodon(sequence[pieceStart + i], read + leftFlank + (3 * i));
+  }
+  if (rand() % 2) {
+    for (size_t i = 0; i < length / 2; i++) {
+      const char swap = read[i];
+      read[i] = complement(read[length - 1 - i]);
+      read[length - 1 - i] = complement(swap);
+    }
+    if (length % 2) {
+      read[length / 2] = complement(read[length / 2]);
+    }
+  }
+  for (size_t i = 0; i < length; i++) {
+    if (rand() % 150 == 0) {
+      read[i] = 'n';
+    } else if (rand() % 10 == 0) {
+      read[i] = read[i] == 't' ? 'u' : read[i] - 0x20;
+    }
+  }
+  *readLength = length;
+  return read;
+}
+
+int compareHits(const void *a, const void *b) {
+  const struct AwFmTranslatedHit *x = a;
+  const struct AwFmTranslatedHit *y = b;
+  if (x->frame != y->frame) {
+    return x->frame < y->frame ? -1 : 1;
+  }
+  if (x->readPosition != y->readPosition) {
+    return x->readPosition < y->readPosition ? -1 : 1;
+  }
+  return x->databasePosition < y->databasePosition
+             ? -1
+             : x->databasePosition > y->databasePosition;
+}
+
+// translates the frame's codons one by one, and finds every kmer in the
+// database by comparing it at every position. The hits are allocated.
+size_t bruteForceHits(const char *sequence, const size_t sequenceLength,
+                      const char *read, const size_t readLength,
+                      const size_t kmerLength,
+                      struct AwFmTranslatedHit **hitsOut) {
+  size_t capacity = 16;
+  struct AwFmTranslatedHit *hits =
+      malloc(capacity * sizeof(struct AwFmTranslatedHit));
+  char *reverseComplement = malloc(readLength);
+  for (size_t i = 0; i < readLength; i++) {
+    reverseComplement[i] = complement(read[readLength - 1 - i]);
+  }
+  char *peptide = malloc(readLength / 3 + 1);
+  size_t numHits = 0;
+  for (uint8_t frame = 0; frame < 6; frame++) {
+    const char *strand = frame < 3 ? read : reverseComplement;
+    const size_t offset = frame % 3;
+    const size_t peptideLength =
+        readLength > offset ? (readLength - offset) / 3 : 0;
+    for (size_t i = 0; i < peptideLength; i++) {
+      peptide[i] = translateCodon(strand + offset + (3 * i));
+    }
+    for (size_t start = 0; start + kmerLength <= peptideLength; start++) {
+      if (memchr(peptide + start, '*', kmerLength) != NULL) {
+        continue;
+      }
+      for (size_t position = 0; position + kmerLength <= sequenceLength;
+           position++) {
+        if (memcmp(sequence + position, peptide + start, kmerLength) == 0) {
+          if (numHits == capacity) {
+            capacity *= 2;
+            hits = realloc(hits, capacity * sizeof(struct AwFmTranslatedHit));
+          }
+          const size_t strandPosition = offset + (3 * start);
+          hits[numHits++] = (struct AwFmTranslatedHit){
+              .databasePosition = position,
+              .readPosition = frame < 3 ? strandPosition
+                                        : readLength - strandPosition -
+                                              (3 * kmerLength),
+              .frame = frame};
+        }
+      }
+    }
+  }
+  free(peptide);
+  free(reverseComplement);
+  *hitsOut = hits;
+  return numHits;
+}
+
+void testTranslatedSearch(const size_t sequenceLength, const size_t numReads,
+                          const size_t kmerLength) {
+  char *sequence = malloc(sequenceLength);
+  for (size_t i = 0; i < sequenceLength; i++) {
+    sequence[i] = aminoLetters[rand() % 20];
+  }
+  struct AwFmIndexConfiguration config = {
+      .suffixArrayCompressionRatio = 1 + rand() % 8,
+      .kmerLengthInSeedTable = 3,
+      .alphabetType = AwFmAlphabetAmino,
+      .keepSuffixArrayInMemory = rand() % 2,
+      .storeOriginalSequence = false};
+  struct AwFmIndex *index;
+  enum AwFmReturnCode returnCode = awFmCreateIndex(
+      &index, &config, (uint8_t *)sequence, sequenceLength, INDEX_SRC);
+  testAssertString(returnCode == AwFmFileWriteOkay, "index creation failed.");
+
+  struct AwFmTranslatedSearchList *searchList =
+      awFmCreateTranslatedSearchList(numReads);
+  for (size_t i = 0; i < numReads; i++) {
+    size_t readLength;
+    searchList->translatedSearchData[i].readString =
+        makeRead(sequence, sequenceLength, &readLength);
+    searchList->translatedSearchData[i].readLength = readLength;
+  }
+  searchList->count = numReads;
+
+  // searched twice, so the second search reuses the hit lists.
+  for (size_t search = 0; search < 2; search++) {
+    returnCode =
+        awFmParallelSearchTranslated(index, searchList, kmerLength, 3);
+    testAssertString(returnCode == AwFmSuccess, "translated search failed.");
+  }
+
+  for (size_t i = 0; i < numReads; i++) {
+    struct AwFmTranslatedSearchData *searchData =
+        &searchList->translatedSearchData[i];
+    struct AwFmTranslatedHit *expectedHits;
+    const size_t numExpected = bruteForceHits(
+        sequence, sequenceLength, searchData->readString,
+        searchData->readLength, kmerLength, &expectedHits);
+    sprintf(buffer, "read %zu of length %zu expected %zu hits, got %u.", i,
+            searchData->readLength, numExpected, searchData->count);
+    testAssertString(searchData->count == numExpected, buffer);
+
+    if (searchData->count == numExpected && numExpected != 0) {
+      qsort(searchData->hits, searchData->count,
+            sizeof(struct AwFmTranslatedHit), compareHits);
+      qsort(expectedHits, numExpected, sizeof(struct AwFmTranslatedHit),
+            compareHits);
+      for (size_t hit = 0; hit < numExpected; hit++) {
+        testAssertString(
+            searchData->hits[hit].frame == expectedHits[hit].frame &&
+                searchData->hits[hit].readPosition ==
+                    expectedHits[hit].readPosition &&
+                searchData->hits[hit].databasePosition ==
+                    expectedHits[hit].databasePosition,
+            "translated hit didn't match.");
+      }
+    }
+    free(expectedHits);
+    free(searchData->readString);
+  }
+
+  awFmDeallocTranslatedSearchList(searchList);
+  awFmDeallocIndex(index);
+  free(sequence);
+}
+
+void testArgumentErrors(void) {
+  char sequence[] = "acgtacgtacgtaaaccc";
+  struct AwFmIndexConfiguration config = {.suffixArrayCompressionRatio = 4,
+                                          .kmerLengthInSeedTable = 4,
+                                          .alphabetType = AwFmAlphabetDna,
+                                          .keepSuffixArrayInMemory = true,
+                                          .storeOriginalSequence = false};
+  struct AwFmIndex *index;
+  awFmCreateIndex(&index, &config, (uint8_t *)sequence, strlen(sequence),
+                  INDEX_SRC);
+  struct AwFmTranslatedSearchList *searchList =
+      awFmCreateTranslatedSearchList(1);
+  searchList->translatedSearchData[0].readString = "atgaaacccggg";
+  searchList->translatedSearchData[0].readLength = 12;
+  searchList->count = 1;
+
+  testAssertString(awFmParallelSearchTranslated(index, searchList, 2, 1) ==
+                       AwFmIncompatibleIndices,
+                   "nucleotide indices should be rejected.");
+  testAssertString(awFmParallelSearchTranslated(index, searchList, 0, 1) ==
+                       AwFmIllegalPositionError,
+                   "zero length kmers should be rejected.");
+  awFmDeallocTranslatedSearchList(searchList);
+  awFmDeallocIndex(index);
+}
@@ -15,6 +15,7 @@ int64_t getChromosomeFromFullFasta(char *fastaFileSrc, int chromosomeNumber, cha
 void buildChromosomeIndex(
 		int chromosomeNumber, uint8_t suffixArrayCompressionRatio, uint8_t kmerLengthInSeedTable, char *indexFilename);
 void buildFullGenomeIndex(uint8_t suffixArrayCompressionRatio, uint8_t kmerLengthInSeedTable, char *indexFilename);
+void printBuildStatistics(const struct AwFmBuildStatistics *statistics);
 void parseArgs(int argc, char **argv);
 
 // parameters
@@ -104,11 +105,12 @@ void buildChromosomeIndex(
 	}
 
 	struct AwFmIndex *index;
-	struct AwFmIndexMetadata metadata = {.versionNumber = 1,
-			.suffixArrayCompressionRatio										= suffixArrayCompressionRatio,
-			.kmerLengthInSeedTable													= kmerLengthInSeedTable,
-			.alphabetType																		= AwFmAlphabetNucleotide,
-			.keepSuffixArrayInMemory												= false};
+	struct AwFmBuildStatistics statistics;
+	struct AwFmIndexConfiguration config = {.suffixArrayCompressionRatio = suffixArrayCompressionRatio,
+			.kmerLengthInSeedTable = kmerLengthInSeedTable,
+			.alphabetType = AwFmAlphabetDna,
+			.keepSuffixArrayInMemory = false};
+	struct AwFmIndexBuildOptions options = {.buildStatistics = &statistics};
 
 	if(sequenceLength > 1000) {
 		printf("for reference, here's the first 1000 characters in the sequence: %.*s\n", 1000, sequenceBuffer);
@@ -119,13 +121,14 @@ void buildChromosomeIndex(
 				sequenceBuffer);
 	}
 
-	enum AwFmReturnCode returnCode =
-			awFmCreateIndex(&index, &metadata, (uint8_t *)sequenceBuffer, sequenceLength, indexFilename, true);
+	enum AwFmReturnCode returnCode = awFmCreateIndexWithOptions(
+			&index, &config, (uint8_t *)sequenceBuffer, sequenceLength, indexFilename, &options);
 
 	if(returnCode < 0) {
-		printf("Error: awFmCreateIndex returned error code %i", returnCode);
+		printf("Error: awFmCreateIndexWithOptions returned error code %i", returnCode);
 		exit(-1);
 	}
+	printBuildStatistics(&statistics);
 
 	awFmDeallocIndex(index);
 	free(sequenceBuffer);
@@ -141,22 +144,46 @@ void buildFullGenomeIndex(uint8_t suffixArrayCompressionRatio, uint8_t kmerLengt
 	}
 
 	struct AwFmIndex *index;
-	struct AwFmIndexMetadata metadata = {.versionNumber = 1,
-			.suffixArrayCompressionRatio										= suffixArrayCompressionRatio,
-			.kmerLengthInSeedTable													= kmerLengthInSeedTable,
-			.alphabetType																		= AwFmAlphabetNucleotide};
-	enum AwFmReturnCode returnCode =
-			awFmCreateIndex(&index, &metadata, (uint8_t *)sequenceBuffer, sequenceLength, indexFilename, true);
+	struct AwFmBuildStatistics statistics;
+	struct AwFmIndexConfiguration config = {.suffixArrayCompressionRatio = suffixArrayCompressionRatio,
+			.kmerLengthInSeedTable = kmerLengthInSeedTable,
+			.alphabetType = AwFmAlphabetDna};
+	struct AwFmIndexBuildOptions options = {.buildStatistics = &statistics};
+	enum AwFmReturnCode returnCode = awFmCreateIndexWithOptions(
+			&index, &config, (uint8_t *)sequenceBuffer, sequenceLength, indexFilename, &options);
 
 	if(returnCode < 0) {
-		printf("Error: awFmCreateIndex returned error code %i", returnCode);
+		printf("Error: awFmCreateIndexWithOptions returned error code %i", returnCode);
 		exit(-1);
 	}
+	printBuildStatistics(&statistics);
 
 	awFmDeallocIndex(index);
 	free(sequenceBuffer);
 }
 
+void printBuildStatistics(const struct AwFmBuildStatistics *statistics) {
+	printf("%-20s %12s %12s %16s\n", "phase", "wall (s)", "cpu (s)", "peak rss (MB)");
+	double totalWallSeconds = 0;
+	double totalCpuSeconds	= 0;
+	size_t peakResidentBytes = 0;
+	for(uint8_t phase = 0; phase < AW_FM_NUM_BUILD_PHASES; phase++) {
+		const struct AwFmBuildPhaseStatistics *phaseStatistics = &statistics->phases[phase];
+		printf("%-20s %12.3f %12.3f %16.1f\n", awFmGetBuildPhaseName(phase), phaseStatistics->wallSeconds,
+				phaseStatistics->cpuSeconds, phaseStatistics->peakResidentBytes / (1024.0 * 1024.0));
+		totalWallSeconds += phaseStatistics->wallSeconds;
+		totalCpuSeconds += phaseStatistics->cpuSeconds;
+		if(phaseStatistics->peakResidentBytes > peakResidentBytes) {
+			peakResidentBytes = phaseStatistics->peakResidentBytes;
+		}
+	}
+	printf("%-20s %12.3f %12.3f %16.1f\n", "total", totalWallSeconds, totalCpuSeconds,
+			peakResidentBytes / (1024.0 * 1024.0));
+	printf("estimated peak construction memory: %.1f MB\n", statistics->peakConstructionBytes / (1024.0 * 1024.0));
+	printf("index file write: %.3f s total, %.3f s not overlapped with construction\n", statistics->fileWriteSeconds,
+			statistics->fileWriteWaitSeconds);
+}
+
 int64_t getChromosomeFromFullFasta(char *fastaFileSrc, int chromosomeNumber, char *buffer) {
 	printf("getting chromosome full fasta\n");
 	const uint8_t chromosomeNumberOnesPlace = chromosomeNumber % 10 + '0';
@@ -0,0 +1,189 @@
+// Compares random kmer search time and dTLB load misses for each
+// AwFmAllocationPolicy. dTLB misses are counted with perf_event_open, which may
+// require lowering /proc/sys/kernel/perf_event_paranoid. Explicit hugetlb pages
+// must be reserved beforehand, e.g.:
+//   echo 2048 > /proc/sys/vm/nr_hugepages
+// otherwise those policies fall back to smaller pages, which is reported in the
+// "backed by" column.
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <linux/perf_event.h>
+#include <omp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "AwFmIndex.h"
+
+#define MAX_THREADS 256
+
+uint8_t aminoLookup[20] = {
+		'a', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'k', 'l', 'm', 'n', 'p', 'q', 'r', 's', 't', 'v', 'w', 'y'};
+uint8_t nucleotideLookup[4] = {'a', 'g', 'c', 't'};
+
+const char *policyNames[4] = {"default", "transparent", "hugetlb-2MB", "hugetlb-1GB"};
+
+char indexFilenameBuffer[1024];
+int numKmersToQuery;
+int kmerLength;
+int numThreads;
+int numRepeats;
+
+int perfFileDescriptors[MAX_THREADS];
+
+void parseArgs(int argc, char **argv);
+void fillSearchListWithRandomKmers(struct AwFmKmerSearchList *searchList, enum AwFmAlphabetType alphabet);
+bool openPerThreadDtlbCounters(void);
+void resetAndEnableCounters(void);
+uint64_t disableAndReadCounters(void);
+
+
+int main(int argc, char **argv) {
+	strcpy(indexFilenameBuffer, "index.awfmi");
+	numKmersToQuery = 1000000;
+	kmerLength			= 16;
+	numThreads			= 4;
+	numRepeats			= 4;
+	parseArgs(argc, argv);
+
+	const bool countersAvailable = openPerThreadDtlbCounters();
+	if(!countersAvailable) {
+		printf("warning: could not open dTLB counters, only timing will be reported.\n");
+	}
+
+	struct AwFmKmerSearchList *searchList = awFmCreateKmerSearchList(numKmersToQuery);
+	if(searchList == NULL) {
+		printf("Error: could not allocate memory for the search list.\n");
+		exit(-2);
+	}
+	searchList->count = numKmersToQuery;
+	for(size_t i = 0; i < numKmersToQuery; i++) {
+		searchList->kmerSearchData[i].kmerString = calloc(kmerLength + 1, sizeof(char));
+		searchList->kmerSearchData[i].kmerLength = kmerLength;
+	}
+
+	printf("%-12s %-12s %-12s %-14s %-14s\n", "policy", "backed by", "seconds", "dTLB misses", "misses/kmer");
+	for(int policy = AwFmAllocationPolicyDefault; policy <= AwFmAllocationPolicyHugePages1GB; policy++) {
+		struct AwFmIndex *index;
+		struct AwFmIndexLoadConfiguration loadConfig = {
+				.keepSuffixArrayInMemory = false, .numThreads = numThreads, .allocationPolicy = policy};
+		enum AwFmReturnCode returnCode = awFmReadIndexFromFileParallel(&index, indexFilenameBuffer, &loadConfig, NULL);
+		if(returnCode < 0) {
+			printf("Error during index read: awFmReadIndexFromFileParallel returned error code %i\n", returnCode);
+			exit(-1);
+		}
+
+		// use the same queries for every policy.
+		srand(1);
+		double totalSeconds				= 0;
+		uint64_t totalDtlbMisses	= 0;
+		for(int repeat = 0; repeat < numRepeats; repeat++) {
+			fillSearchListWithRandomKmers(searchList, index->config.alphabetType);
+			if(countersAvailable) {
+				resetAndEnableCounters();
+			}
+			double startTime = omp_get_wtime();
+			awFmParallelSearchCount(index, searchList, numThreads);
+			totalSeconds += omp_get_wtime() - startTime;
+			if(countersAvailable) {
+				totalDtlbMisses += disableAndReadCounters();
+			}
+		}
+
+		printf("%-12s %-12s %-12f %-14zu %-14f\n", policyNames[policy], policyNames[index->bwtAllocationPolicy],
+				totalSeconds / numRepeats, (size_t)(totalDtlbMisses / numRepeats),
+				(double)totalDtlbMisses / ((double)numRepeats * numKmersToQuery));
+		awFmDeallocIndex(index);
+	}
+
+	for(size_t i = 0; i < numKmersToQuery; i++) {
+		free(searchList->kmerSearchData[i].kmerString);
+	}
+	awFmDeallocKmerSearchList(searchList);
+}
+
+
+void parseArgs(int argc, char **argv) {
+	int option = 0;
+	while((option = getopt(argc, argv, "f:n:k:t:r:")) != -1) {
+		switch(option) {
+			case 'f': strcpy(indexFilenameBuffer, optarg); break;
+			case 'n': sscanf(optarg, "%i", &numKmersToQuery); break;
+			case 'k': sscanf(optarg, "%i", &kmerLength); break;
+			case 't': sscanf(optarg, "%i", &numThreads); break;
+			case 'r': sscanf(optarg, "%i", &numRepeats); break;
+		}
+	}
+	if(numThreads > MAX_THREADS) {
+		numThreads = MAX_THREADS;
+	}
+}
+
+
+void fillSearchListWithRandomKmers(struct AwFmKmerSearchList *searchList, enum AwFmAlphabetType alphabet) {
+	for(size_t i = 0; i < searchList->count; i++) {
+		char *kmer = searchList->kmerSearchData[i].kmerString;
+		for(size_t letter = 0; letter < kmerLength; letter++) {
+			kmer[letter] =
+					alphabet == AwFmAlphabetAmino ? aminoLookup[rand() % 20] : nucleotideLookup[rand() % 4];
+		}
+	}
+}
+
+
+// opens a dTLB load miss counter on each OpenMP worker thread. OpenMP reuses the
+// same threads across parallel regions with the same thread count, so each
+// counter keeps measuring the same worker.
+bool openPerThreadDtlbCounters(void) {
+	bool allCountersOpened = true;
+#pragma omp parallel num_threads(numThreads)
+	{
+		struct perf_event_attr attributes;
+		memset(&attributes, 0, sizeof(struct perf_event_attr));
+		attributes.type						= PERF_TYPE_HW_CACHE;
+		attributes.size						= sizeof(struct perf_event_attr);
+		attributes.config					= PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+										 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		attributes.disabled				= 1;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv			= 1;
+
+		int fileDescriptor = syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+		perfFileDescriptors[omp_get_thread_num()] = fileDescriptor;
+		if(fileDescriptor < 0) {
+#pragma omp atomic write
+			allCountersOpened = false;
+		}
+	}
+	return allCountersOpened;
+}
+
+
+void resetAndEnableCounters(void) {
+#pragma omp parallel num_threads(numThreads)
+	{
+		int fileDescriptor = perfFileDescriptors[omp_get_thread_num()];
+		ioctl(fileDescriptor, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fileDescriptor, PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
+
+
+uint64_t disableAndReadCounters(void) {
+	uint64_t totalCount = 0;
+#pragma omp parallel num_threads(numThreads) reduction(+ : totalCount)
+	{
+		int fileDescriptor = perfFileDescriptors[omp_get_thread_num()];
+		ioctl(fileDescriptor, PERF_EVENT_IOC_DISABLE, 0);
+		uint64_t count = 0;
+		if(read(fileDescriptor, &count, sizeof(uint64_t)) == sizeof(uint64_t)) {
+			totalCount += count;
+		}
+	}
+	return totalCount;
+}